@@ -35,19 +35,17 @@ namespace EntityMapping {
 
 namespace Cases {
 
-AttributeCase::AttributeCase(AttributeComparers::AttributeComparerWrapper* comparerWrapper)
-: mComparerWrapper(std::unique_ptr<AttributeComparers::AttributeComparerWrapper>(comparerWrapper))
+AttributeCase::AttributeCase(AttributeComparers::AttributeComparerWrapper& comparerWrapper)
+: mComparerWrapper(comparerWrapper)
 {
 }
 
 
 bool AttributeCase::testMatch(const Atlas::Message::Element& attribute)
 {
-	if (mComparerWrapper) {
-		if (mComparerWrapper->testAttribute(attribute)) {
-			setState(true);
-			return true;
-		}
+	if (mComparerWrapper.testAttribute(attribute)) {
+		setState(true);
+		return true;
 	}
 	setState(false);
 	return false;
@@ -59,11 +59,15 @@ namespace Cases {
 class AttributeCase : public Case<Matches::AttributeMatch>
 {
 public:
-	explicit AttributeCase(AttributeComparers::AttributeComparerWrapper* comparerWrapper);
+	/**
+	Creates a new case.
+	@param comparerWrapper The comparer to test attributes with. This isn't owned by the case, since it's shared by all mappings created from the same compiled definition.
+	*/
+	explicit AttributeCase(AttributeComparers::AttributeComparerWrapper& comparerWrapper);
 	bool testMatch(const Atlas::Message::Element& attribute);
 
 protected:
-	std::unique_ptr<AttributeComparers::AttributeComparerWrapper> mComparerWrapper;
+	AttributeComparers::AttributeComparerWrapper& mComparerWrapper;
 };
 
 }
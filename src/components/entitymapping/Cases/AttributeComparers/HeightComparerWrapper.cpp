@@ -26,7 +26,8 @@
 
 #include "HeightComparerWrapper.h"
 #include "NumericComparer.h"
-#include <Eris/Entity.h>
+#include <wfmath/atlasconv.h>
+#include <wfmath/axisbox.h>
 
 namespace Ember {
 
@@ -38,14 +39,23 @@ namespace Cases {
 
 namespace AttributeComparers {
 
-HeightComparerWrapper::HeightComparerWrapper(NumericComparer* comparer, Eris::Entity& entity)
-: mNumericComparer(comparer), mEntity(entity)
+HeightComparerWrapper::HeightComparerWrapper(NumericComparer* comparer)
+: mNumericComparer(comparer)
 {
 }
 
-bool HeightComparerWrapper::testAttribute(const Atlas::Message::Element&)
+bool HeightComparerWrapper::testAttribute(const Atlas::Message::Element& attribute)
 {
-	return mEntity.hasBBox() && (mNumericComparer->test(mEntity.getBBox().upperBound(2) - mEntity.getBBox().lowerBound(2)));
+	if (!attribute.isList()) {
+		return false;
+	}
+	WFMath::AxisBox<3> bbox;
+	try {
+		bbox.fromAtlas(attribute);
+	} catch (...) {
+		return false;
+	}
+	return bbox.isValid() && mNumericComparer->test(bbox.upperBound(2) - bbox.lowerBound(2));
 }
 
 
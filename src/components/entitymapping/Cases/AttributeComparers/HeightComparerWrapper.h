@@ -26,12 +26,6 @@
 #include <memory>
 #include "AttributeComparerWrapper.h"
 
-namespace Eris
-{
-class Entity;
-}
-
-
 namespace Ember {
 
 
@@ -45,7 +39,8 @@ namespace AttributeComparers {
 class NumericComparer;
 
 /**
-	Compares the height of an entity. The height is calculated from the bounding box.
+	Compares the height of an entity. The height is calculated from the bounding box, so the "bbox" attribute should be tested.
+	Since no entity is held, instances can be shared by the mappings of many entities.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class HeightComparerWrapper : public AttributeComparerWrapper
@@ -54,18 +49,16 @@ public:
 	/**
 	* Default constructor.
 	* @param comparer The NumericComparer to use for comparison.
-	* @param entity
 	*/
-	HeightComparerWrapper(NumericComparer* comparer, Eris::Entity& entity);
+	explicit HeightComparerWrapper(NumericComparer* comparer);
 
 	/**
-	Test the height. The attribute passed will be ignored.
+	Test the height of the supplied bounding box.
 	*/
 	bool testAttribute(const Atlas::Message::Element& attribute) override;
 
 protected:
 	std::unique_ptr<NumericComparer> mNumericComparer;
-	Eris::Entity& mEntity;
 };
 }
 
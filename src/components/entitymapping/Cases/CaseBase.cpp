@@ -44,7 +44,6 @@ CaseBase::CaseBase()
 
 CaseBase::~CaseBase() {
 	::Ember::EntityMapping::cleanVector(mActions);
-	::Ember::EntityMapping::cleanVector(mMatches);
 }
 
 void CaseBase::addAction(Actions::Action* action) {
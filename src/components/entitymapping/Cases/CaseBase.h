@@ -54,6 +54,7 @@ namespace Cases {
 	@brief Base class for all Cases.
 	A Case containes zero or many Actions, which will be activated when the Case is activated. A Case also contains zero or many child Matches.
 	A Case is activated when it's true and all it's parent cases, all the way up to the root of the EntityMapping, also are true.
+	The actions are owned by the case, while the matches are held by the EntityMapping the case belongs to.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class CaseBase
@@ -0,0 +1,270 @@
+//
+// C++ Implementation: CompiledDefinition
+//
+// Description:
+//
+//
+// Author: Erik Ogenvik <erik@ogenvik.org>, (C) 2016
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.//
+//
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "CompiledDefinition.h"
+
+#include "Cases/AttributeCase.h"
+#include "Cases/EntityTypeCase.h"
+#include "Cases/OutfitCase.h"
+
+#include "Cases/AttributeComparers/HeightComparerWrapper.h"
+#include "Cases/AttributeComparers/NumericComparer.h"
+#include "Cases/AttributeComparers/NumericComparerWrapper.h"
+#include "Cases/AttributeComparers/NumericEqualsComparer.h"
+#include "Cases/AttributeComparers/NumericEqualsOrGreaterComparer.h"
+#include "Cases/AttributeComparers/NumericEqualsOrLesserComparer.h"
+#include "Cases/AttributeComparers/NumericGreaterComparer.h"
+#include "Cases/AttributeComparers/NumericLesserComparer.h"
+#include "Cases/AttributeComparers/NumericRangeComparer.h"
+#include "Cases/AttributeComparers/StringComparer.h"
+#include "Cases/AttributeComparers/StringComparerWrapper.h"
+
+#include "Matches/AttributeMatch.h"
+#include "Matches/EntityTypeMatch.h"
+#include "Matches/OutfitMatch.h"
+#include "Matches/Observers/EntityCreationObserver.h"
+#include "Matches/Observers/MatchAttributeObserver.h"
+
+#include <Eris/TypeService.h>
+
+namespace Ember {
+
+
+
+namespace EntityMapping {
+
+using namespace Definitions;
+using namespace Cases::AttributeComparers;
+
+static const CaseDefinition::ParameterEntry* findCaseParameter(const CaseDefinition::ParameterStore& parameters, const std::string& type)
+{
+	for (auto& entry : parameters) {
+		if (entry.first == type) {
+			return &(entry);
+		}
+	}
+	return nullptr;
+}
+
+static const std::string& getProperty(const DefinitionBase& definition, const std::string& name)
+{
+	static const std::string empty;
+	auto I = definition.getProperties().find(name);
+	if (I != definition.getProperties().end()) {
+		return I->second;
+	}
+	return empty;
+}
+
+static NumericComparer* createNumericComparer(const CompiledNumericBound& bound)
+{
+	switch (bound.type) {
+	case CompiledNumericBound::EQUALS:
+		return new NumericEqualsComparer(bound.value);
+	case CompiledNumericBound::LESSER:
+		return new NumericLesserComparer(bound.value);
+	case CompiledNumericBound::LESSER_EQUALS:
+		return new NumericEqualsOrLesserComparer(bound.value);
+	case CompiledNumericBound::GREATER:
+		return new NumericGreaterComparer(bound.value);
+	case CompiledNumericBound::GREATER_EQUALS:
+		return new NumericEqualsOrGreaterComparer(bound.value);
+	default:
+		return nullptr;
+	}
+}
+
+static NumericComparer* createNumericComparer(const CompiledCase& compiledCase)
+{
+	NumericComparer* mMin = createNumericComparer(compiledCase.lesserBound);
+	NumericComparer* mMax = createNumericComparer(compiledCase.greaterBound);
+
+	//check if we have both min and max set, and if so we should use a range comparer
+	if (mMin && mMax) {
+		return new NumericRangeComparer(mMin, mMax);
+	} else if (!mMax && mMin) {
+		return mMin;
+	} else if (mMax) {
+		return mMax;
+	}
+	//invalid, could not find anything to compare against
+	return nullptr;
+}
+
+template <typename T>
+void CompiledDefinition::reserveStorage()
+{
+	//Each object is aligned when created, so make room for any padding needed.
+	mStorageSize += sizeof(T) + alignof(T) - 1;
+	mObjectCount++;
+}
+
+CompiledDefinition::CompiledDefinition(EntityMappingDefinition& definition, Eris::TypeService& typeService)
+: mDefinition(definition), mTypeService(typeService), mStorageSize(0), mObjectCount(0)
+{
+	mRoot.type = CompiledMatch::ENTITY_TYPE;
+	compileMatch(mRoot, definition.getRoot());
+}
+
+void CompiledDefinition::compileMatch(CompiledMatch& match, MatchDefinition& matchDefinition)
+{
+	if (match.type == CompiledMatch::ATTRIBUTE) {
+		match.attributeName = getProperty(matchDefinition, "attribute");
+		match.internalAttributeName = match.attributeName;
+
+		const std::string& matchType = getProperty(matchDefinition, "type");
+		if (matchType.empty() || matchType == "string") {
+			//default is string comparison
+			match.comparerType = CompiledMatch::COMPARER_STRING;
+		} else if (matchType == "numeric") {
+			match.comparerType = CompiledMatch::COMPARER_NUMERIC;
+		} else if (matchType == "function") {
+			//TODO: make this check better
+			if (match.attributeName == "height") {
+				match.comparerType = CompiledMatch::COMPARER_HEIGHT;
+				match.internalAttributeName = "bbox";
+			}
+		}
+		//Cases without a comparer would never be created, so there's no need to compile them.
+		if (match.comparerType == CompiledMatch::COMPARER_NONE) {
+			return;
+		}
+	} else if (match.type == CompiledMatch::OUTFIT) {
+		match.attributeName = getProperty(matchDefinition, "attachment");
+		match.internalAttributeName = "outfit";
+	}
+
+	match.cases.reserve(matchDefinition.getCases().size());
+	for (auto& caseDefinition : matchDefinition.getCases()) {
+		match.cases.emplace_back();
+		compileCase(match, match.cases.back(), caseDefinition);
+	}
+}
+
+void CompiledDefinition::compileCase(CompiledMatch& match, CompiledCase& aCase, CaseDefinition& caseDefinition)
+{
+	aCase.definition = &caseDefinition;
+
+	if (match.type == CompiledMatch::ATTRIBUTE) {
+		if (match.comparerType == CompiledMatch::COMPARER_STRING) {
+			if (const CaseDefinition::ParameterEntry* param = findCaseParameter(caseDefinition.getCaseParameters(), "equals")) {
+				aCase.stringValue = param->second;
+			}
+		} else {
+			compileNumericBounds(aCase, caseDefinition);
+		}
+		compileComparer(match, aCase);
+		//Cases without a valid comparer are never created.
+		if (!aCase.comparer) {
+			return;
+		}
+		reserveStorage<Cases::AttributeCase>();
+	} else {
+		if (match.type == CompiledMatch::ENTITY_TYPE) {
+			reserveStorage<Cases::EntityTypeCase>();
+		} else {
+			reserveStorage<Cases::OutfitCase>();
+		}
+		for (auto& paramEntry : caseDefinition.getCaseParameters()) {
+			if (paramEntry.first == "equals") {
+				aCase.entityTypes.push_back(mTypeService.getTypeByName(paramEntry.second));
+			}
+		}
+	}
+
+	for (auto& matchDefinition : caseDefinition.getMatches()) {
+		CompiledMatch childMatch;
+		if (matchDefinition.getType() == "attribute") {
+			childMatch.type = CompiledMatch::ATTRIBUTE;
+			reserveStorage<Matches::AttributeMatch>();
+			reserveStorage<Matches::Observers::MatchAttributeObserver>();
+		} else if (matchDefinition.getType() == "entitytype") {
+			childMatch.type = CompiledMatch::ENTITY_TYPE;
+			reserveStorage<Matches::EntityTypeMatch>();
+		} else if (matchDefinition.getType() == "outfit") {
+			childMatch.type = CompiledMatch::OUTFIT;
+			reserveStorage<Matches::OutfitMatch>();
+			reserveStorage<Matches::Observers::MatchAttributeObserver>();
+			reserveStorage<Matches::Observers::EntityCreationObserver>();
+		} else {
+			continue;
+		}
+		compileMatch(childMatch, matchDefinition);
+		aCase.matches.push_back(std::move(childMatch));
+	}
+}
+
+void CompiledDefinition::compileNumericBounds(CompiledCase& aCase, const CaseDefinition& caseDefinition)
+{
+	const CaseDefinition::ParameterEntry* param(nullptr);
+
+	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "equals"))) {
+		aCase.lesserBound.type = CompiledNumericBound::EQUALS;
+		aCase.lesserBound.value = std::stof(param->second);
+		return;
+	}
+
+	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "lesser"))) {
+		aCase.lesserBound.type = CompiledNumericBound::LESSER;
+		aCase.lesserBound.value = std::stof(param->second);
+	} else if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "lesserequals"))) {
+		aCase.lesserBound.type = CompiledNumericBound::LESSER_EQUALS;
+		aCase.lesserBound.value = std::stof(param->second);
+	}
+
+	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "greater"))) {
+		aCase.greaterBound.type = CompiledNumericBound::GREATER;
+		aCase.greaterBound.value = std::stof(param->second);
+	} else if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "greaterequals"))) {
+		aCase.greaterBound.type = CompiledNumericBound::GREATER_EQUALS;
+		aCase.greaterBound.value = std::stof(param->second);
+	}
+}
+
+void CompiledDefinition::compileComparer(const CompiledMatch& match, CompiledCase& aCase)
+{
+	switch (match.comparerType) {
+	case CompiledMatch::COMPARER_STRING:
+		aCase.comparer.reset(new StringComparerWrapper(new StringComparer(aCase.stringValue)));
+		break;
+	case CompiledMatch::COMPARER_NUMERIC:
+		if (NumericComparer* comparer = createNumericComparer(aCase)) {
+			aCase.comparer.reset(new NumericComparerWrapper(comparer));
+		}
+		break;
+	case CompiledMatch::COMPARER_HEIGHT:
+		if (NumericComparer* comparer = createNumericComparer(aCase)) {
+			aCase.comparer.reset(new HeightComparerWrapper(comparer));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+}
+
+}
@@ -0,0 +1,215 @@
+//
+// C++ Interface: CompiledDefinition
+//
+// Description:
+//
+//
+// Author: Erik Ogenvik <erik@ogenvik.org>, (C) 2016
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.//
+//
+#ifndef EMBEROGRE_MODEL_MAPPINGCOMPILEDDEFINITION_H
+#define EMBEROGRE_MODEL_MAPPINGCOMPILEDDEFINITION_H
+
+#include "Definitions/EntityMappingDefinition.h"
+#include "Cases/AttributeComparers/AttributeComparerWrapper.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Eris
+{
+class TypeInfo;
+class TypeService;
+}
+
+namespace Ember {
+
+
+
+namespace EntityMapping {
+
+struct CompiledMatch;
+
+/**
+	One bound of a numeric attribute case, with the value already parsed.
+*/
+struct CompiledNumericBound
+{
+	enum Type
+	{
+		NONE, EQUALS, LESSER, LESSER_EQUALS, GREATER, GREATER_EQUALS
+	};
+
+	Type type = NONE;
+	float value = 0;
+};
+
+/**
+	A case of a compiled match. Only the fields relevant to the type of the owning match are set.
+*/
+struct CompiledCase
+{
+	/**
+	The definition the case was compiled from. This is handed to the IActionCreator when actions are created.
+	*/
+	Definitions::CaseDefinition* definition = nullptr;
+
+	/**
+	Types for entity type and outfit cases, resolved through the type service.
+	*/
+	std::vector<Eris::TypeInfo*> entityTypes;
+
+	/**
+	The value to compare with for string attribute cases.
+	*/
+	std::string stringValue;
+
+	/**
+	Bounds for numeric and function attribute cases. An "equals" value is stored in the lesser bound.
+	If both bounds are set a range comparer is used.
+	*/
+	CompiledNumericBound lesserBound, greaterBound;
+
+	/**
+	The comparer for attribute cases, created from the value or bounds. Comparers don't keep any state, so this is shared by all mappings.
+	If null the case is never created.
+	*/
+	std::unique_ptr<Cases::AttributeComparers::AttributeComparerWrapper> comparer;
+
+	std::vector<CompiledMatch> matches;
+};
+
+/**
+	A match of a compiled definition.
+*/
+struct CompiledMatch
+{
+	enum Type
+	{
+		ENTITY_TYPE, ATTRIBUTE, OUTFIT
+	};
+
+	enum ComparerType
+	{
+		COMPARER_NONE, COMPARER_STRING, COMPARER_NUMERIC, COMPARER_HEIGHT
+	};
+
+	Type type = ENTITY_TYPE;
+
+	/**
+	How attribute cases should be compared. Attribute cases without a valid comparer are never compiled.
+	*/
+	ComparerType comparerType = COMPARER_NONE;
+
+	/**
+	For attribute matches, the name of the attribute. For outfit matches, the name of the attachment.
+	*/
+	std::string attributeName;
+
+	/**
+	The attribute actually observed on the entity (such as "bbox" for the "height" function, or "outfit" for outfit matches).
+	*/
+	std::string internalAttributeName;
+
+	std::vector<CompiledCase> cases;
+};
+
+/**
+	A definition which has been processed once so that it can be applied to many entities.
+
+	All string dispatching, type lookups and number parsing happens when the definition is compiled, so that creating an EntityMapping instance for an entity only needs to create the runtime objects.
+	The comparers and attribute names are used directly by the runtime objects, so each EntityMapping keeps the compiled definition it was created from alive.
+	An instance must not outlive the definition or the type service it was compiled with.
+
+	@author Erik Ogenvik <erik@ogenvik.org>
+*/
+class CompiledDefinition
+{
+public:
+
+	/**
+	 * Compiles the supplied definition.
+	 * @param definition The definition to compile.
+	 * @param typeService The type service used to resolve entity types.
+	 */
+	CompiledDefinition(Definitions::EntityMappingDefinition& definition, Eris::TypeService& typeService);
+
+	/**
+	 * Gets the compiled root match, which is always an entity type match.
+	 */
+	const CompiledMatch& getRoot() const;
+
+	/**
+	 * Gets the definition this was compiled from.
+	 */
+	Definitions::EntityMappingDefinition& getDefinition() const;
+
+	/**
+	 * Gets the number of bytes needed to hold all matches, cases and observers of a mapping created from this definition.
+	 */
+	size_t getStorageSize() const;
+
+	/**
+	 * Gets the number of matches, cases and observers of a mapping created from this definition.
+	 */
+	size_t getObjectCount() const;
+
+protected:
+
+	void compileMatch(CompiledMatch& match, Definitions::MatchDefinition& matchDefinition);
+	void compileCase(CompiledMatch& match, CompiledCase& aCase, Definitions::CaseDefinition& caseDefinition);
+	void compileNumericBounds(CompiledCase& aCase, const Definitions::CaseDefinition& caseDefinition);
+	void compileComparer(const CompiledMatch& match, CompiledCase& aCase);
+
+	/**
+	 * Adds the size of an object of the supplied type to the storage needed.
+	 */
+	template <typename T>
+	void reserveStorage();
+
+	Definitions::EntityMappingDefinition& mDefinition;
+	Eris::TypeService& mTypeService;
+	CompiledMatch mRoot;
+	size_t mStorageSize;
+	size_t mObjectCount;
+};
+
+inline const CompiledMatch& CompiledDefinition::getRoot() const
+{
+	return mRoot;
+}
+
+inline Definitions::EntityMappingDefinition& CompiledDefinition::getDefinition() const
+{
+	return mDefinition;
+}
+
+inline size_t CompiledDefinition::getStorageSize() const
+{
+	return mStorageSize;
+}
+
+inline size_t CompiledDefinition::getObjectCount() const
+{
+	return mObjectCount;
+}
+
+}
+
+}
+
+#endif
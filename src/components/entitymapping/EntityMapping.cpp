@@ -25,6 +25,7 @@
 #endif
 
 #include "EntityMapping.h"
+#include "CompiledDefinition.h"
 #include <Eris/View.h>
 
 namespace Ember {
@@ -34,8 +35,21 @@ namespace Ember {
 namespace EntityMapping {
 
 
-EntityMapping::EntityMapping(Eris::Entity& entity): mEntity(entity)
+EntityMapping::EntityMapping(Eris::Entity& entity, std::shared_ptr<const CompiledDefinition> definition)
+: mEntity(entity), mDefinition(std::move(definition)), mStorageSize(mDefinition->getStorageSize()), mStorageUsed(0)
 {
+	if (mStorageSize) {
+		mStorage.reset(new char[mStorageSize]);
+	}
+	mStoredObjects.reserve(mDefinition->getObjectCount());
+}
+
+EntityMapping::~EntityMapping()
+{
+	//Children are created after their parents, so this destroys them before their parents, as if they were owned by them.
+	for (auto I = mStoredObjects.rbegin(); I != mStoredObjects.rend(); ++I) {
+		I->destroy(I->object);
+	}
 }
 
 Matches::EntityTypeMatch& EntityMapping::getRootEntityMatch()
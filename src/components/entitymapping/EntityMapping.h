@@ -31,6 +31,8 @@
 #include <vector>
 #include <iostream>
 #include <memory>
+#include <new>
+#include <utility>
 
 #include <Atlas/Objects/Entity.h>
 
@@ -54,6 +56,8 @@ namespace Ember {
  */
 namespace EntityMapping {
 
+class CompiledDefinition;
+
 namespace Cases {
 class OutfitCase;
 class CaseBase;
@@ -108,6 +112,9 @@ static void cleanVector(T& theVector)
 
 	Instances of this class are normally not created directly by the application, instead EntityMappingManager::createMapping(...) is used.
 
+	Since a mapping is created for every entity, all of its matches, cases and observers are kept in one block of memory owned by the mapping, sized from the CompiledDefinition it's created from. They're created through create(...), and destroyed along with the mapping.
+	The mapping keeps the compiled definition alive, since its comparers and attribute names are used by the matches and cases.
+
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class EntityMapping
@@ -115,9 +122,23 @@ class EntityMapping
 public:
 	typedef std::vector<Cases::CaseBase*> CaseBaseStore;
 	typedef std::vector<Matches::Observers::MatchAttributeObserver*> MatchAttributeObserverStore;
-    EntityMapping(Eris::Entity& entity);
-
-    ~EntityMapping() = default;
+	/**
+	 * Constructor.
+	 * @param entity The entity the mapping is for.
+	 * @param definition The definition the mapping is created from.
+	 */
+	EntityMapping(Eris::Entity& entity, std::shared_ptr<const CompiledDefinition> definition);
+
+	~EntityMapping();
+
+	/**
+	 * Creates an object in the storage of the mapping. The object will be destroyed when the mapping is.
+	 * Objects are destroyed in the reverse order of their creation, so children should be created after their parents.
+	 * @param args The arguments for the constructor of the object.
+	 * @return The new object.
+	 */
+	template <typename T, typename... TArgs>
+	T* create(TArgs&&... args);
 
     /**
     Gets the root entity match instance.
@@ -132,11 +153,47 @@ public:
 
 protected:
 
+	struct StoredObject
+	{
+		void* object;
+		void (*destroy)(void* object);
+	};
+
 	Matches::EntityTypeMatch mRootEntityMatch;
 
 	Eris::Entity& mEntity;
+
+	std::shared_ptr<const CompiledDefinition> mDefinition;
+
+	/**
+	 * Holds the matches, cases and observers of the mapping.
+	 */
+	std::unique_ptr<char[]> mStorage;
+	size_t mStorageSize;
+	size_t mStorageUsed;
+
+	/**
+	 * All objects created through create(...), in the order they were created.
+	 */
+	std::vector<StoredObject> mStoredObjects;
 };
 
+template <typename T, typename... TArgs>
+T* EntityMapping::create(TArgs&&... args)
+{
+	size_t offset = (mStorageUsed + alignof(T) - 1) & ~(alignof(T) - 1);
+	if (mStorage && offset + sizeof(T) <= mStorageSize) {
+		T* object = new (mStorage.get() + offset) T(std::forward<TArgs>(args)...);
+		mStorageUsed = offset + sizeof(T);
+		mStoredObjects.push_back(StoredObject{object, [](void* instance) { static_cast<T*>(instance)->~T(); }});
+		return object;
+	}
+	//The storage is sized from the compiled definition, so this shouldn't happen, but if it does we'll fall back to the heap.
+	T* object = new T(std::forward<TArgs>(args)...);
+	mStoredObjects.push_back(StoredObject{object, [](void* instance) { delete static_cast<T*>(instance); }});
+	return object;
+}
+
 }
 
 }
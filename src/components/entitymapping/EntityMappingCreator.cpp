@@ -31,18 +31,6 @@
 #include "Cases/OutfitCase.h"
 #include "Cases/AttributeCase.h"
 
-#include "Cases/AttributeComparers/HeightComparerWrapper.h"
-#include "Cases/AttributeComparers/NumericComparer.h"
-#include "Cases/AttributeComparers/NumericComparerWrapper.h"
-#include "Cases/AttributeComparers/NumericEqualsComparer.h"
-#include "Cases/AttributeComparers/NumericEqualsOrGreaterComparer.h"
-#include "Cases/AttributeComparers/NumericEqualsOrLesserComparer.h"
-#include "Cases/AttributeComparers/NumericGreaterComparer.h"
-#include "Cases/AttributeComparers/NumericLesserComparer.h"
-#include "Cases/AttributeComparers/NumericRangeComparer.h"
-#include "Cases/AttributeComparers/StringComparer.h"
-#include "Cases/AttributeComparers/StringComparerWrapper.h"
-
 
 #include "Matches/Observers/EntityCreationObserver.h"
 
@@ -54,24 +42,12 @@ namespace Ember {
 
 namespace EntityMapping {
 
-using namespace Definitions;
 using namespace Matches;
 using namespace Observers;
 using namespace Cases;
-using namespace AttributeComparers;
-
-static const CaseDefinition::ParameterEntry* findCaseParameter(const CaseDefinition::ParameterStore& parameters, const std::string& type)
-{
-	for (auto& entry : parameters) {
-		if (entry.first == type) {
-			return &(entry);
-		}
-	}
-	return nullptr;
-}
 
-EntityMappingCreator::EntityMappingCreator(EntityMappingDefinition& definition, Eris::Entity& entity, IActionCreator& actionCreator, Eris::TypeService& typeService, Eris::View* view)
-: mActionCreator(actionCreator), mEntity(entity), mModelMap(0), mDefinition(definition), mTypeService(typeService), mView(view)
+EntityMappingCreator::EntityMappingCreator(std::shared_ptr<const CompiledDefinition> definition, Eris::Entity& entity, IActionCreator& actionCreator, Eris::View* view)
+: mActionCreator(actionCreator), mEntity(entity), mModelMap(0), mDefinition(std::move(definition)), mView(view)
 {
 }
 
@@ -83,32 +59,26 @@ EntityMapping* EntityMappingCreator::create()
 
 
 EntityMapping* EntityMappingCreator::createMapping() {
-	mModelMap = new EntityMapping(mEntity);
-	addEntityTypeCases(&mModelMap->getRootEntityMatch(), mDefinition.getRoot());
+	mModelMap = new EntityMapping(mEntity, mDefinition);
+	addEntityTypeCases(&mModelMap->getRootEntityMatch(), mDefinition->getRoot());
 
 	//since we already have the entity, we can perform a check right away
 	mModelMap->getRootEntityMatch().setEntity(&mEntity);
 	return mModelMap;
 }
 
-void EntityMappingCreator::addEntityTypeCases(EntityTypeMatch* entityTypeMatch, MatchDefinition& matchDefinition) {
-	for (auto& aCase : matchDefinition.getCases()) {
-		EntityTypeCase* entityCase = new EntityTypeCase();
+void EntityMappingCreator::addEntityTypeCases(EntityTypeMatch* entityTypeMatch, const CompiledMatch& compiledMatch) {
+	entityTypeMatch->getCases().reserve(compiledMatch.cases.size());
+	for (auto& aCase : compiledMatch.cases) {
+		EntityTypeCase* entityCase = mModelMap->create<EntityTypeCase>();
 
-		for (auto& paramEntry : aCase.getCaseParameters()) {
-			if (paramEntry.first == "equals") {
-				entityCase->addEntityType(mTypeService.getTypeByName(paramEntry.second));
-			}
+		for (auto typeInfo : aCase.entityTypes) {
+			entityCase->addEntityType(typeInfo);
 		}
 
-/*			const std::string& entityName = aCase.getProperties()["equals"];
-		std::vector<std::string> splitNames = EntityMappingManager::splitString(entityName, "|", 100);
-		for (std::vector<std::string>::const_iterator J = splitNames.begin(); J != splitNames.end(); ++J) {
-			aCase->addEntityType(mTypeService.getTypeByName(*J));
-		}*/
-		mActionCreator.createActions(*mModelMap, entityCase, aCase);
+		mActionCreator.createActions(*mModelMap, entityCase, *aCase.definition);
 
-		for (auto& aMatch : aCase.getMatches()) {
+		for (auto& aMatch : aCase.matches) {
 			addMatch(entityCase, aMatch);
 		}
 		entityTypeMatch->addCase( entityCase);
@@ -116,24 +86,19 @@ void EntityMappingCreator::addEntityTypeCases(EntityTypeMatch* entityTypeMatch,
 	}
 }
 
-void EntityMappingCreator::addOutfitCases(OutfitMatch* match, MatchDefinition& matchDefinition)
+void EntityMappingCreator::addOutfitCases(OutfitMatch* match, const CompiledMatch& compiledMatch)
 {
-	for (auto& aCase : matchDefinition.getCases()) {
-		OutfitCase* outfitCase = new OutfitCase();
+	match->getCases().reserve(compiledMatch.cases.size());
+	for (auto& aCase : compiledMatch.cases) {
+		OutfitCase* outfitCase = mModelMap->create<OutfitCase>();
 
-		for (auto& paramEntry : aCase.getCaseParameters()) {
-			if (paramEntry.first == "equals") {
-				outfitCase->addEntityType(mTypeService.getTypeByName(paramEntry.second));
-			}
+		for (auto typeInfo : aCase.entityTypes) {
+			outfitCase->addEntityType(typeInfo);
 		}
-/*			const std::string& entityName = I->getProperties()["equals"];
-		std::vector<std::string> splitNames = EntityMappingManager::splitString(entityName, "|", 100);
-		for (std::vector<std::string>::const_iterator J = splitNames.begin(); J != splitNames.end(); ++J) {
-			aCase->addEntityType(mTypeService.getTypeByName(*J));
-		}*/
-		mActionCreator.createActions(*mModelMap, outfitCase, aCase);
-
-		for (auto& aMatch : aCase.getMatches()) {
+
+		mActionCreator.createActions(*mModelMap, outfitCase, *aCase.definition);
+
+		for (auto& aMatch : aCase.matches) {
 			addMatch(outfitCase, aMatch);
 		}
 		match->addCase( outfitCase);
@@ -142,79 +107,15 @@ void EntityMappingCreator::addOutfitCases(OutfitMatch* match, MatchDefinition& m
 }
 
 
-Cases::AttributeComparers::AttributeComparerWrapper* EntityMappingCreator::getAttributeCaseComparer(AttributeMatch* match, MatchDefinition& matchDefinition, CaseDefinition& caseDefinition)
-{
-	const std::string& matchType = matchDefinition.getProperties()["type"];
-
-	if ((matchType.empty()) || (matchType == "string")) {
-		//default is string comparison
-		if (const CaseDefinition::ParameterEntry* param = findCaseParameter(caseDefinition.getCaseParameters(), "equals")) {
-			return new AttributeComparers::StringComparerWrapper(new AttributeComparers::StringComparer(param->second));
-		} else {
-			return new AttributeComparers::StringComparerWrapper(new AttributeComparers::StringComparer(""));
-		}
-/*
-		const std::string& attributeValue = caseDefinition.getProperties()["equals"];
-		return new AttributeComparers::StringComparerWrapper(new AttributeComparers::StringComparer(attributeValue));*/
-	} else if (matchType == "numeric") {
-		return new AttributeComparers::NumericComparerWrapper(createNumericComparer(caseDefinition));
-	} else if (matchType == "function") {
-		if (match->getAttributeName() == "height") {
-			return new AttributeComparers::HeightComparerWrapper(createNumericComparer(caseDefinition), mEntity);
-		}
-	}
-	return 0;
-
-}
-
-AttributeComparers::NumericComparer* EntityMappingCreator::createNumericComparer(CaseDefinition& caseDefinition)
-{
-	const CaseDefinition::ParameterEntry* param(0);
+void EntityMappingCreator::addAttributeCases(AttributeMatch* match, const CompiledMatch& compiledMatch) {
+	match->getCases().reserve(compiledMatch.cases.size());
+	for (auto& aCase : compiledMatch.cases) {
+		if (aCase.comparer) {
+			AttributeCase* attrCase = mModelMap->create<AttributeCase>(*aCase.comparer);
 
-// 	DefinitionBase::PropertiesMap::const_iterator value;
-// 	DefinitionBase::PropertiesMap::const_iterator end = caseDefinition.getProperties().end();
-// 	value = caseDefinition.getProperties().find("equals");
-
-	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "equals"))) {
-		return new AttributeComparers::NumericEqualsComparer(std::stof(param->second));
-	}
+			mActionCreator.createActions(*mModelMap, attrCase, *aCase.definition);
 
-	//If both a min and max value is set, it's a range comparer
-	AttributeComparers::NumericComparer *mMin(0), *mMax(0);
-	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "lesser"))) {
-		mMin = new AttributeComparers::NumericLesserComparer(std::stof(param->second));
-	} else if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "lesserequals"))) {
-		mMin = new AttributeComparers::NumericEqualsOrLesserComparer(std::stof(param->second));
-	}
-
-	if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "greater"))) {
-		mMax = new AttributeComparers::NumericGreaterComparer(std::stof(param->second));
-	} else if ((param = findCaseParameter(caseDefinition.getCaseParameters(), "greaterequals"))) {
-		mMax = new AttributeComparers::NumericEqualsOrGreaterComparer(std::stof(param->second));
-	}
-
-	//check if we have both min and max set, and if so we should use a range comparer
-	if (mMin && mMax) {
-		return new AttributeComparers::NumericRangeComparer(mMin, mMax);
-	} else if (!mMax && mMin) {
-		return mMin;
-	} else if (mMax) {
-		return mMax;
-	}
-	//invalid, could not find anything to compare against
-	return nullptr;
-}
-
-
-void EntityMappingCreator::addAttributeCases(AttributeMatch* match, MatchDefinition& matchDefinition) {
-	for (auto& aCase : matchDefinition.getCases()) {
-		Cases::AttributeComparers::AttributeComparerWrapper* wrapper = getAttributeCaseComparer(match, matchDefinition, aCase);
-		if (wrapper) {
-			AttributeCase* attrCase = new AttributeCase(wrapper);
-
-			mActionCreator.createActions(*mModelMap, attrCase, aCase);
-
-			for (auto& aMatch : aCase.getMatches()) {
+			for (auto& aMatch : aCase.matches) {
 				addMatch(attrCase, aMatch);
 			}
 
@@ -225,65 +126,51 @@ void EntityMappingCreator::addAttributeCases(AttributeMatch* match, MatchDefinit
 
 }
 
-void EntityMappingCreator::addMatch(CaseBase* aCase, MatchDefinition& matchDefinition) {
-	if (matchDefinition.getType() == "attribute") {
-		addAttributeMatch(aCase, matchDefinition);
-	} else if (matchDefinition.getType() == "entitytype") {
-		addEntityTypeMatch(aCase, matchDefinition);
-	} else if (matchDefinition.getType() == "outfit") {
-		addOutfitMatch(aCase, matchDefinition);
+void EntityMappingCreator::addMatch(CaseBase* aCase, const CompiledMatch& compiledMatch) {
+	switch (compiledMatch.type) {
+	case CompiledMatch::ATTRIBUTE:
+		addAttributeMatch(aCase, compiledMatch);
+		break;
+	case CompiledMatch::ENTITY_TYPE:
+		addEntityTypeMatch(aCase, compiledMatch);
+		break;
+	case CompiledMatch::OUTFIT:
+		addOutfitMatch(aCase, compiledMatch);
+		break;
 	}
 }
 
-void EntityMappingCreator::addAttributeMatch(CaseBase* aCase, MatchDefinition& matchDefinition) {
-	const std::string& attributeName = matchDefinition.getProperties()["attribute"];
-
-	std::string internalAttributeName;
-	const std::string& matchType = matchDefinition.getProperties()["type"];
-	//TODO: make this check better
-	if (matchType == "function") {
-		if (attributeName == "height") {
-			internalAttributeName = "bbox";
-		}
-	}
-	if (internalAttributeName.empty()) {
-		internalAttributeName = attributeName;
-	}
-
-	AttributeMatch* match = new AttributeMatch(attributeName, internalAttributeName);
+void EntityMappingCreator::addAttributeMatch(CaseBase* aCase, const CompiledMatch& compiledMatch) {
+	AttributeMatch* match = mModelMap->create<AttributeMatch>(compiledMatch.attributeName, compiledMatch.internalAttributeName);
 	aCase->addMatch( match);
 
-	MatchAttributeObserver* observer = new MatchAttributeObserver(match, internalAttributeName);
+	MatchAttributeObserver* observer = mModelMap->create<MatchAttributeObserver>(match, compiledMatch.internalAttributeName);
 	match->setMatchAttributeObserver(observer);
 
-	addAttributeCases(match, matchDefinition);
+	addAttributeCases(match, compiledMatch);
 
 }
 
-void EntityMappingCreator::addEntityTypeMatch(CaseBase* aCase, MatchDefinition& matchDefinition) {
-	EntityTypeMatch* match = new EntityTypeMatch();
+void EntityMappingCreator::addEntityTypeMatch(CaseBase* aCase, const CompiledMatch& compiledMatch) {
+	EntityTypeMatch* match = mModelMap->create<EntityTypeMatch>();
 	aCase->addMatch( match);
-	addEntityTypeCases(match, matchDefinition);
-
-	//since we already have the entity, we can perform a check right away
-// 	match->testEntity(mEntity);
+	addEntityTypeCases(match, compiledMatch);
 }
 
-void EntityMappingCreator::addOutfitMatch(CaseBase* aCase, MatchDefinition& matchDefinition)
+void EntityMappingCreator::addOutfitMatch(CaseBase* aCase, const CompiledMatch& compiledMatch)
 {
 	if (mView) {
-		const std::string& attachmentName = matchDefinition.getProperties()["attachment"];
-		OutfitMatch* match = new OutfitMatch(attachmentName, mView);
+		OutfitMatch* match = mModelMap->create<OutfitMatch>(compiledMatch.attributeName, mView);
 		aCase->addMatch( match);
 
-		addOutfitCases(match, matchDefinition);
+		addOutfitCases(match, compiledMatch);
 
 
 		//observe the attribute by the use of an MatchAttributeObserver
-		MatchAttributeObserver* observer= new MatchAttributeObserver(match, "outfit");
+		MatchAttributeObserver* observer = mModelMap->create<MatchAttributeObserver>(match, compiledMatch.internalAttributeName);
 		match->setMatchAttributeObserver(observer);
 
-		EntityCreationObserver* entityObserver = new EntityCreationObserver(*match);
+		EntityCreationObserver* entityObserver = mModelMap->create<EntityCreationObserver>(*match);
 		match->setEntityCreationObserver(entityObserver);
 	}
 
@@ -292,3 +179,5 @@ void EntityMappingCreator::addOutfitMatch(CaseBase* aCase, MatchDefinition& matc
 }
 
 }
+
+}
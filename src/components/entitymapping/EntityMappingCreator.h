@@ -23,11 +23,12 @@
 #ifndef EMBEROGRE_MODEL_MAPPINGMODELMAPPINGCREATOR_H
 #define EMBEROGRE_MODEL_MAPPINGMODELMAPPINGCREATOR_H
 
-#include "Definitions/EntityMappingDefinition.h"
+#include "CompiledDefinition.h"
+
+#include <memory>
 namespace Eris
 {
 class Entity;
-class TypeService;
 class View;
 }
 
@@ -37,10 +38,6 @@ namespace Ember {
 
 namespace EntityMapping {
 
-namespace Definitions {
-class EntityMappingDefinition;
-}
-
 namespace Matches {
 class EntityTypeMatch;
 class AttributeMatch;
@@ -48,11 +45,6 @@ class OutfitMatch;
 }
 namespace Cases {
 
-namespace AttributeComparers {
-	class NumericComparer;
-	class AttributeComparerWrapper;
-}
-
 class AttributeCase;
 class OutfitCase;
 class CaseBase;
@@ -60,7 +52,8 @@ class CaseBase;
 class EntityMapping;
 class IActionCreator;
 /**
-	Creates a EntityMapping instances from the supplied definition.
+	Creates a EntityMapping instances from the supplied compiled definition.
+	All matches, cases and observers are created in the storage of the new mapping.
 
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
@@ -70,13 +63,12 @@ class EntityMappingCreator
 public:
 	/**
 	 *    Default constructor.
-	 * @param definition The definition to use.
+	 * @param definition The compiled definition to use.
 	 * @param entity Entity to attach to.
 	 * @param actionCreator Client supplied action creator.
-	 * @param typeService A valid typeservice instance.
 	 * @param view An optional View instance.
 	 */
-	EntityMappingCreator(Definitions::EntityMappingDefinition& definition, Eris::Entity& entity, IActionCreator& actionCreator, Eris::TypeService& typeService, Eris::View* view);
+	EntityMappingCreator(std::shared_ptr<const CompiledDefinition> definition, Eris::Entity& entity, IActionCreator& actionCreator, Eris::View* view);
 
 	~EntityMappingCreator() = default;
 
@@ -96,76 +88,59 @@ protected:
 	/**
 	 * Adds EntityTypeCases to the supplied match.
 	 * @param entityTypeMatch
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addEntityTypeCases(Matches::EntityTypeMatch* entityTypeMatch, Definitions::MatchDefinition& matchDefinition);
+	void addEntityTypeCases(Matches::EntityTypeMatch* entityTypeMatch, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds AttributeCases to the supplied match.
 	 * @param match
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addAttributeCases(Matches::AttributeMatch* match, Definitions::MatchDefinition& matchDefinition);
+	void addAttributeCases(Matches::AttributeMatch* match, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds OutfitCases to the supplied match.
 	 * @param match
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addOutfitCases(Matches::OutfitMatch* match, Definitions::MatchDefinition& matchDefinition);
+	void addOutfitCases(Matches::OutfitMatch* match, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds matches to the supplied case.
 	 * @param aCase
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addMatch(Cases::CaseBase* aCase, Definitions::MatchDefinition& matchDefinition);
+	void addMatch(Cases::CaseBase* aCase, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds attribute matches to the supplied case.
 	 * @param aCase
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addAttributeMatch(Cases::CaseBase* aCase, Definitions::MatchDefinition& matchDefinition);
+	void addAttributeMatch(Cases::CaseBase* aCase, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds entity type matches to the supplied case.
 	 * @param aCase
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addEntityTypeMatch(Cases::CaseBase* aCase, Definitions::MatchDefinition& matchDefinition);
+	void addEntityTypeMatch(Cases::CaseBase* aCase, const CompiledMatch& compiledMatch);
 
 	/**
 	 * Adds outfit matches to the supplied case.
 	 * @param aCase
-	 * @param matchDefinition
+	 * @param compiledMatch
 	 */
-	void addOutfitMatch(Cases::CaseBase* aCase, Definitions::MatchDefinition& matchDefinition);
-
-	/**
-	 * Creates and returns a numeric comparer for the supplied case.
-	 * @param caseDefinition
-	 */
-	Cases::AttributeComparers::NumericComparer* createNumericComparer(Definitions::CaseDefinition& caseDefinition);
-
-	/**
-	 * Creates and returns suitable attribute comparer for the supplied attribute case.
-	 * @param match
-	 * @param matchDefinition
-	 * @param caseDefinition
-	 * @returns An AttributeComparers::AttributeComparerWrapper instance or null.
-	*/
-	Cases::AttributeComparers::AttributeComparerWrapper* getAttributeCaseComparer(Matches::AttributeMatch* match, Definitions::MatchDefinition& matchDefinition, Definitions::CaseDefinition& caseDefinition);
+	void addOutfitMatch(Cases::CaseBase* aCase, const CompiledMatch& compiledMatch);
 
 	IActionCreator& mActionCreator;
 	Eris::Entity& mEntity;
 	EntityMapping* mModelMap;
-	Definitions::EntityMappingDefinition& mDefinition;
-	Eris::TypeService& mTypeService;
+	std::shared_ptr<const CompiledDefinition> mDefinition;
 	Eris::View* mView;
 };
 
-
 }
 
 }
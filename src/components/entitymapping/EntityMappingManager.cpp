@@ -28,6 +28,8 @@
 
 #include "EntityMappingCreator.h"
 
+#include <Eris/TypeService.h>
+
 namespace Ember
 {
 
@@ -43,11 +45,19 @@ EntityMappingManager::EntityMappingManager() :
 
 EntityMappingManager::~EntityMappingManager()
 {
+	mCompiledDefinitions.clear();
 	for (auto& entry : mDefinitions) {
 		delete entry.second;
 	}
 }
 
+void EntityMappingManager::setTypeService(Eris::TypeService* typeService)
+{
+	mTypeService = typeService;
+	mTypeDefinitionCache.clear();
+	mCompiledDefinitions.clear();
+}
+
 void EntityMappingManager::addDefinition(EntityMappingDefinition* definition)
 {
 	std::pair<EntityMappingDefinitionStore::iterator, bool> result = mDefinitions.insert(EntityMappingDefinitionStore::value_type(definition->getName(), definition));
@@ -56,6 +66,8 @@ void EntityMappingManager::addDefinition(EntityMappingDefinition* definition)
 	if (!result.second) {
 		delete definition;
 	} else {
+		//The new definition might be a better match for types already looked up.
+		mTypeDefinitionCache.clear();
 		for (auto& aCase : definition->getRoot().getCases()) {
 			for (auto& paramEntry : aCase.getCaseParameters()) {
 				if (paramEntry.first == "equals") {
@@ -73,20 +85,40 @@ void EntityMappingManager::addDefinition(EntityMappingDefinition* definition)
 
 EntityMappingDefinition* EntityMappingManager::getDefinitionForType(Eris::TypeInfo* typeInfo)
 {
+	auto cacheI = mTypeDefinitionCache.find(typeInfo);
+	if (cacheI != mTypeDefinitionCache.end()) {
+		return cacheI->second;
+	}
+
+	EntityMappingDefinition* definition = nullptr;
+	Eris::TypeInfo* type = typeInfo;
 	bool noneThere = false;
 	while (!noneThere) {
-		auto I = mEntityTypeMappings.find(typeInfo->getName());
+		auto I = mEntityTypeMappings.find(type->getName());
 		if (I != mEntityTypeMappings.end()) {
-			return I->second;
+			definition = I->second;
+			break;
 		} else {
-			if (!typeInfo->getParent()) {
+			if (!type->getParent()) {
 				noneThere = true;
 			} else {
-				typeInfo = typeInfo->getParent();
+				type = type->getParent();
 			}
 		}
 	}
-	return nullptr;
+	if (typeInfo->isBound()) {
+		mTypeDefinitionCache.emplace(typeInfo, definition);
+	}
+	return definition;
+}
+
+std::shared_ptr<const CompiledDefinition> EntityMappingManager::getCompiledDefinition(EntityMappingDefinition& definition)
+{
+	auto I = mCompiledDefinitions.find(&definition);
+	if (I == mCompiledDefinitions.end()) {
+		I = mCompiledDefinitions.emplace(&definition, std::make_shared<CompiledDefinition>(definition, *mTypeService)).first;
+	}
+	return I->second;
 }
 
 EntityMapping* EntityMappingManager::createMapping(Eris::Entity& entity, IActionCreator& actionCreator, Eris::View* view)
@@ -95,7 +127,7 @@ EntityMapping* EntityMappingManager::createMapping(Eris::Entity& entity, IAction
 		Eris::TypeInfo* type = entity.getType();
 		EntityMappingDefinition* definition = getDefinitionForType(type);
 		if (definition) {
-			EntityMappingCreator creator(*definition, entity, actionCreator, *mTypeService, view);
+			EntityMappingCreator creator(getCompiledDefinition(*definition), entity, actionCreator, view);
 			EntityMapping* mapping = creator.create();
 			return mapping;
 		}
@@ -30,12 +30,14 @@
 
 #include <vector>
 #include <unordered_map>
+#include <memory>
 
 #include <Eris/TypeInfo.h>
 #include <Eris/Entity.h>
 
 #include "Definitions/EntityMappingDefinition.h"
 #include "EntityMapping.h"
+#include "CompiledDefinition.h"
 
 
 namespace Ember {
@@ -55,6 +57,9 @@ class IActionCreator;
 	Applications are expected to add definitions to the manager through the addDefinition(...) method. Definitions are managed by the manager and will be deleted by this upon destruction.
 	New EntityMapping instances are created by calling createMapping(...). It's up to the application to delete all EntityMapping instances created by the manager.
 
+	Since mappings are created for every entity seen, both the lookup of the definition for a type and the processing of the definition are cached. Each definition is compiled once into a CompiledDefinition, which is then shared by all mappings created from it.
+	Each mapping keeps its compiled definition alive, so mappings may outlive changes to the type service.
+
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class EntityMappingManager{
@@ -70,6 +75,7 @@ public:
 
     /**
     Sets the type service. Applications are required to set this before calling createMapping(...)
+    Any cached type lookups and compiled definitions are discarded, since they refer to types of the previous type service.
     @param typeService An Eris::TypeService instance.
     */
     void setTypeService(Eris::TypeService* typeService);
@@ -83,6 +89,7 @@ public:
 
     /**
     Queries the internal list of definitions and return the defintion that's most suited for the supplied type.
+    The result is cached for bound types, since the parents of unbound types might not yet be known.
     @param typeInfo An eris type info instance.
     */
     Definitions::EntityMappingDefinition* getDefinitionForType(Eris::TypeInfo* typeInfo);
@@ -102,15 +109,26 @@ protected:
 
 	EntityMappingDefinitionStore mEntityTypeMappings;
 
-	Eris::TypeService* mTypeService;
+	/**
+	 * Results of getDefinitionForType(...), including types for which there is no definition.
+	 */
+	std::unordered_map<const Eris::TypeInfo*, Definitions::EntityMappingDefinition*> mTypeDefinitionCache;
 
-};
+	/**
+	 * Definitions compiled so far, keyed by the definition they were compiled from.
+	 */
+	std::unordered_map<const Definitions::EntityMappingDefinition*, std::shared_ptr<const CompiledDefinition>> mCompiledDefinitions;
 
-inline void EntityMappingManager::setTypeService(Eris::TypeService* typeService)
-{
-	mTypeService = typeService;
-}
+	Eris::TypeService* mTypeService;
 
+	/**
+	 * Gets the compiled version of the supplied definition, compiling it if needed.
+	 * @param definition A definition.
+	 * @return The compiled definition.
+	 */
+	std::shared_ptr<const CompiledDefinition> getCompiledDefinition(Definitions::EntityMappingDefinition& definition);
+
+};
 
 }
 
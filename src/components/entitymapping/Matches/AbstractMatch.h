@@ -42,20 +42,9 @@ namespace EntityMapping {
 namespace Matches {
 
 
-/**
-Utility method for cleaning a std::vector, deleting all instances held.
-*/
-template <typename T>
-static void cleanVector(T& theVector)
-{
-	for (auto& instance : theVector) {
-		delete instance;
-	}
-	theVector.clear();
-}
-
 /**
 	Base class for all matches which includes templated definitions of the kind of Case it will hold.
+	The cases aren't owned by the match; they're held by the EntityMapping the match belongs to.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 template <class TCase>
@@ -65,7 +54,7 @@ public:
 
 	AbstractMatch() = default;
 
-	virtual ~AbstractMatch();
+	virtual ~AbstractMatch() = default;
 
 	/**
 	* Adds a child case.
@@ -103,12 +92,6 @@ protected:
 	 std::vector<TCase*> mCases;
 };
 
-template <class TCase>
-AbstractMatch<TCase>::~AbstractMatch()
-{
-	cleanVector(mCases);
-}
-
 
 template <class TCase>
 void AbstractMatch<TCase>::setEntity(Eris::Entity* entity)
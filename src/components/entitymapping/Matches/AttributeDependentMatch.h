@@ -51,13 +51,13 @@ public:
 	virtual void testAttribute(const Atlas::Message::Element& attribute, bool triggerEvaluation) = 0;
 
     /**
-    Use the supplied observer to observe changes to the attribute. The supplied observer will be managed by this class.
+    Use the supplied observer to observe changes to the attribute. The observer is held by the EntityMapping the match belongs to.
     */
     void setMatchAttributeObserver(Observers::MatchAttributeObserver* observer);
 
 protected:
 
-	std::unique_ptr<Observers::MatchAttributeObserver> mMatchAttributeObserver;
+	Observers::MatchAttributeObserver* mMatchAttributeObserver;
 };
 }
 
@@ -51,6 +51,7 @@ namespace Matches {
 
 /**
 	A Match that inspects a certain attribute.
+	The names of the attribute aren't copied, and must outlive the match. Normally they're held by the CompiledDefinition the match was created from.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class AttributeMatch : public AbstractMatch<Cases::AttributeCase>, public AttributeDependentMatch
@@ -81,7 +82,8 @@ public:
 
 protected:
 
-	std::string mAttributeName, mInternalAttributeName;
+	const std::string& mAttributeName;
+	const std::string& mInternalAttributeName;
 };
 
 inline const std::string& AttributeMatch::getAttributeName()
@@ -65,7 +65,10 @@ protected:
 
 	AttributeDependentMatch* mMatch;
 
-	std::string mAttributeName;
+	/**
+	The name isn't copied, and must outlive the observer.
+	*/
+	const std::string& mAttributeName;
 
 };
 
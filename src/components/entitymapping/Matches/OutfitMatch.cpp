@@ -74,7 +74,7 @@ void OutfitMatch::setEntity(Eris::Entity* entity)
 
 void OutfitMatch::setEntityCreationObserver(Observers::EntityCreationObserver* observer)
 {
-	mEntityObserver.reset(observer);
+	mEntityObserver = observer;
 }
 
 void OutfitMatch::testEntity(Eris::Entity* entity)
@@ -43,6 +43,7 @@ class EntityCreationObserver;
 
 /**
 	Watches for changes to a specific outfit point, such as "body" or "feet". Whenever an entity is outfitted or removed this will trigger.
+	The name of the outfit point isn't copied, and must outlive the match.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class OutfitMatch : public AbstractMatch<Cases::OutfitCase>, public AttributeDependentMatch
@@ -63,9 +64,12 @@ public:
 protected:
 
 	void testEntity(Eris::Entity* entity);
-	std::string mOutfitName;
+	const std::string& mOutfitName;
 	Eris::View* mView;
-	std::unique_ptr<Observers::EntityCreationObserver> mEntityObserver;
+	/**
+	The observer is held by the EntityMapping the match belongs to.
+	*/
+	Observers::EntityCreationObserver* mEntityObserver;
 };
 
 inline const std::string& OutfitMatch::getOutfitName()
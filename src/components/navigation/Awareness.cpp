@@ -59,6 +59,8 @@
 
 #include "Awareness.h"
 #include "AwarenessUtils.h"
+#include "TileRebuildTask.h"
+#include "SpatialGrid.h"
 
 #include "DetourNavMeshQuery.h"
 #include "DetourObstacleAvoidance.h"
@@ -68,6 +70,7 @@
 
 #include "framework/LoggingInstance.h"
 #include "framework/Exception.h"
+#include "framework/tasks/TaskQueue.h"
 
 #include <Eris/View.h>
 #include <Eris/Avatar.h>
@@ -80,10 +83,13 @@
 #include <boost/multi_index/sequenced_index.hpp>
 
 #include <queue>
+#include <algorithm>
+#include <thread>
 
 #define MAX_PATHPOLY      256 // max number of polygons in a path
 #define MAX_PATHVERT      512 // most verts in a path
 #define MAX_OBSTACLES_CIRCLES 4 // max number of circle obstacles to consider when doing avoidance
+#define OBSTACLE_QUERY_SLACK 10.0f // extra distance to search for obstacles, since their predicted positions might have drifted from the indexed ones
 namespace Ember
 {
 namespace Navigation
@@ -92,6 +98,9 @@ namespace Navigation
 // This value specifies how many layers (or "floors") each navmesh tile is expected to have.
 static const int EXPECTED_LAYERS_PER_TILE = 1;
 
+// The amount of rebuild time over which the tile rebuild rate is measured.
+static const std::chrono::steady_clock::duration TILE_REBUILD_RATE_WINDOW = std::chrono::seconds(1);
+
 using namespace boost::multi_index;
 
 /**
@@ -159,6 +168,8 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 		mHeightProvider(heightProvider),
 		mAvatarEntity(view.getAvatar()->getEntity()),
 		mCurrentLocation(mAvatarEntity->getLocation()),
+		mTaskQueue(nullptr),
+		mIsShuttingDown(false),
 		mTalloc(nullptr),
 		mTcomp(nullptr),
 		mTmproc(nullptr),
@@ -169,6 +180,13 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 		mNavMesh(nullptr),
 		mNavQuery(dtAllocNavMeshQuery()),
 		mFilter(nullptr),
+		mMaxPendingTiles(1),
+		mIsRebuildingTiles(false),
+		mRebuildWindowBusyTime(0),
+		mRebuildWindowTiles(0),
+		mTileRebuildRate(0),
+		mEntityAreaGrid(nullptr),
+		mMovingEntityGrid(nullptr),
 		mActiveTileList(nullptr)
 {
 	EmberEntity* entity = static_cast<EmberEntity*>(mView.getTopLevel());
@@ -178,6 +196,11 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 		try {
 			mActiveTileList = new MRUList<std::pair<int, int>>();
 
+			//Use half of the available cores for rebuilding tiles, and keep twice as many tiles in flight so that the executors never are idle.
+			unsigned int numberOfExecutors = std::max(1u, std::thread::hardware_concurrency() / 2);
+			mTaskQueue = new Tasks::TaskQueue(numberOfExecutors, view.getEventService());
+			mMaxPendingTiles = numberOfExecutors * 2;
+
 			mTalloc = new LinearAllocator(128000);
 			mTcomp = new FastLZCompressor;
 			mTmproc = new MeshProcess;
@@ -247,6 +270,12 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 			mCfg.borderSize = mCfg.walkableRadius + 3; // Reserve enough padding.
 			mCfg.width = mCfg.tileSize + mCfg.borderSize * 2;
 			mCfg.height = mCfg.tileSize + mCfg.borderSize * 2;
+
+			//The grids are keyed on the world x and y axes, and tile (tx, ty) covers the world area starting at lower + (tx, ty) * tile size.
+			//Using the lower corner of the extent as origin and the tile size as cell size thus makes each cell cover exactly one tile.
+			WFMath::Point<2> gridOrigin(lower.x(), lower.y());
+			mEntityAreaGrid = new SpatialGrid<Eris::Entity*>(tileSize * cellsize, gridOrigin);
+			mMovingEntityGrid = new SpatialGrid<Eris::Entity*>(tileSize * cellsize, gridOrigin);
 			//	m_cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : m_cfg.cs * m_detailSampleDist;
 			//	m_cfg.detailSampleMaxError = m_cfg.m_cellHeight * m_detailSampleMaxError;
 
@@ -335,11 +364,11 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 						//Only actively observe the entity if it has the same location as the avatar.
 						if (entity.getLocation() == mCurrentLocation) {
 							connections.isIgnored = false;
+							connections.moved = entity.Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), &entity));
 							if (entity.hasAttr("velocity")) {
-								mMovingEntities.push_back(&entity);
+								updateMovingEntity(&entity);
 								connections.isMoving = true;
 							} else {
-								connections.moved = entity.Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), &entity));
 								connections.isMoving = false;
 							}
 						} else {
@@ -351,8 +380,12 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 			};
 
 			entity->accept(attachListenersFunction);
+			std::map<Eris::Entity*, WFMath::RotBox<2>> areas;
 			for (size_t i = 0; i < entity->numContained(); ++i) {
-				buildEntityAreas(*entity->getContained(i), mEntityAreas);
+				buildEntityAreas(*entity->getContained(i), areas);
+			}
+			for (auto& entry : areas) {
+				setEntityArea(entry.first, entry.second);
 			}
 		} catch (const std::exception& e) {
 			delete mObstacleAvoidanceParams;
@@ -370,6 +403,9 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 
 			delete mCtx;
 			delete mActiveTileList;
+			delete mTaskQueue;
+			delete mEntityAreaGrid;
+			delete mMovingEntityGrid;
 			throw;
 		}
 	}
@@ -377,6 +413,11 @@ Awareness::Awareness(Eris::View& view, IHeightProvider& heightProvider, unsigned
 
 Awareness::~Awareness()
 {
+	//Shut down the task queue first, since any tasks still being processed refer to this instance.
+	//Tiles which are completed during the shutdown will be discarded.
+	mIsShuttingDown = true;
+	delete mTaskQueue;
+
 	//disconnect signals when shutting down
 	for (auto& connection : mSignalConnections) {
 		connection.disconnect();
@@ -402,6 +443,8 @@ Awareness::~Awareness()
 
 	delete mCtx;
 	delete mActiveTileList;
+	delete mEntityAreaGrid;
+	delete mMovingEntityGrid;
 }
 
 void Awareness::View_EntitySeen(Eris::Entity* entity)
@@ -418,19 +461,21 @@ void Awareness::View_EntitySeen(Eris::Entity* entity)
 		if (entity->getLocation() == mCurrentLocation) {
 			connections.isIgnored = false;
 
+			connections.moved = entity->Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), entity));
 			if (entity->hasAttr("velocity")) {
 				connections.isMoving = true;
-				mMovingEntities.push_back(entity);
+				updateMovingEntity(entity);
 			} else {
 
 				std::map<Eris::Entity*, WFMath::RotBox<2>> areas;
 				buildEntityAreas(*entity, areas);
 				for (auto& entry : areas) {
 					markTilesAsDirty(entry.second.boundingBox());
-					mEntityAreas.insert(entry);
+					if (mEntityAreas.find(entry.first) == mEntityAreas.end()) {
+						setEntityArea(entry.first, entry.second);
+					}
 				}
 
-				connections.moved = entity->Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), entity));
 				connections.isMoving = false;
 			}
 
@@ -443,18 +488,24 @@ void Awareness::View_EntitySeen(Eris::Entity* entity)
 
 void Awareness::Entity_Moved(Eris::Entity* entity)
 {
+	auto I = mObservedEntities.find(entity);
+	if (I != mObservedEntities.end() && I->second.isMoving) {
+		//Moving entities only need their indexed position updated.
+		updateMovingEntity(entity);
+		return;
+	}
+
 	//If an entity which previously didn't move start moving we need to move it to the "movable entities" collection.
 	if (entity->hasAttr("velocity")) {
-		mMovingEntities.push_back(entity);
-		auto I = mObservedEntities.find(entity);
-		//No need to listen to more Moved events.
-		I->second.moved.disconnect();
-		I->second.isMoving = true;
+		updateMovingEntity(entity);
+		if (I != mObservedEntities.end()) {
+			I->second.isMoving = true;
+		}
 		auto existingI = mEntityAreas.find(entity);
 		if (existingI != mEntityAreas.end()) {
 			//The entity already was registered; mark those tiles where the entity previously were as dirty.
 			markTilesAsDirty(existingI->second.boundingBox());
-			mEntityAreas.erase(entity);
+			removeEntityArea(entity);
 		}
 	} else {
 		std::map<Eris::Entity*, WFMath::RotBox<2>> areas;
@@ -467,10 +518,8 @@ void Awareness::Entity_Moved(Eris::Entity* entity)
 			if (existingI != mEntityAreas.end()) {
 				//The entity already was registered; mark both those tiles where the entity previously were as well as the new tiles as dirty.
 				markTilesAsDirty(existingI->second.boundingBox());
-				existingI->second = entry.second;
-			} else {
-				mEntityAreas.insert(entry);
 			}
+			setEntityArea(entry.first, entry.second);
 		}
 
 	}
@@ -492,7 +541,12 @@ bool Awareness::avoidObstacles(const WFMath::Point<2>& position, const WFMath::V
 
 	WFMath::Ball<2> playerRadius(position, 5);
 
-	for (auto entity : mMovingEntities) {
+	//Only look at those entities which are indexed as being near.
+	std::vector<Eris::Entity*> candidates;
+	WFMath::AxisBox<2> queryArea(WFMath::Point<2>(position.x() - (5 + OBSTACLE_QUERY_SLACK), position.y() - (5 + OBSTACLE_QUERY_SLACK)), WFMath::Point<2>(position.x() + (5 + OBSTACLE_QUERY_SLACK), position.y() + (5 + OBSTACLE_QUERY_SLACK)));
+	mMovingEntityGrid->query(queryArea, candidates);
+
+	for (auto entity : candidates) {
 
 		if (entity->isVisible()) {
 
@@ -553,7 +607,7 @@ void Awareness::Entity_BeingDeleted(Eris::Entity* entity)
 	if (I != mObservedEntities.end()) {
 		if (!I->second.isIgnored) {
 			if (I->second.isMoving) {
-				mMovingEntities.remove(entity);
+				mMovingEntityGrid->remove(entity);
 			} else {
 				std::map<Eris::Entity*, WFMath::RotBox<2>> areas;
 
@@ -562,7 +616,7 @@ void Awareness::Entity_BeingDeleted(Eris::Entity* entity)
 				for (auto& entry : areas) {
 					markTilesAsDirty(entry.second.boundingBox());
 				}
-				mEntityAreas.erase(entity);
+				removeEntityArea(entity);
 			}
 			mObservedEntities.erase(entity);
 		}
@@ -583,27 +637,24 @@ void Awareness::Entity_LocationChanged(Eris::Entity* oldLoc, Eris::Entity* entit
 		if (entity->getLocation() == mCurrentLocation) {
 			assert(connections.moved.empty());
 			connections.isIgnored = false;
+			connections.moved = entity->Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), entity));
 			//Entity was ignored but shouldn't be anymore. We should check if the entity is moving or stationary.
 			if (entity->hasAttr("velocity")) {
 				connections.isMoving = true;
-				mMovingEntities.push_back(entity);
-			} else {
-				connections.moved = entity->Moved.connect(sigc::bind(sigc::mem_fun(*this, &Awareness::Entity_Moved), entity));
+				updateMovingEntity(entity);
 			}
 		} else {
 			//Only sever connections if the entity wasn't already ignored.
 			if (!connections.isIgnored) {
+				assert(connections.moved.connected());
+				connections.moved.disconnect();
 				if (connections.isMoving) {
-					assert(connections.moved.empty());
-					mMovingEntities.remove(entity);
+					mMovingEntityGrid->remove(entity);
 				} else {
-					assert(connections.moved.connected());
-					connections.moved.disconnect();
-
 					auto areasI = mEntityAreas.find(entity);
 					if (areasI != mEntityAreas.end()) {
 						markTilesAsDirty(areasI->second.boundingBox());
-						mEntityAreas.erase(areasI);
+						removeEntityArea(entity);
 					}
 				}
 				connections.isIgnored = true;
@@ -627,9 +678,7 @@ void Awareness::markTilesAsDirty(int tileMinXIndex, int tileMaxXIndex, int tileM
 		for (int ty = tileMinYIndex; ty <= tileMaxYIndex; ++ty) {
 			std::pair<int, int> index(tx, ty);
 			if (mAwareTiles.find(index) != mAwareTiles.end()) {
-				if (mDirtyAwareTiles.insert(index).second) {
-					mDirtyAwareOrderedTiles.push_back(index);
-				}
+				mDirtyAwareTiles.insert(index);
 			} else {
 				mDirtyUnwareTiles.insert(index);
 			}
@@ -640,25 +689,98 @@ void Awareness::markTilesAsDirty(int tileMinXIndex, int tileMaxXIndex, int tileM
 	}
 }
 
-size_t Awareness::rebuildDirtyTile()
+size_t Awareness::rebuildDirtyTiles()
 {
-	if (!mDirtyAwareTiles.empty()) {
-		const auto tileIndexI = mDirtyAwareOrderedTiles.begin();
-		const auto& tileIndex = *tileIndexI;
+	if (!mTaskQueue || mIsShuttingDown) {
+		return mDirtyAwareTiles.size();
+	}
 
-		float tilesize = mCfg.tileSize * mCfg.cs;
-		WFMath::AxisBox<2> adjustedArea(WFMath::Point<2>(mCfg.bmin[0] + (tileIndex.first * tilesize), mCfg.bmin[2] + (tileIndex.second * tilesize)), WFMath::Point<2>(mCfg.bmin[0] + ((tileIndex.first + 1) * tilesize), mCfg.bmin[2] + ((tileIndex.second + 1) * tilesize)));
+	if (mPendingTiles.size() < mMaxPendingTiles) {
+		struct Candidate
+		{
+			float lineDistance;
+			float startDistance;
+			std::pair<int, int> index;
+		};
+
+		//Tiles which already are being rebuilt will be rebuilt again once they are done.
+		std::vector<Candidate> candidates;
+		for (auto& index : mDirtyAwareTiles) {
+			if (mPendingTiles.find(index) == mPendingTiles.end()) {
+				Candidate candidate;
+				candidate.index = index;
+				getTileDistances(index, candidate.lineDistance, candidate.startDistance);
+				candidates.push_back(candidate);
+			}
+		}
 
-		std::vector<WFMath::RotBox<2>> entityAreas;
-		findEntityAreas(adjustedArea, entityAreas);
+		//Rebuild those tiles that are closest to the focus line first, and of those the ones closest to the avatar.
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+			if (a.lineDistance != b.lineDistance) {
+				return a.lineDistance < b.lineDistance;
+			}
+			return a.startDistance < b.startDistance;
+		});
 
-		rebuildTile(tileIndex.first, tileIndex.second, entityAreas);
-		mDirtyAwareTiles.erase(tileIndex);
-		mDirtyAwareOrderedTiles.erase(tileIndexI);
+		for (auto& candidate : candidates) {
+			if (mPendingTiles.size() >= mMaxPendingTiles) {
+				break;
+			}
+			const auto& tileIndex = candidate.index;
+
+			float tilesize = mCfg.tileSize * mCfg.cs;
+			WFMath::AxisBox<2> adjustedArea(WFMath::Point<2>(mCfg.bmin[0] + (tileIndex.first * tilesize), mCfg.bmin[2] + (tileIndex.second * tilesize)), WFMath::Point<2>(mCfg.bmin[0] + ((tileIndex.first + 1) * tilesize), mCfg.bmin[2] + ((tileIndex.second + 1) * tilesize)));
+
+			std::vector<WFMath::RotBox<2>> entityAreas;
+			findEntityAreas(adjustedArea, entityAreas);
+
+			//The height provider can only be accessed from the main thread, so we need to get the heights before handing the tile over to the background thread.
+			int heightsXMin, heightsXMax, heightsYMin, heightsYMax;
+			getTileHeightBounds(tileIndex.first, tileIndex.second, heightsXMin, heightsXMax, heightsYMin, heightsYMax);
+			std::vector<float> heights((heightsXMax - heightsXMin) * (heightsYMax - heightsYMin));
+			mHeightProvider.blitHeights(heightsXMin, heightsXMax, heightsYMin, heightsYMax, heights);
+
+			int priority = -static_cast<int>(candidate.lineDistance);
+			if (mTaskQueue->enqueueTask(new TileRebuildTask(*this, tileIndex.first, tileIndex.second, std::move(heights), std::move(entityAreas), priority))) {
+				mPendingTiles.insert(tileIndex);
+				mDirtyAwareTiles.erase(tileIndex);
+				if (!mIsRebuildingTiles) {
+					mIsRebuildingTiles = true;
+					mRebuildBusySince = std::chrono::steady_clock::now();
+				}
+			}
+		}
 	}
 	return mDirtyAwareTiles.size();
 }
 
+float Awareness::getTileRebuildRate() const
+{
+	return mTileRebuildRate;
+}
+
+void Awareness::getTileDistances(const std::pair<int, int>& index, float& lineDistance, float& startDistance) const
+{
+	float tilesize = mCfg.tileSize * mCfg.cs;
+	WFMath::Point<2> center(mCfg.bmin[0] + ((index.first + 0.5f) * tilesize), mCfg.bmin[2] + ((index.second + 0.5f) * tilesize));
+
+	if (!mFocusLine.isValid()) {
+		lineDistance = 0;
+		startDistance = 0;
+		return;
+	}
+
+	const WFMath::Point<2>& start = mFocusLine.endpoint(0);
+	WFMath::Vector<2> line = mFocusLine.endpoint(1) - start;
+	float lineLengthSqr = line.sqrMag();
+	float t = 0;
+	if (lineLengthSqr > 0) {
+		t = std::min(1.0f, std::max(0.0f, WFMath::Dot(center - start, line) / lineLengthSqr));
+	}
+	lineDistance = WFMath::Distance(center, start + (line * t));
+	startDistance = WFMath::Distance(center, start);
+}
+
 void Awareness::pruneTiles()
 {
 	//remove any tiles that aren't used
@@ -826,9 +948,10 @@ void Awareness::setAwarenessArea(const WFMath::RotBox<2>& area, const WFMath::Se
 	const float tcs = mCfg.tileSize * mCfg.cs;
 	const float tileBorderSize = mCfg.borderSize * mCfg.cs;
 
+	mFocusLine = focusLine;
+
 	auto oldDirtyAwareTiles = mDirtyAwareTiles;
 	mDirtyAwareTiles.clear();
-	mDirtyAwareOrderedTiles.clear();
 	mAwareTiles.clear();
 	bool wereDirtyTiles = !mDirtyAwareTiles.empty();
 	for (int tx = tileMinXIndex; tx <= tileMaxXIndex; ++tx) {
@@ -838,44 +961,24 @@ void Awareness::setAwarenessArea(const WFMath::RotBox<2>& area, const WFMath::Se
 			if (WFMath::Intersect(area, tileBounds, false) || WFMath::Contains(area, tileBounds, false)) {
 
 				std::pair<int, int> index(tx, ty);
-				//If true we should insert in the front of the dirty tiles list.
-				bool insertFront = false;
-				//If true we should insert in the back of the dirty tiles list.
-				bool insertBack = false;
+				//If true the tile should be rebuilt. The order of rebuilding is determined by the focus line when the tiles are rebuilt.
+				bool isDirty = false;
 				//If the tile was marked as dirty in the old aware tiles, retain it as such
 				if (oldDirtyAwareTiles.find(index) != oldDirtyAwareTiles.end()) {
-					if (focusLine.isValid() && WFMath::Intersect(focusLine, tileBounds, false)) {
-						insertFront = true;
-					} else {
-						insertBack = true;
-					}
+					isDirty = true;
 				} else if (mDirtyUnwareTiles.find(index) != mDirtyUnwareTiles.end()) {
 					//if the tile was marked as dirty in the unaware tiles we'll move it to the dirty aware collection.
-					if (focusLine.isValid() && WFMath::Intersect(focusLine, tileBounds, false)) {
-						insertFront = true;
-					} else {
-						insertBack = true;
-					}
+					isDirty = true;
 				} else {
 					//The tile wasn't marked as dirty in any set, but it might be that it hasn't been processed before.
 					auto tile = mTileCache->getTileAt(tx, ty, 0);
-					if (!tile) {
-						if (focusLine.isValid() && WFMath::Intersect(focusLine, tileBounds, false)) {
-							insertFront = true;
-						} else {
-							insertBack = true;
-						}
+					if (!tile && mPendingTiles.find(index) == mPendingTiles.end()) {
+						isDirty = true;
 					}
 				}
 
-				if (insertFront) {
-					if (mDirtyAwareTiles.insert(index).second) {
-						mDirtyAwareOrderedTiles.push_front(index);
-					}
-				} else if (insertBack) {
-					if (mDirtyAwareTiles.insert(index).second) {
-						mDirtyAwareOrderedTiles.push_back(index);
-					}
+				if (isDirty) {
+					mDirtyAwareTiles.insert(index);
 				}
 
 				mDirtyUnwareTiles.erase(index);
@@ -892,12 +995,17 @@ void Awareness::setAwarenessArea(const WFMath::RotBox<2>& area, const WFMath::Se
 	}
 }
 
-void Awareness::rebuildTile(int tx, int ty, const std::vector<WFMath::RotBox<2>>& entityAreas)
+void Awareness::addTileLayers(int tx, int ty, TileCacheData* tiles, int ntiles)
 {
-	TileCacheData tiles[MAX_LAYERS];
-	memset(tiles, 0, sizeof(tiles));
+	if (mIsShuttingDown) {
+		for (int j = 0; j < ntiles; ++j) {
+			dtFree(tiles[j].data);
+			tiles[j].data = 0;
+		}
+		return;
+	}
 
-	int ntiles = rasterizeTileLayers(entityAreas, tx, ty, tiles, MAX_LAYERS);
+	mPendingTiles.erase(std::make_pair(tx, ty));
 
 	for (int j = 0; j < ntiles; ++j) {
 		TileCacheData* tile = &tiles[j];
@@ -916,9 +1024,29 @@ void Awareness::rebuildTile(int tx, int ty, const std::vector<WFMath::RotBox<2>>
 	}
 
 	mTileCache->buildNavMeshTilesAt(tx, ty, mNavMesh);
+	mRebuildWindowTiles++;
 
 	EventTileUpdated(tx, ty);
 
+	//Keep the executors busy as long as there are dirty tiles.
+	rebuildDirtyTiles();
+
+	//Only time spent rebuilding counts towards the window; it's paused while there's nothing to rebuild.
+	auto now = std::chrono::steady_clock::now();
+	auto busyTime = mRebuildWindowBusyTime + (now - mRebuildBusySince);
+	if (busyTime >= TILE_REBUILD_RATE_WINDOW) {
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(busyTime).count();
+		mTileRebuildRate = (mRebuildWindowTiles * 1000000.0f) / elapsed;
+		S_LOG_VERBOSE("Rebuilt " << mRebuildWindowTiles << " navmesh tiles in " << (elapsed / 1000) << " ms (" << mTileRebuildRate << " tiles/s).");
+		mRebuildWindowBusyTime = std::chrono::steady_clock::duration(0);
+		mRebuildWindowTiles = 0;
+		mRebuildBusySince = now;
+	} else if (mPendingTiles.empty()) {
+		mRebuildWindowBusyTime = busyTime;
+	}
+	if (mPendingTiles.empty()) {
+		mIsRebuildingTiles = false;
+	}
 }
 
 void Awareness::buildEntityAreas(Eris::Entity& entity, std::map<Eris::Entity*, WFMath::RotBox<2>>& entityAreas)
@@ -969,28 +1097,47 @@ void Awareness::buildEntityAreas(Eris::Entity& entity, std::map<Eris::Entity*, W
 	}
 }
 
+void Awareness::setEntityArea(Eris::Entity* entity, const WFMath::RotBox<2>& area)
+{
+	mEntityAreas[entity] = area;
+	mEntityAreaGrid->insert(entity, area.boundingBox());
+}
+
+void Awareness::removeEntityArea(Eris::Entity* entity)
+{
+	mEntityAreas.erase(entity);
+	mEntityAreaGrid->remove(entity);
+}
+
+void Awareness::updateMovingEntity(Eris::Entity* entity)
+{
+	//All of the entities have the same location as we have, so we don't need to resolve the position in the world.
+	WFMath::Point<3> pos = entity->getPredictedPos();
+	if (pos.isValid() && entity->hasBBox()) {
+		float radius = entity->getBBox().boundingSphereSloppy().radius();
+		mMovingEntityGrid->insert(entity, WFMath::AxisBox<2>(WFMath::Point<2>(pos.x() - radius, pos.y() - radius), WFMath::Point<2>(pos.x() + radius, pos.y() + radius)));
+	} else {
+		mMovingEntityGrid->remove(entity);
+	}
+}
+
 void Awareness::findEntityAreas(const WFMath::AxisBox<2>& extent, std::vector<WFMath::RotBox<2> >& areas)
 {
-	for (auto& entry : mEntityAreas) {
-		auto& rotbox = entry.second;
+	std::vector<Eris::Entity*> candidates;
+	mEntityAreaGrid->query(extent, candidates);
+	for (auto entity : candidates) {
+		auto& rotbox = mEntityAreas.find(entity)->second;
 		if (WFMath::Contains(extent, rotbox, false) || WFMath::Intersect(extent, rotbox, false)) {
 			areas.push_back(rotbox);
 		}
 	}
 }
 
-int Awareness::rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityAreas, const int tx, const int ty, TileCacheData* tiles, const int maxTiles)
+void Awareness::configureTile(int tx, int ty, rcConfig& tcfg) const
 {
-	std::vector<float> vertsVector;
-	std::vector<int> trisVector;
-
-	FastLZCompressor comp;
-	RasterizationContext rc;
-
-// Tile bounds.
+	// Tile bounds.
 	const float tcs = mCfg.tileSize * mCfg.cs;
 
-	rcConfig tcfg;
 	memcpy(&tcfg, &mCfg, sizeof(tcfg));
 
 	tcfg.bmin[0] = mCfg.bmin[0] + tx * tcs;
@@ -1003,20 +1150,46 @@ int Awareness::rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityA
 	tcfg.bmin[2] -= tcfg.borderSize * tcfg.cs;
 	tcfg.bmax[0] += tcfg.borderSize * tcfg.cs;
 	tcfg.bmax[2] += tcfg.borderSize * tcfg.cs;
+}
 
-//First define all vertices. Get one extra vertex in each direction so that there's no cutoff at the tile's edges.
-	int heightsXMin = std::floor(tcfg.bmin[0]) - 1;
-	int heightsXMax = std::ceil(tcfg.bmax[0]) + 1;
-	int heightsYMin = std::floor(tcfg.bmin[2]) - 1;
-	int heightsYMax = std::ceil(tcfg.bmax[2]) + 1;
+void Awareness::getTileHeightBounds(int tx, int ty, int& xMin, int& xMax, int& yMin, int& yMax) const
+{
+	rcConfig tcfg;
+	configureTile(tx, ty, tcfg);
+
+	//Get one extra vertex in each direction so that there's no cutoff at the tile's edges.
+	xMin = std::floor(tcfg.bmin[0]) - 1;
+	xMax = std::ceil(tcfg.bmax[0]) + 1;
+	yMin = std::floor(tcfg.bmin[2]) - 1;
+	yMax = std::ceil(tcfg.bmax[2]) + 1;
+}
+
+int Awareness::rasterizeTileLayers(const std::vector<float>& heights, const std::vector<WFMath::RotBox<2>>& entityAreas, const int tx, const int ty, TileCacheData* tiles, const int maxTiles) const
+{
+	std::vector<float> vertsVector;
+	std::vector<int> trisVector;
+
+	FastLZCompressor comp;
+	RasterizationContext rc;
+	//Use a separate context, since this might be called from multiple threads at once.
+	AwarenessContext ctx;
+
+	rcConfig tcfg;
+	configureTile(tx, ty, tcfg);
+
+//First define all vertices.
+	int heightsXMin, heightsXMax, heightsYMin, heightsYMax;
+	getTileHeightBounds(tx, ty, heightsXMin, heightsXMax, heightsYMin, heightsYMax);
 	int sizeX = heightsXMax - heightsXMin;
 	int sizeY = heightsYMax - heightsYMin;
 
-//Blit height values with 1 meter interval
-	std::vector<float> heights(sizeX * sizeY);
-	mHeightProvider.blitHeights(heightsXMin, heightsXMax, heightsYMin, heightsYMax, heights);
+	if (heights.size() != static_cast<size_t>(sizeX * sizeY)) {
+		S_LOG_WARNING("Supplied heights doesn't match the size of navmesh tile [" << tx << "|" << ty << "].");
+		return 0;
+	}
 
-	float* heightData = heights.data();
+	vertsVector.reserve(sizeX * sizeY * 3);
+	const float* heightData = heights.data();
 	for (int y = heightsYMin; y < heightsYMax; ++y) {
 		for (int x = heightsXMin; x < heightsXMax; ++x) {
 			vertsVector.push_back(x);
@@ -1049,25 +1222,25 @@ int Awareness::rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityA
 // Allocate voxel heightfield where we rasterize our input data to.
 	rc.solid = rcAllocHeightfield();
 	if (!rc.solid) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
 		return 0;
 	}
-	if (!rcCreateHeightfield(mCtx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch)) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+	if (!rcCreateHeightfield(&ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch)) {
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return 0;
 	}
 
 // Allocate array that can hold triangle flags.
 	rc.triareas = new unsigned char[ntris];
 	if (!rc.triareas) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", ntris / 3);
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", ntris / 3);
 		return 0;
 	}
 
 	memset(rc.triareas, 0, ntris * sizeof(unsigned char));
-	rcMarkWalkableTriangles(mCtx, tcfg.walkableSlopeAngle, verts, nverts, tris, ntris, rc.triareas);
+	rcMarkWalkableTriangles(&ctx, tcfg.walkableSlopeAngle, verts, nverts, tris, ntris, rc.triareas);
 
-	rcRasterizeTriangles(mCtx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb);
+	rcRasterizeTriangles(&ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb);
 
 // Once all geometry is rasterized, we do initial pass of filtering to
 // remove unwanted overhangs caused by the conservative rasterization
@@ -1081,17 +1254,17 @@ int Awareness::rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityA
 
 	rc.chf = rcAllocCompactHeightfield();
 	if (!rc.chf) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
 		return 0;
 	}
-	if (!rcBuildCompactHeightfield(mCtx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid, *rc.chf)) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+	if (!rcBuildCompactHeightfield(&ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid, *rc.chf)) {
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
 		return 0;
 	}
 
 // Erode the walkable area by agent radius.
-	if (!rcErodeWalkableArea(mCtx, tcfg.walkableRadius, *rc.chf)) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+	if (!rcErodeWalkableArea(&ctx, tcfg.walkableRadius, *rc.chf)) {
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
 		return 0;
 	}
 
@@ -1115,16 +1288,16 @@ int Awareness::rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityA
 		verts[10] = 0;
 		verts[11] = rotbox.getCorner(0).y();
 
-		rcMarkConvexPolyArea(mCtx, verts, 4, tcfg.bmin[1], tcfg.bmax[1], DT_TILECACHE_NULL_AREA, *rc.chf);
+		rcMarkConvexPolyArea(&ctx, verts, 4, tcfg.bmin[1], tcfg.bmax[1], DT_TILECACHE_NULL_AREA, *rc.chf);
 	}
 
 	rc.lset = rcAllocHeightfieldLayerSet();
 	if (!rc.lset) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
 		return 0;
 	}
-	if (!rcBuildHeightfieldLayers(mCtx, *rc.chf, tcfg.borderSize, tcfg.walkableHeight, *rc.lset)) {
-		mCtx->log(RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
+	if (!rcBuildHeightfieldLayers(&ctx, *rc.chf, tcfg.borderSize, tcfg.walkableHeight, *rc.lset)) {
+		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
 		return 0;
 	}
 
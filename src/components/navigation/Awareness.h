@@ -23,6 +23,7 @@
 
 #include <wfmath/axisbox.h>
 #include <wfmath/point.h>
+#include <wfmath/segment.h>
 
 #include <sigc++/signal.h>
 #include <sigc++/trackable.h>
@@ -34,6 +35,7 @@
 #include <map>
 #include <unordered_map>
 #include <functional>
+#include <chrono>
 
 class dtNavMeshQuery;
 class dtNavMesh;
@@ -54,10 +56,16 @@ class Entity;
 namespace Ember
 {
 class IHeightProvider;
+namespace Tasks
+{
+class TaskQueue;
+}
 namespace Navigation
 {
 template <typename T>
 class MRUList;
+template <typename TKey>
+class SpatialGrid;
 
 struct TileCacheData;
 struct InputGeometry;
@@ -108,9 +116,13 @@ struct EntityConnections
  *
  * Internally this class uses a dtTileCache to manage the tiles. Since the world is dynamic we need to manage the
  * navmeshes through tiles in order to keep the resource usage down.
+ *
+ * Dirty tiles are rebuilt through a task queue. The rasterization and compression of tiles happens in background threads,
+ * while the resulting layers are added to the tile cache and navmesh in the main thread.
  */
 class Awareness
 {
+	friend class TileRebuildTask;
 public:
 	/**
 	 * A callback function for processing tiles.
@@ -136,10 +148,22 @@ public:
 	void setAwarenessArea(const WFMath::RotBox<2>& area, const WFMath::Segment<2>& focusLine);
 
 	/**
-	 * @brief Rebuilds a dirty tile if any such exists.
-	 * @return The number of dirty tiles remaining.
+	 * @brief Starts rebuilding dirty tiles, if any such exists.
+	 *
+	 * Tiles are rebuilt in background threads, with those closest to the focus line being rebuilt first.
+	 * Only a limited amount of tiles are rebuilt at the same time; as tiles are completed more dirty tiles will automatically be
+	 * rebuilt, so there's no need to call this method repeatedly.
+	 * @return The number of dirty tiles which are waiting to be rebuilt.
 	 */
-	size_t rebuildDirtyTile();
+	size_t rebuildDirtyTiles();
+
+	/**
+	 * @brief Gets the rate at which tiles were rebuilt in the last measurement window.
+	 *
+	 * The rate is measured over a fixed amount of time spent rebuilding tiles; time when no tiles are being rebuilt isn't counted.
+	 * @return The number of tiles rebuilt per second, or 0 if no window has been completed yet.
+	 */
+	float getTileRebuildRate() const;
 
 	/**
 	 * @brief Finds a path from the start to the finish.
@@ -246,6 +270,16 @@ protected:
 	 */
 	std::list<sigc::connection> mSignalConnections;
 
+	/**
+	 * @brief The queue used for rebuilding tiles in background threads.
+	 */
+	Tasks::TaskQueue* mTaskQueue;
+
+	/**
+	 * @brief Set when shutting down, so that any tiles completed during shutdown are discarded.
+	 */
+	bool mIsShuttingDown;
+
 	struct LinearAllocator* mTalloc;
 	struct FastLZCompressor* mTcomp;
 	struct MeshProcess* mTmproc;
@@ -306,42 +340,84 @@ protected:
 	/**
 	 * @brief A set of tiles that are dirty and are in our current awareness area.
 	 *
-	 * These needs to be rebuilt as soon as possible.
-	 * @note The contents of the set is mirrored in mDirtyAwareOrderedTiles.
+	 * These needs to be rebuilt as soon as possible. When rebuilding, the tiles closest to mFocusLine are rebuilt first.
 	 */
 	std::set<std::pair<int, int>> mDirtyAwareTiles;
 
 	/**
-	 * @brief An ordered list of tiles that are dirty and are in our current awareness area.
+	 * @brief Tiles which currently are being rebuilt in the task queue.
+	 *
+	 * A tile which is marked as dirty while being rebuilt will be rebuilt again once the current rebuild is done.
+	 */
+	std::set<std::pair<int, int>> mPendingTiles;
+
+	/**
+	 * @brief The maximum number of tiles to rebuild at the same time.
+	 */
+	size_t mMaxPendingTiles;
+
+	/**
+	 * @brief The focus line of the current awareness area, used for prioritizing tile rebuilds.
 	 *
-	 * When rebuilding tiles we'll use the ordered list instead of the mDirtyAwareTiles set.
-	 * The reason is that we want to have some control of the order of tile buildings, so that those
-	 * tiles that are in a straight line between the entity and the destination are built first.
-	 * @note The contents of the set is mirrored in mDirtyAwareTiles.
+	 * The first endpoint is expected to be the position of the avatar.
 	 */
-	std::list<std::pair<int, int>> mDirtyAwareOrderedTiles;
+	WFMath::Segment<2> mFocusLine;
+
+	/**
+	 * @brief True if tiles are being rebuilt.
+	 */
+	bool mIsRebuildingTiles;
+
+	/**
+	 * @brief The time when tiles started being rebuilt, or when the current measurement window started if later.
+	 */
+	std::chrono::steady_clock::time_point mRebuildBusySince;
+
+	/**
+	 * @brief The rebuild time accumulated in the current measurement window, not counting the time since mRebuildBusySince.
+	 */
+	std::chrono::steady_clock::duration mRebuildWindowBusyTime;
+
+	/**
+	 * @brief The number of tiles rebuilt in the current measurement window.
+	 */
+	size_t mRebuildWindowTiles;
+
+	/**
+	 * @brief The rate, in tiles per second, of the last measurement window.
+	 */
+	float mTileRebuildRate;
 
 	/**
 	 * @brief The view resolved areas for each entity.
 	 *
 	 * This information is used when determining what tiles to rebuild when entities are moved.
+	 * @note Always use setEntityArea() and removeEntityArea() to alter this, so that mEntityAreaGrid is kept up to date.
 	 */
 	std::map<Eris::Entity*, WFMath::RotBox<2>> mEntityAreas;
 
+	/**
+	 * @brief A spatial index of the bounding boxes of the entries in mEntityAreas.
+	 *
+	 * The cells of the grid are aligned with the tiles.
+	 */
+	SpatialGrid<Eris::Entity*>* mEntityAreaGrid;
+
 	/**
 	 * @brief Keeps track of all currently observed entities.
 	 */
 	std::unordered_map<Eris::Entity*, EntityConnections> mObservedEntities;
 
 	/**
-	 * @brief Keeps track of all entities that are moving.
+	 * @brief Keeps track of all entities that are moving, indexed by their last known position.
 	 *
 	 * Moving entities aren't included in the navmesh generation and updates, but are instead
 	 * considered when doing obstacle avoidance.
 	 * It's expected that moving entities should be rather small and have a uniform shape, since they
 	 * internally are represented as 2d circles.
+	 * The positions are updated whenever the entities are moved.
 	 */
-	std::list<Eris::Entity*> mMovingEntities;
+	SpatialGrid<Eris::Entity*>* mMovingEntityGrid;
 
 	/**
 	 * @brief A Most Recently Used list of active tiles.
@@ -352,12 +428,44 @@ protected:
 	MRUList<std::pair<int, int>>* mActiveTileList;
 
 	/**
-	 * @brief Rebuild the tile at the specific index.
+	 * @brief Adds rasterized tile layers to the tile cache and rebuilds the navmesh for the tile.
+	 *
+	 * This must be called in the main thread. It will also start rebuilding more dirty tiles, if there are any.
 	 * @param tx X index.
 	 * @param ty Y index.
-	 * @param entityAreas A list of entities, projected as 2d rotation boxes, which affects the tile.
+	 * @param tiles The compressed tile layers. Ownership of the data is transferred.
+	 * @param ntiles The number of tile layers.
 	 */
-	void rebuildTile(int tx, int ty, const std::vector<WFMath::RotBox<2>>& entityAreas);
+	void addTileLayers(int tx, int ty, TileCacheData* tiles, int ntiles);
+
+	/**
+	 * @brief Calculates the Recast configuration for the tile at the specified index, including its border.
+	 * @param tx X index.
+	 * @param ty Y index.
+	 * @param tcfg The configuration will be written here.
+	 */
+	void configureTile(int tx, int ty, rcConfig& tcfg) const;
+
+	/**
+	 * @brief Gets the bounds of the terrain heights needed to rasterize the tile at the specified index.
+	 *
+	 * Heights are sampled with a 1 meter interval, and the max values are exclusive.
+	 * @param tx X index.
+	 * @param ty Y index.
+	 * @param xMin Min X coord.
+	 * @param xMax Max X coord.
+	 * @param yMin Min Y coord.
+	 * @param yMax Max Y coord.
+	 */
+	void getTileHeightBounds(int tx, int ty, int& xMin, int& xMax, int& yMin, int& yMax) const;
+
+	/**
+	 * @brief Gets the distances used for prioritizing the rebuild of the tile at the specified index.
+	 * @param index The tile index.
+	 * @param lineDistance The distance from the tile center to the focus line will be stored here.
+	 * @param startDistance The distance from the tile center to the start of the focus line will be stored here.
+	 */
+	void getTileDistances(const std::pair<int, int>& index, float& lineDistance, float& startDistance) const;
 
 	/**
 	 * @brief Calculates the 2d rotbox area of the entity and adds it to the supplied map of areas.
@@ -366,6 +474,25 @@ protected:
 	 */
 	void buildEntityAreas(Eris::Entity& entity, std::map<Eris::Entity*, WFMath::RotBox<2>>& entityAreas);
 
+	/**
+	 * @brief Sets the area of an entity, replacing any existing area.
+	 * @param entity An entity.
+	 * @param area The area of the entity.
+	 */
+	void setEntityArea(Eris::Entity* entity, const WFMath::RotBox<2>& area);
+
+	/**
+	 * @brief Removes the area of an entity.
+	 * @param entity An entity.
+	 */
+	void removeEntityArea(Eris::Entity* entity);
+
+	/**
+	 * @brief Registers a moving entity, or updates the position of an already registered one.
+	 * @param entity A moving entity.
+	 */
+	void updateMovingEntity(Eris::Entity* entity);
+
 	/**
 	 * Find entity 2d rotbox areas within the supplied extent.
 	 * @param extent An extent in world units.
@@ -375,6 +502,9 @@ protected:
 
 	/**
 	 * @brief Rasterizes the tile at the specified index.
+	 *
+	 * This doesn't touch any mutable state and is safe to call from a background thread.
+	 * @param heights The terrain heights covering the tile, as bounded by getTileHeightBounds().
 	 * @param entityAreas The entity areas that affects the tile.
 	 * @param tx X index.
 	 * @param ty Y index.
@@ -382,7 +512,7 @@ protected:
 	 * @param maxTiles The maximum number of tile layers to create.
 	 * @return The number of tile layers that were created.
 	 */
-	int rasterizeTileLayers(const std::vector<WFMath::RotBox<2>>& entityAreas, const int tx, const int ty, TileCacheData* tiles, const int maxTiles);
+	int rasterizeTileLayers(const std::vector<float>& heights, const std::vector<WFMath::RotBox<2>>& entityAreas, const int tx, const int ty, TileCacheData* tiles, const int maxTiles) const;
 
 	/**
 	 * @brief Applies the supplied processor on the supplied tiles.
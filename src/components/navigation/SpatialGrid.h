@@ -0,0 +1,230 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SPATIALGRID_H_
+#define SPATIALGRID_H_
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Ember
+{
+namespace Navigation
+{
+
+/**
+ * @brief A uniform grid for fast lookup of items by their 2d bounding boxes.
+ *
+ * Each item is registered in every cell its bounding box touches. Queries only need to look at the cells touched by the
+ * query area, instead of at all items. Items can be moved or removed incrementally.
+ *
+ * Note that queries are done against the bounding boxes of the items; any exact intersection tests must be done by the caller.
+ */
+template<typename TKey>
+class SpatialGrid
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * @param cellSize The size of one side of a cell, in world units.
+	 * @param origin The origin of the grid. Cells are aligned to this point.
+	 */
+	SpatialGrid(float cellSize, const WFMath::Point<2>& origin = WFMath::Point<2>::ZERO()) :
+			mCellSize(cellSize), mOrigin(origin)
+	{
+	}
+
+	/**
+	 * @brief Inserts an item, or updates the bounds of an already existing item.
+	 * @param key The item.
+	 * @param bounds The bounds of the item.
+	 */
+	void insert(const TKey& key, const WFMath::AxisBox<2>& bounds)
+	{
+		Entry entry;
+		entry.bounds = bounds;
+		getCellRange(bounds, entry.xMin, entry.xMax, entry.yMin, entry.yMax);
+
+		auto I = mEntries.find(key);
+		if (I != mEntries.end()) {
+			Entry& existing = I->second;
+			//Only touch the cells if the item has moved to other cells.
+			if (existing.xMin != entry.xMin || existing.xMax != entry.xMax || existing.yMin != entry.yMin || existing.yMax != entry.yMax) {
+				removeFromCells(key, existing);
+				addToCells(key, entry);
+			}
+			existing = entry;
+		} else {
+			addToCells(key, entry);
+			mEntries.insert(std::make_pair(key, entry));
+		}
+	}
+
+	/**
+	 * @brief Removes an item.
+	 * @param key The item.
+	 * @return True if the item was registered.
+	 */
+	bool remove(const TKey& key)
+	{
+		auto I = mEntries.find(key);
+		if (I == mEntries.end()) {
+			return false;
+		}
+		removeFromCells(key, I->second);
+		mEntries.erase(I);
+		return true;
+	}
+
+	/**
+	 * @brief Checks if an item is registered.
+	 * @param key The item.
+	 * @return True if the item is registered.
+	 */
+	bool contains(const TKey& key) const
+	{
+		return mEntries.find(key) != mEntries.end();
+	}
+
+	/**
+	 * @brief Finds all items whose bounds intersect the supplied area.
+	 *
+	 * Each item is only reported once, even if it spans multiple cells.
+	 * @param area An area in world units.
+	 * @param result Matching items will be appended to this.
+	 */
+	void query(const WFMath::AxisBox<2>& area, std::vector<TKey>& result) const
+	{
+		int xMin, xMax, yMin, yMax;
+		getCellRange(area, xMin, xMax, yMin, yMax);
+
+		for (int x = xMin; x <= xMax; ++x) {
+			for (int y = yMin; y <= yMax; ++y) {
+				auto I = mCells.find(packIndex(x, y));
+				if (I == mCells.end()) {
+					continue;
+				}
+				for (auto& key : I->second) {
+					const Entry& entry = mEntries.find(key)->second;
+					//Items spanning multiple cells are only reported from the first cell shared by the item and the query.
+					if (x != std::max(xMin, entry.xMin) || y != std::max(yMin, entry.yMin)) {
+						continue;
+					}
+					if (intersects(entry.bounds, area)) {
+						result.push_back(key);
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Gets the number of registered items.
+	 * @return The number of items.
+	 */
+	size_t size() const
+	{
+		return mEntries.size();
+	}
+
+	/**
+	 * @brief Removes all items.
+	 */
+	void clear()
+	{
+		mEntries.clear();
+		mCells.clear();
+	}
+
+private:
+
+	struct Entry
+	{
+		WFMath::AxisBox<2> bounds;
+		int xMin;
+		int xMax;
+		int yMin;
+		int yMax;
+	};
+
+	float mCellSize;
+	WFMath::Point<2> mOrigin;
+
+	std::unordered_map<TKey, Entry> mEntries;
+	std::unordered_map<std::uint64_t, std::vector<TKey>> mCells;
+
+	static std::uint64_t packIndex(int x, int y)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+	}
+
+	static bool intersects(const WFMath::AxisBox<2>& a, const WFMath::AxisBox<2>& b)
+	{
+		return a.lowCorner().x() <= b.highCorner().x() && a.highCorner().x() >= b.lowCorner().x() && a.lowCorner().y() <= b.highCorner().y() && a.highCorner().y() >= b.lowCorner().y();
+	}
+
+	void getCellRange(const WFMath::AxisBox<2>& bounds, int& xMin, int& xMax, int& yMin, int& yMax) const
+	{
+		xMin = static_cast<int>(std::floor((bounds.lowCorner().x() - mOrigin.x()) / mCellSize));
+		xMax = static_cast<int>(std::floor((bounds.highCorner().x() - mOrigin.x()) / mCellSize));
+		yMin = static_cast<int>(std::floor((bounds.lowCorner().y() - mOrigin.y()) / mCellSize));
+		yMax = static_cast<int>(std::floor((bounds.highCorner().y() - mOrigin.y()) / mCellSize));
+	}
+
+	void addToCells(const TKey& key, const Entry& entry)
+	{
+		for (int x = entry.xMin; x <= entry.xMax; ++x) {
+			for (int y = entry.yMin; y <= entry.yMax; ++y) {
+				mCells[packIndex(x, y)].push_back(key);
+			}
+		}
+	}
+
+	void removeFromCells(const TKey& key, const Entry& entry)
+	{
+		for (int x = entry.xMin; x <= entry.xMax; ++x) {
+			for (int y = entry.yMin; y <= entry.yMax; ++y) {
+				auto I = mCells.find(packIndex(x, y));
+				if (I != mCells.end()) {
+					auto& keys = I->second;
+					auto J = std::find(keys.begin(), keys.end(), key);
+					if (J != keys.end()) {
+						//Order within a cell doesn't matter, so swap with the last element to avoid shifting.
+						*J = keys.back();
+						keys.pop_back();
+					}
+					if (keys.empty()) {
+						mCells.erase(I);
+					}
+				}
+			}
+		}
+	}
+};
+
+}
+}
+
+#endif /* SPATIALGRID_H_ */
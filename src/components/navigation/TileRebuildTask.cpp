@@ -0,0 +1,66 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "TileRebuildTask.h"
+#include "Awareness.h"
+
+namespace Ember
+{
+namespace Navigation
+{
+
+TileRebuildTask::TileRebuildTask(Awareness& awareness, int tx, int ty, std::vector<float> heights, std::vector<WFMath::RotBox<2>> entityAreas, int priority) :
+		mAwareness(awareness), mTx(tx), mTy(ty), mHeights(std::move(heights)), mEntityAreas(std::move(entityAreas)), mPriority(priority), mNumberOfTiles(0)
+{
+	memset(mTiles, 0, sizeof(mTiles));
+}
+
+TileRebuildTask::~TileRebuildTask()
+{
+	for (int i = 0; i < mNumberOfTiles; ++i) {
+		dtFree(mTiles[i].data);
+	}
+}
+
+void TileRebuildTask::executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
+{
+	mNumberOfTiles = mAwareness.rasterizeTileLayers(mHeights, mEntityAreas, mTx, mTy, mTiles, MAX_LAYERS);
+	//Release memory as soon as we can.
+	mHeights = std::vector<float>();
+	mEntityAreas = std::vector<WFMath::RotBox<2>>();
+}
+
+bool TileRebuildTask::executeTaskInMainThread()
+{
+	mAwareness.addTileLayers(mTx, mTy, mTiles, mNumberOfTiles);
+	//The tile cache now owns the data.
+	mNumberOfTiles = 0;
+	return true;
+}
+
+int TileRebuildTask::getPriority() const
+{
+	return mPriority;
+}
+
+}
+}
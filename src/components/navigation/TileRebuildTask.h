@@ -0,0 +1,91 @@
+/*
+ Copyright (C) 2014 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TILEREBUILDTASK_H_
+#define TILEREBUILDTASK_H_
+
+#include "framework/tasks/TemplateNamedTask.h"
+#include "Awareness.h"
+#include "AwarenessUtils.h"
+
+#include <wfmath/rotbox.h>
+
+#include <vector>
+
+namespace Ember
+{
+namespace Navigation
+{
+
+/**
+ * @brief Rebuilds one navmesh tile.
+ *
+ * The heightfield rasterization, layer building and compression is done in a background thread.
+ * The resulting compressed layers are then added to the tile cache and navmesh in the main thread.
+ *
+ * Since the height provider only can be accessed from the main thread, the heights for the tile must be supplied when the task is created.
+ */
+class TileRebuildTask : public Tasks::TemplateNamedTask<TileRebuildTask>
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * @param awareness The awareness instance to which the tile belongs.
+	 * @param tx X index.
+	 * @param ty Y index.
+	 * @param heights Terrain heights covering the tile, as returned by Awareness::getTileHeightBounds().
+	 * @param entityAreas The entity areas which affect the tile.
+	 * @param priority The priority of the task.
+	 */
+	TileRebuildTask(Awareness& awareness, int tx, int ty, std::vector<float> heights, std::vector<WFMath::RotBox<2>> entityAreas, int priority);
+
+	virtual ~TileRebuildTask();
+
+	virtual void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context);
+
+	virtual bool executeTaskInMainThread();
+
+	virtual int getPriority() const;
+
+private:
+
+	Awareness& mAwareness;
+	const int mTx;
+	const int mTy;
+	std::vector<float> mHeights;
+	std::vector<WFMath::RotBox<2>> mEntityAreas;
+	const int mPriority;
+
+	/**
+	 * @brief The compressed tile layers, as created in the background thread.
+	 *
+	 * Ownership of the data is transferred to the tile cache in the main thread. Any data which remains will be freed at destruction.
+	 */
+	TileCacheData mTiles[MAX_LAYERS];
+
+	/**
+	 * @brief The number of valid entries in mTiles.
+	 */
+	int mNumberOfTiles;
+};
+
+}
+}
+
+#endif /* TILEREBUILDTASK_H_ */
@@ -20,6 +20,7 @@
 
 #include "domain/IEntityControlDelegate.h"
 #include "components/ogre/NodeAttachment.h"
+#include "components/ogre/MotionManager.h"
 #include <wfmath/quaternion.h>
 #include <wfmath/const.h>
 
@@ -38,6 +39,10 @@ void DelegatingNodeController::updatePosition() {
 	mAttachment.setPosition(mAttachmentControlDelegate.getPosition(), mAttachmentControlDelegate.getOrientation(), mAttachmentControlDelegate.getVelocity());
 }
 
+void DelegatingNodeController::registerMotion(MotionManager& motionManager) {
+	motionManager.addMovable(this);
+}
+
 IEntityControlDelegate* DelegatingNodeController::getControlDelegate() const {
 	return &mAttachmentControlDelegate;
 }
@@ -61,6 +61,11 @@ private:
 
 	virtual void updatePosition();
 
+	/**
+	 * @brief The delegate decides the movement, so it can't be predicted; the position is instead updated each frame.
+	 */
+	void registerMotion(MotionManager& motionManager) override;
+
 };
 
 }
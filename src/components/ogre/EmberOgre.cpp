@@ -45,6 +45,7 @@
 #include "services/scripting/ScriptingService.h"
 #include "framework/IScriptingProvider.h"
 #include "framework/TimeFrame.h"
+#include "framework/XMLDocumentCache.h"
 
 #include "terrain/TerrainLayerDefinitionManager.h"
 
@@ -74,6 +75,7 @@
 
 #include "OgreLogObserver.h"
 #include "OgreResourceLoader.h"
+#include "ResourcePreloader.h"
 #include "authoring/ConsoleDevTools.h"
 
 #include "EmberEntityFactory.h"
@@ -189,6 +191,9 @@ EmberOgre::~EmberOgre()
 	delete mLodManager;
 	delete mLodDefinitionManager;
 
+	//The model background loaders use the preloader, and it uses the Ogre background queue, so it must be destroyed in between.
+	mResourcePreloader.reset();
+
 	// 	if (mWindow) {
 	// 		mRoot->getRenderSystem()->destroyRenderTarget(mWindow->getName());
 	// 	}
@@ -250,6 +255,7 @@ bool EmberOgre::renderOneFrame(const TimeFrame& timeFrame)
 			long remainingTime = timeFrame.getRemainingTime().total_milliseconds();
 			remainingTime = std::max(1L, remainingTime);
 			mRoot->getWorkQueue()->setResponseProcessingTimeLimit(remainingTime);
+			mResourcePreloader->processUploads(timeFrame);
 			mRoot->_fireFrameEnded();
 //			log.report("_fireFrameEnded");
 
@@ -260,6 +266,12 @@ bool EmberOgre::renderOneFrame(const TimeFrame& timeFrame)
 		return true;
 	} else {
 		mIsInPausedMode = true;
+		//Keep on uploading resources even when nothing is rendered, since background loading (such as of models) depends on it to progress.
+		try {
+			mResourcePreloader->processUploads(timeFrame, false);
+		} catch (const std::exception& ex) {
+			S_LOG_FAILURE("Error when processing resource uploads in the main render loop." << ex);
+		}
 		return false;
 	}
 }
@@ -334,6 +346,16 @@ bool EmberOgre::setup(Input& input, MainLoopController& mainLoopController, Eris
 	//We'll control the rendering ourself and need to turn off the autoupdating.
 	mWindow->setAutoUpdated(false);
 
+	//All definitions are parsed when the resource groups are initialized, so the cache must be in place before that.
+	mXMLDocumentCache.reset(new XMLDocumentCache(configSrv.getHomeDirectory(BaseDirType_CACHE) + "/definitions.cache"));
+
+	//Resources are uploaded in the main thread with a time budget for each frame, in milliseconds.
+	int uploadBudget = 4;
+	if (configSrv.itemExists("media", "uploadbudget")) {
+		uploadBudget = std::max(1, static_cast<int>(configSrv.getValue("media", "uploadbudget")));
+	}
+	mResourcePreloader.reset(new ResourcePreloader(boost::posix_time::milliseconds(uploadBudget)));
+
 	std::string exportDir(configSrv.getHomeDirectory(BaseDirType_DATA) + "user-media/data/");
 	//Create the model definition manager
 	mModelDefinitionManager = new Model::ModelDefinitionManager(exportDir, eventService);
@@ -426,6 +448,9 @@ bool EmberOgre::setup(Input& input, MainLoopController& mainLoopController, Eris
 
 		Ogre::ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
 
+		//Write any new or changed definitions while the rest of the setup goes on.
+		mXMLDocumentCache->writeInBackground();
+
 		//out of pure interest we'll print out how many modeldefinitions we've loaded
 		Ogre::ResourceManager::ResourceMapIterator I = Model::ModelDefinitionManager::getSingleton().getResourceIterator();
 		int count = 0;
@@ -548,6 +573,7 @@ void EmberOgre::Server_GotView(Eris::View* view)
 	mWorld->getEntityFactory().EventBeingDeleted.connect(sigc::mem_fun(*this, &EmberOgre::EntityFactory_BeingDeleted));
 	mShaderManager->registerSceneManager(&mWorld->getSceneManager());
 	EventWorldCreated.emit(*mWorld);
+	mResourcePreloader->startStatistics();
 }
 
 void EmberOgre::EntityFactory_BeingDeleted()
@@ -64,6 +64,7 @@ class Input;
 class MainLoopController;
 class TimeFrame;
 class EmberEntity;
+class XMLDocumentCache;
 namespace OgreView
 {
 
@@ -108,6 +109,7 @@ class ConsoleDevTools;
 class GUIManager;
 
 class OgreResourceLoader;
+class ResourcePreloader;
 
 class OgreLogObserver;
 
@@ -379,6 +381,16 @@ protected:
 
 	ConsoleDevTools* mConsoleDevTools;
 
+	/**
+	 * @brief Keeps parsed definition documents between runs, to speed up startup.
+	 */
+	std::unique_ptr<XMLDocumentCache> mXMLDocumentCache;
+
+	/**
+	 * @brief Performs resource uploads in the main thread, and preloads media.
+	 */
+	std::unique_ptr<ResourcePreloader> mResourcePreloader;
+
 	/**
 	 * @brief Gets the main Eris View instance, which is the main inteface to the world.
 	 *
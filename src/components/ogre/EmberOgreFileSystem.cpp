@@ -35,189 +35,14 @@ Torus Knot Software Ltd.
 #include <OgreLogManager.h>
 #include <OgreRoot.h>
 
-#if OGRE_PLATFORM == OGRE_PLATFORM_LINUX || OGRE_PLATFORM == OGRE_PLATFORM_APPLE
-#include <sys/param.h>
-#include <dirent.h>
-#include <fnmatch.h>
-
-
-
-
-namespace Ember {
-namespace OgreView {
-
-/* Our simplified data entry structure */
-struct _finddata_t
-{
-    char *name;
-    int attrib;
-    unsigned long size;
-};
-
-long _findfirst(const char *pattern, struct _finddata_t *data);
-int _findnext(long id, struct _finddata_t *data);
-int _findclose(long id);
-
-}
-}
-#define _A_NORMAL 0x00  /* Normalfile-Noread/writerestrictions */
-#define _A_RDONLY 0x01  /* Read only file */
-#define _A_HIDDEN 0x02  /* Hidden file */
-#define _A_SYSTEM 0x04  /* System file */
-#define _A_SUBDIR 0x10  /* Subdirectory */
-#define _A_ARCH   0x20  /* Archive file */
-#define MAX_PATH MAXPATHLEN
-
-#endif
+#include <sys/stat.h>
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
-
-#include <windows.h>
-#include <direct.h>
-#include <io.h>
-#include <stdio.h>
 #include <ctype.h>
-
 #endif
 
 using namespace Ogre;
-namespace Ember {
-namespace OgreView {
-
-#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
-
-struct _find_search_t
-{
-    char *pattern;
-    char *curfn;
-    char *directory;
-    int dirlen;
-    DIR *dirfd;
-};
-
-long _findfirst(const char *pattern, struct _finddata_t *data)
-{
-    _find_search_t *fs = new _find_search_t;
-    fs->curfn = NULL;
-    fs->pattern = NULL;
-
-    // Separate the mask from directory name
-    const char *mask = strrchr (pattern, '/');
-    if (mask)
-    {
-        fs->dirlen = mask - pattern;
-        mask++;
-        fs->directory = (char *)malloc (fs->dirlen + 1);
-        memcpy (fs->directory, pattern, fs->dirlen);
-        fs->directory [fs->dirlen] = 0;
-    }
-    else
-    {
-        mask = pattern;
-        fs->directory = strdup (".");
-        fs->dirlen = 1;
-    }
-
-    fs->dirfd = opendir (fs->directory);
-    if (!fs->dirfd)
-    {
-        _findclose ((long)fs);
-        return -1;
-    }
-
-    /* Hack for "*.*" -> "*' from DOS/Windows */
-    if (strcmp (mask, "*.*") == 0)
-        mask += 2;
-    fs->pattern = strdup (mask);
-
-    /* Get the first entry */
-    if (_findnext ((long)fs, data) < 0)
-    {
-        _findclose ((long)fs);
-        return -1;
-    }
-
-    return (long)fs;
-}
-
-int _findnext(long id, struct _finddata_t *data)
-{
-    _find_search_t *fs = (_find_search_t *)id;
-
-    /* Loop until we run out of entries or find the next one */
-    dirent *entry;
-    for (;;)
-    {
-        if (!(entry = readdir (fs->dirfd)))
-            return -1;
-
-        /* See if the filename matches our pattern */
-        if (fnmatch (fs->pattern, entry->d_name, 0) == 0)
-            break;
-    }
-
-    if (fs->curfn)
-        free (fs->curfn);
-    data->name = fs->curfn = strdup (entry->d_name);
-
-    size_t namelen = strlen (entry->d_name);
-    char *xfn = new char [fs->dirlen + 1 + namelen + 1];
-    sprintf (xfn, "%s/%s", fs->directory, entry->d_name);
-
-    /* stat the file to get if it's a subdir and to find its length */
-    struct stat stat_buf;
-    if (stat (xfn, &stat_buf))
-    {
-        // Hmm strange, imitate a zero-length file then
-        data->attrib = _A_NORMAL;
-        data->size = 0;
-    }
-    else
-    {
-        if (S_ISDIR(stat_buf.st_mode))
-            data->attrib = _A_SUBDIR;
-        else
-            /* Default type to a normal file */
-            data->attrib = _A_NORMAL;
-
-        data->size = stat_buf.st_size;
-    }
 
-    delete [] xfn;
-
-    /* Files starting with a dot are hidden files in Unix */
-    if (data->name [0] == '.')
-        data->attrib |= _A_HIDDEN;
-
-    return 0;
-}
-
-int _findclose(long id)
-{
-    int ret;
-    _find_search_t *fs = (_find_search_t *)id;
-
-    ret = fs->dirfd ? closedir (fs->dirfd) : 0;
-    free (fs->pattern);
-    free (fs->directory);
-    if (fs->curfn)
-        free (fs->curfn);
-    delete fs;
-
-    return ret;
-}
-
-
-#endif
-}
-
-}
-
-    //-----------------------------------------------------------------------
-    static bool is_reserved_dir (const char *fn)
-    {
-        return (fn [0] == '.' && (fn [1] == 0 || (fn [1] == '.' && fn [2] == 0)));
-    }
     //-----------------------------------------------------------------------
     static bool is_absolute_path(const char* path)
     {
@@ -239,7 +64,7 @@ namespace Ember {
 namespace OgreView {
     //-----------------------------------------------------------------------
     FileSystemArchive::FileSystemArchive(const String& name, const String& archType )
-        : Archive(name, archType)
+        : Archive(name, archType), mIndex(name)
     {
     }
     //-----------------------------------------------------------------------
@@ -257,102 +82,23 @@ namespace OgreView {
     void FileSystemArchive::findFiles(const String& pattern, bool recursive,
         bool dirs, StringVector* simpleList, FileInfoList* detailList) const
     {
-        long lHandle, res;
-        struct _finddata_t tagData{};
-        // pattern can contain a directory name, separate it from mask
-        size_t pos1 = pattern.rfind ('/');
-        size_t pos2 = pattern.rfind ('\\');
-        if (pos1 == pattern.npos || ((pos2 != pattern.npos) && (pos1 < pos2)))
-            pos1 = pos2;
-        String directory;
-        if (pos1 != pattern.npos)
-            directory = pattern.substr (0, pos1 + 1);
-
-		String base_dir = mName;
-		if (!directory.empty ())
-		{
-			base_dir = concatenate_path(mName, directory);
-			// Remove the last '/'
-			base_dir.erase (base_dir.length () - 1);
-		}
-
-		//if there's a file with the name "norecurse" we shouldn't recurse further
-		std::ifstream norecurseFile((base_dir + "/norecurse").c_str());
-		if (!norecurseFile.fail()) {
-			return;
-		}
-
-		base_dir.append ("/*");
-
-
-        String full_pattern = concatenate_path(mName, pattern);
-
-        lHandle = _findfirst(full_pattern.c_str(), &tagData);
-        res = 0;
-        while (lHandle != -1 && res != -1)
-        {
-            if ((dirs == ((tagData.attrib & _A_SUBDIR) != 0)) &&
-                (!dirs || !is_reserved_dir (tagData.name)))
+        mIndex.find(pattern, recursive, dirs, [&](const std::string& directory, const FileSystemIndex::Entry& entry) {
+            if (simpleList)
             {
-
-                if (simpleList)
-                {
-                    simpleList->push_back(directory + tagData.name);
-                }
-                else if (detailList)
-                {
-                    FileInfo fi;
-                    fi.archive = this;
-                    fi.filename = directory + tagData.name;
-                    fi.basename = tagData.name;
-                    fi.path = directory;
-                    fi.compressedSize = tagData.size;
-                    fi.uncompressedSize = tagData.size;
-                    detailList->push_back(fi);
-
-                }
+                simpleList->push_back(directory + entry.name);
             }
-            res = _findnext( lHandle, &tagData );
-        }
-        // Close if we found any files
-        if(lHandle != -1)
-            _findclose(lHandle);
-
-
-        // Now find directories
-        if (recursive)
-        {
-
-
-            // Remove directory name from pattern
-            String mask ("/");
-            if (pos1 != pattern.npos)
-                mask.append (pattern.substr (pos1 + 1));
-            else
-                mask.append (pattern);
-
-            lHandle = _findfirst(base_dir.c_str (), &tagData);
-            res = 0;
-            while (lHandle != -1 && res != -1)
+            else if (detailList)
             {
-        		//if the name of the directory is "source" we should ignore it, since these are directories
-        		//containing raw source materials (.psd files, .blend files etc) which we don't want to bring
-        		//into the client (they tend to be rather large)
-                if ((tagData.attrib & _A_SUBDIR) &&
-                    !is_reserved_dir (tagData.name) && !(tagData.attrib & _A_HIDDEN) &&
-                    std::strcmp(tagData.name, "source") != 0)
-                {
-                    // recurse
-                    base_dir = directory;
-                    base_dir.append (tagData.name).append (mask);
-                    findFiles(base_dir, recursive, dirs, simpleList, detailList);
-                }
-                res = _findnext( lHandle, &tagData );
+                FileInfo fi;
+                fi.archive = this;
+                fi.filename = directory + entry.name;
+                fi.basename = entry.name;
+                fi.path = directory;
+                fi.compressedSize = entry.size;
+                fi.uncompressedSize = entry.size;
+                detailList->push_back(fi);
             }
-            // Close if we found any files
-            if(lHandle != -1)
-                _findclose(lHandle);
-        }
+        });
     }
     //-----------------------------------------------------------------------
     FileSystemArchive::~FileSystemArchive()
@@ -362,12 +108,13 @@ namespace OgreView {
     //-----------------------------------------------------------------------
     void FileSystemArchive::load()
     {
-        // do nothing here, what has to be said will be said later
+        mIndex.build();
+        S_LOG_VERBOSE("Indexed " << mIndex.getFileCount() << " files in " << mName << ".");
     }
     //-----------------------------------------------------------------------
     void FileSystemArchive::unload()
     {
-        // nothing to see here, move along
+        mIndex.clear();
     }
     //-----------------------------------------------------------------------
     DataStreamPtr FileSystemArchive::open(const String& filename, bool readOnly) const
@@ -440,6 +187,12 @@ namespace OgreView {
     //-----------------------------------------------------------------------
 	bool FileSystemArchive::exists(const String& filename) const
 	{
+		//The index could lag behind the disk if a change hasn't been reported yet, so only trust it when it finds the file.
+		if (!is_absolute_path(filename.c_str()) && mIndex.exists(filename))
+		{
+			return true;
+		}
+
         String full_path = concatenate_path(mName, filename);
 
         struct stat tagStat;
@@ -447,7 +200,7 @@ namespace OgreView {
 
 		// stat will return true if the filename is absolute, but we need to check
 		// the file is actually in this archive
-        if (ret && is_absolute_path(filename.c_str()))
+        if (ret)
 		{
 			// only valid if full path starts with our base
 			ret = Ogre::StringUtil::startsWith(full_path, mName);
@@ -455,7 +208,15 @@ namespace OgreView {
 
 		return ret;
 	}
-	
+
+	void FileSystemArchive::pathChanged(const String& path)
+	{
+		if (Ogre::StringUtil::startsWith(path, mName + "/", false))
+		{
+			mIndex.pathChanged(path.substr(mName.length() + 1));
+		}
+	}
+
 	time_t FileSystemArchive::getModifiedTime(const String& filename) const
 	{
 		String full_path = concatenate_path(mName, filename);
@@ -35,6 +35,8 @@ Torus Knot Software Ltd.
 #include <OgreArchive.h>
 #include <OgreArchiveFactory.h>
 
+#include "framework/FileSystemIndex.h"
+
 namespace Ember {
 namespace OgreView {
 
@@ -43,10 +45,17 @@ namespace OgreView {
         This has been modified from the original Ogre class to:
         1) not visit hidden directories (such as .svn)
         2) not recurse into directories if there's a file named "norecurse" in them
+        3) serve all queries from an index of the directory tree, built when the archive is loaded,
+           instead of reading the directories on each query
     */
     class FileSystemArchive : public Ogre::Archive
     {
     protected:
+        /**
+         * @brief An index of all files in the archive.
+         */
+        FileSystemIndex mIndex;
+
         /** Utility method to retrieve all files in a directory matching pattern.
         @param pattern File pattern
         @param recursive Whether to cascade down directories
@@ -98,6 +107,14 @@ namespace OgreView {
 		 */
 		time_t getModifiedTime(const Ogre::String& filename) const override;
 
+		/**
+		 * @brief Updates the index after a change has been detected in the file system.
+		 *
+		 * Changes outside of the archive are ignored.
+		 * @param path The full path of the changed file or directory.
+		 */
+		void pathChanged(const Ogre::String& path);
+
     };
 
     /** Specialisation of ArchiveFactory for FileSystem files. */
@@ -19,6 +19,10 @@
 #ifndef IMOVABLE_H_
 #define IMOVABLE_H_
 
+#include <wfmath/point.h>
+#include <wfmath/vector.h>
+#include <wfmath/quaternion.h>
+
 namespace Ember
 {
 namespace OgreView
@@ -48,6 +52,18 @@ public:
 	 * @param timeSlice The current time slice, in seconds.
 	 */
 	virtual void updateMotion(float timeSlice) = 0;
+
+	/**
+	 * @brief Called when the position predicted by the MotionManager has changed.
+	 *
+	 * This is only called for movables added through MotionManager::addPredictedMovable().
+	 * @param position The predicted position.
+	 * @param orientation The orientation.
+	 * @param velocity The velocity.
+	 */
+	virtual void setPredictedMotion(const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity)
+	{
+	}
 };
 
 }
@@ -26,6 +26,7 @@
 #endif
 
 #include "MeshCollisionDetector.h"
+#include "TriangleBVH.h"
 
 #include "model/Model.h"
 #include "model/SubModel.h"
@@ -37,6 +38,41 @@
 namespace Ember {
 namespace OgreView {
 
+namespace {
+/**
+ * @brief All collision data currently in use, by mesh.
+ * Only weak references are kept, so that the data is destroyed once no detector uses it anymore.
+ */
+std::unordered_map<const Ogre::Mesh*, std::weak_ptr<MeshCollisionData>> sCollisionDataRegistry;
+}
+
+MeshCollisionData::MeshCollisionData(Ogre::MeshPtr mesh)
+: mMesh(std::move(mesh))
+{
+	mMesh->addListener(this);
+}
+
+MeshCollisionData::~MeshCollisionData()
+{
+	mMesh->removeListener(this);
+}
+
+const TriangleBVH* MeshCollisionData::getBVH()
+{
+	if (!mBVH && mMesh->isLoaded()) {
+		std::vector<Ogre::Vector3> vertices;
+		std::vector<unsigned long> indices;
+		MeshCollisionDetector::getMeshInformation(mMesh, vertices, indices);
+		mBVH.reset(new TriangleBVH(vertices, indices));
+	}
+	return mBVH.get();
+}
+
+void MeshCollisionData::unloadingComplete(Ogre::Resource*)
+{
+	mBVH.reset();
+}
+
 MeshCollisionDetector::MeshCollisionDetector(Model::Model* model)
 :mModel(model)
 {
@@ -45,6 +81,7 @@ MeshCollisionDetector::MeshCollisionDetector(Model::Model* model)
 
 void MeshCollisionDetector::reload()
 {
+	mCollisionData.clear();
 }
 
 void MeshCollisionDetector::refit()
@@ -59,60 +96,61 @@ bool MeshCollisionDetector::getVisualize() const
 	return false;
 }
 
-void MeshCollisionDetector::testCollision(Ogre::Ray& ray, CollisionResult& result)
+std::shared_ptr<MeshCollisionData> MeshCollisionDetector::getCollisionData(const Ogre::MeshPtr& mesh)
 {
+	auto I = sCollisionDataRegistry.find(mesh.get());
+	if (I != sCollisionDataRegistry.end()) {
+		auto data = I->second.lock();
+		if (data) {
+			return data;
+		}
+	}
+
+	//Remove any data no longer in use, since the meshes they refer to might have been destroyed.
+	for (auto J = sCollisionDataRegistry.begin(); J != sCollisionDataRegistry.end();) {
+		if (J->second.expired()) {
+			J = sCollisionDataRegistry.erase(J);
+		} else {
+			++J;
+		}
+	}
 
-	// at this point we have raycast to a series of different objects bounding boxes.
-	// we need to test these different objects to see which is the first polygon hit.
-	// there are some minor optimizations (distance based) that mean we wont have to
-	// check all of the objects most of the time, but the worst case scenario is that
-	// we need to test every triangle of every object.
+	auto data = std::make_shared<MeshCollisionData>(mesh);
+	sCollisionDataRegistry[mesh.get()] = data;
+	return data;
+}
+
+void MeshCollisionDetector::testCollision(Ogre::Ray& ray, CollisionResult& result)
+{
 	Ogre::Real closest_distance = -1.0f;
-	Ogre::Vector3 closest_result = Ogre::Vector3::ZERO;
 	if (mModel->getNodeProvider() && mModel->getNodeProvider()->getNode()) {
 		auto* node = mModel->getNodeProvider()->getNode();
+
+		//Transform the ray into the local space of the model, instead of transforming all vertices into world space.
+		//Since the direction is transformed along with the origin, distances along the ray are the same in both spaces.
+		const Ogre::Vector3& scale = node->getScale();
+		if (scale.x == 0 || scale.y == 0 || scale.z == 0) {
+			result.collided = false;
+			return;
+		}
+		Ogre::Quaternion inverseOrientation = node->_getDerivedOrientation().Inverse();
+		Ogre::Ray localRay((inverseOrientation * (ray.getOrigin() - node->_getDerivedPosition())) / scale, (inverseOrientation * ray.getDirection()) / scale);
+
 		const auto& submodels = mModel->getSubmodels();
 		for (auto& submodel : submodels) {
 			Ogre::Entity* pentity = submodel->getEntity();
 			if (pentity->isVisible()) {
-				// mesh data to retrieve
-				size_t vertex_count;
-				size_t index_count;
-
-				// get the mesh information
-				getMeshInformation(pentity->getMesh(), vertex_count, mVertices, index_count, mIndices,
-								   node->_getDerivedPosition(),
-								   node->_getDerivedOrientation(),
-								   node->getScale());
-
-				// test for hitting individual triangles on the mesh
-				bool new_closest_found = false;
-				for (int i = 0; i < static_cast<int>(index_count); i += 3) {
-					// check for a hit against this triangle
-					std::pair<bool, Ogre::Real> hit = Ogre::Math::intersects(ray, mVertices[mIndices[i]],
-																			 mVertices[mIndices[i + 1]], mVertices[mIndices[i + 2]], true, false);
-
-					// if it was a hit check if its the closest
-					if (hit.first) {
-						if ((closest_distance < 0.0f) ||
-							(hit.second < closest_distance)) {
-							// this is the closest so far, save it off
-							closest_distance = hit.second;
-							new_closest_found = true;
-						}
-					}
+				const Ogre::MeshPtr& mesh = pentity->getMesh();
+				auto& collisionData = mCollisionData[mesh.get()];
+				if (!collisionData) {
+					collisionData = getCollisionData(mesh);
 				}
-
-				//16000 seems like a good number for most meshes
-				mVertices.resize(16000);
-				mVertices.shrink_to_fit();
-				mIndices.resize(16000);
-				mIndices.shrink_to_fit();
-
-				// if we found a new closest raycast for this object, update the
-				// closest_result before moving on to the next object.
-				if (new_closest_found) {
-					closest_result = ray.getPoint(closest_distance);
+				const TriangleBVH* bvh = collisionData->getBVH();
+				Ogre::Real distance;
+				if (bvh && bvh->intersect(localRay, distance)) {
+					if ((closest_distance < 0.0f) || (distance < closest_distance)) {
+						closest_distance = distance;
+					}
 				}
 			}
 		}
@@ -124,7 +162,7 @@ void MeshCollisionDetector::testCollision(Ogre::Ray& ray, CollisionResult& resul
 	{
 		// raycast success
 		result.collided = true;
-		result.position = closest_result;
+		result.position = ray.getPoint(closest_distance);
 		result.distance = closest_distance;
 	}
 	else
@@ -138,13 +176,8 @@ void MeshCollisionDetector::testCollision(Ogre::Ray& ray, CollisionResult& resul
 // Get the mesh information for the given mesh.
 // Code found on this forum link: http://www.ogre3d.org/wiki/index.php/RetrieveVertexData
 void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
-                                size_t &vertex_count,
                                 std::vector<Ogre::Vector3> &vertices,
-                                size_t &index_count,
-                                std::vector<unsigned long> &indices,
-                                const Ogre::Vector3 &position,
-                                const Ogre::Quaternion &orient,
-                                const Ogre::Vector3 &scale)
+                                std::vector<unsigned long> &indices)
 {
 	bool added_shared = false;
 	size_t current_offset = 0;
@@ -152,7 +185,8 @@ void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
 	size_t next_offset = 0;
 	size_t index_offset = 0;
 
-	vertex_count = index_count = 0;
+	size_t vertex_count = 0;
+	size_t index_count = 0;
 
 	// Calculate how many vertices and indices we're going to need
 	for (unsigned short i = 0; i < mesh->getNumSubMeshes(); ++i)
@@ -179,8 +213,8 @@ void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
 
 
 	// Allocate space for the vertices and indices
-	vertices.reserve(vertex_count);
-	indices.reserve(index_count);
+	vertices.resize(vertex_count);
+	indices.resize(index_count);
 
 	added_shared = false;
 
@@ -218,9 +252,7 @@ void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
 			{
 				posElem->baseVertexPointerToElement(vertex, &pReal);
 
-				Ogre::Vector3 pt(pReal[0], pReal[1], pReal[2]);
-
-				vertices[current_offset + j] = (orient * (pt * scale)) + position;
+				vertices[current_offset + j] = Ogre::Vector3(pReal[0], pReal[1], pReal[2]);
 			}
 
 			vbuf->unlock();
@@ -234,7 +266,8 @@ void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
 
 		bool use32bitindexes = (ibuf->getType() == Ogre::HardwareIndexBuffer::IT_32BIT);
 
-		unsigned long*  pLong = static_cast<unsigned long*>(ibuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
+		//32 bit indices must be read as uint32_t, since unsigned long is 64 bits on some platforms.
+		uint32_t*  pLong = static_cast<uint32_t*>(ibuf->lock(Ogre::HardwareBuffer::HBL_READ_ONLY));
 		unsigned short* pShort = reinterpret_cast<unsigned short*>(pLong);
 
 
@@ -244,7 +277,7 @@ void MeshCollisionDetector::getMeshInformation(const Ogre::MeshPtr& mesh,
 		{
 			for ( size_t k = 0; k < numTris*3; ++k)
 			{
-				indices[index_offset++] = pLong[k] + static_cast<unsigned long>(offset);
+				indices[index_offset++] = static_cast<unsigned long>(pLong[k]) + static_cast<unsigned long>(offset);
 			}
 		}
 		else
@@ -24,14 +24,50 @@
 #define EMBEROGREMESHCOLLISIONDETECTOR_H
 
 #include <OgreSharedPtr.h>
+#include <OgreResource.h>
+#include <OgreMesh.h>
 #include "EmberEntityUserObject.h"
 #include "ICollisionDetector.h"
 
+#include <memory>
+#include <unordered_map>
+
 namespace Ember {
 namespace OgreView {
 
+class TriangleBVH;
+
+/**
+ * @brief Holds the triangles of a mesh, in a bounding volume hierarchy suitable for picking.
+ *
+ * The triangles are in the local space of the mesh, so the same instance can be shared by all entities using the mesh.
+ * The hierarchy is built the first time it's requested, and discarded whenever the mesh is unloaded (which happens when it's reloaded).
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class MeshCollisionData : public Ogre::Resource::Listener
+{
+public:
+	explicit MeshCollisionData(Ogre::MeshPtr mesh);
+
+	~MeshCollisionData() override;
+
+	/**
+	 * @brief Gets the bounding volume hierarchy, building it if needed.
+	 * @return The hierarchy, or null if the mesh isn't loaded.
+	 */
+	const TriangleBVH* getBVH();
+
+	void unloadingComplete(Ogre::Resource*) override;
+
+private:
+	Ogre::MeshPtr mMesh;
+
+	std::unique_ptr<TriangleBVH> mBVH;
+};
+
 /**
-	Uses a brute force approach to checking for intersection by iterating through all vertices to see which intersects the ray.
+	Checks for intersection with the triangles of the meshes of the model.
+	The triangles of each mesh are cached in a bounding volume hierarchy, shared between all models, and the ray is transformed into the local space of the model rather than the other way around.
 	@author Erik Ogenvik <erik@ogenvik.org>
 */
 class MeshCollisionDetector : public ICollisionDetector
@@ -52,25 +88,31 @@ public:
 
 	bool getVisualize() const override;
 
-protected:
-	Model::Model* mModel;
-	void getMeshInformation(const Ogre::MeshPtr& mesh,
-                                size_t &vertex_count,
-                                std::vector<Ogre::Vector3> &vertices,
-                                size_t &index_count,
-                                std::vector<unsigned long> &indices,
-                                const Ogre::Vector3 &position,
-                                const Ogre::Quaternion &orient,
-                                const Ogre::Vector3 &scale);
+	/**
+	 * @brief Gets the collision data for a mesh.
+	 * If there already is data for the mesh it will be shared.
+	 * @param mesh The mesh.
+	 * @return The collision data for the mesh.
+	 */
+	static std::shared_ptr<MeshCollisionData> getCollisionData(const Ogre::MeshPtr& mesh);
 
 	/**
-	 * We keep preallocated vectors of vertices and indices to avoid allocating new memory each time.
+	 * @brief Reads the vertices and indices of a mesh, in the local space of the mesh.
+	 * @param mesh The mesh.
+	 * @param vertices The vertices will be put here.
+	 * @param indices The indices will be put here, with three for each triangle.
 	 */
-	std::vector<Ogre::Vector3> mVertices;
+	static void getMeshInformation(const Ogre::MeshPtr& mesh,
+                                std::vector<Ogre::Vector3> &vertices,
+                                std::vector<unsigned long> &indices);
+
+protected:
+	Model::Model* mModel;
+
 	/**
-	 * We keep preallocated vectors of vertices and indices to avoid allocating new memory each time.
+	 * @brief The collision data for the meshes of the model, looked up as they are first picked.
 	 */
-	std::vector<unsigned long> mIndices;
+	std::unordered_map<const Ogre::Mesh*, std::shared_ptr<MeshCollisionData>> mCollisionData;
 };
 
 }
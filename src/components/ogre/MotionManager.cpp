@@ -30,34 +30,174 @@ template<> Ember::OgreView::MotionManager* Ember::Singleton<Ember::OgreView::Mot
 namespace Ember {
 namespace OgreView {
 
+namespace
+{
+/**
+ * @brief Movements shorter than this (squared) aren't worth updating the scene for.
+ */
+const float MIN_MOVEMENT_SQUARED = 0.0001f * 0.0001f;
+}
 
-MotionManager::MotionManager()
+void MotionManager::PredictedMotionStore::add(IMovable* movable, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity)
 {
-	mInfo.MovingEntities = mMotionSet.size();
-	mInfo.AnimatedEntities = mAnimatedEntities.size();
+	size_t index;
+	auto I = indices.find(movable);
+	if (I != indices.end()) {
+		index = I->second;
+	} else {
+		index = movables.size();
+		indices.emplace(movable, index);
+		movables.push_back(movable);
+		positionX.push_back(0);
+		positionY.push_back(0);
+		positionZ.push_back(0);
+		velocityX.push_back(0);
+		velocityY.push_back(0);
+		velocityZ.push_back(0);
+		writtenX.push_back(0);
+		writtenY.push_back(0);
+		writtenZ.push_back(0);
+		orientations.emplace_back();
+		changed.push_back(0);
+	}
+	//The movable is expected to already be at the position.
+	positionX[index] = writtenX[index] = position.x();
+	positionY[index] = writtenY[index] = position.y();
+	positionZ[index] = writtenZ[index] = position.z();
+	velocityX[index] = velocity.x();
+	velocityY[index] = velocity.y();
+	velocityZ[index] = velocity.z();
+	orientations[index] = orientation;
 }
 
+void MotionManager::PredictedMotionStore::remove(IMovable* movable)
+{
+	auto I = indices.find(movable);
+	if (I == indices.end()) {
+		return;
+	}
+	size_t index = I->second;
+	indices.erase(I);
+
+	size_t last = movables.size() - 1;
+	if (index != last) {
+		movables[index] = movables[last];
+		positionX[index] = positionX[last];
+		positionY[index] = positionY[last];
+		positionZ[index] = positionZ[last];
+		velocityX[index] = velocityX[last];
+		velocityY[index] = velocityY[last];
+		velocityZ[index] = velocityZ[last];
+		writtenX[index] = writtenX[last];
+		writtenY[index] = writtenY[last];
+		writtenZ[index] = writtenZ[last];
+		orientations[index] = orientations[last];
+		changed[index] = changed[last];
+		indices[movables[index]] = index;
+	}
+	movables.pop_back();
+	positionX.pop_back();
+	positionY.pop_back();
+	positionZ.pop_back();
+	velocityX.pop_back();
+	velocityY.pop_back();
+	velocityZ.pop_back();
+	writtenX.pop_back();
+	writtenY.pop_back();
+	writtenZ.pop_back();
+	orientations.pop_back();
+	changed.pop_back();
+}
+
+size_t MotionManager::PredictedMotionStore::size() const
+{
+	return movables.size();
+}
+
+MotionManager::MotionManager()
+{
+	mInfo.MovablesUpdated = 0;
+	mInfo.AnimationsUpdated = 0;
+	updateInfo();
+}
 
 MotionManager::~MotionManager()
 {}
 
+void MotionManager::updateInfo()
+{
+	mInfo.MovingEntities = mMotionSet.size() + mPredictedMotions.size();
+	mInfo.PredictedEntities = mPredictedMotions.size();
+	mInfo.AnimatedEntities = mAnimatedEntities.animatables.size();
+}
 
 void MotionManager::doMotionUpdate(Ogre::Real timeSlice)
 {
 	for (MovableStore::const_iterator I = mMotionSet.begin(); I != mMotionSet.end(); ++I) {
 		(*I)->updateMotion(timeSlice);
 	}
+	mInfo.MovablesUpdated += mMotionSet.size();
+}
+
+void MotionManager::doPredictedMotionUpdate(Ogre::Real timeSlice)
+{
+	PredictedMotionStore& store = mPredictedMotions;
+	const size_t count = store.size();
+
+	//Predict all positions in one pass over the arrays, without touching the movables. This is simple enough to be vectorised by the compiler.
+	float* positionX = store.positionX.data();
+	float* positionY = store.positionY.data();
+	float* positionZ = store.positionZ.data();
+	const float* velocityX = store.velocityX.data();
+	const float* velocityY = store.velocityY.data();
+	const float* velocityZ = store.velocityZ.data();
+	const float* writtenX = store.writtenX.data();
+	const float* writtenY = store.writtenY.data();
+	const float* writtenZ = store.writtenZ.data();
+	unsigned char* changed = store.changed.data();
+	for (size_t i = 0; i < count; ++i) {
+		positionX[i] += velocityX[i] * timeSlice;
+		positionY[i] += velocityY[i] * timeSlice;
+		positionZ[i] += velocityZ[i] * timeSlice;
+		float dx = positionX[i] - writtenX[i];
+		float dy = positionY[i] - writtenY[i];
+		float dz = positionZ[i] - writtenZ[i];
+		changed[i] = (dx * dx + dy * dy + dz * dz) > MIN_MOVEMENT_SQUARED;
+	}
+
+	//Then update the movables which have moved. The movables could remove themselves while being updated, so the size must be checked each time.
+	size_t i = 0;
+	while (i < store.size()) {
+		if (store.changed[i]) {
+			IMovable* movable = store.movables[i];
+			store.writtenX[i] = store.positionX[i];
+			store.writtenY[i] = store.positionY[i];
+			store.writtenZ[i] = store.positionZ[i];
+			movable->setPredictedMotion(WFMath::Point<3>(store.positionX[i], store.positionY[i], store.positionZ[i]), store.orientations[i],
+					WFMath::Vector<3>(store.velocityX[i], store.velocityY[i], store.velocityZ[i]));
+			mInfo.MovablesUpdated++;
+			//If the movable removed itself the last one was moved into its place, and must not be skipped.
+			if (i < store.size() && store.movables[i] != movable) {
+				continue;
+			}
+		}
+		++i;
+	}
 }
 
 void MotionManager::doAnimationUpdate(Ogre::Real timeSlice)
 {
-	for (AnimatedStore::const_iterator I = mAnimatedEntities.begin(); I != mAnimatedEntities.end(); ++I) {
-		I->second->updateAnimation(timeSlice);
+	auto& animatables = mAnimatedEntities.animatables;
+	for (size_t i = 0; i < animatables.size(); ++i) {
+		animatables[i]->updateAnimation(timeSlice);
 	}
+	mInfo.AnimationsUpdated = animatables.size();
 }
 
 bool MotionManager::frameStarted(const Ogre::FrameEvent& event)
 {
+	mInfo.MovablesUpdated = 0;
+	doPredictedMotionUpdate(event.timeSinceLastFrame);
 	doMotionUpdate(event.timeSinceLastFrame);
 	doAnimationUpdate(event.timeSinceLastFrame);
 	return true;
@@ -70,27 +210,58 @@ bool MotionManager::frameEnded(const Ogre::FrameEvent& event)
 
 void MotionManager::addMovable(IMovable* movable)
 {
+	mPredictedMotions.remove(movable);
 	mMotionSet.insert(movable);
-	mInfo.MovingEntities = mMotionSet.size();
+	updateInfo();
 	movable->updateMotion(0);
 }
 
+void MotionManager::addPredictedMovable(IMovable* movable, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity)
+{
+	mMotionSet.erase(movable);
+	mPredictedMotions.add(movable, position, orientation, velocity);
+	updateInfo();
+}
+
 void MotionManager::removeMovable(IMovable* movable)
 {
 	mMotionSet.erase(movable);
-	mInfo.MovingEntities = mMotionSet.size();
+	mPredictedMotions.remove(movable);
+	updateInfo();
 }
 
 void MotionManager::addAnimated(const std::string& id, IAnimated* animated)
 {
-	mAnimatedEntities[id] = animated;
-	mInfo.AnimatedEntities = mAnimatedEntities.size();
+	auto I = mAnimatedEntities.indices.find(id);
+	if (I != mAnimatedEntities.indices.end()) {
+		mAnimatedEntities.animatables[I->second] = animated;
+	} else {
+		mAnimatedEntities.indices.emplace(id, mAnimatedEntities.animatables.size());
+		mAnimatedEntities.animatables.push_back(animated);
+		mAnimatedEntities.ids.push_back(id);
+	}
+	updateInfo();
 }
 
 void MotionManager::removeAnimated(const std::string& id)
 {
-	mAnimatedEntities.erase(id);
-	mInfo.AnimatedEntities = mAnimatedEntities.size();
+	auto I = mAnimatedEntities.indices.find(id);
+	if (I == mAnimatedEntities.indices.end()) {
+		return;
+	}
+	size_t index = I->second;
+	mAnimatedEntities.indices.erase(I);
+
+	//Move the last element into the place of the removed one.
+	size_t last = mAnimatedEntities.animatables.size() - 1;
+	if (index != last) {
+		mAnimatedEntities.animatables[index] = mAnimatedEntities.animatables[last];
+		mAnimatedEntities.ids[index] = std::move(mAnimatedEntities.ids[last]);
+		mAnimatedEntities.indices[mAnimatedEntities.ids[index]] = index;
+	}
+	mAnimatedEntities.animatables.pop_back();
+	mAnimatedEntities.ids.pop_back();
+	updateInfo();
 }
 
 }
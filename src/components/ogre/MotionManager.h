@@ -23,7 +23,12 @@
 #include "framework/Singleton.h"
 
 #include <OgreFrameListener.h>
+#include <wfmath/point.h>
+#include <wfmath/vector.h>
+#include <wfmath/quaternion.h>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 namespace Ember {
 class EmberEntity;
@@ -36,6 +41,10 @@ class IMovable;
  * @brief Responsible for making sure that movement and animation within the graphical system is managed and synchronized.
  *
  * The main task of the manager is to keep track of all movables and animatables, i.e. implementations of IMovable and IAnimated, and make sure that these are asked to update their movement or animation when needed (usually each frame).
+ *
+ * Since there can be thousands of moving entities the movables which just follow the movement of their entities are handled in bulk.
+ * Their motion state is kept in contiguous arrays, one for each component, and their positions are predicted in one pass each frame.
+ * Only those movables whose positions actually changed are then told about it.
  */
 class MotionManager : public Ogre::FrameListener, public Singleton<MotionManager> {
 public:
@@ -47,6 +56,21 @@ public:
 	{
 		size_t AnimatedEntities;
 		size_t MovingEntities;
+
+		/**
+		 * @brief The number of moving entities whose positions are predicted by the manager.
+		 */
+		size_t PredictedEntities;
+
+		/**
+		 * @brief The number of movables updated in the last frame.
+		 */
+		size_t MovablesUpdated;
+
+		/**
+		 * @brief The number of animatables updated in the last frame.
+		 */
+		size_t AnimationsUpdated;
 	};
 
 	/**
@@ -67,6 +91,18 @@ public:
 	 */
 	void addMovable(IMovable* movable);
 
+	/**
+	 * @brief Adds a movable whose position should be predicted by the manager.
+	 *
+	 * The position will be moved along the velocity each frame, and whenever it changes IMovable::setPredictedMotion will be called.
+	 * Calling this again for the same movable replaces its motion state, which should be done whenever new movement data is received.
+	 * @param movable The movable instance.
+	 * @param position The current position.
+	 * @param orientation The orientation.
+	 * @param velocity The velocity, in units per second.
+	 */
+	void addPredictedMovable(IMovable* movable, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity);
+
 	/**
 	 * @brief Removes a movable from the movement list.
 	 * @param movable The movable instance to add to the movable list.
@@ -108,14 +144,54 @@ private:
 
 	/**
 	 * @brief A store of animatables, identified by a string.
+	 *
+	 * The animatables are kept in a contiguous array, with a lookup of their indices from their ids.
 	 */
-	typedef std::unordered_map<std::string , IAnimated*> AnimatedStore;
+	struct AnimatedStore
+	{
+		std::vector<IAnimated*> animatables;
+		std::vector<std::string> ids;
+		std::unordered_map<std::string, size_t> indices;
+	};
 
 	/**
 	 * @brief A store of movables.
 	 */
 	typedef std::set<IMovable*> MovableStore;
 
+	/**
+	 * @brief The motion state of all movables with predicted positions, stored as one array per component.
+	 *
+	 * Elements are removed by moving the last element into their place.
+	 */
+	struct PredictedMotionStore
+	{
+		std::vector<IMovable*> movables;
+		std::vector<float> positionX, positionY, positionZ;
+		std::vector<float> velocityX, velocityY, velocityZ;
+
+		/**
+		 * @brief The positions last sent to the movables.
+		 */
+		std::vector<float> writtenX, writtenY, writtenZ;
+
+		/**
+		 * @brief Orientations aren't predicted, but are needed when the movables are updated.
+		 */
+		std::vector<WFMath::Quaternion> orientations;
+
+		/**
+		 * @brief Set during the prediction pass for each element which needs to be updated.
+		 */
+		std::vector<unsigned char> changed;
+
+		std::unordered_map<IMovable*, size_t> indices;
+
+		void add(IMovable* movable, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity);
+		void remove(IMovable* movable);
+		size_t size() const;
+	};
+
 
 	/**
 	 * @brief Information about this manager.
@@ -127,6 +203,11 @@ private:
 	 */
 	MovableStore mMotionSet;
 
+	/**
+	 * @brief Contains all of the entities whose movement is predicted.
+	 */
+	PredictedMotionStore mPredictedMotions;
+
 	/**
 	 * @brief Contains all of the entities that will be animated each frame.
 	 */
@@ -138,6 +219,13 @@ private:
 	 */
 	void doMotionUpdate(Ogre::Real timeSlice);
 
+	/**
+	 * @brief Predicts the positions of all movables in mPredictedMotions, and updates those that changed.
+	 */
+	void doPredictedMotionUpdate(Ogre::Real timeSlice);
+
+	void updateInfo();
+
 	/**
 	 * @brief Will iterate over all registered animatables and update those that are enabled.
 	 */
@@ -169,10 +169,8 @@ MovementController::~MovementController()
 void MovementController::tileRebuild()
 {
 	if (mAwareness) {
-		size_t dirtyTiles = mAwareness->rebuildDirtyTile();
-		if (dirtyTiles) {
-			mAvatar.getEmberEntity().getView()->getEventService().runOnMainThread([this] {this->tileRebuild();}, mActiveMarker);
-		}
+		//The awareness will keep on rebuilding tiles in the background until all dirty tiles are done.
+		mAwareness->rebuildDirtyTiles();
 	}
 }
 
@@ -262,6 +260,7 @@ void MovementController::stopSteering()
 		if (mAwareness->needsPruning()) {
 			schedulePruning();
 		}
+		EventSteeringPathUpdated.emit(std::list<WFMath::Point<3>>());
 	}
 }
 
@@ -353,6 +352,7 @@ void MovementController::Steering_PathUpdated()
 	if (mVisualizePath) {
 		mAwarenessVisualizer->visualizePath(mSteering->getPath());
 	}
+	EventSteeringPathUpdated.emit(mSteering->getPath());
 }
 
 
@@ -32,8 +32,11 @@
 #include <Eris/ActiveMarker.h>
 
 #include <wfmath/vector.h>
+#include <wfmath/point.h>
 #include <sigc++/trackable.h>
 
+#include <list>
+
 
 namespace Ember {
 class EmberEntity;
@@ -116,6 +119,12 @@ public:
 	*/
 	sigc::signal<void, MovementControllerMode::Mode> EventMovementModeChanged;
 
+	/**
+	 * @brief Emitted when the path along which the avatar is steered has changed.
+	 * The argument is the waypoints, in view coords, with the next one first. It's empty when steering is stopped.
+	 */
+	sigc::signal<void, const std::list<WFMath::Point<3>>&> EventSteeringPathUpdated;
+
 	/**
 	 *    Gets the current movement for this frame.
 	 * @return
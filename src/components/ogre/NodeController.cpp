@@ -27,6 +27,19 @@ namespace Ember
 namespace OgreView
 {
 
+namespace
+{
+void getPredictedMotion(const EmberEntity& entity, WFMath::Point<3>& position, WFMath::Quaternion& orientation, WFMath::Vector<3>& velocity)
+{
+	const WFMath::Point<3>& pos = entity.getPredictedPos();
+	const WFMath::Quaternion& predictedOrientation = entity.getPredictedOrientation() * WFMath::Quaternion(2, WFMath::numeric_constants<float>::pi() / 2);
+	const WFMath::Vector<3>& predictedVelocity = entity.getPredictedVelocity();
+	position = pos.isValid() ? pos : WFMath::Point<3>::ZERO();
+	orientation = predictedOrientation.isValid() ? predictedOrientation : WFMath::Quaternion::IDENTITY();
+	velocity = predictedVelocity.isValid() ? predictedVelocity : WFMath::Vector<3>::ZERO();
+}
+}
+
 NodeController::NodeController(NodeAttachment& attachment) :
 	mAttachment(attachment)
 {
@@ -53,7 +66,7 @@ void NodeController::movementUpdate()
 	updatePosition();
 	MotionManager& motionManager = MotionManager::getSingleton();
 	if (mAttachment.getAttachedEntity().isMoving()) {
-		motionManager.addMovable(this);
+		registerMotion(motionManager);
 	} else {
 		motionManager.removeMovable(this);
 	}
@@ -64,12 +77,27 @@ void NodeController::updateMotion(float timeSlice)
 	updatePosition();
 }
 
+void NodeController::setPredictedMotion(const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity)
+{
+	mAttachment.setPosition(position, orientation, velocity);
+}
+
+void NodeController::registerMotion(MotionManager& motionManager)
+{
+	WFMath::Point<3> position;
+	WFMath::Quaternion orientation;
+	WFMath::Vector<3> velocity;
+	getPredictedMotion(mAttachment.getAttachedEntity(), position, orientation, velocity);
+	motionManager.addPredictedMovable(this, position, orientation, velocity);
+}
+
 void NodeController::updatePosition()
 {
-	const WFMath::Point<3>& pos = mAttachment.getAttachedEntity().getPredictedPos();
-	const WFMath::Quaternion& orientation = mAttachment.getAttachedEntity().getPredictedOrientation() * WFMath::Quaternion(2, WFMath::numeric_constants<float>::pi() / 2);
-	const WFMath::Vector<3>& velocity = mAttachment.getAttachedEntity().getPredictedVelocity();
-	mAttachment.setPosition(pos.isValid() ? pos : WFMath::Point<3>::ZERO(), orientation.isValid() ? orientation : WFMath::Quaternion::IDENTITY(), velocity.isValid() ? velocity : WFMath::Vector<3>::ZERO());
+	WFMath::Point<3> position;
+	WFMath::Quaternion orientation;
+	WFMath::Vector<3> velocity;
+	getPredictedMotion(mAttachment.getAttachedEntity(), position, orientation, velocity);
+	mAttachment.setPosition(position, orientation, velocity);
 }
 
 IEntityControlDelegate* NodeController::getControlDelegate() const
@@ -30,6 +30,7 @@ namespace OgreView
 {
 
 class NodeAttachment;
+class MotionManager;
 
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
@@ -55,6 +56,8 @@ public:
 
 	virtual void updateMotion(float timeSlice);
 
+	void setPredictedMotion(const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::Vector<3>& velocity) override;
+
 	void forceMovementUpdate();
 
 	virtual IEntityControlDelegate* getControlDelegate() const;
@@ -67,6 +70,13 @@ protected:
 	void entity_Moved();
 	virtual void updatePosition();
 
+	/**
+	 * @brief Registers with the MotionManager, when the entity is moving.
+	 *
+	 * By default the movement is predicted by the MotionManager, from the movement of the entity.
+	 */
+	virtual void registerMotion(MotionManager& motionManager);
+
 };
 
 }
@@ -31,6 +31,7 @@
 #include "services/config/ConfigService.h"
 #include "model/ModelDefinitionManager.h"
 #include "sound/XMLSoundDefParser.h"
+#include "ResourcePreloader.h"
 
 #include "EmberOgreFileSystem.h"
 
@@ -208,6 +209,11 @@ void OgreResourceLoader::preloadMedia() {
 	const char* resourceGroup[] = {"General", "Data"};
 
 	for (auto& group : resourceGroup) {
+		//If possible, let the preloader do the work over a number of frames, so that the main loop isn't stalled.
+		if (ResourcePreloader::hasInstance()) {
+			ResourcePreloader::getSingleton().preloadGroup(group);
+			continue;
+		}
 		try {
 			Ogre::ResourceGroupManager::getSingleton().loadResourceGroup(group);
 		} catch (const std::exception& ex) {
@@ -233,6 +239,15 @@ void OgreResourceLoader::observeDirectory(const std::string& path) {
 		auto& ev = event.ev;
 		S_LOG_VERBOSE("Resource changed " << ev.path.string() << " " << ev.type_cstr());
 
+		//The archives must know about the change before any resources are reloaded.
+		auto archiveI = Ogre::ArchiveManager::getSingleton().getArchiveIterator();
+		while (archiveI.hasMoreElements()) {
+			auto archive = dynamic_cast<FileSystemArchive*>(archiveI.getNext());
+			if (archive) {
+				archive->pathChanged(ev.path.string());
+			}
+		}
+
 		if (ev.type == boost::asio::dir_monitor_event::modified) {
 			try {
 				if (boost::filesystem::file_size(ev.path) == 0) {
@@ -0,0 +1,275 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ResourcePreloader.h"
+
+#include "framework/LoggingInstance.h"
+#include "framework/TimeFrame.h"
+
+#include <OgreMaterialManager.h>
+#include <OgreMeshManager.h>
+#include <OgreTextureManager.h>
+#include <OgreTechnique.h>
+#include <OgreResourceGroupManager.h>
+
+#include <algorithm>
+#include <set>
+
+template<> Ember::OgreView::ResourcePreloader* Ember::Singleton<Ember::OgreView::ResourcePreloader>::ms_Singleton = nullptr;
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace
+{
+/**
+ * @brief The maximum number of background prepare requests in flight.
+ *
+ * Keeping this bounded means that requests for needed models won't have to wait behind the whole preload in the background queue.
+ */
+const size_t MAX_TICKETS = 16;
+
+/**
+ * @brief For how long statistics are collected after startStatistics() has been called.
+ */
+const boost::posix_time::seconds STATISTICS_DURATION(10);
+
+/**
+ * @brief A frame taking this much longer than desired counts as a hitch. This is the same threshold as used by the main loop.
+ */
+const float HITCH_FACTOR = 1.4f;
+}
+
+ResourcePreloader::ResourcePreloader(boost::posix_time::time_duration maxUploadTime) :
+		mMaxUploadTime(maxUploadTime),
+		mCreationTime(boost::posix_time::microsec_clock::local_time()),
+		mHasRenderedFrame(false),
+		mStatistics { false, boost::posix_time::ptime(), boost::posix_time::ptime(), 0, 0, boost::posix_time::time_duration() }
+{
+}
+
+ResourcePreloader::~ResourcePreloader()
+{
+	for (auto& entry : mTickets) {
+		Ogre::ResourceBackgroundQueue::getSingleton().abortRequest(entry.first);
+	}
+}
+
+void ResourcePreloader::addUpload(Priority priority, std::function<void()> upload, const void* owner)
+{
+	if (priority == PRIORITY_NEEDED) {
+		mNeededUploads.push_back(Upload { std::move(upload), owner });
+	} else {
+		mPreloadUploads.push_back(Upload { std::move(upload), owner });
+	}
+}
+
+void ResourcePreloader::cancelUploads(const void* owner)
+{
+	auto isOwned = [owner](const Upload& upload) {return upload.owner == owner;};
+	mNeededUploads.erase(std::remove_if(mNeededUploads.begin(), mNeededUploads.end(), isOwned), mNeededUploads.end());
+	mPreloadUploads.erase(std::remove_if(mPreloadUploads.begin(), mPreloadUploads.end(), isOwned), mPreloadUploads.end());
+}
+
+void ResourcePreloader::preloadGroup(const std::string& group)
+{
+#if OGRE_THREAD_SUPPORT
+	auto& resourceGroupManager = Ogre::ResourceGroupManager::getSingleton();
+
+	Ogre::StringVectorPtr meshNames = resourceGroupManager.findResourceNames(group, "*.mesh");
+	for (auto& meshName : *meshNames) {
+		mPendingPrepares.push_back(PrepareRequest { Ogre::MeshManager::getSingleton().getResourceType(), meshName, group });
+	}
+
+	//Textures aren't known to the resource group until the materials using them are loaded, so we need to find them through the materials.
+	std::set<std::string> textureNames;
+	Ogre::ResourceManager::ResourceMapIterator I = Ogre::MaterialManager::getSingleton().getResourceIterator();
+	while (I.hasMoreElements()) {
+		Ogre::MaterialPtr material = Ogre::static_pointer_cast<Ogre::Material>(I.getNext());
+		if (material->getGroup() != group || material->isLoaded()) {
+			continue;
+		}
+		for (auto* technique : material->getTechniques()) {
+			for (auto* pass : technique->getPasses()) {
+				for (auto* tus : pass->getTextureUnitStates()) {
+					for (unsigned int i = 0; i < tus->getNumFrames(); ++i) {
+						const auto& textureName = tus->getFrameTextureName(i);
+						if (!textureName.empty() && textureNames.insert(textureName).second) {
+							mPendingPrepares.push_back(PrepareRequest { Ogre::TextureManager::getSingleton().getResourceType(), textureName, group });
+						}
+					}
+				}
+			}
+		}
+		mPendingMaterials.push_back(material);
+	}
+
+	S_LOG_INFO("Preloading " << meshNames->size() << " meshes, " << textureNames.size() << " textures and " << mPendingMaterials.size() << " materials in group '" << group << "'.");
+	issuePrepares();
+#else
+	//Without threads there's nothing to gain by splitting up the work.
+	try {
+		Ogre::ResourceGroupManager::getSingleton().loadResourceGroup(group);
+	} catch (const std::exception& ex) {
+		S_LOG_FAILURE("An error occurred when preloading media." << ex);
+	}
+#endif
+}
+
+void ResourcePreloader::issuePrepares()
+{
+	auto& queue = Ogre::ResourceBackgroundQueue::getSingleton();
+	while (mTickets.size() < MAX_TICKETS && !mPendingPrepares.empty()) {
+		PrepareRequest request = std::move(mPendingPrepares.front());
+		mPendingPrepares.pop_front();
+		try {
+			Ogre::BackgroundProcessTicket ticket = queue.prepare(request.resourceType, request.name, request.group, false, nullptr, nullptr, this);
+			if (ticket) {
+				mTickets.emplace(ticket, std::move(request));
+			}
+		} catch (const std::exception& ex) {
+			S_LOG_WARNING("Could not prepare " << request.name << " in the background." << ex);
+		}
+	}
+
+	//Once everything has been prepared, the materials can be loaded. Since uploads of the same priority are done in order, they will be loaded after the textures.
+	if (mTickets.empty() && mPendingPrepares.empty() && !mPendingMaterials.empty()) {
+		for (auto& material : mPendingMaterials) {
+			addUpload(PRIORITY_PRELOAD, [material]() {
+				if (!material->isLoaded()) {
+					try {
+						material->load();
+					} catch (const std::exception& ex) {
+						S_LOG_WARNING("Error when preloading material " << material->getName() << "." << ex);
+					}
+				}
+			});
+		}
+		mPendingMaterials.clear();
+	}
+}
+
+void ResourcePreloader::operationCompleted(Ogre::BackgroundProcessTicket ticket, const Ogre::BackgroundProcessResult& result)
+{
+	auto I = mTickets.find(ticket);
+	if (I == mTickets.end()) {
+		return;
+	}
+	PrepareRequest request = std::move(I->second);
+	mTickets.erase(I);
+
+	if (result.error) {
+		S_LOG_WARNING("Could not prepare " << request.name << " in the background: " << result.message);
+	} else {
+		addUpload(PRIORITY_PRELOAD, [this, request]() {
+			loadResource(request);
+		});
+	}
+	issuePrepares();
+}
+
+void ResourcePreloader::loadResource(const PrepareRequest& request)
+{
+	Ogre::ResourceManager* manager = Ogre::ResourceGroupManager::getSingleton()._getResourceManager(request.resourceType);
+	Ogre::ResourcePtr resource = manager->getResourceByName(request.name, request.group);
+	if (resource && !resource->isLoaded()) {
+		try {
+			resource->load();
+		} catch (const std::exception& ex) {
+			S_LOG_WARNING("Error when preloading " << request.name << "." << ex);
+		}
+	}
+}
+
+void ResourcePreloader::processUploads(const TimeFrame& timeFrame, bool frameRendered)
+{
+	if (frameRendered) {
+		recordFrame(timeFrame);
+	}
+
+	if (mNeededUploads.empty() && mPreloadUploads.empty()) {
+		return;
+	}
+
+	//Never use more than the remaining time of the frame, but always do at least one upload so that loading always progresses.
+	TimeFrame uploadTimeFrame(std::min(mMaxUploadTime, timeFrame.getRemainingTime()));
+	do {
+		//Take the upload out of the queue before performing it, since it might queue more uploads.
+		auto& queue = mNeededUploads.empty() ? mPreloadUploads : mNeededUploads;
+		Upload upload = std::move(queue.front());
+		queue.pop_front();
+		upload.upload();
+	} while ((!mNeededUploads.empty() || !mPreloadUploads.empty()) && uploadTimeFrame.isTimeLeft());
+}
+
+void ResourcePreloader::startStatistics()
+{
+	mStatistics = Statistics { true, boost::posix_time::microsec_clock::local_time(), boost::posix_time::ptime(), 0, 0, boost::posix_time::time_duration() };
+}
+
+void ResourcePreloader::recordFrame(const TimeFrame& timeFrame)
+{
+	auto now = boost::posix_time::microsec_clock::local_time();
+	if (!mHasRenderedFrame) {
+		mHasRenderedFrame = true;
+		S_LOG_INFO("First frame rendered " << (now - mCreationTime).total_milliseconds() << " ms after resource setup started.");
+	}
+
+	if (!mStatistics.active) {
+		return;
+	}
+	if (mStatistics.frames == 0) {
+		S_LOG_INFO("First frame in world rendered " << (now - mStatistics.startTime).total_milliseconds() << " ms after entering the world.");
+	} else {
+		auto frameTime = now - mStatistics.lastFrameTime;
+		auto desiredFrameTime = timeFrame.getElapsedTime() + timeFrame.getRemainingTime();
+		if (frameTime.total_microseconds() > desiredFrameTime.total_microseconds() * HITCH_FACTOR) {
+			mStatistics.hitches++;
+		}
+		mStatistics.longestFrame = std::max(mStatistics.longestFrame, frameTime);
+	}
+	mStatistics.frames++;
+	mStatistics.lastFrameTime = now;
+
+	auto elapsed = now - mStatistics.startTime;
+	if (elapsed >= STATISTICS_DURATION) {
+		float seconds = elapsed.total_milliseconds() / 1000.0f;
+		S_LOG_INFO("World entry: " << mStatistics.frames << " frames in " << seconds << " s, " << (mStatistics.hitches / seconds) << " hitches per second, longest frame "
+				<< mStatistics.longestFrame.total_milliseconds() << " ms. " << getQueuedUploads() << " uploads and " << getPendingPrepares() << " prepares remaining.");
+		mStatistics.active = false;
+	}
+}
+
+size_t ResourcePreloader::getQueuedUploads() const
+{
+	return mNeededUploads.size() + mPreloadUploads.size();
+}
+
+size_t ResourcePreloader::getPendingPrepares() const
+{
+	return mTickets.size() + mPendingPrepares.size();
+}
+
+}
+}
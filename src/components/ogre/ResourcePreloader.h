@@ -0,0 +1,199 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_RESOURCEPRELOADER_H
+#define EMBEROGRE_RESOURCEPRELOADER_H
+
+#include "framework/Singleton.h"
+
+#include <OgreResourceBackgroundQueue.h>
+#include <OgreMaterial.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace Ember
+{
+class TimeFrame;
+namespace OgreView
+{
+
+/**
+ * @brief Loads resources without stalling the main loop.
+ *
+ * Loading an Ogre resource consists of two steps: preparing, where the data is read and decoded, and loading, where it's uploaded to the GPU.
+ * Only the latter has to happen in the main thread. This class keeps a queue of such main thread uploads, which is processed each frame under a time budget.
+ *
+ * Uploads have a priority. Uploads for models which are needed by entities in the world (see ModelBackgroundLoader) always go before uploads from preloading,
+ * so that preloading never delays what the entity factory is creating.
+ *
+ * Resource groups can be preloaded with preloadGroup(). All meshes in the group, as well as all textures used by materials in the group, are then prepared in
+ * background threads through the Ogre::ResourceBackgroundQueue. As they're prepared they are queued for upload. Lastly the materials themselves are loaded.
+ *
+ * Since the point of this is to keep the frame rate smooth while entering the world, it also keeps some statistics on how long it took until the first frame was
+ * rendered, and how many frames took too long, which are written to the log.
+ *
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class ResourcePreloader : public Singleton<ResourcePreloader>, public Ogre::ResourceBackgroundQueue::Listener
+{
+public:
+
+	enum Priority
+	{
+		/**
+		 * @brief The upload is needed for something about to be shown.
+		 */
+		PRIORITY_NEEDED,
+
+		/**
+		 * @brief The upload is speculative.
+		 */
+		PRIORITY_PRELOAD
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param maxUploadTime The maximum time to spend on uploads each frame. At least one upload is always performed each frame, if there's any.
+	 */
+	explicit ResourcePreloader(boost::posix_time::time_duration maxUploadTime);
+
+	~ResourcePreloader() override;
+
+	/**
+	 * @brief Queues an upload to be performed in the main thread.
+	 * @param priority The priority.
+	 * @param upload The upload.
+	 * @param owner An optional owner, which allows the upload to be cancelled through cancelUploads().
+	 */
+	void addUpload(Priority priority, std::function<void()> upload, const void* owner = nullptr);
+
+	/**
+	 * @brief Cancels all queued uploads for the owner.
+	 * @param owner The owner.
+	 */
+	void cancelUploads(const void* owner);
+
+	/**
+	 * @brief Starts preloading all meshes and materials in a resource group.
+	 * @param group The name of the group.
+	 */
+	void preloadGroup(const std::string& group);
+
+	/**
+	 * @brief Performs queued uploads.
+	 *
+	 * This should be called once each frame, after the frame has been rendered. It should also be called when no frame is rendered (such as when the window is minimised),
+	 * since anything loading resources depends on the uploads being performed.
+	 * @param timeFrame The time frame of the current frame.
+	 * @param frameRendered Whether a frame was rendered. Only rendered frames are included in the frame statistics.
+	 */
+	void processUploads(const TimeFrame& timeFrame, bool frameRendered = true);
+
+	/**
+	 * @brief Starts collecting statistics on the frame times.
+	 *
+	 * This should be called when the world is entered. The statistics are written to the log once the world has been shown for a while.
+	 */
+	void startStatistics();
+
+	/**
+	 * @brief Gets the number of uploads queued.
+	 */
+	size_t getQueuedUploads() const;
+
+	/**
+	 * @brief Gets the number of resources being prepared or waiting to be prepared.
+	 */
+	size_t getPendingPrepares() const;
+
+	void operationCompleted(Ogre::BackgroundProcessTicket ticket, const Ogre::BackgroundProcessResult& result) override;
+
+private:
+
+	struct Upload
+	{
+		std::function<void()> upload;
+		const void* owner;
+	};
+
+	/**
+	 * @brief A resource to be prepared in the background.
+	 */
+	struct PrepareRequest
+	{
+		std::string resourceType;
+		std::string name;
+		std::string group;
+	};
+
+	/**
+	 * @brief Frame statistics, collected after startStatistics() has been called.
+	 */
+	struct Statistics
+	{
+		bool active;
+		boost::posix_time::ptime startTime;
+		boost::posix_time::ptime lastFrameTime;
+		size_t frames;
+		size_t hitches;
+		boost::posix_time::time_duration longestFrame;
+	};
+
+	boost::posix_time::time_duration mMaxUploadTime;
+
+	std::deque<Upload> mNeededUploads;
+	std::deque<Upload> mPreloadUploads;
+
+	std::deque<PrepareRequest> mPendingPrepares;
+	std::map<Ogre::BackgroundProcessTicket, PrepareRequest> mTickets;
+
+	/**
+	 * @brief Materials which will be loaded once all meshes and textures have been prepared.
+	 */
+	std::deque<Ogre::MaterialPtr> mPendingMaterials;
+
+	/**
+	 * @brief The time when this instance was created, used to measure the time until the first frame.
+	 */
+	boost::posix_time::ptime mCreationTime;
+	bool mHasRenderedFrame;
+
+	Statistics mStatistics;
+
+	/**
+	 * @brief Issues background prepare requests, keeping the number in flight bounded.
+	 */
+	void issuePrepares();
+
+	/**
+	 * @brief Loads a prepared resource, if it isn't already loaded.
+	 */
+	void loadResource(const PrepareRequest& request);
+
+	void recordFrame(const TimeFrame& timeFrame);
+};
+
+}
+}
+
+#endif
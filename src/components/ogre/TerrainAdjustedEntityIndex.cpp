@@ -0,0 +1,191 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TerrainAdjustedEntityIndex.h"
+
+#include <Eris/Entity.h>
+
+#include <wfmath/vector.h>
+
+#include <sigc++/bind.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace
+{
+/**
+ * @brief The size of one side of a cell in the index; the same as a terrain segment.
+ */
+const float CellSize = 64;
+}
+
+TerrainAdjustedEntityIndex::TerrainAdjustedEntityIndex() :
+		mTopLevel(nullptr), mGrid(CellSize)
+{
+}
+
+TerrainAdjustedEntityIndex::~TerrainAdjustedEntityIndex()
+{
+	for (auto& observed : mObservedEntities) {
+		observed.second.moved.disconnect();
+		observed.second.locationChanged.disconnect();
+		observed.second.beingDeleted.disconnect();
+		observed.second.bboxChanged.disconnect();
+	}
+}
+
+void TerrainAdjustedEntityIndex::setTopLevel(Eris::Entity* topLevel)
+{
+	mTopLevel = topLevel;
+	mGrid.clear();
+	if (topLevel) {
+		observeRecursive(*topLevel);
+	}
+}
+
+void TerrainAdjustedEntityIndex::addEntity(Eris::Entity* entity)
+{
+	observe(*entity);
+}
+
+void TerrainAdjustedEntityIndex::query(const std::vector<WFMath::AxisBox<2>>& areas, std::vector<Eris::Entity*>& entities) const
+{
+	size_t start = entities.size();
+	for (auto& area : areas) {
+		if (area.isValid()) {
+			mGrid.query(area, entities);
+		}
+	}
+	if (areas.size() > 1) {
+		std::sort(entities.begin() + start, entities.end());
+		entities.erase(std::unique(entities.begin() + start, entities.end()), entities.end());
+	}
+}
+
+size_t TerrainAdjustedEntityIndex::size() const
+{
+	return mGrid.size();
+}
+
+WFMath::AxisBox<2> TerrainAdjustedEntityIndex::getFootprint(const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::AxisBox<3>& bbox)
+{
+	WFMath::Point<2> position2d(position.x(), position.y());
+	if (!bbox.isValid()) {
+		return WFMath::AxisBox<2>(position2d, position2d);
+	}
+
+	double theta = 0;
+	if (orientation.isValid()) {
+		WFMath::Vector<3> xVec = WFMath::Vector<3>(1.0, 0.0, 0.0).rotate(orientation);
+		theta = std::atan2(xVec.y(), xVec.x()); // rotation about Z
+	}
+	double cosTheta = std::cos(theta);
+	double sinTheta = std::sin(theta);
+
+	const WFMath::Point<3>& low = bbox.lowCorner();
+	const WFMath::Point<3>& high = bbox.highCorner();
+	double corners[4][2] = { { low.x(), low.y() }, { high.x(), low.y() }, { high.x(), high.y() }, { low.x(), high.y() } };
+
+	double xMin = 0, xMax = 0, yMin = 0, yMax = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		double x = corners[i][0] * cosTheta - corners[i][1] * sinTheta;
+		double y = corners[i][0] * sinTheta + corners[i][1] * cosTheta;
+		if (i == 0) {
+			xMin = xMax = x;
+			yMin = yMax = y;
+		} else {
+			xMin = std::min(xMin, x);
+			xMax = std::max(xMax, x);
+			yMin = std::min(yMin, y);
+			yMax = std::max(yMax, y);
+		}
+	}
+	return WFMath::AxisBox<2>(WFMath::Point<2>(position.x() + xMin, position.y() + yMin), WFMath::Point<2>(position.x() + xMax, position.y() + yMax));
+}
+
+void TerrainAdjustedEntityIndex::observeRecursive(Eris::Entity& entity)
+{
+	observe(entity);
+	for (unsigned int i = 0; i < entity.numContained(); ++i) {
+		observeRecursive(*entity.getContained(i));
+	}
+}
+
+void TerrainAdjustedEntityIndex::observe(Eris::Entity& entity)
+{
+	auto result = mObservedEntities.insert(std::make_pair(&entity, EntityConnections()));
+	if (result.second) {
+		EntityConnections& connections = result.first->second;
+		connections.moved = entity.Moved.connect(sigc::bind(sigc::mem_fun(*this, &TerrainAdjustedEntityIndex::Entity_Moved), &entity));
+		connections.locationChanged = entity.LocationChanged.connect(sigc::bind(sigc::mem_fun(*this, &TerrainAdjustedEntityIndex::Entity_LocationChanged), &entity));
+		connections.beingDeleted = entity.BeingDeleted.connect(sigc::bind(sigc::mem_fun(*this, &TerrainAdjustedEntityIndex::Entity_BeingDeleted), &entity));
+		//The bbox isn't covered by the Moved signal, but changes the footprint just as much.
+		connections.bboxChanged = entity.observe("bbox", sigc::bind(sigc::mem_fun(*this, &TerrainAdjustedEntityIndex::Entity_BboxChanged), &entity));
+	}
+	updateEntity(entity);
+}
+
+void TerrainAdjustedEntityIndex::updateEntity(Eris::Entity& entity)
+{
+	//Only entities placed directly in the world are adjusted to the terrain; any contained entities follow their parents.
+	if (mTopLevel && entity.getLocation() == mTopLevel && entity.getPredictedPos().isValid()) {
+		mGrid.insert(&entity, getFootprint(entity.getPredictedPos(), entity.getOrientation(), entity.hasBBox() ? entity.getBBox() : WFMath::AxisBox<3>()));
+	} else {
+		mGrid.remove(&entity);
+	}
+}
+
+void TerrainAdjustedEntityIndex::Entity_Moved(Eris::Entity* entity)
+{
+	updateEntity(*entity);
+}
+
+void TerrainAdjustedEntityIndex::Entity_LocationChanged(Eris::Entity* oldLocation, Eris::Entity* entity)
+{
+	updateEntity(*entity);
+}
+
+void TerrainAdjustedEntityIndex::Entity_BboxChanged(const Atlas::Message::Element& bbox, Eris::Entity* entity)
+{
+	updateEntity(*entity);
+}
+
+void TerrainAdjustedEntityIndex::Entity_BeingDeleted(Eris::Entity* entity)
+{
+	mGrid.remove(entity);
+	auto I = mObservedEntities.find(entity);
+	if (I != mObservedEntities.end()) {
+		I->second.moved.disconnect();
+		I->second.locationChanged.disconnect();
+		I->second.beingDeleted.disconnect();
+		I->second.bboxChanged.disconnect();
+		mObservedEntities.erase(I);
+	}
+	if (entity == mTopLevel) {
+		mTopLevel = nullptr;
+	}
+}
+
+}
+}
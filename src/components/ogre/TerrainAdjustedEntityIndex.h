@@ -0,0 +1,151 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAINADJUSTEDENTITYINDEX_H_
+#define EMBEROGRE_TERRAINADJUSTEDENTITYINDEX_H_
+
+#include "components/navigation/SpatialGrid.h"
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+#include <wfmath/quaternion.h>
+
+#include <sigc++/connection.h>
+#include <sigc++/trackable.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace Atlas
+{
+namespace Message
+{
+class Element;
+}
+}
+
+namespace Eris
+{
+class Entity;
+}
+
+namespace Ember
+{
+namespace OgreView
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Keeps a 2d index of the footprints of the entities whose positions are adjusted to the terrain.
+ *
+ * These are the entities directly contained by the top level entity. Whenever the terrain is changed only the entities whose footprints
+ * intersect the changed areas need to be adjusted, rather than all entities in the world.
+ *
+ * Entities must be added through addEntity() as they are seen, after which the index is kept up to date by listening for them being moved, resized, relocated and deleted.
+ */
+class TerrainAdjustedEntityIndex : public virtual sigc::trackable
+{
+public:
+
+	TerrainAdjustedEntityIndex();
+
+	~TerrainAdjustedEntityIndex();
+
+	/**
+	 * @brief Sets the top level entity, i.e. the world, and starts listening to it and all entities it contains.
+	 * @param topLevel The top level entity, or null if there's none.
+	 */
+	void setTopLevel(Eris::Entity* topLevel);
+
+	/**
+	 * @brief Starts listening to an entity, indexing it if it's directly contained by the top level entity.
+	 * This should be called for every entity which is seen.
+	 * @param entity An entity.
+	 */
+	void addEntity(Eris::Entity* entity);
+
+	/**
+	 * @brief Finds the entities whose footprints intersect any of a number of areas.
+	 *
+	 * Each entity is only reported once, even if it intersects multiple areas.
+	 * @param areas Areas in world units.
+	 * @param entities Matching entities will be appended to this.
+	 */
+	void query(const std::vector<WFMath::AxisBox<2>>& areas, std::vector<Eris::Entity*>& entities) const;
+
+	/**
+	 * @brief Gets the number of indexed entities.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Calculates the 2d bounding box of an entity.
+	 * @param position The position of the entity.
+	 * @param orientation The orientation of the entity. If not valid it's ignored.
+	 * @param bbox The bounding box of the entity. If not valid the footprint is just the position.
+	 * @return The footprint.
+	 */
+	static WFMath::AxisBox<2> getFootprint(const WFMath::Point<3>& position, const WFMath::Quaternion& orientation, const WFMath::AxisBox<3>& bbox);
+
+private:
+
+	struct EntityConnections
+	{
+		sigc::connection moved;
+		sigc::connection locationChanged;
+		sigc::connection beingDeleted;
+		sigc::connection bboxChanged;
+	};
+
+	/**
+	 * @brief The top level entity. Only entities directly contained by it are indexed.
+	 */
+	Eris::Entity* mTopLevel;
+
+	Navigation::SpatialGrid<Eris::Entity*> mGrid;
+
+	/**
+	 * @brief All entities which are listened to, whether they are indexed or not.
+	 */
+	std::unordered_map<Eris::Entity*, EntityConnections> mObservedEntities;
+
+	/**
+	 * @brief Starts listening to an entity and all entities it contains.
+	 */
+	void observeRecursive(Eris::Entity& entity);
+
+	void observe(Eris::Entity& entity);
+
+	/**
+	 * @brief Adds, updates or removes the entity from the index, depending on where it is.
+	 */
+	void updateEntity(Eris::Entity& entity);
+
+	void Entity_Moved(Eris::Entity* entity);
+
+	void Entity_LocationChanged(Eris::Entity* oldLocation, Eris::Entity* entity);
+
+	void Entity_BboxChanged(const Atlas::Message::Element& bbox, Eris::Entity* entity);
+
+	void Entity_BeingDeleted(Eris::Entity* entity);
+};
+
+}
+}
+
+#endif /* EMBEROGRE_TERRAINADJUSTEDENTITYINDEX_H_ */
@@ -0,0 +1,254 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace
+{
+/**
+ * @brief Checks if the ray hits the box, using the slab method.
+ * @param node The box.
+ * @param origin The ray origin.
+ * @param inverseDirection The inverse of each component of the ray direction.
+ * @param maxDistance Hits beyond this distance are ignored.
+ * @param distance Set to the distance at which the ray enters the box.
+ * @return True if the ray hits the box.
+ */
+template<typename NodeT>
+inline bool intersectsBox(const NodeT& node, const Ogre::Vector3& origin, const Ogre::Vector3& inverseDirection, Ogre::Real maxDistance, Ogre::Real& distance)
+{
+	Ogre::Real tMin = 0;
+	Ogre::Real tMax = maxDistance;
+	for (int i = 0; i < 3; ++i) {
+		Ogre::Real t1 = (node.min[i] - origin[i]) * inverseDirection[i];
+		Ogre::Real t2 = (node.max[i] - origin[i]) * inverseDirection[i];
+		if (t1 > t2) {
+			std::swap(t1, t2);
+		}
+		tMin = std::max(tMin, t1);
+		tMax = std::min(tMax, t2);
+		if (tMin > tMax) {
+			return false;
+		}
+	}
+	distance = tMin;
+	return true;
+}
+}
+
+TriangleBVH::TriangleBVH(const std::vector<Ogre::Vector3>& vertices, const std::vector<unsigned long>& indices)
+{
+	size_t numberOfTriangles = indices.size() / 3;
+	if (numberOfTriangles == 0) {
+		return;
+	}
+
+	std::vector<Ogre::Vector3> triangles;
+	triangles.reserve(numberOfTriangles * 3);
+	std::vector<Ogre::Vector3> centroids;
+	centroids.reserve(numberOfTriangles);
+	for (size_t i = 0; i < numberOfTriangles * 3; i += 3) {
+		const Ogre::Vector3& a = vertices[indices[i]];
+		const Ogre::Vector3& b = vertices[indices[i + 1]];
+		const Ogre::Vector3& c = vertices[indices[i + 2]];
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+		centroids.push_back((a + b + c) / 3.0f);
+	}
+	mTriangles.swap(triangles);
+
+	std::vector<uint32_t> triangleIndices(numberOfTriangles);
+	for (uint32_t i = 0; i < numberOfTriangles; ++i) {
+		triangleIndices[i] = i;
+	}
+	mNodes.reserve((numberOfTriangles / MAX_LEAF_SIZE + 1) * 2);
+	build(triangleIndices, centroids, 0, static_cast<uint32_t>(numberOfTriangles));
+
+	//Store the triangles in leaf order, so that each leaf is contiguous.
+	triangles.resize(mTriangles.size());
+	for (size_t i = 0; i < numberOfTriangles; ++i) {
+		uint32_t index = triangleIndices[i];
+		triangles[i * 3] = mTriangles[index * 3];
+		triangles[i * 3 + 1] = mTriangles[index * 3 + 1];
+		triangles[i * 3 + 2] = mTriangles[index * 3 + 2];
+	}
+	mTriangles.swap(triangles);
+}
+
+void TriangleBVH::build(std::vector<uint32_t>& triangleIndices, const std::vector<Ogre::Vector3>& centroids, uint32_t start, uint32_t end)
+{
+	uint32_t nodeIndex = static_cast<uint32_t>(mNodes.size());
+	mNodes.emplace_back();
+
+	Ogre::Vector3 min(std::numeric_limits<Ogre::Real>::max());
+	Ogre::Vector3 max(-std::numeric_limits<Ogre::Real>::max());
+	Ogre::Vector3 centroidMin(min);
+	Ogre::Vector3 centroidMax(max);
+	for (uint32_t i = start; i < end; ++i) {
+		uint32_t index = triangleIndices[i];
+		for (uint32_t j = 0; j < 3; ++j) {
+			min.makeFloor(mTriangles[index * 3 + j]);
+			max.makeCeil(mTriangles[index * 3 + j]);
+		}
+		centroidMin.makeFloor(centroids[index]);
+		centroidMax.makeCeil(centroids[index]);
+	}
+	mNodes[nodeIndex].min = min;
+	mNodes[nodeIndex].max = max;
+
+	uint32_t count = end - start;
+	if (count <= MAX_LEAF_SIZE) {
+		mNodes[nodeIndex].offset = start;
+		mNodes[nodeIndex].count = count;
+		return;
+	}
+
+	//Split at the median of the centroids along the longest axis. This gives a balanced tree, which is good enough for picking.
+	Ogre::Vector3 extent = centroidMax - centroidMin;
+	int axis = 0;
+	if (extent.y > extent[axis]) {
+		axis = 1;
+	}
+	if (extent.z > extent[axis]) {
+		axis = 2;
+	}
+	uint32_t middle = start + count / 2;
+	std::nth_element(triangleIndices.begin() + start, triangleIndices.begin() + middle, triangleIndices.begin() + end, [&](uint32_t lhs, uint32_t rhs) {
+		return centroids[lhs][axis] < centroids[rhs][axis];
+	});
+
+	mNodes[nodeIndex].count = 0;
+	build(triangleIndices, centroids, start, middle);
+	mNodes[nodeIndex].offset = static_cast<uint32_t>(mNodes.size());
+	build(triangleIndices, centroids, middle, end);
+}
+
+bool TriangleBVH::intersect(const Ogre::Ray& ray, Ogre::Real& distance) const
+{
+	if (mNodes.empty()) {
+		return false;
+	}
+
+	const Ogre::Vector3& origin = ray.getOrigin();
+	const Ogre::Vector3& direction = ray.getDirection();
+	//Division by zero gives infinity, which the slab test handles.
+	Ogre::Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	Ogre::Real closest = std::numeric_limits<Ogre::Real>::max();
+	bool hit = false;
+
+	//Nodes to visit, along with the distance at which the ray enters them.
+	//The tree is balanced, so this is more than enough for any mesh that fits in memory.
+	std::pair<uint32_t, Ogre::Real> stack[64];
+	unsigned int stackSize = 0;
+	Ogre::Real rootDistance;
+	if (!intersectsBox(mNodes[0], origin, inverseDirection, closest, rootDistance)) {
+		return false;
+	}
+	stack[stackSize++] = std::make_pair(0, rootDistance);
+
+	while (stackSize) {
+		std::pair<uint32_t, Ogre::Real> entry = stack[--stackSize];
+		//The closest hit might have moved since the node was pushed.
+		if (entry.second > closest) {
+			continue;
+		}
+		uint32_t nodeIndex = entry.first;
+		const Node& node = mNodes[nodeIndex];
+		if (node.count) {
+			//Möller-Trumbore, culling back faces.
+			for (uint32_t i = node.offset * 3; i < (node.offset + node.count) * 3; i += 3) {
+				const Ogre::Vector3& a = mTriangles[i];
+				Ogre::Vector3 edge1 = mTriangles[i + 1] - a;
+				Ogre::Vector3 edge2 = mTriangles[i + 2] - a;
+				Ogre::Vector3 p = direction.crossProduct(edge2);
+				Ogre::Real determinant = edge1.dotProduct(p);
+				if (determinant <= 0) {
+					continue;
+				}
+				Ogre::Vector3 s = origin - a;
+				Ogre::Real u = s.dotProduct(p);
+				if (u < 0 || u > determinant) {
+					continue;
+				}
+				Ogre::Vector3 q = s.crossProduct(edge1);
+				Ogre::Real v = direction.dotProduct(q);
+				if (v < 0 || u + v > determinant) {
+					continue;
+				}
+				Ogre::Real t = edge2.dotProduct(q) / determinant;
+				if (t >= 0 && t < closest) {
+					closest = t;
+					hit = true;
+				}
+			}
+		} else {
+			//Visit the nearest child first, so that the farther one can be culled by the closest hit.
+			uint32_t left = nodeIndex + 1;
+			uint32_t right = node.offset;
+			Ogre::Real leftDistance, rightDistance;
+			bool hitsLeft = intersectsBox(mNodes[left], origin, inverseDirection, closest, leftDistance);
+			bool hitsRight = intersectsBox(mNodes[right], origin, inverseDirection, closest, rightDistance);
+			if (hitsLeft && hitsRight) {
+				if (leftDistance < rightDistance) {
+					stack[stackSize++] = std::make_pair(right, rightDistance);
+					stack[stackSize++] = std::make_pair(left, leftDistance);
+				} else {
+					stack[stackSize++] = std::make_pair(left, leftDistance);
+					stack[stackSize++] = std::make_pair(right, rightDistance);
+				}
+			} else if (hitsLeft) {
+				stack[stackSize++] = std::make_pair(left, leftDistance);
+			} else if (hitsRight) {
+				stack[stackSize++] = std::make_pair(right, rightDistance);
+			}
+		}
+	}
+
+	if (hit) {
+		distance = closest;
+	}
+	return hit;
+}
+
+size_t TriangleBVH::getNumberOfTriangles() const
+{
+	return mTriangles.size() / 3;
+}
+
+size_t TriangleBVH::getNumberOfNodes() const
+{
+	return mNodes.size();
+}
+
+}
+}
@@ -0,0 +1,115 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TRIANGLEBVH_H
+#define EMBEROGRE_TRIANGLEBVH_H
+
+#include <OgreVector3.h>
+#include <OgreRay.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+/**
+ * @brief A bounding volume hierarchy over a soup of triangles, used for fast ray picking.
+ *
+ * The triangles are copied and reordered so that the triangles of each leaf are stored contiguously. Nodes are stored depth first in a flat array, with the left child of a node always directly following it.
+ *
+ * Only the front faces of triangles are hit, i.e. those which are wound counter clockwise as seen from the ray origin. This matches the picking previously done through Ogre::Math::intersects().
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class TriangleBVH
+{
+public:
+
+	/**
+	 * @brief The max number of triangles in each leaf.
+	 */
+	static const unsigned int MAX_LEAF_SIZE = 4;
+
+	/**
+	 * @brief Ctor.
+	 * @param vertices The vertices.
+	 * @param indices Indices into the vertices, with three for each triangle.
+	 */
+	TriangleBVH(const std::vector<Ogre::Vector3>& vertices, const std::vector<unsigned long>& indices);
+
+	/**
+	 * @brief Finds the closest triangle hit by the ray.
+	 * @param ray The ray, in the same space as the vertices.
+	 * @param distance If a triangle was hit, this is set to the distance along the ray, in multiples of the ray direction.
+	 * @return True if any triangle was hit.
+	 */
+	bool intersect(const Ogre::Ray& ray, Ogre::Real& distance) const;
+
+	/**
+	 * @brief Gets the number of triangles.
+	 * @return The number of triangles.
+	 */
+	size_t getNumberOfTriangles() const;
+
+	/**
+	 * @brief Gets the number of nodes in the hierarchy.
+	 * @return The number of nodes.
+	 */
+	size_t getNumberOfNodes() const;
+
+private:
+
+	struct Node
+	{
+		Ogre::Vector3 min;
+		Ogre::Vector3 max;
+
+		/**
+		 * @brief For leaves, the first triangle. For inner nodes, the index of the right child.
+		 */
+		uint32_t offset;
+
+		/**
+		 * @brief The number of triangles in a leaf, or 0 for inner nodes.
+		 */
+		uint32_t count;
+	};
+
+	/**
+	 * @brief The corners of the triangles, with three entries per triangle.
+	 */
+	std::vector<Ogre::Vector3> mTriangles;
+
+	std::vector<Node> mNodes;
+
+	/**
+	 * @brief Recursively builds the node for the triangles in the range, in the order given by triangleIndices.
+	 * @param triangleIndices The triangles, which are reordered while building.
+	 * @param centroids The centroids of all triangles.
+	 * @param start The first triangle in triangleIndices.
+	 * @param end One past the last triangle in triangleIndices.
+	 */
+	void build(std::vector<uint32_t>& triangleIndices, const std::vector<Ogre::Vector3>& centroids, uint32_t start, uint32_t end);
+};
+
+}
+}
+
+#endif /* EMBEROGRE_TRIANGLEBVH_H */
@@ -20,6 +20,7 @@
 
 #include "Avatar.h"
 #include "MovementController.h"
+#include "Convert.h"
 #include "EmberEntityFactory.h"
 #include "MotionManager.h"
 #include "authoring/EntityMoveManager.h"
@@ -36,6 +37,7 @@
 #include "components/ogre/lod/LodLevelManager.h"
 
 #include "TerrainEntityManager.h"
+#include "TerrainAdjustedEntityIndex.h"
 #include "TerrainPageDataProvider.h"
 #include "terrain/TerrainManager.h"
 #include "terrain/TerrainHandler.h"
@@ -83,13 +85,19 @@ World::World(Eris::View& view, Ogre::RenderWindow& renderWindow, Ember::OgreView
 		mMotionManager(new MotionManager()), mAvatarCameraMotionHandler(0), mAvatarCameraWarper(nullptr),
 		mEntityWorldPickListener(0), mAuthoringManager(new Authoring::AuthoringManager(*this)),
 		mAuthoringMoverConnector(new Authoring::AuthoringMoverConnector(*mAuthoringManager, *mMoveManager)),
-		mTerrainEntityManager(0), mLodLevelManager(new Lod::LodLevelManager(graphicalChangeAdapter, mScene->getMainCamera())),
+		mTerrainEntityManager(0), mTerrainAdjustedEntityIndex(new TerrainAdjustedEntityIndex()), mLodLevelManager(new Lod::LodLevelManager(graphicalChangeAdapter, mScene->getMainCamera())),
 		mFoliage(0), mFoliageDetailManager(0), mFoliageInitializer(0), mEnvironment(0), mConfigListenerContainer(new ConfigListenerContainer()), mCalendar(new Eris::Calendar(view.getAvatar()))
 {
 	mAfterTerrainUpdateConnection = mTerrainManager->getHandler().EventAfterTerrainUpdate.connect(sigc::mem_fun(*this, &World::terrainManager_AfterTerrainUpdate));
 
 	mTerrainEntityManager = new TerrainEntityManager(view, mTerrainManager->getHandler(), mScene->getSceneManager());
 
+	//The connections are severed automatically when the index is destroyed.
+	view.EntitySeen.connect(sigc::mem_fun(*mTerrainAdjustedEntityIndex, &TerrainAdjustedEntityIndex::addEntity));
+	view.EntityCreated.connect(sigc::mem_fun(*mTerrainAdjustedEntityIndex, &TerrainAdjustedEntityIndex::addEntity));
+	view.TopLevelEntityChanged.connect(sigc::mem_fun(*this, &World::View_TopLevelEntityChanged));
+	mTerrainAdjustedEntityIndex->setTopLevel(view.getTopLevel());
+
 	mPageDataProvider = new TerrainPageDataProvider(mTerrainManager->getHandler());
 	mTerrainManager->getTerrainAdapter()->setPageDataProvider(mPageDataProvider);
 
@@ -128,6 +136,7 @@ World::~World()
 	delete mFoliageInitializer;
 	delete mConfigListenerContainer;
 	delete mTerrainEntityManager;
+	delete mTerrainAdjustedEntityIndex;
 	mSignals.EventTerrainManagerBeingDestroyed();
 	delete mTerrainManager;
 	mSignals.EventTerrainManagerDestroyed();
@@ -268,19 +277,38 @@ Eris::Calendar& World::getCalendar() const
 
 void World::terrainManager_AfterTerrainUpdate(const std::vector<WFMath::AxisBox<2>>& areas, const std::set<Terrain::TerrainPage*>& pages)
 {
-	EmberEntity* emberEntity = static_cast<EmberEntity*>(mView.getTopLevel());
-	if (emberEntity) {
-		updateEntityPosition(emberEntity, areas);
+	//Only the entities standing on the changed areas need to be adjusted.
+	std::vector<Eris::Entity*> entities;
+	mTerrainAdjustedEntityIndex->query(areas, entities);
+	for (auto entity : entities) {
+		updateEntityPosition(static_cast<EmberEntity*>(entity));
 	}
 }
 
-void World::updateEntityPosition(EmberEntity* entity, const std::vector<WFMath::AxisBox<2>>& areas)
+void World::View_TopLevelEntityChanged()
+{
+	mTerrainAdjustedEntityIndex->setTopLevel(mView.getTopLevel());
+}
+
+void World::updateEntityPosition(EmberEntity* entity)
 {
 	entity->adjustPosition();
 	for (unsigned int i = 0; i < entity->numContained(); ++i) {
 		EmberEntity* containedEntity = static_cast<EmberEntity*>(entity->getContained(i));
-		updateEntityPosition(containedEntity, areas);
+		updateEntityPosition(containedEntity);
+	}
+}
+
+void World::movementController_SteeringPathUpdated(const std::list<WFMath::Point<3>>& path)
+{
+	//Pages along the path the avatar is steered are likely to be needed soon.
+	std::vector<Ogre::Vector3> prefetchPath;
+	for (auto& point : path) {
+		if (point.isValid()) {
+			prefetchPath.push_back(Convert::toOgre(point));
+		}
 	}
+	mTerrainManager->getTerrainAdapter()->setPrefetchPath(prefetchPath);
 }
 
 void World::View_gotAvatarCharacter(Eris::Entity* entity)
@@ -292,6 +320,7 @@ void World::View_gotAvatarCharacter(Eris::Entity* entity)
 		mAvatarCameraMotionHandler = new AvatarCameraMotionHandler(*mAvatar);
 		mAvatar->getCameraMount().setMotionHandler(mAvatarCameraMotionHandler);
 		mMovementController = new MovementController(*mAvatar, *mMainCamera, *mTerrainManager);
+		mMovementController->EventSteeringPathUpdated.connect(sigc::mem_fun(*this, &World::movementController_SteeringPathUpdated));
 		mMainCamera->setMovementProvider(mMovementController);
 		mMainCamera->attachToMount(&mAvatar->getCameraMount());
 
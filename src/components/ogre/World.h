@@ -28,11 +28,14 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <list>
 
 namespace WFMath
 {
 template<int>
 class AxisBox;
+template<int>
+class Point;
 }
 
 namespace Eris
@@ -96,6 +99,7 @@ class LodLevelManager;
 
 class Avatar;
 class MovementController;
+class TerrainAdjustedEntityIndex;
 class EmberEntityFactory;
 class MotionManager;
 class Scene;
@@ -362,6 +366,11 @@ protected:
 
 	TerrainEntityManager* mTerrainEntityManager;
 
+	/**
+	 * @brief Keeps track of the entities which need to be adjusted when the terrain changes.
+	 */
+	TerrainAdjustedEntityIndex* mTerrainAdjustedEntityIndex;
+
 	/**
 	 * @brief The lod level manager, owned by this instance, used to adjust the level of detail of materials and meshes.
 	 */
@@ -429,6 +438,19 @@ protected:
 	 */
 	void View_gotAvatarCharacter(Eris::Entity* entity);
 
+	/**
+	 * @brief Sent from the view when the top level entity has changed.
+	 *
+	 * The index of entities adjusted to the terrain is then rebuilt.
+	 */
+	void View_TopLevelEntityChanged();
+
+	/**
+	 * @brief Passes the path along which the avatar is steered on to the terrain, so that pages along it can be prefetched.
+	 * @param path The waypoints, in view coords.
+	 */
+	void movementController_SteeringPathUpdated(const std::list<WFMath::Point<3>>& path);
+
 	/**
 	 * @brief Called when the avatar entity is being deleted.
 	 *
@@ -437,11 +459,10 @@ protected:
 	void avatarEntity_BeingDeleted();
 
 	/**
-	 * @brief Updates the position of the entity, and all it's children, as long as it's within the changed areas.
+	 * @brief Updates the position of the entity, and all it's children.
 	 * @param entity The entity to update.
-	 * @param areas The areas which have been updated.
 	 */
-	void updateEntityPosition(EmberEntity* entity, const std::vector<WFMath::AxisBox<2>>& areas);
+	void updateEntityPosition(EmberEntity* entity);
 
 	/**
 	 * @brief Listen to changes the "graphics:foliage" config element, and create or destroy the foliage accordingly.
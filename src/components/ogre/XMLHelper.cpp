@@ -25,7 +25,9 @@
 #endif
 
 #include "XMLHelper.h"
+#include "framework/XMLDocumentCache.h"
 #include <OgreVector3.h>
+#include <OgreResourceGroupManager.h>
 
 namespace Ember {
 namespace OgreView {
@@ -39,16 +41,37 @@ XMLHelper::~XMLHelper()
 {
 }
 
-bool XMLHelper::Load(TiXmlDocument& xmlDoc, Ogre::DataStreamPtr stream)
+bool XMLHelper::Load(TiXmlDocument& xmlDoc, Ogre::DataStreamPtr stream, const std::string& groupName)
 {
 	size_t length(stream->size());
 
 	if ( length )
 	{
+		XMLDocumentCache* cache = XMLDocumentCache::hasInstance() ? XMLDocumentCache::getSingletonPtr() : nullptr;
+		std::string cacheName;
+		time_t modifiedTime = 0;
+		if (cache) {
+			cacheName = groupName.empty() ? stream->getName() : groupName + ":" + stream->getName();
+			if (!groupName.empty()) {
+				try {
+					modifiedTime = Ogre::ResourceGroupManager::getSingleton().resourceModifiedTime(groupName, stream->getName());
+				} catch (const Ogre::Exception&) {
+					//Just use the slower check below.
+				}
+			}
+			if (modifiedTime && cache->load(xmlDoc, cacheName, modifiedTime, length)) {
+				return true;
+			}
+		}
+
 		// If we have a file, assume it is all one big XML file, and read it in.
 		// The document parser may decide the document ends sooner than the entire file, however.
 		std::string data(stream->getAsString());
 
+		if (cache && cache->load(xmlDoc, cacheName, modifiedTime, data)) {
+			return true;
+		}
+
 		xmlDoc.Parse( data.c_str());
 
 		if (xmlDoc.Error() ) {
@@ -60,6 +83,9 @@ bool XMLHelper::Load(TiXmlDocument& xmlDoc, Ogre::DataStreamPtr stream)
 			S_LOG_FAILURE(ss.str());
 			return false;
 		} else {
+			if (cache) {
+				cache->store(xmlDoc, cacheName, modifiedTime, data);
+			}
             return true;
 		}
 	}
@@ -52,11 +52,13 @@ public:
 
 	/**
 	 Attempts to load the supplied stream into the document. Failures will be logged.
+	 If an XMLDocumentCache instance exists, the document is loaded from it when possible, and stored in it otherwise.
 	 @param An empty xml document.
 	 @param An opened and valid data stream
+	 @param The resource group of the stream, if known. This allows the cache to be checked without reading the stream.
 	 @returns true if successful, else false
 	 */
-    bool Load(TiXmlDocument& xmlDoc, Ogre::DataStreamPtr stream);
+    bool Load(TiXmlDocument& xmlDoc, Ogre::DataStreamPtr stream, const std::string& groupName = "");
 
 	/**
 	 * @brief Utility method for filling an Ogre Vector3 with data from an xml element.
@@ -47,7 +47,7 @@ void XMLEntityRecipeSerializer::parseScript(Ogre::DataStreamPtr& stream, const O
 {
 	TiXmlDocument xmlDoc;
 	XMLHelper xmlHelper;
-	if (!xmlHelper.Load(xmlDoc, stream)) {
+	if (!xmlHelper.Load(xmlDoc, stream, groupName)) {
 		return;
 	}
 	TiXmlElement* rootElem = xmlDoc.RootElement();
@@ -0,0 +1,130 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+// Drives the CPU water simulation of the projected grid without any rendering.
+// For each complexity it measures a full simulation in the calling thread, the same
+// split across the worker threads, and how long the main thread is blocked each
+// frame when the simulation overlaps an emulated 4 ms render.
+
+#include "../src/Modules/ProjectedGrid/GridSimulation.h"
+#include "../src/Noise/Perlin/Perlin.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace Hydrax;
+
+namespace
+{
+	const int Frames = 100;
+
+	long long microseconds(std::chrono::steady_clock::duration Duration)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(Duration).count();
+	}
+
+	/** A grid seen from above the water, looking towards the horizon
+	 */
+	void getCorners(Ogre::Vector4 Corners[4])
+	{
+		Corners[0] = Ogre::Vector4(-100.0f, 0.0f,  100.0f, 1.0f);
+		Corners[1] = Ogre::Vector4( 100.0f, 0.0f,  100.0f, 1.0f);
+		Corners[2] = Ogre::Vector4(-0.5f,   0.0f, -0.5f,    0.001f);
+		Corners[3] = Ogre::Vector4( 0.5f,   0.0f, -0.5f,    0.001f);
+	}
+
+	/** Time a full simulation of each frame, as when the camera moves
+	 */
+	long long timeGeometry(Noise::Noise &n, Module::GridSimulation &Simulation, const Module::GridSimulation::FrameState &State)
+	{
+		Ogre::Vector4 Corners[4];
+		getCorners(Corners);
+
+		auto Start = std::chrono::steady_clock::now();
+		for (int k = 0; k < Frames; k++)
+		{
+			n.update(0.016f);
+			Simulation.calculeGeometry(&n, Corners, State);
+		}
+		return microseconds(std::chrono::steady_clock::now() - Start) / Frames;
+	}
+
+	/** Time how long the main thread is blocked when the simulation overlaps rendering
+	 */
+	long long timeOverlapped(Noise::Noise &n, Module::GridSimulation &Simulation, const Module::GridSimulation::FrameState &State)
+	{
+		std::chrono::steady_clock::duration Blocked(0);
+
+		for (int k = 0; k < Frames; k++)
+		{
+			auto Start = std::chrono::steady_clock::now();
+			Simulation.finish();
+			n.update(0.016f);
+			Simulation.beginFrame(&n, State);
+			Blocked += std::chrono::steady_clock::now() - Start;
+
+			// Rendering
+			std::this_thread::sleep_for(std::chrono::milliseconds(4));
+		}
+		Simulation.finish();
+
+		return microseconds(Blocked) / Frames;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Ogre::LogManager LogManager;
+	LogManager.createLog("GridSimulationBenchmark.log", true, false, true);
+
+	Noise::Perlin Perlin;
+	Perlin.create();
+
+	Module::GridSimulation::FrameState State;
+	State.Origin = Ogre::Vector3::ZERO;
+	State.Direction = Ogre::Vector3(0.0f, -0.5f, -1.0f);
+	State.Underwater = false;
+
+	const int Complexities[] = {128, 256, 512};
+
+	WorkerPool SingleThread(0);
+	WorkerPool Workers;
+
+	for (int Complexity : Complexities)
+	{
+		Module::GridSimulation Single(&SingleThread, MaterialManager::NM_VERTEX, Complexity);
+		Module::GridSimulation Parallel(&Workers, MaterialManager::NM_VERTEX, Complexity);
+		Module::GridSimulation::Options Options;
+		Options.Smooth = true;
+		Single.setOptions(Options);
+		Parallel.setOptions(Options);
+
+		std::cout << std::endl << "Complexity " << Complexity << ", full simulation in one thread: " << timeGeometry(Perlin, Single, State) << " us";
+		std::cout << std::endl << "Complexity " << Complexity << ", full simulation in " << (Workers.getThreadCount() + 1) << " threads: " << timeGeometry(Perlin, Parallel, State) << " us";
+		std::cout << std::endl << "Complexity " << Complexity << ", main thread blocked when overlapping rendering: " << timeOverlapped(Perlin, Parallel, State) << " us";
+	}
+	std::cout << std::endl;
+
+	return 0;
+}
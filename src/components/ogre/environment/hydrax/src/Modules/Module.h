@@ -69,7 +69,7 @@ namespace Hydrax{ namespace Module
 			@param g GPUNormalMapManager pointer, default: NULL, use it if GPU Normal map generation is needed
 			@param DeleteOldNoise Delete the old noise module (Default = true)
 		 */
-		void setNoise(Noise::Noise* Noise, GPUNormalMapManager* g = 0, const bool& DeleteOldNoise = true);
+		virtual void setNoise(Noise::Noise* Noise, GPUNormalMapManager* g = 0, const bool& DeleteOldNoise = true);
 
 		/** Call it each frame
 		    @param timeSinceLastFrame Time since last frame(delta)
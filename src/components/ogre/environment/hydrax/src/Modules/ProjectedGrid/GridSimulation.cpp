@@ -0,0 +1,388 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "GridSimulation.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace Hydrax{namespace Module
+{
+	// The passes below each process a band of rows [Begin, End). They only write to
+	// their own rows, so the bands can be processed in parallel. Everything is kept as
+	// plain float arithmetic over rows, which the compiler can vectorise.
+
+	template<class VertexType>
+	void _GS_calculePositions(VertexType *Vertices, const Ogre::Vector4 *Corners, const int &Complexity, const int &Begin, const int &End)
+	{
+		const float d = 1.0f/(Complexity-1);
+
+		for (int iv = Begin; iv < End; iv++)
+		{
+			const float v = iv*d, _1_v = 1.0f-v;
+
+			// Interpolate between the corners once per row, each vertex is then interpolated between the row ends
+			const float
+				lx = _1_v*Corners[0].x + v*Corners[2].x, rx = _1_v*Corners[1].x + v*Corners[3].x,
+				lz = _1_v*Corners[0].z + v*Corners[2].z, rz = _1_v*Corners[1].z + v*Corners[3].z,
+				lw = _1_v*Corners[0].w + v*Corners[2].w, rw = _1_v*Corners[1].w + v*Corners[3].w;
+
+			VertexType *Row = Vertices + iv*Complexity;
+
+			for (int iu = 0; iu < Complexity; iu++)
+			{
+				const float u = iu*d, _1_u = 1.0f-u,
+					divide = 1.0f/(_1_u*lw + u*rw);
+
+				Row[iu].x = (_1_u*lx + u*rx)*divide;
+				Row[iu].z = (_1_u*lz + u*rz)*divide;
+			}
+		}
+	}
+
+	template<class VertexType>
+	void _GS_calculeHeights(VertexType *Target, const VertexType *Source, float *Heights, float *SamplesX, float *SamplesZ, Noise::Noise *n,
+		const int &Complexity, const int &Begin, const int &End, const Ogre::Vector3 &Origin, const float &Height, const float &Strength)
+	{
+		for (int v = Begin; v < End; v++)
+		{
+			VertexType *Row = Target + v*Complexity;
+			float *RowHeights = Heights + v*Complexity;
+			// Each row has its own samples, so that chunks running in parallel don't share any
+			float *x = SamplesX + v*Complexity;
+			float *z = SamplesZ + v*Complexity;
+
+			if (Source != Target)
+			{
+				const VertexType *SourceRow = Source + v*Complexity;
+
+				for (int u = 0; u < Complexity; u++)
+				{
+					Row[u] = SourceRow[u];
+				}
+			}
+
+			for (int u = 0; u < Complexity; u++)
+			{
+				x[u] = Origin.x + Row[u].x;
+				z[u] = Origin.z + Row[u].z;
+			}
+
+			// Sample the noise for the whole row at once
+			n->getValues(x, z, RowHeights, Complexity);
+
+			for (int u = 0; u < Complexity; u++)
+			{
+				RowHeights[u] = Height + RowHeights[u]*Strength;
+				Row[u].y = RowHeights[u];
+			}
+		}
+	}
+
+	template<class VertexType>
+	void _GS_smooth(VertexType *Vertices, const float *Heights, const int &Complexity, const int &Begin, const int &End)
+	{
+		for (int v = Begin; v < End; v++)
+		{
+			for (int u = 1; u < Complexity-1; u++)
+			{
+				const int i = v*Complexity + u;
+
+				// Reads the unsmoothed heights, so the result doesn't depend on the order the rows are processed in
+				Vertices[i].y =
+					 0.2f *
+					(Heights[i] +
+					 Heights[i+1] +
+					 Heights[i-1] +
+					 Heights[i+Complexity] +
+					 Heights[i-Complexity]);
+			}
+		}
+	}
+
+	void _GS_calculeNormals(Mesh::POS_NORM_VERTEX *Vertices, const int &Complexity, const int &Begin, const int &End)
+	{
+		for (int v = Begin; v < End; v++)
+		{
+			for (int u = 1; u < Complexity-1; u++)
+			{
+				Mesh::POS_NORM_VERTEX &Vertex = Vertices[v*Complexity + u];
+				const Mesh::POS_NORM_VERTEX &Left  = Vertices[v*Complexity + u - 1],
+					                        &Right = Vertices[v*Complexity + u + 1],
+					                        &Up    = Vertices[(v-1)*Complexity + u],
+					                        &Down  = Vertices[(v+1)*Complexity + u];
+
+				const float
+					x1 = Right.x - Left.x, y1 = Right.y - Left.y, z1 = Right.z - Left.z,
+					x2 = Down.x  - Up.x,   y2 = Down.y  - Up.y,   z2 = Down.z  - Up.z;
+
+				// vec2.crossProduct(vec1)
+				Vertex.nx = y2*z1 - z2*y1;
+				Vertex.ny = z2*x1 - x2*z1;
+				Vertex.nz = x2*y1 - y2*x1;
+			}
+		}
+	}
+
+	void _GS_performChoppyWaves(Mesh::POS_NORM_VERTEX *Vertices, const Mesh::POS_NORM_VERTEX *Base, const int &Complexity, const int &Begin, const int &End,
+		const Ogre::Vector2 &Dir, const Ogre::Vector2 &Perp, const float &Strength)
+	{
+		for (int v = Begin; v < End; v++)
+		{
+			const Mesh::POS_NORM_VERTEX *Row = Base + v*Complexity,
+				                        *NextRow = Base + (v+1)*Complexity;
+
+			const float Dis1 = Ogre::Math::Sqrt((Row[1].x - NextRow[1].x)*(Row[1].x - NextRow[1].x) +
+				                                (Row[1].z - NextRow[1].z)*(Row[1].z - NextRow[1].z));
+
+			for (int u = 1; u < Complexity-1; u++)
+			{
+				Mesh::POS_NORM_VERTEX &Vertex = Vertices[v*Complexity + u];
+
+				const float Dis2 = Ogre::Math::Sqrt((Row[u].x - Row[u+1].x)*(Row[u].x - Row[u+1].x) +
+					                                (Row[u].z - Row[u+1].z)*(Row[u].z - Row[u+1].z));
+
+				float Length = Ogre::Math::Sqrt(Vertex.nx*Vertex.nx + Vertex.ny*Vertex.ny + Vertex.nz*Vertex.nz);
+				if (Length > 0.0f)
+				{
+					Length = Strength/Length;
+				}
+
+				Vertex.x = Row[u].x + Vertex.nx*Length*(Dir.x*Dis1 + Perp.x*Dis2);
+				Vertex.z = Row[u].z + Vertex.nz*Length*(Dir.y*Dis1 + Perp.y*Dis2);
+			}
+		}
+	}
+
+	GridSimulation::GridSimulation(WorkerPool *Pool, const MaterialManager::NormalMode &NormalMode, const int &Complexity)
+		: mWorkerPool(Pool)
+		, mNormalMode(NormalMode)
+		, mComplexity(Complexity)
+		, mFront(0)
+		, mVerticesChoppyBuffer(0)
+		, mHeights(new float[Complexity*Complexity])
+		, mSamplesX(new float[Complexity*Complexity])
+		, mSamplesZ(new float[Complexity*Complexity])
+		, mSwapped(false)
+	{
+		const int Count = Complexity*Complexity;
+
+		if (mNormalMode == MaterialManager::NM_VERTEX)
+		{
+			Mesh::POS_NORM_VERTEX Initial = {0, 0, 0, 0, -1, 0};
+
+			mVertices[0] = new Mesh::POS_NORM_VERTEX[Count];
+			mVertices[1] = new Mesh::POS_NORM_VERTEX[Count];
+			mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[Count];
+
+			std::fill(static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[0]), static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[0]) + Count, Initial);
+			std::fill(static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[1]), static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[1]) + Count, Initial);
+			std::fill(mVerticesChoppyBuffer, mVerticesChoppyBuffer + Count, Initial);
+		}
+		else
+		{
+			Mesh::POS_VERTEX Initial = {0, 0, 0};
+
+			mVertices[0] = new Mesh::POS_VERTEX[Count];
+			mVertices[1] = new Mesh::POS_VERTEX[Count];
+
+			std::fill(static_cast<Mesh::POS_VERTEX*>(mVertices[0]), static_cast<Mesh::POS_VERTEX*>(mVertices[0]) + Count, Initial);
+			std::fill(static_cast<Mesh::POS_VERTEX*>(mVertices[1]), static_cast<Mesh::POS_VERTEX*>(mVertices[1]) + Count, Initial);
+		}
+	}
+
+	GridSimulation::~GridSimulation()
+	{
+		waitForFrame();
+
+		if (mNormalMode == MaterialManager::NM_VERTEX)
+		{
+			delete [] static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[0]);
+			delete [] static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[1]);
+			delete [] mVerticesChoppyBuffer;
+		}
+		else
+		{
+			delete [] static_cast<Mesh::POS_VERTEX*>(mVertices[0]);
+			delete [] static_cast<Mesh::POS_VERTEX*>(mVertices[1]);
+		}
+
+		delete [] mHeights;
+		delete [] mSamplesX;
+		delete [] mSamplesZ;
+	}
+
+	void GridSimulation::setOptions(const Options &Options)
+	{
+		waitForFrame();
+
+		mOptions = Options;
+	}
+
+	void GridSimulation::calculeGeometry(Noise::Noise *n, const Ogre::Vector4 Corners[4], const FrameState &State)
+	{
+		waitForFrame();
+		mSwapped = false;
+
+		const int Complexity = mComplexity;
+
+		if (mNormalMode == MaterialManager::NM_VERTEX)
+		{
+			Mesh::POS_NORM_VERTEX *Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices[mFront]);
+			Mesh::POS_NORM_VERTEX *ChoppyBuffer = mOptions.ChoppyWaves ? mVerticesChoppyBuffer : 0;
+
+			mWorkerPool->parallelFor(0, Complexity, [Vertices, ChoppyBuffer, Corners, Complexity](int Begin, int End)
+			{
+				_GS_calculePositions(Vertices, Corners, Complexity, Begin, End);
+
+				// Keep the undisplaced positions for the choppy waves
+				if (ChoppyBuffer)
+				{
+					std::copy(Vertices + Begin*Complexity, Vertices + End*Complexity, ChoppyBuffer + Begin*Complexity);
+				}
+			});
+		}
+		else
+		{
+			Mesh::POS_VERTEX *Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices[mFront]);
+
+			mWorkerPool->parallelFor(0, Complexity, [Vertices, Corners, Complexity](int Begin, int End)
+			{
+				_GS_calculePositions(Vertices, Corners, Complexity, Begin, End);
+			});
+		}
+
+		_simulate(n, mVertices[mFront], mVertices[mFront], State, mOptions);
+	}
+
+	void GridSimulation::beginFrame(Noise::Noise *n, const FrameState &State)
+	{
+		waitForFrame();
+
+		void *Target = mVertices[1-mFront];
+		// With choppy waves the front buffer is displaced, so the positions must be taken from the choppy buffer
+		const void *Source = (mNormalMode == MaterialManager::NM_VERTEX && mOptions.ChoppyWaves) ?
+			static_cast<const void*>(mVerticesChoppyBuffer) : mVertices[mFront];
+		const Options Options = mOptions;
+
+		std::shared_ptr<std::packaged_task<void()> > Frame = std::make_shared<std::packaged_task<void()> >([this, n, Target, Source, State, Options]()
+		{
+			_simulate(n, Target, Source, State, Options);
+		});
+
+		mFrame = Frame->get_future();
+		mWorkerPool->enqueue([Frame]() {(*Frame)();});
+	}
+
+	bool GridSimulation::finish()
+	{
+		waitForFrame();
+
+		bool Swapped = mSwapped;
+		mSwapped = false;
+
+		return Swapped;
+	}
+
+	void GridSimulation::waitForFrame()
+	{
+		if (mFrame.valid())
+		{
+			mFrame.get();
+
+			mFront = 1-mFront;
+			mSwapped = true;
+		}
+	}
+
+	void GridSimulation::_simulate(Noise::Noise *n, void *Target, const void *Source, const FrameState &State, const Options &Options)
+	{
+		const int Complexity = mComplexity;
+		float *Heights = mHeights;
+		float *SamplesX = mSamplesX;
+		float *SamplesZ = mSamplesZ;
+
+		if (mNormalMode == MaterialManager::NM_VERTEX)
+		{
+			Mesh::POS_NORM_VERTEX *Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(Target);
+			const Mesh::POS_NORM_VERTEX *SourceVertices = static_cast<const Mesh::POS_NORM_VERTEX*>(Source);
+
+			mWorkerPool->parallelFor(0, Complexity, [&](int Begin, int End)
+			{
+				_GS_calculeHeights(Vertices, SourceVertices, Heights, SamplesX, SamplesZ, n, Complexity, Begin, End, State.Origin, Options.Height, Options.Strength);
+			});
+
+			if (Options.Smooth)
+			{
+				mWorkerPool->parallelFor(1, Complexity-1, [&](int Begin, int End)
+				{
+					_GS_smooth(Vertices, Heights, Complexity, Begin, End);
+				});
+			}
+
+			mWorkerPool->parallelFor(1, Complexity-1, [&](int Begin, int End)
+			{
+				_GS_calculeNormals(Vertices, Complexity, Begin, End);
+			});
+
+			if (Options.ChoppyWaves)
+			{
+				const Mesh::POS_NORM_VERTEX *Base = mVerticesChoppyBuffer;
+
+				Ogre::Vector2 Dir  = Ogre::Vector2(State.Direction.x, State.Direction.z).normalisedCopy(),
+					          Perp = Dir.perpendicular();
+
+				if (Dir.x < 0 ) Dir.x = -Dir.x;
+				if (Dir.y < 0 ) Dir.y = -Dir.y;
+
+				if (Perp.x < 0 ) Perp.x = -Perp.x;
+				if (Perp.y < 0 ) Perp.y = -Perp.y;
+
+				const float Strength = State.Underwater ? -Options.ChoppyStrength : Options.ChoppyStrength;
+
+				mWorkerPool->parallelFor(1, Complexity-1, [&](int Begin, int End)
+				{
+					_GS_performChoppyWaves(Vertices, Base, Complexity, Begin, End, Dir, Perp, Strength);
+				});
+			}
+		}
+		else
+		{
+			Mesh::POS_VERTEX *Vertices = static_cast<Mesh::POS_VERTEX*>(Target);
+			const Mesh::POS_VERTEX *SourceVertices = static_cast<const Mesh::POS_VERTEX*>(Source);
+
+			mWorkerPool->parallelFor(0, Complexity, [&](int Begin, int End)
+			{
+				_GS_calculeHeights(Vertices, SourceVertices, Heights, SamplesX, SamplesZ, n, Complexity, Begin, End, State.Origin, Options.Height, Options.Strength);
+			});
+
+			if (Options.Smooth)
+			{
+				mWorkerPool->parallelFor(1, Complexity-1, [&](int Begin, int End)
+				{
+					_GS_smooth(Vertices, Heights, Complexity, Begin, End);
+				});
+			}
+		}
+	}
+}}
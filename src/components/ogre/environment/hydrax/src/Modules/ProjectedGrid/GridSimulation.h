@@ -0,0 +1,184 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_Modules_GridSimulation_H_
+#define _Hydrax_Modules_GridSimulation_H_
+
+#include "../../Prerequisites.h"
+
+#include "../../Mesh.h"
+#include "../../MaterialManager.h"
+#include "../../WorkerPool.h"
+#include "../../Noise/Noise.h"
+
+#include <future>
+
+namespace Hydrax{namespace Module
+{
+	/** CPU side simulation of the projected grid vertices.
+	    All passes (positions, heights, smoothing, normals and choppy waves) are split
+		in bands of grid rows, which are processed in parallel by a WorkerPool.
+
+		The vertices are double buffered: while the caller renders the front buffer,
+		beginFrame() computes the next heights into the back buffer in a worker thread.
+		finish() waits for that and swaps the buffers. Since the noise is read by the
+		simulation, the noise mustn't be updated between beginFrame() and finish().
+	 */
+	class DllExport GridSimulation
+	{
+	public:
+		/** Simulation options
+		 */
+		struct Options
+		{
+			/// Base height of the water plane
+			float Height;
+			/// Noise strength
+			float Strength;
+			/// Smooth
+			bool Smooth;
+			/// Choppy waves, only with MaterialManager::NM_VERTEX
+			bool ChoppyWaves;
+			/// Choppy waves strength
+			float ChoppyStrength;
+
+			/** Default constructor
+			 */
+			Options()
+				: Height(0.0f)
+				, Strength(35.0f)
+				, Smooth(false)
+				, ChoppyWaves(true)
+				, ChoppyStrength(3.75f)
+			{
+			}
+		};
+
+		/** State of the rendering camera, captured in the main thread
+		 */
+		struct FrameState
+		{
+			/// World position of the grid origin
+			Ogre::Vector3 Origin;
+			/// Camera view direction
+			Ogre::Vector3 Direction;
+			/// Is the camera underwater?
+			bool Underwater;
+		};
+
+		/** Constructor
+		    @param Pool Worker pool to run the passes in
+			@param NormalMode MaterialManager::NM_VERTEX for Mesh::POS_NORM_VERTEX vertices, MaterialManager::NM_RTT for Mesh::POS_VERTEX
+			@param Complexity Grid complexity (N*N)
+		 */
+		GridSimulation(WorkerPool *Pool, const MaterialManager::NormalMode &NormalMode, const int &Complexity);
+
+		/** Destructor
+		 */
+		~GridSimulation();
+
+		/** Set options
+		    @param Options Options
+			@remarks Waits for any frame being simulated
+		 */
+		void setOptions(const Options &Options);
+
+		/** Compute the whole grid for new corners, in the front buffer
+		    @param n Noise to sample
+			@param Corners Grid corners in homogenous coordinates, see ProjectedGrid
+			@param State Camera state
+		 */
+		void calculeGeometry(Noise::Noise *n, const Ogre::Vector4 Corners[4], const FrameState &State);
+
+		/** Start computing the heights for the current noise into the back buffer, in a worker thread
+		    @param n Noise to sample, mustn't be updated or deleted until the frame is finished
+			@param State Camera state
+		 */
+		void beginFrame(Noise::Noise *n, const FrameState &State);
+
+		/** Wait for the frame started by beginFrame() and make it the front buffer
+		    @return true if a frame simulated in the background has become the front buffer since the last call
+		 */
+		bool finish();
+
+		/** Wait for any frame being simulated, without reporting it
+		    @remarks The next call to finish() will still report the frame
+		 */
+		void waitForFrame();
+
+		/** Get the front buffer vertices
+		    @return Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX array
+		 */
+		inline void* getVertices() const
+		{
+			return mVertices[mFront];
+		}
+
+		/** Get the number of vertices
+		    @return Complexity*Complexity
+		 */
+		inline int getVertexCount() const
+		{
+			return mComplexity*mComplexity;
+		}
+
+	private:
+		/** Run all height dependent passes
+		    @param n Noise to sample
+			@param Target Vertices to write
+			@param Source Vertices to take the positions from, can be Target
+			@param State Camera state
+			@param Options Options
+		 */
+		void _simulate(Noise::Noise *n, void *Target, const void *Source, const FrameState &State, const Options &Options);
+
+		/// Worker pool
+		WorkerPool *mWorkerPool;
+		/// Normal mode
+		MaterialManager::NormalMode mNormalMode;
+		/// Grid complexity
+		int mComplexity;
+
+		/// Front and back vertex buffers (Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX)
+		void *mVertices[2];
+		/// Index of the front buffer
+		int mFront;
+		/// Positions without choppy displacement, only with MaterialManager::NM_VERTEX
+		Mesh::POS_NORM_VERTEX *mVerticesChoppyBuffer;
+		/// Unsmoothed heights
+		float *mHeights;
+		/// Noise sample positions, allocated once instead of for each row band
+		float *mSamplesX;
+		float *mSamplesZ;
+
+		/// Options
+		Options mOptions;
+
+		/// Frame being simulated in the background
+		std::future<void> mFrame;
+		/// Has the front buffer changed since the last call to finish()?
+		bool mSwapped;
+	};
+}}
+
+#endif
@@ -59,8 +59,8 @@ namespace Hydrax{namespace Module
 		: Module("ProjectedGrid" + _PG_getNormalModeString(NormalMode),
 		         n, Mesh::Options(256, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
 		, mHydrax(h)
-		, mVertices(0)
-		, mVerticesChoppyBuffer(0)
+		, mWorkerPool(0)
+		, mSimulation(0)
 		, mBasePlane(BasePlane)
 		, mNormal(BasePlane.normal)
 		, mPos(Ogre::Vector3(0,0,0))
@@ -74,8 +74,8 @@ namespace Hydrax{namespace Module
 		: Module("ProjectedGrid" + _PG_getNormalModeString(NormalMode),
 		         n, Mesh::Options(Options.Complexity, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
 		, mHydrax(h)
-		, mVertices(0)
-		, mVerticesChoppyBuffer(0)
+		, mWorkerPool(0)
+		, mSimulation(0)
 		, mBasePlane(BasePlane)
 		, mNormal(BasePlane.normal)
 		, mPos(Ogre::Vector3(0,0,0))
@@ -104,7 +104,7 @@ namespace Hydrax{namespace Module
 		mHydrax->_setStrength(Options.Strength);
 
 		// Re-create geometry if it's needed
-		if (isCreated() && Options.Complexity != mOptions.Complexity)
+		if (isCreated() && (Options.Complexity != mOptions.Complexity || Options.Threads != mOptions.Threads))
 		{
 			remove();
 			mOptions = Options;
@@ -132,6 +132,22 @@ namespace Hydrax{namespace Module
 		}
 
 		mOptions = Options;
+
+		if (mSimulation)
+		{
+			mSimulation->setOptions(_getSimulationOptions());
+		}
+	}
+
+	void ProjectedGrid::setNoise(Noise::Noise* Noise, GPUNormalMapManager* g, const bool& DeleteOldNoise)
+	{
+		// The old noise might still be read by the simulation
+		if (mSimulation)
+		{
+			mSimulation->waitForFrame();
+		}
+
+		Module::setNoise(Noise, g, DeleteOldNoise);
 	}
 
 	void ProjectedGrid::create()
@@ -140,25 +156,9 @@ namespace Hydrax{namespace Module
 
 		Module::create();
 
-		if (getNormalMode() == MaterialManager::NM_VERTEX)
-		{
-		    mVertices = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];
-
-			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-			for (int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-			{
-				Vertices[i].nx = 0;
-				Vertices[i].ny = -1;
-				Vertices[i].nz = 0;
-			}
-
-			mVerticesChoppyBuffer = new Mesh::POS_NORM_VERTEX[mOptions.Complexity*mOptions.Complexity];
-		}
-		else if(getNormalMode() == MaterialManager::NM_RTT)
-		{
-			mVertices = new Mesh::POS_VERTEX[mOptions.Complexity*mOptions.Complexity];
-		}
+		mWorkerPool = new WorkerPool(mOptions.Threads);
+		mSimulation = new GridSimulation(mWorkerPool, getNormalMode(), mOptions.Complexity);
+		mSimulation->setOptions(_getSimulationOptions());
 
 	    _setDisplacementAmplitude(0.0f);
 
@@ -175,24 +175,14 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
-		Module::remove();
+		// Waits for any frame being simulated, so do it before the noise is removed
+		delete mSimulation;
+		mSimulation = 0;
 
-		if (mVertices)
-		{
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
-			{
-				delete [] static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
-			{
-				delete [] static_cast<Mesh::POS_VERTEX*>(mVertices);
-			}
-		}
+		delete mWorkerPool;
+		mWorkerPool = 0;
 
-		if (mVerticesChoppyBuffer)
-		{
-			delete [] mVerticesChoppyBuffer;
-		}
+		Module::remove();
 
 		if (mTmpRndrngCamera)
 		{
@@ -214,7 +204,8 @@ namespace Hydrax{namespace Module
 		Data += CfgFileManager::_getCfgString("PG_Elevation", mOptions.Elevation);
 		Data += CfgFileManager::_getCfgString("PG_ForceRecalculateGeometry", mOptions.ForceRecalculateGeometry);
 		Data += CfgFileManager::_getCfgString("PG_Smooth", mOptions.Smooth);
-		Data += CfgFileManager::_getCfgString("PG_Strength", mOptions.Strength); Data += "\n";
+		Data += CfgFileManager::_getCfgString("PG_Strength", mOptions.Strength);
+		Data += CfgFileManager::_getCfgString("PG_Threads", mOptions.Threads); Data += "\n";
 	}
 
 	bool ProjectedGrid::loadCfg(const Ogre::ConfigFile &CfgFile)
@@ -224,14 +215,21 @@ namespace Hydrax{namespace Module
 			return false;
 		}
 
-		setOptions(
-			Options(CfgFileManager::_getIntValue(CfgFile,   "PG_Complexity"),
-			        CfgFileManager::_getFloatValue(CfgFile, "PG_Strength"),
-					CfgFileManager::_getFloatValue(CfgFile, "PG_Elevation"),
-					CfgFileManager::_getBoolValue(CfgFile,  "PG_Smooth"),
-					CfgFileManager::_getBoolValue(CfgFile,  "PG_ForceRecalculateGeometry"),
-					CfgFileManager::_getBoolValue(CfgFile,  "PG_ChoppyWaves"),
-					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength")));
+		Options CfgOptions(CfgFileManager::_getIntValue(CfgFile,   "PG_Complexity"),
+		                   CfgFileManager::_getFloatValue(CfgFile, "PG_Strength"),
+		                   CfgFileManager::_getFloatValue(CfgFile, "PG_Elevation"),
+		                   CfgFileManager::_getBoolValue(CfgFile,  "PG_Smooth"),
+		                   CfgFileManager::_getBoolValue(CfgFile,  "PG_ForceRecalculateGeometry"),
+		                   CfgFileManager::_getBoolValue(CfgFile,  "PG_ChoppyWaves"),
+		                   CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength"));
+
+		// Older config files don't have it, and _getIntValue() would then give 0 (no worker threads)
+		if (CfgFile.getSetting("<int>PG_Threads") != "")
+		{
+			CfgOptions.Threads = CfgFileManager::_getIntValue(CfgFile, "PG_Threads");
+		}
+
+		setOptions(CfgOptions);
 
 		return true;
 	}
@@ -243,6 +241,9 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
+		// The noise can't be updated while the last frame is being simulated from it
+		bool Simulated = mSimulation->finish();
+
 		Module::update(timeSinceLastFrame);
 
 		Ogre::Vector3 RenderingCameraPos = mRenderingCamera->getDerivedPosition();
@@ -273,100 +274,24 @@ namespace Hydrax{namespace Module
 
 		    if (mLastMinMax)
 		    {
+				// The grid must follow the camera in the same frame, so it's computed right away
 			    _renderGeometry(mRange, mProjectingCamera->getViewMatrix(), RenderingCameraPos);
 
-			    mHydrax->getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+			    mHydrax->getMesh()->updateGeometry(mSimulation->getVertexCount(), mSimulation->getVertices());
 		    }
 
 			mRenderingCamera->setFarClipDistance(RenderingFarClipDistance);
 		}
 		else if (mLastMinMax)
 		{
-			int i = 0, v, u;
-
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
+			// Show the heights simulated during the last frame, and simulate
+			// the current ones while this frame is rendered
+			if (Simulated)
 			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-				if (mOptions.ChoppyWaves)
-				{
-					for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		            {
-			            Vertices[i] = mVerticesChoppyBuffer[i];
-		            }
-				}
-
-				for(v=0; v<mOptions.Complexity; v++)
-				{
-					for(u=0; u<mOptions.Complexity; u++)
-					{
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-
-						i++;
-					}
-				}
+				mHydrax->getMesh()->updateGeometry(mSimulation->getVertexCount(), mSimulation->getVertices());
 			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
-			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
 
-				for(v=0; v<mOptions.Complexity; v++)
-				{
-					for(u=0; u<mOptions.Complexity; u++)
-					{
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-
-						i++;
-					}
-				}
-			}
-
-			// Smooth the heightdata
-		    if (mOptions.Smooth)
-		    {
-				if (getNormalMode() == MaterialManager::NM_VERTEX)
-				{
-					Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-					for(v=1; v<(mOptions.Complexity-1); v++)
-					{
-						for(u=1; u<(mOptions.Complexity-1); u++)
-						{
-							Vertices[v*mOptions.Complexity + u].y =
-								 0.2f *
-								(Vertices[v    *mOptions.Complexity + u    ].y +
-								 Vertices[v    *mOptions.Complexity + (u+1)].y +
-								 Vertices[v    *mOptions.Complexity + (u-1)].y +
-								 Vertices[(v+1)*mOptions.Complexity + u    ].y +
-								 Vertices[(v-1)*mOptions.Complexity + u    ].y);
-						}
-					}
-				}
-				else if(getNormalMode() == MaterialManager::NM_RTT)
-				{
-					Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-					for(v=1; v<(mOptions.Complexity-1); v++)
-					{
-						for(u=1; u<(mOptions.Complexity-1); u++)
-						{
-							Vertices[v*mOptions.Complexity + u].y =
-								 0.2f *
-								(Vertices[v    *mOptions.Complexity + u    ].y +
-								 Vertices[v    *mOptions.Complexity + (u+1)].y +
-								 Vertices[v    *mOptions.Complexity + (u-1)].y +
-								 Vertices[(v+1)*mOptions.Complexity + u    ].y +
-								 Vertices[(v-1)*mOptions.Complexity + u    ].y);
-						}
-					}
-				}
-		    }
-
-			_calculeNormals();
-
-			_performChoppyWaves();
-
-			mHydrax->getMesh()->updateGeometry(mOptions.Complexity*mOptions.Complexity, mVertices);
+			mSimulation->beginFrame(mNoise, _getFrameState(RenderingCameraPos));
 		}
 
 		mLastPosition = RenderingCameraPos;
@@ -375,249 +300,38 @@ namespace Hydrax{namespace Module
 
 	bool ProjectedGrid::_renderGeometry(const Ogre::Matrix4& m,const Ogre::Matrix4& _viewMat, const Ogre::Vector3& WorldPos)
 	{
-		t_corners0 = _calculeWorldPosition(Ogre::Vector2( 0.0f, 0.0f),m,_viewMat);
-		t_corners1 = _calculeWorldPosition(Ogre::Vector2(+1.0f, 0.0f),m,_viewMat);
-		t_corners2 = _calculeWorldPosition(Ogre::Vector2( 0.0f,+1.0f),m,_viewMat);
-		t_corners3 = _calculeWorldPosition(Ogre::Vector2(+1.0f,+1.0f),m,_viewMat);
-
-		float du  = 1.0f/(mOptions.Complexity-1),
-			  dv  = 1.0f/(mOptions.Complexity-1),
-			  u,v = 0.0f,
-			  // _1_u = (1.0f-u)
-			  _1_u, _1_v = 1.0f,
-			  divide;
-
-		Ogre::Vector4 result;
-
-		int i = 0, iv, iu;
-
-		if (getNormalMode() == MaterialManager::NM_VERTEX)
-		{
-			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-			for(iv=0; iv<mOptions.Complexity; iv++)
-			{
-				u = 0.0f;
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);
-
-					divide = 1.0f/result.w;
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
+		t_corners[0] = _calculeWorldPosition(Ogre::Vector2( 0.0f, 0.0f),m,_viewMat);
+		t_corners[1] = _calculeWorldPosition(Ogre::Vector2(+1.0f, 0.0f),m,_viewMat);
+		t_corners[2] = _calculeWorldPosition(Ogre::Vector2( 0.0f,+1.0f),m,_viewMat);
+		t_corners[3] = _calculeWorldPosition(Ogre::Vector2(+1.0f,+1.0f),m,_viewMat);
 
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
-			}
-
-			if (mOptions.ChoppyWaves)
-			{
-				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		        {
-			        mVerticesChoppyBuffer[i] = Vertices[i];
-		        }
-			}
-		}
-		else if(getNormalMode() == MaterialManager::NM_RTT)
-		{
-			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-			for(iv=0; iv<mOptions.Complexity; iv++)
-			{
-				u = 0.0f;
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);
-
-					divide = 1.0f/result.w;
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
-
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
-			}
-		}
-
-		// Smooth the heightdata
-		if (mOptions.Smooth)
-		{
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
-			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-				for(iv=1; iv<(mOptions.Complexity-1); iv++)
-				{
-					for(iu=1; iu<(mOptions.Complexity-1); iu++)
-					{
-						Vertices[iv*mOptions.Complexity + iu].y =
-							 0.2f *
-							(Vertices[iv    *mOptions.Complexity + iu    ].y +
-							 Vertices[iv    *mOptions.Complexity + (iu+1)].y +
-							 Vertices[iv    *mOptions.Complexity + (iu-1)].y +
-							 Vertices[(iv+1)*mOptions.Complexity + iu    ].y +
-							 Vertices[(iv-1)*mOptions.Complexity + iu    ].y);
-					}
-				}
-			}
-			else if(getNormalMode() == MaterialManager::NM_RTT)
-			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-				for(iv=1; iv<(mOptions.Complexity-1); iv++)
-				{
-					for(iu=1; iu<(mOptions.Complexity-1); iu++)
-					{
-						Vertices[iv*mOptions.Complexity + iu].y =
-							 0.2f *
-							(Vertices[iv    *mOptions.Complexity + iu    ].y +
-							 Vertices[iv    *mOptions.Complexity + (iu+1)].y +
-							 Vertices[iv    *mOptions.Complexity + (iu-1)].y +
-							 Vertices[(iv+1)*mOptions.Complexity + iu    ].y +
-							 Vertices[(iv-1)*mOptions.Complexity + iu    ].y);
-					}
-				}
-			}
-		}
-
-		_calculeNormals();
-
-		_performChoppyWaves();
+		mSimulation->calculeGeometry(mNoise, t_corners, _getFrameState(WorldPos));
 
 		return true;
 	}
 
-	void ProjectedGrid::_calculeNormals()
+	GridSimulation::Options ProjectedGrid::_getSimulationOptions() const
 	{
-		if (getNormalMode() != MaterialManager::NM_VERTEX)
-		{
-			return;
-		}
-
-		int v, u;
-		Ogre::Vector3 vec1, vec2, normal;
-
-		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+		GridSimulation::Options SimulationOptions;
 
-		for(v=1; v<(mOptions.Complexity-1); v++)
-		{
-			for(u=1; u<(mOptions.Complexity-1); u++)
-			{
-				vec1 = Ogre::Vector3(
-					Vertices[v*mOptions.Complexity + u + 1].x-Vertices[v*mOptions.Complexity + u - 1].x,
-					Vertices[v*mOptions.Complexity + u + 1].y-Vertices[v*mOptions.Complexity + u - 1].y,
-					Vertices[v*mOptions.Complexity + u + 1].z-Vertices[v*mOptions.Complexity + u - 1].z);
+		SimulationOptions.Height         = -mBasePlane.d;
+		SimulationOptions.Strength       = mOptions.Strength;
+		SimulationOptions.Smooth         = mOptions.Smooth;
+		SimulationOptions.ChoppyWaves    = mOptions.ChoppyWaves;
+		SimulationOptions.ChoppyStrength = mOptions.ChoppyStrength;
 
-				vec2 = Ogre::Vector3(
-					Vertices[(v+1)*mOptions.Complexity + u].x - Vertices[(v-1)*mOptions.Complexity + u].x,
-					Vertices[(v+1)*mOptions.Complexity + u].y - Vertices[(v-1)*mOptions.Complexity + u].y,
-					Vertices[(v+1)*mOptions.Complexity + u].z - Vertices[(v-1)*mOptions.Complexity + u].z);
-
-				normal = vec2.crossProduct(vec1);
-
-				Vertices[v*mOptions.Complexity + u].nx = normal.x;
-				Vertices[v*mOptions.Complexity + u].ny = normal.y;
-				Vertices[v*mOptions.Complexity + u].nz = normal.z;
-			}
-		}
+		return SimulationOptions;
 	}
 
-	void ProjectedGrid::_performChoppyWaves()
+	GridSimulation::FrameState ProjectedGrid::_getFrameState(const Ogre::Vector3& WorldPos) const
 	{
-		if (getNormalMode() != MaterialManager::NM_VERTEX || !mOptions.ChoppyWaves)
-		{
-			return;
-		}
-
-		int v, u,
-		    Underwater = 1;
-
-		if (mHydrax->_isCurrentFrameUnderwater())
-		{
-			Underwater = -1;
-		}
-
-		float Dis1,  Dis2;//,
-		   // Dis1_, Dis2_;
+		GridSimulation::FrameState State;
 
-		Ogre::Vector3 CameraDir, Norm;
-		Ogre::Vector2 Dir, Perp, Norm2;
+		State.Origin     = WorldPos;
+		State.Direction  = mRenderingCamera->getDerivedDirection();
+		State.Underwater = mHydrax->_isCurrentFrameUnderwater();
 
-		CameraDir = mRenderingCamera->getDerivedDirection();
-		Dir       = Ogre::Vector2(CameraDir.x, CameraDir.z).normalisedCopy();
-		Perp      = Dir.perpendicular();
-
-		if (Dir.x < 0 ) Dir.x = -Dir.x;
-		if (Dir.y < 0 ) Dir.y = -Dir.y;
-
-		if (Perp.x < 0 ) Perp.x = -Perp.x;
-		if (Perp.y < 0 ) Perp.y = -Perp.y;
-
-		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-		for(v=1; v<(mOptions.Complexity-1); v++)
-		{
-			Dis1 =  (Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + 1].x,
-					               mVerticesChoppyBuffer[v*mOptions.Complexity + 1].z) -
-					 Ogre::Vector2(mVerticesChoppyBuffer[(v+1)*mOptions.Complexity + 1].x,
-				                   mVerticesChoppyBuffer[(v+1)*mOptions.Complexity + 1].z)).length();
-
-			/*Dis1_ = (Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + 1].x,
-                                   mVerticesChoppyBuffer[v*mOptions.Complexity + 1].z) -
-				   	 Ogre::Vector2(mVerticesChoppyBuffer[(v-1)*mOptions.Complexity + 1].x,
-					               mVerticesChoppyBuffer[(v-1)*mOptions.Complexity + 1].z)).length();
-
-			Dis1 = (Dis1+Dis1_)/2;*/
-
-			for(u=1; u<(mOptions.Complexity-1); u++)
-			{
-				Dis2 = (Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + u].x,
-					                  mVerticesChoppyBuffer[v*mOptions.Complexity + u].z) -
-					    Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + u+1].x,
-					                  mVerticesChoppyBuffer[v*mOptions.Complexity + u+1].z)).length();
-/*
-				Dis2_ = (Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + u].x,
-					                   mVerticesChoppyBuffer[v*mOptions.Complexity + u].z) -
-					     Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + u-1].x,
-				                       mVerticesChoppyBuffer[v*mOptions.Complexity + u-1].z)).length();
-
-				Dis2 = (Dis2+Dis2_)/2;*/
-
-				Norm = Ogre::Vector3(Vertices[v*mOptions.Complexity + u].nx,
-					                 Vertices[v*mOptions.Complexity + u].ny,
-								     Vertices[v*mOptions.Complexity + u].nz).
-					   			     normalisedCopy();
-
-				Norm2 = Ogre::Vector2(Norm.x, Norm.z)  *
-					                 ( (Dir  * Dis1)   +
-					                   (Perp * Dis2))  *
-				 				      mOptions.ChoppyStrength;
-
-				Vertices[v*mOptions.Complexity + u].x = mVerticesChoppyBuffer[v*mOptions.Complexity + u].x + Norm2.x * Underwater;
-				Vertices[v*mOptions.Complexity + u].z = mVerticesChoppyBuffer[v*mOptions.Complexity + u].z + Norm2.y * Underwater;
-			}
-		}
+		return State;
 	}
 
 	// Check the point of intersection with the plane (0,1,0,0) and return the position in homogenous coordinates
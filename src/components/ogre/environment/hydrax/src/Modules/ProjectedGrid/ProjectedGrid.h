@@ -36,6 +36,8 @@ http://www.cnblogs.com/ArenAK/archive/2007/11/07/951713.html
 #include "../../Hydrax.h"
 #include "../../Mesh.h"
 #include "../Module.h"
+#include "../../WorkerPool.h"
+#include "GridSimulation.h"
 
 namespace Hydrax{ namespace Module
 {
@@ -62,6 +64,8 @@ namespace Hydrax{ namespace Module
 			bool ChoppyWaves;
 			/// Choppy waves strength
 			float ChoppyStrength;
+			/// Number of simulation worker threads, -1 to let the WorkerPool decide
+			int Threads;
 
 			/** Default constructor
 			 */
@@ -73,6 +77,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, Threads(-1)
 			{
 			}
 
@@ -87,6 +92,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, Threads(-1)
 			{
 			}
 
@@ -107,6 +113,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, Threads(-1)
 			{
 			}
 
@@ -133,6 +140,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(_ForceRecalculateGeometry)
 				, ChoppyWaves(_ChoppyWaves)
 				, ChoppyStrength(_ChoppyStrength)
+				, Threads(-1)
 			{
 			}
 		};
@@ -166,8 +174,17 @@ namespace Hydrax{ namespace Module
 		 */
 		void remove();
 
+		/** Set noise
+		    @param Noise New noise module
+			@param g GPUNormalMapManager pointer, default: NULL, use it if GPU Normal map generation is needed
+			@param DeleteOldNoise Delete the old noise module (Default = true)
+		 */
+		void setNoise(Noise::Noise* Noise, GPUNormalMapManager* g = 0, const bool& DeleteOldNoise = true);
+
 		/** Call it each frame
 		    @param timeSinceLastFrame Time since last frame(delta)
+			@remarks While the grid is still, the new heights are simulated in worker threads
+			         while the frame is rendered, and shown on the next call.
 		 */
 		void update(const Ogre::Real &timeSinceLastFrame);
 
@@ -202,13 +219,16 @@ namespace Hydrax{ namespace Module
 		}
 
 	private:
-		/** Calcule current normals
+		/** Get the simulation options
+		    @return Simulation options for the current options
 		 */
-		void _calculeNormals();
+		GridSimulation::Options _getSimulationOptions() const;
 
-		/** Perform choppy waves
+		/** Get the rendering camera state
+		    @param WorldPos Origin world position
+			@return Camera state for the simulation
 		 */
-		void _performChoppyWaves();
+		GridSimulation::FrameState _getFrameState(const Ogre::Vector3& WorldPos) const;
 
 		/** Render geometry
 		    @param m Range
@@ -237,14 +257,14 @@ namespace Hydrax{ namespace Module
 		 */
 		void _setDisplacementAmplitude(const float &Amplitude);
 
-		/// Vertex pointer (Mesh::POS_NORM_VERTEX or Mesh::POS_VERTEX)
-		void *mVertices;
+		/// Worker threads for the grid simulation
+		WorkerPool *mWorkerPool;
 
-		/// Use it to store vertex positions when choppy displacement is enabled
-		Mesh::POS_NORM_VERTEX* mVerticesChoppyBuffer;
+		/// Grid vertices simulation
+		GridSimulation *mSimulation;
 
 		/// For corners
-		Ogre::Vector4 t_corners0,t_corners1,t_corners2,t_corners3;
+		Ogre::Vector4 t_corners[4];
 
 		/// Range matrix
 		Ogre::Matrix4 mRange;
@@ -72,6 +72,14 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
+	void Noise::getValues(const float *x, const float *y, float *Values, const int &Count)
+	{
+		for (int k = 0; k < Count; k++)
+		{
+			Values[k] = getValue(x[k], y[k]);
+		}
+	}
+
 	void Noise::saveCfg(Ogre::String &Data)
 	{
 		Data += "#Noise options\n";
@@ -120,6 +120,15 @@ namespace Hydrax{ namespace Noise
 		 */
 		virtual float getValue(const float &x, const float &y) = 0;
 
+		/** Get the noise values for a number of x/y points
+		    @param x X Coords
+			@param y Y Coords
+			@param Values Where the noise values are written
+			@param Count Number of points
+			@remarks Must be safe to call from several threads at once, as long as update() isn't called at the same time
+		 */
+		virtual void getValues(const float *x, const float *y, float *Values, const int &Count);
+
 	protected:
 		/// Module name
 		Ogre::String mName;
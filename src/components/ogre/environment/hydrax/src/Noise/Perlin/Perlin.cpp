@@ -32,13 +32,15 @@ http://graphics.cs.lth.se/theses/projects/projgrid/
 
 #define _def_PackedNoise true
 
+/// Number of points processed at a time by Perlin::getValues()
+#define _def_ValuesBlockSize 64
+
 namespace Hydrax{namespace Noise
 {
 	Perlin::Perlin()
 		: Noise("Perlin", true)
 		, octaves(0)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * 0.085f)
 		, mGPUNormalMapManager(0)
 	{
@@ -49,7 +51,6 @@ namespace Hydrax{namespace Noise
 		, mOptions(Options)
 		, octaves(0)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * Options.Scale)
 		, mGPUNormalMapManager(0)
 	{
@@ -405,6 +406,56 @@ namespace Hydrax{namespace Noise
 		return _getHeigthDual(x,y);
 	}
 
+	void Perlin::getValues(const float *x, const float *y, float *Values, const int &Count)
+	{
+		// Each step is done for a whole block of points at a time, in plain loops which the
+		// compiler can vectorise. The blocks are small enough for the temporaries to stay in cache.
+		int ui[_def_ValuesBlockSize],
+			vi[_def_ValuesBlockSize],
+			value[_def_ValuesBlockSize];
+
+		const int hoct = octaves / n_packsize;
+
+		for (int Start = 0; Start < Count; Start += _def_ValuesBlockSize)
+		{
+			const int Size = (Count - Start < _def_ValuesBlockSize) ? Count - Start : _def_ValuesBlockSize;
+			const float *xb = x + Start,
+				        *yb = y + Start;
+
+			for (int k = 0; k < Size; k++)
+			{
+				ui[k] = xb[k]*magnitude;
+				vi[k] = yb[k]*magnitude;
+				value[k] = 0;
+			}
+
+			const int *Noise = p_noise;
+
+			for (int i = 0; i < hoct; i++)
+			{
+				for (int k = 0; k < Size; k++)
+				{
+					value[k] += _readTexelLinearDual(ui[k], vi[k], Noise);
+				}
+
+				for (int k = 0; k < Size; k++)
+				{
+					ui[k] = ui[k] << n_packsize;
+					vi[k] = vi[k] << n_packsize;
+				}
+
+				Noise += np_size_sq;
+			}
+
+			float *Result = Values + Start;
+
+			for (int k = 0; k < Size; k++)
+			{
+				Result[k] = static_cast<float>(value[k])/noise_magnitude;
+			}
+		}
+	}
+
 	void Perlin::_initNoise()
 	{
 		// Create noise (uniform)
@@ -495,12 +546,17 @@ namespace Hydrax{namespace Noise
 			image[1] = (iImage+1) & noise_frames_m1;
 			image[2] = (iImage+2) & noise_frames_m1;
 
+			const int *Image0 = noise + n_size_sq * image[0],
+				      *Image1 = noise + n_size_sq * image[1],
+				      *Image2 = noise + n_size_sq * image[2];
+			int *Octave = o_noise + n_size_sq*o;
+
 			for (i=0; i<n_size_sq; i++)
 			{
-			    o_noise[i + n_size_sq*o] = (
-				   ((amount[0] * noise[i + n_size_sq * image[0]])>>scale_decimalbits) +
-				   ((amount[1] * noise[i + n_size_sq * image[1]])>>scale_decimalbits) +
-				   ((amount[2] * noise[i + n_size_sq * image[2]])>>scale_decimalbits));
+			    Octave[i] = (
+				   ((amount[0] * Image0[i])>>scale_decimalbits) +
+				   ((amount[1] * Image1[i])>>scale_decimalbits) +
+				   ((amount[2] * Image2[i])>>scale_decimalbits));
 			}
 
 			r_timemulti *= mOptions.Timemulti;
@@ -513,13 +569,17 @@ namespace Hydrax{namespace Noise
 			{
 				for(v=0; v<np_size; v++)
 				{
+					int *Row = p_noise + v*np_size + octavepack*np_size_sq;
+					const int *Source = o_noise + (o+3)*n_size_sq + (v&n_size_m1)*n_size;
+
 					for(u=0; u<np_size; u++)
 					{
-						p_noise[v*np_size+u+octavepack*np_size_sq]  = o_noise[(o+3)*n_size_sq + (v&n_size_m1)*n_size + (u&n_size_m1)];
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 3, o);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 2, o+1);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 1, o+2);
+						Row[u] = Source[u&n_size_m1];
 					}
+
+					_mapSampleRow(Row, v, 3, o);
+					_mapSampleRow(Row, v, 2, o+1);
+					_mapSampleRow(Row, v, 1, o+2);
 				}
 
 				octavepack++;
@@ -527,7 +587,7 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
-	int Perlin::_readTexelLinearDual(const int &u, const int &v,const int &o)
+	int Perlin::_readTexelLinearDual(const int &u, const int &v, const int *Noise) const
 	{
 		int iu, iup, iv, ivp, fu, fv,
 			ut01, ut23, ut;
@@ -541,17 +601,18 @@ namespace Hydrax{namespace Noise
 		fu = u & n_dec_magn_m1;
 		fv = v & n_dec_magn_m1;
 
-		ut01 = ((n_dec_magn-fu)*r_noise[iv + iu] + fu*r_noise[iv + iup])>>n_dec_bits;
-		ut23 = ((n_dec_magn-fu)*r_noise[ivp + iu] + fu*r_noise[ivp + iup])>>n_dec_bits;
+		ut01 = ((n_dec_magn-fu)*Noise[iv + iu] + fu*Noise[iv + iup])>>n_dec_bits;
+		ut23 = ((n_dec_magn-fu)*Noise[ivp + iu] + fu*Noise[ivp + iup])>>n_dec_bits;
 		ut = ((n_dec_magn-fv)*ut01 + fv*ut23) >> n_dec_bits;
 
 		return ut;
 	}
 
-	float Perlin::_getHeigthDual(float u, float v)
+	float Perlin::_getHeigthDual(float u, float v) const
 	{
-		// Pointer to the current noise source octave
-		r_noise = p_noise;
+		// Pointer to the current noise source octave.
+		// Kept local, so that several threads can read the noise at once.
+		const int *r_noise = p_noise;
 
 		int ui = u*magnitude,
 		    vi = v*magnitude,
@@ -561,7 +622,7 @@ namespace Hydrax{namespace Noise
 
 		for(i=0; i<hoct; i++)
 		{
-			value += _readTexelLinearDual(ui,vi,0);
+			value += _readTexelLinearDual(ui,vi,r_noise);
 			ui = ui << n_packsize;
 			vi = vi << n_packsize;
 			r_noise += np_size_sq;
@@ -570,24 +631,32 @@ namespace Hydrax{namespace Noise
 		return static_cast<float>(value)/noise_magnitude;
 	}
 
-	int Perlin::_mapSample(const int &u, const int &v, const int &upsamplepower, const int &octave)
+	void Perlin::_mapSampleRow(int *Row, const int &v, const int &upsamplepower, const int &octave) const
 	{
 		int magnitude = 1<<upsamplepower,
 
-		    pu = u >> upsamplepower,
 		    pv = v >> upsamplepower,
-
-		    fu = u & (magnitude-1),
 		    fv = v & (magnitude-1),
-
-		    fu_m = magnitude - fu,
 		    fv_m = magnitude - fv,
 
-		    o = fu_m*fv_m*o_noise[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu)  &n_size_m1)] +
-			    fu*  fv_m*o_noise[octave*n_size_sq + ((pv)  &n_size_m1)*n_size + ((pu+1)&n_size_m1)] +
-			    fu_m*fv*  o_noise[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu)  &n_size_m1)] +
-			    fu*  fv*  o_noise[octave*n_size_sq + ((pv+1)&n_size_m1)*n_size + ((pu+1)&n_size_m1)];
+		    shift = upsamplepower+upsamplepower;
+
+		// Both source rows are the same for the whole destination row
+		const int *Row0 = o_noise + octave*n_size_sq + ((pv)  &n_size_m1)*n_size,
+			      *Row1 = o_noise + octave*n_size_sq + ((pv+1)&n_size_m1)*n_size;
 
-		return o >> (upsamplepower+upsamplepower);
+		for (int u = 0; u < np_size; u++)
+		{
+			int pu = u >> upsamplepower,
+			    fu = u & (magnitude-1),
+			    fu_m = magnitude - fu,
+
+			    o = fu_m*fv_m*Row0[(pu)  &n_size_m1] +
+				    fu*  fv_m*Row0[(pu+1)&n_size_m1] +
+				    fu_m*fv*  Row1[(pu)  &n_size_m1] +
+				    fu*  fv*  Row1[(pu+1)&n_size_m1];
+
+			Row[u] += o >> shift;
+		}
 	}
 }}
@@ -211,6 +211,15 @@ namespace Hydrax{ namespace Noise
 		 */
 		float getValue(const float &x, const float &y);
 
+		/** Get the noise values for a number of x/y points
+		    @param x X Coords
+			@param y Y Coords
+			@param Values Where the noise values are written
+			@param Count Number of points
+			@remarks Gives the same values as getValue(), but processes the points in blocks
+		 */
+		void getValues(const float *x, const float *y, float *Values, const int &Count);
+
 		/** Set/Update perlin noise options
 		    @param Options Perlin noise options
 			@remarks If create() have been already called, Octaves option doesn't be updated.
@@ -241,32 +250,30 @@ namespace Hydrax{ namespace Noise
 		/** Read texel linear dual
 		    @param u u
 			@param v v
-			@param o Octave
+			@param Noise Packed noise octave to read from
 			@return int
 		 */
-	    int _readTexelLinearDual(const int &u, const int &v, const int &o);
+	    int _readTexelLinearDual(const int &u, const int &v, const int *Noise) const;
 
 		/** Read texel linear
 		    @param u u
 			@param v v
 			@return Heigth
 		 */
-		float _getHeigthDual(float u, float v);
+		float _getHeigthDual(float u, float v) const;
 
-		/** Map sample
-		    @param u u
+		/** Map sample a whole row and add it to the row
+		    @param Row Row of np_size values to add the samples to
 			@param v v
-			@param level Level
+			@param upsamplepower Upsample power
 			@param octave Octave
-			@return Map sample
 		 */
-		int _mapSample(const int &u, const int &v, const int &upsamplepower, const int &octave);
+		void _mapSampleRow(int *Row, const int &v, const int &upsamplepower, const int &octave) const;
 
 		/// Perlin noise variables
 		int noise[n_size_sq*noise_frames];
 		int o_noise[n_size_sq*max_octaves];
 		int p_noise[np_size_sq*(max_octaves>>(n_packsize-1))];	
-		int *r_noise;
 		int octaves;
 		float magnitude;
 
@@ -0,0 +1,180 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+/// Number of chunks per thread in parallelFor(), more chunks gives a better balance between threads
+#define _def_ChunksPerThread 4
+
+namespace Hydrax
+{
+	WorkerPool::WorkerPool(const int &Threads)
+		: mStopped(false)
+	{
+		int Count = Threads;
+
+		if (Count < 0)
+		{
+			Count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 4);
+		}
+
+		for (int k = 0; k < Count; k++)
+		{
+			mThreads.emplace_back(&WorkerPool::_work, this);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(mMutex);
+			mStopped = true;
+		}
+		mCondition.notify_all();
+
+		for (auto& Thread : mThreads)
+		{
+			Thread.join();
+		}
+	}
+
+	void WorkerPool::enqueue(std::function<void()> Task)
+	{
+		if (mThreads.empty())
+		{
+			Task();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> Lock(mMutex);
+			mTasks.push_back(std::move(Task));
+		}
+		mCondition.notify_one();
+	}
+
+	void WorkerPool::parallelFor(const int &Begin, const int &End, const std::function<void(int, int)> &Function)
+	{
+		const int Count = End - Begin;
+
+		if (Count <= 0)
+		{
+			return;
+		}
+
+		const int Chunks = std::min(Count, (getThreadCount() + 1) * _def_ChunksPerThread);
+
+		if (Chunks < 2)
+		{
+			Function(Begin, End);
+			return;
+		}
+
+		struct Batch
+		{
+			std::atomic<int> Next;
+			std::atomic<int> Done;
+			std::mutex Mutex;
+			std::condition_variable Condition;
+			/// First exception thrown by Function, guarded by Mutex
+			std::exception_ptr Exception;
+		};
+
+		// Shared, since helpers might start after all chunks are done and this call has returned.
+		// They will then find no chunk to take, and never touch Function.
+		std::shared_ptr<Batch> State = std::make_shared<Batch>();
+		State->Next = 0;
+		State->Done = 0;
+
+		auto Run = [State, Begin, Count, Chunks, &Function]()
+		{
+			int Chunk;
+			while ((Chunk = State->Next++) < Chunks)
+			{
+				try
+				{
+					Function(Begin + Count * Chunk / Chunks, Begin + Count * (Chunk + 1) / Chunks);
+				}
+				catch (...)
+				{
+					// The chunk still counts as done, or the caller would wait forever
+					std::lock_guard<std::mutex> Lock(State->Mutex);
+					if (!State->Exception)
+					{
+						State->Exception = std::current_exception();
+					}
+				}
+
+				if (++State->Done == Chunks)
+				{
+					std::lock_guard<std::mutex> Lock(State->Mutex);
+					State->Condition.notify_all();
+				}
+			}
+		};
+
+		const int Helpers = std::min(getThreadCount(), Chunks - 1);
+		for (int k = 0; k < Helpers; k++)
+		{
+			enqueue(Run);
+		}
+
+		// If the workers are busy the calling thread will process all chunks by itself
+		Run();
+
+		std::unique_lock<std::mutex> Lock(State->Mutex);
+		State->Condition.wait(Lock, [&State, Chunks]() {return State->Done == Chunks;});
+
+		if (State->Exception)
+		{
+			std::rethrow_exception(State->Exception);
+		}
+	}
+
+	void WorkerPool::_work()
+	{
+		std::unique_lock<std::mutex> Lock(mMutex);
+
+		while (true)
+		{
+			mCondition.wait(Lock, [this]() {return mStopped || !mTasks.empty();});
+
+			if (mTasks.empty())
+			{
+				return;
+			}
+
+			std::function<void()> Task = std::move(mTasks.front());
+			mTasks.pop_front();
+
+			Lock.unlock();
+			Task();
+			Lock.lock();
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/*
+--------------------------------------------------------------------------------
+This source file is part of Hydrax.
+Visit ---
+
+Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+This program is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the Free Software
+Foundation; either version 2 of the License, or (at your option) any later
+version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License along with
+this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+http://www.gnu.org/copyleft/lesser.txt.
+--------------------------------------------------------------------------------
+*/
+
+#ifndef _Hydrax_WorkerPool_H_
+#define _Hydrax_WorkerPool_H_
+
+#include "Prerequisites.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Hydrax
+{
+	/** Small pool of worker threads, used to split the CPU side water
+	    simulation across cores.
+		If the pool has no threads everything runs in the calling thread.
+	 */
+	class DllExport WorkerPool
+	{
+	public:
+		/** Constructor
+		    @param Threads Number of worker threads, -1 to use a quarter of the hardware threads (at least one)
+			@remarks The terrain task queue and Ogre's work queue already keep most cores busy, so the
+			         default leaves room for them
+		 */
+		WorkerPool(const int &Threads = -1);
+
+		/** Destructor
+		    @remarks Waits for all queued tasks
+		 */
+		~WorkerPool();
+
+		/** Run a task in a worker thread
+		    @param Task Task to run
+		 */
+		void enqueue(std::function<void()> Task);
+
+		/** Split a range in chunks and process them in parallel, the calling thread included
+		    @param Begin First index
+			@param End One past the last index
+			@param Function Called with [begin, end) for each chunk
+			@remarks Returns when all chunks have been processed. Can be called from a task.
+			         If Function throws, the first exception is rethrown here once all chunks are done
+		 */
+		void parallelFor(const int &Begin, const int &End, const std::function<void(int, int)> &Function);
+
+		/** Get the number of worker threads
+		    @return Number of worker threads, not counting the calling thread
+		 */
+		inline int getThreadCount() const
+		{
+			return static_cast<int>(mThreads.size());
+		}
+
+	private:
+		/** Worker thread loop
+		 */
+		void _work();
+
+		/// Worker threads
+		std::vector<std::thread> mThreads;
+		/// Queued tasks
+		std::deque<std::function<void()> > mTasks;
+		/// Guards mTasks and mStopped
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		/// Set when the pool is being destroyed
+		bool mStopped;
+	};
+}
+
+#endif
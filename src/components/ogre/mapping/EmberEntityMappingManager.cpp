@@ -70,7 +70,7 @@ void EmberEntityMappingManager::parseScript (Ogre::DataStreamPtr &stream, const
 {
 	TiXmlDocument xmlDoc;
 	XMLHelper xmlHelper;
-	if (!xmlHelper.Load(xmlDoc, stream)) {
+	if (!xmlHelper.Load(xmlDoc, stream, groupName)) {
 		return;
 	}
 
@@ -26,6 +26,7 @@
 
 #include "ModelBackgroundLoader.h"
 #include "Model.h"
+#include "components/ogre/ResourcePreloader.h"
 #include "framework/TimeFrame.h"
 #include "framework/LoggingInstance.h"
 
@@ -66,6 +67,9 @@ ModelBackgroundLoader::~ModelBackgroundLoader() {
 	for (auto& ticket : mTickets) {
 		Ogre::ResourceBackgroundQueue::getSingleton().abortRequest(ticket);
 	}
+	if (ResourcePreloader::hasInstance()) {
+		ResourcePreloader::getSingleton().cancelUploads(this);
+	}
 }
 
 bool ModelBackgroundLoader::poll() {
@@ -76,9 +80,16 @@ bool ModelBackgroundLoader::poll() {
 	}
 
 	if (areAllTicketsProcessed()) {
-		MainLoopController::getSingleton().getEventService().runOnMainThread([this]() {
-			this->poll();
-		}, mIsActive);
+		//Uploads for models which are about to be shown should go before any preloading.
+		if (ResourcePreloader::hasInstance()) {
+			ResourcePreloader::getSingleton().addUpload(ResourcePreloader::PRIORITY_NEEDED, [this]() {
+				this->poll();
+			}, this);
+		} else {
+			MainLoopController::getSingleton().getEventService().runOnMainThread([this]() {
+				this->poll();
+			}, mIsActive);
+		}
 	}
 	return false;
 
@@ -66,7 +66,7 @@ void XMLModelDefinitionSerializer::parseScript(ModelDefinitionManager& modelDefM
 {
 	TiXmlDocument xmlDoc;
 	XMLHelper xmlHelper;
-	if (!xmlHelper.Load(xmlDoc, stream)) {
+	if (!xmlHelper.Load(xmlDoc, stream, groupName)) {
 		return;
 	}
 
@@ -39,7 +39,7 @@ namespace Ember
 namespace OgreView
 {
 	SoundAction::SoundAction(SoundEntity& soundEntity)
-	: mSoundEntity(soundEntity), mGroup(0), mInstance(0), mIsLooping(false)
+	: mSoundEntity(soundEntity), mGroup(0), mInstance(0), mIsLooping(false), mPriority(0)
 	{
 	}
 	
@@ -80,6 +80,7 @@ namespace OgreView
 		}
 
 		mGroup = newGroup;
+		mPriority = groupModel->getPriority();
 		return newGroup;
 	}
 
@@ -87,12 +88,13 @@ namespace OgreView
 	{
 		if (mGroup) {
 			if (!mInstance) {
-				mInstance = EmberServices::getSingleton().getSoundService().createInstance();
+				mInstance = EmberServices::getSingleton().getSoundService().createInstance(mPriority);
 				if (!mInstance) {
 					//The sound system seems to be disabled (could be for a valid reason) so just return without any fuss.
 					return;
 				}
 				mInstance->setMotionProvider(this);
+				mInstance->EventStolen.connect(sigc::mem_fun(*this, &SoundAction::SoundInstance_Stolen));
 				mInstance->setIsLooping(mIsLooping);
 				//If the sound is set not to loop, we need to listen for when it's done playing and remove the instance once it's done (to save on sound resources).
 				if (!mIsLooping) {
@@ -125,6 +127,12 @@ namespace OgreView
 		}
 	}
 	
+	void SoundAction::SoundInstance_Stolen()
+	{
+		//The sound service will destroy the instance itself.
+		mInstance = 0;
+	}
+	
 	SoundInstance* SoundAction::getInstance() const
 	{
 		return mInstance;
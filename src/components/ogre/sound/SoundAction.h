@@ -109,6 +109,12 @@ protected:
 	 * Note that if a sound is set to not loop, we must listen for the SoundInstance::EventPlayComplete so that we can remove the sound instance the momement it's done playing.
 	 */
 	bool mIsLooping;
+
+	/**
+	 * @brief The priority with which the sound instance should be created.
+	 * This is taken from the sound group definition.
+	 */
+	int mPriority;
 	
 	/**
 	 * @brief Listen for when the sound has been played to completion and then delete the instance.
@@ -116,6 +122,11 @@ protected:
 	 */
 	void SoundInstance_PlayComplete();
 
+	/**
+	 * @brief Listen for when the sound instance is taken by the sound service to play a sound with higher priority.
+	 */
+	void SoundInstance_Stolen();
+
 
 };
 }
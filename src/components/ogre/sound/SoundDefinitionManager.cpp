@@ -57,7 +57,7 @@ SoundDefinitionManager::~SoundDefinitionManager()
 
 void SoundDefinitionManager::parseScript (Ogre::DataStreamPtr &stream, const Ogre::String &groupName)
 {
-	mSoundParser->parseScript(stream);
+	mSoundParser->parseScript(stream, groupName);
 }
 
 Ogre::Resource* SoundDefinitionManager::createImpl(const Ogre::String& name, Ogre::ResourceHandle handle, const Ogre::String& group, bool isManual, Ogre::ManualResourceLoader* loader, const Ogre::NameValuePairList* createParams)
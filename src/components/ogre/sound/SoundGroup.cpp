@@ -49,8 +49,11 @@ SoundGroupBinding::SoundGroupBinding(SoundSource& source, SoundGroup& soundGroup
 	for (SoundGroup::SampleStore::const_iterator I = samples.begin(); I != samples.end(); ++I) 
 	{
 		BaseSoundSample::BufferStore sampleBuffers = (*I)->getBuffers();
-		pbuffers[i] = *(sampleBuffers.begin());
-		++i;
+		//Streamed samples have no buffers of their own, and can't be queued together with other samples.
+		if (!sampleBuffers.empty()) {
+			pbuffers[i] = *(sampleBuffers.begin());
+			++i;
+		}
 	}
 	alSourceQueueBuffers(source.getALSource(), i, pbuffers);
 // 	alSourcei(source.getALSource(), AL_BUFFER, sample.getBuffer());
@@ -157,6 +160,11 @@ void SoundGroupBinding::update()
 	
 	bool SoundGroup::bindToInstance(SoundInstance* instance)
 	{
+		//A single sample can provide its own binding, which is needed for streamed samples.
+		if (mSamples.size() == 1) {
+			instance->bind(mSamples.front()->createBinding(instance->getSource()));
+			return true;
+		}
 		SoundGroupBinding* binding = new SoundGroupBinding(instance->getSource(), *this);
 		instance->bind(binding);
 		return true;
@@ -34,6 +34,7 @@ namespace Ember {
 namespace OgreView {
 
 SoundGroupDefinition::SoundGroupDefinition()
+: mPriority(0)
 {
 }
 
@@ -57,6 +58,16 @@ const SoundGroupDefinition::SoundDefinitionStore& SoundGroupDefinition::getSound
 	return mSamples;
 }
 
+void SoundGroupDefinition::setPriority(int priority)
+{
+	mPriority = priority;
+}
+
+int SoundGroupDefinition::getPriority() const
+{
+	return mPriority;
+}
+
 
 }
 }
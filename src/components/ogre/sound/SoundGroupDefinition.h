@@ -55,11 +55,29 @@ public:
 	 */
 	const SoundDefinitionStore& getSoundDefinitions() const;
 
+	/**
+	 * @brief Sets the priority with which sounds from this group should be played.
+	 * @param priority The priority.
+	 */
+	void setPriority(int priority);
+
+	/**
+	 * @brief Gets the priority with which sounds from this group should be played.
+	 * When there are too many sounds playing, those with lower priority will be stopped to give room for those with higher priority.
+	 * @return The priority. The default is 0.
+	 */
+	int getPriority() const;
+
 private:
 	/**
 	 * @brief The sounds defined for this group.
 	 */
 	SoundDefinitionStore mSamples;
+
+	/**
+	 * @brief The priority of the sounds of this group.
+	 */
+	int mPriority;
 };
 
 }
@@ -39,11 +39,11 @@ XMLSoundDefParser::XMLSoundDefParser(SoundDefinitionManager& manager)
 }
 
 
-void XMLSoundDefParser::parseScript(Ogre::DataStreamPtr stream)
+void XMLSoundDefParser::parseScript(Ogre::DataStreamPtr stream, const std::string& groupName)
 {
 	TiXmlDocument xmlDoc;
 	XMLHelper xmlHelper;
-	if (!xmlHelper.Load(xmlDoc, stream)) 
+	if (!xmlHelper.Load(xmlDoc, stream, groupName)) 
 	{
 		return;
 	}
@@ -67,6 +67,12 @@ void XMLSoundDefParser::parseScript(Ogre::DataStreamPtr stream)
 			if (newModel)
 			{
 				S_LOG_INFO("Sound Model " << finalName << " created.");
+
+				const char* priority = smElem->Attribute("priority");
+				if (priority)
+				{
+					newModel->setPriority(atoi(priority));
+				}
 	
 				readBuffers(newModel, smElem);
 			}
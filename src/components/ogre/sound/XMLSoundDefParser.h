@@ -35,7 +35,7 @@ class XMLSoundDefParser
 {
 public:
 	XMLSoundDefParser(SoundDefinitionManager& manager);
-	void parseScript(Ogre::DataStreamPtr stream);
+	void parseScript(Ogre::DataStreamPtr stream, const std::string& groupName);
 
 private:
 	SoundDefinitionManager& mManager;
@@ -0,0 +1,243 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BlendMapCache.h"
+#include "BlendMapCompositor.h"
+#include "TerrainPage.h"
+#include "TerrainPageGeometry.h"
+#include "TerrainPageSurfaceLayer.h"
+
+#include <Mercator/Segment.h>
+#include <Mercator/Surface.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+bool BlendMapCache::Region::isEmpty() const
+{
+	return left >= right || top >= bottom;
+}
+
+void BlendMapCache::Region::merge(const Region& region)
+{
+	if (region.isEmpty()) {
+		return;
+	}
+	if (isEmpty()) {
+		*this = region;
+		return;
+	}
+	left = std::min(left, region.left);
+	top = std::min(top, region.top);
+	right = std::max(right, region.right);
+	bottom = std::max(bottom, region.bottom);
+}
+
+BlendMapCache::Region BlendMapCache::Region::getLevelRegion(size_t level, unsigned int width) const
+{
+	if (isEmpty()) {
+		return Region { 0, 0, 0, 0 };
+	}
+	unsigned int levelWidth = BlendMapCompositor::getLevelWidth(width, level);
+	if (level >= sizeof(unsigned int) * 8) {
+		return Region { 0, 0, levelWidth, levelWidth };
+	}
+	//Each pixel in a level covers 2*2 pixels in the level above, so round outwards.
+	unsigned int divisor = 1u << level;
+	return Region { std::min(left / divisor, levelWidth), std::min(top / divisor, levelWidth), std::min((right + divisor - 1) / divisor, levelWidth), std::min(
+			(bottom + divisor - 1) / divisor, levelWidth) };
+}
+
+BlendMapCache::BlendMapCache(const TerrainPage& page) :
+		mPage(page)
+{
+}
+
+void BlendMapCache::markDirty(const WFMath::AxisBox<2>& area)
+{
+	int segmentsPerAxis = mPage.getNumberOfSegmentsPerAxis();
+	if (!area.isValid() || segmentsPerAxis <= 0) {
+		return;
+	}
+	const WFMath::AxisBox<2>& extent = mPage.getWorldExtent();
+	float segmentSize = (extent.highCorner().x() - extent.lowCorner().x()) / segmentsPerAxis;
+
+	//Neighbouring segments share their edges, so an area touching an edge affects the segments on both sides.
+	int xMin = std::max(0, static_cast<int>(std::ceil((area.lowCorner().x() - extent.lowCorner().x()) / segmentSize)) - 1);
+	int xMax = std::min(segmentsPerAxis - 1, static_cast<int>(std::floor((area.highCorner().x() - extent.lowCorner().x()) / segmentSize)));
+	int yMin = std::max(0, static_cast<int>(std::ceil((area.lowCorner().y() - extent.lowCorner().y()) / segmentSize)) - 1);
+	int yMax = std::min(segmentsPerAxis - 1, static_cast<int>(std::floor((area.highCorner().y() - extent.lowCorner().y()) / segmentSize)));
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& entry : mEntries) {
+		for (int x = xMin; x <= xMax; ++x) {
+			for (int y = yMin; y <= yMax; ++y) {
+				entry.second.dirtySegments.insert(std::make_pair(x, y));
+			}
+		}
+	}
+}
+
+std::shared_ptr<const BlendMapCache::BlendMap> BlendMapCache::compose(const std::string& key, const TerrainPageGeometry& geometry, const std::vector<const TerrainPageSurfaceLayer*>& layers)
+{
+	std::vector<int> layerIndices;
+	for (auto layer : layers) {
+		layerIndices.push_back(layer->getSurfaceIndex());
+	}
+	unsigned int width = static_cast<unsigned int>(mPage.getBlendMapSize());
+	SegmentVector segments = geometry.getValidSegments();
+
+	//Keep the lock while composing, so that any concurrent compositions of the same page will build upon each other.
+	std::lock_guard<std::mutex> lock(mMutex);
+	Entry& entry = mEntries[key];
+
+	if (entry.blendMap && entry.layerIndices == layerIndices && entry.blendMap->width == width) {
+		if (entry.dirtySegments.empty()) {
+			return entry.blendMap;
+		}
+		std::map<std::pair<int, int>, const Mercator::Segment*> segmentsByIndex;
+		for (auto& pageSegment : segments) {
+			segmentsByIndex.emplace(std::make_pair(static_cast<int>(pageSegment.index.x()), static_cast<int>(pageSegment.index.y())), pageSegment.segment);
+		}
+
+		std::shared_ptr<BlendMap> blendMap(new BlendMap(*entry.blendMap));
+		Region region { 0, 0, 0, 0 };
+		for (auto& segmentIndex : entry.dirtySegments) {
+			auto I = segmentsByIndex.find(segmentIndex);
+			region.merge(composeSegment(*blendMap, segmentIndex, I == segmentsByIndex.end() ? nullptr : I->second, layers));
+		}
+		generateMipmaps(*blendMap, region);
+
+		entry.blendMap = blendMap;
+		entry.dirtySegments.clear();
+		entry.uploadRegion.merge(region);
+		return blendMap;
+	}
+
+	std::shared_ptr<BlendMap> blendMap(new BlendMap());
+	blendMap->width = width;
+	size_t levelCount = BlendMapCompositor::getLevelCount(width);
+	for (size_t level = 0; level < levelCount; ++level) {
+		unsigned int levelWidth = BlendMapCompositor::getLevelWidth(width, level);
+		blendMap->levels.emplace_back(static_cast<size_t>(levelWidth) * levelWidth * 4, 0);
+	}
+	for (auto& pageSegment : segments) {
+		composeSegment(*blendMap, std::make_pair(static_cast<int>(pageSegment.index.x()), static_cast<int>(pageSegment.index.y())), pageSegment.segment, layers);
+	}
+	Region region { 0, 0, width, width };
+	generateMipmaps(*blendMap, region);
+
+	entry.layerIndices = layerIndices;
+	entry.blendMap = blendMap;
+	entry.dirtySegments.clear();
+	entry.uploadRegion = region;
+	return blendMap;
+}
+
+BlendMapCache::Region BlendMapCache::takeUploadRegion(const std::string& key, const std::shared_ptr<const BlendMap>& blendMap, bool isNewTexture)
+{
+	Region fullRegion { 0, 0, blendMap->width, blendMap->width };
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(key);
+	if (I == mEntries.end()) {
+		return fullRegion;
+	}
+	Entry& entry = I->second;
+	if (entry.blendMap != blendMap) {
+		//The blend map has been composed anew since this one was; the texture won't match either of them, so both need to be uploaded in full.
+		entry.uploadRegion = Region { 0, 0, entry.blendMap->width, entry.blendMap->width };
+		return fullRegion;
+	}
+	Region region = isNewTexture ? fullRegion : entry.uploadRegion;
+	entry.uploadRegion = Region { 0, 0, 0, 0 };
+	return region;
+}
+
+std::vector<BlendMapCache::StoredBlendMap> BlendMapCache::getBlendMaps() const
+{
+	std::vector<StoredBlendMap> blendMaps;
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& entry : mEntries) {
+		if (entry.second.blendMap && entry.second.dirtySegments.empty()) {
+			blendMaps.push_back(StoredBlendMap { entry.first, entry.second.layerIndices, entry.second.blendMap });
+		}
+	}
+	return blendMaps;
+}
+
+void BlendMapCache::restore(const std::vector<StoredBlendMap>& blendMaps)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto& storedBlendMap : blendMaps) {
+		Entry& entry = mEntries[storedBlendMap.key];
+		entry.layerIndices = storedBlendMap.layerIndices;
+		entry.blendMap = storedBlendMap.blendMap;
+		entry.dirtySegments.clear();
+		entry.uploadRegion = Region { 0, 0, storedBlendMap.blendMap->width, storedBlendMap.blendMap->width };
+	}
+}
+
+BlendMapCache::Region BlendMapCache::composeSegment(BlendMap& blendMap, const std::pair<int, int>& segmentIndex, const Mercator::Segment* segment,
+		const std::vector<const TerrainPageSurfaceLayer*>& layers) const
+{
+	int segmentsPerAxis = mPage.getNumberOfSegmentsPerAxis();
+	if (segmentIndex.first < 0 || segmentIndex.first >= segmentsPerAxis || segmentIndex.second < 0 || segmentIndex.second >= segmentsPerAxis) {
+		return Region { 0, 0, 0, 0 };
+	}
+	unsigned int resolution = blendMap.width / segmentsPerAxis;
+	//Ogre's vertical axis is the reverse of Worldforge's.
+	Region region { segmentIndex.first * resolution, (segmentsPerAxis - segmentIndex.second - 1) * resolution, (segmentIndex.first + 1) * resolution, (segmentsPerAxis
+			- segmentIndex.second) * resolution };
+
+	//Any channel without coverage is cleared.
+	const unsigned char* coverage[4] = { nullptr, nullptr, nullptr, nullptr };
+	if (segment && static_cast<unsigned int>(segment->getResolution()) == resolution) {
+		for (size_t i = 0; i < layers.size() && i < 4; ++i) {
+			Mercator::Surface* surface = layers[i]->getCoverageSurface(*segment);
+			if (surface) {
+				coverage[i] = surface->getData();
+			}
+		}
+	}
+	BlendMapCompositor::composeSegment(coverage, 4, 0, resolution, blendMap.levels[0].data(), 4, blendMap.width, region.left, region.top);
+	return region;
+}
+
+void BlendMapCache::generateMipmaps(BlendMap& blendMap, const Region& region)
+{
+	for (size_t level = 1; level < blendMap.levels.size(); ++level) {
+		Region levelRegion = region.getLevelRegion(level, blendMap.width);
+		BlendMapCompositor::generateMipmap(blendMap.levels[level - 1].data(), BlendMapCompositor::getLevelWidth(blendMap.width, level - 1), blendMap.levels[level].data(), 4,
+				levelRegion.left, levelRegion.top, levelRegion.right, levelRegion.bottom);
+	}
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,216 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_BLENDMAPCACHE_H_
+#define EMBEROGRE_TERRAIN_BLENDMAPCACHE_H_
+
+#include <wfmath/axisbox.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Mercator
+{
+class Segment;
+}
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+class TerrainPage;
+class TerrainPageGeometry;
+class TerrainPageSurfaceLayer;
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Keeps the combined blend maps of a terrain page between material compilations.
+ *
+ * A combined blend map holds the coverage of up to four layers, one in each channel, along with all of its mipmaps.
+ * When a material is compiled anew only the segments which have been marked as dirty since the last time need to be composed, and only those parts
+ * need to be uploaded to the texture.
+ *
+ * Each blend map is identified by a key, which is the name of the texture it's uploaded to. If the layers of a blend map change it's composed in full.
+ *
+ * Composed blend maps are never altered, so they can be safely used by any thread once obtained.
+ */
+class BlendMapCache
+{
+public:
+
+	/**
+	 * @brief A rectangle of pixels, in the full size image.
+	 */
+	struct Region
+	{
+		unsigned int left;
+		unsigned int top;
+		unsigned int right;
+		unsigned int bottom;
+
+		bool isEmpty() const;
+
+		/**
+		 * @brief Extends the region to also cover another region.
+		 */
+		void merge(const Region& region);
+
+		/**
+		 * @brief Gets the corresponding region in a mipmap level.
+		 * @param level The mipmap level.
+		 * @param width The width of the full size image.
+		 */
+		Region getLevelRegion(size_t level, unsigned int width) const;
+	};
+
+	/**
+	 * @brief A composed blend map, with four interleaved channels.
+	 */
+	struct BlendMap
+	{
+		/**
+		 * @brief The width of the full size image.
+		 */
+		unsigned int width;
+
+		/**
+		 * @brief The image data, first the full size image and then each mipmap down to one pixel.
+		 */
+		std::vector<std::vector<unsigned char>> levels;
+	};
+
+	/**
+	 * @brief A composed blend map along with what's needed to put it back in the cache, as stored by TerrainPageCache.
+	 */
+	struct StoredBlendMap
+	{
+		std::string key;
+
+		/**
+		 * @brief The surface indices of the layers in the blend map.
+		 */
+		std::vector<int> layerIndices;
+
+		std::shared_ptr<const BlendMap> blendMap;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param page The page to which the blend maps belong.
+	 */
+	explicit BlendMapCache(const TerrainPage& page);
+
+	/**
+	 * @brief Marks the segments affected by a change to the terrain as dirty, so that they're composed anew.
+	 *
+	 * This must be called for any changes which affect the surfaces of the segments, before the material is compiled.
+	 * @param area The changed area, in world units.
+	 */
+	void markDirty(const WFMath::AxisBox<2>& area);
+
+	/**
+	 * @brief Gets a blend map with the current coverage of a number of layers.
+	 *
+	 * This is done in the background, as part of preparing the material.
+	 * @param key The key of the blend map.
+	 * @param geometry The geometry of the page.
+	 * @param layers The layers, at most four.
+	 * @return A blend map.
+	 */
+	std::shared_ptr<const BlendMap> compose(const std::string& key, const TerrainPageGeometry& geometry, const std::vector<const TerrainPageSurfaceLayer*>& layers);
+
+	/**
+	 * @brief Gets the region of a blend map which needs to be uploaded to its texture.
+	 *
+	 * This is done in the main thread, when the material is compiled. The region is considered uploaded once returned.
+	 * @param key The key of the blend map.
+	 * @param blendMap The blend map which will be uploaded.
+	 * @param isNewTexture True if the texture has just been created, and thus has no content.
+	 * @return The region to upload; possibly empty.
+	 */
+	Region takeUploadRegion(const std::string& key, const std::shared_ptr<const BlendMap>& blendMap, bool isNewTexture);
+
+	/**
+	 * @brief Gets all blend maps which are up to date with the surfaces.
+	 * @return The blend maps.
+	 */
+	std::vector<StoredBlendMap> getBlendMaps() const;
+
+	/**
+	 * @brief Puts previously composed blend maps in the cache, replacing any existing ones with the same keys.
+	 *
+	 * The surfaces of the page must match those the blend maps were composed from. The blend maps will be uploaded in full.
+	 * @param blendMaps The blend maps.
+	 */
+	void restore(const std::vector<StoredBlendMap>& blendMaps);
+
+private:
+
+	struct Entry
+	{
+		/**
+		 * @brief The surface indices of the layers in the blend map.
+		 */
+		std::vector<int> layerIndices;
+
+		std::shared_ptr<const BlendMap> blendMap;
+
+		/**
+		 * @brief Segments, in local page indices, which have changed since the blend map was composed.
+		 */
+		std::set<std::pair<int, int>> dirtySegments;
+
+		/**
+		 * @brief The region of the blend map which differs from what was last uploaded to the texture.
+		 */
+		Region uploadRegion;
+	};
+
+	const TerrainPage& mPage;
+
+	std::map<std::string, Entry> mEntries;
+
+	mutable std::mutex mMutex;
+
+	/**
+	 * @brief Composes a segment into a blend map.
+	 * @param segmentIndex The local index of the segment.
+	 * @param segment The Mercator segment, or null if there is no valid segment.
+	 * @return The region composed.
+	 */
+	Region composeSegment(BlendMap& blendMap, const std::pair<int, int>& segmentIndex, const Mercator::Segment* segment, const std::vector<const TerrainPageSurfaceLayer*>& layers) const;
+
+	static void generateMipmaps(BlendMap& blendMap, const Region& region);
+};
+
+}
+
+}
+
+}
+
+#endif /* EMBEROGRE_TERRAIN_BLENDMAPCACHE_H_ */
@@ -0,0 +1,241 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BlendMapCompositor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+namespace
+{
+
+/**
+ * @brief Averages the four samples surrounding each pixel of a row.
+ * @param upper The upper row of samples, with count + 1 samples.
+ * @param lower The lower row of samples, with count + 1 samples.
+ * @param destination The resulting pixels.
+ * @param count The number of pixels.
+ */
+void averageRow(const unsigned char* upper, const unsigned char* lower, unsigned char* destination, unsigned int count)
+{
+	unsigned int i = 0;
+	//The sums are done in 16 bits, so that the result is exactly the same as the scalar code below.
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16) {
+		__m128i upperLeft = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + i));
+		__m128i upperRight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + i + 1));
+		__m128i lowerLeft = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + i));
+		__m128i lowerRight = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + i + 1));
+		__m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(upperLeft, zero), _mm_unpacklo_epi8(upperRight, zero)),
+				_mm_add_epi16(_mm_unpacklo_epi8(lowerLeft, zero), _mm_unpacklo_epi8(lowerRight, zero)));
+		__m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(upperLeft, zero), _mm_unpackhi_epi8(upperRight, zero)),
+				_mm_add_epi16(_mm_unpackhi_epi8(lowerLeft, zero), _mm_unpackhi_epi8(lowerRight, zero)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(_mm_srli_epi16(low, 2), _mm_srli_epi16(high, 2)));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint16x8_t low = vaddw_u8(vaddw_u8(vaddl_u8(vld1_u8(upper + i), vld1_u8(upper + i + 1)), vld1_u8(lower + i)), vld1_u8(lower + i + 1));
+		uint16x8_t high = vaddw_u8(vaddw_u8(vaddl_u8(vld1_u8(upper + i + 8), vld1_u8(upper + i + 9)), vld1_u8(lower + i + 8)), vld1_u8(lower + i + 9));
+		vst1q_u8(destination + i, vcombine_u8(vshrn_n_u16(low, 2), vshrn_n_u16(high, 2)));
+	}
+#endif
+	for (; i < count; ++i) {
+		destination[i] = static_cast<unsigned char>((upper[i] + upper[i + 1] + lower[i] + lower[i + 1]) / 4);
+	}
+}
+
+/**
+ * @brief Interleaves four rows into a row of four channel pixels.
+ */
+void interleaveRows(const unsigned char* first, const unsigned char* second, const unsigned char* third, const unsigned char* fourth, unsigned char* destination, unsigned int count)
+{
+	unsigned int i = 0;
+#if defined(__SSE2__)
+	for (; i + 16 <= count; i += 16) {
+		__m128i firstValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+		__m128i secondValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i));
+		__m128i thirdValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(third + i));
+		__m128i fourthValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fourth + i));
+		//First pair up the first and second, and third and fourth, channels; then pair up those pairs.
+		__m128i pairsLow = _mm_unpacklo_epi8(firstValues, secondValues);
+		__m128i pairsHigh = _mm_unpackhi_epi8(firstValues, secondValues);
+		__m128i otherPairsLow = _mm_unpacklo_epi8(thirdValues, fourthValues);
+		__m128i otherPairsHigh = _mm_unpackhi_epi8(thirdValues, fourthValues);
+		unsigned char* pixels = destination + i * 4;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), _mm_unpacklo_epi16(pairsLow, otherPairsLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 16), _mm_unpackhi_epi16(pairsLow, otherPairsLow));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 32), _mm_unpacklo_epi16(pairsHigh, otherPairsHigh));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 48), _mm_unpackhi_epi16(pairsHigh, otherPairsHigh));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t pixels;
+		pixels.val[0] = vld1q_u8(first + i);
+		pixels.val[1] = vld1q_u8(second + i);
+		pixels.val[2] = vld1q_u8(third + i);
+		pixels.val[3] = vld1q_u8(fourth + i);
+		vst4q_u8(destination + i * 4, pixels);
+	}
+#endif
+	for (; i < count; ++i) {
+		destination[i * 4] = first[i];
+		destination[i * 4 + 1] = second[i];
+		destination[i * 4 + 2] = third[i];
+		destination[i * 4 + 3] = fourth[i];
+	}
+}
+
+inline unsigned char average(unsigned char a, unsigned char b)
+{
+	return static_cast<unsigned char>((a + b + 1) / 2);
+}
+}
+
+void BlendMapCompositor::composeSegment(const unsigned char* const* layers, unsigned int layerCount, unsigned int firstChannel, unsigned int resolution,
+		unsigned char* destination, unsigned int channels, unsigned int width, unsigned int xOffset, unsigned int yOffset)
+{
+	const unsigned int segmentSize = resolution + 1;
+	const bool writeDirectly = channels == 1 && layerCount == 1;
+	std::vector<unsigned char> rows(writeDirectly ? 0 : layerCount * resolution);
+
+	for (unsigned int i = 0; i < resolution; ++i) {
+		//Mercator rows go upwards, Ogre rows go downwards.
+		unsigned char* destinationRow = destination + ((static_cast<size_t>(yOffset) + resolution - 1 - i) * width + xOffset) * channels;
+
+		if (writeDirectly) {
+			if (layers[0]) {
+				averageRow(layers[0] + i * segmentSize, layers[0] + (i + 1) * segmentSize, destinationRow, resolution);
+			} else {
+				std::memset(destinationRow, 0, resolution);
+			}
+			continue;
+		}
+
+		for (unsigned int layer = 0; layer < layerCount; ++layer) {
+			unsigned char* row = rows.data() + layer * resolution;
+			if (layers[layer]) {
+				averageRow(layers[layer] + i * segmentSize, layers[layer] + (i + 1) * segmentSize, row, resolution);
+			} else {
+				std::memset(row, 0, resolution);
+			}
+		}
+
+		if (channels == 4 && layerCount == 4 && firstChannel == 0) {
+			interleaveRows(rows.data(), rows.data() + resolution, rows.data() + resolution * 2, rows.data() + resolution * 3, destinationRow, resolution);
+		} else {
+			for (unsigned int layer = 0; layer < layerCount; ++layer) {
+				const unsigned char* row = rows.data() + layer * resolution;
+				unsigned char* pixel = destinationRow + firstChannel + layer;
+				for (unsigned int j = 0; j < resolution; ++j) {
+					*pixel = row[j];
+					pixel += channels;
+				}
+			}
+		}
+	}
+}
+
+unsigned int BlendMapCompositor::getLevelWidth(unsigned int width, size_t level)
+{
+	if (level >= sizeof(unsigned int) * 8) {
+		return 1;
+	}
+	return std::max(1u, width >> level);
+}
+
+size_t BlendMapCompositor::getLevelCount(unsigned int width)
+{
+	size_t count = 1;
+	while (width > 1) {
+		width /= 2;
+		count++;
+	}
+	return count;
+}
+
+void BlendMapCompositor::generateMipmap(const unsigned char* source, unsigned int sourceWidth, unsigned char* destination, unsigned int channels,
+		unsigned int left, unsigned int top, unsigned int right, unsigned int bottom)
+{
+	const unsigned int width = getLevelWidth(sourceWidth, 1);
+	const size_t sourceStride = static_cast<size_t>(sourceWidth) * channels;
+
+	for (unsigned int y = top; y < bottom; ++y) {
+		const unsigned char* upper = source + std::min(y * 2, sourceWidth - 1) * sourceStride;
+		const unsigned char* lower = source + std::min(y * 2 + 1, sourceWidth - 1) * sourceStride;
+		unsigned char* destinationRow = destination + static_cast<size_t>(y) * width * channels;
+
+		unsigned int x = left;
+		//Average horizontally first, then vertically; the scalar code below does the same, so that the rounding matches.
+#if defined(__SSE2__)
+		if (channels == 4) {
+			for (; x + 4 <= right && (x + 4) * 2 <= sourceWidth; x += 4) {
+				__m128i upperFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + x * 8));
+				__m128i upperSecond = _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper + x * 8 + 16));
+				__m128i lowerFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + x * 8));
+				__m128i lowerSecond = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + x * 8 + 16));
+				//Separate the even and odd pixels.
+				__m128i upperEven = _mm_unpacklo_epi64(_mm_shuffle_epi32(upperFirst, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(upperSecond, _MM_SHUFFLE(2, 0, 2, 0)));
+				__m128i upperOdd = _mm_unpacklo_epi64(_mm_shuffle_epi32(upperFirst, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(upperSecond, _MM_SHUFFLE(3, 1, 3, 1)));
+				__m128i lowerEven = _mm_unpacklo_epi64(_mm_shuffle_epi32(lowerFirst, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(lowerSecond, _MM_SHUFFLE(2, 0, 2, 0)));
+				__m128i lowerOdd = _mm_unpacklo_epi64(_mm_shuffle_epi32(lowerFirst, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(lowerSecond, _MM_SHUFFLE(3, 1, 3, 1)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destinationRow + x * 4), _mm_avg_epu8(_mm_avg_epu8(upperEven, upperOdd), _mm_avg_epu8(lowerEven, lowerOdd)));
+			}
+		}
+#elif defined(__ARM_NEON)
+		if (channels == 4) {
+			for (; x + 4 <= right && (x + 4) * 2 <= sourceWidth; x += 4) {
+				uint32x4x2_t upperPixels = vld2q_u32(reinterpret_cast<const uint32_t*>(upper + x * 8));
+				uint32x4x2_t lowerPixels = vld2q_u32(reinterpret_cast<const uint32_t*>(lower + x * 8));
+				uint8x16_t upperAverage = vrhaddq_u8(vreinterpretq_u8_u32(upperPixels.val[0]), vreinterpretq_u8_u32(upperPixels.val[1]));
+				uint8x16_t lowerAverage = vrhaddq_u8(vreinterpretq_u8_u32(lowerPixels.val[0]), vreinterpretq_u8_u32(lowerPixels.val[1]));
+				vst1q_u8(destinationRow + x * 4, vrhaddq_u8(upperAverage, lowerAverage));
+			}
+		}
+#endif
+		for (; x < right; ++x) {
+			const size_t first = std::min(x * 2, sourceWidth - 1) * channels;
+			const size_t second = std::min(x * 2 + 1, sourceWidth - 1) * channels;
+			for (unsigned int channel = 0; channel < channels; ++channel) {
+				destinationRow[x * channels + channel] = average(average(upper[first + channel], upper[second + channel]), average(lower[first + channel], lower[second + channel]));
+			}
+		}
+	}
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_BLENDMAPCOMPOSITOR_H_
+#define EMBEROGRE_TERRAIN_BLENDMAPCOMPOSITOR_H_
+
+#include <cstddef>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Kernels for writing the coverage of terrain layers into blend map images.
+ *
+ * The images are square, with the channels of each pixel interleaved. The coverage data comes from Mercator surfaces, which have one more sample per axis than
+ * the segment has pixels; each pixel gets the average of the four samples surrounding it. Since Mercator and Ogre use different vertical directions, the rows
+ * of a segment are written bottom up.
+ *
+ * SSE2 or NEON is used when available, with scalar code for any remaining pixels. The results are the same whichever is used.
+ */
+class BlendMapCompositor
+{
+public:
+
+	/**
+	 * @brief Writes the coverage of a segment for a number of layers into an image, in one pass.
+	 *
+	 * Channels outside the range written to are left untouched.
+	 * @param layers The coverage data of each layer, i.e. the data of its Mercator surface, with (resolution + 1) * (resolution + 1) samples.
+	 * A null pointer clears the channel.
+	 * @param layerCount The number of layers. The first layer is written to "firstChannel", the next to the channel after it, and so on.
+	 * @param firstChannel The channel to which the first layer is written.
+	 * @param resolution The resolution of the segment, i.e. the number of pixels per axis it covers in the image.
+	 * @param destination The image data.
+	 * @param channels The number of channels in the image.
+	 * @param width The width of the image, in pixels.
+	 * @param xOffset The horizontal pixel position of the segment in the image.
+	 * @param yOffset The vertical pixel position of the segment in the image.
+	 */
+	static void composeSegment(const unsigned char* const* layers, unsigned int layerCount, unsigned int firstChannel, unsigned int resolution,
+			unsigned char* destination, unsigned int channels, unsigned int width, unsigned int xOffset, unsigned int yOffset);
+
+	/**
+	 * @brief Gets the width of a mipmap level.
+	 * @param width The width of the full image.
+	 * @param level The mipmap level, where 0 is the full image.
+	 */
+	static unsigned int getLevelWidth(unsigned int width, size_t level);
+
+	/**
+	 * @brief Gets the number of mipmap levels of an image, including the full image, down to a size of one pixel.
+	 * @param width The width of the full image.
+	 */
+	static size_t getLevelCount(unsigned int width);
+
+	/**
+	 * @brief Updates a region of a mipmap level by filtering the level above it.
+	 *
+	 * Each pixel gets the average of the 2*2 pixels it covers in the source, where any pixel outside of the source is clamped to its edge.
+	 * @param source The image data of the level above.
+	 * @param sourceWidth The width of the level above.
+	 * @param destination The image data of the level to update, with a width as given by getLevelWidth().
+	 * @param channels The number of channels in both images.
+	 * @param left The first column to update.
+	 * @param top The first row to update.
+	 * @param right The column after the last one to update.
+	 * @param bottom The row after the last one to update.
+	 */
+	static void generateMipmap(const unsigned char* source, unsigned int sourceWidth, unsigned char* destination, unsigned int channels,
+			unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+};
+
+}
+
+}
+
+}
+
+#endif /* EMBEROGRE_TERRAIN_BLENDMAPCOMPOSITOR_H_ */
@@ -55,9 +55,58 @@ GeometryUpdateTask::~GeometryUpdateTask()
 {
 }
 
+namespace
+{
+/**
+ * @brief Updates the geometry of a single page, and then its shaders.
+ *
+ * Since the shaders depend on the geometry, the shader update is executed as a subtask once the geometry has been repopulated. Pages are independent of each other, so one of these can be run for each page in parallel.
+ */
+class PageGeometryUpdateTask : public Tasks::TemplateNamedTask<PageGeometryUpdateTask>
+{
+public:
+	PageGeometryUpdateTask(TerrainPageGeometryPtr geometry, const std::vector<const TerrainShader*>& shaders, const std::vector<WFMath::AxisBox<2>>& areas, TerrainHandler& handler, const WFMath::Vector<3>& lightDirection, std::vector<Mercator::Segment*>& segments) :
+		mGeometry(geometry), mShaders(shaders), mAreas(areas), mHandler(handler), mLightDirection(lightDirection), mSegments(segments)
+	{
+	}
+
+	virtual void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
+	{
+		//If the page is in the page cache its surfaces, blend maps and shadow are restored along with the geometry, and needn't be generated.
+		TerrainPageCache::Key key;
+		bool isRestored = mHandler.restorePageFromCache(*mGeometry, mShaders, key);
+		mGeometry->repopulate();
+		const SegmentVector& segmentVector = mGeometry->getValidSegments();
+		for (SegmentVector::const_iterator I = segmentVector.begin(); I != segmentVector.end(); ++I) {
+			mSegments.push_back(I->segment);
+		}
+		GeometryPtrVector geometries;
+		geometries.push_back(mGeometry);
+
+		context.executeTask(new TerrainShaderUpdateTask(geometries, mShaders, mAreas, mHandler.EventLayerUpdated, mHandler.EventTerrainMaterialRecompiled, mLightDirection, !isRestored));
+		//The material has now been prepared, so the page is complete.
+		if (!isRestored) {
+			mHandler.storePageInCache(key, *mGeometry);
+		}
+		mGeometry.reset();
+	}
+
+private:
+	TerrainPageGeometryPtr mGeometry;
+	const std::vector<const TerrainShader*>& mShaders;
+	const std::vector<WFMath::AxisBox<2>>& mAreas;
+	TerrainHandler& mHandler;
+	const WFMath::Vector<3> mLightDirection;
+
+	/**
+	 * @brief The segments of the page are added here. This is only touched by this task.
+	 */
+	std::vector<Mercator::Segment*>& mSegments;
+};
+}
+
 void GeometryUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
 {
-	std::vector<Mercator::Segment*> segments;
 	// build a vector of shaders so we can more efficiently update them
 	std::vector<const Terrain::TerrainShader*> shaderList;
 
@@ -65,18 +114,17 @@ void GeometryUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionConte
 		shaderList.push_back(entry.second);
 	}
 
-	//first populate the geometry for all pages, and then regenerate the shaders
-	for (BridgeBoundGeometryPtrVector::const_iterator I = mGeometry.begin(); I != mGeometry.end(); ++I) {
-		TerrainPageGeometryPtr geometry = I->first;
-		geometry->repopulate();
-		const SegmentVector& segmentVector = geometry->getValidSegments();
-		for (SegmentVector::const_iterator I = segmentVector.begin(); I != segmentVector.end(); ++I) {
-			segments.push_back(I->segment);
-		}
-		GeometryPtrVector geometries;
-		geometries.push_back(geometry);
+	//Populate the geometry for all pages, and then regenerate their shaders. Each page is handled separately, in parallel if there are idle executors.
+	std::vector<std::vector<Mercator::Segment*>> segmentsPerPage(mGeometry.size());
+	std::vector<Tasks::ITask*> pageTasks;
+	for (size_t i = 0; i < mGeometry.size(); ++i) {
+		pageTasks.push_back(new PageGeometryUpdateTask(mGeometry[i].first, shaderList, mAreas, mHandler, mLightDirection, segmentsPerPage[i]));
+	}
+	context.executeTasksInParallel(pageTasks);
 
-		context.executeTask(new TerrainShaderUpdateTask(geometries, shaderList, mAreas, mHandler.EventLayerUpdated, mHandler.EventTerrainMaterialRecompiled, mLightDirection));
+	std::vector<Mercator::Segment*> segments;
+	for (auto& pageSegments : segmentsPerPage) {
+		segments.insert(segments.end(), pageSegments.begin(), pageSegments.end());
 	}
 	context.executeTask(new HeightMapUpdateTask(mHeightMapBufferProvider, mHeightMap, segments));
 
@@ -20,6 +20,7 @@
 #include "IHeightMapSegment.h"
 #include "framework/LoggingInstance.h"
 #include <wfmath/vector.h>
+#include <wfmath/point.h>
 
 //MSVC 11.0 doesn't support std::lround so we'll use boost. When MSVC gains support for std::lround this could be removed.
 #ifdef _MSC_VER
@@ -49,20 +50,12 @@ HeightMap::~HeightMap()
 
 void HeightMap::insert(int xIndex, int yIndex, IHeightMapSegment* segment)
 {
-	mSegments[xIndex][yIndex] = std::shared_ptr < IHeightMapSegment > (segment);
+	mSegments[packIndex(xIndex, yIndex)].reset(segment);
 }
 
 bool HeightMap::remove(int xIndex, int yIndex)
 {
-	Segmentstore::iterator column = mSegments.find(xIndex);
-	if (column != mSegments.end()) {
-		Segmentcolumn::iterator row = column->second.find(yIndex);
-		if (row != column->second.end()) {
-			column->second.erase(row);
-			return true;
-		}
-	}
-	return false;
+	return mSegments.erase(packIndex(xIndex, yIndex)) != 0;
 }
 
 void HeightMap::blitHeights(int xMin, int xMax, int yMin, int yMax, std::vector<float>& heights) const
@@ -78,9 +71,8 @@ void HeightMap::blitHeights(int xMin, int xMax, int yMin, int yMax, std::vector<
 	for (int segmentX = segmentXMin; segmentX <= segmentXMax; ++segmentX) {
 		for (int segmentY = segmentYMin; segmentY <= segmentYMax; ++segmentY) {
 
-			auto segmentPtr = getSegment(segmentX, segmentY);
-			if (segmentPtr) {
-				auto segment = segmentPtr.get();
+			auto segment = getSegment(segmentX, segmentY);
+			if (segment) {
 
 				int segmentXStart = segmentX * mSegmentResolution;
 				int segmentYStart = segmentY * mSegmentResolution;
@@ -92,9 +84,10 @@ void HeightMap::blitHeights(int xMin, int xMax, int yMin, int yMax, std::vector<
 				int xEnd = std::min<int>(xMax - segmentXStart, mSegmentResolution);
 				int yEnd = std::min<int>(yMax - segmentYStart, mSegmentResolution);
 
-				for (int x = xStart; x < xEnd; ++x) {
+				//Copy row by row, since both the segment data and the destination are laid out in rows.
+				if (xStart < xEnd) {
 					for (int y = yStart; y < yEnd; ++y) {
-						heights[((dataYOffset + y) * xSize) + (dataXOffset + x)] = segment->getHeight(x, y);
+						segment->getHeightRow(xStart, xEnd, y, &heights[((dataYOffset + y) * xSize) + (dataXOffset + xStart)]);
 					}
 				}
 			}
@@ -107,8 +100,8 @@ float HeightMap::getHeight(float x, float y) const
 	int ix = I_ROUND(floor(x / mSegmentResolution));
 	int iy = I_ROUND(floor(y / mSegmentResolution));
 
-	std::shared_ptr<IHeightMapSegment> segment(getSegment(ix, iy));
-	if (!segment.get()) {
+	auto segment = getSegment(ix, iy);
+	if (!segment) {
 		return mDefaultLevel;
 	}
 	return segment->getHeight(I_ROUND(x) - (ix * mSegmentResolution), I_ROUND(y) - (iy * mSegmentResolution));
@@ -120,25 +113,83 @@ bool HeightMap::getHeightAndNormal(float x, float y, float& height, WFMath::Vect
 	int ix = I_ROUND(floor(x / mSegmentResolution));
 	int iy = I_ROUND(floor(y / mSegmentResolution));
 
-	std::shared_ptr<IHeightMapSegment> segment(getSegment(ix, iy));
-	if (!segment.get()) {
+	auto segment = getSegment(ix, iy);
+	if (!segment) {
 		return false;
 	}
 	segment->getHeightAndNormal(x - (ix * (int)mSegmentResolution), y - (iy * (int)mSegmentResolution), height, normal);
 	return true;
 }
 
-std::shared_ptr<IHeightMapSegment> HeightMap::getSegment(int xIndex, int yIndex) const
+void HeightMap::getHeights(const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights) const
 {
-	Segmentstore::const_iterator I = mSegments.find(xIndex);
-	if (I == mSegments.end()) {
-		return std::shared_ptr<IHeightMapSegment>();
+	heights.resize(positions.size());
+
+	//Remember the last segment, since positions are often close to each other.
+	const IHeightMapSegment* segment = nullptr;
+	int lastIx = 0;
+	int lastIy = 0;
+	bool hasLast = false;
+
+	for (size_t i = 0; i < positions.size(); ++i) {
+		float x = positions[i].x();
+		float y = positions[i].y();
+		int ix = I_ROUND(floor(x / mSegmentResolution));
+		int iy = I_ROUND(floor(y / mSegmentResolution));
+		if (!hasLast || ix != lastIx || iy != lastIy) {
+			segment = getSegment(ix, iy);
+			lastIx = ix;
+			lastIy = iy;
+			hasLast = true;
+		}
+		if (segment) {
+			heights[i] = segment->getHeight(I_ROUND(x) - (ix * mSegmentResolution), I_ROUND(y) - (iy * mSegmentResolution));
+		} else {
+			heights[i] = mDefaultLevel;
+		}
 	}
-	Segmentcolumn::const_iterator J = I->second.find(yIndex);
-	if (J == I->second.end()) {
-		return std::shared_ptr<IHeightMapSegment>();
+}
+
+size_t HeightMap::getHeightsAndNormals(const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights, std::vector<WFMath::Vector<3>>& normals) const
+{
+	heights.resize(positions.size());
+	normals.resize(positions.size());
+
+	const IHeightMapSegment* segment = nullptr;
+	int lastIx = 0;
+	int lastIy = 0;
+	bool hasLast = false;
+	size_t found = 0;
+
+	for (size_t i = 0; i < positions.size(); ++i) {
+		float x = positions[i].x();
+		float y = positions[i].y();
+		int ix = I_ROUND(floor(x / mSegmentResolution));
+		int iy = I_ROUND(floor(y / mSegmentResolution));
+		if (!hasLast || ix != lastIx || iy != lastIy) {
+			segment = getSegment(ix, iy);
+			lastIx = ix;
+			lastIy = iy;
+			hasLast = true;
+		}
+		if (segment) {
+			segment->getHeightAndNormal(x - (ix * (int)mSegmentResolution), y - (iy * (int)mSegmentResolution), heights[i], normals[i]);
+			found++;
+		} else {
+			heights[i] = mDefaultLevel;
+			normals[i] = WFMath::Vector<3>(0, 0, 1);
+		}
+	}
+	return found;
+}
+
+const IHeightMapSegment* HeightMap::getSegment(int xIndex, int yIndex) const
+{
+	auto I = mSegments.find(packIndex(xIndex, yIndex));
+	if (I == mSegments.end()) {
+		return nullptr;
 	}
-	return J->second;
+	return I->second.get();
 }
 
 }
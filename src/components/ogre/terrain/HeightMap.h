@@ -20,12 +20,15 @@
 #define EMBEROGRETERRAINHEIGHTMAP_H_
 
 #include "Types.h"
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace WFMath
 {
 	template<int> class Vector;
+	template<int> class Point;
 }
 
 namespace Ember
@@ -41,22 +44,22 @@ class IHeightMapSegment;
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
  * @brief Keeps data about the height map of the terrain.
- * This class is safe for threading, in contrast to the Mercator::Terrain class which primarily provides height map features.
  * The whole reason for this class existing is basically Mercator not being thread safe. We want to be able to update the Mercator terrain in a background thread, but at the same time be able to provide real time height checking functionality for other subsystems in Ember which are running in the main thread.
+ * The segments are therefore created from the Mercator terrain in the background thread, but are only inserted into this class in the main thread (see HeightMapUpdateTask).
+ *
+ * This class itself isn't thread safe: all access, both updates and lookups, must happen from the main thread.
+ * Segments are stored in a single hash map keyed on the packed segment index, and are only ever accessed through plain pointers internally.
+ * For bulk lookups, prefer the batch methods getHeights(), getHeightsAndNormals() and blitHeights() since they reuse segment lookups between samples.
  */
 class HeightMap
 {
 public:
 
     /**
-     * @brief STL map to store sparse array of Segment pointers.
+     * @brief Hash map to store sparse array of Segment pointers, keyed by the packed segment index.
+     * @see packIndex()
      */
-    typedef std::unordered_map<int, std::shared_ptr<IHeightMapSegment>> Segmentcolumn;
-
-    /**
-     * @brief STL map to store sparse array of Segment pointer columns.
-     */
-    typedef std::unordered_map<int, Segmentcolumn > Segmentstore;
+    typedef std::unordered_map<std::uint64_t, std::unique_ptr<IHeightMapSegment>> Segmentstore;
 
     /**
      * @Ctor.
@@ -119,6 +122,25 @@ public:
      */
     void blitHeights(int xMin, int xMax, int yMin, int yMax, std::vector<float>& heights) const;
 
+    /**
+     * @brief Gets the heights at multiple locations.
+     * This uses the same crude lookup as getHeight(), but is faster when many nearby positions are queried since segment lookups are reused.
+     * @param positions The positions, in world units.
+     * @param heights The heights will be stored here, in the same order as the positions. The vector will be resized as needed.
+     */
+    void getHeights(const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights) const;
+
+    /**
+     * @brief Gets the heights and normals at multiple locations.
+     * This uses the same precise lookup as getHeightAndNormal(), but is faster when many nearby positions are queried since segment lookups are reused.
+     * Positions for which no segment can be found will get the default height, and a normal pointing upwards.
+     * @param positions The positions, in world units.
+     * @param heights The heights will be stored here, in the same order as the positions. The vector will be resized as needed.
+     * @param normals The normals will be stored here, in the same order as the positions. The vector will be resized as needed.
+     * @returns The number of positions for which a segment was found.
+     */
+    size_t getHeightsAndNormals(const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights, std::vector<WFMath::Vector<3>>& normals) const;
+
 
 private:
 
@@ -139,11 +161,23 @@ private:
 
 	/**
 	 * @brief Gets the segment at the specified index.
+	 * The returned pointer is borrowed, and is only valid until the segment is removed or replaced.
+	 * @param xIndex The x index.
+	 * @param yIndex The y index.
+	 * @returns A pointer to a segment, or null if no segment could be found.
+	 */
+	const IHeightMapSegment* getSegment(int xIndex, int yIndex) const;
+
+	/**
+	 * @brief Packs a segment index into a single key.
 	 * @param xIndex The x index.
 	 * @param yIndex The y index.
-	 * @returns A shared pointer to a segment, or to null if no segment could be found.
+	 * @returns A key for the segment store.
 	 */
-	std::shared_ptr<IHeightMapSegment> getSegment(int xIndex, int yIndex) const;
+	static std::uint64_t packIndex(int xIndex, int yIndex)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(xIndex)) << 32) | static_cast<std::uint32_t>(yIndex);
+	}
 };
 
 }
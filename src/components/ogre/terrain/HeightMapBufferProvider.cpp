@@ -46,11 +46,13 @@ HeightMapBufferProvider::~HeightMapBufferProvider()
 void HeightMapBufferProvider::checkin(HeightMapBuffer& heightMapBuffer)
 {
 	Buffer<float>* buffer = heightMapBuffer.getBuffer();
+	std::lock_guard<std::mutex> lock(mMutex);
 	mPrimitiveBuffers.push_back(buffer);
 }
 
 HeightMapBuffer* HeightMapBufferProvider::checkout()
 {
+	std::lock_guard<std::mutex> lock(mMutex);
 	if (mPrimitiveBuffers.size() == 0) {
 		while (mPrimitiveBuffers.size() < mDesiredBuffers) {
 			mPrimitiveBuffers.push_back(new Buffer<float> (mBufferResolution, 1));
@@ -63,7 +65,7 @@ HeightMapBuffer* HeightMapBufferProvider::checkout()
 
 void HeightMapBufferProvider::maintainPool()
 {
-
+	std::lock_guard<std::mutex> lock(mMutex);
 	if (mPrimitiveBuffers.size() <= mDesiredBuffers - mDesiredBuffersTolerance) {
 		while (mPrimitiveBuffers.size() < mDesiredBuffers) {
 			mPrimitiveBuffers.push_back(new Buffer<float> (mBufferResolution, 1));
@@ -19,6 +19,7 @@
 #ifndef HEIGHTMAPBUFFERPROVIDER_H_
 #define HEIGHTMAPBUFFERPROVIDER_H_
 
+#include <mutex>
 #include <vector>
 
 namespace Ember
@@ -37,6 +38,8 @@ class HeightMapBuffer;
  * @brief A height map buffer provider, which for performance reasons keeps a pool of buffers which are recycled as new HeightMapBuffer instances are created.
  * To help with performance and to avoid memory fragmentation this class is used to keep a collection of Buffer instances, which are used by HeightMapBuffer instances.
  * The HeightMapBuffer class will at destruction automatically return the Buffer instance to the provider.
+ *
+ * Buffers are checked out from the terrain task executors and checked in from the main thread, so all access to the pool is guarded by a mutex.
  */
 class HeightMapBufferProvider
 {
@@ -74,6 +77,11 @@ private:
 	 */
 	BufferStore mPrimitiveBuffers;
 
+	/**
+	 * @brief Guards mPrimitiveBuffers.
+	 */
+	std::mutex mMutex;
+
 	/**
 	 * @brief The resolution of one buffer. This is normally the size of one terrain segment plus one (to match Mercator::Segment).
 	 */
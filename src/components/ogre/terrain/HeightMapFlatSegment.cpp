@@ -18,6 +18,7 @@
 
 #include "HeightMapFlatSegment.h"
 #include "wfmath/vector.h"
+#include <algorithm>
 
 namespace Ember
 {
@@ -49,6 +50,11 @@ void HeightMapFlatSegment::getHeightAndNormal(float x, float y, float& height, W
 	normal.z() = 1;
 }
 
+void HeightMapFlatSegment::getHeightRow(int xStart, int xEnd, int y, float* destination) const
+{
+	std::fill(destination, destination + (xEnd - xStart), mHeight);
+}
+
 }
 
 }
@@ -60,6 +60,14 @@ public:
      */
 	virtual void getHeightAndNormal(float x, float y, float& height, WFMath::Vector<3>& normal) const;
 
+	/**
+	 * @brief Fills a row with the flat height.
+	 * @param xStart The first x location to fill, in local segment units.
+	 * @param xEnd One past the last x location to fill, in local segment units.
+	 * @param y The y location of the row, in local segment units.
+	 * @param destination The heights will be written here.
+	 */
+	virtual void getHeightRow(int xStart, int xEnd, int y, float* destination) const;
 
 protected:
 	float mHeight;
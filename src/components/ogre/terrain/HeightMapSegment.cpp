@@ -22,6 +22,7 @@
 #include "Buffer.h"
 #include <wfmath/vector.h>
 #include <cassert>
+#include <cstring>
 
 namespace Ember
 {
@@ -32,7 +33,7 @@ namespace Terrain
 {
 
 HeightMapSegment::HeightMapSegment(HeightMapBuffer* buffer) :
-	mBuffer(buffer)
+	mBuffer(buffer), mData(buffer->getBuffer()->getData()), mResolution(buffer->getResolution())
 {
 
 }
@@ -44,7 +45,12 @@ HeightMapSegment::~HeightMapSegment()
 
 float HeightMapSegment::getHeight(int x, int y) const
 {
-	return mBuffer->getBuffer()->getData()[y * (mBuffer->getResolution()) + x];
+	return mData[y * mResolution + x];
+}
+
+void HeightMapSegment::getHeightRow(int xStart, int xEnd, int y, float* destination) const
+{
+	std::memcpy(destination, mData + (y * mResolution + xStart), (xEnd - xStart) * sizeof(float));
 }
 
 /// \brief Get an accurate height and normal vector at a given coordinate
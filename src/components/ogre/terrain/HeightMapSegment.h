@@ -70,12 +70,31 @@ public:
      */
 	virtual void getHeightAndNormal(float x, float y, float& height, WFMath::Vector<3>& normal) const;
 
+	/**
+	 * @brief Copies a contiguous row of heights straight from the buffer.
+	 * @param xStart The first x location to copy, in local segment units.
+	 * @param xEnd One past the last x location to copy, in local segment units.
+	 * @param y The y location of the row, in local segment units.
+	 * @param destination The heights will be written here.
+	 */
+	virtual void getHeightRow(int xStart, int xEnd, int y, float* destination) const;
+
 private:
 
 	/**
 	 * @brief The buffer which contains the height data.
 	 */
     HeightMapBuffer* mBuffer;
+
+	/**
+	 * @brief The raw height data of the buffer, cached to avoid indirections on lookups.
+	 */
+	const float* mData;
+
+	/**
+	 * @brief The resolution of the buffer, cached to avoid indirections on lookups.
+	 */
+	unsigned int mResolution;
 };
 
 }
@@ -58,6 +58,21 @@ public:
 	 * @param normal The normal will be stored here.
      */
 	virtual void getHeightAndNormal(float x, float y, float& height, WFMath::Vector<3>& normal) const = 0;
+
+	/**
+	 * @brief Copies a contiguous row of heights.
+	 * The default implementation calls getHeight() for each sample; implementations backed by memory should override this with a straight copy.
+	 * @param xStart The first x location to copy, in local segment units.
+	 * @param xEnd One past the last x location to copy, in local segment units.
+	 * @param y The y location of the row, in local segment units.
+	 * @param destination The heights will be written here. There must be room for at least (xEnd - xStart) values.
+	 */
+	virtual void getHeightRow(int xStart, int xEnd, int y, float* destination) const
+	{
+		for (int x = xStart; x < xEnd; ++x) {
+			*destination++ = getHeight(x, y);
+		}
+	}
 };
 }
 }
@@ -29,6 +29,7 @@
 #include <sigc++/slot.h>
 #include <sigc++/connection.h>
 #include <string>
+#include <vector>
 
 namespace Ember {
 namespace OgreView {
@@ -73,6 +74,18 @@ public:
 	 */
 	virtual void setLoadRadius(Ogre::Real loadRadius) = 0;
 
+	/**
+	 * @brief Sets how many pages ahead of the camera, as predicted from its movement, may be loading at the same time.
+	 * @param budget The number of pages. Zero disables prefetching.
+	 */
+	virtual void setPrefetchBudget(unsigned int budget) = 0;
+
+	/**
+	 * @brief Sets a path which the camera is expected to follow, which is used for predicting which pages to prefetch.
+	 * @param path Waypoints in world coords, in the order they will be visited. An empty path clears it.
+	 */
+	virtual void setPrefetchPath(const std::vector<Ogre::Vector3>& path) = 0;
+
 	/**
 	 * @brief Returns the height at the given position.
 	 *
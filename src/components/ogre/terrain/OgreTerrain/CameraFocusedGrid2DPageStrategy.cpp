@@ -23,6 +23,9 @@
 #include "CameraFocusedGrid2DPageStrategy.h"
 #include <OgrePagedWorldSection.h>
 #include <OgreCamera.h>
+#include <OgreTerrainPagedWorldSection.h>
+#include <OgreTerrainGroup.h>
+#include <OgreTerrain.h>
 
 using namespace Ogre;
 
@@ -34,7 +37,9 @@ namespace Terrain
 {
 
 CameraFocusedGrid2DPageStrategy::CameraFocusedGrid2DPageStrategy(Ogre::PageManager* manager)
-: Ogre::Grid2DPageStrategy(manager)
+: Ogre::Grid2DPageStrategy(manager),
+  mTimeSinceLastNotify(0),
+  mHasPendingPrefetchPath(false)
 {
 }
 
@@ -42,6 +47,12 @@ CameraFocusedGrid2DPageStrategy::~CameraFocusedGrid2DPageStrategy()
 {
 }
 
+void CameraFocusedGrid2DPageStrategy::frameStart(Real timeSinceLastFrame, PagedWorldSection* section)
+{
+	Grid2DPageStrategy::frameStart(timeSinceLastFrame, section);
+	mTimeSinceLastNotify += timeSinceLastFrame;
+}
+
 void CameraFocusedGrid2DPageStrategy::notifyCamera(Camera* cam, PagedWorldSection* section)
 {
 	Grid2DPageStrategyData* stratData = static_cast<Grid2DPageStrategyData*>(section->getStrategyData());
@@ -54,6 +65,21 @@ void CameraFocusedGrid2DPageStrategy::notifyCamera(Camera* cam, PagedWorldSectio
 	int32 x, y;
 	stratData->determineGridLocation(gridpos, &x, &y);
 
+	Vector2 cellPosition = convertGridToCellSpace(stratData, gridpos);
+	mPrefetcher.update(cellPosition, static_cast<float>(mTimeSinceLastNotify));
+	mTimeSinceLastNotify = 0;
+	if (mHasPendingPrefetchPath) {
+		std::vector<Vector2> path;
+		for (auto& point : mPendingPrefetchPath) {
+			Vector2 pointGridpos;
+			stratData->convertWorldToGridSpace(point, pointGridpos);
+			path.push_back(convertGridToCellSpace(stratData, pointGridpos));
+		}
+		mPrefetcher.setPath(path);
+		mPendingPrefetchPath.clear();
+		mHasPendingPrefetchPath = false;
+	}
+
 	Real loadRadius = stratData->getLoadRadiusInCells();
 	Real holdRadius = stratData->getHoldRadiusInCells();
 	// scan the whole Hold range
@@ -102,9 +128,61 @@ void CameraFocusedGrid2DPageStrategy::notifyCamera(Camera* cam, PagedWorldSectio
 		}
 	}
 
+	mPrefetcher.recordLoadRange(loadxmin, loadxmax, loadymin, loadymax, [&](const PagePrefetcher::Cell& cell) {return isPageReady(section, cell);});
+	//Prefetch last, so that the pages which are needed now are requested first.
+	prefetchPages(section);
+}
 
+void CameraFocusedGrid2DPageStrategy::setPrefetchBudget(size_t budget)
+{
+	mPrefetcher.setBudget(budget);
+}
 
+void CameraFocusedGrid2DPageStrategy::setPrefetchPath(const std::vector<Vector3>& path)
+{
+	mPendingPrefetchPath = path;
+	mHasPendingPrefetchPath = true;
+}
 
+const PagePrefetcher::Statistics& CameraFocusedGrid2DPageStrategy::getPrefetchStatistics() const
+{
+	return mPrefetcher.getStatistics();
+}
+
+void CameraFocusedGrid2DPageStrategy::prefetchPages(PagedWorldSection* section)
+{
+	Grid2DPageStrategyData* stratData = static_cast<Grid2DPageStrategyData*>(section->getStrategyData());
+
+	PagePrefetcher::Plan plan;
+	mPrefetcher.plan(static_cast<float>(stratData->getLoadRadiusInCells()), [&](const PagePrefetcher::Cell& cell) {return isPageReady(section, cell);}, plan);
+
+	//Pages which aren't touched will be unloaded, which is how requests which are no longer wanted are cancelled.
+	for (auto& cell : plan.load) {
+		section->loadPage(stratData->calculatePageID(cell.first, cell.second));
+	}
+	for (auto& cell : plan.hold) {
+		section->holdPage(stratData->calculatePageID(cell.first, cell.second));
+	}
+}
+
+Vector2 CameraFocusedGrid2DPageStrategy::convertGridToCellSpace(Grid2DPageStrategyData* stratData, const Vector2& gridpos)
+{
+	int32 x, y;
+	stratData->determineGridLocation(gridpos, &x, &y);
+	Vector2 mid;
+	stratData->getMidPointGridSpace(x, y, mid);
+	Real cellSize = stratData->getCellSize();
+	return Vector2(x + 0.5f + (gridpos.x - mid.x) / cellSize, y + 0.5f + (gridpos.y - mid.y) / cellSize);
+}
+
+bool CameraFocusedGrid2DPageStrategy::isPageReady(PagedWorldSection* section, const PagePrefetcher::Cell& cell)
+{
+	TerrainPagedWorldSection* terrainSection = dynamic_cast<TerrainPagedWorldSection*>(section);
+	if (terrainSection) {
+		Ogre::Terrain* terrain = terrainSection->getTerrainGroup()->getTerrain(cell.first, cell.second);
+		return terrain && terrain->isLoaded();
+	}
+	return section->getPage(static_cast<Grid2DPageStrategyData*>(section->getStrategyData())->calculatePageID(cell.first, cell.second)) != nullptr;
 }
 
 void CameraFocusedGrid2DPageStrategy::loadNearestPages(const Vector2& gridpos, PagedWorldSection* section)
@@ -19,8 +19,12 @@
 #ifndef CAMERAFOCUSEDGRID2DPAGESTRATEGY_H_
 #define CAMERAFOCUSEDGRID2DPAGESTRATEGY_H_
 
+#include "PagePrefetcher.h"
+
 #include <OgreGrid2DPageStrategy.h>
 
+#include <vector>
+
 namespace Ember
 {
 namespace OgreView
@@ -34,6 +38,8 @@ namespace Terrain
  * This is a slight modified version of the base Ogre::Grid2DPageStrategy class
  * with the only difference being that pages that are close to the camera are loaded
  * first (which is what you would want in most cases).
+ *
+ * In addition, pages which the camera is predicted to reach soon are requested ahead of time, as determined by a PagePrefetcher.
  */
 class CameraFocusedGrid2DPageStrategy : public Ogre::Grid2DPageStrategy
 {
@@ -41,10 +47,56 @@ public:
 	CameraFocusedGrid2DPageStrategy(Ogre::PageManager* manager);
 	virtual ~CameraFocusedGrid2DPageStrategy();
 
+    void frameStart(Ogre::Real timeSinceLastFrame, Ogre::PagedWorldSection* section);
+
     void notifyCamera(Ogre::Camera* cam, Ogre::PagedWorldSection* section);
 
+    /**
+     * @brief Sets how many prefetched pages may be loading at the same time.
+     * @param budget The number of pages. Zero disables prefetching.
+     */
+    void setPrefetchBudget(size_t budget);
+
+    /**
+     * @brief Sets a path which the camera is expected to follow, used for predicting which pages to prefetch.
+     * @param path Waypoints in world space, in the order they will be visited. An empty path clears it.
+     */
+    void setPrefetchPath(const std::vector<Ogre::Vector3>& path);
+
+    const PagePrefetcher::Statistics& getPrefetchStatistics() const;
+
 protected:
 
+    PagePrefetcher mPrefetcher;
+
+    /**
+     * @brief The time accumulated since the camera was last notified.
+     */
+    Ogre::Real mTimeSinceLastNotify;
+
+    /**
+     * @brief A path set through setPrefetchPath(), waiting to be converted to cell space once the strategy data is available.
+     */
+    std::vector<Ogre::Vector3> mPendingPrefetchPath;
+
+    bool mHasPendingPrefetchPath;
+
+    /**
+     * @brief Requests pages ahead of the camera.
+     * @param section
+     */
+    void prefetchPages(Ogre::PagedWorldSection* section);
+
+    /**
+     * @brief Converts a position in grid space to cell space, as used by PagePrefetcher.
+     */
+    static Ogre::Vector2 convertGridToCellSpace(Ogre::Grid2DPageStrategyData* stratData, const Ogre::Vector2& gridpos);
+
+    /**
+     * @brief Determines whether the terrain for a cell has been loaded.
+     */
+    static bool isPageReady(Ogre::PagedWorldSection* section, const PagePrefetcher::Cell& cell);
+
     /**
      * @brief Loads the pages nearest to the camera.
      *
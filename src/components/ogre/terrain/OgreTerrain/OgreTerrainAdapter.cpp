@@ -29,6 +29,8 @@
 #include <OgreTerrainPaging.h>
 #include <OgrePagedWorld.h>
 
+#include <sstream>
+
 #define EMBER_OGRE_TERRAIN_HALF_RANGE 0x7FFF
 
 namespace Ember
@@ -121,6 +123,16 @@ void OgreTerrainAdapter::setLoadRadius(Ogre::Real loadRadius)
 	}
 }
 
+void OgreTerrainAdapter::setPrefetchBudget(unsigned int budget)
+{
+	mPageStrategy->setPrefetchBudget(budget);
+}
+
+void OgreTerrainAdapter::setPrefetchPath(const std::vector<Ogre::Vector3>& path)
+{
+	mPageStrategy->setPrefetchPath(path);
+}
+
 Ogre::Real OgreTerrainAdapter::getHeightAt(Ogre::Real x, Ogre::Real z)
 {
 	Ogre::Terrain* foundTerrain = nullptr;
@@ -190,7 +202,11 @@ void OgreTerrainAdapter::reloadPageMaterial(const TerrainIndex& index)
 
 std::string OgreTerrainAdapter::getDebugInfo()
 {
-	return "Not available";
+	const PagePrefetcher::Statistics& statistics = mPageStrategy->getPrefetchStatistics();
+	std::stringstream ss;
+	ss << "Pages prefetched: " << statistics.requested << " (demoted: " << statistics.demoted << ", cancelled: " << statistics.cancelled << ")" << std::endl;
+	ss << "Pages ready when in range: " << statistics.readyInTime << ", not ready: " << statistics.popIns;
+	return ss.str();
 }
 
 ITerrainObserver* OgreTerrainAdapter::createObserver()
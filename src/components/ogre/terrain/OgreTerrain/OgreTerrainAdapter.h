@@ -66,6 +66,10 @@ public:
 
 	void setLoadRadius(Ogre::Real loadRadius) override;
 
+	void setPrefetchBudget(unsigned int budget) override;
+
+	void setPrefetchPath(const std::vector<Ogre::Vector3>& path) override;
+
 	Ogre::Real getHeightAt(Ogre::Real x, Ogre::Real z) override;
 
 	void setCamera(Ogre::Camera* camera) override;
@@ -0,0 +1,341 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "PagePrefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Ember
+{
+namespace OgreView
+{
+namespace Terrain
+{
+
+namespace
+{
+/**
+ * @brief Below this speed, in cells per second, the camera is considered to be still.
+ */
+const float MinimumSpeed = 0.005f;
+
+/**
+ * @brief The time in seconds over which the velocity is smoothed.
+ */
+const float VelocitySmoothingTime = 0.3f;
+
+/**
+ * @brief Any movement longer than this in one update, in cells, is considered a teleport.
+ */
+const float TeleportDistance = 2.0f;
+
+/**
+ * @brief The distance, in cells, between the predicted positions.
+ */
+const float TrajectoryStep = 0.5f;
+
+const size_t MaximumTrajectoryPositions = 32;
+
+/**
+ * @brief The time in seconds a demoted page is held before being released.
+ */
+const float HoldTime = 2.0f;
+
+/**
+ * @brief How far from a path, in cells, the camera may be and still be considered to follow it.
+ */
+const float PathTolerance = 0.5f;
+}
+
+PagePrefetcher::PagePrefetcher() :
+		mBudget(4),
+		mLookAheadTime(4.0f),
+		mPosition(Ogre::Vector2::ZERO),
+		mVelocity(Ogre::Vector2::ZERO),
+		mTimeSinceLastUpdate(0),
+		mHasPosition(false),
+		mHasLoadRange(false),
+		mStatistics()
+{
+}
+
+void PagePrefetcher::setBudget(size_t budget)
+{
+	mBudget = budget;
+}
+
+size_t PagePrefetcher::getBudget() const
+{
+	return mBudget;
+}
+
+void PagePrefetcher::setLookAheadTime(float seconds)
+{
+	mLookAheadTime = std::max(0.0f, seconds);
+}
+
+void PagePrefetcher::setPath(const std::vector<Ogre::Vector2>& path)
+{
+	mPath.clear();
+	if (!path.empty()) {
+		//The path starts with the next waypoint, so the current position is needed to get the first leg.
+		if (mHasPosition) {
+			mPath.push_back(mPosition);
+		}
+		mPath.insert(mPath.end(), path.begin(), path.end());
+	}
+}
+
+void PagePrefetcher::update(const Ogre::Vector2& position, float timeSinceLastUpdate)
+{
+	if (mHasPosition && (position - mPosition).length() > TeleportDistance) {
+		reset();
+	}
+	if (!mHasPosition) {
+		mPosition = position;
+		mHasPosition = true;
+		return;
+	}
+
+	if (timeSinceLastUpdate > 0) {
+		Ogre::Vector2 velocity = (position - mPosition) / timeSinceLastUpdate;
+		float weight = 1.0f - std::exp(-timeSinceLastUpdate / VelocitySmoothingTime);
+		mVelocity += (velocity - mVelocity) * weight;
+	}
+	mPosition = position;
+	mTimeSinceLastUpdate = timeSinceLastUpdate;
+}
+
+const Ogre::Vector2& PagePrefetcher::getVelocity() const
+{
+	return mVelocity;
+}
+
+void PagePrefetcher::plan(float loadRadius, const ReadyPredicate& isReady, Plan& plan)
+{
+	plan.load.clear();
+	plan.hold.clear();
+	if (!mHasPosition) {
+		return;
+	}
+
+	int xMin, xMax, yMin, yMax;
+	getLoadRange(mPosition, loadRadius, xMin, xMax, yMin, yMax);
+	auto isInLoadRange = [&](const Cell& cell) {
+		return cell.first >= xMin && cell.first <= xMax && cell.second >= yMin && cell.second <= yMax;
+	};
+
+	std::set<Cell> predicted;
+	if (mBudget > 0) {
+		size_t inFlight = 0;
+		for (auto& entry : mRequests) {
+			if (!isReady(entry.first)) {
+				inFlight++;
+			}
+		}
+
+		std::vector<Ogre::Vector2> trajectory;
+		predictTrajectory(trajectory);
+
+		std::vector<Cell> cells;
+		for (auto& position : trajectory) {
+			int predictedXMin, predictedXMax, predictedYMin, predictedYMax;
+			getLoadRange(position, loadRadius, predictedXMin, predictedXMax, predictedYMin, predictedYMax);
+
+			cells.clear();
+			for (int y = predictedYMin; y <= predictedYMax; ++y) {
+				for (int x = predictedXMin; x <= predictedXMax; ++x) {
+					Cell cell(x, y);
+					if (!isInLoadRange(cell) && predicted.find(cell) == predicted.end()) {
+						cells.push_back(cell);
+					}
+				}
+			}
+			//The pages closest to where the camera will be are the ones most likely to be seen.
+			auto distance = [&](const Cell& cell) {
+				return Ogre::Vector2(cell.first + 0.5f, cell.second + 0.5f).squaredDistance(position);
+			};
+			std::sort(cells.begin(), cells.end(), [&](const Cell& lhs, const Cell& rhs) {return distance(lhs) < distance(rhs);});
+
+			for (auto& cell : cells) {
+				auto I = mRequests.find(cell);
+				if (I != mRequests.end()) {
+					I->second.age = 0;
+					I->second.demoted = false;
+				} else if (inFlight < mBudget) {
+					if (!isReady(cell)) {
+						inFlight++;
+						mStatistics.requested++;
+					}
+					mRequests.emplace(cell, Request { 0, false });
+				} else {
+					continue;
+				}
+				predicted.insert(cell);
+				plan.load.push_back(cell);
+			}
+		}
+	}
+
+	for (auto I = mRequests.begin(); I != mRequests.end();) {
+		const Cell& cell = I->first;
+		if (predicted.find(cell) != predicted.end()) {
+			++I;
+			continue;
+		}
+		if (isInLoadRange(cell)) {
+			//The camera has arrived, and the page is now handled like any other.
+			I = mRequests.erase(I);
+			continue;
+		}
+		Request& request = I->second;
+		request.age += mTimeSinceLastUpdate;
+		Ogre::Vector2 offset(cell.first + 0.5f - mPosition.x, cell.second + 0.5f - mPosition.y);
+		if (request.age > HoldTime || offset.dotProduct(mVelocity) < 0) {
+			mStatistics.cancelled++;
+			I = mRequests.erase(I);
+			continue;
+		}
+		if (!request.demoted) {
+			request.demoted = true;
+			mStatistics.demoted++;
+		}
+		plan.hold.push_back(cell);
+		++I;
+	}
+}
+
+void PagePrefetcher::recordLoadRange(int xMin, int xMax, int yMin, int yMax, const ReadyPredicate& isReady)
+{
+	std::set<Cell> loadRange;
+	for (int y = yMin; y <= yMax; ++y) {
+		for (int x = xMin; x <= xMax; ++x) {
+			Cell cell(x, y);
+			if (mHasLoadRange && mLoadRange.find(cell) == mLoadRange.end()) {
+				if (isReady(cell)) {
+					mStatistics.readyInTime++;
+				} else {
+					mStatistics.popIns++;
+				}
+			}
+			loadRange.insert(cell);
+		}
+	}
+	mLoadRange.swap(loadRange);
+	mHasLoadRange = true;
+}
+
+const PagePrefetcher::Statistics& PagePrefetcher::getStatistics() const
+{
+	return mStatistics;
+}
+
+void PagePrefetcher::reset()
+{
+	mPath.clear();
+	mVelocity = Ogre::Vector2::ZERO;
+	mTimeSinceLastUpdate = 0;
+	mHasPosition = false;
+	mRequests.clear();
+	mLoadRange.clear();
+	mHasLoadRange = false;
+}
+
+void PagePrefetcher::getLoadRange(const Ogre::Vector2& position, float loadRadius, int& xMin, int& xMax, int& yMin, int& yMax)
+{
+	float x = std::floor(static_cast<float>(position.x));
+	float y = std::floor(static_cast<float>(position.y));
+	xMin = static_cast<int>(std::floor(x - loadRadius));
+	xMax = static_cast<int>(std::ceil(x + loadRadius));
+	yMin = static_cast<int>(std::floor(y - loadRadius));
+	yMax = static_cast<int>(std::ceil(y + loadRadius));
+}
+
+void PagePrefetcher::predictTrajectory(std::vector<Ogre::Vector2>& positions) const
+{
+	float speed = mVelocity.length();
+	if (speed < MinimumSpeed) {
+		return;
+	}
+	float step = std::max(TrajectoryStep / speed, mLookAheadTime / MaximumTrajectoryPositions);
+
+	if (!mPath.empty() && predictAlongPath(step, speed, positions)) {
+		return;
+	}
+	for (float time = step;; time += step) {
+		time = std::min(time, mLookAheadTime);
+		positions.push_back(mPosition + mVelocity * time);
+		if (time >= mLookAheadTime) {
+			break;
+		}
+	}
+}
+
+bool PagePrefetcher::predictAlongPath(float step, float speed, std::vector<Ogre::Vector2>& positions) const
+{
+	size_t segment = 0;
+	Ogre::Vector2 current = mPath.front();
+	float nearestDistance = current.distance(mPosition);
+	for (size_t i = 0; i + 1 < mPath.size(); ++i) {
+		Ogre::Vector2 direction = mPath[i + 1] - mPath[i];
+		float lengthSquared = direction.squaredLength();
+		float fraction = 0;
+		if (lengthSquared > 0) {
+			fraction = std::min(1.0f, std::max(0.0f, static_cast<float>((mPosition - mPath[i]).dotProduct(direction) / lengthSquared)));
+		}
+		Ogre::Vector2 point = mPath[i] + direction * fraction;
+		float distance = point.distance(mPosition);
+		if (distance < nearestDistance) {
+			nearestDistance = distance;
+			segment = i;
+			current = point;
+		}
+	}
+	if (nearestDistance > PathTolerance) {
+		return false;
+	}
+
+	float travelled = 0;
+	for (float time = step;; time += step) {
+		time = std::min(time, mLookAheadTime);
+		float target = speed * time;
+		while (travelled < target && segment + 1 < mPath.size()) {
+			const Ogre::Vector2& next = mPath[segment + 1];
+			float remaining = current.distance(next);
+			if (travelled + remaining >= target) {
+				current += (next - current) * ((target - travelled) / remaining);
+				travelled = target;
+			} else {
+				travelled += remaining;
+				current = next;
+				segment++;
+			}
+		}
+		positions.push_back(current);
+		if (travelled < target || time >= mLookAheadTime) {
+			//Either the end of the path or the end of the look ahead time has been reached.
+			break;
+		}
+	}
+	return true;
+}
+
+}
+}
+}
@@ -0,0 +1,243 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_PAGEPREFETCHER_H_
+#define EMBEROGRE_TERRAIN_PAGEPREFETCHER_H_
+
+#include <OgreVector2.h>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace Ember
+{
+namespace OgreView
+{
+namespace Terrain
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Predicts which pages will be needed soon, so that they can be requested before the camera reaches them.
+ *
+ * The movement of the camera is tracked in order to estimate its velocity. The trajectory is then extrapolated a couple of seconds ahead, either
+ * along a straight line or, if one has been set and the camera is following it, along a path. Any pages which would come within the load radius
+ * of the camera along that trajectory are requested, soonest first.
+ *
+ * To not compete too much with the pages which are actually needed there's a budget of how many prefetched pages may be loading at the same time.
+ * Pages which are no longer predicted are first demoted to only being held, and then released once they've fallen behind the camera or haven't
+ * been predicted for a while.
+ *
+ * All positions are in cell space, i.e. in units of pages where the page with index (x, y) covers [x, x + 1) * [y, y + 1).
+ *
+ * Since the time it takes before pages appear is what this is meant to improve, it also keeps track of how many pages were ready when they came
+ * within the load radius, and how many weren't (and thus would "pop in").
+ */
+class PagePrefetcher
+{
+public:
+	typedef std::pair<int, int> Cell;
+
+	/**
+	 * @brief Determines whether the page for a cell has been loaded.
+	 */
+	typedef std::function<bool(const Cell&)> ReadyPredicate;
+
+	struct Statistics
+	{
+		/**
+		 * @brief The number of pages requested ahead of time.
+		 */
+		size_t requested;
+
+		/**
+		 * @brief The number of pages which were demoted to only being held, since they were no longer predicted.
+		 */
+		size_t demoted;
+
+		/**
+		 * @brief The number of requested pages which were released before they came within the load radius.
+		 */
+		size_t cancelled;
+
+		/**
+		 * @brief The number of pages which were ready when they came within the load radius.
+		 */
+		size_t readyInTime;
+
+		/**
+		 * @brief The number of pages which weren't ready when they came within the load radius.
+		 */
+		size_t popIns;
+	};
+
+	/**
+	 * @brief The pages to request, as determined by plan().
+	 */
+	struct Plan
+	{
+		/**
+		 * @brief Pages to load, soonest needed first.
+		 */
+		std::vector<Cell> load;
+
+		/**
+		 * @brief Pages to keep if they're already loaded, but not to actively load.
+		 */
+		std::vector<Cell> hold;
+	};
+
+	PagePrefetcher();
+
+	/**
+	 * @brief Sets how many prefetched pages may be loading at the same time.
+	 * @param budget The number of pages. Zero disables prefetching.
+	 */
+	void setBudget(size_t budget);
+
+	size_t getBudget() const;
+
+	/**
+	 * @brief Sets how far ahead the trajectory is predicted.
+	 * @param seconds The time, in seconds.
+	 */
+	void setLookAheadTime(float seconds);
+
+	/**
+	 * @brief Sets a path which the camera is expected to follow, such as the one the avatar is steered along.
+	 *
+	 * The path is only used as long as the camera is close to it, else the trajectory is extrapolated from the velocity.
+	 * @param path Waypoints in cell space, in the order they will be visited. An empty path clears it.
+	 */
+	void setPath(const std::vector<Ogre::Vector2>& path);
+
+	/**
+	 * @brief Updates the position of the camera, and thus the estimated velocity.
+	 *
+	 * This should be called once each frame, before plan().
+	 * @param position The position, in cell space.
+	 * @param timeSinceLastUpdate The time in seconds since the last call.
+	 */
+	void update(const Ogre::Vector2& position, float timeSinceLastUpdate);
+
+	/**
+	 * @brief Gets the estimated velocity, in cells per second.
+	 */
+	const Ogre::Vector2& getVelocity() const;
+
+	/**
+	 * @brief Determines which pages to request this frame.
+	 *
+	 * Pages within the load range of the current position aren't included, as they're expected to be loaded anyway.
+	 * @param loadRadius The load radius, in cells.
+	 * @param isReady Determines whether a page has been loaded.
+	 * @param plan The plan to fill. It's cleared first.
+	 */
+	void plan(float loadRadius, const ReadyPredicate& isReady, Plan& plan);
+
+	/**
+	 * @brief Records which pages are within the current load range, counting those that have just come within it.
+	 *
+	 * The first range recorded after a reset isn't counted, since nothing could have been prefetched for it.
+	 * @param isReady Determines whether a page has been loaded.
+	 */
+	void recordLoadRange(int xMin, int xMax, int yMin, int yMax, const ReadyPredicate& isReady);
+
+	const Statistics& getStatistics() const;
+
+	/**
+	 * @brief Forgets the tracked movement and all requested pages.
+	 *
+	 * This is done automatically if the camera moves too far in one update, as when teleporting.
+	 */
+	void reset();
+
+	/**
+	 * @brief Gets the range of cells within the load radius of a position, in the same way as Ogre::Grid2DPageStrategy does.
+	 */
+	static void getLoadRange(const Ogre::Vector2& position, float loadRadius, int& xMin, int& xMax, int& yMin, int& yMax);
+
+private:
+
+	struct Request
+	{
+		/**
+		 * @brief The time in seconds since the page was last predicted.
+		 */
+		float age;
+
+		/**
+		 * @brief True if the page has been demoted to only being held.
+		 */
+		bool demoted;
+	};
+
+	size_t mBudget;
+
+	float mLookAheadTime;
+
+	std::vector<Ogre::Vector2> mPath;
+
+	Ogre::Vector2 mPosition;
+
+	Ogre::Vector2 mVelocity;
+
+	/**
+	 * @brief The time since the last update, used to age the requests.
+	 */
+	float mTimeSinceLastUpdate;
+
+	/**
+	 * @brief True if mPosition has been set since the last reset.
+	 */
+	bool mHasPosition;
+
+	/**
+	 * @brief The pages requested ahead of time.
+	 */
+	std::map<Cell, Request> mRequests;
+
+	/**
+	 * @brief The cells within the load range last recorded.
+	 */
+	std::set<Cell> mLoadRange;
+
+	bool mHasLoadRange;
+
+	Statistics mStatistics;
+
+	/**
+	 * @brief Predicts the positions of the camera over the look ahead time, in order.
+	 */
+	void predictTrajectory(std::vector<Ogre::Vector2>& positions) const;
+
+	/**
+	 * @brief Predicts the trajectory along mPath.
+	 * @return False if the camera isn't following the path.
+	 */
+	bool predictAlongPath(float step, float speed, std::vector<Ogre::Vector2>& positions) const;
+};
+
+}
+}
+}
+
+#endif /* EMBEROGRE_TERRAIN_PAGEPREFETCHER_H_ */
@@ -0,0 +1,275 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Replays camera paths against a simulated page loader, with and without prefetching.
+// The loader has a fixed number of workers each taking a fixed time per page, and like the
+// Ogre paging system it drops any page which isn't touched in a frame. For each path it
+// reports the ratio of pages which were ready when they came within the load radius, and
+// the number of pages which weren't (and thus would pop in).
+//
+// A path can be supplied as a file, with one "<seconds> <x> <y>" keyframe per line in world units.
+
+#include "../PagePrefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Ember::OgreView::Terrain;
+
+namespace
+{
+const float PageSize = 256.0f;
+const float LoadRadius = 300.0f;
+const float HoldRadius = LoadRadius * 2;
+const float FrameTime = 1.0f / 60.0f;
+const float PageLoadTime = 1.0f;
+const size_t LoaderWorkers = 3;
+
+struct Keyframe
+{
+	float time;
+	Ogre::Vector2 position;
+};
+
+struct CameraPath
+{
+	std::string name;
+	std::vector<Keyframe> keyframes;
+
+	/**
+	 * @brief Waypoints given to the prefetcher, as a steered avatar would have.
+	 */
+	bool isSteered;
+
+	Ogre::Vector2 getPosition(float time) const
+	{
+		if (time <= keyframes.front().time) {
+			return keyframes.front().position;
+		}
+		for (size_t i = 1; i < keyframes.size(); ++i) {
+			if (time <= keyframes[i].time) {
+				const Keyframe& from = keyframes[i - 1];
+				const Keyframe& to = keyframes[i];
+				float fraction = (time - from.time) / std::max(to.time - from.time, 0.0001f);
+				return from.position + (to.position - from.position) * fraction;
+			}
+		}
+		return keyframes.back().position;
+	}
+};
+
+/**
+ * @brief Loads pages in the background, dropping any which aren't touched each frame.
+ */
+class SimulatedLoader
+{
+public:
+	void loadPage(const PagePrefetcher::Cell& cell)
+	{
+		mTouched.insert(cell);
+		if (mLoaded.find(cell) == mLoaded.end() && mLoading.find(cell) == mLoading.end()
+				&& std::find(mQueue.begin(), mQueue.end(), cell) == mQueue.end()) {
+			mQueue.push_back(cell);
+		}
+	}
+
+	void holdPage(const PagePrefetcher::Cell& cell)
+	{
+		mTouched.insert(cell);
+	}
+
+	bool isReady(const PagePrefetcher::Cell& cell) const
+	{
+		return mLoaded.find(cell) != mLoaded.end();
+	}
+
+	void frameEnd(float timeSinceLastFrame)
+	{
+		auto isTouched = [&](const PagePrefetcher::Cell& cell) {return mTouched.find(cell) != mTouched.end();};
+		mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(), [&](const PagePrefetcher::Cell& cell) {return !isTouched(cell);}), mQueue.end());
+		for (auto I = mLoading.begin(); I != mLoading.end();) {
+			if (!isTouched(I->first)) {
+				I = mLoading.erase(I);
+			} else {
+				I->second -= timeSinceLastFrame;
+				if (I->second <= 0) {
+					mLoaded.insert(I->first);
+					I = mLoading.erase(I);
+				} else {
+					++I;
+				}
+			}
+		}
+		for (auto I = mLoaded.begin(); I != mLoaded.end();) {
+			if (!isTouched(*I)) {
+				I = mLoaded.erase(I);
+			} else {
+				++I;
+			}
+		}
+		while (mLoading.size() < LoaderWorkers && !mQueue.empty()) {
+			mLoading.emplace(mQueue.front(), PageLoadTime);
+			mQueue.pop_front();
+		}
+		mTouched.clear();
+	}
+
+private:
+	std::set<PagePrefetcher::Cell> mTouched;
+	std::deque<PagePrefetcher::Cell> mQueue;
+	std::map<PagePrefetcher::Cell, float> mLoading;
+	std::set<PagePrefetcher::Cell> mLoaded;
+};
+
+Ogre::Vector2 toCellSpace(const Ogre::Vector2& position)
+{
+	//Pages are centered on their index, as set up by OgreTerrainAdapter.
+	return position / PageSize + Ogre::Vector2(0.5f, 0.5f);
+}
+
+PagePrefetcher::Statistics replay(const CameraPath& path, size_t budget)
+{
+	SimulatedLoader loader;
+	PagePrefetcher prefetcher;
+	prefetcher.setBudget(budget);
+	auto isReady = [&](const PagePrefetcher::Cell& cell) {return loader.isReady(cell);};
+
+	float duration = path.keyframes.back().time;
+	PagePrefetcher::Plan plan;
+	bool hasPath = false;
+	for (float time = 0; time <= duration; time += FrameTime) {
+		Ogre::Vector2 position = toCellSpace(path.getPosition(time));
+		prefetcher.update(position, FrameTime);
+		if (path.isSteered && !hasPath) {
+			std::vector<Ogre::Vector2> waypoints;
+			for (auto& keyframe : path.keyframes) {
+				if (keyframe.time > time) {
+					waypoints.push_back(toCellSpace(keyframe.position));
+				}
+			}
+			prefetcher.setPath(waypoints);
+			hasPath = true;
+		}
+
+		//The same requests as CameraFocusedGrid2DPageStrategy makes.
+		int xMin, xMax, yMin, yMax;
+		PagePrefetcher::getLoadRange(position, HoldRadius / PageSize, xMin, xMax, yMin, yMax);
+		int loadXMin, loadXMax, loadYMin, loadYMax;
+		PagePrefetcher::getLoadRange(position, LoadRadius / PageSize, loadXMin, loadXMax, loadYMin, loadYMax);
+		for (int y = yMin; y <= yMax; ++y) {
+			for (int x = xMin; x <= xMax; ++x) {
+				PagePrefetcher::Cell cell(x, y);
+				if (x >= loadXMin && x <= loadXMax && y >= loadYMin && y <= loadYMax) {
+					loader.loadPage(cell);
+				} else {
+					loader.holdPage(cell);
+				}
+			}
+		}
+		prefetcher.recordLoadRange(loadXMin, loadXMax, loadYMin, loadYMax, isReady);
+
+		prefetcher.plan(LoadRadius / PageSize, isReady, plan);
+		for (auto& cell : plan.load) {
+			loader.loadPage(cell);
+		}
+		for (auto& cell : plan.hold) {
+			loader.holdPage(cell);
+		}
+
+		loader.frameEnd(FrameTime);
+	}
+	return prefetcher.getStatistics();
+}
+
+std::vector<CameraPath> createPaths()
+{
+	std::vector<CameraPath> paths;
+
+	//Riding in a straight line.
+	paths.push_back(CameraPath { "riding", { { 0, Ogre::Vector2(0, 0) }, { 120, Ogre::Vector2(1440, 0) } }, false });
+
+	//Flying fast in a wide turn.
+	CameraPath flying { "flying", { }, false };
+	for (int i = 0; i <= 60; ++i) {
+		float angle = i * 0.05f;
+		flying.keyframes.push_back(Keyframe { i * 2.0f, Ogre::Vector2(std::sin(angle), 1.0f - std::cos(angle)) * 2400.0f });
+	}
+	paths.push_back(flying);
+
+	//Steered along a path with sharp corners.
+	paths.push_back(CameraPath { "steered", { { 0, Ogre::Vector2(0, 0) }, { 30, Ogre::Vector2(600, 0) }, { 60, Ogre::Vector2(600, 600) }, { 90, Ogre::Vector2(0, 600) }, {
+			120, Ogre::Vector2(0, 1200) } }, true });
+
+	return paths;
+}
+
+bool readPath(const std::string& fileName, CameraPath& path)
+{
+	std::ifstream stream(fileName);
+	if (!stream) {
+		return false;
+	}
+	path.name = fileName;
+	path.isSteered = false;
+	Keyframe keyframe;
+	float x, y;
+	while (stream >> keyframe.time >> x >> y) {
+		keyframe.position = Ogre::Vector2(x, y);
+		path.keyframes.push_back(keyframe);
+	}
+	return !path.keyframes.empty();
+}
+
+void report(const std::string& name, const char* mode, const PagePrefetcher::Statistics& statistics)
+{
+	size_t total = statistics.readyInTime + statistics.popIns;
+	float ratio = total ? static_cast<float>(statistics.readyInTime) / total : 1.0f;
+	std::cout << std::left << std::setw(10) << name << std::setw(12) << mode << "ready before visible: " << std::fixed << std::setprecision(2) << ratio << ", pop-ins: "
+			<< statistics.popIns << ", prefetched: " << statistics.requested << ", cancelled: " << statistics.cancelled << std::endl;
+}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<CameraPath> paths;
+	if (argc > 1) {
+		CameraPath path;
+		if (!readPath(argv[1], path)) {
+			std::cerr << "Could not read a camera path from " << argv[1] << std::endl;
+			return 1;
+		}
+		paths.push_back(path);
+	} else {
+		paths = createPaths();
+	}
+
+	for (auto& path : paths) {
+		report(path.name, "no prefetch", replay(path, 0));
+		report(path.name, "prefetch", replay(path, PagePrefetcher().getBudget()));
+	}
+
+	return 0;
+}
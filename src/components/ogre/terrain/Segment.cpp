@@ -18,7 +18,6 @@
 
 #include "Segment.h"
 #include <Mercator/Segment.h>
-#include <sstream>
 namespace Ember
 {
 namespace OgreView
@@ -54,11 +53,9 @@ int Segment::getYIndex() const
 	return mYIndex;
 }
 
-std::string Segment::getKey() const
+uint64_t Segment::getKey() const
 {
-	std::stringstream ss;
-	ss << getXIndex() << "_" << getYIndex();
-	return ss.str();
+	return makeKey(mXIndex, mYIndex);
 }
 
 void Segment::invalidate()
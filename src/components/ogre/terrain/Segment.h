@@ -19,6 +19,7 @@
 #ifndef EMBEROGRE_TERRAIN_SEGMENT_H_
 #define EMBEROGRE_TERRAIN_SEGMENT_H_
 
+#include <cstdint>
 #include <string>
 #include <functional>
 
@@ -82,7 +83,18 @@ public:
 	 * @brief Gets a unique key for the segment, to be used for quick lookup.
 	 * @returns A unique key for the segment.
 	 */
-	std::string getKey() const;
+	uint64_t getKey() const;
+
+	/**
+	 * @brief Creates a unique key for a segment index, by packing both indices into one integer.
+	 * @param xIndex The x index.
+	 * @param yIndex The y index.
+	 * @returns A unique key for the index.
+	 */
+	static uint64_t makeKey(int xIndex, int yIndex)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(xIndex)) << 32) | static_cast<uint32_t>(yIndex);
+	}
 
 	/**
 	 * @brief Invalidates this segment.
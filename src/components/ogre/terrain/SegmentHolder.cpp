@@ -31,7 +31,7 @@ namespace Terrain
 {
 
 SegmentHolder::SegmentHolder(Segment* segment, SegmentManager& segmentManager) :
-	mSegment(segment), mSegmentManager(segmentManager), mRefCount(0)
+	mSegment(segment), mSegmentManager(segmentManager), mRefCount(0), mPreviousUnused(nullptr), mNextUnused(nullptr), mIsMarkedUnused(false)
 {
 
 }
@@ -43,10 +43,14 @@ SegmentHolder::~SegmentHolder()
 
 std::shared_ptr<Segment> SegmentHolder::getReference()
 {
-	mRefCount++;
 	//If mRefCount is 1 we're guaranteed to be the only one interacting with the segment, so it's thread safe to call Mercator::Segment::isValid
-	if (mRefCount == 1 && mSegment->getMercatorSegment().isValid()) {
-		mSegmentManager.unmarkHolder(this);
+	if (++mRefCount == 1) {
+		if (mSegment->getMercatorSegment().isValid()) {
+			mSegmentManager.unmarkHolder(this);
+		} else {
+			//The data has either been released or never been created; try to get it back without generating it.
+			mSegmentManager.restoreSegment(*mSegment);
+		}
 	}
 
 	//When the shared pointer is deleted we should just decrease our internal reference counter.
@@ -59,9 +63,8 @@ std::shared_ptr<Segment> SegmentHolder::getReference()
 void SegmentHolder::returnReference()
 {
 	assert(mRefCount > 0);
-	mRefCount--;
 	//If mRefCount is 0 we're guaranteed to be the only one interacting with the segment, so it's thread safe to call Mercator::Segment::isValid
-	if (mRefCount == 0 && mSegment->getMercatorSegment().isValid()) {
+	if (--mRefCount == 0 && mSegment->getMercatorSegment().isValid()) {
 		mSegmentManager.markHolderAsDirtyAndUnused(this);
 		mSegmentManager.pruneUnusedSegments();
 	}
@@ -46,6 +46,7 @@ class SegmentManager;
 class SegmentHolder
 {
 friend class SegmentReference;
+friend class SegmentManager;
 public:
 
 	/**
@@ -96,6 +97,24 @@ protected:
 	 */
 	std::atomic<unsigned int> mRefCount;
 
+	/**
+	 * @brief The previous holder in the SegmentManager's list of unused segments.
+	 * This is guarded by the SegmentManager.
+	 */
+	SegmentHolder* mPreviousUnused;
+
+	/**
+	 * @brief The next holder in the SegmentManager's list of unused segments.
+	 * This is guarded by the SegmentManager.
+	 */
+	SegmentHolder* mNextUnused;
+
+	/**
+	 * @brief True if the holder is in the SegmentManager's list of unused segments.
+	 * This is guarded by the SegmentManager.
+	 */
+	bool mIsMarkedUnused;
+
 	/**
 	 * @brief Called when a reference is destroyed. This will decrease the reference counter.
 	 */
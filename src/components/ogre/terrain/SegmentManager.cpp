@@ -26,6 +26,9 @@
 #include <Mercator/Terrain.h>
 
 #include <wfmath/MersenneTwister.h>
+#include <wfmath/axisbox.h>
+
+#include <cmath>
 
 namespace Ember
 {
@@ -35,30 +38,54 @@ namespace OgreView
 namespace Terrain
 {
 
-SegmentManager::SegmentManager(Mercator::Terrain& terrain, unsigned int desiredSegmentBuffer) :
-		mTerrain(terrain), mDesiredSegmentBuffer(desiredSegmentBuffer), mFakeSegmentHeight(-12.0f), mFakeSegmentHeightVariation(10.0f), mEndlessWorldEnabled(false)
+SegmentManager::SegmentManager(Mercator::Terrain& terrain, unsigned int desiredSegmentBuffer, std::unique_ptr<SegmentSpillCache> spillCache) :
+		mTerrain(terrain),
+		mDesiredSegmentBuffer(desiredSegmentBuffer),
+		mFakeSegmentHeight(-12.0f),
+		mFakeSegmentHeightVariation(10.0f),
+		mEndlessWorldEnabled(false),
+		mFirstUnusedSegment(nullptr),
+		mLastUnusedSegment(nullptr),
+		mUnusedSegmentCount(0),
+		mSpillCache(std::move(spillCache)),
+		mLookups(0),
+		mMisses(0),
+		mRestores(0),
+		mEvictions(0)
 {
 
 }
 
 SegmentManager::~SegmentManager()
 {
-	for (SegmentStore::const_iterator I = mSegments.begin(); I != mSegments.end(); ++I) {
-		delete I->second;
+	S_LOG_INFO("Terrain segments: " << mLookups << " lookups, " << mMisses << " misses, " << mRestores << " restored from the spill cache, " << mEvictions << " evictions.");
+	for (auto& shard : mShards) {
+		for (auto& entry : shard.segments) {
+			delete entry.second;
+		}
 	}
 }
 
+SegmentManager::Shard& SegmentManager::getShard(uint64_t key)
+{
+	//Use the lowest bits of both indices, so that neighbouring segments end up in different shards.
+	return mShards[((key >> 32) & 3) | ((key & 3) << 2)];
+}
+
 SegmentRefPtr SegmentManager::getSegmentReference(int xIndex, int yIndex)
 {
-	std::stringstream ss;
-	ss << xIndex << "_" << yIndex;
-	std::string key = ss.str();
-	std::unique_lock < std::mutex > l(mSegmentsMutex);
-	SegmentStore::const_iterator I = mSegments.find(key);
-	if (I != mSegments.end()) {
-		return I->second->getReference();
-	} else if (mEndlessWorldEnabled) {
-		return createFakeSegment(key, xIndex, yIndex);
+	uint64_t key = Segment::makeKey(xIndex, yIndex);
+	Shard& shard = getShard(key);
+	{
+		std::unique_lock < std::mutex > l(shard.mutex);
+		SegmentStore::const_iterator I = shard.segments.find(key);
+		if (I != shard.segments.end()) {
+			mLookups++;
+			return I->second->getReference();
+		}
+	}
+	if (mEndlessWorldEnabled) {
+		return createFakeSegment(xIndex, yIndex);
 	} else {
 		return SegmentRefPtr();
 	}
@@ -67,21 +94,14 @@ SegmentRefPtr SegmentManager::getSegmentReference(int xIndex, int yIndex)
 size_t SegmentManager::getSegmentReferences(const SegmentManager::IndexMap& indices, SegmentRefStore& segments)
 {
 	size_t count = 0;
-	std::unique_lock < std::mutex > l(mSegmentsMutex);
 
 	for (IndexMap::const_iterator I = indices.begin(); I != indices.end(); ++I) {
 		for (IndexColumn::const_iterator J = I->second.begin(); J != I->second.end(); ++J) {
 
 			const std::pair<int, int>& worldIndex(J->second);
-			std::stringstream ss;
-			ss << worldIndex.first << "_" << worldIndex.second;
-			std::string key = ss.str();
-			SegmentStore::const_iterator segI = mSegments.find(key);
-			if (segI != mSegments.end()) {
-				segments[I->first][J->first] = segI->second->getReference();
-				count++;
-			} else if (mEndlessWorldEnabled) {
-				segments[I->first][J->first] = createFakeSegment(key, worldIndex.first, worldIndex.second);
+			SegmentRefPtr segment = getSegmentReference(worldIndex.first, worldIndex.second);
+			if (segment) {
+				segments[I->first][J->first] = segment;
 				count++;
 			}
 		}
@@ -89,7 +109,7 @@ size_t SegmentManager::getSegmentReferences(const SegmentManager::IndexMap& indi
 	return count;
 }
 
-std::shared_ptr<Segment> SegmentManager::createFakeSegment(const std::string& key, int xIndex, int yIndex)
+std::shared_ptr<Segment> SegmentManager::createFakeSegment(int xIndex, int yIndex)
 {
 
 	std::function<void(Mercator::Segment*)> invalidate = [](Mercator::Segment* s)
@@ -144,11 +164,13 @@ std::shared_ptr<Segment> SegmentManager::createFakeSegment(const std::string& ke
 
 void SegmentManager::addSegment(Mercator::Segment& segment)
 {
-	std::stringstream ss;
-	ss << (segment.getXRef() / segment.getResolution()) << "_" << (segment.getYRef() / segment.getResolution());
-	std::unique_lock < std::mutex > l(mSegmentsMutex);
-	SegmentStore::const_iterator I = mSegments.find(ss.str());
-	if (I == mSegments.end()) {
+	int xIndex = segment.getXRef() / segment.getResolution();
+	int yIndex = segment.getYRef() / segment.getResolution();
+	uint64_t key = Segment::makeKey(xIndex, yIndex);
+	Shard& shard = getShard(key);
+	std::unique_lock < std::mutex > l(shard.mutex);
+	SegmentStore::const_iterator I = shard.segments.find(key);
+	if (I == shard.segments.end()) {
 		std::function<void(Mercator::Segment*)> invalidate = [](Mercator::Segment* s)
 		{
 			if (s) {
@@ -156,7 +178,7 @@ void SegmentManager::addSegment(Mercator::Segment& segment)
 			}
 		};
 		std::function<Mercator::Segment*()> segmentProvider = [&]() {return &segment;};
-		mSegments.insert(SegmentStore::value_type(ss.str(), new SegmentHolder(new Segment(segment.getXRef() / segment.getResolution(), segment.getYRef() / segment.getResolution(), segmentProvider, invalidate), *this)));
+		shard.segments.insert(SegmentStore::value_type(key, new SegmentHolder(new Segment(xIndex, yIndex, segmentProvider, invalidate), *this)));
 	}
 }
 
@@ -176,31 +198,115 @@ void SegmentManager::syncWithTerrain()
 
 void SegmentManager::pruneUnusedSegments()
 {
-	std::unique_lock < std::mutex > l(mSegmentsMutex);
-	std::unique_lock < std::mutex > l1(mUnusedAndDirtySegmentsMutex);
-	while (mUnusedAndDirtySegments.size() > mDesiredSegmentBuffer) {
-		SegmentHolder* holder = mUnusedAndDirtySegments.front();
-		mUnusedAndDirtySegments.pop_front();
-		holder->getSegment().invalidate();
+	while (true) {
+		SegmentHolder* holder;
+		{
+			std::unique_lock < std::mutex > l(mUnusedAndDirtySegmentsMutex);
+			if (mUnusedSegmentCount <= mDesiredSegmentBuffer) {
+				return;
+			}
+			holder = mFirstUnusedSegment;
+		}
+
+		//The shard must be locked before the list. Locking the shard also makes sure that no reference to the segment can be obtained while its data is released.
+		Segment& segment = holder->getSegment();
+		std::unique_lock < std::mutex > l(getShard(segment.getKey()).mutex);
+		{
+			std::unique_lock < std::mutex > l1(mUnusedAndDirtySegmentsMutex);
+			if (holder != mFirstUnusedSegment) {
+				//The list changed while we weren't holding the lock; start over.
+				continue;
+			}
+			unlinkUnusedHolder(holder);
+		}
+		//The holder might have been referenced again after it was marked.
+		if (holder->isUnused()) {
+			if (mSpillCache) {
+				mSpillCache->store(segment.getXIndex(), segment.getYIndex(), segment.getMercatorSegment());
+			}
+			segment.invalidate();
+			mEvictions++;
+		}
 	}
 }
 
 void SegmentManager::markHolderAsDirtyAndUnused(SegmentHolder* holder)
 {
 	std::unique_lock < std::mutex > l(mUnusedAndDirtySegmentsMutex);
-
-	mUnusedAndDirtySegments.push_back(holder);
+	if (holder->mIsMarkedUnused) {
+		return;
+	}
+	holder->mIsMarkedUnused = true;
+	holder->mPreviousUnused = mLastUnusedSegment;
+	holder->mNextUnused = nullptr;
+	if (mLastUnusedSegment) {
+		mLastUnusedSegment->mNextUnused = holder;
+	} else {
+		mFirstUnusedSegment = holder;
+	}
+	mLastUnusedSegment = holder;
+	mUnusedSegmentCount++;
 }
 
 void SegmentManager::unmarkHolder(SegmentHolder* holder)
 {
 	std::unique_lock < std::mutex > l(mUnusedAndDirtySegmentsMutex);
-	SegmentList::iterator I = std::find(mUnusedAndDirtySegments.begin(), mUnusedAndDirtySegments.end(), holder);
-	if (I != mUnusedAndDirtySegments.end()) {
-		mUnusedAndDirtySegments.erase(I);
+	unlinkUnusedHolder(holder);
+}
+
+void SegmentManager::unlinkUnusedHolder(SegmentHolder* holder)
+{
+	if (!holder->mIsMarkedUnused) {
+		return;
+	}
+	if (holder->mPreviousUnused) {
+		holder->mPreviousUnused->mNextUnused = holder->mNextUnused;
+	} else {
+		mFirstUnusedSegment = holder->mNextUnused;
+	}
+	if (holder->mNextUnused) {
+		holder->mNextUnused->mPreviousUnused = holder->mPreviousUnused;
+	} else {
+		mLastUnusedSegment = holder->mPreviousUnused;
+	}
+	holder->mPreviousUnused = nullptr;
+	holder->mNextUnused = nullptr;
+	holder->mIsMarkedUnused = false;
+	mUnusedSegmentCount--;
+}
+
+void SegmentManager::restoreSegment(Segment& segment)
+{
+	mMisses++;
+	if (mSpillCache && mSpillCache->restore(segment.getXIndex(), segment.getYIndex(), segment.getMercatorSegment())) {
+		mRestores++;
 	}
 }
 
+void SegmentManager::discardSpilledSegments(const WFMath::AxisBox<2>& area)
+{
+	if (!mSpillCache || !area.isValid()) {
+		return;
+	}
+	//Neighbouring segments share their edges, so an area touching an edge affects the segments on both sides.
+	float resolution = mTerrain.getResolution();
+	int xMin = static_cast<int>(std::ceil(area.lowCorner().x() / resolution)) - 1;
+	int xMax = static_cast<int>(std::floor(area.highCorner().x() / resolution));
+	int yMin = static_cast<int>(std::ceil(area.lowCorner().y() / resolution)) - 1;
+	int yMax = static_cast<int>(std::floor(area.highCorner().y() / resolution));
+	mSpillCache->discard(xMin, xMax, yMin, yMax);
+}
+
+SegmentManager::Statistics SegmentManager::getStatistics() const
+{
+	return Statistics { mLookups, mMisses, mRestores, mEvictions };
+}
+
+SegmentSpillCache* SegmentManager::getSpillCache() const
+{
+	return mSpillCache.get();
+}
+
 void SegmentManager::setEndlessWorldEnabled(bool enabled)
 {
 	mEndlessWorldEnabled = enabled;
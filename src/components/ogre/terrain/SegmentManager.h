@@ -20,11 +20,14 @@
 #define EMBEROGRE_TERRAIN_SEGMENTMANAGER_H_
 
 #include "Types.h"
+#include "SegmentSpillCache.h"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
-#include <string>
-#include <list>
 
 namespace Mercator
 {
@@ -55,6 +58,9 @@ class SegmentHolder;
  * The Segment instances are references from the manager through instances of SegmentHolder. This is a SegmentManager insternal class who's sole responsibility is to keep a count of how many references there are to the Segment instance. When there are no active references the Segment is eligible for data release.
  * Whenever an external subsystem needs to access a segment it will need to call the getSegmentReference() method to obtain a reference instance. As long as the reference instance is alive the Segment is considered in use and will not be "collected".
  *
+ * Since segments are looked up from many threads the store is split into a number of shards, each with its own mutex, so that lookups of different segments seldom have to wait for each other.
+ * Unused segments are kept in a least recently used list, linked through the SegmentHolder instances themselves, so that segments can be added and removed in constant time.
+ * If a SegmentSpillCache is supplied the data of segments released is stored there in compressed form, so that it doesn't have to be generated anew when the segments are used again.
  */
 class SegmentManager
 {
@@ -63,13 +69,37 @@ public:
 	typedef std::unordered_map<int, std::pair<int, int>> IndexColumn;
 	typedef std::unordered_map<int, IndexColumn> IndexMap;
 
+	struct Statistics
+	{
+		/**
+		 * @brief The number of references obtained for segments known to the manager.
+		 */
+		size_t lookups;
+
+		/**
+		 * @brief The number of times a segment wasn't in use and had no data, which then had to be restored or generated.
+		 */
+		size_t misses;
+
+		/**
+		 * @brief The number of misses where the data could be restored from the spill cache.
+		 */
+		size_t restores;
+
+		/**
+		 * @brief The number of segments which have had their data released.
+		 */
+		size_t evictions;
+	};
+
 	/**
 	 * @brief Ctor.
 	 * Note that no Segments will be created until syncWithTerrain() has been called.
 	 * @param terrain The main Mercator terrain instance from which segments will be obtained.
 	 * @param desiredSegmentBuffer The amount of segments we want to keep around, not collected. Often the segments closest to the avatar are most often used and updated, and it's a good idea to keep a number of these around without releasing their data.
+	 * @param spillCache An optional cache in which the data of released segments is stored.
 	 */
-	SegmentManager(Mercator::Terrain& terrain, unsigned int desiredSegmentBuffer);
+	SegmentManager(Mercator::Terrain& terrain, unsigned int desiredSegmentBuffer, std::unique_ptr<SegmentSpillCache> spillCache = nullptr);
 
 	/**
 	 * @brief Dtor.
@@ -114,6 +144,30 @@ public:
 
 	void unmarkHolder(SegmentHolder* holder);
 
+	/**
+	 * @brief Tries to restore the data of a segment from the spill cache.
+	 * This must only be called when there are no other references to the segment.
+	 * @param segment A segment without data.
+	 */
+	void restoreSegment(Segment& segment);
+
+	/**
+	 * @brief Discards the data in the spill cache for all segments intersecting an area.
+	 * This must be called whenever anything affecting the segments, such as base points, mods or areas, is changed.
+	 * @param area The area in world units.
+	 */
+	void discardSpilledSegments(const WFMath::AxisBox<2>& area);
+
+	/**
+	 * @brief Gets statistics on the use of segments.
+	 */
+	Statistics getStatistics() const;
+
+	/**
+	 * @brief Gets the spill cache, if any.
+	 */
+	SegmentSpillCache* getSpillCache() const;
+
 	/**
 	 * @brief Sets if "endless" world should be enabled.
 	 *
@@ -166,8 +220,25 @@ public:
 
 protected:
 
-	typedef std::unordered_map<std::string, SegmentHolder* > SegmentStore;
-	typedef std::list<SegmentHolder*> SegmentList;
+	typedef std::unordered_map<uint64_t, SegmentHolder*> SegmentStore;
+
+	/**
+	 * @brief The number of shards; a power of two.
+	 */
+	static const unsigned int SHARD_COUNT = 16;
+
+	/**
+	 * @brief A part of the store of segments.
+	 */
+	struct Shard
+	{
+		SegmentStore segments;
+
+		/**
+		 * @brief A mutex for accessing segments.
+		 */
+		std::mutex mutex;
+	};
 
 	/**
 	 * @brief The main Mercator terrain instance.
@@ -203,25 +274,51 @@ protected:
 	bool mEndlessWorldEnabled;
 
 	/**
-	 * @brief A store of Segment instances.
+	 * @brief A store of Segment instances, split into shards by their index.
 	 */
-	SegmentStore mSegments;
+	std::array<Shard, SHARD_COUNT> mShards;
 
 	/**
-	 * @brief A mutex for accessing mSegments.
+	 * @brief The first, and least recently used, of all unused segments which have data.
 	 */
-	std::mutex mSegmentsMutex;
+	SegmentHolder* mFirstUnusedSegment;
 
 	/**
-	 * @brief Keeps track of all
+	 * @brief The last, and most recently used, of all unused segments which have data.
 	 */
-	SegmentList mUnusedAndDirtySegments;
+	SegmentHolder* mLastUnusedSegment;
 
 	/**
-	 * @brief A mutex for accessing mUnusedAndDirtySegments.
+	 * @brief The number of unused segments which have data.
+	 */
+	size_t mUnusedSegmentCount;
+
+	/**
+	 * @brief A mutex for accessing the list of unused segments.
+	 * If both this and a shard mutex is to be locked, the shard mutex must be locked first.
 	 */
 	std::mutex mUnusedAndDirtySegmentsMutex;
 
+	std::unique_ptr<SegmentSpillCache> mSpillCache;
+
+	std::atomic<size_t> mLookups;
+	std::atomic<size_t> mMisses;
+	std::atomic<size_t> mRestores;
+	std::atomic<size_t> mEvictions;
+
+	/**
+	 * @brief Gets the shard in which a segment is stored.
+	 * Neighbouring segments are stored in different shards.
+	 * @param key The key of the segment.
+	 */
+	Shard& getShard(uint64_t key);
+
+	/**
+	 * @brief Removes a holder from the list of unused segments.
+	 * The mutex for the list must be locked.
+	 */
+	void unlinkUnusedHolder(SegmentHolder* holder);
+
 	/**
 	 * @brief Adds a new Mercator segment and creates a corresponding Segment instance for it.
 	 * @param segment The Mercator segment which we want to add to the manager.
@@ -233,12 +330,11 @@ protected:
 	 *
 	 * A "fake" segment is one that only exists on the client. This is used to make the undefined terrain
 	 * appear infinite.
-	 * @param key The lookup key for the segment.
 	 * @param x The x index of the segment.
 	 * @param y The y index of the segment.
 	 * @return A new segment holder instance which refers to the fake segment.
 	 */
-	SegmentRefPtr createFakeSegment(const std::string& key, int x, int y);
+	SegmentRefPtr createFakeSegment(int x, int y);
 
 
 };
@@ -0,0 +1,334 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SegmentSpillCache.h"
+#include "Segment.h"
+
+#include "framework/LoggingInstance.h"
+
+#include <Mercator/Segment.h>
+#include <Mercator/Surface.h>
+#include <Mercator/HeightMap.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+namespace
+{
+template<typename T>
+void write(std::string& buffer, T value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read(const char*& data, const char* end, T& value)
+{
+	if (static_cast<size_t>(end - data) < sizeof(T)) {
+		return false;
+	}
+	std::memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+bool compress(const std::string& source, std::string& destination)
+{
+	uLongf length = compressBound(source.size());
+	destination.resize(length);
+	//Favour speed over size, since compression is done while the segment manager is locked.
+	if (compress2(reinterpret_cast<Bytef*>(&destination[0]), &length, reinterpret_cast<const Bytef*>(source.data()), source.size(), Z_BEST_SPEED) != Z_OK) {
+		return false;
+	}
+	destination.resize(length);
+	return true;
+}
+
+bool uncompress(const std::string& source, size_t uncompressedSize, std::string& destination)
+{
+	uLongf length = uncompressedSize;
+	destination.resize(length);
+	return ::uncompress(reinterpret_cast<Bytef*>(&destination[0]), &length, reinterpret_cast<const Bytef*>(source.data()), source.size()) == Z_OK && length == uncompressedSize;
+}
+}
+
+SegmentSpillCache::SegmentSpillCache(size_t memoryBudget, std::string directory, size_t diskBudget) :
+		mMemoryBudget(memoryBudget), mDirectory(std::move(directory)), mDiskBudget(diskBudget), mStatistics { 0, 0, 0, 0, 0, 0 }
+{
+	if (!mDirectory.empty()) {
+		boost::system::error_code ec;
+		//Any files left are from an earlier session, and can't be trusted.
+		boost::filesystem::remove_all(mDirectory, ec);
+		boost::filesystem::create_directories(mDirectory, ec);
+		if (ec) {
+			S_LOG_WARNING("Could not create directory '" << mDirectory << "' for released terrain segments; they will only be kept in memory.");
+		}
+	}
+}
+
+SegmentSpillCache::~SegmentSpillCache()
+{
+	if (!mDirectory.empty()) {
+		boost::system::error_code ec;
+		boost::filesystem::remove_all(mDirectory, ec);
+	}
+}
+
+std::string SegmentSpillCache::serialize(Mercator::Segment& segment)
+{
+	std::string buffer;
+	uint32_t size = static_cast<uint32_t>(segment.getSize());
+	buffer.reserve(sizeof(float) * size * size + 1024);
+	write(buffer, size);
+	buffer.append(reinterpret_cast<const char*>(segment.getPoints()), sizeof(float) * size * size);
+
+	auto& surfaces = segment.getSurfaces();
+	uint32_t surfaceCount = 0;
+	for (auto& entry : surfaces) {
+		if (entry.second->isValid()) {
+			surfaceCount++;
+		}
+	}
+	write(buffer, surfaceCount);
+	for (auto& entry : surfaces) {
+		Mercator::Surface* surface = entry.second;
+		if (surface->isValid()) {
+			write(buffer, static_cast<int32_t>(entry.first));
+			write(buffer, static_cast<uint32_t>(surface->getChannels()));
+			write(buffer, static_cast<uint32_t>(surface->getSize()));
+			buffer.append(reinterpret_cast<const char*>(surface->getData()), surface->getSize() * surface->getSize() * surface->getChannels());
+		}
+	}
+	return buffer;
+}
+
+bool SegmentSpillCache::deserialize(const std::string& data, Mercator::Segment& segment)
+{
+	const char* position = data.data();
+	const char* end = data.data() + data.size();
+
+	uint32_t size;
+	if (!read(position, end, size) || size != static_cast<uint32_t>(segment.getSize()) || static_cast<size_t>(end - position) < sizeof(float) * size * size) {
+		return false;
+	}
+	//Height data which is already valid is kept, so that only the surfaces are restored.
+	if (!segment.isValid()) {
+		Mercator::HeightMap& heightMap = segment.getHeightMap();
+		heightMap.allocate();
+		std::memcpy(heightMap.getData(), position, sizeof(float) * size * size);
+		const float* points = heightMap.getData();
+		for (size_t i = 0; i < size * size; ++i) {
+			heightMap.checkMaxMin(points[i]);
+		}
+	}
+	position += sizeof(float) * size * size;
+
+	uint32_t surfaceCount;
+	if (!read(position, end, surfaceCount)) {
+		return false;
+	}
+	auto& surfaces = segment.getSurfaces();
+	for (uint32_t i = 0; i < surfaceCount; ++i) {
+		int32_t id;
+		uint32_t channels, surfaceSize;
+		if (!read(position, end, id) || !read(position, end, channels) || !read(position, end, surfaceSize)) {
+			return false;
+		}
+		size_t length = static_cast<size_t>(surfaceSize) * surfaceSize * channels;
+		if (static_cast<size_t>(end - position) < length) {
+			return false;
+		}
+		//Surfaces might have been removed or added since the segment was stored; only restore those which still match.
+		auto I = surfaces.find(id);
+		if (I != surfaces.end()) {
+			Mercator::Surface* surface = I->second;
+			if (!surface->isValid() && surface->getChannels() == channels && surface->getSize() == surfaceSize) {
+				surface->allocate();
+				std::memcpy(surface->getData(), position, length);
+			}
+		}
+		position += length;
+	}
+	return true;
+}
+
+void SegmentSpillCache::store(int xIndex, int yIndex, Mercator::Segment& segment)
+{
+	if (!segment.isValid()) {
+		return;
+	}
+	std::string uncompressed = serialize(segment);
+	std::string compressed;
+	if (!compress(uncompressed, compressed)) {
+		S_LOG_WARNING("Could not compress terrain segment at " << xIndex << ":" << yIndex << ".");
+		return;
+	}
+
+	uint64_t key = Segment::makeKey(xIndex, yIndex);
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(key);
+	if (I != mEntries.end()) {
+		removeEntry(I);
+	}
+	mMemoryOrder.push_back(key);
+	size_t compressedSize = compressed.size();
+	mEntries.emplace(key, Entry { IN_MEMORY, std::move(compressed), compressedSize, uncompressed.size(), std::prev(mMemoryOrder.end()) });
+	mStatistics.memoryUsed += compressedSize;
+	mStatistics.stores++;
+	enforceBudgets();
+}
+
+bool SegmentSpillCache::restore(int xIndex, int yIndex, Mercator::Segment& segment)
+{
+	std::string compressed;
+	size_t uncompressedSize;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto I = mEntries.find(Segment::makeKey(xIndex, yIndex));
+		if (I == mEntries.end()) {
+			mStatistics.misses++;
+			return false;
+		}
+		uncompressedSize = I->second.uncompressedSize;
+		if (I->second.location == IN_MEMORY) {
+			compressed = std::move(I->second.data);
+		} else {
+			std::ifstream stream(getPath(I->first), std::ios::binary);
+			std::stringstream ss;
+			ss << stream.rdbuf();
+			compressed = ss.str();
+		}
+		removeEntry(I);
+		mStatistics.hits++;
+	}
+
+	std::string uncompressed;
+	if (!uncompress(compressed, uncompressedSize, uncompressed) || !deserialize(uncompressed, segment)) {
+		S_LOG_WARNING("Could not restore terrain segment at " << xIndex << ":" << yIndex << ".");
+		if (segment.isValid()) {
+			segment.invalidate();
+		}
+		return false;
+	}
+	return true;
+}
+
+void SegmentSpillCache::discard(int xMin, int xMax, int yMin, int yMax)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (auto I = mEntries.begin(); I != mEntries.end();) {
+		int x = static_cast<int32_t>(I->first >> 32);
+		int y = static_cast<int32_t>(I->first & 0xFFFFFFFF);
+		if (x >= xMin && x <= xMax && y >= yMin && y <= yMax) {
+			auto J = I++;
+			removeEntry(J);
+		} else {
+			++I;
+		}
+	}
+}
+
+void SegmentSpillCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	while (!mEntries.empty()) {
+		removeEntry(mEntries.begin());
+	}
+}
+
+size_t SegmentSpillCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEntries.size();
+}
+
+SegmentSpillCache::Statistics SegmentSpillCache::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStatistics;
+}
+
+void SegmentSpillCache::removeEntry(std::unordered_map<uint64_t, Entry>::iterator I)
+{
+	Entry& entry = I->second;
+	if (entry.location == IN_MEMORY) {
+		mMemoryOrder.erase(entry.orderIterator);
+		mStatistics.memoryUsed -= entry.compressedSize;
+	} else {
+		mDiskOrder.erase(entry.orderIterator);
+		mStatistics.diskUsed -= entry.compressedSize;
+		boost::system::error_code ec;
+		boost::filesystem::remove(getPath(I->first), ec);
+	}
+	mEntries.erase(I);
+}
+
+void SegmentSpillCache::enforceBudgets()
+{
+	while (mStatistics.memoryUsed > mMemoryBudget && !mMemoryOrder.empty()) {
+		auto I = mEntries.find(mMemoryOrder.front());
+		Entry& entry = I->second;
+		bool written = false;
+		if (!mDirectory.empty() && entry.compressedSize <= mDiskBudget) {
+			std::ofstream stream(getPath(I->first), std::ios::binary | std::ios::trunc);
+			written = stream.write(entry.data.data(), entry.data.size()).good();
+		}
+		if (written) {
+			mMemoryOrder.pop_front();
+			mStatistics.memoryUsed -= entry.compressedSize;
+			entry.location = ON_DISK;
+			std::string().swap(entry.data);
+			mDiskOrder.push_back(I->first);
+			entry.orderIterator = std::prev(mDiskOrder.end());
+			mStatistics.diskUsed += entry.compressedSize;
+		} else {
+			removeEntry(I);
+			mStatistics.evictions++;
+		}
+	}
+	while (mStatistics.diskUsed > mDiskBudget && !mDiskOrder.empty()) {
+		removeEntry(mEntries.find(mDiskOrder.front()));
+		mStatistics.evictions++;
+	}
+}
+
+std::string SegmentSpillCache::getPath(uint64_t key) const
+{
+	std::stringstream ss;
+	ss << mDirectory << "/" << std::hex << key << ".segment";
+	return ss.str();
+}
+
+}
+
+}
+
+}
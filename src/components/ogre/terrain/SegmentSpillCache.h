@@ -0,0 +1,227 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_SEGMENTSPILLCACHE_H_
+#define EMBEROGRE_TERRAIN_SEGMENTSPILLCACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Mercator
+{
+class Segment;
+}
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Keeps compressed copies of the data of released segments.
+ *
+ * When the SegmentManager releases the data of an unused segment, the height map and surfaces are compressed and stored here.
+ * When the segment is used again the data can then be restored, instead of being generated anew from the base points, mods and areas.
+ *
+ * The compressed data is kept in memory, bounded by a memory budget. If a directory is supplied, entries which don't fit in memory are moved to files in it,
+ * bounded by a disk budget. In both tiers the least recently stored entries are dropped first. Any files are removed when the cache is destroyed.
+ *
+ * It's up to the owner to discard entries whenever anything affecting the segments is changed, since the cache can't detect this by itself.
+ *
+ * All methods are thread safe.
+ */
+class SegmentSpillCache
+{
+public:
+
+	struct Statistics
+	{
+		/**
+		 * @brief The number of segments stored.
+		 */
+		size_t stores;
+
+		/**
+		 * @brief The number of segments restored.
+		 */
+		size_t hits;
+
+		/**
+		 * @brief The number of segments which couldn't be restored since they weren't in the cache.
+		 */
+		size_t misses;
+
+		/**
+		 * @brief The number of entries dropped because of the budgets.
+		 */
+		size_t evictions;
+
+		/**
+		 * @brief The number of bytes of compressed data in memory.
+		 */
+		size_t memoryUsed;
+
+		/**
+		 * @brief The number of bytes of compressed data on disk.
+		 */
+		size_t diskUsed;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param memoryBudget The maximum number of bytes of compressed data to keep in memory.
+	 * @param directory A directory in which entries which don't fit in memory are stored. If empty nothing is stored on disk.
+	 * @param diskBudget The maximum number of bytes of compressed data to keep on disk.
+	 */
+	SegmentSpillCache(size_t memoryBudget, std::string directory = "", size_t diskBudget = 0);
+
+	/**
+	 * @brief Dtor.
+	 * Any files written are removed.
+	 */
+	~SegmentSpillCache();
+
+	/**
+	 * @brief Stores the data of a segment, replacing any existing entry.
+	 *
+	 * Nothing is stored if the segment has no valid height data.
+	 * @param xIndex The x index of the segment.
+	 * @param yIndex The y index of the segment.
+	 * @param segment The segment. It mustn't be accessed by any other thread during the call.
+	 */
+	void store(int xIndex, int yIndex, Mercator::Segment& segment);
+
+	/**
+	 * @brief Restores the data of a segment, removing the entry.
+	 *
+	 * The segment must not have any valid height data. Surfaces which aren't valid are restored too, if they were stored.
+	 * @param xIndex The x index of the segment.
+	 * @param yIndex The y index of the segment.
+	 * @param segment The segment. It mustn't be accessed by any other thread during the call.
+	 * @return True if the segment was restored.
+	 */
+	bool restore(int xIndex, int yIndex, Mercator::Segment& segment);
+
+	/**
+	 * @brief Discards entries for all segments within an index range, inclusive.
+	 */
+	void discard(int xMin, int xMax, int yMin, int yMax);
+
+	/**
+	 * @brief Discards all entries.
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of entries, in memory as well as on disk.
+	 */
+	size_t size() const;
+
+	Statistics getStatistics() const;
+
+	/**
+	 * @brief Serializes the height map and all valid surfaces of a segment.
+	 * @param segment A segment with valid height data.
+	 * @return The uncompressed data.
+	 */
+	static std::string serialize(Mercator::Segment& segment);
+
+	/**
+	 * @brief Restores the height map and surfaces of a segment from data created by serialize().
+	 *
+	 * The height map is only restored if the segment has no valid height data, and surfaces only if they exist in the segment but aren't valid.
+	 * @return False if the data didn't match the segment.
+	 */
+	static bool deserialize(const std::string& data, Mercator::Segment& segment);
+
+private:
+
+	enum Location
+	{
+		IN_MEMORY, ON_DISK
+	};
+
+	struct Entry
+	{
+		Location location;
+
+		/**
+		 * @brief The compressed data, if in memory.
+		 */
+		std::string data;
+
+		/**
+		 * @brief The size of the compressed data.
+		 */
+		size_t compressedSize;
+
+		/**
+		 * @brief The size of the data before compression.
+		 */
+		size_t uncompressedSize;
+
+		/**
+		 * @brief The position in either mMemoryOrder or mDiskOrder.
+		 */
+		std::list<uint64_t>::iterator orderIterator;
+	};
+
+	const size_t mMemoryBudget;
+	const std::string mDirectory;
+	const size_t mDiskBudget;
+
+	std::unordered_map<uint64_t, Entry> mEntries;
+
+	/**
+	 * @brief The keys of the entries in memory, least recently stored first.
+	 */
+	std::list<uint64_t> mMemoryOrder;
+
+	/**
+	 * @brief The keys of the entries on disk, least recently moved there first.
+	 */
+	std::list<uint64_t> mDiskOrder;
+
+	Statistics mStatistics;
+
+	mutable std::mutex mMutex;
+
+	void removeEntry(std::unordered_map<uint64_t, Entry>::iterator I);
+
+	/**
+	 * @brief Moves or drops entries until the budgets are met.
+	 */
+	void enforceBudgets();
+
+	std::string getPath(uint64_t key) const;
+};
+
+}
+
+}
+
+}
+
+#endif /* EMBEROGRE_TERRAIN_SEGMENTSPILLCACHE_H_ */
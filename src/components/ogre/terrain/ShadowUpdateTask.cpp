@@ -21,11 +21,16 @@
 #include "TerrainPageSurface.h"
 #include "TerrainPageShadow.h"
 #include "TerrainPageGeometry.h"
+#include "TerrainHandler.h"
+
+#include "framework/LoggingInstance.h"
 
 #include <OgreTextureManager.h>
 #include <OgreRoot.h>
 #include <OgreHardwarePixelBuffer.h>
 
+#include <chrono>
+
 namespace Ember
 {
 namespace OgreView
@@ -34,8 +39,8 @@ namespace OgreView
 namespace Terrain
 {
 
-ShadowUpdateTask::ShadowUpdateTask(const GeometryPtrVector& pageGeometries, const WFMath::Vector<3>& lightDirection) :
-		mPageGeometries(pageGeometries), mLightDirection(lightDirection)
+ShadowUpdateTask::ShadowUpdateTask(const GeometryPtrVector& pageGeometries, const WFMath::Vector<3>& lightDirection, TerrainHandler& handler) :
+		mPageGeometries(pageGeometries), mLightDirection(lightDirection), mHandler(handler)
 {
 
 }
@@ -53,9 +58,17 @@ void ShadowUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionContext
 			if (shadow) {
 				auto& shadowTextureName = shadow->getShadowTextureName();
 				if (!shadowTextureName.empty()) {
-					pageGeometry->repopulate(true);
-					shadow->setLightDirection(mLightDirection);
-					shadow->updateShadow(*pageGeometry.get());
+					auto start = std::chrono::steady_clock::now();
+					//A shadow restored from the page cache comes with its own normals.
+					pageGeometry->repopulate(!shadow->hasRestoredNormals());
+					std::vector<int8_t> bakedNormals;
+					shadow->updateShadow(*pageGeometry.get(), mLightDirection, &bakedNormals);
+					auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+					S_LOG_VERBOSE("Baked shadow for page [" << page.getWFIndex().first << "|" << page.getWFIndex().second << "] in " << duration.count() / 1000.0 << " ms.");
+					uint64_t key;
+					if (page.getCacheKey(key)) {
+						mHandler.storePageInCache(key, *pageGeometry, std::move(bakedNormals));
+					}
 				}
 			}
 		}
@@ -30,16 +30,20 @@ namespace OgreView
 
 namespace Terrain
 {
+class TerrainHandler;
 
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
  * @brief Async task for updating precomputed shadows for pages.
  * This is only of use when using the fixed function pipeline.
+ *
+ * Since baking only touches the pages handled by the task, one task per page can be enqueued to spread the work over all available executors.
+ * The time spent baking each page is logged, and the page is stored in the page cache along with its shadow.
  */
 class ShadowUpdateTask : public Tasks::TemplateNamedTask<ShadowUpdateTask>
 {
 public:
-	ShadowUpdateTask(const GeometryPtrVector& pageGeometries, const WFMath::Vector<3>& lightDirection);
+	ShadowUpdateTask(const GeometryPtrVector& pageGeometries, const WFMath::Vector<3>& lightDirection, TerrainHandler& handler);
 	virtual ~ShadowUpdateTask();
 
 	virtual void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context);
@@ -50,6 +54,8 @@ private:
 	GeometryPtrVector mPageGeometries;
 
 	const WFMath::Vector<3> mLightDirection;
+
+	TerrainHandler& mHandler;
 };
 
 }
@@ -42,7 +42,7 @@ class TerrainLayerDefinitionManager;
 class TerrainAreaAddTask: public TerrainAreaTaskBase
 {
 public:
-	TerrainAreaAddTask(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType markForUpdateSlot, TerrainHandler& terrainHandler, TerrainLayerDefinitionManager& terrainLayerDefinitionManager, AreaShaderstore& areaShaders);
+	TerrainAreaAddTask(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType markForUpdateSlot, SegmentManager& segmentManager, TerrainHandler& terrainHandler, TerrainLayerDefinitionManager& terrainLayerDefinitionManager, AreaShaderstore& areaShaders);
 	virtual ~TerrainAreaAddTask();
 
 	virtual void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context);
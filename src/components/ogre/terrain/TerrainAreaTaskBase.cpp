@@ -25,8 +25,8 @@ namespace OgreView
 namespace Terrain
 {
 
-TerrainAreaTaskBase::TerrainAreaTaskBase(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType shaderUpdateSlot)
-: mTerrain(terrain), mArea(area), mShaderUpdateSlot(shaderUpdateSlot)
+TerrainAreaTaskBase::TerrainAreaTaskBase(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType shaderUpdateSlot, SegmentManager& segmentManager)
+: mTerrain(terrain), mArea(area), mShaderUpdateSlot(shaderUpdateSlot), mSegmentManager(segmentManager)
 {
 }
 
@@ -42,6 +42,7 @@ namespace Terrain
 
 class TerrainArea;
 class TerrainShader;
+class SegmentManager;
 
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
@@ -52,7 +53,7 @@ class TerrainAreaTaskBase: public Tasks::TemplateNamedTask<TerrainAreaTaskBase>
 public:
 	typedef sigc::slot<void, const TerrainShader*, const WFMath::AxisBox<2>&> ShaderUpdateSlotType;
 
-	TerrainAreaTaskBase(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType shaderUpdateSlot);
+	TerrainAreaTaskBase(Mercator::Terrain& terrain, Mercator::Area* area, ShaderUpdateSlotType shaderUpdateSlot, SegmentManager& segmentManager);
 	virtual ~TerrainAreaTaskBase();
 
 protected:
@@ -69,6 +70,11 @@ protected:
 
 	ShaderUpdateSlotType mShaderUpdateSlot;
 
+	/**
+	 * @brief The segment manager, which needs to know about areas being changed.
+	 */
+	SegmentManager& mSegmentManager;
+
 };
 
 }
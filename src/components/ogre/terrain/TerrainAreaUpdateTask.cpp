@@ -18,6 +18,7 @@
 
 #include "TerrainAreaUpdateTask.h"
 #include "TerrainArea.h"
+#include "SegmentManager.h"
 #include <Mercator/Terrain.h>
 
 namespace Ember
@@ -27,8 +28,8 @@ namespace OgreView
 
 namespace Terrain
 {
-TerrainAreaUpdateTask::TerrainAreaUpdateTask(Mercator::Terrain& terrain, Mercator::Area* area, const Mercator::Area& newArea, ShaderUpdateSlotType markForUpdateSlot, const TerrainShader* shader) :
-	TerrainAreaTaskBase(terrain, area, markForUpdateSlot), mNewArea(newArea), mShader(shader)
+TerrainAreaUpdateTask::TerrainAreaUpdateTask(Mercator::Terrain& terrain, Mercator::Area* area, const Mercator::Area& newArea, ShaderUpdateSlotType markForUpdateSlot, SegmentManager& segmentManager, const TerrainShader* shader) :
+	TerrainAreaTaskBase(terrain, area, markForUpdateSlot, segmentManager), mNewArea(newArea), mShader(shader)
 {
 
 }
@@ -44,6 +45,8 @@ void TerrainAreaUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionCo
 	mNewShape = mArea->bbox();
 
 	mTerrain.updateArea(mArea);
+	mSegmentManager.discardSpilledSegments(mOldShape);
+	mSegmentManager.discardSpilledSegments(mNewShape);
 }
 
 bool TerrainAreaUpdateTask::executeTaskInMainThread()
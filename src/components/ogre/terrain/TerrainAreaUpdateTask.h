@@ -48,9 +48,10 @@ public:
 	 * @param area The terrain area which is updated.
 	 * @param shader The affected shader.
 	 * @param markForUpdateSlot A slot which will be called in the main thread when the update is complete.
+	 * @param segmentManager The segment manager.
 	 * @param oldShape The old shape, before the update.
 	 */
-	TerrainAreaUpdateTask(Mercator::Terrain& terrain, Mercator::Area* area, const Mercator::Area& newArea, ShaderUpdateSlotType markForUpdateSlot, const TerrainShader* shader);
+	TerrainAreaUpdateTask(Mercator::Terrain& terrain, Mercator::Area* area, const Mercator::Area& newArea, ShaderUpdateSlotType markForUpdateSlot, SegmentManager& segmentManager, const TerrainShader* shader);
 	virtual ~TerrainAreaUpdateTask();
 
 	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context) override;
@@ -51,6 +51,8 @@
 #include "HeightMapBufferProvider.h"
 #include "PlantAreaQuery.h"
 #include "SegmentManager.h"
+#include "TerrainTaskScheduler.h"
+#include "BlendMapCache.h"
 
 #include "../Convert.h"
 #include "../ILightning.h"
@@ -67,6 +69,8 @@
 
 #include <sigc++/bind.h>
 
+#include <algorithm>
+
 namespace Ember
 {
 
@@ -106,6 +110,36 @@ public:
 
 };
 
+/**
+ * @brief Writes a page to the page cache.
+ *
+ * Compressing and writing a page takes a while, so this is done in its own task with low priority, rather than holding up the generation of other pages.
+ */
+class PageCacheStoreTask: public Tasks::TemplateNamedTask<PageCacheStoreTask>
+{
+private:
+	TerrainPageCache& mPageCache;
+	TerrainPageCache::Key mKey;
+	TerrainPageCache::PageData mData;
+
+public:
+	PageCacheStoreTask(TerrainPageCache& pageCache, TerrainPageCache::Key key, TerrainPageCache::PageData data) :
+			mPageCache(pageCache), mKey(key), mData(std::move(data))
+	{
+	}
+
+	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
+	{
+		mPageCache.save(mKey, mData);
+	}
+
+	virtual int getPriority() const
+	{
+		//Below all other terrain tasks.
+		return -1;
+	}
+};
+
 class TerrainPageReloadTask: public Tasks::TemplateNamedTask<TerrainPageReloadTask>
 {
 private:
@@ -128,16 +162,21 @@ public:
 
 	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
 	{
-		mGeometry->repopulate();
 		std::vector<const TerrainShader*> shaders;
 		for (ShaderStore::const_iterator I = mShaders.begin(); I != mShaders.end(); ++I) {
 			shaders.push_back(I->second);
 		}
+		TerrainPageCache::Key key;
+		bool isRestored = mHandler.restorePageFromCache(*mGeometry, shaders, key);
+		mGeometry->repopulate();
 		AreaStore areas;
 		areas.push_back(mArea);
 		GeometryPtrVector geometries;
 		geometries.push_back(mGeometry);
-		context.executeTask(new TerrainShaderUpdateTask(geometries, shaders, areas, mHandler.EventLayerUpdated, mHandler.EventTerrainMaterialRecompiled, mMainLightDirection));
+		context.executeTask(new TerrainShaderUpdateTask(geometries, shaders, areas, mHandler.EventLayerUpdated, mHandler.EventTerrainMaterialRecompiled, mMainLightDirection, !isRestored));
+		if (!isRestored) {
+			mHandler.storePageInCache(key, *mGeometry);
+		}
 		if (mBridge.get()) {
 			mBridge->updateTerrain(*mGeometry);
 		}
@@ -153,7 +192,7 @@ public:
 
 };
 
-TerrainHandler::TerrainHandler(unsigned int pageIndexSize, ICompilerTechniqueProvider& compilerTechniqueProvider, Eris::EventService& eventService) :
+TerrainHandler::TerrainHandler(unsigned int pageIndexSize, ICompilerTechniqueProvider& compilerTechniqueProvider, Eris::EventService& eventService, unsigned int numberOfExecutors) :
 		mPageIndexSize(pageIndexSize),
 		mCompilerTechniqueProvider(compilerTechniqueProvider),
 		mTerrainInfo(new TerrainInfo(pageIndexSize)),
@@ -161,12 +200,16 @@ TerrainHandler::TerrainHandler(unsigned int pageIndexSize, ICompilerTechniquePro
 		mTerrain(new Mercator::Terrain(Mercator::Terrain::SHADED)),
 		mHeightMax(std::numeric_limits<Ogre::Real>::min()), mHeightMin(std::numeric_limits<Ogre::Real>::max()),
 		mHasTerrainInfo(false),
-		mTaskQueue(new Tasks::TaskQueue(1, eventService)),
+		mTaskQueue(new Tasks::TaskQueue(numberOfExecutors, eventService)),
+		mTaskScheduler(new TerrainTaskScheduler(*mTaskQueue)),
 		mLightning(0),
 		mHeightMap(new HeightMap(Mercator::Terrain::defaultLevel, mTerrain->getResolution())),
 		//The mercator buffers are one size larger than the resolution
 		mHeightMapBufferProvider(new HeightMapBufferProvider(mTerrain->getResolution() + 1)),
-		mSegmentManager(new SegmentManager(*mTerrain, 64)),
+		//Keep up to 32 MB of compressed segment data around, so that segments can be restored without having to be generated anew when the camera returns to them.
+		mSegmentManager(new SegmentManager(*mTerrain, 64, std::unique_ptr<SegmentSpillCache>(new SegmentSpillCache(32 * 1024 * 1024)))),
+		mPageCache(new TerrainPageCache()),
+		mShadowLightThreshold(0.02f),
 		mTerrainEntity(nullptr)
 {
 	mSegmentManager->setEndlessWorldEnabled(true);
@@ -183,8 +226,10 @@ TerrainHandler::TerrainHandler(unsigned int pageIndexSize, ICompilerTechniquePro
 
 TerrainHandler::~TerrainHandler()
 {
-	//Deleting the task queue will purge it, making sure that all jobs are processed first.
+	//Deactivating the scheduler will make sure that all jobs are processed first. Deleting the task queue will then execute them in the main thread.
+	mTaskScheduler->deactivate();
 	delete mTaskQueue;
+	delete mTaskScheduler;
 
 	for (PageVector::iterator J = mPages.begin(); J != mPages.end(); ++J) {
 		delete (*J);
@@ -197,13 +242,14 @@ TerrainHandler::~TerrainHandler()
 	delete mHeightMapBufferProvider;
 
 	delete mSegmentManager;
+	delete mPageCache;
 
 	delete mTerrain;
 }
 
 void TerrainHandler::shutdown()
 {
-	mTaskQueue->deactivate();
+	mTaskScheduler->deactivate();
 }
 
 void TerrainHandler::setPageSize(unsigned int pageSize)
@@ -224,7 +270,8 @@ void TerrainHandler::setPageSize(unsigned int pageSize)
 
 void TerrainHandler::getBasePoints(sigc::slot<void, Mercator::Terrain::Pointstore&>& asyncCallback)
 {
-	mTaskQueue->enqueueTask(new BasePointRetrieveTask(*mTerrain, asyncCallback));
+	//This only reads the base points, so it only needs to wait for tasks altering the terrain.
+	mTaskScheduler->enqueueTask(new BasePointRetrieveTask(*mTerrain, asyncCallback), std::vector<WFMath::AxisBox<2>>());
 }
 
 TerrainShader* TerrainHandler::createShader(const TerrainLayerDefinition* layerDef, Mercator::Shader* mercatorShader)
@@ -281,11 +328,11 @@ void TerrainHandler::destroyPage(TerrainPage* page)
 		mPages.erase(pageIter);
 	}
 	mTerrainPages[pos.x()][pos.y()] = nullptr;
-	//We should delete the page first when all existing tasks are completed. This is because some of them might refer to the page.
-	if (!mTaskQueue->isActive()) {
+	//We should delete the page first when all existing tasks for the page are completed. This is because some of them might refer to the page.
+	if (!mTaskScheduler->isActive()) {
 		delete page;
 	} else {
-		if (!mTaskQueue->enqueueTask(new TerrainPageDeletionTask(page))) {
+		if (!mTaskScheduler->enqueueTask(new TerrainPageDeletionTask(page), page->getWorldExtent())) {
 			//If the task queue is inactive there's no risk of deleting it.
 			delete page;
 		}
@@ -331,7 +378,9 @@ void TerrainHandler::getPlantsForArea(Foliage::PlantPopulator& populator, PlantA
 		if (mLightning) {
 			defaultShadowColour = mLightning->getAmbientLightColour();
 		}
-		mTaskQueue->enqueueTask(new PlantQueryTask(segmentRef, populator, query, defaultShadowColour, asyncCallback));
+		int resolution = mTerrain->getResolution();
+		WFMath::AxisBox<2> segmentArea(WFMath::Point<2>(xIndex * resolution, yIndex * resolution), WFMath::Point<2>((xIndex + 1) * resolution, (yIndex + 1) * resolution));
+		mTaskScheduler->enqueueTask(new PlantQueryTask(segmentRef, populator, query, defaultShadowColour, asyncCallback), segmentArea);
 
 	}
 }
@@ -358,12 +407,14 @@ void TerrainHandler::updateShaders()
 	//update shaders that needs updating
 	if (mShadersToUpdate.size()) {
 		GeometryPtrVector geometry;
+		std::vector<WFMath::AxisBox<2>> pageAreas;
 		for (PageVector::const_iterator I = mPages.begin(); I != mPages.end(); ++I) {
 			geometry.push_back(TerrainPageGeometryPtr(new TerrainPageGeometry(**I, *mSegmentManager, getDefaultHeight())));
+			pageAreas.push_back((*I)->getWorldExtent());
 		}
 		//use a reverse iterator, since we need to update top most layers first, since lower layers might depend on them for their foliage positions
 		for (ShaderUpdateSet::reverse_iterator I = mShadersToUpdate.rbegin(); I != mShadersToUpdate.rend(); ++I) {
-			mTaskQueue->enqueueTask(new TerrainShaderUpdateTask(geometry, I->first, I->second.Areas, EventLayerUpdated, EventTerrainMaterialRecompiled, mLightning->getMainLightDirection()), 0);
+			mTaskScheduler->enqueueTask(new TerrainShaderUpdateTask(geometry, I->first, I->second.Areas, EventLayerUpdated, EventTerrainMaterialRecompiled, mLightning->getMainLightDirection()), pageAreas);
 		}
 		mShadersToUpdate.clear();
 	}
@@ -372,8 +423,10 @@ void TerrainHandler::updateShaders()
 void TerrainHandler::updateAllPages()
 {
 	GeometryPtrVector geometry;
+	std::vector<WFMath::AxisBox<2>> pageAreas;
 	for (PageVector::const_iterator I = mPages.begin(); I != mPages.end(); ++I) {
 		geometry.push_back(TerrainPageGeometryPtr(new TerrainPageGeometry(**I, *mSegmentManager, getDefaultHeight())));
+		pageAreas.push_back((*I)->getWorldExtent());
 	}
 
 	//Update all pages
@@ -382,7 +435,7 @@ void TerrainHandler::updateAllPages()
 
 	//Update all shaders on all pages
 	for (ShaderStore::const_iterator I = mShaderMap.begin(); I != mShaderMap.end(); ++I) {
-		mTaskQueue->enqueueTask(new TerrainShaderUpdateTask(geometry, I->second, areas, EventLayerUpdated, EventTerrainMaterialRecompiled, mLightning->getMainLightDirection()), 0);
+		mTaskScheduler->enqueueTask(new TerrainShaderUpdateTask(geometry, I->second, areas, EventLayerUpdated, EventTerrainMaterialRecompiled, mLightning->getMainLightDirection()), pageAreas);
 	}
 }
 
@@ -434,7 +487,7 @@ void TerrainHandler::setUpTerrainPageAtIndex(const TerrainIndex& index, ITerrain
 		if (mLightning) {
 			sunDirection = mLightning->getMainLightDirection();
 		}
-		if (!mTaskQueue->enqueueTask(new TerrainPageCreationTask(*this, index, bridgePtr, *mHeightMapBufferProvider, *mHeightMap, sunDirection))) {
+		if (!mTaskScheduler->enqueueTask(new TerrainPageCreationTask(*this, index, bridgePtr, *mHeightMapBufferProvider, *mHeightMap, sunDirection), getPageExtent(index))) {
 			//We need to alert the bridge since it's holding up a thread waiting for this call.
 			bridge->terrainPageReady();
 		}
@@ -442,7 +495,7 @@ void TerrainHandler::setUpTerrainPageAtIndex(const TerrainIndex& index, ITerrain
 		TerrainPage* page = mTerrainPages[x][y];
 		TerrainPageGeometryPtr geometryInstance(new TerrainPageGeometry(*page, getSegmentManager(), getDefaultHeight()));
 
-		if (!mTaskQueue->enqueueTask(new TerrainPageReloadTask(*this, bridgePtr, geometryInstance, getAllShaders(), page->getWorldExtent(), mLightning->getMainLightDirection()))) {
+		if (!mTaskScheduler->enqueueTask(new TerrainPageReloadTask(*this, bridgePtr, geometryInstance, getAllShaders(), page->getWorldExtent(), mLightning->getMainLightDirection()), page->getWorldExtent())) {
 			//We need to alert the bridge since it's holding up a thread waiting for this call.
 			bridge->terrainPageReady();
 		}
@@ -480,22 +533,31 @@ void TerrainHandler::setLightning(ILightning* lightning)
 	mLightning = lightning;
 }
 
-void TerrainHandler::updateShadows()
+void TerrainHandler::updateShadows(bool force)
 {
 	if (mLightning) {
 		//Only update if there's a shadow texture set.
 		if (!mPages.empty()) {
 			auto page = mPages.front();
 			if (page->getSurface() && page->getSurface()->getShadow() && page->getSurface()->getShadow()->getShadowTextureName() != "") {
-				S_LOG_VERBOSE("Updating precomputed shadows.");
 				WFMath::Vector<3> sunDirection = mLightning->getMainLightDirection();
 
-				GeometryPtrVector geometry;
+				size_t skipped = 0;
 				for (auto& page : mPages) {
-					geometry.push_back(TerrainPageGeometryPtr(new TerrainPageGeometry(*page, *mSegmentManager, getDefaultHeight())));
+					auto shadow = page->getSurface() ? page->getSurface()->getShadow() : nullptr;
+					if (shadow) {
+						if (!force && !shadow->needsUpdate(sunDirection, mShadowLightThreshold)) {
+							skipped++;
+							continue;
+						}
+						shadow->setLightDirection(sunDirection);
+						//Use one task per page, so that pages can be baked in parallel.
+						GeometryPtrVector geometry;
+						geometry.push_back(TerrainPageGeometryPtr(new TerrainPageGeometry(*page, *mSegmentManager, getDefaultHeight())));
+						mTaskScheduler->enqueueTask(new ShadowUpdateTask(geometry, sunDirection, *this), page->getWorldExtent());
+					}
 				}
-
-				mTaskQueue->enqueueTask(new ShadowUpdateTask(geometry, sunDirection));
+				S_LOG_VERBOSE("Updating precomputed shadows for " << (mPages.size() - skipped) << " pages, skipping " << skipped << " pages.");
 			}
 		}
 	} else {
@@ -503,6 +565,11 @@ void TerrainHandler::updateShadows()
 	}
 }
 
+void TerrainHandler::setShadowLightThreshold(float threshold)
+{
+	mShadowLightThreshold = threshold;
+}
+
 float TerrainHandler::getDefaultHeight() const
 {
 	return -12;
@@ -510,7 +577,7 @@ float TerrainHandler::getDefaultHeight() const
 
 bool TerrainHandler::updateTerrain(const TerrainDefPointStore& terrainPoints)
 {
-	mTaskQueue->enqueueTask(new TerrainUpdateTask(*mTerrain, terrainPoints, *this, *mTerrainInfo, mHasTerrainInfo, *mSegmentManager));
+	mTaskScheduler->enqueueExclusiveTask(new TerrainUpdateTask(*mTerrain, terrainPoints, *this, *mTerrainInfo, mHasTerrainInfo, *mSegmentManager));
 	return true;
 }
 
@@ -528,7 +595,7 @@ void TerrainHandler::reloadTerrain(const std::vector<TerrainPosition>& positions
 
 void TerrainHandler::reloadTerrain(const std::vector<WFMath::AxisBox<2>>& areas)
 {
-	if (mTaskQueue->isActive()) {
+	if (mTaskScheduler->isActive()) {
 		std::set<TerrainPage*> pagesToUpdate;
 		for (std::vector<WFMath::AxisBox<2>>::const_iterator I(areas.begin()); I != areas.end(); ++I) {
 			const WFMath::AxisBox<2>& area = *I;
@@ -551,7 +618,7 @@ void TerrainHandler::reloadTerrain(const std::vector<WFMath::AxisBox<2>>& areas)
 				bridgePtr = J->second;
 			}
 			geometryToUpdate.push_back(BridgeBoundGeometryPtrVector::value_type(TerrainPageGeometryPtr(new TerrainPageGeometry(*page, *mSegmentManager, getDefaultHeight())), bridgePtr));
-			mTaskQueue->enqueueTask(new GeometryUpdateTask(geometryToUpdate, areas, *this, mShaderMap, *mHeightMapBufferProvider, *mHeightMap, mLightning->getMainLightDirection()));
+			mTaskScheduler->enqueueTask(new GeometryUpdateTask(geometryToUpdate, areas, *this, mShaderMap, *mHeightMapBufferProvider, *mHeightMap, mLightning->getMainLightDirection()), page->getWorldExtent());
 		}
 	}
 }
@@ -571,6 +638,94 @@ SegmentManager& TerrainHandler::getSegmentManager()
 	return *mSegmentManager;
 }
 
+TerrainPageCache& TerrainHandler::getPageCache()
+{
+	return *mPageCache;
+}
+
+bool TerrainHandler::restorePageFromCache(TerrainPageGeometry& geometry, const std::vector<const TerrainShader*>& shaders, TerrainPageCache::Key& key)
+{
+	TerrainPage& page = geometry.getPage();
+	SegmentVector segments = geometry.getValidSegments();
+	key = mPageCache->createKey(page.getWFIndex(), page.getWorldExtent(), page.getBlendMapSize(), segments, shaders);
+	page.setCacheKey(key);
+	if (!mPageCache->isEnabled()) {
+		return false;
+	}
+
+	TerrainPageCache::PageData data;
+	if (!mPageCache->load(key, data)) {
+		return false;
+	}
+	if (!TerrainPageCache::restoreSegments(data, segments, shaders)) {
+		S_LOG_WARNING("Could not restore terrain page [" << page.getWFIndex().first << "|" << page.getWFIndex().second << "] from the page cache.");
+		return false;
+	}
+	page.getSurface()->getBlendMapCache()->restore(data.blendMaps);
+	if (!data.shadow.empty() && !data.normals.empty() && data.shadowWidth == static_cast<unsigned int>(page.getBlendMapSize())) {
+		page.getSurface()->getShadow()->restore(data.shadow, data.shadowLightDirection, std::move(data.normals));
+	}
+	return true;
+}
+
+void TerrainHandler::storePageInCache(TerrainPageCache::Key key, TerrainPageGeometry& geometry, std::vector<int8_t> shadowNormals)
+{
+	if (!mPageCache->isEnabled()) {
+		return;
+	}
+	SegmentVector segments = geometry.getValidSegments();
+	TerrainPage& page = geometry.getPage();
+	std::vector<BlendMapCache::StoredBlendMap> blendMaps = page.getSurface()->getBlendMapCache()->getBlendMaps();
+
+	//The shadow is only stored right after it has been baked, along with the normals it was baked from.
+	WFMath::Vector<3> lightDirection;
+	TerrainPageShadow* shadow = page.getSurface()->getShadow();
+	bool hasShadow = !shadowNormals.empty() && shadow->getBakedLightDirection(lightDirection);
+
+	//Store the page unless it's already stored with everything now available; a shadow is for example often baked after the page has been stored.
+	unsigned int contents = TerrainPageCache::CONTENTS_SEGMENTS | (blendMaps.empty() ? 0 : TerrainPageCache::CONTENTS_BLEND_MAPS) | (hasShadow ? TerrainPageCache::CONTENTS_SHADOW : 0);
+	if (mPageCache->contains(key, contents)) {
+		return;
+	}
+	TerrainPageCache::PageData data;
+	if (!TerrainPageCache::collectSegments(segments, data)) {
+		return;
+	}
+	data.blendMaps = std::move(blendMaps);
+	if (hasShadow && shadow->copyImage(data.shadow)) {
+		data.shadowWidth = page.getBlendMapSize();
+		data.shadowLightDirection = lightDirection;
+		data.normals = std::move(shadowNormals);
+	}
+	//The task queue is deleted before the page cache, so any pending stores will have been written by then.
+	Tasks::ITask* task = new PageCacheStoreTask(*mPageCache, key, std::move(data));
+	if (!mTaskQueue->enqueueTask(task)) {
+		delete task;
+	}
+}
+
+Tasks::TaskQueue& TerrainHandler::getTaskQueue()
+{
+	return *mTaskQueue;
+}
+
+TerrainTaskScheduler& TerrainHandler::getTaskScheduler()
+{
+	return *mTaskScheduler;
+}
+
+WFMath::AxisBox<2> TerrainHandler::getPageExtent(const TerrainIndex& index) const
+{
+	//This should match TerrainPage::getWorldExtent().
+	int pageMetersSize = getPageMetersSize();
+	return WFMath::AxisBox<2>(WFMath::Point<2>(index.first * pageMetersSize, (index.second - 1) * pageMetersSize), WFMath::Point<2>((index.first + 1) * pageMetersSize, index.second * pageMetersSize));
+}
+
+const Tasks::TaskQueue::CompletionStatistics& TerrainHandler::getLastFrameTaskStatistics() const
+{
+	return mLastFrameTaskStatistics;
+}
+
 void TerrainHandler::addTerrainMod(TerrainMod* terrainMod)
 {
 	// Listen for changes to the modifier
@@ -578,20 +733,20 @@ void TerrainHandler::addTerrainMod(TerrainMod* terrainMod)
 	// Listen for deletion of the modifier
 	terrainMod->EventModDeleted.connect(sigc::bind(sigc::mem_fun(*this, &TerrainHandler::TerrainMod_Deleted), terrainMod));
 
-	mTaskQueue->enqueueTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
+	mTaskScheduler->enqueueExclusiveTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
 }
 
 void TerrainHandler::TerrainMod_Changed(TerrainMod* terrainMod)
 {
-	if (mTaskQueue->isActive()) {
-		mTaskQueue->enqueueTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
+	if (mTaskScheduler->isActive()) {
+		mTaskScheduler->enqueueExclusiveTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
 	}
 }
 
 void TerrainHandler::TerrainMod_Deleted(TerrainMod* terrainMod)
 {
-	if (mTaskQueue->isActive()) {
-		mTaskQueue->enqueueTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
+	if (mTaskScheduler->isActive()) {
+		mTaskScheduler->enqueueExclusiveTask(new TerrainModUpdateTask(*mTerrain, *terrainMod, *this));
 	}
 }
 
@@ -604,7 +759,7 @@ void TerrainHandler::updateArea(const std::string& id, Mercator::Area* terrainAr
 			Mercator::Area* newArea = new Mercator::Area(*terrainArea);
 			mAreas.insert(AreaMap::value_type(id, newArea));
 
-			mTaskQueue->enqueueTask(new TerrainAreaAddTask(*mTerrain, newArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *this, TerrainLayerDefinitionManager::getSingleton(), mAreaShaders));
+			mTaskScheduler->enqueueExclusiveTask(new TerrainAreaAddTask(*mTerrain, newArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *mSegmentManager, *this, TerrainLayerDefinitionManager::getSingleton(), mAreaShaders));
 		}
 		//If there's no existing area, and no valid supplied one, just don't do anything.
 	} else {
@@ -616,7 +771,7 @@ void TerrainHandler::updateArea(const std::string& id, Mercator::Area* terrainAr
 				shader = mAreaShaders[existingArea->getLayer()];
 			}
 			mAreas.erase(I);
-			mTaskQueue->enqueueTask(new TerrainAreaRemoveTask(*mTerrain, existingArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), shader));
+			mTaskScheduler->enqueueExclusiveTask(new TerrainAreaRemoveTask(*mTerrain, existingArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *mSegmentManager, shader));
 		} else {
 			//Check if we need to swap the area (if the layer has changed) or if we just can update the shape.
 			if (terrainArea->getLayer() != existingArea->getLayer()) {
@@ -626,17 +781,17 @@ void TerrainHandler::updateArea(const std::string& id, Mercator::Area* terrainAr
 				}
 
 				mAreas.erase(I);
-				mTaskQueue->enqueueTask(new TerrainAreaRemoveTask(*mTerrain, existingArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), shader));
+				mTaskScheduler->enqueueExclusiveTask(new TerrainAreaRemoveTask(*mTerrain, existingArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *mSegmentManager, shader));
 
 				Mercator::Area* newArea = new Mercator::Area(*terrainArea);
 				mAreas.insert(AreaMap::value_type(id, newArea));
-				mTaskQueue->enqueueTask(new TerrainAreaAddTask(*mTerrain, newArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *this, TerrainLayerDefinitionManager::getSingleton(), mAreaShaders));
+				mTaskScheduler->enqueueExclusiveTask(new TerrainAreaAddTask(*mTerrain, newArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *mSegmentManager, *this, TerrainLayerDefinitionManager::getSingleton(), mAreaShaders));
 			} else {
 				const TerrainShader* shader = 0;
 				if (mAreaShaders.count(terrainArea->getLayer())) {
 					shader = mAreaShaders[terrainArea->getLayer()];
 				}
-				mTaskQueue->enqueueTask(new TerrainAreaUpdateTask(*mTerrain, existingArea, *terrainArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), shader));
+				mTaskScheduler->enqueueExclusiveTask(new TerrainAreaUpdateTask(*mTerrain, existingArea, *terrainArea, sigc::mem_fun(*this, &TerrainHandler::markShaderForUpdate), *mSegmentManager, shader));
 			}
 		}
 	}
@@ -644,6 +799,8 @@ void TerrainHandler::updateArea(const std::string& id, Mercator::Area* terrainAr
 
 void TerrainHandler::frameProcessed(const TimeFrame&, unsigned int)
 {
+	mLastFrameTaskStatistics = mTaskQueue->takeCompletionStatistics();
+
 	if (mLightning) {
 		//Update shadows every hour
 		if (!mLastLightingUpdateAngle.isValid() || WFMath::Angle(mLightning->getMainLightDirection(), mLastLightingUpdateAngle) > (WFMath::numeric_constants<float>::pi() / 12)) {
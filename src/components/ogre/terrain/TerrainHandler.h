@@ -20,7 +20,9 @@
 #define TERRAINHANDLER_H_
 
 #include "Types.h"
+#include "TerrainPageCache.h"
 #include "domain/IHeightProvider.h"
+#include "framework/tasks/TaskQueue.h"
 
 #include <wfmath/vector.h>
 
@@ -30,6 +32,7 @@
 
 #include <set>
 #include <memory>
+#include <vector>
 
 namespace Mercator {
 	class Area;
@@ -48,9 +51,6 @@ namespace Ember
 {
 class TimeFrame;
 class EmberEntity;
-namespace Tasks {
-	class TaskQueue;
-}
 namespace OgreView
 {
 class ILightning;
@@ -74,6 +74,7 @@ class TerrainDefPoint;
 class PlantAreaQuery;
 class PlantAreaQueryResult;
 class SegmentManager;
+class TerrainTaskScheduler;
 
 namespace Foliage {
 class PlantPopulator;
@@ -96,8 +97,10 @@ public:
 	 * @brief Ctor.
 	 * @param pageIndexSize The size of one side of a page, in indices.
 	 * @param compilerTechniqueProvider Provider for terrain surface compilation techniques.
+	 * @param eventService The event service, used for processing completed tasks in the main thread.
+	 * @param numberOfExecutors The number of threads used for processing terrain tasks.
 	 */
-	TerrainHandler(unsigned int pageIndexSize, ICompilerTechniqueProvider& compilerTechniqueProvider, Eris::EventService& eventService);
+	TerrainHandler(unsigned int pageIndexSize, ICompilerTechniqueProvider& compilerTechniqueProvider, Eris::EventService& eventService, unsigned int numberOfExecutors = 1);
 
 	/**
 	 * @brief Dtor.
@@ -242,9 +245,18 @@ public:
 	const std::list<TerrainShader*>& getBaseShaders() const;
 
 	/**
-	 * @brief Regenerates all terrain shadow maps.
+	 * @brief Regenerates terrain shadow maps.
+	 *
+	 * Each page is baked in its own task, so that the work can be spread over all executors.
+	 * @param force If false, pages whose shadows were baked with a light direction within the shadow light threshold of the current light direction are skipped.
+	 */
+	void updateShadows(bool force = false);
+
+	/**
+	 * @brief Sets how much the light direction needs to change before a page's shadow is baked again.
+	 * @param threshold An angle, in radians.
 	 */
-	void updateShadows();
+	void setShadowLightThreshold(float threshold);
 
 	/**
 	 * @brief Gets the size of one page as indices.
@@ -328,6 +340,58 @@ public:
 	 */
 	SegmentManager& getSegmentManager();
 
+	/**
+	 * @brief Gets the cache of generated pages, stored on disk between sessions.
+	 *
+	 * @return The page cache.
+	 */
+	TerrainPageCache& getPageCache();
+
+	/**
+	 * @brief Tries to restore the segments, blend maps and shadow of a page from the page cache.
+	 *
+	 * This must be called from the terrain handling thread, before the geometry is populated.
+	 * @param geometry The geometry of the page.
+	 * @param shaders All terrain shaders.
+	 * @param key The key of the page is placed here, to be used with storePageInCache() if the page couldn't be restored.
+	 * @return True if the page was restored, in which case its surfaces don't need to be populated.
+	 */
+	bool restorePageFromCache(TerrainPageGeometry& geometry, const std::vector<const TerrainShader*>& shaders, TerrainPageCache::Key& key);
+
+	/**
+	 * @brief Stores a fully generated page in the page cache, unless it's already there with the same or more contents.
+	 *
+	 * This must be called from the terrain handling thread, once the material of the page has been prepared, and again whenever its shadow has been baked.
+	 * The page is collected right away, but written to disk by a low priority task.
+	 * @param key The key of the page, as obtained by restorePageFromCache() or TerrainPage::getCacheKey().
+	 * @param geometry The geometry of the page.
+	 * @param shadowNormals The normals the shadow of the page was just baked from, as returned by TerrainPageShadow::updateShadow().
+	 * The shadow is only stored if these are supplied, so that the stored shadow and normals always match.
+	 */
+	void storePageInCache(TerrainPageCache::Key key, TerrainPageGeometry& geometry, std::vector<int8_t> shadowNormals = std::vector<int8_t>());
+
+	/**
+	 * @brief Gets the task queue used for all background terrain updates.
+	 *
+	 * @return The task queue.
+	 */
+	Tasks::TaskQueue& getTaskQueue();
+
+	/**
+	 * @brief Gets the scheduler through which all terrain tasks are enqueued on the task queue.
+	 *
+	 * @return The task scheduler.
+	 */
+	TerrainTaskScheduler& getTaskScheduler();
+
+	/**
+	 * @brief Gets statistics for the main thread processing of terrain tasks during the last frame.
+	 *
+	 * This can be used to tune the completion time budget of the task queue.
+	 * @return Statistics for the last frame.
+	 */
+	const Tasks::TaskQueue::CompletionStatistics& getLastFrameTaskStatistics() const;
+
 	/**
 	 * @brief Gets the compiler technique provider, responsible for creating terrain shader techniques.
 	 *
@@ -487,6 +551,17 @@ protected:
 	 */
 	Tasks::TaskQueue* mTaskQueue;
 
+	/**
+	 * @brief Schedules tasks on mTaskQueue, making sure that tasks working on the same part of the terrain aren't run at the same time.
+	 * All tasks should be enqueued through this, rather than directly on the queue.
+	 */
+	TerrainTaskScheduler* mTaskScheduler;
+
+	/**
+	 * @brief Statistics for the main thread processing of tasks during the last frame.
+	 */
+	Tasks::TaskQueue::CompletionStatistics mLastFrameTaskStatistics;
+
 	/**
 	 * @brief Provides lightning information for the terrain.
 	 */
@@ -520,6 +595,11 @@ protected:
 	 */
 	SegmentManager* mSegmentManager;
 
+	/**
+	 * @brief Keeps generated pages on disk, so that they don't need to be generated anew in later sessions.
+	 */
+	TerrainPageCache* mPageCache;
+
 	/**
 	 * @brief The angle used when lighting for precomputed shadows was last updated.
 	 *
@@ -528,6 +608,11 @@ protected:
 	 */
 	WFMath::Vector<3> mLastLightingUpdateAngle;
 
+	/**
+	 * @brief How much, in radians, the light direction must have changed for a page's precomputed shadow to be baked again.
+	 */
+	float mShadowLightThreshold;
+
 	/**
 	 * @brief Keeps track of the current terrain entity.
 	 *
@@ -571,6 +656,13 @@ protected:
 	 */
 	void frameProcessed(const TimeFrame&, unsigned int);
 
+	/**
+	 * @brief Gets the world extent of the page at the index, regardless of whether the page exists or not.
+	 * @param index The index of the page.
+	 * @return The world extent.
+	 */
+	WFMath::AxisBox<2> getPageExtent(const TerrainIndex& index) const;
+
 	/**
 	 * @brief Updates shaders needing updating.
 	 *
@@ -38,7 +38,11 @@
 
 #include "framework/TimeFrame.h"
 
+#include "services/EmberServices.h"
 #include "services/config/ConfigService.h"
+#include "framework/ConsoleBackend.h"
+#include "framework/tasks/TaskQueue.h"
+#include "TerrainTaskScheduler.h"
 
 #include "../ShaderManager.h"
 #include "../Scene.h"
@@ -47,6 +51,8 @@
 #include <OgreRoot.h>
 #include <OgreGpuProgramManager.h>
 
+#include <wfmath/const.h>
+
 #ifdef WIN32
 #include <tchar.h>
 #define snprintf _snprintf
@@ -55,6 +61,8 @@
 #endif
 
 #include <sigc++/bind.h>
+#include <sstream>
+#include <thread>
 
 using namespace Ogre;
 namespace Ember
@@ -64,19 +72,47 @@ namespace OgreView
 namespace Terrain
 {
 
+namespace
+{
+/**
+ * @brief Gets the number of threads to use for terrain tasks, as set in the config.
+ * Any value below 1 means that the number is picked based on the available cores, leaving one core for the main thread.
+ * This is only read at startup, since the task queue can't change its number of executors.
+ */
+unsigned int getNumberOfExecutors()
+{
+	int threads = 0;
+	auto& configService = EmberServices::getSingleton().getConfigService();
+	if (configService.itemExists("terrain", "threads")) {
+		varconf::Variable variable = configService.getValue("terrain", "threads");
+		if (variable.is_int()) {
+			threads = static_cast<int>(variable);
+		}
+	}
+	if (threads < 1) {
+		threads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	}
+	return static_cast<unsigned int>(std::max(1, threads));
+}
+}
 
 TerrainManager::TerrainManager(ITerrainAdapter* adapter, Scene& scene, ShaderManager& shaderManager, Eris::EventService& eventService) :
-	UpdateShadows("update_shadows", this, "Updates shadows in the terrain."), mCompilerTechniqueProvider(new Techniques::CompilerTechniqueProvider(shaderManager, scene.getSceneManager())), mHandler(new TerrainHandler(adapter->getPageSize(), *mCompilerTechniqueProvider, eventService)), mIsFoliageShown(false), mTerrainAdapter(adapter), mFoliageBatchSize(32), mVegetation(new Foliage::Vegetation()), mScene(scene), mIsInitialized(false)
+	UpdateShadows("update_shadows", this, "Updates shadows in the terrain."), TaskStatistics("terrain_taskstatistics", this, "Prints statistics about terrain tasks; both the main thread processing during the last frame, and the time spent in each stage of background processing."), mCompilerTechniqueProvider(new Techniques::CompilerTechniqueProvider(shaderManager, scene.getSceneManager())), mHandler(new TerrainHandler(adapter->getPageSize(), *mCompilerTechniqueProvider, eventService, getNumberOfExecutors())), mIsFoliageShown(false), mTerrainAdapter(adapter), mFoliageBatchSize(32), mVegetation(new Foliage::Vegetation()), mScene(scene), mIsInitialized(false)
 {
 	registerConfigListener("graphics", "foliage", sigc::mem_fun(*this, &TerrainManager::config_Foliage));
 	registerConfigListener("terrain", "preferredtechnique", sigc::mem_fun(*this, &TerrainManager::config_TerrainTechnique));
 	registerConfigListener("terrain", "pagesize", sigc::mem_fun(*this, &TerrainManager::config_TerrainPageSize));
 	registerConfigListener("terrain", "loadradius", sigc::mem_fun(*this, &TerrainManager::config_TerrainLoadRadius));
+	registerConfigListener("terrain", "prefetchbudget", sigc::mem_fun(*this, &TerrainManager::config_PrefetchBudget));
+	registerConfigListener("terrain", "taskcompletionbudget", sigc::mem_fun(*this, &TerrainManager::config_TaskCompletionBudget));
+	registerConfigListener("terrain", "shadowlightthreshold", sigc::mem_fun(*this, &TerrainManager::config_ShadowLightThreshold));
+	registerConfigListener("terrain", "pagecachesize", sigc::mem_fun(*this, &TerrainManager::config_PageCacheSize));
 
 	shaderManager.EventLevelChanged.connect(sigc::bind(sigc::mem_fun(*this, &TerrainManager::shaderManager_LevelChanged), &shaderManager));
 
 	mHandler->EventShaderCreated.connect(sigc::mem_fun(*this, &TerrainManager::terrainHandler_ShaderCreated));
 	mHandler->EventAfterTerrainUpdate.connect(sigc::mem_fun(*this, &TerrainManager::terrainHandler_AfterTerrainUpdate));
+	mHandler->EventLayerUpdated.connect(sigc::mem_fun(*this, &TerrainManager::terrainHandler_LayerUpdated));
 	mHandler->EventWorldSizeChanged.connect(sigc::mem_fun(*this, &TerrainManager::terrainHandler_WorldSizeChanged));
 	mHandler->EventTerrainMaterialRecompiled.connect(sigc::mem_fun(*this, &TerrainManager::terrainHandler_TerrainPageMaterialRecompiled));
 
@@ -181,8 +217,45 @@ void TerrainManager::config_TerrainLoadRadius(const std::string& section, const
 	}
 }
 
+void TerrainManager::config_PrefetchBudget(const std::string& section, const std::string& key, varconf::Variable& variable)
+{
+	if (variable.is_int()) {
+		int budget = std::max(0, static_cast<int>(variable));
+		mTerrainAdapter->setPrefetchBudget(static_cast<unsigned int>(budget));
+	}
+}
+
+void TerrainManager::config_TaskCompletionBudget(const std::string& section, const std::string& key, varconf::Variable& variable)
+{
+	if (variable.is_int()) {
+		int budget = std::max(0, static_cast<int>(variable));
+		mHandler->getTaskQueue().setCompletionTimeBudget(boost::posix_time::milliseconds(budget));
+	}
+}
+
+void TerrainManager::config_ShadowLightThreshold(const std::string& section, const std::string& key, varconf::Variable& variable)
+{
+	if (variable.is_double() || variable.is_int()) {
+		//The threshold is specified in degrees.
+		double threshold = std::max(0.0, static_cast<double>(variable));
+		mHandler->setShadowLightThreshold(static_cast<float>(threshold * WFMath::numeric_constants<double>::pi() / 180.0));
+	}
+}
+
+void TerrainManager::config_PageCacheSize(const std::string& section, const std::string& key, varconf::Variable& variable)
+{
+	if (variable.is_int()) {
+		//The size is specified in megabytes.
+		size_t size = static_cast<size_t>(std::max(0, static_cast<int>(variable)));
+		std::string directory = EmberServices::getSingleton().getConfigService().getHomeDirectory(BaseDirType_CACHE) + "/terrain";
+		mHandler->getPageCache().setDirectory(directory, size * 1024 * 1024);
+	}
+}
+
 void TerrainManager::terrainHandler_AfterTerrainUpdate(const std::vector<WFMath::AxisBox<2>>& areas, const std::set<TerrainPage*>& pages)
 {
+	//Any cached foliage coverage depends on the geometry, so it must be recalculated before the pages are reloaded.
+	mVegetation->invalidateCoverage(areas);
 
 	for (std::set<TerrainPage*>::const_iterator I = pages.begin(); I != pages.end(); ++I) {
 		TerrainPage* page = *I;
@@ -205,6 +278,11 @@ void TerrainManager::terrainHandler_ShaderCreated(const TerrainShader& shader)
 	}
 }
 
+void TerrainManager::terrainHandler_LayerUpdated(const TerrainShader* shader, const std::vector<WFMath::AxisBox<2>>& areas)
+{
+	mVegetation->invalidateAllCoverage();
+}
+
 void TerrainManager::terrainHandler_WorldSizeChanged()
 {
 	if (!mIsInitialized) {
@@ -243,7 +321,39 @@ void TerrainManager::getPlantsForArea(PlantAreaQuery& query, sigc::slot<void, co
 void TerrainManager::runCommand(const std::string& command, const std::string& args)
 {
 	if (UpdateShadows == command) {
-		mHandler->updateShadows();
+		mHandler->updateShadows(true);
+	} else if (TaskStatistics == command) {
+		auto& statistics = mHandler->getLastFrameTaskStatistics();
+		std::stringstream ss;
+		ss << "Terrain tasks last frame: " << statistics.unitsCompleted << " units completed in " << statistics.batches << " batches, taking "
+				<< statistics.timeSpent.total_microseconds() << " us. Backlog: " << statistics.backlog << " units.";
+		ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
+
+		auto& scheduler = mHandler->getTaskScheduler();
+		ss.str("");
+		ss << "Terrain task threads: " << mHandler->getTaskQueue().getNumberOfExecutors() << ", running tasks: " << scheduler.getNumberOfRunningTasks() << ", tasks waiting for other tasks: " << scheduler.getNumberOfWaitingTasks() << ".";
+		ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
+
+		auto pageCacheStatistics = mHandler->getPageCache().getStatistics();
+		ss.str("");
+		ss << "Terrain page cache: " << pageCacheStatistics.hits << " hits, " << pageCacheStatistics.misses << " misses, " << pageCacheStatistics.stores << " stores, "
+				<< pageCacheStatistics.evictions << " evictions, " << pageCacheStatistics.entries << " pages using " << pageCacheStatistics.diskUsed / 1024 << " kB.";
+		ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
+
+		//Print the time spent in each stage, where "dependency wait" is the time spent waiting for other tasks on the same part of the terrain, and "queue wait" the time spent waiting for an executor.
+		auto dependencyStatistics = scheduler.getDependencyStatistics();
+		for (auto& entry : mHandler->getTaskQueue().getExecutionStatistics()) {
+			auto& executionStatistics = entry.second;
+			ss.str("");
+			ss << entry.first << ": " << executionStatistics.count << " runs, execution avg/max " << (executionStatistics.totalExecution / executionStatistics.count) << "/" << executionStatistics.maxExecution
+					<< " us, queue wait avg/max " << (executionStatistics.totalWait / executionStatistics.count) << "/" << executionStatistics.maxWait << " us";
+			auto I = dependencyStatistics.find(entry.first);
+			if (I != dependencyStatistics.end() && I->second.count) {
+				ss << ", dependency wait avg/max " << (I->second.totalWait / I->second.count) << "/" << I->second.maxWait << " us (" << I->second.delayed << " delayed)";
+			}
+			ss << ".";
+			ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
+		}
 	}
 }
 
@@ -147,6 +147,11 @@ public:
 	 */
 	const ConsoleCommandWrapper UpdateShadows;
 
+	/**
+	 * @brief Console command for printing statistics about the main thread processing of terrain tasks during the last frame.
+	 */
+	const ConsoleCommandWrapper TaskStatistics;
+
 	/**
 	 * @brief Whether the foliage should be shown or not.
 	 *
@@ -281,10 +286,20 @@ protected:
 
 	void config_TerrainLoadRadius(const std::string& section, const std::string& key, varconf::Variable& variable);
 
+	void config_PrefetchBudget(const std::string& section, const std::string& key, varconf::Variable& variable);
+
+	void config_TaskCompletionBudget(const std::string& section, const std::string& key, varconf::Variable& variable);
+
+	void config_ShadowLightThreshold(const std::string& section, const std::string& key, varconf::Variable& variable);
+
+	void config_PageCacheSize(const std::string& section, const std::string& key, varconf::Variable& variable);
+
 	void terrainHandler_AfterTerrainUpdate(const std::vector<WFMath::AxisBox<2>>& areas, const std::set<TerrainPage*>& pages);
 
 	void terrainHandler_ShaderCreated(const TerrainShader& shader);
 
+	void terrainHandler_LayerUpdated(const TerrainShader* shader, const std::vector<WFMath::AxisBox<2>>& areas);
+
 	void terrainHandler_WorldSizeChanged();
 
 	void terrainHandler_TerrainPageMaterialRecompiled(TerrainPage* page);
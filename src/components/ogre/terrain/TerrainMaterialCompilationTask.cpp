@@ -49,10 +49,13 @@ void TerrainMaterialCompilationTask::executeTaskInBackgroundThread(Tasks::TaskEx
 		(*J)->repopulate();
 		TerrainPage& page = (*J)->getPage();
 		TerrainPageSurfaceCompilationInstance* compilationInstance = page.getSurface()->createSurfaceCompilationInstance(*J);
-		//If the technique requires a pregenerated shadow we must also populate normals.
+		//If the technique requires a pregenerated shadow we must also populate normals, unless the shadow was restored from the page cache along with its normals.
 		if (compilationInstance->requiresPregenShadow()) {
-			(*J)->repopulate(true);
-			page.getSurface()->getShadow()->updateShadow(**J);
+			TerrainPageShadow* shadow = page.getSurface()->getShadow();
+			if (!shadow->hasRestoredNormals()) {
+				(*J)->repopulate(true);
+			}
+			shadow->updateShadow(**J);
 		}
 		if (compilationInstance->prepare()) {
 			mMaterialRecompilations.push_back(std::pair<TerrainPageSurfaceCompilationInstance*, TerrainPage*>(compilationInstance, &(*J)->getPage()));
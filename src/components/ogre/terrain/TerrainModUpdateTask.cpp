@@ -19,8 +19,11 @@
 #include "TerrainModUpdateTask.h"
 #include "TerrainHandler.h"
 #include "TerrainMod.h"
+#include "SegmentManager.h"
+#include "TerrainPageCache.h"
 #include <Mercator/Terrain.h>
 #include <Mercator/Segment.h>
+#include <Eris/Entity.h>
 
 namespace Ember
 {
@@ -31,9 +34,12 @@ namespace Terrain
 {
 
 TerrainModUpdateTask::TerrainModUpdateTask(Mercator::Terrain& terrain, const TerrainMod& terrainMod, TerrainHandler& handler) :
-		mTerrain(terrain), mHandler(handler), mId(std::atol(terrainMod.getEntityId().c_str())), mPosition(terrainMod.getEntity().getPosition()), mOrientation(terrainMod.getEntity().getOrientation()), mTranslator(*terrainMod.getTranslator())
+		mTerrain(terrain), mHandler(handler), mId(std::atol(terrainMod.getEntityId().c_str())), mPosition(terrainMod.getEntity().getPosition()), mOrientation(terrainMod.getEntity().getOrientation()), mTranslator(*terrainMod.getTranslator()), mDefinitionHash(0)
 {
-
+	Eris::Entity& entity = terrainMod.getEntity();
+	if (entity.hasAttr("terrainmod")) {
+		mDefinitionHash = TerrainPageCache::hashElement(entity.valueOfAttr("terrainmod"));
+	}
 }
 
 void TerrainModUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
@@ -78,6 +84,17 @@ void TerrainModUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionCon
 		delete existingMod;
 	}
 
+	for (auto& area : mUpdatedAreas) {
+		mHandler.getSegmentManager().discardSpilledSegments(area);
+	}
+
+	//Pages touched by the mod get new keys in the page cache, so nothing needs to be discarded there.
+	if (terrainMod && terrainMod->bbox().isValid()) {
+		mHandler.getPageCache().updateMod(mId, terrainMod->bbox(), mDefinitionHash, mPosition, mOrientation);
+	} else {
+		mHandler.getPageCache().removeMod(mId);
+	}
+
 }
 
 bool TerrainModUpdateTask::executeTaskInMainThread()
@@ -76,6 +76,11 @@ private:
 	const WFMath::Quaternion& mOrientation;
 	Ember::Terrain::TerrainModTranslator mTranslator;
 
+	/**
+	 * @brief A hash of the definition of the mod, used to identify pages affected by it in the page cache.
+	 */
+	uint64_t mDefinitionHash;
+
 };
 
 }
@@ -51,7 +51,7 @@ namespace Terrain
 {
 
 TerrainPage::TerrainPage(const TerrainIndex& index, int pageSize, ICompilerTechniqueProvider& compilerTechniqueProvider) :
-	mIndex(index), mPageSize(pageSize), mPosition(index.first, index.second), mTerrainSurface(new TerrainPageSurface(*this, compilerTechniqueProvider)),  mExtent(WFMath::Point<2>(mPosition.x() * (getPageSize() - 1), (mPosition.y() - 1) * (getPageSize() - 1)), WFMath::Point<2>((mPosition.x() + 1) * (getPageSize() - 1), (mPosition.y()) * (getPageSize() - 1)))
+	mIndex(index), mPageSize(pageSize), mPosition(index.first, index.second), mTerrainSurface(new TerrainPageSurface(*this, compilerTechniqueProvider)),  mExtent(WFMath::Point<2>(mPosition.x() * (getPageSize() - 1), (mPosition.y() - 1) * (getPageSize() - 1)), WFMath::Point<2>((mPosition.x() + 1) * (getPageSize() - 1), (mPosition.y()) * (getPageSize() - 1))), mCacheKey(0), mHasCacheKey(false)
 {
 
 	S_LOG_VERBOSE("Creating TerrainPage at position " << index.first << ":" << index.second);
@@ -119,6 +119,18 @@ const TerrainPageSurface* TerrainPage::getSurface() const
 	return mTerrainSurface.get();
 }
 
+void TerrainPage::setCacheKey(uint64_t key)
+{
+	mCacheKey = key;
+	mHasCacheKey = true;
+}
+
+bool TerrainPage::getCacheKey(uint64_t& key) const
+{
+	key = mCacheKey;
+	return mHasCacheKey;
+}
+
 TerrainPageSurfaceLayer* TerrainPage::addShader(const TerrainShader* shader)
 {
 	TerrainPageSurfaceLayer* layer = mTerrainSurface->createSurfaceLayer(shader->getLayerDefinition(), shader->getTerrainIndex(), shader->getShader());
@@ -31,6 +31,7 @@
 
 #include <vector>
 #include <cmath>
+#include <cstdint>
 
 namespace WFMath
 {
@@ -173,6 +174,20 @@ public:
 	 */
 	bool getNormal(const TerrainPosition& localPosition, WFMath::Vector<3>& normal) const;
 
+	/**
+	 * @brief Sets the key of the page in the page cache.
+	 * This is set whenever the page is generated or restored, so that the page can be stored again once more of it is available, such as a baked shadow.
+	 * @param key The key, as created by TerrainPageCache::createKey().
+	 */
+	void setCacheKey(uint64_t key);
+
+	/**
+	 * @brief Gets the key of the page in the page cache.
+	 * @param key The key is placed here.
+	 * @return True if a key has been set.
+	 */
+	bool getCacheKey(uint64_t& key) const;
+
 private:
 
 	/**
@@ -197,6 +212,16 @@ private:
 	 */
 	const WFMath::AxisBox<2> mExtent;
 
+	/**
+	 * @brief The key of the page in the page cache.
+	 */
+	uint64_t mCacheKey;
+
+	/**
+	 * @brief True if mCacheKey has been set.
+	 */
+	bool mHasCacheKey;
+
 	/**
 	 * @brief How much to scale the blend map. This is done to avoid pixelated terrain (a blur filter is applied).
 	 * This value is taken from the config file.
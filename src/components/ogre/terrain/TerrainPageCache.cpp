@@ -0,0 +1,820 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TerrainPageCache.h"
+#include "SegmentSpillCache.h"
+#include "TerrainShader.h"
+#include "TerrainLayerDefinition.h"
+
+#include "framework/LoggingInstance.h"
+
+#include <Mercator/Area.h>
+#include <Mercator/BasePoint.h>
+#include <Mercator/Segment.h>
+#include <Mercator/Shader.h>
+#include <Mercator/Surface.h>
+
+#include <Atlas/Message/Element.h>
+
+#include <wfmath/intersect.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+namespace
+{
+const char Magic[4] = { 'E', 'T', 'P', 'C' };
+
+/**
+ * @brief Increase whenever the format of the files, or the data they're generated from, changes.
+ */
+const uint32_t FormatVersion = 1;
+
+enum SectionType
+{
+	SECTION_SEGMENTS = 1, SECTION_BLEND_MAPS = 2, SECTION_NORMALS = 3, SECTION_SHADOW = 4
+};
+
+struct FileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t sectionCount;
+	uint32_t reserved;
+};
+
+struct SectionHeader
+{
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t compressedSize;
+	uint64_t uncompressedSize;
+};
+
+const uint64_t FnvOffset = 14695981039346656037ULL;
+const uint64_t FnvPrime = 1099511628211ULL;
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t length)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < length; ++i) {
+		hash ^= bytes[i];
+		hash *= FnvPrime;
+	}
+	return hash;
+}
+
+template<typename T>
+uint64_t hashValue(uint64_t hash, T value)
+{
+	return hashBytes(hash, &value, sizeof(T));
+}
+
+uint64_t hashString(uint64_t hash, const std::string& value)
+{
+	hash = hashValue(hash, static_cast<uint64_t>(value.size()));
+	return hashBytes(hash, value.data(), value.size());
+}
+
+template<typename T>
+void write(std::string& buffer, T value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeBytes(std::string& buffer, const void* data, size_t length)
+{
+	write(buffer, static_cast<uint64_t>(length));
+	buffer.append(static_cast<const char*>(data), length);
+}
+
+template<typename T>
+bool read(const char*& data, const char* end, T& value)
+{
+	if (static_cast<size_t>(end - data) < sizeof(T)) {
+		return false;
+	}
+	std::memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+/**
+ * @brief Reads a length prefixed run of bytes, as written by writeBytes().
+ */
+bool readBytes(const char*& data, const char* end, const char*& bytes, size_t& length)
+{
+	uint64_t length64;
+	if (!read(data, end, length64) || static_cast<uint64_t>(end - data) < length64) {
+		return false;
+	}
+	bytes = data;
+	length = static_cast<size_t>(length64);
+	data += length;
+	return true;
+}
+
+bool compress(const std::string& source, std::string& destination)
+{
+	uLongf length = compressBound(source.size());
+	destination.resize(length);
+	//Pages are written once and then read many times, so spend a bit more time to get smaller files.
+	if (compress2(reinterpret_cast<Bytef*>(&destination[0]), &length, reinterpret_cast<const Bytef*>(source.data()), source.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		return false;
+	}
+	destination.resize(length);
+	return true;
+}
+
+bool uncompress(const char* source, size_t sourceSize, size_t uncompressedSize, std::string& destination)
+{
+	uLongf length = uncompressedSize;
+	destination.resize(length);
+	return ::uncompress(reinterpret_cast<Bytef*>(&destination[0]), &length, reinterpret_cast<const Bytef*>(source), sourceSize) == Z_OK && length == uncompressedSize;
+}
+
+std::string serializeSegments(const TerrainPageCache::PageData& data)
+{
+	std::string buffer;
+	write(buffer, static_cast<uint32_t>(data.segments.size()));
+	for (auto& segment : data.segments) {
+		write(buffer, static_cast<int32_t>(segment.xIndex));
+		write(buffer, static_cast<int32_t>(segment.yIndex));
+		writeBytes(buffer, segment.data.data(), segment.data.size());
+	}
+	return buffer;
+}
+
+bool deserializeSegments(const char* position, const char* end, TerrainPageCache::PageData& data)
+{
+	uint32_t count;
+	if (!read(position, end, count)) {
+		return false;
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		int32_t xIndex, yIndex;
+		const char* bytes;
+		size_t length;
+		if (!read(position, end, xIndex) || !read(position, end, yIndex) || !readBytes(position, end, bytes, length)) {
+			return false;
+		}
+		data.segments.push_back(TerrainPageCache::PageData::SegmentData { xIndex, yIndex, std::string(bytes, length) });
+	}
+	return true;
+}
+
+std::string serializeBlendMaps(const TerrainPageCache::PageData& data)
+{
+	std::string buffer;
+	write(buffer, static_cast<uint32_t>(data.blendMaps.size()));
+	for (auto& storedBlendMap : data.blendMaps) {
+		writeBytes(buffer, storedBlendMap.key.data(), storedBlendMap.key.size());
+		write(buffer, static_cast<uint32_t>(storedBlendMap.layerIndices.size()));
+		for (int layerIndex : storedBlendMap.layerIndices) {
+			write(buffer, static_cast<int32_t>(layerIndex));
+		}
+		const BlendMapCache::BlendMap& blendMap = *storedBlendMap.blendMap;
+		write(buffer, static_cast<uint32_t>(blendMap.width));
+		write(buffer, static_cast<uint32_t>(blendMap.levels.size()));
+		for (auto& level : blendMap.levels) {
+			writeBytes(buffer, level.data(), level.size());
+		}
+	}
+	return buffer;
+}
+
+bool deserializeBlendMaps(const char* position, const char* end, TerrainPageCache::PageData& data)
+{
+	uint32_t count;
+	if (!read(position, end, count)) {
+		return false;
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		BlendMapCache::StoredBlendMap storedBlendMap;
+		const char* bytes;
+		size_t length;
+		uint32_t layerCount;
+		if (!readBytes(position, end, bytes, length) || !read(position, end, layerCount)) {
+			return false;
+		}
+		storedBlendMap.key.assign(bytes, length);
+		for (uint32_t j = 0; j < layerCount; ++j) {
+			int32_t layerIndex;
+			if (!read(position, end, layerIndex)) {
+				return false;
+			}
+			storedBlendMap.layerIndices.push_back(layerIndex);
+		}
+		std::shared_ptr<BlendMapCache::BlendMap> blendMap(new BlendMapCache::BlendMap());
+		uint32_t width, levelCount;
+		if (!read(position, end, width) || !read(position, end, levelCount)) {
+			return false;
+		}
+		blendMap->width = width;
+		for (uint32_t j = 0; j < levelCount; ++j) {
+			if (!readBytes(position, end, bytes, length)) {
+				return false;
+			}
+			blendMap->levels.emplace_back(bytes, bytes + length);
+		}
+		storedBlendMap.blendMap = blendMap;
+		data.blendMaps.push_back(std::move(storedBlendMap));
+	}
+	return true;
+}
+
+std::string serializeShadow(const TerrainPageCache::PageData& data)
+{
+	std::string buffer;
+	write(buffer, static_cast<uint32_t>(data.shadowWidth));
+	write(buffer, static_cast<float>(data.shadowLightDirection.x()));
+	write(buffer, static_cast<float>(data.shadowLightDirection.y()));
+	write(buffer, static_cast<float>(data.shadowLightDirection.z()));
+	writeBytes(buffer, data.shadow.data(), data.shadow.size());
+	return buffer;
+}
+
+bool deserializeShadow(const char* position, const char* end, TerrainPageCache::PageData& data)
+{
+	uint32_t width;
+	float x, y, z;
+	const char* bytes;
+	size_t length;
+	if (!read(position, end, width) || !read(position, end, x) || !read(position, end, y) || !read(position, end, z) || !readBytes(position, end, bytes, length)) {
+		return false;
+	}
+	data.shadowWidth = width;
+	data.shadowLightDirection = WFMath::Vector<3>(x, y, z);
+	data.shadow.assign(bytes, bytes + length);
+	return true;
+}
+
+std::string serializeNormals(const TerrainPageCache::PageData& data)
+{
+	std::string buffer;
+	writeBytes(buffer, data.normals.data(), data.normals.size());
+	return buffer;
+}
+
+bool deserializeNormals(const char* position, const char* end, TerrainPageCache::PageData& data)
+{
+	const char* bytes;
+	size_t length;
+	if (!readBytes(position, end, bytes, length)) {
+		return false;
+	}
+	data.normals.resize(length);
+	std::memcpy(data.normals.data(), bytes, length);
+	return true;
+}
+
+/**
+ * @brief Hashes everything about a segment which affects its height data and surfaces, apart from the mods.
+ */
+uint64_t hashSegment(uint64_t hash, const Mercator::Segment& segment)
+{
+	hash = hashValue(hash, static_cast<int32_t>(segment.getXRef()));
+	hash = hashValue(hash, static_cast<int32_t>(segment.getYRef()));
+	hash = hashValue(hash, static_cast<int32_t>(segment.getResolution()));
+	auto& controlPoints = segment.getControlPoints();
+	for (size_t i = 0; i < 4; ++i) {
+		const Mercator::BasePoint& basePoint = controlPoints[i];
+		hash = hashValue(hash, basePoint.height());
+		hash = hashValue(hash, basePoint.roughness());
+		hash = hashValue(hash, basePoint.falloff());
+	}
+
+	//The areas are kept in a multimap, in which the order of areas in the same layer isn't defined, so hash each area on its own and sort them.
+	std::vector<uint64_t> areaHashes;
+	for (auto& entry : segment.getAreas()) {
+		const Mercator::Area* area = entry.second;
+		uint64_t areaHash = hashValue(FnvOffset, static_cast<int32_t>(area->getLayer()));
+		const WFMath::Polygon<2>& shape = area->shape();
+		for (size_t i = 0; i < shape.numCorners(); ++i) {
+			areaHash = hashValue(areaHash, static_cast<float>(shape.getCorner(i).x()));
+			areaHash = hashValue(areaHash, static_cast<float>(shape.getCorner(i).y()));
+		}
+		areaHashes.push_back(areaHash);
+	}
+	std::sort(areaHashes.begin(), areaHashes.end());
+	hash = hashValue(hash, static_cast<uint32_t>(areaHashes.size()));
+	for (auto areaHash : areaHashes) {
+		hash = hashValue(hash, areaHash);
+	}
+	return hash;
+}
+}
+
+TerrainPageCache::TerrainPageCache() :
+		mDiskBudget(0), mSurfaceDefinitions(0), mStatistics { 0, 0, 0, 0, 0, 0 }
+{
+}
+
+TerrainPageCache::~TerrainPageCache()
+{
+}
+
+void TerrainPageCache::setDirectory(const std::string& directory, size_t diskBudget)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.clear();
+	mUsageOrder.clear();
+	mStatistics.entries = 0;
+	mStatistics.diskUsed = 0;
+	mDirectory.clear();
+	mDiskBudget = diskBudget;
+	if (directory.empty() || diskBudget == 0) {
+		return;
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(directory, ec);
+	if (ec) {
+		S_LOG_WARNING("Could not create directory '" << directory << "' for cached terrain pages; no pages will be cached.");
+		return;
+	}
+	mDirectory = directory;
+
+	//Pick up the pages stored by earlier sessions, ordered by when they were last used.
+	std::vector<std::pair<std::time_t, std::pair<Key, size_t>>> existing;
+	for (boost::filesystem::directory_iterator I(mDirectory, ec), end; !ec && I != end; I.increment(ec)) {
+		const boost::filesystem::path& path = I->path();
+		Key key;
+		if (path.extension() == ".page" && parseKey(path.stem().string(), key)) {
+			boost::system::error_code fileEc;
+			size_t size = static_cast<size_t>(boost::filesystem::file_size(path, fileEc));
+			std::time_t time = boost::filesystem::last_write_time(path, fileEc);
+			if (!fileEc) {
+				existing.emplace_back(time, std::make_pair(key, size));
+			}
+		} else if (path.extension() == ".tmp") {
+			//Left over from a session which ended while writing.
+			boost::system::error_code fileEc;
+			boost::filesystem::remove(path, fileEc);
+		}
+	}
+	std::sort(existing.begin(), existing.end(), [](const std::pair<std::time_t, std::pair<Key, size_t>>& lhs, const std::pair<std::time_t, std::pair<Key, size_t>>& rhs) {
+		return lhs.first < rhs.first;
+	});
+	for (auto& entry : existing) {
+		addEntry(entry.second.first, entry.second.second, CONTENTS_SEGMENTS);
+	}
+	enforceBudget();
+	S_LOG_INFO("Using " << mEntries.size() << " cached terrain pages (" << mStatistics.diskUsed / 1024 << " kB) in '" << mDirectory << "'.");
+}
+
+bool TerrainPageCache::isEnabled() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return !mDirectory.empty();
+}
+
+void TerrainPageCache::updateMod(long id, const WFMath::AxisBox<2>& area, uint64_t definitionHash, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation)
+{
+	uint64_t hash = hashValue(FnvOffset, definitionHash);
+	for (size_t i = 0; i < 3; ++i) {
+		hash = hashValue(hash, static_cast<float>(position.isValid() ? position[i] : 0));
+	}
+	if (orientation.isValid()) {
+		hash = hashValue(hash, static_cast<float>(orientation.scalar()));
+		for (size_t i = 0; i < 3; ++i) {
+			hash = hashValue(hash, static_cast<float>(orientation.vector()[i]));
+		}
+	}
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMods[id] = Mod { area, hash };
+}
+
+void TerrainPageCache::removeMod(long id)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMods.erase(id);
+}
+
+void TerrainPageCache::setSurfaceDefinitions(uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mSurfaceDefinitions = hash;
+}
+
+TerrainPageCache::Key TerrainPageCache::createKey(const TerrainIndex& index, const WFMath::AxisBox<2>& extent, unsigned int blendMapSize, const SegmentVector& segments,
+		const std::vector<const TerrainShader*>& shaders) const
+{
+	uint64_t hash = hashValue(FnvOffset, FormatVersion);
+	hash = hashValue(hash, static_cast<int32_t>(index.first));
+	hash = hashValue(hash, static_cast<int32_t>(index.second));
+	hash = hashValue(hash, static_cast<uint32_t>(blendMapSize));
+
+	std::vector<const TerrainShader*> sortedShaders(shaders);
+	std::sort(sortedShaders.begin(), sortedShaders.end(), [](const TerrainShader* lhs, const TerrainShader* rhs) {
+		return lhs->getTerrainIndex() < rhs->getTerrainIndex();
+	});
+	for (auto shader : sortedShaders) {
+		hash = hashValue(hash, static_cast<int32_t>(shader->getTerrainIndex()));
+		hash = hashString(hash, shader->getLayerDefinition().getShaderName());
+		hash = hashValue(hash, static_cast<uint32_t>(shader->getLayerDefinition().getAreaId()));
+	}
+
+	std::vector<const PageSegment*> sortedSegments;
+	for (auto& pageSegment : segments) {
+		sortedSegments.push_back(&pageSegment);
+	}
+	std::sort(sortedSegments.begin(), sortedSegments.end(), [](const PageSegment* lhs, const PageSegment* rhs) {
+		return lhs->index.x() < rhs->index.x() || (lhs->index.x() == rhs->index.x() && lhs->index.y() < rhs->index.y());
+	});
+	for (auto pageSegment : sortedSegments) {
+		hash = hashValue(hash, static_cast<int32_t>(pageSegment->index.x()));
+		hash = hashValue(hash, static_cast<int32_t>(pageSegment->index.y()));
+		hash = hashSegment(hash, *pageSegment->segment);
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	hash = hashValue(hash, mSurfaceDefinitions);
+	//Mods affect the heights of the segments they overlap, as well as their neighbours' normals, so include any touching the page.
+	for (auto& entry : mMods) {
+		if (entry.second.area.isValid() && WFMath::Intersect(entry.second.area, extent, false)) {
+			hash = hashValue(hash, static_cast<int64_t>(entry.first));
+			hash = hashValue(hash, entry.second.hash);
+		}
+	}
+	return hash;
+}
+
+bool TerrainPageCache::contains(Key key, unsigned int contents) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(key);
+	return I != mEntries.end() && (I->second.contents & contents) == contents;
+}
+
+bool TerrainPageCache::load(Key key, PageData& data)
+{
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto I = mEntries.find(key);
+		if (I == mEntries.end()) {
+			mStatistics.misses++;
+			return false;
+		}
+		path = getPath(key);
+	}
+
+	bool success = false;
+	try {
+		boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+		const char* start = static_cast<const char*>(region.get_address());
+		const char* end = start + region.get_size();
+
+		const char* position = start;
+		FileHeader header;
+		if (read(position, end, header) && std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 && header.version == FormatVersion && header.key == key) {
+			success = true;
+			std::string uncompressed;
+			for (uint32_t i = 0; i < header.sectionCount && success; ++i) {
+				SectionHeader section;
+				if (!read(position, end, section) || section.offset > static_cast<uint64_t>(end - start) || section.compressedSize > static_cast<uint64_t>(end - start) - section.offset) {
+					success = false;
+					break;
+				}
+				if (!uncompress(start + section.offset, section.compressedSize, section.uncompressedSize, uncompressed)) {
+					success = false;
+					break;
+				}
+				const char* sectionStart = uncompressed.data();
+				const char* sectionEnd = sectionStart + uncompressed.size();
+				switch (section.type) {
+				case SECTION_SEGMENTS:
+					success = deserializeSegments(sectionStart, sectionEnd, data);
+					break;
+				case SECTION_BLEND_MAPS:
+					success = deserializeBlendMaps(sectionStart, sectionEnd, data);
+					break;
+				case SECTION_NORMALS:
+					success = deserializeNormals(sectionStart, sectionEnd, data);
+					break;
+				case SECTION_SHADOW:
+					success = deserializeShadow(sectionStart, sectionEnd, data);
+					break;
+				default:
+					//Sections added by later versions can safely be ignored.
+					break;
+				}
+			}
+		}
+	} catch (const std::exception& ex) {
+		S_LOG_WARNING("Could not read cached terrain page from '" << path << "'." << ex);
+		success = false;
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(key);
+	if (!success) {
+		S_LOG_WARNING("Cached terrain page in '" << path << "' was corrupt; it will be generated anew.");
+		if (I != mEntries.end()) {
+			removeEntry(I);
+		}
+		mStatistics.misses++;
+		return false;
+	}
+	if (I != mEntries.end()) {
+		I->second.contents = getContents(data);
+		mUsageOrder.splice(mUsageOrder.end(), mUsageOrder, I->second.orderIterator);
+		//The modification time is used to order the entries in the next session.
+		boost::system::error_code ec;
+		boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+	}
+	mStatistics.hits++;
+	return true;
+}
+
+void TerrainPageCache::save(Key key, const PageData& data)
+{
+	std::string directory;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mDirectory.empty()) {
+			return;
+		}
+		directory = mDirectory;
+	}
+
+	std::vector<std::pair<SectionType, std::string>> sections;
+	sections.emplace_back(SECTION_SEGMENTS, serializeSegments(data));
+	if (!data.blendMaps.empty()) {
+		sections.emplace_back(SECTION_BLEND_MAPS, serializeBlendMaps(data));
+	}
+	if (!data.shadow.empty()) {
+		sections.emplace_back(SECTION_SHADOW, serializeShadow(data));
+		if (!data.normals.empty()) {
+			sections.emplace_back(SECTION_NORMALS, serializeNormals(data));
+		}
+	}
+
+	std::vector<SectionHeader> sectionHeaders;
+	std::vector<std::string> compressedSections;
+	uint64_t offset = sizeof(FileHeader) + sizeof(SectionHeader) * sections.size();
+	for (auto& section : sections) {
+		std::string compressed;
+		if (!compress(section.second, compressed)) {
+			S_LOG_WARNING("Could not compress terrain page for the cache.");
+			return;
+		}
+		//Keep each section aligned, so that they can be read straight from the mapping.
+		offset = (offset + 7) & ~static_cast<uint64_t>(7);
+		sectionHeaders.push_back(SectionHeader { static_cast<uint32_t>(section.first), 0, offset, compressed.size(), section.second.size() });
+		offset += compressed.size();
+		compressedSections.push_back(std::move(compressed));
+	}
+
+	std::string buffer;
+	buffer.reserve(offset);
+	FileHeader header;
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.key = key;
+	header.sectionCount = static_cast<uint32_t>(sectionHeaders.size());
+	header.reserved = 0;
+	write(buffer, header);
+	for (auto& sectionHeader : sectionHeaders) {
+		write(buffer, sectionHeader);
+	}
+	for (size_t i = 0; i < compressedSections.size(); ++i) {
+		buffer.resize(sectionHeaders[i].offset, '\0');
+		buffer.append(compressedSections[i]);
+	}
+
+	//Write to a temporary file first, so that a page is never seen half written.
+	boost::system::error_code ec;
+	boost::filesystem::path tempPath = boost::filesystem::path(directory) / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp", ec);
+	if (ec) {
+		return;
+	}
+	{
+		std::ofstream stream(tempPath.string(), std::ios::binary | std::ios::trunc);
+		if (!stream.write(buffer.data(), buffer.size()).good()) {
+			stream.close();
+			boost::filesystem::remove(tempPath, ec);
+			S_LOG_WARNING("Could not write terrain page to the cache in '" << directory << "'.");
+			return;
+		}
+	}
+
+	unsigned int contents = getContents(data);
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(key);
+	//Don't replace a page which has been stored with more contents in the meantime.
+	if (mDirectory != directory || (I != mEntries.end() && (I->second.contents & contents) == contents && I->second.contents != contents)) {
+		boost::filesystem::remove(tempPath, ec);
+		return;
+	}
+	boost::filesystem::rename(tempPath, getPath(key), ec);
+	if (ec) {
+		boost::filesystem::remove(tempPath, ec);
+		return;
+	}
+	if (I != mEntries.end()) {
+		mUsageOrder.erase(I->second.orderIterator);
+		mStatistics.diskUsed -= I->second.size;
+		mStatistics.entries--;
+		mEntries.erase(I);
+	}
+	addEntry(key, buffer.size(), contents);
+	mStatistics.stores++;
+	enforceBudget();
+}
+
+TerrainPageCache::Statistics TerrainPageCache::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStatistics;
+}
+
+bool TerrainPageCache::collectSegments(const SegmentVector& segments, PageData& data)
+{
+	for (auto& pageSegment : segments) {
+		if (!pageSegment.segment->isValid()) {
+			return false;
+		}
+		for (auto& entry : pageSegment.segment->getSurfaces()) {
+			if (!entry.second->isValid()) {
+				return false;
+			}
+		}
+		data.segments.push_back(PageData::SegmentData { static_cast<int>(pageSegment.index.x()), static_cast<int>(pageSegment.index.y()), SegmentSpillCache::serialize(
+				*pageSegment.segment) });
+	}
+	return true;
+}
+
+bool TerrainPageCache::restoreSegments(const PageData& data, const SegmentVector& segments, const std::vector<const TerrainShader*>& shaders)
+{
+	std::map<std::pair<int, int>, const std::string*> segmentData;
+	for (auto& segment : data.segments) {
+		segmentData.emplace(std::make_pair(segment.xIndex, segment.yIndex), &segment.data);
+	}
+
+	for (auto& pageSegment : segments) {
+		auto I = segmentData.find(std::make_pair(static_cast<int>(pageSegment.index.x()), static_cast<int>(pageSegment.index.y())));
+		if (I == segmentData.end()) {
+			return false;
+		}
+		Mercator::Segment& segment = *pageSegment.segment;
+		if (!SegmentSpillCache::deserialize(*I->second, segment)) {
+			return false;
+		}
+
+		//Surfaces are only added to segments when the layers are populated, so any missing ones have to be added here in the same way.
+		//Whether a shader applies depends on the heights, so this can only be done once they've been restored.
+		bool addedSurfaces = false;
+		auto& surfaces = segment.getSurfaces();
+		for (auto shader : shaders) {
+			if (surfaces.find(shader->getTerrainIndex()) == surfaces.end() && shader->getShader().checkIntersect(segment)) {
+				surfaces[shader->getTerrainIndex()] = shader->getShader().newSurface(segment);
+				addedSurfaces = true;
+			}
+		}
+		if (addedSurfaces) {
+			SegmentSpillCache::deserialize(*I->second, segment);
+		}
+
+		if (!segment.isValid()) {
+			return false;
+		}
+		for (auto& entry : surfaces) {
+			if (!entry.second->isValid()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+uint64_t TerrainPageCache::hashElement(const Atlas::Message::Element& element, uint64_t seed)
+{
+	uint64_t hash = seed ? seed : FnvOffset;
+	if (element.isInt()) {
+		hash = hashValue(hash, 'i');
+		hash = hashValue(hash, static_cast<int64_t>(element.asInt()));
+	} else if (element.isFloat()) {
+		hash = hashValue(hash, 'f');
+		hash = hashValue(hash, static_cast<double>(element.asFloat()));
+	} else if (element.isString()) {
+		hash = hashValue(hash, 's');
+		hash = hashString(hash, element.asString());
+	} else if (element.isList()) {
+		hash = hashValue(hash, 'l');
+		hash = hashValue(hash, static_cast<uint64_t>(element.asList().size()));
+		for (auto& child : element.asList()) {
+			hash = hashElement(child, hash);
+		}
+	} else if (element.isMap()) {
+		//Maps are ordered, so the hash doesn't depend on the order in which the entries were added.
+		hash = hashValue(hash, 'm');
+		hash = hashValue(hash, static_cast<uint64_t>(element.asMap().size()));
+		for (auto& entry : element.asMap()) {
+			hash = hashString(hash, entry.first);
+			hash = hashElement(entry.second, hash);
+		}
+	} else {
+		hash = hashValue(hash, 'n');
+	}
+	return hash;
+}
+
+unsigned int TerrainPageCache::getContents(const PageData& data)
+{
+	unsigned int contents = CONTENTS_SEGMENTS;
+	if (!data.blendMaps.empty()) {
+		contents |= CONTENTS_BLEND_MAPS;
+	}
+	if (!data.shadow.empty() && !data.normals.empty()) {
+		contents |= CONTENTS_SHADOW;
+	}
+	return contents;
+}
+
+void TerrainPageCache::addEntry(Key key, size_t size, unsigned int contents)
+{
+	mUsageOrder.push_back(key);
+	mEntries.emplace(key, Entry { size, contents, std::prev(mUsageOrder.end()) });
+	mStatistics.diskUsed += size;
+	mStatistics.entries++;
+}
+
+void TerrainPageCache::removeEntry(std::unordered_map<Key, Entry>::iterator I)
+{
+	mUsageOrder.erase(I->second.orderIterator);
+	mStatistics.diskUsed -= I->second.size;
+	mStatistics.entries--;
+	boost::system::error_code ec;
+	boost::filesystem::remove(getPath(I->first), ec);
+	mEntries.erase(I);
+}
+
+void TerrainPageCache::enforceBudget()
+{
+	while (mStatistics.diskUsed > mDiskBudget && !mUsageOrder.empty()) {
+		removeEntry(mEntries.find(mUsageOrder.front()));
+		mStatistics.evictions++;
+	}
+}
+
+std::string TerrainPageCache::getPath(Key key) const
+{
+	std::stringstream ss;
+	ss << mDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".page";
+	return ss.str();
+}
+
+bool TerrainPageCache::parseKey(const std::string& fileName, Key& key)
+{
+	if (fileName.size() != 16 || fileName.find_first_not_of("0123456789abcdef") != std::string::npos) {
+		return false;
+	}
+	std::stringstream ss(fileName);
+	ss >> std::hex >> key;
+	return !ss.fail();
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,364 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_TERRAINPAGECACHE_H_
+#define EMBEROGRE_TERRAIN_TERRAINPAGECACHE_H_
+
+#include "Types.h"
+#include "TerrainPageGeometry.h"
+#include "BlendMapCache.h"
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+#include <wfmath/quaternion.h>
+#include <wfmath/vector.h>
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Atlas
+{
+namespace Message
+{
+class Element;
+}
+}
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+class TerrainShader;
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Keeps generated terrain pages on disk between sessions.
+ *
+ * Generating a page means populating the height data and surfaces of all its segments, composing the blend maps and possibly baking a shadow.
+ * Since the base points, mods and areas of a world seldom change between sessions, the result of this is stored on disk and restored the next time the
+ * page is needed, instead of being generated anew.
+ *
+ * The cache is content addressed: each page is stored under a key which is a hash of everything the generated data depends on; the base points, areas
+ * and mods affecting the page's segments as well as the shaders and their layer definitions. Whenever any of these changes the key changes too, so
+ * entries never have to be explicitly invalidated. The mods and the surface definitions can't be read from the Mercator terrain in a form suitable for
+ * hashing, so they have to be registered through updateMod() and setSurfaceDefinitions().
+ *
+ * Each page is stored in its own file, made up of a header, a table of sections and the sections themselves, each compressed on its own. A file is
+ * read by mapping it into memory and decompressing the sections straight from the mapping. The files are in the byte order of the machine, and
+ * files with another byte order or format version are ignored.
+ *
+ * The files are kept within a disk budget, by removing the least recently used ones. The time a file was last used is kept as its modification time,
+ * so that this persists between sessions.
+ *
+ * All methods are thread safe.
+ */
+class TerrainPageCache
+{
+public:
+
+	typedef uint64_t Key;
+
+	/**
+	 * @brief The parts of a page which can be stored, as flags.
+	 */
+	enum Contents
+	{
+		CONTENTS_SEGMENTS = 1 << 0, CONTENTS_BLEND_MAPS = 1 << 1, CONTENTS_SHADOW = 1 << 2
+	};
+
+	/**
+	 * @brief The contents of a page, as stored in the cache.
+	 */
+	struct PageData
+	{
+		struct SegmentData
+		{
+			/**
+			 * @brief The x index of the segment within the page.
+			 */
+			int xIndex;
+
+			/**
+			 * @brief The y index of the segment within the page.
+			 */
+			int yIndex;
+
+			/**
+			 * @brief The height map and surfaces, as serialized by SegmentSpillCache::serialize().
+			 */
+			std::string data;
+		};
+
+		std::vector<SegmentData> segments;
+
+		/**
+		 * @brief Combined blend maps; empty if none had been composed.
+		 */
+		std::vector<BlendMapCache::StoredBlendMap> blendMaps;
+
+		/**
+		 * @brief The width of the shadow.
+		 */
+		unsigned int shadowWidth = 0;
+
+		/**
+		 * @brief The precomputed shadow; empty if none had been baked.
+		 */
+		std::vector<unsigned char> shadow;
+
+		/**
+		 * @brief The light direction the shadow was baked with.
+		 */
+		WFMath::Vector<3> shadowLightDirection;
+
+		/**
+		 * @brief The normals the shadow was baked from, three signed bytes per pixel laid out as the shadow; empty if there's no shadow.
+		 */
+		std::vector<int8_t> normals;
+	};
+
+	struct Statistics
+	{
+		/**
+		 * @brief The number of pages found in the cache.
+		 */
+		size_t hits;
+
+		/**
+		 * @brief The number of pages not found in the cache.
+		 */
+		size_t misses;
+
+		/**
+		 * @brief The number of pages written to the cache.
+		 */
+		size_t stores;
+
+		/**
+		 * @brief The number of files removed because of the disk budget.
+		 */
+		size_t evictions;
+
+		/**
+		 * @brief The number of files in the cache.
+		 */
+		size_t entries;
+
+		/**
+		 * @brief The number of bytes used by the files in the cache.
+		 */
+		size_t diskUsed;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * The cache is disabled until a directory has been set.
+	 */
+	TerrainPageCache();
+
+	~TerrainPageCache();
+
+	/**
+	 * @brief Sets the directory in which the pages are stored.
+	 *
+	 * Any files already in the directory are used, and removed if they don't fit within the budget.
+	 * @param directory The directory. If empty the cache is disabled.
+	 * @param diskBudget The maximum number of bytes to use. If zero the cache is disabled.
+	 */
+	void setDirectory(const std::string& directory, size_t diskBudget);
+
+	/**
+	 * @brief True if a directory has been set and the cache can be used.
+	 */
+	bool isEnabled() const;
+
+	/**
+	 * @brief Registers a mod, or updates an already registered one.
+	 *
+	 * This must be done whenever a mod is applied to the terrain.
+	 * @param id The id of the mod.
+	 * @param area The area affected by the mod.
+	 * @param definitionHash A hash of the definition of the mod, as created by hashElement().
+	 * @param position The position of the mod.
+	 * @param orientation The orientation of the mod.
+	 */
+	void updateMod(long id, const WFMath::AxisBox<2>& area, uint64_t definitionHash, const WFMath::Point<3>& position, const WFMath::Quaternion& orientation);
+
+	/**
+	 * @brief Unregisters a mod, which must be done when it's removed from the terrain.
+	 */
+	void removeMod(long id);
+
+	/**
+	 * @brief Sets a hash of the definitions of the surfaces of the terrain, which aren't kept by the shaders themselves.
+	 */
+	void setSurfaceDefinitions(uint64_t hash);
+
+	/**
+	 * @brief Creates the key of a page from everything affecting its contents.
+	 *
+	 * This must be called from the terrain handling thread, since it reads from the segments.
+	 * @param index The index of the page.
+	 * @param extent The extent of the page in world units.
+	 * @param blendMapSize The size of the blend maps of the page.
+	 * @param segments The segments of the page. These don't need to be populated.
+	 * @param shaders All terrain shaders.
+	 * @return A key.
+	 */
+	Key createKey(const TerrainIndex& index, const WFMath::AxisBox<2>& extent, unsigned int blendMapSize, const SegmentVector& segments,
+			const std::vector<const TerrainShader*>& shaders) const;
+
+	/**
+	 * @brief Checks whether a page is in the cache, with at least the specified contents.
+	 *
+	 * The contents of pages stored in earlier sessions aren't known until they have been loaded; until then they're taken to only contain the segments.
+	 * @param key The key of the page.
+	 * @param contents The contents, as Contents flags.
+	 * @return True if the page is stored with all of the contents.
+	 */
+	bool contains(Key key, unsigned int contents = CONTENTS_SEGMENTS) const;
+
+	/**
+	 * @brief Reads a page from the cache.
+	 * @param key The key of the page.
+	 * @param data The data is placed here.
+	 * @return True if the page was found and could be read.
+	 */
+	bool load(Key key, PageData& data);
+
+	/**
+	 * @brief Writes a page to the cache, replacing any existing page with the same key.
+	 *
+	 * An existing page is however kept if it has more contents than the new one.
+	 */
+	void save(Key key, const PageData& data);
+
+	Statistics getStatistics() const;
+
+	/**
+	 * @brief Adds the data of the segments of a page to data to be stored.
+	 * @param segments The segments of the page.
+	 * @param data The data to add to.
+	 * @return False if any of the segments or their surfaces weren't populated, in which case the page shouldn't be stored.
+	 */
+	static bool collectSegments(const SegmentVector& segments, PageData& data);
+
+	/**
+	 * @brief Restores the segments of a page from stored data.
+	 *
+	 * Segments which already have valid height data only get their invalid surfaces restored. Any surfaces which don't exist in the segments are added
+	 * for the shaders which apply to them.
+	 * @param data The stored data.
+	 * @param segments The segments of the page.
+	 * @param shaders All terrain shaders.
+	 * @return True if all segments and their surfaces are valid afterwards.
+	 */
+	static bool restoreSegments(const PageData& data, const SegmentVector& segments, const std::vector<const TerrainShader*>& shaders);
+
+	/**
+	 * @brief Hashes an Atlas element, such as the definition of a mod.
+	 * @param element The element.
+	 * @param seed A hash to build upon.
+	 * @return A hash.
+	 */
+	static uint64_t hashElement(const Atlas::Message::Element& element, uint64_t seed = 0);
+
+	/**
+	 * @brief Gets the contents of page data.
+	 * @param data The page data.
+	 * @return The contents, as Contents flags.
+	 */
+	static unsigned int getContents(const PageData& data);
+
+private:
+
+	struct Mod
+	{
+		WFMath::AxisBox<2> area;
+		uint64_t hash;
+	};
+
+	struct Entry
+	{
+		/**
+		 * @brief The size of the file.
+		 */
+		size_t size;
+
+		/**
+		 * @brief The contents of the file, as Contents flags.
+		 */
+		unsigned int contents;
+
+		/**
+		 * @brief The position in mUsageOrder.
+		 */
+		std::list<Key>::iterator orderIterator;
+	};
+
+	std::string mDirectory;
+	size_t mDiskBudget;
+
+	/**
+	 * @brief The registered mods, by id.
+	 */
+	std::map<long, Mod> mMods;
+
+	uint64_t mSurfaceDefinitions;
+
+	std::unordered_map<Key, Entry> mEntries;
+
+	/**
+	 * @brief The keys of all entries, least recently used first.
+	 */
+	std::list<Key> mUsageOrder;
+
+	Statistics mStatistics;
+
+	mutable std::mutex mMutex;
+
+	void addEntry(Key key, size_t size, unsigned int contents);
+
+	void removeEntry(std::unordered_map<Key, Entry>::iterator I);
+
+	/**
+	 * @brief Removes the least recently used files until the budget is met.
+	 */
+	void enforceBudget();
+
+	std::string getPath(Key key) const;
+
+	static bool parseKey(const std::string& fileName, Key& key);
+};
+
+}
+
+}
+
+}
+
+#endif /* EMBEROGRE_TERRAIN_TERRAINPAGECACHE_H_ */
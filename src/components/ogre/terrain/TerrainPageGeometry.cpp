@@ -213,7 +213,7 @@ bool TerrainPageGeometry::getNormal(const TerrainPosition& localPosition, WFMath
 		size_t xPos = localPosition.x() - (I_ROUND(floor(localPosition.x() / resolution)) * resolution);
 		size_t yPos = localPosition.y() - (I_ROUND(floor(localPosition.y() / resolution)) * resolution);
 		size_t normalPos = (yPos * segment->getSize() * 3) + (xPos * 3);
-		normal = WFMath::Vector<3>(segment->getNormals()[normalPos], segment->getNormals()[normalPos + 1], segment->getNormals()[normalPos] + 2);
+		normal = WFMath::Vector<3>(segment->getNormals()[normalPos], segment->getNormals()[normalPos + 1], segment->getNormals()[normalPos + 2]);
 		return true;
 	} else {
 		return false;
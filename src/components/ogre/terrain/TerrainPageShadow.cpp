@@ -31,9 +31,15 @@
 #include "OgreImage.h"
 #include "../Convert.h"
 
+#include <Mercator/Segment.h>
+
 #include <OgreColourValue.h>
 #include <OgreImage.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace Ember
 {
 namespace OgreView
@@ -42,7 +48,7 @@ namespace Terrain
 {
 
 TerrainPageShadow::TerrainPageShadow(const TerrainPage& terrainPage) :
-		mTerrainPage(terrainPage), mLightDirection(WFMath::Vector<3>::ZERO()), mImage(nullptr)
+		mTerrainPage(terrainPage), mLightDirection(WFMath::Vector<3>::ZERO()), mImage(nullptr), mBakedLightDirection(WFMath::Vector<3>::ZERO())
 {
 }
 
@@ -56,46 +62,186 @@ void TerrainPageShadow::setLightDirection(const WFMath::Vector<3>& lightDirectio
 	mLightDirection = lightDirection;
 }
 
+const WFMath::Vector<3>& TerrainPageShadow::getLightDirection() const
+{
+	return mLightDirection;
+}
+
+bool TerrainPageShadow::needsUpdate(const WFMath::Vector<3>& lightDirection, float threshold) const
+{
+	if (!mImage || !mLightDirection.isValid() || mLightDirection.sqrMag() == 0) {
+		return true;
+	}
+	return WFMath::Angle(mLightDirection, lightDirection) >= threshold;
+}
+
 void TerrainPageShadow::updateShadow(const TerrainPageGeometry& geometry)
+{
+	updateShadow(geometry, mLightDirection);
+}
+
+void TerrainPageShadow::updateShadow(const TerrainPageGeometry& geometry, const WFMath::Vector<3>& lightDirection, std::vector<int8_t>* bakedNormals)
 {
 	if (!mImage) {
 		mImage = new OgreImage(new Image::ImageBuffer(mTerrainPage.getBlendMapSize(), 1));
 	}
-	mImage->reset();
 
+	WFMath::Vector<3> wfLightDirection = lightDirection;
+	wfLightDirection = wfLightDirection.normalize(1);
 
-	int pageSizeInVertices = mTerrainPage.getPageSize();
-	int pageSizeInMeters = pageSizeInVertices - 1;
+	NormalBuffer normals;
+	if (!mRestoredNormals.empty()) {
+		//The restored shadow is still correct if the light hasn't moved; otherwise bake it from the restored normals.
+		if (!lightDirection.isEqualTo(mBakedLightDirection)) {
+			dequantizeNormals(mRestoredNormals, normals);
+			computeShadow(normals, wfLightDirection, 0, std::min(normals.weight.size(), mImage->getSize()), mImage->getData());
+		}
+		if (bakedNormals) {
+			bakedNormals->swap(mRestoredNormals);
+		}
+		std::vector<int8_t>().swap(mRestoredNormals);
+	} else {
+		int pageSizeInMeters = mTerrainPage.getPageSize() - 1;
+		gatherNormals(geometry, pageSizeInMeters, normals);
+		computeShadow(normals, wfLightDirection, 0, normals.weight.size(), mImage->getData());
+		if (bakedNormals) {
+			quantizeNormals(normals, *bakedNormals);
+		}
+	}
+	mBakedLightDirection = lightDirection;
+}
 
-	//since Ogre uses a different coord system than WF, we have to do some conversions here
-	TerrainPosition origPosition(0, pageSizeInMeters - 1);
+bool TerrainPageShadow::getBakedLightDirection(WFMath::Vector<3>& lightDirection) const
+{
+	if (!mImage) {
+		return false;
+	}
+	lightDirection = mBakedLightDirection;
+	return true;
+}
 
-	WFMath::Vector<3> wfLightDirection = mLightDirection;
-	wfLightDirection = wfLightDirection.normalize(1);
+bool TerrainPageShadow::copyImage(std::vector<unsigned char>& image) const
+{
+	if (!mImage) {
+		return false;
+	}
+	image.assign(mImage->getData(), mImage->getData() + mImage->getSize());
+	return true;
+}
+
+void TerrainPageShadow::restore(const std::vector<unsigned char>& image, const WFMath::Vector<3>& lightDirection, std::vector<int8_t> normals)
+{
+	if (!mImage) {
+		mImage = new OgreImage(new Image::ImageBuffer(mTerrainPage.getBlendMapSize(), 1));
+	}
+	std::memcpy(mImage->getData(), image.data(), std::min(image.size(), mImage->getSize()));
+	mBakedLightDirection = lightDirection;
+	mRestoredNormals = std::move(normals);
+}
 
-	TerrainPosition position(origPosition);
+bool TerrainPageShadow::hasRestoredNormals() const
+{
+	return !mRestoredNormals.empty();
+}
 
-	auto data = mImage->getData();
+void TerrainPageShadow::quantizeNormals(const NormalBuffer& normals, std::vector<int8_t>& quantized)
+{
+	size_t count = normals.weight.size();
+	quantized.assign(count * 3, 0);
+	auto quantize = [](float value) {
+		return static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, std::round(value * 127.0f))));
+	};
+	for (size_t i = 0; i < count; ++i) {
+		if (normals.weight[i] > 0) {
+			quantized[i * 3] = quantize(normals.x[i]);
+			quantized[i * 3 + 1] = quantize(normals.y[i]);
+			quantized[i * 3 + 2] = quantize(normals.z[i]);
+		}
+	}
+}
 
-	for (int i = 0; i < pageSizeInMeters; ++i) {
-		position = origPosition;
-		position[1] = position[1] - i;
-		for (int j = 0; j < pageSizeInMeters; ++j) {
-			WFMath::Vector<3> normal;
-			if (geometry.getNormal(position, normal)) {
-				float dotProduct = WFMath::Dot(normal.normalize(1), wfLightDirection);
+void TerrainPageShadow::dequantizeNormals(const std::vector<int8_t>& quantized, NormalBuffer& normals)
+{
+	size_t count = quantized.size() / 3;
+	normals.x.assign(count, 0.0f);
+	normals.y.assign(count, 0.0f);
+	normals.z.assign(count, 0.0f);
+	normals.weight.assign(count, 0.0f);
+	for (size_t i = 0; i < count; ++i) {
+		float nx = quantized[i * 3];
+		float ny = quantized[i * 3 + 1];
+		float nz = quantized[i * 3 + 2];
+		float magnitude = std::sqrt((nx * nx) + (ny * ny) + (nz * nz));
+		if (magnitude > 0) {
+			normals.x[i] = nx / magnitude;
+			normals.y[i] = ny / magnitude;
+			normals.z[i] = nz / magnitude;
+			normals.weight[i] = 1.0f;
+		}
+	}
+}
 
-				// if the dotProduct is > 0, the face is looking away from the sun
-				*data = static_cast<unsigned char>((1.0f - ((dotProduct + 1.0f) * 0.5f)) * 255);
+void TerrainPageShadow::gatherNormals(const TerrainPageGeometry& geometry, int size, NormalBuffer& normals)
+{
+	size_t count = static_cast<size_t>(size) * size;
+	normals.x.assign(count, 0.0f);
+	normals.y.assign(count, 0.0f);
+	normals.z.assign(count, 0.0f);
+	normals.weight.assign(count, 0.0f);
 
+	size_t index = 0;
+	//since Ogre uses a different coord system than WF, the rows are stored from the top down
+	for (int i = 0; i < size; ++i) {
+		int y = size - 1 - i;
+		int x = 0;
+		while (x < size) {
+			TerrainPosition localPosition;
+			const Mercator::Segment* segment = geometry.getSegmentAtLocalPosition(TerrainPosition(x, y), localPosition);
+			int xPos = static_cast<int>(localPosition.x());
+			//Segments are always 64 units, as assumed by getSegmentAtLocalPosition().
+			int span = std::min(64 - xPos, size - x);
+			if (segment && segment->getNormals()) {
+				int yPos = static_cast<int>(localPosition.y());
+				const float* segmentNormals = segment->getNormals() + ((yPos * segment->getSize()) + xPos) * 3;
+				for (int j = 0; j < span; ++j) {
+					float nx = segmentNormals[0];
+					float ny = segmentNormals[1];
+					float nz = segmentNormals[2];
+					float magnitude = std::sqrt((nx * nx) + (ny * ny) + (nz * nz));
+					if (magnitude > 0) {
+						normals.x[index] = nx / magnitude;
+						normals.y[index] = ny / magnitude;
+						normals.z[index] = nz / magnitude;
+						normals.weight[index] = 1.0f;
+					}
+					segmentNormals += 3;
+					index++;
+				}
 			} else {
-				*data = 0;
+				index += span;
 			}
-			data++;
-			position[0] = position[0] + 1;
+			x += span;
 		}
 	}
+}
 
+void TerrainPageShadow::computeShadow(const NormalBuffer& normals, const WFMath::Vector<3>& lightDirection, size_t start, size_t end, unsigned char* destination)
+{
+	const float lx = lightDirection.x();
+	const float ly = lightDirection.y();
+	const float lz = lightDirection.z();
+	const float* __restrict nx = normals.x.data();
+	const float* __restrict ny = normals.y.data();
+	const float* __restrict nz = normals.z.data();
+	const float* __restrict weight = normals.weight.data();
+	unsigned char* __restrict data = destination;
+
+	for (size_t i = start; i < end; ++i) {
+		float dotProduct = (nx[i] * lx) + (ny[i] * ly) + (nz[i] * lz);
+		// if the dotProduct is > 0, the face is looking away from the sun
+		float value = (1.0f - ((dotProduct + 1.0f) * 0.5f)) * 255.0f * weight[i];
+		data[i] = static_cast<unsigned char>(value);
+	}
 }
 
 void TerrainPageShadow::loadIntoImage(Ogre::Image& ogreImage) const
@@ -24,7 +24,9 @@
 #define EMBEROGRETERRAINPAGESHADOW_H
 #include "../EmberOgrePrerequisites.h"
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 #include <wfmath/vector.h>
 #include <OgreMath.h>
 
@@ -44,18 +46,121 @@ class OgreImage;
 
 /**
 	@author Erik Ogenvik <erik@ogenvik.org>
+	@brief A precomputed lambert shadow for a terrain page.
+
+	The shadow is baked by first gathering all normals of the page into a contiguous buffer, and then applying the light direction to the whole buffer in one go.
+	Baking a page only reads from the page's geometry, so different pages can be baked in parallel.
 */
 class TerrainPageShadow
 {
 public:
+
+	/**
+	 * @brief Contiguous normals for a page, stored as separate arrays for each component.
+	 * Positions without any valid normal have a weight of zero.
+	 */
+	struct NormalBuffer
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> weight;
+	};
+
 	TerrainPageShadow(const TerrainPage& terrainPage);
 
 	virtual ~TerrainPageShadow();
 
 	void setLightDirection(const WFMath::Vector<3>& lightDirection);
 
+	/**
+	 * @brief Gets the light direction used when the shadow was last baked.
+	 * @return The light direction, or a zero vector if no light direction has been set.
+	 */
+	const WFMath::Vector<3>& getLightDirection() const;
+
+	/**
+	 * @brief Checks whether the shadow needs to be baked again for a new light direction.
+	 * @param lightDirection The new light direction.
+	 * @param threshold The angle, in radians, which the light direction must change before the shadow is baked again.
+	 * @return True if the shadow needs to be baked again.
+	 */
+	bool needsUpdate(const WFMath::Vector<3>& lightDirection, float threshold) const;
+
 	void updateShadow(const TerrainPageGeometry& geometry);
 
+	/**
+	 * @brief Bakes the shadow using the supplied light direction rather than the one set through setLightDirection().
+	 * This allows a background task to bake with its own copy of the light direction while the main thread is free to update the page's light direction.
+	 * @param geometry The geometry of the page. Normals must already be populated.
+	 * @param lightDirection The light direction.
+	 * @param bakedNormals If not null, the normals the shadow was baked from are placed here, quantized as by quantizeNormals().
+	 */
+	void updateShadow(const TerrainPageGeometry& geometry, const WFMath::Vector<3>& lightDirection, std::vector<int8_t>* bakedNormals = nullptr);
+
+	/**
+	 * @brief Gathers the normals of the geometry into a contiguous buffer, laid out in the same order as the shadow image.
+	 * @param geometry The geometry of the page. Normals must already be populated.
+	 * @param size The size of one side of the shadow image.
+	 * @param normals The buffer to fill. It will be resized as needed.
+	 */
+	static void gatherNormals(const TerrainPageGeometry& geometry, int size, NormalBuffer& normals);
+
+	/**
+	 * @brief Calculates shadow values for a range of normals.
+	 * This is written as a straight loop over the component arrays so that it can be vectorised by the compiler.
+	 * @param normals The normals.
+	 * @param lightDirection The normalised light direction.
+	 * @param start The first normal to process.
+	 * @param end One past the last normal to process.
+	 * @param destination The shadow values will be written here, starting at destination[start].
+	 */
+	static void computeShadow(const NormalBuffer& normals, const WFMath::Vector<3>& lightDirection, size_t start, size_t end, unsigned char* destination);
+
+	/**
+	 * @brief Gets the light direction the shadow was last baked with.
+	 * @param lightDirection The light direction will be placed here.
+	 * @return False if no shadow has been baked.
+	 */
+	bool getBakedLightDirection(WFMath::Vector<3>& lightDirection) const;
+
+	/**
+	 * @brief Copies the shadow values, as last baked or restored.
+	 * @param image The shadow values will be placed here.
+	 * @return False if no shadow has been baked.
+	 */
+	bool copyImage(std::vector<unsigned char>& image) const;
+
+	/**
+	 * @brief Restores a previously baked shadow, along with the normals it was baked from.
+	 *
+	 * The next call to updateShadow() will use the normals rather than the geometry, and keep the restored shadow if the light direction is the same.
+	 * This way the normals of the geometry don't need to be populated. The normals are released once used.
+	 * @param image The shadow values.
+	 * @param lightDirection The light direction the shadow was baked with.
+	 * @param normals The quantized normals, as created by quantizeNormals().
+	 */
+	void restore(const std::vector<unsigned char>& image, const WFMath::Vector<3>& lightDirection, std::vector<int8_t> normals);
+
+	/**
+	 * @brief True if restored normals are waiting to be used by updateShadow().
+	 */
+	bool hasRestoredNormals() const;
+
+	/**
+	 * @brief Quantizes normals into three signed bytes each, for storage.
+	 * @param normals The normals.
+	 * @param quantized The quantized normals will be placed here.
+	 */
+	static void quantizeNormals(const NormalBuffer& normals, std::vector<int8_t>& quantized);
+
+	/**
+	 * @brief Expands normals created by quantizeNormals(). Positions without any normal get a weight of zero.
+	 * @param quantized The quantized normals.
+	 * @param normals The buffer to fill. It will be resized as needed.
+	 */
+	static void dequantizeNormals(const std::vector<int8_t>& quantized, NormalBuffer& normals);
+
 	void loadIntoImage(Ogre::Image& ogreImage) const;
 
 	/**
@@ -85,6 +190,16 @@ protected:
 
 	OgreImage* mImage;
 
+	/**
+	 * @brief The light direction which the shadow in mImage was baked with.
+	 */
+	WFMath::Vector<3> mBakedLightDirection;
+
+	/**
+	 * @brief Quantized normals restored along with the shadow, to be used instead of the geometry the next time the shadow is baked.
+	 */
+	std::vector<int8_t> mRestoredNormals;
+
 	/**
 	 * @brief An optional shadow texture name.
 	 *
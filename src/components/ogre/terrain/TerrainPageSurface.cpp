@@ -30,6 +30,7 @@
 #include "TerrainPageSurfaceCompiler.h"
 #include "TerrainPageGeometry.h"
 #include "TerrainLayerDefinition.h"
+#include "BlendMapCache.h"
 #include "../Convert.h"
 #include <OgreMaterialManager.h>
 #include <OgreRoot.h>
@@ -42,7 +43,7 @@ namespace Terrain
 {
 
 TerrainPageSurface::TerrainPageSurface(const TerrainPage& terrainPage, ICompilerTechniqueProvider& compilerTechniqueProvider) :
-	mTerrainPage(terrainPage), mSurfaceCompiler(new TerrainPageSurfaceCompiler(compilerTechniqueProvider)), mShadow(new TerrainPageShadow(terrainPage))
+	mTerrainPage(terrainPage), mSurfaceCompiler(new TerrainPageSurfaceCompiler(compilerTechniqueProvider)), mShadow(new TerrainPageShadow(terrainPage)), mBlendMapCache(new BlendMapCache(terrainPage))
 {
 	//create a name for out material
 	// 	S_LOG_INFO("Creating a material for the terrain.");
@@ -131,6 +132,11 @@ TerrainPageShadow* TerrainPageSurface::getShadow() const
 	return mShadow;
 }
 
+BlendMapCache* TerrainPageSurface::getBlendMapCache() const
+{
+	return mBlendMapCache.get();
+}
+
 
 }
 
@@ -52,6 +52,7 @@ class TerrainPageGeometry;
 class TerrainLayerDefinition;
 class TerrainPageSurfaceCompilationInstance;
 class ICompilerTechniqueProvider;
+class BlendMapCache;
 
 /**
  @author Erik Ogenvik <erik@ogenvik.org>
@@ -111,6 +112,12 @@ public:
 	 */
 	TerrainPageShadow* getShadow() const;
 
+	/**
+	 * @brief Gets the cache of combined blend maps for this surface.
+	 * @return The blend map cache.
+	 */
+	BlendMapCache* getBlendMapCache() const;
+
 protected:
 
 	std::string mMaterialName;
@@ -118,6 +125,8 @@ protected:
 	TerrainPageSurfaceLayerStore mLayers;
 	std::unique_ptr<TerrainPageSurfaceCompiler> mSurfaceCompiler;
 	TerrainPageShadow* mShadow;
+
+	std::unique_ptr<BlendMapCache> mBlendMapCache;
 	Ogre::MaterialPtr mMaterial;
 	Ogre::MaterialPtr mMaterialComposite;
 
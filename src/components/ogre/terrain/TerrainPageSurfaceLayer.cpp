@@ -29,7 +29,8 @@
 #include "TerrainPageSurface.h"
 #include "TerrainLayerDefinition.h"
 #include "TerrainPageGeometry.h"
-#include "WFImage.h"
+#include "Image.h"
+#include "BlendMapCompositor.h"
 #include <Mercator/Surface.h>
 #include <Mercator/Shader.h>
 
@@ -68,23 +69,11 @@ void TerrainPageSurfaceLayer::fillImage(const TerrainPageGeometry& geometry, Ima
 	SegmentVector validSegments = geometry.getValidSegments();
 	for (SegmentVector::const_iterator I = validSegments.begin(); I != validSegments.end(); ++I) {
 		Mercator::Segment* segment = I->segment;
-		if (mShader.checkIntersect(*segment)) {
-			Mercator::Surface* surface = getSurfaceForSegment(segment);
-			if (surface && surface->isValid()) {
-				WFImage sourceImage(new Image::ImageBuffer(segment->getResolution(), 1));
-				auto srcPtr = surface->getData();
-				auto dataPtr = sourceImage.getData();
-				auto segmentSize = segment->getSize();
-				for (int i = 0; i < segment->getResolution(); ++i) {
-					for (int j = 0; j < segment->getResolution(); ++j) {
-						//interpolate four samples to get the fragment coverage
-						*dataPtr = (unsigned char)((srcPtr[(i * segmentSize) + j] + srcPtr[(i * segmentSize) + j + 1] + srcPtr[((i + 1) * segmentSize) + j] + srcPtr[((i + 1) * segmentSize) + j + 1]) / 4);
-						dataPtr++;
-					}
-				}
-
-				image.blit(sourceImage, channel, ((int)I->index.x() * segment->getResolution()), ((mTerrainPageSurface.getNumberOfSegmentsPerAxis() - (int)I->index.y() - 1) * segment->getResolution()));
-			}
+		Mercator::Surface* surface = getCoverageSurface(*segment);
+		if (surface) {
+			const unsigned char* coverage = surface->getData();
+			BlendMapCompositor::composeSegment(&coverage, 1, channel, segment->getResolution(), image.getData(), image.getChannels(), image.getResolution(),
+					((int)I->index.x() * segment->getResolution()), ((mTerrainPageSurface.getNumberOfSegmentsPerAxis() - (int)I->index.y() - 1) * segment->getResolution()));
 		}
 	}
 }
@@ -114,6 +103,18 @@ Mercator::Surface* TerrainPageSurfaceLayer::getSurfaceForSegment(const Mercator:
 	return I->second;
 }
 
+Mercator::Surface* TerrainPageSurfaceLayer::getCoverageSurface(const Mercator::Segment& segment) const
+{
+	if (!mShader.checkIntersect(segment)) {
+		return nullptr;
+	}
+	Mercator::Surface* surface = getSurfaceForSegment(&segment);
+	if (surface && surface->isValid()) {
+		return surface;
+	}
+	return nullptr;
+}
+
 
 const std::string& TerrainPageSurfaceLayer::getDiffuseTextureName() const
 {
@@ -81,6 +81,13 @@ public:
 	int getSurfaceIndex() const;
 	Mercator::Surface* getSurfaceForSegment(const Mercator::Segment* segment) const;
 
+	/**
+	 * @brief Gets the surface of a segment which holds the coverage of this layer.
+	 * @param segment The segment.
+	 * @return The surface, or null if the layer doesn't intersect the segment or the surface isn't valid.
+	 */
+	Mercator::Surface* getCoverageSurface(const Mercator::Segment& segment) const;
+
 	float getScale() const;
 	void setScale(float scale);
 
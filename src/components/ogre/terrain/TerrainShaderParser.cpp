@@ -22,6 +22,7 @@
 #include "components/ogre/terrain/TerrainShader.h"
 #include "components/ogre/terrain/TerrainLayerDefinition.h"
 #include "components/ogre/terrain/TerrainLayerDefinitionManager.h"
+#include "components/ogre/terrain/TerrainPageCache.h"
 
 #include <Mercator/Shader.h>
 #include <Mercator/FillShader.h>
@@ -124,6 +125,11 @@ void TerrainShaderParser::createShaders(const Atlas::Message::Element& terrain)
 
 	if (!isValid) {
 		createDefaultShaders();
+		//The default shaders are always the same, so any constant will do.
+		mTerrainHandler.getPageCache().setSurfaceDefinitions(1);
+	} else {
+		//The parameters of the shaders can't be read back from them, so identify them through their definitions instead.
+		mTerrainHandler.getPageCache().setSurfaceDefinitions(TerrainPageCache::hashElement(terrain.Map().find("surfaces")->second));
 	}
 }
 
@@ -21,6 +21,7 @@
 #include "TerrainPageGeometry.h"
 #include "TerrainPageSurface.h"
 #include "TerrainMaterialCompilationTask.h"
+#include "BlendMapCache.h"
 #include "framework/tasks/TaskExecutionContext.h"
 
 #include <wfmath/intersect.h>
@@ -34,13 +35,13 @@ namespace Terrain
 {
 
 TerrainShaderUpdateTask::TerrainShaderUpdateTask(const GeometryPtrVector& geometry, const TerrainShader* shader, const AreaStore& areas, sigc::signal<void, const TerrainShader*, const AreaStore&>& signal, sigc::signal<void, TerrainPage*>& signalMaterialRecompiled, const WFMath::Vector<3>& lightDirection) :
-	mGeometry(geometry), mAreas(areas), mSignal(signal), mSignalMaterialRecompiled(signalMaterialRecompiled), mLightDirection(lightDirection)
+	mGeometry(geometry), mAreas(areas), mSignal(signal), mSignalMaterialRecompiled(signalMaterialRecompiled), mLightDirection(lightDirection), mRepopulate(true)
 {
 	mShaders.push_back(shader);
 }
 
-TerrainShaderUpdateTask::TerrainShaderUpdateTask(const GeometryPtrVector& geometry, const std::vector<const TerrainShader*>& shaders, const AreaStore& areas, sigc::signal<void, const TerrainShader*, const AreaStore&>& signal, sigc::signal<void, TerrainPage*>& signalMaterialRecompiled, const WFMath::Vector<3>& lightDirection) :
-	mGeometry(geometry), mShaders(shaders), mAreas(areas), mSignal(signal), mSignalMaterialRecompiled(signalMaterialRecompiled), mLightDirection(lightDirection)
+TerrainShaderUpdateTask::TerrainShaderUpdateTask(const GeometryPtrVector& geometry, const std::vector<const TerrainShader*>& shaders, const AreaStore& areas, sigc::signal<void, const TerrainShader*, const AreaStore&>& signal, sigc::signal<void, TerrainPage*>& signalMaterialRecompiled, const WFMath::Vector<3>& lightDirection, bool repopulate) :
+	mGeometry(geometry), mShaders(shaders), mAreas(areas), mSignal(signal), mSignalMaterialRecompiled(signalMaterialRecompiled), mLightDirection(lightDirection), mRepopulate(repopulate)
 {
 }
 
@@ -62,9 +63,17 @@ void TerrainShaderUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecution
 			}
 		}
 		if (shouldUpdate) {
+			//Only the parts of the blend maps affected by the changes need to be composed anew.
+			//If restored from the page cache the blend maps are already up to date.
+			if (mRepopulate) {
+				BlendMapCache* blendMapCache = page.getSurface()->getBlendMapCache();
+				for (auto& area : mAreas) {
+					blendMapCache->markDirty(area);
+				}
+			}
 			for (std::vector<const TerrainShader*>::const_iterator I = mShaders.begin(); I != mShaders.end(); ++I) {
 				//repopulate the layer
-				page.updateShaderTexture(*I, *geometry, true);
+				page.updateShaderTexture(*I, *geometry, mRepopulate);
 			}
 			updatedPages.push_back(geometry);
 		}
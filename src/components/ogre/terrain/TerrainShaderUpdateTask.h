@@ -73,8 +73,9 @@ public:
 	 * @param signal A signal which will be emitted in the main thread once all surfaces have been updated.
 	 * @param signalMaterialRecompiled A signal which will be passed on and emitted once a material for a terrain page has been recompiled.
 	 * @param lightDirection The main light direction.
+	 * @param repopulate If false the surfaces are assumed to already be populated, as when restored from the page cache, and only the layers are set up.
 	 */
-	TerrainShaderUpdateTask(const GeometryPtrVector& geometry, const std::vector<const TerrainShader*>& shaders, const AreaStore& areas, sigc::signal<void, const TerrainShader*, const AreaStore&>& signal, sigc::signal<void, TerrainPage*>& signalMaterialRecompiled, const WFMath::Vector<3>& lightDirection);
+	TerrainShaderUpdateTask(const GeometryPtrVector& geometry, const std::vector<const TerrainShader*>& shaders, const AreaStore& areas, sigc::signal<void, const TerrainShader*, const AreaStore&>& signal, sigc::signal<void, TerrainPage*>& signalMaterialRecompiled, const WFMath::Vector<3>& lightDirection, bool repopulate = true);
 
 	virtual ~TerrainShaderUpdateTask();
 
@@ -114,6 +115,11 @@ private:
 	 */
 	const WFMath::Vector<3> mLightDirection;
 
+	/**
+	 * @brief Whether the surfaces should be populated.
+	 */
+	const bool mRepopulate;
+
 };
 
 }
@@ -0,0 +1,277 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "TerrainTaskScheduler.h"
+
+#include "framework/tasks/ITask.h"
+#include "framework/tasks/TaskQueue.h"
+#include "framework/LoggingInstance.h"
+
+#include <wfmath/intersect.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace Ember
+{
+namespace OgreView
+{
+namespace Terrain
+{
+
+/**
+ * @brief Wraps a task dispatched by the scheduler, notifying the scheduler once it has been completely executed.
+ *
+ * The task is only considered completed when it's deleted, which happens in the main thread after it has been executed there.
+ * If the background part fails the task is instead deleted in the executor thread, in which case the scheduler is notified from there.
+ * Tasks depending on it will thus not be dispatched before both its background and main thread parts are done.
+ */
+class ScheduledTask: public Tasks::ITask
+{
+public:
+	ScheduledTask(TerrainTaskScheduler& scheduler, std::uint64_t id, Tasks::ITask* task) :
+			mScheduler(scheduler), mId(id), mTask(task), mNotifyScheduler(true)
+	{
+	}
+
+	virtual ~ScheduledTask()
+	{
+		delete mTask;
+		if (mNotifyScheduler) {
+			mScheduler.taskCompleted(mId);
+		}
+	}
+
+	virtual void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context)
+	{
+		mTask->executeTaskInBackgroundThread(context);
+	}
+
+	virtual bool executeTaskInMainThread()
+	{
+		return mTask->executeTaskInMainThread();
+	}
+
+	virtual std::string getName() const
+	{
+		return mTask->getName();
+	}
+
+	virtual int getPriority() const
+	{
+		return mTask->getPriority();
+	}
+
+	/**
+	 * @brief Makes sure that the scheduler isn't notified when this instance is deleted, for when the task never was dispatched.
+	 */
+	void cancel()
+	{
+		mNotifyScheduler = false;
+	}
+
+private:
+	TerrainTaskScheduler& mScheduler;
+	const std::uint64_t mId;
+	Tasks::ITask* mTask;
+	bool mNotifyScheduler;
+};
+
+TerrainTaskScheduler::TerrainTaskScheduler(Tasks::TaskQueue& taskQueue) :
+		mTaskQueue(taskQueue), mIsExclusiveRunning(false), mIsActive(true), mNextId(0)
+{
+}
+
+TerrainTaskScheduler::~TerrainTaskScheduler()
+{
+	deactivate();
+}
+
+bool TerrainTaskScheduler::enqueueTask(Tasks::ITask* task, const std::vector<WFMath::AxisBox<2>>& areas)
+{
+	return enqueue(task, areas, false);
+}
+
+bool TerrainTaskScheduler::enqueueTask(Tasks::ITask* task, const WFMath::AxisBox<2>& area)
+{
+	return enqueue(task, std::vector<WFMath::AxisBox<2>> { area }, false);
+}
+
+bool TerrainTaskScheduler::enqueueExclusiveTask(Tasks::ITask* task)
+{
+	return enqueue(task, std::vector<WFMath::AxisBox<2>>(), true);
+}
+
+bool TerrainTaskScheduler::enqueue(Tasks::ITask* task, std::vector<WFMath::AxisBox<2>> areas, bool exclusive)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!mIsActive || !mTaskQueue.isActive()) {
+		S_LOG_WARNING("Tried to enqueue the task " << task->getName() << " on a terrain task scheduler which isn't active (i.e. is shutting down).");
+		delete task;
+		return false;
+	}
+	std::uint64_t id = mNextId++;
+	mWaiting.push_back(Entry { id, task, std::move(areas), exclusive, false, std::chrono::steady_clock::now() });
+	dispatchWaitingTasks(lock);
+	if (!mWaiting.empty() && mWaiting.back().id == id) {
+		mWaiting.back().delayed = true;
+	}
+	return true;
+}
+
+void TerrainTaskScheduler::deactivate()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (!mIsActive) {
+			return;
+		}
+		mIsActive = false;
+		//Tasks only complete once they've been executed in the main thread, so we need to do that here while waiting.
+		//All waiting tasks will eventually be dispatched, as the tasks they wait for complete.
+		while (!mWaiting.empty() || !mRunning.empty()) {
+			lock.unlock();
+			mTaskQueue.pollProcessedTasks();
+			lock.lock();
+			mCompletedCondition.wait_for(lock, std::chrono::milliseconds(1), [&] {return mWaiting.empty() && mRunning.empty();});
+		}
+	}
+	mTaskQueue.deactivate();
+}
+
+bool TerrainTaskScheduler::isActive() const
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mIsActive;
+}
+
+size_t TerrainTaskScheduler::getNumberOfWaitingTasks() const
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mWaiting.size();
+}
+
+size_t TerrainTaskScheduler::getNumberOfRunningTasks() const
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mRunning.size();
+}
+
+std::map<std::string, TerrainTaskScheduler::DependencyStatistics> TerrainTaskScheduler::getDependencyStatistics() const
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mDependencyStatistics;
+}
+
+bool TerrainTaskScheduler::overlaps(const std::vector<WFMath::AxisBox<2>>& lhs, const std::vector<WFMath::AxisBox<2>>& rhs)
+{
+	for (auto& lhsArea : lhs) {
+		for (auto& rhsArea : rhs) {
+			//Areas which only share an edge, such as two adjacent pages, don't overlap.
+			if (WFMath::Intersect(lhsArea, rhsArea, true)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TerrainTaskScheduler::dispatchWaitingTasks(const std::unique_lock<std::mutex>& lock)
+{
+	//This might be called from an executor thread, if a task failed, so all state must be accessed with the lock held.
+	assert(lock.owns_lock() && lock.mutex() == &mMutex);
+	//Areas of tasks which are waiting before the one being looked at; any later task touching these must keep on waiting, to preserve the order.
+	std::vector<WFMath::AxisBox<2>> blockedAreas;
+	auto I = mWaiting.begin();
+	while (I != mWaiting.end() && !mIsExclusiveRunning) {
+		Entry& entry = *I;
+		bool canDispatch;
+		if (entry.exclusive) {
+			canDispatch = I == mWaiting.begin() && mRunning.empty();
+			if (!canDispatch) {
+				//Nothing can pass an exclusive task.
+				break;
+			}
+		} else {
+			canDispatch = !overlaps(entry.areas, blockedAreas);
+			if (canDispatch) {
+				for (auto& running : mRunning) {
+					if (overlaps(entry.areas, running.second.areas)) {
+						canDispatch = false;
+						break;
+					}
+				}
+			}
+		}
+
+		if (!canDispatch) {
+			blockedAreas.insert(blockedAreas.end(), entry.areas.begin(), entry.areas.end());
+			++I;
+			continue;
+		}
+
+		auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - entry.enqueued).count();
+		DependencyStatistics& statistics = mDependencyStatistics[entry.task->getName()];
+		statistics.count++;
+		if (entry.delayed) {
+			statistics.delayed++;
+		}
+		statistics.totalWait += wait;
+		statistics.maxWait = std::max<long long>(statistics.maxWait, wait);
+
+		std::uint64_t id = entry.id;
+		bool exclusive = entry.exclusive;
+		ScheduledTask* scheduledTask = new ScheduledTask(*this, id, entry.task);
+		mRunning.insert(std::make_pair(id, std::move(entry)));
+		I = mWaiting.erase(I);
+		if (exclusive) {
+			mIsExclusiveRunning = true;
+		}
+		if (!mTaskQueue.enqueueTask(scheduledTask)) {
+			//The queue has been shut down behind our back; the task will never be run.
+			mRunning.erase(id);
+			if (exclusive) {
+				mIsExclusiveRunning = false;
+			}
+			scheduledTask->cancel();
+			delete scheduledTask;
+		}
+	}
+}
+
+void TerrainTaskScheduler::taskCompleted(std::uint64_t id)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	auto I = mRunning.find(id);
+	if (I != mRunning.end()) {
+		if (I->second.exclusive) {
+			mIsExclusiveRunning = false;
+		}
+		mRunning.erase(I);
+	}
+	dispatchWaitingTasks(lock);
+	mCompletedCondition.notify_all();
+}
+
+}
+}
+}
@@ -0,0 +1,243 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_TERRAINTASKSCHEDULER_H_
+#define EMBEROGRE_TERRAIN_TERRAINTASKSCHEDULER_H_
+
+#include <wfmath/axisbox.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Ember
+{
+namespace Tasks
+{
+class ITask;
+class TaskQueue;
+}
+namespace OgreView
+{
+namespace Terrain
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Schedules terrain tasks on a task queue with multiple executors, making sure that tasks which depend on each other aren't run at the same time.
+ *
+ * When the terrain only had one executor all tasks were run in the order they were enqueued, which implicitly took care of all dependencies between them.
+ * With multiple executors we instead need to express these dependencies. This is done in two ways:
+ * - Tasks which only work on some part of the terrain (such as updating the geometry or shaders of a page) declare the world areas they touch.
+ *   Such a task is dispatched to the queue as soon as no earlier task touching any of the same areas is either running or waiting.
+ * - Tasks which alter the Mercator terrain itself (such as changing base points, mods or areas) are exclusive.
+ *   An exclusive task is only dispatched when all earlier tasks are done, and no later task is dispatched until it's done.
+ *
+ * Tasks are otherwise dispatched in the order they were enqueued. A task only counts as done once it has been executed both in the background and in the main thread.
+ * A task depending on another will thus never have either of its parts run before the other task is fully done.
+ *
+ * Tasks are enqueued from the main thread, and waiting tasks are normally dispatched there too, as running tasks complete.
+ * A task whose background part fails is however deleted in the executor thread which ran it, so its completion, and the dispatching
+ * of any tasks waiting for it, then happens in that thread. All state is therefore guarded by a mutex.
+ */
+class TerrainTaskScheduler
+{
+public:
+
+	/**
+	 * @brief Statistics for how long tasks with the same name have waited for other tasks before being dispatched.
+	 * All times are in microseconds.
+	 */
+	struct DependencyStatistics
+	{
+		/**
+		 * @brief The number of dispatched tasks.
+		 */
+		size_t count = 0;
+
+		/**
+		 * @brief The number of tasks which weren't dispatched right away, because they had to wait for other tasks.
+		 */
+		size_t delayed = 0;
+
+		/**
+		 * @brief The total time tasks waited for other tasks.
+		 */
+		long long totalWait = 0;
+
+		/**
+		 * @brief The longest time a task waited for other tasks.
+		 */
+		long long maxWait = 0;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param taskQueue The queue to which tasks are dispatched.
+	 */
+	explicit TerrainTaskScheduler(Tasks::TaskQueue& taskQueue);
+
+	/**
+	 * @brief Dtor.
+	 * Any tasks still waiting will be processed first, as with deactivate().
+	 */
+	~TerrainTaskScheduler();
+
+	/**
+	 * @brief Enqueues a task which works on a part of the terrain.
+	 * @param task The task. Ownership is transferred.
+	 * @param areas The world areas the task reads or writes. If empty the task only depends on exclusive tasks.
+	 * @return False if the task couldn't be enqueued, in which case it has been deleted.
+	 */
+	bool enqueueTask(Tasks::ITask* task, const std::vector<WFMath::AxisBox<2>>& areas);
+
+	/**
+	 * @brief Enqueues a task which works on a single area of the terrain.
+	 * @param task The task. Ownership is transferred.
+	 * @param area The world area the task reads or writes.
+	 * @return False if the task couldn't be enqueued, in which case it has been deleted.
+	 */
+	bool enqueueTask(Tasks::ITask* task, const WFMath::AxisBox<2>& area);
+
+	/**
+	 * @brief Enqueues a task which must be run on its own, since it alters state shared by all other tasks.
+	 * @param task The task. Ownership is transferred.
+	 * @return False if the task couldn't be enqueued, in which case it has been deleted.
+	 */
+	bool enqueueExclusiveTask(Tasks::ITask* task);
+
+	/**
+	 * @brief Waits for all enqueued tasks to be dispatched and run, and then deactivates the task queue.
+	 * Since tasks need to be run in the main thread to complete, the processed tasks of the queue are polled while waiting.
+	 * No tasks can be enqueued after this has been called.
+	 * @note This must be called from the main thread.
+	 */
+	void deactivate();
+
+	/**
+	 * @brief Returns true if tasks can be enqueued.
+	 * @return True if the scheduler is active.
+	 */
+	bool isActive() const;
+
+	/**
+	 * @brief Gets the number of tasks which are waiting for other tasks.
+	 * @return The number of waiting tasks.
+	 */
+	size_t getNumberOfWaitingTasks() const;
+
+	/**
+	 * @brief Gets the number of tasks which have been dispatched, but not yet completely executed.
+	 * @return The number of running tasks.
+	 */
+	size_t getNumberOfRunningTasks() const;
+
+	/**
+	 * @brief Gets the dependency statistics, per task name.
+	 * @return The statistics, keyed by task name.
+	 */
+	std::map<std::string, DependencyStatistics> getDependencyStatistics() const;
+
+private:
+	friend class ScheduledTask;
+
+	/**
+	 * @brief A task which has been enqueued, either waiting or running.
+	 */
+	struct Entry
+	{
+		std::uint64_t id;
+		Tasks::ITask* task;
+		std::vector<WFMath::AxisBox<2>> areas;
+		bool exclusive;
+
+		/**
+		 * @brief True if the task couldn't be dispatched right away when enqueued.
+		 */
+		bool delayed;
+		std::chrono::steady_clock::time_point enqueued;
+	};
+
+	Tasks::TaskQueue& mTaskQueue;
+
+	/**
+	 * @brief Tasks waiting to be dispatched, in the order they were enqueued.
+	 */
+	std::list<Entry> mWaiting;
+
+	/**
+	 * @brief Tasks which have been dispatched but not yet completed, keyed by id. The task pointer is owned by the queue once dispatched.
+	 */
+	std::map<std::uint64_t, Entry> mRunning;
+
+	/**
+	 * @brief Whether an exclusive task is currently running.
+	 */
+	bool mIsExclusiveRunning;
+
+	bool mIsActive;
+
+	std::uint64_t mNextId;
+
+	std::map<std::string, DependencyStatistics> mDependencyStatistics;
+
+	/**
+	 * @brief Guards all state, since tasks which fail in the background are completed in the executor threads.
+	 */
+	mutable std::mutex mMutex;
+
+	/**
+	 * @brief Signalled whenever a task completes, used when deactivating.
+	 */
+	std::condition_variable mCompletedCondition;
+
+	/**
+	 * @brief Adds a task to the waiting list, and dispatches it if possible.
+	 */
+	bool enqueue(Tasks::ITask* task, std::vector<WFMath::AxisBox<2>> areas, bool exclusive);
+
+	/**
+	 * @brief Dispatches all waiting tasks which don't depend on any running or earlier waiting task.
+	 * This can be called from any thread, as long as mMutex is held.
+	 * @param lock A lock on mMutex.
+	 */
+	void dispatchWaitingTasks(const std::unique_lock<std::mutex>& lock);
+
+	/**
+	 * @brief Called when a dispatched task has been completely executed and is deleted.
+	 * This normally happens in the main thread, but happens in an executor thread if the background part of the task failed.
+	 * @param id The id of the task.
+	 */
+	void taskCompleted(std::uint64_t id);
+
+	/**
+	 * @brief Checks whether any of the areas overlap.
+	 */
+	static bool overlaps(const std::vector<WFMath::AxisBox<2>>& lhs, const std::vector<WFMath::AxisBox<2>>& rhs);
+};
+
+}
+}
+}
+
+#endif /* EMBEROGRE_TERRAIN_TERRAINTASKSCHEDULER_H_ */
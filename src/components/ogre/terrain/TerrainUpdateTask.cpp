@@ -23,6 +23,7 @@
 #include "SegmentManager.h"
 #include <Mercator/Terrain.h>
 #include <OgreAxisAlignedBox.h>
+#include <wfmath/axisbox.h>
 
 namespace Ember
 {
@@ -63,6 +64,8 @@ void TerrainUpdateTask::executeTaskInBackgroundThread(Tasks::TaskExecutionContex
 		mTerrain.setBasePoint(static_cast<int> (pos.x()), static_cast<int> (pos.y()), bp);
 		mUpdatedBasePoints.push_back(UpdateBasePointStore::value_type(pos, bp));
 		mUpdatedPositions.push_back(TerrainPosition(pos.x() * terrainRes, pos.y() * terrainRes));
+		//All segments with the base point as a corner are affected.
+		mSegmentManager.discardSpilledSegments(WFMath::AxisBox<2>(mUpdatedPositions.back(), mUpdatedPositions.back()));
 	}
 	mSegmentManager.syncWithTerrain();
 }
@@ -49,7 +49,7 @@ void XMLLayerDefinitionSerializer::parseScript(Ogre::DataStreamPtr& stream, cons
 {
 	TiXmlDocument xmlDoc;
 	XMLHelper xmlHelper;
-	if (!xmlHelper.Load(xmlDoc, stream)) {
+	if (!xmlHelper.Load(xmlDoc, stream, groupName)) {
 		return;
 	}
 
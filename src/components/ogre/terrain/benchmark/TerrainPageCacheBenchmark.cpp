@@ -0,0 +1,326 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares generating terrain pages from scratch, as on a cold start, with restoring them from the page cache, as on a warm start.
+// A deterministic world with base points, shaders and areas is built, and for each page the heights, normals and surfaces of its
+// segments are populated, its blend map composed and its shadow baked. The pages are then stored in the cache. A second, identical
+// world is then built, and the pages restored from the cache into it. The restored data is checked against the generated data.
+//
+// The cache directory can be supplied as the first argument, in which case it's kept afterwards. The number of pages per axis can
+// be supplied as the second argument.
+
+#include "../TerrainPageCache.h"
+#include "../TerrainShader.h"
+#include "../TerrainLayerDefinition.h"
+#include "../BlendMapCompositor.h"
+
+#include <Mercator/Area.h>
+#include <Mercator/AreaShader.h>
+#include <Mercator/BasePoint.h>
+#include <Mercator/FillShader.h>
+#include <Mercator/GrassShader.h>
+#include <Mercator/Segment.h>
+#include <Mercator/Surface.h>
+#include <Mercator/Terrain.h>
+#include <Mercator/ThresholdShader.h>
+
+#include <wfmath/polygon.h>
+#include <wfmath/randgen.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Ember::OgreView::Terrain;
+
+namespace
+{
+const int SegmentsPerPage = 4;
+const int AreaLayer = 7;
+
+/**
+ * @brief A Mercator terrain set up the same way every time.
+ */
+struct World
+{
+	std::vector<std::unique_ptr<TerrainLayerDefinition>> definitions;
+	std::vector<std::unique_ptr<TerrainShader>> shaders;
+	std::vector<const TerrainShader*> shaderList;
+
+	//Declared last so that it's destroyed before the shaders its surfaces refer to.
+	Mercator::Terrain terrain;
+
+	explicit World(int pagesPerAxis) :
+			terrain(Mercator::Terrain::SHADED)
+	{
+		int points = pagesPerAxis * SegmentsPerPage;
+		WFMath::MTRand rand;
+		for (int y = 0; y <= points; ++y) {
+			for (int x = 0; x <= points; ++x) {
+				rand.seed(x + (y * 10000));
+				terrain.setBasePoint(x, y, Mercator::BasePoint(rand.rand<float>() * 40.0f - 10.0f, 1.5f, 0.9f));
+			}
+		}
+
+		addShader("rock", 0, new Mercator::FillShader());
+		addShader("sand", 0, new Mercator::BandShader(-2.f, 1.5f));
+		addShader("grass", 0, new Mercator::GrassShader(1.f, 80.f, .5f, 1.f));
+		addShader("road", AreaLayer, new Mercator::AreaShader(AreaLayer));
+
+		//A few roads crossing the world.
+		float size = pagesPerAxis * SegmentsPerPage * 64.0f;
+		for (int i = 0; i < pagesPerAxis; ++i) {
+			float y = (i + 0.5f) * size / pagesPerAxis;
+			WFMath::Polygon<2> shape;
+			shape.addCorner(0, WFMath::Point<2>(0, y - 4));
+			shape.addCorner(1, WFMath::Point<2>(size, y + 20));
+			shape.addCorner(2, WFMath::Point<2>(size, y + 28));
+			shape.addCorner(3, WFMath::Point<2>(0, y + 4));
+			Mercator::Area* area = new Mercator::Area(AreaLayer, false);
+			area->setShape(shape);
+			terrain.addArea(area);
+		}
+	}
+
+	void addShader(const std::string& name, unsigned int areaId, Mercator::Shader* shader)
+	{
+		TerrainLayerDefinition* definition = new TerrainLayerDefinition();
+		definition->setShaderName(name);
+		definition->setAreaId(areaId);
+		definitions.emplace_back(definition);
+		TerrainShader* terrainShader = new TerrainShader(terrain, static_cast<int>(shaders.size()), *definition, shader);
+		shaders.emplace_back(terrainShader);
+		shaderList.push_back(terrainShader);
+	}
+
+	SegmentVector getSegments(int pageX, int pageY)
+	{
+		SegmentVector segments;
+		float resolution = terrain.getResolution();
+		for (int y = 0; y < SegmentsPerPage; ++y) {
+			for (int x = 0; x < SegmentsPerPage; ++x) {
+				PageSegment pageSegment;
+				pageSegment.index = TerrainPosition(x, y);
+				pageSegment.segment = terrain.getSegmentAtPos(((pageX * SegmentsPerPage) + x + 0.5f) * resolution, ((pageY * SegmentsPerPage) + y + 0.5f) * resolution);
+				if (pageSegment.segment) {
+					segments.push_back(pageSegment);
+				}
+			}
+		}
+		return segments;
+	}
+
+	WFMath::AxisBox<2> getExtent(int pageX, int pageY) const
+	{
+		float pageSize = SegmentsPerPage * terrain.getResolution();
+		return WFMath::AxisBox<2>(WFMath::Point<2>(pageX * pageSize, pageY * pageSize), WFMath::Point<2>((pageX + 1) * pageSize, (pageY + 1) * pageSize));
+	}
+};
+
+/**
+ * @brief Generates everything for a page, the same way the terrain tasks do.
+ */
+void generatePage(World& world, const SegmentVector& segments, TerrainPageCache::PageData& data)
+{
+	for (auto& pageSegment : segments) {
+		Mercator::Segment& segment = *pageSegment.segment;
+		segment.populate();
+		segment.populateNormals();
+		auto& surfaces = segment.getSurfaces();
+		for (auto shader : world.shaderList) {
+			if (surfaces.find(shader->getTerrainIndex()) == surfaces.end() && shader->getShader().checkIntersect(segment)) {
+				surfaces[shader->getTerrainIndex()] = shader->getShader().newSurface(segment);
+			}
+		}
+		segment.populateSurfaces();
+	}
+
+	unsigned int resolution = static_cast<unsigned int>(world.terrain.getResolution());
+	unsigned int width = resolution * SegmentsPerPage;
+
+	//One combined blend map with all four layers.
+	std::shared_ptr<BlendMapCache::BlendMap> blendMap(new BlendMapCache::BlendMap());
+	blendMap->width = width;
+	for (size_t level = 0; level < BlendMapCompositor::getLevelCount(width); ++level) {
+		unsigned int levelWidth = BlendMapCompositor::getLevelWidth(width, level);
+		blendMap->levels.emplace_back(static_cast<size_t>(levelWidth) * levelWidth * 4, 0);
+	}
+	for (auto& pageSegment : segments) {
+		const unsigned char* coverage[4] = { nullptr, nullptr, nullptr, nullptr };
+		for (size_t i = 0; i < world.shaderList.size() && i < 4; ++i) {
+			auto I = pageSegment.segment->getSurfaces().find(world.shaderList[i]->getTerrainIndex());
+			if (I != pageSegment.segment->getSurfaces().end() && I->second->isValid()) {
+				coverage[i] = I->second->getData();
+			}
+		}
+		unsigned int x = static_cast<unsigned int>(pageSegment.index.x());
+		unsigned int y = static_cast<unsigned int>(pageSegment.index.y());
+		BlendMapCompositor::composeSegment(coverage, 4, 0, resolution, blendMap->levels[0].data(), 4, width, x * resolution, (SegmentsPerPage - y - 1) * resolution);
+	}
+	for (size_t level = 1; level < blendMap->levels.size(); ++level) {
+		unsigned int levelWidth = BlendMapCompositor::getLevelWidth(width, level);
+		BlendMapCompositor::generateMipmap(blendMap->levels[level - 1].data(), BlendMapCompositor::getLevelWidth(width, level - 1), blendMap->levels[level].data(), 4, 0, 0,
+				levelWidth, levelWidth);
+	}
+	data.blendMaps.push_back(BlendMapCache::StoredBlendMap { "blendmap", { 0, 1, 2, 3 }, blendMap });
+
+	//A lambert shadow, baked from quantized normals just as TerrainHandler stores it.
+	WFMath::Vector<3> lightDirection(0.3f, 0.4f, -0.866f);
+	data.shadowWidth = width;
+	data.shadowLightDirection = lightDirection;
+	data.shadow.assign(static_cast<size_t>(width) * width, 0);
+	data.normals.assign(static_cast<size_t>(width) * width * 3, 0);
+	for (auto& pageSegment : segments) {
+		const float* normals = pageSegment.segment->getNormals();
+		int segmentSize = pageSegment.segment->getSize();
+		int xOffset = static_cast<int>(pageSegment.index.x()) * resolution;
+		int yOffset = (SegmentsPerPage - static_cast<int>(pageSegment.index.y()) - 1) * resolution;
+		for (unsigned int y = 0; y < resolution; ++y) {
+			for (unsigned int x = 0; x < resolution; ++x) {
+				//Rows are stored from the top down, like the shadow images.
+				const float* normal = normals + ((((resolution - 1 - y) * segmentSize) + x) * 3);
+				float magnitude = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				size_t index = (static_cast<size_t>(yOffset + y) * width) + xOffset + x;
+				if (magnitude > 0) {
+					float dotProduct = (normal[0] * lightDirection.x() + normal[1] * lightDirection.y() + normal[2] * lightDirection.z()) / magnitude;
+					data.shadow[index] = static_cast<unsigned char>((1.0f - ((dotProduct + 1.0f) * 0.5f)) * 255.0f);
+					for (int i = 0; i < 3; ++i) {
+						data.normals[index * 3 + i] = static_cast<int8_t>(std::round(normal[i] / magnitude * 127.0f));
+					}
+				}
+			}
+		}
+	}
+
+	TerrainPageCache::collectSegments(segments, data);
+}
+
+/**
+ * @brief Checks that the segments of a page are the same in two worlds.
+ */
+bool compareSegments(const SegmentVector& expected, const SegmentVector& actual)
+{
+	if (expected.size() != actual.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < expected.size(); ++i) {
+		Mercator::Segment& lhs = *expected[i].segment;
+		Mercator::Segment& rhs = *actual[i].segment;
+		size_t size = static_cast<size_t>(lhs.getSize()) * lhs.getSize();
+		if (!rhs.isValid() || std::memcmp(lhs.getPoints(), rhs.getPoints(), size * sizeof(float)) != 0 || lhs.getMax() != rhs.getMax() || lhs.getMin() != rhs.getMin()) {
+			return false;
+		}
+		for (auto& entry : lhs.getSurfaces()) {
+			auto I = rhs.getSurfaces().find(entry.first);
+			if (I == rhs.getSurfaces().end() || !I->second->isValid()
+					|| std::memcmp(entry.second->getData(), I->second->getData(), size * entry.second->getChannels()) != 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+double millisecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+}
+}
+
+int main(int argc, char** argv)
+{
+	bool keepDirectory = argc > 1;
+	std::string directory = keepDirectory ? argv[1] : (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-pagecache-%%%%-%%%%")).string();
+	int pagesPerAxis = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+	int pageCount = pagesPerAxis * pagesPerAxis;
+
+	World coldWorld(pagesPerAxis);
+	TerrainPageCache coldCache;
+	coldCache.setDirectory(directory, 1024 * 1024 * 1024);
+
+	double generateTime = 0, saveTime = 0;
+	std::vector<TerrainPageCache::Key> keys;
+	for (int y = 0; y < pagesPerAxis; ++y) {
+		for (int x = 0; x < pagesPerAxis; ++x) {
+			SegmentVector segments = coldWorld.getSegments(x, y);
+			TerrainPageCache::Key key = coldCache.createKey(TerrainIndex(x, y), coldWorld.getExtent(x, y), SegmentsPerPage * 64, segments, coldWorld.shaderList);
+			keys.push_back(key);
+
+			TerrainPageCache::PageData data;
+			auto start = std::chrono::steady_clock::now();
+			generatePage(coldWorld, segments, data);
+			generateTime += millisecondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			coldCache.save(key, data);
+			saveTime += millisecondsSince(start);
+		}
+	}
+	TerrainPageCache::Statistics coldStatistics = coldCache.getStatistics();
+
+	//A new session, with a new world and cache.
+	World warmWorld(pagesPerAxis);
+	TerrainPageCache warmCache;
+	warmCache.setDirectory(directory, 1024 * 1024 * 1024);
+
+	double restoreTime = 0;
+	size_t mismatches = 0;
+	for (int y = 0; y < pagesPerAxis; ++y) {
+		for (int x = 0; x < pagesPerAxis; ++x) {
+			SegmentVector segments = warmWorld.getSegments(x, y);
+			auto start = std::chrono::steady_clock::now();
+			TerrainPageCache::Key key = warmCache.createKey(TerrainIndex(x, y), warmWorld.getExtent(x, y), SegmentsPerPage * 64, segments, warmWorld.shaderList);
+			TerrainPageCache::PageData data;
+			bool isRestored = warmCache.load(key, data) && TerrainPageCache::restoreSegments(data, segments, warmWorld.shaderList);
+			restoreTime += millisecondsSince(start);
+
+			if (!isRestored || key != keys[(y * pagesPerAxis) + x] || !compareSegments(coldWorld.getSegments(x, y), segments)) {
+				mismatches++;
+			}
+		}
+	}
+	TerrainPageCache::Statistics warmStatistics = warmCache.getStatistics();
+
+	//Any change to the base points must give the pages touching them new keys.
+	warmWorld.terrain.setBasePoint(1, 1, Mercator::BasePoint(100.0f));
+	SegmentVector changedSegments = warmWorld.getSegments(0, 0);
+	bool isKeyChanged = warmCache.createKey(TerrainIndex(0, 0), warmWorld.getExtent(0, 0), SegmentsPerPage * 64, changedSegments, warmWorld.shaderList) != keys.front();
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "pages:              " << pageCount << " (" << SegmentsPerPage * SegmentsPerPage << " segments each)" << std::endl;
+	std::cout << "cold start:         " << generateTime / pageCount << " ms/page generating, " << saveTime / pageCount << " ms/page storing" << std::endl;
+	std::cout << "warm start:         " << restoreTime / pageCount << " ms/page restoring (" << warmStatistics.hits << " hits, " << warmStatistics.misses << " misses)" << std::endl;
+	std::cout << "speedup:            " << (restoreTime > 0 ? generateTime / restoreTime : 0) << "x" << std::endl;
+	std::cout << "disk use:           " << (coldStatistics.entries ? coldStatistics.diskUsed / coldStatistics.entries / 1024 : 0) << " kB/page" << std::endl;
+	std::cout << "restored correctly: " << (mismatches == 0 ? "yes" : "no") << ", keys follow base points: " << (isKeyChanged ? "yes" : "no") << std::endl;
+
+	if (!keepDirectory) {
+		boost::system::error_code ec;
+		boost::filesystem::remove_all(directory, ec);
+	}
+	return mismatches == 0 && isKeyChanged ? 0 : 1;
+}
@@ -6,6 +6,7 @@
  */
 
 #include "ClusterPopulator.h"
+#include "CoverageCache.h"
 #include "components/ogre/terrain/PlantAreaQueryResult.h"
 #include "components/ogre/terrain/PlantAreaQuery.h"
 #include "components/ogre/terrain/Segment.h"
@@ -19,6 +20,16 @@
 #include <Mercator/Segment.h>
 #include <Mercator/Surface.h>
 #include <Mercator/Shader.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace Ember
 {
 namespace OgreView
@@ -31,7 +42,7 @@ namespace Foliage
 {
 
 ClusterPopulator::ClusterPopulator(unsigned int layerIndex, IScaler* scaler, unsigned int plantIndex) :
-	PlantPopulator(layerIndex, scaler, plantIndex), mMinClusterRadius(1.0f), mMaxClusterRadius(1.0f), mClusterDistance(1.0f), mDensity(1.0f), mFalloff(1.0f), mThreshold(0)
+	PlantPopulator(layerIndex, scaler, plantIndex), mMinClusterRadius(1.0f), mMaxClusterRadius(1.0f), mClusterDistance(1.0f), mDensity(1.0f), mFalloff(1.0f), mThreshold(0), mCoverageCache(nullptr)
 {
 }
 
@@ -51,42 +62,104 @@ void ClusterPopulator::populate(PlantAreaQueryResult& result, SegmentRefPtr segm
 	const WFMath::AxisBox<2>& area = Convert::toWF(query.getArea());
 
 	//Make a small list of surfaces in order
-	std::list<int> indexSort;
+	std::vector<int> indexSort;
 	for (Mercator::Segment::Surfacestore::const_iterator I = mercatorSegment.getSurfaces().begin(); I != mercatorSegment.getSurfaces().end(); ++I) {
 		if (I->first >= mLayerIndex) {
 			if (I->second->m_shader.checkIntersect(mercatorSegment)) {
-				if (!I->second->isValid()) {
-					I->second->populate();
-				}
 				indexSort.push_back(I->first);
 			}
 		}
 	}
 
-	indexSort.sort();
+	std::sort(indexSort.begin(), indexSort.end());
 	//Check that there actually is a valid surface on which the plants can be placed
-	if (indexSort.size() > 0 && indexSort.front() == mLayerIndex) {
-		Buffer<unsigned char> combinedCoverage(mercatorSegment.getSize(), 1);
-		unsigned char* combinedCoverageData = combinedCoverage.getData();
-		size_t size = combinedCoverage.getSize();
-		//The first layer should be copied just as it is
-		std::list<int>::const_iterator I = indexSort.begin();
-		{
-			Mercator::Surface* surface = mercatorSegment.getSurfaces()[*I];
-			memcpy(combinedCoverageData, surface->getData(), combinedCoverage.getSize());
+	if (!indexSort.empty() && indexSort.front() == mLayerIndex) {
+		//Many plant types share the same layers, so the combined coverage is cached per segment and set of layers.
+		CoverageCache::Key key;
+		unsigned long generation = 0;
+		CoverageCache::CoveragePtr combinedCoverage;
+		if (mCoverageCache) {
+			key.xRef = mercatorSegment.getXRef();
+			key.yRef = mercatorSegment.getYRef();
+			key.resolution = mercatorSegment.getResolution();
+			key.layers = indexSort;
+			combinedCoverage = mCoverageCache->get(key, generation);
 		}
-		++I;
-		for (; I != indexSort.end(); ++I) {
-			Mercator::Surface* surface = mercatorSegment.getSurfaces()[*I];
-			unsigned char* surfaceData = surface->getData();
-			for (size_t i = 0; i < size; ++i) {
-				combinedCoverageData[i] -= std::min<unsigned char>(surfaceData[i], combinedCoverageData[i]);
+
+		if (!combinedCoverage) {
+			std::shared_ptr<Buffer<unsigned char>> coverage(new Buffer<unsigned char>(mercatorSegment.getSize(), 1));
+			unsigned char* combinedCoverageData = coverage->getData();
+			size_t size = coverage->getSize();
+			for (auto I = indexSort.begin(); I != indexSort.end(); ++I) {
+				Mercator::Surface* surface = mercatorSegment.getSurfaces()[*I];
+				if (!surface->isValid()) {
+					surface->populate();
+				}
+				if (I == indexSort.begin()) {
+					//The first layer should be copied just as it is
+					memcpy(combinedCoverageData, surface->getData(), size);
+				} else {
+					subtractCoverage(combinedCoverageData, surface->getData(), size);
+				}
+			}
+			combinedCoverage = coverage;
+			if (mCoverageCache) {
+				mCoverageCache->insert(key, combinedCoverage, generation);
 			}
 		}
 
 		ClusterStore store;
 		getClustersForArea(segmentRef, area, store);
-		populateWithClusters(segmentRef, result, area, store, combinedCoverage);
+		populateWithClusters(segmentRef, result, area, store, *combinedCoverage);
+	}
+}
+
+void ClusterPopulator::subtractCoverage(unsigned char* coverage, const unsigned char* layer, size_t size)
+{
+	size_t i = 0;
+	//Subtracting with unsigned saturation is the same as "coverage -= min(layer, coverage)", but 16 values at a time.
+#if defined(__SSE2__)
+	for (; i + 16 <= size; i += 16) {
+		__m128i coverageValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage + i));
+		__m128i layerValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layer + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(coverage + i), _mm_subs_epu8(coverageValues, layerValues));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 16 <= size; i += 16) {
+		vst1q_u8(coverage + i, vqsubq_u8(vld1q_u8(coverage + i), vld1q_u8(layer + i)));
+	}
+#endif
+	for (; i < size; ++i) {
+		coverage[i] -= std::min<unsigned char>(layer[i], coverage[i]);
+	}
+}
+
+void ClusterPopulator::getHeights(const float* points, unsigned int size, const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights)
+{
+	heights.resize(positions.size());
+	int maxTile = static_cast<int>(size) - 2;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		float x = positions[i].x();
+		float y = positions[i].y();
+
+		//Positions on the far edges are interpolated from the last tile.
+		int tileX = std::min(static_cast<int>(std::floor(x)), maxTile);
+		int tileY = std::min(static_cast<int>(std::floor(y)), maxTile);
+		float offX = x - tileX;
+		float offY = y - tileY;
+
+		const float* row = points + (tileY * size) + tileX;
+		float h1 = row[0];
+		float h2 = row[size];
+		float h3 = row[size + 1];
+		float h4 = row[1];
+
+		//The square is broken into two triangles, in the same way as Mercator::Segment::getHeightAndNormal() does.
+		if ((offX - offY) <= 0.f) {
+			heights[i] = h1 + (h3 - h2) * offX + (h2 - h1) * offY;
+		} else {
+			heights[i] = h1 + (h4 - h1) * offX + (h3 - h4) * offY;
+		}
 	}
 }
 
@@ -140,8 +213,12 @@ void ClusterPopulator::populateWithCluster(const SegmentRefPtr& segmentRef, Plan
 	unsigned int res = combinedCoverage.getResolution();
 	const unsigned char* data = combinedCoverage.getData();
 
-	float height = 0;
-	WFMath::Vector<3> normal;
+	//Heights are looked up for all instances in the cluster at once, after it's been determined which should be placed.
+	std::vector<WFMath::Point<2>> localPositions;
+	std::vector<PlantInstance> instances;
+	localPositions.reserve(instancesInEachCluster);
+	instances.reserve(instancesInEachCluster);
+
 	//place one cluster
 	for (unsigned int j = 0; j < instancesInEachCluster; ++j) {
 		float theta = rng.rand(WFMath::numeric_constants<WFMath::CoordType>::pi() * 2);
@@ -156,11 +233,20 @@ void ClusterPopulator::populateWithCluster(const SegmentRefPtr& segmentRef, Plan
 		if (WFMath::Contains(area, pos, true)) {
 			WFMath::Point<2> localPos(pos.x() - mercatorSegment.getXRef(), pos.y() - mercatorSegment.getYRef());
 			if (data[((unsigned int)localPos.y() * res) + ((unsigned int)localPos.x())] >= mThreshold) {
-				mercatorSegment.getHeightAndNormal(localPos.x(), localPos.y(), height, normal);
-				plants.push_back(PlantInstance(Ogre::Vector3(pos.x(), height, -pos.y()), rotation, scale));
+				localPositions.push_back(localPos);
+				instances.push_back(PlantInstance(Ogre::Vector3(pos.x(), 0, -pos.y()), rotation, scale));
 			}
 		}
 	}
+
+	if (!instances.empty()) {
+		std::vector<float> heights;
+		getHeights(mercatorSegment.getPoints(), mercatorSegment.getSize(), localPositions, heights);
+		for (size_t i = 0; i < instances.size(); ++i) {
+			instances[i].position.y = heights[i];
+			plants.push_back(instances[i]);
+		}
+	}
 }
 
 float ClusterPopulator::getMinClusterRadius() const
@@ -223,6 +309,11 @@ float ClusterPopulator::getTreshold() const
 	return mThreshold;
 }
 
+void ClusterPopulator::setCoverageCache(CoverageCache* coverageCache)
+{
+	mCoverageCache = coverageCache;
+}
+
 }
 
 }
@@ -10,6 +10,8 @@
 
 #include "PlantPopulator.h"
 
+#include <vector>
+
 namespace WFMath
 {
 	template<int> class Ball;
@@ -28,6 +30,8 @@ template <typename> class Buffer;
 namespace Foliage
 {
 
+class CoverageCache;
+
 typedef std::vector<WFMath::Ball<2>> ClusterStore;
 
 class ClusterPopulator : public PlantPopulator
@@ -55,6 +59,33 @@ public:
 
 	void setThreshold(unsigned char theValue);
 	float getTreshold() const;
+
+	/**
+	 * @brief Sets a cache to use for combined coverages.
+	 * @param coverageCache A cache, or null if no caching should be done. Ownership is not transferred.
+	 */
+	void setCoverageCache(CoverageCache* coverageCache);
+
+	/**
+	 * @brief Subtracts the coverage of a layer from a coverage, clamping at zero.
+	 *
+	 * This is done with SIMD instructions where available.
+	 * @param coverage The coverage to subtract from.
+	 * @param layer The coverage of a layer above.
+	 * @param size The number of values in both coverages.
+	 */
+	static void subtractCoverage(unsigned char* coverage, const unsigned char* layer, size_t size);
+
+	/**
+	 * @brief Gets the interpolated heights for a batch of positions in a segment.
+	 *
+	 * This uses the same interpolation as Mercator::Segment::getHeightAndNormal(), but without calculating any normals.
+	 * @param points The height points of the segment.
+	 * @param size The number of points along each side of the segment.
+	 * @param positions Positions, local to the segment.
+	 * @param heights The heights will be stored here, in the same order as the positions.
+	 */
+	static void getHeights(const float* points, unsigned int size, const std::vector<WFMath::Point<2>>& positions, std::vector<float>& heights);
 protected:
 
 	void getClustersForArea(const SegmentRefPtr& segmentRef, const WFMath::AxisBox<2>& area, ClusterStore& clusters);
@@ -67,6 +98,11 @@ protected:
 	float mDensity;
 	float mFalloff;
 	unsigned char mThreshold;
+
+	/**
+	 * @brief An optional cache of combined coverages, shared between populators.
+	 */
+	CoverageCache* mCoverageCache;
 };
 
 }
@@ -0,0 +1,136 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CoverageCache.h"
+#include "components/ogre/terrain/Buffer.h"
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+namespace Foliage
+{
+
+bool CoverageCache::Key::operator<(const Key& rhs) const
+{
+	if (xRef != rhs.xRef) {
+		return xRef < rhs.xRef;
+	}
+	if (yRef != rhs.yRef) {
+		return yRef < rhs.yRef;
+	}
+	if (resolution != rhs.resolution) {
+		return resolution < rhs.resolution;
+	}
+	return layers < rhs.layers;
+}
+
+CoverageCache::CoverageCache(size_t maxEntries) :
+		mMaxEntries(maxEntries), mGeneration(0)
+{
+}
+
+CoverageCache::~CoverageCache()
+{
+}
+
+CoverageCache::CoveragePtr CoverageCache::get(const Key& key, unsigned long& generation)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	generation = mGeneration;
+	auto I = mEntries.find(key);
+	if (I == mEntries.end()) {
+		return CoveragePtr();
+	}
+	//Move to the front of the usage list.
+	mUsage.splice(mUsage.begin(), mUsage, I->second.usage);
+	return I->second.coverage;
+}
+
+void CoverageCache::insert(const Key& key, CoveragePtr coverage, unsigned long generation)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (generation != mGeneration) {
+		//The cache has been invalidated since the coverage was calculated; it might be stale.
+		return;
+	}
+	auto I = mEntries.find(key);
+	if (I != mEntries.end()) {
+		I->second.coverage = coverage;
+		mUsage.splice(mUsage.begin(), mUsage, I->second.usage);
+		return;
+	}
+
+	mUsage.push_front(key);
+	Entry entry;
+	entry.coverage = coverage;
+	entry.usage = mUsage.begin();
+	mEntries.insert(std::make_pair(key, entry));
+
+	while (mEntries.size() > mMaxEntries) {
+		mEntries.erase(mUsage.back());
+		mUsage.pop_back();
+	}
+}
+
+void CoverageCache::invalidate(const std::vector<WFMath::AxisBox<2>>& areas)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mGeneration++;
+	for (auto I = mEntries.begin(); I != mEntries.end();) {
+		const Key& key = I->first;
+		bool touched = false;
+		for (auto& area : areas) {
+			if (area.lowCorner().x() <= key.xRef + key.resolution && area.highCorner().x() >= key.xRef && area.lowCorner().y() <= key.yRef + key.resolution && area.highCorner().y() >= key.yRef) {
+				touched = true;
+				break;
+			}
+		}
+		if (touched) {
+			mUsage.erase(I->second.usage);
+			I = mEntries.erase(I);
+		} else {
+			++I;
+		}
+	}
+}
+
+void CoverageCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mGeneration++;
+	mEntries.clear();
+	mUsage.clear();
+}
+
+size_t CoverageCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEntries.size();
+}
+
+}
+
+}
+
+}
+}
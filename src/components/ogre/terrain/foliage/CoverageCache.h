@@ -0,0 +1,171 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBEROGRE_TERRAIN_FOLIAGE_COVERAGECACHE_H_
+#define EMBEROGRE_TERRAIN_FOLIAGE_COVERAGECACHE_H_
+
+#include <wfmath/axisbox.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Ember
+{
+namespace OgreView
+{
+
+namespace Terrain
+{
+
+template<typename> class Buffer;
+
+namespace Foliage
+{
+
+/**
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ * @brief Caches combined surface coverage for segments.
+ *
+ * Calculating the combined coverage of a layer, with all layers above it subtracted, needs to be done for every plant type
+ * and every foliage page. Since many plant types share the same layers, and the same segment is queried for many pages,
+ * the result is cached here, keyed by the segment and the set of layers which were combined.
+ *
+ * The cache is accessed from the background threads, and invalidated from the main thread. To prevent stale coverage from being
+ * inserted after an invalidation, each lookup returns a generation which must be supplied when inserting.
+ */
+class CoverageCache
+{
+public:
+
+	typedef std::shared_ptr<const Buffer<unsigned char>> CoveragePtr;
+
+	/**
+	 * @brief Identifies a combined coverage.
+	 */
+	struct Key
+	{
+		/**
+		 * @brief The x position of the segment, in world units.
+		 */
+		int xRef;
+
+		/**
+		 * @brief The y position of the segment, in world units.
+		 */
+		int yRef;
+
+		/**
+		 * @brief The resolution of the segment.
+		 */
+		int resolution;
+
+		/**
+		 * @brief The indices of the surface layers which were combined, in order.
+		 */
+		std::vector<int> layers;
+
+		bool operator<(const Key& rhs) const;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param maxEntries The max number of coverages to keep. When exceeded the least recently used coverage is removed.
+	 */
+	explicit CoverageCache(size_t maxEntries = 256);
+
+	/**
+	 * @brief Dtor.
+	 */
+	~CoverageCache();
+
+	/**
+	 * @brief Gets a cached coverage.
+	 * @param key The key of the coverage.
+	 * @param generation The current generation will be stored here. Supply this to insert() if the coverage needs to be calculated.
+	 * @return The cached coverage, or an empty pointer if none could be found.
+	 */
+	CoveragePtr get(const Key& key, unsigned long& generation);
+
+	/**
+	 * @brief Inserts a coverage.
+	 *
+	 * If the cache has been invalidated since the generation was obtained nothing will be inserted.
+	 * @param key The key of the coverage.
+	 * @param coverage The combined coverage.
+	 * @param generation The generation as returned by get() before the coverage was calculated.
+	 */
+	void insert(const Key& key, CoveragePtr coverage, unsigned long generation);
+
+	/**
+	 * @brief Removes all coverages for segments which touch any of the areas.
+	 * @param areas Areas, in world units.
+	 */
+	void invalidate(const std::vector<WFMath::AxisBox<2>>& areas);
+
+	/**
+	 * @brief Removes all coverages.
+	 */
+	void clear();
+
+	/**
+	 * @brief Gets the number of cached coverages.
+	 * @return The number of cached coverages.
+	 */
+	size_t size() const;
+
+private:
+
+	typedef std::list<Key> UsageList;
+
+	struct Entry
+	{
+		CoveragePtr coverage;
+		UsageList::iterator usage;
+	};
+
+	typedef std::map<Key, Entry> EntryStore;
+
+	const size_t mMaxEntries;
+
+	/**
+	 * @brief Incremented each time the cache is invalidated.
+	 */
+	unsigned long mGeneration;
+
+	EntryStore mEntries;
+
+	/**
+	 * @brief Keys ordered by use, with the most recently used first.
+	 */
+	UsageList mUsage;
+
+	mutable std::mutex mMutex;
+};
+
+}
+
+}
+
+}
+
+}
+
+#endif /* EMBEROGRE_TERRAIN_FOLIAGE_COVERAGECACHE_H_ */
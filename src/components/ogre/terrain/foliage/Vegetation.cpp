@@ -7,6 +7,7 @@
 
 #include "Vegetation.h"
 #include "ClusterPopulator.h"
+#include "CoverageCache.h"
 #include "components/ogre/terrain/TerrainLayerDefinition.h"
 
 namespace Ember
@@ -20,7 +21,8 @@ namespace Terrain
 namespace Foliage
 {
 
-Vegetation::Vegetation()
+Vegetation::Vegetation() :
+		mCoverageCache(new CoverageCache())
 {
 }
 
@@ -29,7 +31,7 @@ Vegetation::~Vegetation()
 	for (PopulatorStore::const_iterator I = mPopulators.begin(); I != mPopulators.end(); ++I) {
 		delete I->second;
 	}
-
+	delete mCoverageCache;
 }
 
 void Vegetation::createPopulator(const TerrainFoliageDefinition& foliageDef, unsigned int surfaceLayerIndex)
@@ -52,6 +54,7 @@ void Vegetation::createPopulator(const TerrainFoliageDefinition& foliageDef, uns
 			threshold = static_cast<unsigned char> (atoi(foliageDef.getParameter("threshold").c_str()));
 		}
 		populator->setThreshold(threshold);
+		populator->setCoverageCache(mCoverageCache);
 
 		mPopulators[foliageDef.getPlantType()] = populator;
 
@@ -75,6 +78,16 @@ PlantPopulator* Vegetation::getPopulator(const std::string& plantType)
 	return 0;
 }
 
+void Vegetation::invalidateCoverage(const std::vector<WFMath::AxisBox<2>>& areas)
+{
+	mCoverageCache->invalidate(areas);
+}
+
+void Vegetation::invalidateAllCoverage()
+{
+	mCoverageCache->clear();
+}
+
 }
 
 }
@@ -11,6 +11,7 @@
 #include "components/ogre/terrain/Types.h"
 #include <cstdlib>
 #include <map>
+#include <vector>
 
 namespace Ember
 {
@@ -27,6 +28,7 @@ namespace Foliage
 {
 
 class PlantPopulator;
+class CoverageCache;
 
 class Vegetation
 {
@@ -40,10 +42,30 @@ public:
 
 	PlantPopulator* getPopulator(const std::string& plantType);
 
+	/**
+	 * @brief Invalidates cached coverage for any segments touched by the areas.
+	 *
+	 * Call this whenever the terrain geometry has changed.
+	 * @param areas Areas, in world units.
+	 */
+	void invalidateCoverage(const std::vector<WFMath::AxisBox<2>>& areas);
+
+	/**
+	 * @brief Invalidates all cached coverage.
+	 *
+	 * Call this whenever any layer has changed.
+	 */
+	void invalidateAllCoverage();
+
 protected:
 	typedef std::map<std::string, PlantPopulator*> PopulatorStore;
 
 	PopulatorStore mPopulators;
+
+	/**
+	 * @brief Combined coverage shared by all populators.
+	 */
+	CoverageCache* mCoverageCache;
 };
 
 }
@@ -21,6 +21,7 @@
 #include "components/ogre/terrain/TerrainPageSurfaceLayer.h"
 #include "components/ogre/terrain/TerrainPage.h"
 #include "components/ogre/terrain/TerrainPageGeometry.h"
+#include "components/ogre/terrain/TerrainPageSurface.h"
 #include <OgreShadowCameraSetupPSSM.h>
 #include <OgrePass.h>
 #include <OgreTechnique.h>
@@ -112,6 +113,11 @@ void Shader::buildPasses(bool normalMapped)
 				}
 			}
 		}
+		//Now that all layers have been added the blend maps can be composed.
+		PassStore& passes = normalMapped ? mPassesNormalMapped : mPasses;
+		for (size_t i = 0; i < passes.size(); ++i) {
+			passes[i]->composeBlendMaps(*mGeometry, *mPage.getSurface()->getBlendMapCache(), i);
+		}
 	} else {
 		S_LOG_WARNING("Could not create pass in Shader terrain technique.");
 	}
@@ -37,19 +37,25 @@ namespace Terrain
 namespace Techniques
 {
 
-Ogre::TexturePtr ShaderPass::getCombinedBlendMapTexture(size_t passIndex, size_t batchIndex, std::set<std::string>& managedTextures) const
+std::string ShaderPass::getCombinedBlendMapTextureName(size_t passIndex, size_t batchIndex) const
 {
 	// we need an unique name for our alpha texture
 	std::stringstream combinedBlendMapTextureNameSS;
 
 	combinedBlendMapTextureNameSS << "terrain_" << mPosition.x() << "_" << mPosition.y() << "_combinedBlendMap_" << passIndex << "_" << batchIndex << "_" << mBlendMapPixelWidth;
-	const Ogre::String combinedBlendMapName(combinedBlendMapTextureNameSS.str());
+	return combinedBlendMapTextureNameSS.str();
+}
+
+Ogre::TexturePtr ShaderPass::getCombinedBlendMapTexture(size_t passIndex, size_t batchIndex, std::set<std::string>& managedTextures, bool& isNewTexture) const
+{
+	const Ogre::String combinedBlendMapName(getCombinedBlendMapTextureName(passIndex, batchIndex));
 	Ogre::TexturePtr combinedBlendMapTexture;
 	Ogre::TextureManager* textureMgr = Ogre::Root::getSingletonPtr()->getTextureManager();
 	if (textureMgr->resourceExists(combinedBlendMapName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME)) {
 		S_LOG_VERBOSE("Using already created blendMap texture " << combinedBlendMapName);
 		combinedBlendMapTexture = static_cast<Ogre::TexturePtr>(textureMgr->getByName(combinedBlendMapName, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME));
-		if(!combinedBlendMapTexture->isLoaded()) {
+		isNewTexture = !combinedBlendMapTexture->isLoaded();
+		if(isNewTexture) {
 			combinedBlendMapTexture->createInternalResources();
 		}
 		return combinedBlendMapTexture;
@@ -64,6 +70,7 @@ Ogre::TexturePtr ShaderPass::getCombinedBlendMapTexture(size_t passIndex, size_t
 	combinedBlendMapTexture = textureMgr->createManual(combinedBlendMapName, "General", Ogre::TEX_TYPE_2D, mBlendMapPixelWidth, mBlendMapPixelWidth, textureMgr->getDefaultNumMipmaps(), Ogre::PF_B8G8R8A8, flags);
 	managedTextures.insert(combinedBlendMapName);
 	combinedBlendMapTexture->createInternalResources();
+	isNewTexture = true;
 	return combinedBlendMapTexture;
 }
 
@@ -102,12 +109,12 @@ ShaderPassBlendMapBatch* ShaderPass::getCurrentBatch()
 
 ShaderPassBlendMapBatch* ShaderPass::createNewBatch()
 {
-	return new ShaderPassBlendMapBatch(*this, getBlendMapPixelWidth());
+	return new ShaderPassBlendMapBatch(*this);
 }
 
 void ShaderPass::addLayer(const TerrainPageGeometry& geometry, const TerrainPageSurfaceLayer* layer)
 {
-	getCurrentBatch()->addLayer(geometry, layer);
+	getCurrentBatch()->addLayer(layer);
 
 	mScales[mLayers.size()] = layer->getScale();
 	mLayers.push_back(layer);
@@ -166,7 +173,9 @@ bool ShaderPass::finalize(Ogre::Pass& pass, std::set<std::string>& managedTextur
 	size_t i = 0;
 	// add our blendMap textures first
 	for (auto batch : mBlendMapBatches) {
-		batch->finalize(pass, getCombinedBlendMapTexture(pass.getIndex(), i++, managedTextures), mUseNormalMapping);
+		bool isNewTexture = false;
+		Ogre::TexturePtr texture = getCombinedBlendMapTexture(pass.getIndex(), i++, managedTextures, isNewTexture);
+		batch->finalize(pass, texture, isNewTexture, mUseNormalMapping);
 	}
 
 	//we provide different fragment programs for different amounts of textures used, so we need to determine which one to use.
@@ -242,6 +251,14 @@ bool ShaderPass::finalize(Ogre::Pass& pass, std::set<std::string>& managedTextur
 	return true;
 }
 
+void ShaderPass::composeBlendMaps(const TerrainPageGeometry& geometry, BlendMapCache& blendMapCache, size_t passIndex)
+{
+	for (size_t i = 0; i < mBlendMapBatches.size(); ++i) {
+		//The texture name is used as key, so that the blend map in the cache always matches the texture.
+		mBlendMapBatches[i]->compose(geometry, blendMapCache, getCombinedBlendMapTextureName(passIndex, i));
+	}
+}
+
 bool ShaderPass::hasRoomForLayer(const TerrainPageSurfaceLayer* layer)
 {
 	//TODO: calculate this once
@@ -37,6 +37,7 @@ class TerrainPage;
 class TerrainPageSurfaceLayer;
 class TerrainPageGeometry;
 class TerrainPageShadow;
+class BlendMapCache;
 
 namespace Techniques
 {
@@ -58,6 +59,16 @@ friend class ShaderPassBlendMapBatch;
 
 	virtual bool hasRoomForLayer(const TerrainPageSurfaceLayer* layer);
 
+	/**
+	 * @brief Composes the combined blend maps of all batches.
+	 *
+	 * This should be called once all layers have been added, and before finalize() is called.
+	 * @param geometry The geometry of the page.
+	 * @param blendMapCache The cache of blend maps for the page.
+	 * @param passIndex The index of the pass in its technique.
+	 */
+	void composeBlendMaps(const TerrainPageGeometry& geometry, BlendMapCache& blendMapCache, size_t passIndex);
+
 	/**
 	 * @brief Creates the combined final blend maps and sets the shader params. Be sure to call this before you load the material.
      * @param managedTextures A set of textures created in the process. These will be destroyed when the page is destroyed.
@@ -76,7 +87,8 @@ protected:
 	virtual ShaderPassBlendMapBatch* createNewBatch();
 
 	unsigned int getBlendMapPixelWidth() const;
-	Ogre::TexturePtr getCombinedBlendMapTexture(size_t passIndex, size_t batchIndex, std::set<std::string>& managedTextures) const;
+	std::string getCombinedBlendMapTextureName(size_t passIndex, size_t batchIndex) const;
+	Ogre::TexturePtr getCombinedBlendMapTexture(size_t passIndex, size_t batchIndex, std::set<std::string>& managedTextures, bool& isNewTexture) const;
 
 	float mScales[16];
 	BlendMapBatchStore mBlendMapBatches;
@@ -19,6 +19,7 @@
 #include "ShaderPassBlendMapBatch.h"
 #include "ShaderPass.h"
 #include "components/ogre/terrain/TerrainPageSurfaceLayer.h"
+#include "components/ogre/terrain/BlendMapCompositor.h"
 
 #include "framework/TimedLog.h"
 
@@ -26,6 +27,8 @@
 #include <OgreTextureUnitState.h>
 #include <OgrePass.h>
 
+#include <algorithm>
+
 namespace Ember
 {
 namespace OgreView
@@ -37,62 +40,64 @@ namespace Terrain
 namespace Techniques
 {
 
-ShaderPassBlendMapBatch::ShaderPassBlendMapBatch(ShaderPass& shaderPass, unsigned int imageSize) :
-	mShaderPass(shaderPass), mCombinedBlendMapImage(new Image::ImageBuffer(imageSize, 4))
+ShaderPassBlendMapBatch::ShaderPassBlendMapBatch(ShaderPass& shaderPass) :
+	mShaderPass(shaderPass), mBlendMapCache(nullptr)
 {
-	//reset the blendMap image
-	mCombinedBlendMapImage.reset();
 }
 
 ShaderPassBlendMapBatch::~ShaderPassBlendMapBatch()
 {
 }
 
-void ShaderPassBlendMapBatch::addLayer(const TerrainPageGeometry& geometry, const TerrainPageSurfaceLayer* layer)
+void ShaderPassBlendMapBatch::addLayer(const TerrainPageSurfaceLayer* layer)
 {
-	addBlendMap(geometry, layer, mLayers.size());
 	mLayers.push_back(layer);
 }
 
-void ShaderPassBlendMapBatch::addBlendMap(const TerrainPageGeometry& geometry, const TerrainPageSurfaceLayer* layer, unsigned int channel)
+std::vector<const TerrainPageSurfaceLayer*>& ShaderPassBlendMapBatch::getLayers()
 {
-	layer->fillImage(geometry, mCombinedBlendMapImage, channel);
-	mSyncedTextures.clear();
+	return mLayers;
 }
 
-std::vector<const TerrainPageSurfaceLayer*>& ShaderPassBlendMapBatch::getLayers()
+void ShaderPassBlendMapBatch::compose(const TerrainPageGeometry& geometry, BlendMapCache& blendMapCache, const std::string& key)
 {
-	return mLayers;
+	mBlendMapCache = &blendMapCache;
+	mBlendMapKey = key;
+	mBlendMap = blendMapCache.compose(key, geometry, mLayers);
 }
 
-void ShaderPassBlendMapBatch::assignCombinedBlendMapTexture(Ogre::TexturePtr texture)
+void ShaderPassBlendMapBatch::assignCombinedBlendMapTexture(Ogre::TexturePtr texture, bool isNewTexture)
 {
-	if (std::find(mSyncedTextures.begin(), mSyncedTextures.end(), texture->getName()) == mSyncedTextures.end()) {
-		TimedLog log("ShaderPassBlendMapBatch::assignCombinedBlendMapTexture", true);
-
-		//blit the whole image to the hardware buffer
-		Ogre::PixelBox sourceBox(mCombinedBlendMapImage.getResolution(), mCombinedBlendMapImage.getResolution(), 1, Ogre::PF_B8G8R8A8, mCombinedBlendMapImage.getData());
-
-		if ((texture->getUsage() & Ogre::TU_AUTOMIPMAP) && texture->getMipmapsHardwareGenerated()) {
-			//No need to blit for all mipmaps as they will be generated.
-			Ogre::HardwarePixelBufferSharedPtr hardwareBuffer(texture->getBuffer(0, 0));
-			hardwareBuffer->blitFromMemory(sourceBox);
-		} else {
-			for (size_t i = 0; i <= texture->getNumMipmaps(); ++i)
-			{
-				Ogre::HardwarePixelBufferSharedPtr hardwareBuffer(texture->getBuffer(0, i));
-				hardwareBuffer->blitFromMemory(sourceBox);
-			}
-		}
+	if (!mBlendMap) {
+		return;
+	}
+	//Only the parts which have changed since the last upload need to be uploaded, if any.
+	BlendMapCache::Region region = mBlendMapCache->takeUploadRegion(mBlendMapKey, mBlendMap, isNewTexture);
+	if (region.isEmpty()) {
+		return;
+	}
+	TimedLog log("ShaderPassBlendMapBatch::assignCombinedBlendMapTexture", true);
 
-		mSyncedTextures.push_back(texture->getName());
+	//If the mipmaps are generated by the hardware we only need to upload the full size image, else we'll upload the mipmaps we've already generated.
+	size_t levelCount = 1;
+	if (!((texture->getUsage() & Ogre::TU_AUTOMIPMAP) && texture->getMipmapsHardwareGenerated())) {
+		levelCount = std::min(static_cast<size_t>(texture->getNumMipmaps()) + 1, mBlendMap->levels.size());
+	}
+	for (size_t level = 0; level < levelCount; ++level) {
+		unsigned int levelWidth = BlendMapCompositor::getLevelWidth(mBlendMap->width, level);
+		BlendMapCache::Region levelRegion = region.getLevelRegion(level, mBlendMap->width);
+		Ogre::Box box(levelRegion.left, levelRegion.top, levelRegion.right, levelRegion.bottom);
+		Ogre::PixelBox levelBox(levelWidth, levelWidth, 1, Ogre::PF_B8G8R8A8, const_cast<unsigned char*>(mBlendMap->levels[level].data()));
+
+		Ogre::HardwarePixelBufferSharedPtr hardwareBuffer(texture->getBuffer(0, level));
+		hardwareBuffer->blitFromMemory(levelBox.getSubVolume(box), box);
 	}
 }
 
-void ShaderPassBlendMapBatch::finalize(Ogre::Pass& pass, Ogre::TexturePtr texture, bool useNormalMapping)
+void ShaderPassBlendMapBatch::finalize(Ogre::Pass& pass, Ogre::TexturePtr texture, bool isNewTexture, bool useNormalMapping)
 {
 	//add our blend map textures first
-	assignCombinedBlendMapTexture(texture);
+	assignCombinedBlendMapTexture(texture, isNewTexture);
 	Ogre::TextureUnitState * blendMapTUS = pass.createTextureUnitState();
 	blendMapTUS->setTextureScale(1, 1);
 	blendMapTUS->setTextureName(texture->getName());
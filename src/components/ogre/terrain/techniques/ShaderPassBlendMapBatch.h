@@ -20,7 +20,9 @@
 #define EMBEROGRETERRAINTECHNIQUESSHADERPASSBLENDMAPBATCH_H_
 
 #include "components/ogre/OgreIncludes.h"
-#include "components/ogre/terrain/OgreImage.h"
+#include "components/ogre/terrain/BlendMapCache.h"
+#include <memory>
+#include <string>
 #include <vector>
 #include <OgreTexture.h>
 
@@ -49,30 +51,54 @@ typedef std::vector<const TerrainPageSurfaceLayer*> LayerStore;
 class ShaderPassBlendMapBatch
 {
 public:
-	ShaderPassBlendMapBatch(ShaderPass& shaderPass, unsigned int imageSize);
+	explicit ShaderPassBlendMapBatch(ShaderPass& shaderPass);
 	virtual ~ShaderPassBlendMapBatch();
 
-	void addLayer(const TerrainPageGeometry& geometry, const TerrainPageSurfaceLayer* layer);
+	void addLayer(const TerrainPageSurfaceLayer* layer);
 
 	std::vector<const TerrainPageSurfaceLayer*>& getLayers();
-	Image& getCombinedBlendMapImage();
 
-	virtual void finalize(Ogre::Pass& pass, Ogre::TexturePtr texture, bool useNormalMapping);
+	/**
+	 * @brief Composes the combined blend map of all layers in the batch.
+	 *
+	 * This should be called once all layers have been added, and before finalize() is called.
+	 * @param geometry The geometry of the page.
+	 * @param blendMapCache The cache of blend maps for the page.
+	 * @param key The key of the blend map in the cache.
+	 */
+	void compose(const TerrainPageGeometry& geometry, BlendMapCache& blendMapCache, const std::string& key);
+
+	/**
+	 * @brief Sets up the pass to use the batch, uploading the combined blend map to the texture as needed.
+	 * @param pass The pass.
+	 * @param texture The texture for the combined blend map.
+	 * @param isNewTexture True if the texture has just been created.
+	 * @param useNormalMapping Whether normal mapping is used.
+	 */
+	virtual void finalize(Ogre::Pass& pass, Ogre::TexturePtr texture, bool isNewTexture, bool useNormalMapping);
 
 protected:
 
 	ShaderPass& mShaderPass;
 
-	OgreImage mCombinedBlendMapImage;
 	LayerStore mLayers;
 
 	/**
-	 * @brief A collection of names of textures which have already been synced with the image, to prevent us from blitting when we don't need.
+	 * @brief The cache from which the blend map was obtained.
+	 */
+	BlendMapCache* mBlendMapCache;
+
+	/**
+	 * @brief The key of the blend map in the cache.
+	 */
+	std::string mBlendMapKey;
+
+	/**
+	 * @brief The combined blend map, once composed.
 	 */
-	std::vector<std::string> mSyncedTextures;
+	std::shared_ptr<const BlendMapCache::BlendMap> mBlendMap;
 
-	void assignCombinedBlendMapTexture(Ogre::TexturePtr texture);
-	void addBlendMap(const TerrainPageGeometry& geometry, const TerrainPageSurfaceLayer* layer, unsigned int channel);
+	void assignCombinedBlendMapTexture(Ogre::TexturePtr texture, bool isNewTexture);
 
 };
 
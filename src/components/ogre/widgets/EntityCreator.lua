@@ -235,7 +235,7 @@ function EntityCreator.buildWidget(world)
 					local entitiesToLoad = stats.entitiesCount - stats.entitiesProcessedCount
 					local mindsToRestore = stats.mindsCount - stats.mindsProcessedCount
 					local rulesToRestore = stats.rulesCount - stats.rulesProcessedCount
-					dumpStatusWindow:setText("Loading, " .. rulesToRestore .. " rules, " .. entitiesToLoad .. " entities and " .. mindsToRestore .." minds left")
+					dumpStatusWindow:setText("Loading, " .. rulesToRestore .. " rules, " .. entitiesToLoad .. " entities and " .. mindsToRestore .." minds left (" .. math.floor(stats.entitiesPerSecond) .. " entities/s)")
 				end)
 				cancelButton.method = function()
 					activeOverlay:setVisible(false)
@@ -66,7 +66,8 @@ function Performance.framestarted(timeSinceLastFrame)
 		if Performance.motionManager then
 			local motionInfo = Performance.motionManager:getInfo()
 			statString = statString .. "\nAnimated: " .. motionInfo.AnimatedEntities
-			statString = statString .. "\nMoving: " .. motionInfo.MovingEntities
+			statString = statString .. "\nMoving: " .. motionInfo.MovingEntities .. " (" .. motionInfo.PredictedEntities .. " predicted)"
+			statString = statString .. "\nMotion updates: " .. motionInfo.MovablesUpdated .. ", animation updates: " .. motionInfo.AnimationsUpdated
 		end
 		--ss << "Time in eris: " << getAverageErisTime() * 100 << "% \n"
 		
@@ -0,0 +1,236 @@
+//
+// Copyright (C) 2016 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "EntityDumpReader.h"
+
+#include <Atlas/Codecs/XML.h>
+#include <Atlas/Codecs/Packed.h>
+
+#include <algorithm>
+#include <cctype>
+
+using Atlas::Message::Element;
+using Atlas::Message::ListType;
+using Atlas::Message::MapType;
+
+namespace
+{
+/**
+ * @brief The number of bytes read from the stream at a time.
+ */
+const std::streamsize CHUNK_SIZE = 65536;
+}
+
+EntityDumpReader::EntityDumpReader(std::istream& stream) :
+		mStream(stream), mEntityCount(0), mInEntities(false), mEntitiesStarted(false), mSkipEntities(false), mComplete(false)
+{
+}
+
+EntityDumpReader::~EntityDumpReader()
+{
+}
+
+bool EntityDumpReader::readUntilEntities()
+{
+	while (!mEntitiesStarted && !mComplete && readChunk()) {
+	}
+	return mComplete || !mFrames.empty();
+}
+
+bool EntityDumpReader::readEntity(MapType& entity)
+{
+	while (mEntities.empty() && !mComplete && (mInEntities || !mEntitiesStarted) && readChunk()) {
+	}
+	if (mEntities.empty()) {
+		return false;
+	}
+	entity = std::move(mEntities.front());
+	mEntities.pop_front();
+	return true;
+}
+
+void EntityDumpReader::readToEnd()
+{
+	mSkipEntities = true;
+	mEntities.clear();
+	while (!mComplete && readChunk()) {
+	}
+}
+
+const MapType& EntityDumpReader::getSections() const
+{
+	return mSections;
+}
+
+size_t EntityDumpReader::getEntityCount() const
+{
+	return mEntityCount;
+}
+
+bool EntityDumpReader::readChunk()
+{
+	std::string chunk(CHUNK_SIZE, '\0');
+	mStream.read(&chunk[0], CHUNK_SIZE);
+	chunk.resize(mStream.gcount());
+	if (chunk.empty()) {
+		return false;
+	}
+
+	if (!mCodec) {
+		auto I = std::find_if(chunk.begin(), chunk.end(), [](char c) {return !std::isspace(static_cast<unsigned char>(c));});
+		if (I == chunk.end()) {
+			return true;
+		}
+		//XML dumps always start with a tag, while Packed dumps never do.
+		if (*I == '<') {
+			mCodec.reset(new Atlas::Codecs::XML(mBuffer, mBuffer, *this));
+		} else {
+			mCodec.reset(new Atlas::Codecs::Packed(mBuffer, mBuffer, *this));
+		}
+	}
+
+	//The codec keeps its parse state between polls, so it doesn't matter that elements are split between chunks.
+	mBuffer.str(chunk);
+	mBuffer.clear();
+	mCodec->poll(true);
+	return true;
+}
+
+void EntityDumpReader::addElement(const std::string& name, Element element)
+{
+	if (mFrames.empty()) {
+		return;
+	}
+	if (mFrames.size() == 1) {
+		mSections[name] = std::move(element);
+		return;
+	}
+	if (mInEntities && mFrames.size() == 2) {
+		mEntityCount++;
+		if (!mSkipEntities && element.isMap()) {
+			mEntities.push_back(std::move(element.Map()));
+		}
+		return;
+	}
+	Element& parent = mFrames.back().element;
+	if (parent.isMap()) {
+		parent.Map()[name] = std::move(element);
+	} else {
+		parent.List().push_back(std::move(element));
+	}
+}
+
+void EntityDumpReader::pushFrame(const std::string& name, Element element)
+{
+	mFrames.push_back(Frame { std::move(element), name });
+}
+
+void EntityDumpReader::popFrame()
+{
+	if (mFrames.empty()) {
+		return;
+	}
+	Frame frame = std::move(mFrames.back());
+	mFrames.pop_back();
+	if (mFrames.empty()) {
+		mComplete = true;
+	} else if (mInEntities && mFrames.size() == 1) {
+		mInEntities = false;
+	} else {
+		addElement(frame.name, std::move(frame.element));
+	}
+}
+
+void EntityDumpReader::streamBegin()
+{
+}
+
+void EntityDumpReader::streamMessage()
+{
+	//Only the first top level map is read.
+	if (mFrames.empty() && !mComplete) {
+		pushFrame("", MapType());
+	}
+}
+
+void EntityDumpReader::streamEnd()
+{
+}
+
+void EntityDumpReader::mapMapItem(const std::string& name)
+{
+	pushFrame(name, MapType());
+}
+
+void EntityDumpReader::mapListItem(const std::string& name)
+{
+	if (mFrames.size() == 1 && name == "entities") {
+		mInEntities = true;
+		mEntitiesStarted = true;
+	}
+	pushFrame(name, ListType());
+}
+
+void EntityDumpReader::mapIntItem(const std::string& name, long value)
+{
+	addElement(name, value);
+}
+
+void EntityDumpReader::mapFloatItem(const std::string& name, double value)
+{
+	addElement(name, value);
+}
+
+void EntityDumpReader::mapStringItem(const std::string& name, const std::string& value)
+{
+	addElement(name, value);
+}
+
+void EntityDumpReader::mapEnd()
+{
+	popFrame();
+}
+
+void EntityDumpReader::listMapItem()
+{
+	pushFrame("", MapType());
+}
+
+void EntityDumpReader::listListItem()
+{
+	pushFrame("", ListType());
+}
+
+void EntityDumpReader::listIntItem(long value)
+{
+	addElement("", value);
+}
+
+void EntityDumpReader::listFloatItem(double value)
+{
+	addElement("", value);
+}
+
+void EntityDumpReader::listStringItem(const std::string& value)
+{
+	addElement("", value);
+}
+
+void EntityDumpReader::listEnd()
+{
+	popFrame();
+}
@@ -0,0 +1,184 @@
+//
+// Copyright (C) 2016 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef ENTITYDUMPREADER_H
+#define ENTITYDUMPREADER_H
+
+#include <Atlas/Bridge.h>
+#include <Atlas/Message/Element.h>
+
+#include <deque>
+#include <istream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Atlas
+{
+class Codec;
+}
+
+/**
+ * @author Erik Ogenvik
+ *
+ * @brief Reads an entity dump, as written by EntityExporterBase, piece by piece.
+ *
+ * Instead of decoding the whole dump into one object, the entities in the top level "entities" list are handed out one at a time,
+ * as they are read from the stream. Everything else in the top level map (such as "meta", "rules" and "minds") is kept as sections.
+ * The stream is read in fixed size chunks, so the memory used doesn't depend on the size of the dump.
+ *
+ * Both XML and Packed encoded dumps can be read; the codec is picked by looking at the first character of the stream.
+ *
+ * This is meant to be shared between both Ember and Cyphesis, and only relies on Atlas and C++ std.
+ */
+class EntityDumpReader: public Atlas::Bridge
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * @param stream The stream to read from. Must outlive this instance.
+	 */
+	explicit EntityDumpReader(std::istream& stream);
+
+	virtual ~EntityDumpReader();
+
+	/**
+	 * @brief Reads until the start of the entities list, or the end of the stream.
+	 *
+	 * Any sections before the entities list (usually "meta" and "rules") are available through getSections() after this.
+	 * @return True if the stream contained a top level map.
+	 */
+	bool readUntilEntities();
+
+	/**
+	 * @brief Reads the next entity.
+	 * @param entity The entity, if one was read.
+	 * @return False if there are no more entities.
+	 */
+	bool readEntity(Atlas::Message::MapType& entity);
+
+	/**
+	 * @brief Reads the rest of the stream, counting but not keeping any remaining entities.
+	 */
+	void readToEnd();
+
+	/**
+	 * @brief Gets all top level items except the entities list read so far.
+	 * @return The sections.
+	 */
+	const Atlas::Message::MapType& getSections() const;
+
+	/**
+	 * @brief Gets the number of entities read (or skipped) so far.
+	 * @return The number of entities.
+	 */
+	size_t getEntityCount() const;
+
+	virtual void streamBegin();
+	virtual void streamMessage();
+	virtual void streamEnd();
+
+	virtual void mapMapItem(const std::string& name);
+	virtual void mapListItem(const std::string& name);
+	virtual void mapIntItem(const std::string& name, long);
+	virtual void mapFloatItem(const std::string& name, double);
+	virtual void mapStringItem(const std::string& name, const std::string&);
+	virtual void mapEnd();
+
+	virtual void listMapItem();
+	virtual void listListItem();
+	virtual void listIntItem(long);
+	virtual void listFloatItem(double);
+	virtual void listStringItem(const std::string&);
+	virtual void listEnd();
+
+private:
+
+	/**
+	 * @brief A map or list being built.
+	 */
+	struct Frame
+	{
+		Atlas::Message::Element element;
+
+		/**
+		 * @brief The name of the element in its parent map, if the parent is a map.
+		 */
+		std::string name;
+	};
+
+	std::istream& mStream;
+
+	/**
+	 * @brief Holds the chunk currently being decoded.
+	 */
+	std::stringstream mBuffer;
+
+	std::unique_ptr<Atlas::Codec> mCodec;
+
+	/**
+	 * @brief The maps and lists being built, innermost last.
+	 */
+	std::vector<Frame> mFrames;
+
+	/**
+	 * @brief Entities which have been read from the stream, but not yet handed out.
+	 */
+	std::deque<Atlas::Message::MapType> mEntities;
+
+	Atlas::Message::MapType mSections;
+
+	size_t mEntityCount;
+
+	/**
+	 * @brief True while inside the top level entities list.
+	 */
+	bool mInEntities;
+
+	/**
+	 * @brief True once the entities list has been started.
+	 */
+	bool mEntitiesStarted;
+
+	/**
+	 * @brief True if entities should only be counted, not kept.
+	 */
+	bool mSkipEntities;
+
+	/**
+	 * @brief True once the top level map has been read.
+	 */
+	bool mComplete;
+
+	/**
+	 * @brief Reads and decodes the next chunk of the stream.
+	 * @return False if the end of the stream was reached.
+	 */
+	bool readChunk();
+
+	/**
+	 * @brief Adds a completed element to the innermost frame, or to the sections or entities if at the top level.
+	 */
+	void addElement(const std::string& name, Atlas::Message::Element element);
+
+	void pushFrame(const std::string& name, Atlas::Message::Element element);
+	void popFrame();
+};
+
+#endif //ENTITYDUMPREADER_H
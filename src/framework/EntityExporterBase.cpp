@@ -21,6 +21,7 @@
 #include "LoggingInstance.h"
 
 #include <Atlas/Codecs/XML.h>
+#include <Atlas/Codecs/Packed.h>
 #include <Atlas/Message/QueuedDecoder.h>
 #include <Atlas/Message/MEncoder.h>
 #include <Atlas/Objects/Anonymous.h>
@@ -52,8 +53,22 @@ bool idSorter(const std::string& lhs, const std::string& rhs)
 	return integerId(lhs) < integerId(rhs);
 }
 
+struct EntityExporterBase::StreamWriter
+{
+	std::fstream stream;
+	Atlas::Message::QueuedDecoder decoder;
+	std::unique_ptr<Atlas::Codec> codec;
+	std::unique_ptr<Atlas::Formatter> formatter;
+	std::unique_ptr<Atlas::Message::Encoder> encoder;
+
+	/**
+	 * @brief Either the formatter or the codec, depending on the encoding.
+	 */
+	Atlas::Bridge* bridge;
+};
+
 EntityExporterBase::EntityExporterBase(const std::string& accountId, const std::string& avatarId, const std::string& currentTimestamp) :
-		mAccountId(accountId), mAvatarId(avatarId), mCurrentTimestamp(currentTimestamp), mStats( { }), mComplete(false), mCancelled(false), mOutstandingGetRequestCounter(0), mExportTransient(false), mPreserveIds(false), mExportRules(false), mExportMinds(true)
+		mAccountId(accountId), mAvatarId(avatarId), mCurrentTimestamp(currentTimestamp), mStats( { }), mComplete(false), mCancelled(false), mOutstandingGetRequestCounter(0), mExportTransient(false), mPreserveIds(false), mExportRules(false), mExportMinds(true), mStreaming(false), mFormat(XML), mPersistedIdCounter(0)
 {
 }
 
@@ -111,6 +126,36 @@ bool EntityExporterBase::getExportRules() const
 	return mExportRules;
 }
 
+void EntityExporterBase::setMaxOpsInFlight(unsigned int maxOpsInFlight)
+{
+	mEntityWindow.setMaxSize(maxOpsInFlight);
+}
+
+unsigned int EntityExporterBase::getMaxOpsInFlight() const
+{
+	return static_cast<unsigned int>(mEntityWindow.getMaxSize());
+}
+
+void EntityExporterBase::setStreaming(bool streaming)
+{
+	mStreaming = streaming;
+}
+
+bool EntityExporterBase::getStreaming() const
+{
+	return mStreaming;
+}
+
+void EntityExporterBase::setFormat(Format format)
+{
+	mFormat = format;
+}
+
+EntityExporterBase::Format EntityExporterBase::getFormat() const
+{
+	return mFormat;
+}
+
 const EntityExporterBase::Stats& EntityExporterBase::getStats() const
 {
 	return mStats;
@@ -206,29 +251,49 @@ void EntityExporterBase::pollQueue()
 		return;
 	}
 
-	//Make sure that no more than 5 outstanding get requests are currently sent to the server.
+	//Make sure that we don't have more outstanding get requests than the window allows.
 	//The main reason for us not wanting more is that we then run the risk of overflowing the server connection (which will then be dropped).
-	while (mOutstandingGetRequestCounter < 5 && !mEntityQueue.empty()) {
-		Get get;
+	while (mEntityWindow.canSend() && !mEntityQueue.empty()) {
+		requestEntity(mEntityQueue.front());
+		mEntityQueue.pop_front();
+	}
+	updateEntityStats();
+	EventProgress.emit();
+}
+
+void EntityExporterBase::requestEntity(const std::string& entityId)
+{
+	Get get;
+
+	Anonymous get_arg;
+	get_arg->setObjtype("obj");
+	get_arg->setId(entityId);
 
-		Anonymous get_arg;
-		get_arg->setObjtype("obj");
-		get_arg->setId(mEntityQueue.front());
+	get->setArgs1(get_arg);
+	get->setFrom(mAccountId);
+	get->setSerialno(newSerialNumber());
 
-		get->setArgs1(get_arg);
-		get->setFrom(mAccountId);
-		get->setSerialno(newSerialNumber());
+	mEntityGetsInFlight.insert(std::make_pair(get->getSerialno(), std::chrono::steady_clock::now()));
+	mEntityWindow.sent();
+	mOutstandingGetRequestCounter++;
 
-		sigc::slot<void, const Operation&> slot = sigc::mem_fun(*this, &EntityExporterBase::operationGetResult);
-		sendAndAwaitResponse(get, slot);
-		S_LOG_VERBOSE("Requesting info about entity with id " << get_arg->getId());
+	sigc::slot<void, const Operation&> slot = sigc::mem_fun(*this, &EntityExporterBase::operationGetResult);
+	sendAndAwaitResponse(get, slot);
+	S_LOG_VERBOSE("Requesting info about entity with id " << entityId);
 
-		mOutstandingGetRequestCounter++;
+	mStats.entitiesQueried++;
+}
 
-		mEntityQueue.pop_front();
-		mStats.entitiesQueried++;
+void EntityExporterBase::updateEntityStats()
+{
+	mStats.entityGetsInFlight = static_cast<unsigned int>(mEntityWindow.getInFlight());
+	mStats.entityGetsWindow = static_cast<unsigned int>(mEntityWindow.getSize());
+	mStats.entityGetsInFlightPeak = static_cast<unsigned int>(mEntityWindow.getPeakInFlight());
+	mStats.entityGetsRoundTrip = static_cast<unsigned int>(mEntityWindow.getRoundTripTime().count());
+	auto elapsed = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::steady_clock::now() - mEntityRequestStart).count();
+	if (elapsed > 0) {
+		mStats.entitiesPerSecond = mStats.entitiesReceived / elapsed;
 	}
-	EventProgress.emit();
 }
 
 void EntityExporterBase::infoArrived(const Operation & op)
@@ -266,29 +331,34 @@ void EntityExporterBase::infoArrived(const Operation & op)
 	}
 
 	if (!shouldSkip) {
-		//Make a copy so that we can sort the contains list and update it in the
-		//entity
-		RootEntity entityCopy(ent->copy());
 		std::list<std::string> contains = ent->getContains();
 		//Sort the contains list so it's deterministic
 		contains.sort(idSorter);
-		entityCopy->setContains(contains);
 
-		std::string persistedId = entityCopy->getId();
+		std::string persistedId;
+		if (mStreamWriter) {
+			persistedId = streamEntity(ent);
+		} else {
+			//Make a copy so that we can update the sorted contains list in the entity
+			RootEntity entityCopy(ent->copy());
+			entityCopy->setContains(contains);
+
+			persistedId = entityCopy->getId();
 
-		if (!mPreserveIds && persistedId != "0") {
-			std::stringstream ss;
-			ss << mEntities.size();
-			persistedId = ss.str();
-			entityCopy->setId(persistedId);
-		}
-		mIdMapping.insert(std::make_pair(ent->getId(), persistedId));
+			if (!mPreserveIds && persistedId != "0") {
+				std::stringstream ss;
+				ss << mEntities.size();
+				persistedId = ss.str();
+				entityCopy->setId(persistedId);
+			}
+			mIdMapping.insert(std::make_pair(ent->getId(), persistedId));
 
-		//Remove attributes which shouldn't be persisted
-		entityCopy->removeAttr(Atlas::Objects::Entity::VELOCITY_ATTR);
-		entityCopy->removeAttr(Atlas::Objects::Entity::LOC_ATTR);
-		entityCopy->removeAttr(Atlas::Objects::STAMP_ATTR);
-		dumpEntity(entityCopy);
+			//Remove attributes which shouldn't be persisted
+			entityCopy->removeAttr(Atlas::Objects::Entity::VELOCITY_ATTR);
+			entityCopy->removeAttr(Atlas::Objects::Entity::LOC_ATTR);
+			entityCopy->removeAttr(Atlas::Objects::STAMP_ATTR);
+			dumpEntity(entityCopy);
+		}
 		std::list<std::string>::const_iterator I = contains.begin();
 		std::list<std::string>::const_iterator Iend = contains.end();
 		for (; I != Iend; ++I) {
@@ -312,6 +382,45 @@ void EntityExporterBase::infoArrived(const Operation & op)
 	pollQueue();
 }
 
+std::string EntityExporterBase::streamEntity(const RootEntity& ent)
+{
+	std::string persistedId = assignPersistedId(ent->getId());
+
+	RootEntity entityCopy(ent->copy());
+	entityCopy->setId(persistedId);
+
+	//Remove attributes which shouldn't be persisted, as well as the contained entities since they aren't known yet.
+	//Instead the children refer to their parent through "loc".
+	entityCopy->removeAttr(Atlas::Objects::Entity::VELOCITY_ATTR);
+	entityCopy->removeAttr(Atlas::Objects::Entity::CONTAINS_ATTR);
+	entityCopy->removeAttr(Atlas::Objects::STAMP_ATTR);
+	if (ent->getId() == mRootEntityId || ent->isDefaultLoc()) {
+		entityCopy->removeAttr(Atlas::Objects::Entity::LOC_ATTR);
+	} else {
+		entityCopy->setLoc(assignPersistedId(ent->getLoc()));
+	}
+
+	Element entityElement = entityCopy->asMessage();
+	resolveEntityReferences(entityElement);
+	mStreamWriter->encoder->listElementMapItem(entityElement.asMap());
+	return persistedId;
+}
+
+std::string EntityExporterBase::assignPersistedId(const std::string& entityId)
+{
+	if (mPreserveIds) {
+		return entityId;
+	}
+	auto I = mIdMapping.find(entityId);
+	if (I != mIdMapping.end()) {
+		return I->second;
+	}
+	std::stringstream ss;
+	ss << mPersistedIdCounter++;
+	mIdMapping.insert(std::make_pair(entityId, ss.str()));
+	return ss.str();
+}
+
 void EntityExporterBase::requestThoughts(const std::string& entityId, const std::string& persistedId)
 {
 	Atlas::Objects::Operation::Generic think;
@@ -351,9 +460,9 @@ void EntityExporterBase::requestRule(const std::string& rule)
 	mOutstandingGetRequestCounter++;
 }
 
-void EntityExporterBase::adjustReferencedEntities()
+void EntityExporterBase::adjustReferencedMinds()
 {
-	S_LOG_VERBOSE("Adjusting referenced entity ids.");
+	S_LOG_VERBOSE("Adjusting referenced entity ids in minds.");
 	if (!mPreserveIds) {
 		for (auto& mind : mMinds) {
 			//We know that mMinds only contain maps, and that there's always a "thoughts" list
@@ -433,6 +542,11 @@ void EntityExporterBase::adjustReferencedEntities()
 			}
 		}
 	}
+}
+
+void EntityExporterBase::adjustReferencedEntities()
+{
+	S_LOG_VERBOSE("Adjusting referenced entity ids.");
 	for (auto& entity : mEntities) {
 		auto& entityMap = entity.asMap();
 		//We know that mEntities only contain maps
@@ -462,9 +576,14 @@ void EntityExporterBase::resolveEntityReferences(Atlas::Message::Element& elemen
 	if (element.isMap()) {
 		auto entityRefI = element.asMap().find("$eid");
 		if (entityRefI != element.asMap().end() && entityRefI->second.isString()) {
-			auto I = mIdMapping.find(entityRefI->second.asString());
-			if (I != mIdMapping.end()) {
-				entityRefI->second = I->second;
+			if (mStreamWriter) {
+				//The referred entity might not have been received yet, so make sure it has an id.
+				entityRefI->second = assignPersistedId(entityRefI->second.asString());
+			} else {
+				auto I = mIdMapping.find(entityRefI->second.asString());
+				if (I != mIdMapping.end()) {
+					entityRefI->second = I->second;
+				}
 			}
 		}
 		//If it's a map we need to process all child elements too
@@ -479,22 +598,8 @@ void EntityExporterBase::resolveEntityReferences(Atlas::Message::Element& elemen
 	}
 }
 
-void EntityExporterBase::complete()
+Atlas::Message::MapType EntityExporterBase::createMeta()
 {
-
-	adjustReferencedEntities();
-
-	//Make sure the minds are stored in a deterministic fashion
-	std::sort(mMinds.begin(), mMinds.end(), [](Atlas::Message::Element const & a, Atlas::Message::Element const &b) {
-		return integerId(a.asMap().find("id")->second.asString()) < integerId(b.asMap().find("id")->second.asString());
-	});
-
-	//Make sure the rules are stored in a deterministic fashion
-	std::sort(mRules.begin(), mRules.end(), [](Atlas::Message::Element const & a, Atlas::Message::Element const &b) {
-		return a.asMap().find("id")->second.asString() < b.asMap().find("id")->second.asString();
-	});
-
-	Anonymous root;
 	Atlas::Message::MapType meta;
 
 	meta["name"] = mName;
@@ -507,31 +612,64 @@ void EntityExporterBase::complete()
 	fillWithServerData(server);
 
 	meta["server"] = server;
+	return meta;
+}
 
-	root->setAttr("meta", meta);
+void EntityExporterBase::complete()
+{
 
-	root->setAttr("entities", mEntities);
-	root->setAttr("minds", mMinds);
-	if (!mRules.empty()) {
-		root->setAttr("rules", mRules);
-	}
+	adjustReferencedMinds();
 
-	std::fstream filestream(mFilename, std::ios::out);
-	Atlas::Message::QueuedDecoder decoder;
-	Atlas::Codecs::XML codec(filestream, filestream, decoder);
-	std::unique_ptr<Atlas::Formatter> formatter(createMultiLineFormatter(filestream, codec));
+	//Make sure the minds are stored in a deterministic fashion
+	std::sort(mMinds.begin(), mMinds.end(), [](Atlas::Message::Element const & a, Atlas::Message::Element const &b) {
+		return integerId(a.asMap().find("id")->second.asString()) < integerId(b.asMap().find("id")->second.asString());
+	});
+
+	if (mStreamWriter) {
+		//The entities and rules have already been written; all that's left is to close the entities list and add the minds.
+		auto& writer = *mStreamWriter;
+		writer.bridge->listEnd();
+		writer.encoder->mapElementListItem("minds", mMinds);
+		writer.bridge->mapEnd();
+		writer.bridge->streamEnd();
+		writer.stream.close();
+		mStreamWriter.reset();
+	} else {
+		adjustReferencedEntities();
+
+		//Make sure the rules are stored in a deterministic fashion
+		std::sort(mRules.begin(), mRules.end(), [](Atlas::Message::Element const & a, Atlas::Message::Element const &b) {
+			return a.asMap().find("id")->second.asString() < b.asMap().find("id")->second.asString();
+		});
+
+		Anonymous root;
+
+		root->setAttr("meta", createMeta());
 
-	Atlas::Objects::ObjectsEncoder encoder(*formatter);
+		root->setAttr("entities", mEntities);
+		root->setAttr("minds", mMinds);
+		if (!mRules.empty()) {
+			root->setAttr("rules", mRules);
+		}
+
+		std::fstream filestream(mFilename, std::ios::out);
+		Atlas::Message::QueuedDecoder decoder;
+		Atlas::Codecs::XML codec(filestream, filestream, decoder);
+		std::unique_ptr<Atlas::Formatter> formatter(createMultiLineFormatter(filestream, codec));
 
-	encoder.streamBegin();
-	encoder.streamObjectsMessage(root);
-	encoder.streamEnd();
+		Atlas::Objects::ObjectsEncoder encoder(*formatter);
 
-	filestream.close();
+		encoder.streamBegin();
+		encoder.streamObjectsMessage(root);
+		encoder.streamEnd();
+
+		filestream.close();
+	}
 
 	//Clear the lists to release the memory allocated
 	mEntities.clear();
 	mMinds.clear();
+	mRules.clear();
 
 	mComplete = true;
 	EventCompleted.emit();
@@ -561,28 +699,71 @@ void EntityExporterBase::start(const std::string& filename, const std::string& e
 
 void EntityExporterBase::startRequestingEntities()
 {
+	if (mStreaming && !startStreaming()) {
+		cancel();
+		return;
+	}
+
 	// Send a get for the requested root entity
-	mOutstandingGetRequestCounter++;
-	Get get;
+	mEntityRequestStart = std::chrono::steady_clock::now();
+	requestEntity(mRootEntityId);
+	EventProgress.emit();
+}
 
-	Anonymous get_arg;
-	get_arg->setObjtype("obj");
-	get_arg->setId(mRootEntityId);
-	get->setArgs1(get_arg);
+bool EntityExporterBase::startStreaming()
+{
+	mStreamWriter.reset(new StreamWriter());
+	auto& writer = *mStreamWriter;
+	writer.stream.open(mFilename, std::ios::out);
+	if (!writer.stream.is_open()) {
+		S_LOG_FAILURE("Could not open file '" << mFilename << "' for writing.");
+		mStreamWriter.reset();
+		return false;
+	}
 
-	get->setFrom(mAccountId);
-	get->setSerialno(newSerialNumber());
+	if (mFormat == PACKED) {
+		writer.codec.reset(new Atlas::Codecs::Packed(writer.stream, writer.stream, writer.decoder));
+		writer.bridge = writer.codec.get();
+	} else {
+		writer.codec.reset(new Atlas::Codecs::XML(writer.stream, writer.stream, writer.decoder));
+		writer.formatter.reset(createMultiLineFormatter(writer.stream, *writer.codec));
+		writer.bridge = writer.formatter.get();
+	}
+	writer.encoder.reset(new Atlas::Message::Encoder(*writer.bridge));
 
-	sigc::slot<void, const Operation&> slot = sigc::mem_fun(*this, &EntityExporterBase::operationGetResult);
-	sendAndAwaitResponse(get, slot);
+	writer.bridge->streamBegin();
+	writer.bridge->streamMessage();
 
-	mStats.entitiesQueried++;
-	EventProgress.emit();
+	auto meta = createMeta();
+	meta["streamed"] = 1;
+	writer.encoder->mapElementMapItem("meta", meta);
+
+	//All rules have been received before any entities are requested, so they can be written now.
+	if (!mRules.empty()) {
+		std::sort(mRules.begin(), mRules.end(), [](Atlas::Message::Element const & a, Atlas::Message::Element const &b) {
+			return a.asMap().find("id")->second.asString() < b.asMap().find("id")->second.asString();
+		});
+		writer.encoder->mapElementListItem("rules", mRules);
+		mRules.clear();
+	}
+
+	writer.bridge->mapListItem("entities");
+	return true;
 }
 
 void EntityExporterBase::operationGetResult(const Operation & op)
 {
 	mOutstandingGetRequestCounter--;
+	auto I = mEntityGetsInFlight.find(op->getRefno());
+	if (I != mEntityGetsInFlight.end()) {
+		//Errors and timeouts (signalled by an empty root operation) are signs that the server can't keep up.
+		if (op->getClassNo() == Atlas::Objects::Operation::INFO_NO) {
+			mEntityWindow.completed(std::chrono::steady_clock::now() - I->second);
+		} else {
+			mEntityWindow.failed();
+		}
+		mEntityGetsInFlight.erase(I);
+	}
 	if (!mCancelled) {
 		if (op->getClassNo() == Atlas::Objects::Operation::INFO_NO) {
 			infoArrived(op);
@@ -602,7 +783,8 @@ void EntityExporterBase::operationGetResult(const Operation & op)
 			S_LOG_WARNING("Got unexpected response on a GET request with operation of type " << op->getParent());
 			S_LOG_WARNING("Error message: " << errorMessage);
 			mStats.entitiesError++;
-			EventProgress.emit();
+			//Make sure the next entities are requested even though this one failed.
+			pollQueue();
 		}
 	}
 }
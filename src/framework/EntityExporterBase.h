@@ -23,10 +23,13 @@
 #include <Atlas/Message/Element.h>
 #include <Atlas/Formatter.h>
 
+#include "OperationWindow.h"
+
 #include <sigc++/trackable.h>
 #include <sigc++/signal.h>
 #include <sigc++/slot.h>
 
+#include <chrono>
 #include <list>
 #include <vector>
 #include <fstream>
@@ -87,6 +90,12 @@ class Element;
  *  <map>
  * </atlas>
  *
+ * By default all entities are kept in memory until the export is complete, and then written in one go.
+ * For large worlds streaming can be enabled instead (see setStreaming()), in which case each entity is written
+ * to the file as soon as it's received from the server. Since the contained entities aren't known when an entity is
+ * written, a streamed dump has no "contains" attributes; instead each entity except the top one has a "loc" attribute
+ * referring to its parent, which always appears before it in the "entities" list. Streamed dumps are marked by
+ * a "streamed" attribute in the "meta" map, and can also be written using the more compact Packed encoding.
  *
  * This is an abstract class which only relies on Atlas and C++ std.
  * It's meant to be extended with a subclass which implements the various abstract methods.
@@ -140,6 +149,42 @@ public:
 		 * @brief The number of rules queried.
 		 */
 		unsigned int rulesError;
+		/**
+		 * @brief The number of entity get requests currently awaiting a response from the server.
+		 */
+		unsigned int entityGetsInFlight;
+		/**
+		 * @brief The number of entity get requests which currently may be in flight, as adjusted to the responsiveness of the server.
+		 */
+		unsigned int entityGetsWindow;
+		/**
+		 * @brief The highest number of entity get requests which have been in flight at once.
+		 */
+		unsigned int entityGetsInFlightPeak;
+		/**
+		 * @brief The smoothed round trip time of entity get requests, in microseconds.
+		 */
+		unsigned int entityGetsRoundTrip;
+		/**
+		 * @brief The number of entities received per second, since the entities started being requested.
+		 */
+		float entitiesPerSecond;
+	};
+
+	/**
+	 * @brief The encodings which can be used for the dump.
+	 */
+	enum Format
+	{
+		/**
+		 * @brief Human readable XML.
+		 */
+		XML,
+		/**
+		 * @brief The Atlas Packed encoding, which is more compact and faster to read.
+		 * Only available when streaming.
+		 */
+		PACKED
 	};
 
 	/**
@@ -237,6 +282,48 @@ public:
      */
     bool getExportMinds() const;
 
+	/**
+	 * @brief Sets the max number of entity get requests which may be in flight at once.
+	 *
+	 * The number actually in flight is adapted to how responsive the server is, but will never be more than this.
+	 * @param maxOpsInFlight The max number of requests in flight. Must be at least 1.
+	 */
+	void setMaxOpsInFlight(unsigned int maxOpsInFlight);
+
+	/**
+	 * @brief Gets the max number of entity get requests which may be in flight at once.
+	 * @return The max number of requests in flight.
+	 */
+	unsigned int getMaxOpsInFlight() const;
+
+	/**
+	 * @brief Sets whether entities should be written to the file as they are received, instead of being kept in memory until the export is complete.
+	 *
+	 * Call this before you call start().
+	 * @param streaming Whether entities should be streamed.
+	 */
+	void setStreaming(bool streaming);
+
+	/**
+	 * @brief Gets whether entities are written to the file as they are received.
+	 * @return Whether entities are streamed.
+	 */
+	bool getStreaming() const;
+
+	/**
+	 * @brief Sets the encoding of the dump.
+	 *
+	 * Call this before you call start(). Dumps which aren't streamed are always written as XML.
+	 * @param format The encoding.
+	 */
+	void setFormat(Format format);
+
+	/**
+	 * @brief Gets the encoding of the dump.
+	 * @return The encoding.
+	 */
+	Format getFormat() const;
+
 	/**
 	 * @brief Gets stats about the export process.
 	 * @return Stats about the process.
@@ -338,6 +425,21 @@ protected:
 	 */
 	size_t mOutstandingGetRequestCounter;
 
+	/**
+	 * @brief Limits the number of entity get requests in flight.
+	 */
+	OperationWindow mEntityWindow;
+
+	/**
+	 * @brief When each outstanding entity get request was sent, keyed by serial number.
+	 */
+	std::unordered_map<long, std::chrono::steady_clock::time_point> mEntityGetsInFlight;
+
+	/**
+	 * @brief When we started requesting entities, used for the throughput stats.
+	 */
+	std::chrono::steady_clock::time_point mEntityRequestStart;
+
 	/**
 	 * @brief True if we should also export transient entities.
 	 * Default is "false" (as if an entity is marked as transient it's not meant to be persisted).
@@ -374,11 +476,73 @@ protected:
      */
     std::unordered_set<std::string> mMindTypes;
 
+	/**
+	 * @brief True if entities should be written as they are received.
+	 */
+	bool mStreaming;
+
+	/**
+	 * @brief The encoding of the dump.
+	 */
+	Format mFormat;
+
+	/**
+	 * @brief The next id to use for entities when ids aren't preserved.
+	 */
+	size_t mPersistedIdCounter;
+
+	struct StreamWriter;
+
+	/**
+	 * @brief Writes the dump as entities arrive, when streaming.
+	 */
+	std::unique_ptr<StreamWriter> mStreamWriter;
+
     /**
 	 * @brief Starts the process of requesting entities and walking the entity hierarchy.
 	 */
 	void startRequestingEntities();
 
+	/**
+	 * @brief Sends a get request for an entity.
+	 * @param entityId The id of the entity.
+	 */
+	void requestEntity(const std::string& entityId);
+
+	/**
+	 * @brief Updates the throughput stats.
+	 */
+	void updateEntityStats();
+
+	/**
+	 * @brief Opens the file and writes everything which goes before the entities.
+	 * @return False if the file couldn't be opened.
+	 */
+	bool startStreaming();
+
+	/**
+	 * @brief Writes an entity to the file, when streaming.
+	 * @param ent The entity as received from the server.
+	 * @return The persisted id of the entity.
+	 */
+	std::string streamEntity(const Atlas::Objects::Entity::RootEntity& ent);
+
+	/**
+	 * @brief Gets the persisted id of an entity when streaming, assigning a new one if needed.
+	 *
+	 * Since entities are written before all other entities are known, ids are assigned as soon as an entity
+	 * is referred to, either as the parent of another entity or from an entity reference attribute.
+	 * @param entityId The id of the entity on the server.
+	 * @return The persisted id of the entity.
+	 */
+	std::string assignPersistedId(const std::string& entityId);
+
+	/**
+	 * @brief Creates the "meta" map of the dump.
+	 * @return The meta data.
+	 */
+	Atlas::Message::MapType createMeta();
+
 	void dumpRule(const Atlas::Objects::Entity::RootEntity& ent);
 	void dumpEntity(const Atlas::Objects::Entity::RootEntity& ent);
 	void dumpMind(const std::string& entityId, const Operation & op);
@@ -405,11 +569,19 @@ protected:
 	void complete();
 
 	/**
-	 * @brief Adjusts entity references.
+	 * @brief Adjusts entity references in minds.
 	 *
 	 * If mPreserveIds is set to false then new ids will be generated for all entities.
 	 * We then need to also make sure that any references in minds are updated to use the new ids.
 	 */
+	void adjustReferencedMinds();
+
+	/**
+	 * @brief Adjusts entity references in entities.
+	 *
+	 * This updates the contains lists to use the new ids, culling any entities which weren't exported,
+	 * as well as any entity reference attributes.
+	 */
 	void adjustReferencedEntities();
 
     /**
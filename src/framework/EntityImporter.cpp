@@ -19,6 +19,7 @@
 #include "EntityImporter.h"
 
 #include "AtlasObjectDecoder.h"
+#include "EntityDumpReader.h"
 #include "LoggingInstance.h"
 #include "osdir.h"
 #include <Atlas/Codecs/XML.h>
@@ -102,19 +103,17 @@ std::vector<EntityImporter::ShortInfo> EntityImporter::getInfoFromDirectory(cons
 				ShortInfo info;
 
 				std::fstream fileStream(directoryPath + "/" + filename, std::ios::in);
-				AtlasObjectDecoder atlasLoader;
-
-				Atlas::Codecs::XML codec(fileStream, fileStream, atlasLoader);
-				codec.poll(true);
-
-				auto rootObj = atlasLoader.getLastObject();
-
-				if (!rootObj.isValid()) {
+				//Only the sections are kept when reading, so this works for large dumps too.
+				EntityDumpReader reader(fileStream);
+				if (!reader.readUntilEntities()) {
 					continue;
 				}
-				Atlas::Message::Element metaElem;
-				if (rootObj->copyAttr("meta", metaElem) == 0 && metaElem.isMap()) {
-					auto meta = metaElem.asMap();
+				reader.readToEnd();
+
+				auto& sections = reader.getSections();
+				auto metaI = sections.find("meta");
+				if (metaI != sections.end() && metaI->second.isMap()) {
+					auto meta = metaI->second.asMap();
 					info.filename = directoryPath + "/" + filename;
 					if (meta["name"].isString() && meta["name"] != "") {
 						info.name = meta["name"].asString();
@@ -125,15 +124,14 @@ std::vector<EntityImporter::ShortInfo> EntityImporter::getInfoFromDirectory(cons
 						info.description = meta["description"].asString();
 					}
 
-					Atlas::Message::Element entitiesElem;
-					if (rootObj->copyAttr("entities", entitiesElem) == 0 && entitiesElem.isList()) {
-						info.entityCount = entitiesElem.asList().size();
-					}
-					if (rootObj->copyAttr("rules", entitiesElem) == 0 && entitiesElem.isList()) {
-						info.rulesCount = entitiesElem.asList().size();
+					info.entityCount = reader.getEntityCount();
+					auto rulesI = sections.find("rules");
+					if (rulesI != sections.end() && rulesI->second.isList()) {
+						info.rulesCount = rulesI->second.asList().size();
 					}
-					if (rootObj->copyAttr("minds", entitiesElem) == 0 && entitiesElem.isList()) {
-						info.mindsCount = entitiesElem.asList().size();
+					auto mindsI = sections.find("minds");
+					if (mindsI != sections.end() && mindsI->second.isList()) {
+						info.mindsCount = mindsI->second.asList().size();
 					}
 					infos.push_back(info);
 				}
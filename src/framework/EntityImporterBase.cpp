@@ -18,11 +18,14 @@
 
 #include "EntityImporterBase.h"
 
+#include "EntityDumpReader.h"
 #include "LoggingInstance.h"
 
 #include <Atlas/Objects/Anonymous.h>
 #include <Atlas/Objects/Operation.h>
 
+#include <sigc++/bind.h>
+
 #include <fstream>
 
 using Atlas::Objects::Root;
@@ -35,20 +38,17 @@ using Atlas::Objects::Operation::Look;
 using Atlas::Objects::Operation::Set;
 using Atlas::Message::Element;
 
-StackEntry::StackEntry(const Atlas::Objects::Entity::RootEntity & o, const std::list<std::string>::const_iterator & c) :
-		obj(o), currentChildIterator(c)
+namespace
 {
+/**
+ * @brief The max number of parked entities before we stop reading more from a streamed dump, and wait for their parents to be walked.
+ */
+const size_t MAX_PARKED_ENTITIES = 10000;
 }
 
-StackEntry::StackEntry(const Atlas::Objects::Entity::RootEntity & o) :
-		obj(o)
+bool EntityImporterBase::getEntity(const std::string & id, const std::string & loc)
 {
-	currentChildIterator = obj->getContains().end();
-}
-
-bool EntityImporterBase::getEntity(const std::string & id, OpVector & res)
-{
-	std::map<std::string, Root>::const_iterator I = mPersistedEntities.find(id);
+	auto I = mPersistedEntities.find(id);
 	if (I == mPersistedEntities.end()) {
 		S_LOG_VERBOSE("Could not find entity with id " << id << "; this one was probably transient.");
 		//This will often happen if the child entity was transient, and therefore wasn't exported (but is still references from the parent entity).
@@ -59,9 +59,17 @@ bool EntityImporterBase::getEntity(const std::string & id, OpVector & res)
 		S_LOG_FAILURE("Corrupt dump - non entity found " << id << ".");
 		return false;
 	}
+	if (mEntitiesInFlight.find(id) != mEntitiesInFlight.end()) {
+		S_LOG_FAILURE("Corrupt dump - entity " << id << " is contained in more than one entity.");
+		return false;
+	}
 
-	m_state = ENTITY_WALKING;
-	mTreeStack.emplace_back(obj);
+	EntityWalkEntry& entry = mEntitiesInFlight[id];
+	entry.state = EntityWalkEntry::GETTING;
+	entry.obj = obj;
+	entry.loc = loc;
+	//The entity is kept in the walk entry from now on.
+	mPersistedEntities.erase(I);
 
 	Anonymous get_arg;
 	get_arg->setId(id);
@@ -71,11 +79,55 @@ bool EntityImporterBase::getEntity(const std::string & id, OpVector & res)
 	get->setArgs1(get_arg);
 	get->setFrom(mAccountId);
 	get->setSerialno(newSerialNumber());
-	res.push_back(get);
 	S_LOG_VERBOSE("EntityImporterBase: Getting entity with id " << id);
+	sendEntityOperation(id, entry, get);
 	return true;
 }
 
+void EntityImporterBase::sendEntityOperation(const std::string& id, EntityWalkEntry& entry, const Operation& op)
+{
+	entry.serialno = op->getSerialno();
+	entry.sent = std::chrono::steady_clock::now();
+	mEntityWindow.sent();
+
+	sigc::slot<void, const Operation&> slot = sigc::bind(sigc::mem_fun(*this, &EntityImporterBase::operationEntityResult), id);
+	sendAndAwaitResponse(op, slot);
+}
+
+void EntityImporterBase::queueChildEntities(const std::string& id, const RootEntity& obj, const std::string& restoredId)
+{
+	//Note that there might be a reference to an entity in CONTAINS which can't be found
+	//in the list of entities; this happens with transient entities, and is handled in getEntity().
+	for (auto& child : obj->getContains()) {
+		mEntityWalkQueue.emplace_back(child, restoredId);
+	}
+	//Entities in streamed dumps instead refer to their parent, and might have been read before the parent was walked.
+	auto I = mParkedEntities.find(id);
+	if (I != mParkedEntities.end()) {
+		for (auto& child : I->second) {
+			mEntityWalkQueue.emplace_back(child, restoredId);
+		}
+		mParkedEntitiesCount -= I->second.size();
+		mParkedEntities.erase(I);
+	}
+}
+
+void EntityImporterBase::entityFailed(const std::string& id)
+{
+	mFailedEntities.insert(id);
+	auto I = mParkedEntities.find(id);
+	if (I != mParkedEntities.end()) {
+		auto children = std::move(I->second);
+		mParkedEntitiesCount -= children.size();
+		mParkedEntities.erase(I);
+		for (auto& child : children) {
+			mPersistedEntities.erase(child);
+			mEntitiesWithReferenceAttributes.erase(child);
+			entityFailed(child);
+		}
+	}
+}
+
 void EntityImporterBase::extractChildren(const Root& op, std::list<std::string>& children)
 {
 	Element childElem;
@@ -165,47 +217,121 @@ void EntityImporterBase::walkRules(OpVector & res)
 	}
 }
 
-void EntityImporterBase::walkEntities(OpVector & res)
+void EntityImporterBase::walkEntities()
 {
-	if (mTreeStack.empty()) {
+	//Since siblings don't depend on each other we can send ops for all entities whose parent has been resolved, as long as the window allows.
+	while (mEntityWindow.canSend()) {
+		if (!mEntityWalkQueue.empty()) {
+			auto entry = mEntityWalkQueue.front();
+			mEntityWalkQueue.pop_front();
+			getEntity(entry.first, entry.second);
+		} else if (mEntityReader && (mParkedEntitiesCount < MAX_PARKED_ENTITIES || mEntitiesInFlight.empty())) {
+			//Don't read too far ahead of the walk when streaming, since parked entities are kept in memory.
+			readStreamedEntity();
+		} else {
+			break;
+		}
+	}
+	updateEntityStats();
+
+	if (mEntityWalkQueue.empty() && mEntitiesInFlight.empty() && !mEntityReader) {
+		if (mParkedEntitiesCount > 0) {
+			S_LOG_WARNING("Skipping " << mParkedEntitiesCount << " entities whose parent entities couldn't be found in the dump.");
+			mParkedEntities.clear();
+			mParkedEntitiesCount = 0;
+		}
+		S_LOG_VERBOSE("Done walking entities, peak ops in flight: " << mStats.entityOpsInFlightPeak << ", entities per second: " << mStats.entitiesPerSecond);
+		resolveMinds();
 		sendResolvedEntityReferences();
-	} else {
-		StackEntry & current = mTreeStack.back();
-		//Check if there are any children. If not, we should pop the stack and
-		if (current.obj->getContains().empty()) {
-			// Pop: Go back to WALKING parent
-			assert(!mTreeStack.empty());
-			mTreeStack.pop_back();
-			while (!mTreeStack.empty()) {
-				StackEntry & se = mTreeStack.back();
-				//Try to get the next child entity (unless we've reached the end of the list of children).
-				//Since some entities are references but not persisted we need to loop until we find one that we know of.
-				for (; ++se.currentChildIterator, se.currentChildIterator != se.obj->getContains().end();) {
-					if (getEntity(*se.currentChildIterator, res)) {
-						//We've sent a request for an entity; we should break out and await a response from the server.
-						return;
-					}
-				}
+	}
+}
 
-				//If we've reached the end of the contained entities we should pop the current stack entry.
-				mTreeStack.pop_back();
-			}
+void EntityImporterBase::readStreamedEntity()
+{
+	Atlas::Message::MapType entityMap;
+	if (!mEntityReader->readEntity(entityMap)) {
+		//All entities have been read; the minds come after them.
+		mEntityReader->readToEnd();
+		auto& sections = mEntityReader->getSections();
+		auto mindsI = sections.find("minds");
+		if (mindsI != sections.end()) {
+			readMinds(mindsI->second);
+		}
+		mStats.mindsCount = static_cast<unsigned int>(mPersistedMinds.size());
+		S_LOG_INFO("Done reading streamed dump. Number of entities: " << mStats.entitiesCount << " Number of minds: " << mPersistedMinds.size());
+		mEntityReader.reset();
+		mEntityStream.reset();
+		return;
+	}
+
+	auto object = Atlas::Objects::Factories::instance()->createObject(entityMap);
+	if (!object.isValid() || object->isDefaultId()) {
+		return;
+	}
+	const std::string id = object->getId();
+	mStats.entitiesCount++;
+
+	std::string parentId;
+	auto locI = entityMap.find("loc");
+	if (locI != entityMap.end() && locI->second.isString()) {
+		parentId = locI->second.asString();
+	}
+
+	if (parentId.empty()) {
+		if (id != mRootEntityId) {
+			S_LOG_WARNING("Entity " << id << " has no parent, but isn't the top level entity; skipping it and all of its children.");
+			entityFailed(id);
+			return;
+		}
+	} else if (mFailedEntities.find(parentId) != mFailedEntities.end()) {
+		entityFailed(id);
+		return;
+	}
+
+	registerEntityReferences(id, entityMap);
+	//If we should resume the world, check if the world has a "suspended" property, and disable it if so.
+	if (mResumeWorld && id == "0" && object->hasAttr("suspended")) {
+		object->setAttr("suspended", 0);
+		S_LOG_INFO("Resuming suspended world.");
+	}
+	mPersistedEntities.insert(std::make_pair(id, object));
+
+	if (parentId.empty()) {
+		mEntityWalkQueue.emplace_back(id, "");
+	} else {
+		auto I = mEntityIdMap.find(parentId);
+		if (I != mEntityIdMap.end()) {
+			mEntityWalkQueue.emplace_back(id, I->second);
 		} else {
-			//Iterate until we find an entity that's persisted.
-			//Note that there might be a reference to an entity in CONTAINS which can't be found
-			//in the list of entities; this happens with transient entities.
-			for (auto I = current.obj->getContains().begin(); I != current.obj->getContains().end(); ++I) {
-				current.currentChildIterator = I;
-				bool foundEntity = getEntity(*current.currentChildIterator, res);
-				if (foundEntity) {
-					return;
-				}
-			}
+			mParkedEntities[parentId].push_back(id);
+			mParkedEntitiesCount++;
 		}
-		if (mTreeStack.empty()) {
-			sendResolvedEntityReferences();
+	}
+}
+
+void EntityImporterBase::updateEntityStats()
+{
+	mStats.entityOpsInFlight = static_cast<unsigned int>(mEntityWindow.getInFlight());
+	mStats.entityOpsWindow = static_cast<unsigned int>(mEntityWindow.getSize());
+	mStats.entityOpsInFlightPeak = static_cast<unsigned int>(mEntityWindow.getPeakInFlight());
+	mStats.entityOpsRoundTrip = static_cast<unsigned int>(mEntityWindow.getRoundTripTime().count());
+	auto elapsed = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::steady_clock::now() - mEntityWalkStart).count();
+	if (elapsed > 0) {
+		mStats.entitiesPerSecond = mStats.entitiesProcessedCount / elapsed;
+	}
+}
+
+void EntityImporterBase::resolveMinds()
+{
+	for (auto& mind : mPersistedMinds) {
+		auto I = mEntityIdMap.find(mind.first);
+		if (I != mEntityIdMap.end()) {
+			mResolvedMindMapping.emplace_back(I->second, mind.second);
+		} else {
+			S_LOG_VERBOSE("Could not find restored entity for mind of persisted entity " << mind.first << ".");
 		}
 	}
+	mPersistedMinds.clear();
 }
 
 void EntityImporterBase::sendMinds()
@@ -327,9 +453,9 @@ void EntityImporterBase::sendMinds()
 void EntityImporterBase::sendResolvedEntityReferences()
 {
 	if (!mEntitiesWithReferenceAttributes.empty()) {
-		for (auto entryI : mEntitiesWithReferenceAttributes) {
+		for (auto& entryI : mEntitiesWithReferenceAttributes) {
 			const auto& persistedEntityId = entryI.first;
-			const auto& attributeNames = entryI.second;
+			const auto& attributes = entryI.second;
 
 			auto createdEntityI = mEntityIdMap.find(persistedEntityId);
 			if (createdEntityI == mEntityIdMap.end()) {
@@ -338,15 +464,12 @@ void EntityImporterBase::sendResolvedEntityReferences()
 			}
 			const auto& createdEntityId = createdEntityI->second;
 
-			//This should not fail at this phase, so we're not doing any checks.
-			auto& persistedEntity = mPersistedEntities.find(persistedEntityId)->second;
-
 			RootEntity entity;
 
-			for (const auto& attributeName : attributeNames) {
-				Element element = persistedEntity->getAttr(attributeName);
+			for (const auto& attribute : attributes) {
+				Element element = attribute.second;
 				resolveEntityReferences(element);
-				entity->setAttr(attributeName, element);
+				entity->setAttr(attribute.first, element);
 			}
 
 			Set set;
@@ -393,34 +516,30 @@ void EntityImporterBase::complete()
 	EventCompleted.emit();
 }
 
-void EntityImporterBase::createEntity(const RootEntity & obj, OpVector & res)
+void EntityImporterBase::createEntity(const std::string& id, EntityWalkEntry& entry)
 {
 	++mStats.entitiesProcessedCount;
 	++mStats.entitiesCreateCount;
 	EventProgress.emit();
 
-	m_state = ENTITY_CREATING;
+	entry.state = EntityWalkEntry::CREATING;
 
-	assert(mTreeStack.size() > 1);
-	std::deque<StackEntry>::reverse_iterator I = mTreeStack.rbegin();
-	++I;
-	assert(I != mTreeStack.rend());
-	const std::string & loc = I->restored_id;
+	assert(!entry.loc.empty());
 
-	RootEntity create_arg = obj.copy();
+	RootEntity create_arg = entry.obj.copy();
 
 	create_arg->removeAttrFlag(Atlas::Objects::Entity::CONTAINS_FLAG);
 	create_arg->removeAttrFlag(Atlas::Objects::Entity::VELOCITY_FLAG);
 	create_arg->removeAttrFlag(Atlas::Objects::ID_FLAG);
-	create_arg->setLoc(loc);
+	create_arg->setLoc(entry.loc);
 
 	//Remove any attribute which references another entity from the Create op.
 	//This is because the attribute will at this time with certainty refer to the wrong or a non-existing entity.
 	//The attribute will later on be set through a Set op in sendResolvedEntityReferences().
-	auto referenceMapEntryI = mEntitiesWithReferenceAttributes.find(obj->getId());
+	auto referenceMapEntryI = mEntitiesWithReferenceAttributes.find(id);
 	if (referenceMapEntryI != mEntitiesWithReferenceAttributes.end()) {
-		for (const auto& attributeName : referenceMapEntryI->second) {
-			create_arg->removeAttr(attributeName);
+		for (const auto& attribute : referenceMapEntryI->second) {
+			create_arg->removeAttr(attribute.first);
 		}
 	}
 
@@ -429,9 +548,38 @@ void EntityImporterBase::createEntity(const RootEntity & obj, OpVector & res)
 	create->setFrom(mAvatarId);
 	create->setSerialno(newSerialNumber());
 
-	mCreateEntityMapping.insert(std::make_pair(create->getSerialno(), obj->getId()));
+	sendEntityOperation(id, entry, create);
+}
+
+void EntityImporterBase::updateEntity(const std::string& id, EntityWalkEntry& entry, const std::string& restoredId)
+{
+	const RootEntity& obj = entry.obj;
+	Root update = obj.copy();
+
+	S_LOG_VERBOSE("Updating: " << obj->getId() << " ," << obj->getParent());
+
+	update->removeAttrFlag(Atlas::Objects::Entity::CONTAINS_FLAG);
+	update->removeAttrFlag(Atlas::Objects::Entity::LOC_FLAG);
+	update->removeAttrFlag(Atlas::Objects::STAMP_FLAG);
+
+	Set set;
+	set->setArgs1(update);
+	set->setFrom(mAvatarId);
+	set->setTo(restoredId);
+	set->setSerialno(newSerialNumber());
 
-	res.push_back(create);
+	//The entity keeps its id, which is needed both for any children and for minds.
+	mEntityIdMap.insert(std::make_pair(id, restoredId));
+
+	++mStats.entitiesProcessedCount;
+	++mStats.entitiesUpdateCount;
+	EventProgress.emit();
+
+	entry.state = EntityWalkEntry::UPDATING;
+	sendEntityOperation(id, entry, set);
+
+	//The id of the entity won't change, so there's no need to wait for the update before handling the children.
+	queueChildEntities(id, obj, restoredId);
 }
 
 void EntityImporterBase::createRule(const Atlas::Objects::Root & obj, OpVector & res)
@@ -545,41 +693,6 @@ void EntityImporterBase::errorArrived(const Operation & op, OpVector & res)
 		walkRules(res);
 	}
 		break;
-	case ENTITY_WALKING:
-	{
-		//An error here just means that the entity we asked for didn't exist on the server, and we need
-		//to create it. This is an expected result.
-		assert(!mTreeStack.empty());
-		StackEntry & current = mTreeStack.back();
-		const RootEntity& obj = current.obj;
-
-		assert(obj.isValid());
-
-		createEntity(obj, res);
-	}
-		break;
-	case ENTITY_CREATING:
-	{
-		//An error here means that something went wrong when trying to create an entity. This is wrong.
-		//It probably means that there's something wrong with the data we're sending. Either the
-		//persisted data is corrupt, or there have been changes on the server (for example entity types
-		//renamed or removed).
-		std::string entityType = "unknown";
-
-		auto I = mCreateEntityMapping.find(op->getRefno());
-		if (I != mCreateEntityMapping.end()) {
-			auto J = mPersistedEntities.find(I->second);
-			if (J != mPersistedEntities.end()) {
-				auto& entity = J->second;
-				entityType = entity->getParent();
-			}
-		}
-		S_LOG_FAILURE("Could not create entity of type '" << entityType << "', continuing with next. Server message: " << errorMessage);
-		mStats.entitiesCreateErrorCount++;
-		EventProgress.emit();
-		walkEntities(res);
-	}
-		break;
 	default:
 		S_LOG_FAILURE("Unexpected state in state machine. Server message: " << errorMessage);
 		break;
@@ -616,78 +729,6 @@ void EntityImporterBase::infoArrived(const Operation & op, OpVector & res)
 		mStats.rulesUpdateCount++;
 		EventProgress.emit();
 		walkRules(res);
-	} else if (m_state == ENTITY_CREATING) {
-		if (!op.isValid()) {
-			return;
-		}
-		mNewIds.insert(arg->getId());
-		StackEntry & current = mTreeStack.back();
-		current.restored_id = arg->getId();
-		S_LOG_VERBOSE("Created: " << arg->getParent() << "(" << arg->getId() << ")");
-
-		auto I = mCreateEntityMapping.find(op->getRefno());
-		if (I != mCreateEntityMapping.end()) {
-			//Check if there's a mind that we should send further on
-			auto mindI = mPersistedMinds.find(I->second);
-			if (mindI != mPersistedMinds.end()) {
-				mResolvedMindMapping.emplace_back(arg->getId(), mindI->second);
-			}
-			mEntityIdMap.insert(std::make_pair(I->second, arg->getId()));
-			mCreateEntityMapping.erase(op->getRefno());
-		} else {
-			S_LOG_WARNING("Got info about create for an entity which we didn't seem to have sent.");
-		}
-
-		walkEntities(res);
-	} else if (m_state == ENTITY_WALKING) {
-		const RootEntity& ent = smart_dynamic_cast<RootEntity>(arg);
-		if (!ent.isValid()) {
-			S_LOG_FAILURE("Info response is not entity.");
-			return;
-		}
-		if (arg->isDefaultId()) {
-			S_LOG_FAILURE("Corrupted info response: no id.");
-		}
-		const std::string & id = arg->getId();
-
-		StackEntry & current = mTreeStack.back();
-		const RootEntity& obj = current.obj;
-
-		assert(id == obj->getId());
-
-		if (mNewIds.find(id) != mNewIds.end() || (mTreeStack.size() != 1 && ent->isDefaultLoc()) || ent->getParent() != obj->getParent()) {
-			createEntity(obj, res);
-		} else {
-
-			Root update = obj.copy();
-
-			current.restored_id = id;
-
-			S_LOG_VERBOSE("Updating: " << obj->getId() << " ," << obj->getParent());
-
-			update->removeAttrFlag(Atlas::Objects::Entity::CONTAINS_FLAG);
-			update->removeAttrFlag(Atlas::Objects::STAMP_FLAG);
-
-			Set set;
-			set->setArgs1(update);
-			set->setFrom(mAvatarId);
-			set->setTo(id);
-			set->setSerialno(newSerialNumber());
-
-			res.push_back(set);
-
-			//Check if there's a mind, and if so put it in our map of resolved entity-to-mind mappings (since we know the entity id)
-			auto mindI = mPersistedMinds.find(obj->getId());
-			if (mindI != mPersistedMinds.end()) {
-				mResolvedMindMapping.emplace_back(obj->getId(), mindI->second);
-			}
-
-			++mStats.entitiesProcessedCount;
-			++mStats.entitiesUpdateCount;
-			EventProgress.emit();
-
-			m_state = ENTITY_UPDATING;
-		}
 	}
 }
 
@@ -708,23 +749,16 @@ void EntityImporterBase::sightArrived(const Operation & op, OpVector & res)
 			cancel();
 			return;
 		} else {
-			getEntity(arg->getId(), res);
-		}
-
-		// Expecting sight of world root
-		break;
-	case ENTITY_UPDATING:
-	{
-		const Operation& sub_op = smart_dynamic_cast<Operation>(arg);
-		if (!sub_op.isValid()) {
-			break;
-		}
-		if (sub_op->getClassNo() != Atlas::Objects::Operation::SET_NO || sub_op->getArgs().empty() || sub_op->isDefaultSerialno()) {
-			S_LOG_FAILURE("This is not our entity update response.");
-			break;
+			// Expecting sight of world root
+			m_state = ENTITY_WALKING;
+			mEntityWalkStart = std::chrono::steady_clock::now();
+			mRootEntityId = arg->getId();
+			//When streaming the top entity is queued once it's been read.
+			if (!mEntityReader) {
+				mEntityWalkQueue.emplace_back(mRootEntityId, "");
+			}
+			walkEntities();
 		}
-		walkEntities(res);
-	}
 		break;
 	default:
 		S_LOG_WARNING("Unexpected state in state machine.");
@@ -733,7 +767,7 @@ void EntityImporterBase::sightArrived(const Operation & op, OpVector & res)
 }
 
 EntityImporterBase::EntityImporterBase(const std::string& accountId, const std::string& avatarId) :
-		mAccountId(accountId), mAvatarId(avatarId), mStats( { }), m_state(INIT), mThoughtOpsInTransit(0), mSetOpsInTransit(0), mResumeWorld(0)
+		mAccountId(accountId), mAvatarId(avatarId), mStats( { }), m_state(INIT), mParkedEntitiesCount(0), mThoughtOpsInTransit(0), mSetOpsInTransit(0), mResumeWorld(0)
 {
 }
 
@@ -743,6 +777,11 @@ EntityImporterBase::~EntityImporterBase()
 
 void EntityImporterBase::start(const std::string& filename)
 {
+	//Streamed dumps are read piece by piece as the entities are walked, while any other dumps are loaded whole.
+	if (startStreamed(filename)) {
+		return;
+	}
+
 	auto factories = Atlas::Objects::Factories::instance();
 
 	auto rootObj = loadFromFile(filename);
@@ -759,22 +798,9 @@ void EntityImporterBase::start(const std::string& filename)
 	rootObj->copyAttr("entities", entitiesElem);
 	rootObj->copyAttr("minds", mindsElem);
 	if (rootObj->copyAttr("rules", rulesElem) == 0) {
-		if (!rulesElem.isList()) {
-			S_LOG_WARNING("Rules element is not list.");
+		if (!readRules(rulesElem)) {
 			EventCompleted.emit();
 			return;
-		} else {
-			for (auto& ruleMessage : rulesElem.asList()) {
-				if (ruleMessage.isMap()) {
-					auto object = factories->createObject(ruleMessage.asMap());
-					if (object.isValid()) {
-						if (!object->isDefaultId()) {
-							mPersistedRules.insert(std::make_pair(object->getId(), object));
-						}
-					}
-				}
-			}
-
 		}
 	}
 
@@ -783,8 +809,7 @@ void EntityImporterBase::start(const std::string& filename)
 		EventCompleted.emit();
 		return;
 	}
-	if (!mindsElem.isList()) {
-		S_LOG_WARNING("Minds element is not list.");
+	if (!readMinds(mindsElem)) {
 		EventCompleted.emit();
 		return;
 	}
@@ -812,16 +837,6 @@ void EntityImporterBase::start(const std::string& filename)
 			}
 		}
 	}
-	for (auto& mindMessage : mindsElem.asList()) {
-		if (mindMessage.isMap()) {
-			auto object = factories->createObject(mindMessage.asMap());
-			if (object.isValid()) {
-				if (!object->isDefaultId()) {
-					mPersistedMinds.insert(std::make_pair(object->getId(), object));
-				}
-			}
-		}
-	}
 
 	S_LOG_INFO("Starting loading of world. Number of entities: " << mPersistedEntities.size() << " Number of minds: " << mPersistedMinds.size() << " Number of rules: " << mPersistedRules.size());
 	mStats.entitiesCount = static_cast<unsigned int>(mPersistedEntities.size());
@@ -838,6 +853,92 @@ void EntityImporterBase::start(const std::string& filename)
 
 }
 
+bool EntityImporterBase::startStreamed(const std::string& filename)
+{
+	std::unique_ptr<std::fstream> stream(new std::fstream(filename, std::ios::in));
+	if (!stream->is_open()) {
+		return false;
+	}
+	std::unique_ptr<EntityDumpReader> reader(new EntityDumpReader(*stream));
+	if (!reader->readUntilEntities()) {
+		return false;
+	}
+
+	auto& sections = reader->getSections();
+	auto metaI = sections.find("meta");
+	if (metaI == sections.end() || !metaI->second.isMap()) {
+		return false;
+	}
+	auto streamedI = metaI->second.asMap().find("streamed");
+	if (streamedI == metaI->second.asMap().end() || !streamedI->second.isInt() || streamedI->second.asInt() == 0) {
+		return false;
+	}
+
+	//The rules are always written before the entities.
+	auto rulesI = sections.find("rules");
+	if (rulesI != sections.end()) {
+		if (!readRules(rulesI->second)) {
+			EventCompleted.emit();
+			return true;
+		}
+	}
+
+	mEntityStream = std::move(stream);
+	mEntityReader = std::move(reader);
+
+	S_LOG_INFO("Starting streamed loading of world. Number of rules: " << mPersistedRules.size());
+	mStats.rulesCount = static_cast<unsigned int>(mPersistedRules.size());
+
+	EventProgress.emit();
+
+	if (mPersistedRules.empty()) {
+		startEntityWalking();
+	} else {
+		startRuleWalking();
+	}
+	return true;
+}
+
+bool EntityImporterBase::readRules(const Atlas::Message::Element& rulesElem)
+{
+	if (!rulesElem.isList()) {
+		S_LOG_WARNING("Rules element is not list.");
+		return false;
+	}
+	auto factories = Atlas::Objects::Factories::instance();
+	for (auto& ruleMessage : rulesElem.asList()) {
+		if (ruleMessage.isMap()) {
+			auto object = factories->createObject(ruleMessage.asMap());
+			if (object.isValid()) {
+				if (!object->isDefaultId()) {
+					mPersistedRules.insert(std::make_pair(object->getId(), object));
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool EntityImporterBase::readMinds(const Atlas::Message::Element& mindsElem)
+{
+	if (!mindsElem.isList()) {
+		S_LOG_WARNING("Minds element is not list.");
+		return false;
+	}
+	auto factories = Atlas::Objects::Factories::instance();
+	for (auto& mindMessage : mindsElem.asList()) {
+		if (mindMessage.isMap()) {
+			auto object = factories->createObject(mindMessage.asMap());
+			if (object.isValid()) {
+				if (!object->isDefaultId()) {
+					mPersistedMinds.insert(std::make_pair(object->getId(), object));
+				}
+			}
+		}
+	}
+	return true;
+}
+
 void EntityImporterBase::registerEntityReferences(const std::string& id, const Atlas::Message::MapType& element)
 {
 	for (auto I : element) {
@@ -846,7 +947,7 @@ void EntityImporterBase::registerEntityReferences(const std::string& id, const A
 			continue;
 		}
 		if (hasEntityReference(I.second)) {
-			mEntitiesWithReferenceAttributes[id].push_back(name);
+			mEntitiesWithReferenceAttributes[id][name] = I.second;
 		}
 	}
 }
@@ -924,6 +1025,16 @@ void EntityImporterBase::setResume(bool enabled)
 	mResumeWorld = enabled;
 }
 
+void EntityImporterBase::setMaxOpsInFlight(unsigned int maxOpsInFlight)
+{
+	mEntityWindow.setMaxSize(maxOpsInFlight);
+}
+
+unsigned int EntityImporterBase::getMaxOpsInFlight() const
+{
+	return static_cast<unsigned int>(mEntityWindow.getMaxSize());
+}
+
 void EntityImporterBase::operationThinkResult(const Operation & op)
 {
 	mThoughtOpsInTransit--;
@@ -940,6 +1051,135 @@ void EntityImporterBase::operationSetResult(const Operation & op)
 	}
 }
 
+void EntityImporterBase::operationEntityResult(const Operation & op, const std::string& id)
+{
+	if (m_state == CANCEL) {
+		m_state = CANCELLED;
+		return;
+	}
+	if (m_state == CANCELLED) {
+		return;
+	}
+
+	auto I = mEntitiesInFlight.find(id);
+	//Since there can be multiple responses to the same serial number we need to make sure that this is the one we're waiting for.
+	if (I == mEntitiesInFlight.end() || I->second.serialno != op->getRefno()) {
+		return;
+	}
+	EntityWalkEntry& entry = I->second;
+	auto classNo = op->getClassNo();
+
+	if (classNo == Atlas::Objects::Operation::ROOT_OPERATION_NO) {
+		//An empty root operation signals a timeout; we never got any answer from the server.
+		mEntityWindow.failed();
+		S_LOG_FAILURE("Got time out when waiting for response about entity " << id << ".");
+		if (entry.state == EntityWalkEntry::CREATING) {
+			mStats.entitiesCreateErrorCount++;
+		}
+		//An entity which couldn't be updated still exists, so its children can still be restored.
+		if (entry.state != EntityWalkEntry::UPDATING) {
+			entityFailed(id);
+		}
+		mEntitiesInFlight.erase(I);
+		EventProgress.emit();
+	} else if (classNo == Atlas::Objects::Operation::ERROR_NO) {
+		if (entry.state == EntityWalkEntry::GETTING) {
+			if (entry.loc.empty()) {
+				mEntityWindow.failed();
+				S_LOG_FAILURE("Could not get the top level entity " << id << " from the server.");
+				mEntitiesInFlight.erase(I);
+				entityFailed(id);
+			} else {
+				//An error here just means that the entity we asked for didn't exist on the server, and we need
+				//to create it. This is an expected result.
+				mEntityWindow.completed(std::chrono::steady_clock::now() - entry.sent);
+				createEntity(id, entry);
+			}
+		} else {
+			mEntityWindow.failed();
+			std::string errorMessage;
+			if (!op->getArgs().empty()) {
+				auto arg = op->getArgs().front();
+				if (arg->hasAttr("message")) {
+					const Atlas::Message::Element messageElem = arg->getAttr("message");
+					if (messageElem.isString()) {
+						errorMessage = messageElem.asString();
+					}
+				}
+			}
+			if (entry.state == EntityWalkEntry::CREATING) {
+				//An error here means that something went wrong when trying to create an entity. This is wrong.
+				//It probably means that there's something wrong with the data we're sending. Either the
+				//persisted data is corrupt, or there have been changes on the server (for example entity types
+				//renamed or removed).
+				S_LOG_FAILURE("Could not create entity of type '" << entry.obj->getParent() << "', continuing with next. Server message: " << errorMessage);
+				if (!entry.obj->getContains().empty()) {
+					S_LOG_WARNING("Skipping the " << entry.obj->getContains().size() << " entities contained in the entity which couldn't be created.");
+				}
+				mStats.entitiesCreateErrorCount++;
+				entityFailed(id);
+			} else {
+				S_LOG_FAILURE("Could not update entity " << id << ". Server message: " << errorMessage);
+			}
+			EventProgress.emit();
+			mEntitiesInFlight.erase(I);
+		}
+	} else if (classNo == Atlas::Objects::Operation::INFO_NO && entry.state != EntityWalkEntry::UPDATING) {
+		if (op->isDefaultArgs() || op->getArgs().empty()) {
+			S_LOG_FAILURE("Info with no arg.");
+			return;
+		}
+		mEntityWindow.completed(std::chrono::steady_clock::now() - entry.sent);
+		const Root & arg = op->getArgs().front();
+
+		if (entry.state == EntityWalkEntry::CREATING) {
+			mNewIds.insert(arg->getId());
+			S_LOG_VERBOSE("Created: " << arg->getParent() << "(" << arg->getId() << ")");
+
+			mEntityIdMap.insert(std::make_pair(id, arg->getId()));
+			queueChildEntities(id, entry.obj, arg->getId());
+			mEntitiesInFlight.erase(I);
+		} else {
+			const RootEntity& ent = smart_dynamic_cast<RootEntity>(arg);
+			if (!ent.isValid()) {
+				S_LOG_FAILURE("Info response is not entity.");
+				mEntitiesInFlight.erase(I);
+				entityFailed(id);
+			} else {
+				if (arg->isDefaultId()) {
+					S_LOG_FAILURE("Corrupted info response: no id.");
+				}
+				const std::string& restoredId = arg->getId();
+
+				assert(restoredId == id);
+
+				//Since ops are handled by the server in the order they are sent, any entity we've just created with the same id will already be registered here.
+				if (!entry.loc.empty() && (mNewIds.find(restoredId) != mNewIds.end() || ent->isDefaultLoc() || ent->getParent() != entry.obj->getParent())) {
+					createEntity(id, entry);
+				} else {
+					updateEntity(id, entry, restoredId);
+				}
+			}
+		}
+	} else if (classNo == Atlas::Objects::Operation::SIGHT_NO && entry.state == EntityWalkEntry::UPDATING) {
+		if (op->isDefaultArgs() || op->getArgs().empty()) {
+			S_LOG_FAILURE("No arg");
+			return;
+		}
+		const Operation& sub_op = smart_dynamic_cast<Operation>(op->getArgs().front());
+		if (!sub_op.isValid() || sub_op->getClassNo() != Atlas::Objects::Operation::SET_NO || sub_op->getArgs().empty() || sub_op->isDefaultSerialno()) {
+			S_LOG_FAILURE("This is not our entity update response.");
+			return;
+		}
+		mEntityWindow.completed(std::chrono::steady_clock::now() - entry.sent);
+		mEntitiesInFlight.erase(I);
+	} else {
+		return;
+	}
+
+	walkEntities();
+}
+
 void EntityImporterBase::operation(const Operation & op)
 {
 	if (m_state == CANCEL) {
@@ -25,9 +25,14 @@
 #include <Atlas/Objects/SmartPtr.h>
 #include <Atlas/Objects/ObjectsFwd.h>
 
+#include "OperationWindow.h"
+
 #include <sigc++/trackable.h>
 #include <sigc++/signal.h>
 
+#include <chrono>
+#include <fstream>
+#include <memory>
 #include <vector>
 #include <list>
 #include <set>
@@ -42,39 +47,11 @@ class Codec;
 class Encoder;
 }
 
+class EntityDumpReader;
+
 typedef Atlas::Objects::Operation::RootOperation Operation;
 typedef std::vector<Atlas::Objects::Operation::RootOperation> OpVector;
 
-/**
- * @brief Represents one entry on the hierarchy of entities which are to be created on the server.
- */
-class StackEntry
-{
-public:
-	/**
-	 * @brief The persisted entity data.
-	 *
-	 * This should be sent to the server.
-	 */
-	const Atlas::Objects::Entity::RootEntity obj;
-
-	/**
-	 * @brief The id of the entity on the server, after it's either been created or updated.
-	 */
-	std::string restored_id;
-
-	/**
-	 * @brief Keeps track of the what child we're currently handling.
-	 *
-	 * As we walk through the children of entity this is updated, thus keeping track
-	 * of what child needs to be updated next.
-	 */
-	std::list<std::string>::const_iterator currentChildIterator;
-
-	StackEntry(const Atlas::Objects::Entity::RootEntity & o, const std::list<std::string>::const_iterator & c);
-	explicit StackEntry(const Atlas::Objects::Entity::RootEntity & o);
-};
-
 /**
  * @brief Imports a previously exported entity.
  */
@@ -169,6 +146,26 @@ public:
 		 * The number of failed rule creation ops.
 		 */
 		unsigned int rulesCreateErrorCount;
+		/**
+		 * The number of entity ops currently awaiting a response from the server.
+		 */
+		unsigned int entityOpsInFlight;
+		/**
+		 * The number of entity ops which currently may be in flight, as adjusted to the responsiveness of the server.
+		 */
+		unsigned int entityOpsWindow;
+		/**
+		 * The highest number of entity ops which have been in flight at once.
+		 */
+		unsigned int entityOpsInFlightPeak;
+		/**
+		 * The smoothed round trip time of entity ops, in microseconds.
+		 */
+		unsigned int entityOpsRoundTrip;
+		/**
+		 * The number of entities processed per second, since the entities started being processed.
+		 */
+		float entitiesPerSecond;
 	};
 
 	/**
@@ -204,6 +201,9 @@ public:
 
 	/**
 	 * @brief Starts importing entities from the specified file.
+	 *
+	 * Streamed dumps (see EntityExporterBase::setStreaming()) are read piece by piece while the entities are walked,
+	 * so that only the entities waiting to be walked are kept in memory. Other dumps are loaded whole through loadFromFile().
 	 * @param filename A path to an entity dump file.
 	 */
 	virtual void start(const std::string& filename);
@@ -225,6 +225,20 @@ public:
 	 */
 	void setResume(bool enabled);
 
+	/**
+	 * @brief Sets the max number of entity ops which may be in flight at once.
+	 *
+	 * The number actually in flight is adapted to how responsive the server is, but will never be more than this.
+	 * @param maxOpsInFlight The max number of ops in flight. Must be at least 1.
+	 */
+	void setMaxOpsInFlight(unsigned int maxOpsInFlight);
+
+	/**
+	 * @brief Gets the max number of entity ops which may be in flight at once.
+	 * @return The max number of ops in flight.
+	 */
+	unsigned int getMaxOpsInFlight() const;
+
 	/**
 	 * @brief Emitted when the load has been completed.
 	 */
@@ -254,7 +268,10 @@ protected:
 	Stats mStats;
 
 	/**
-	 * @brief All of the persisted entities, which are to be created on the server.
+	 * @brief The persisted entities which are yet to be updated or created on the server.
+	 *
+	 * Entities are removed as they are walked. For streamed dumps this only contains the entities which have been read
+	 * from the dump but not yet walked.
 	 */
 	std::map<std::string, Atlas::Objects::Root> mPersistedEntities;
 
@@ -265,6 +282,7 @@ protected:
 	 * Note that the mind data (i.e. the value) is first transferred to mResolvedMindMapping
 	 * before it's sent to the server. This is because the id of the entity might
 	 * be different from what's stored if it has to be created first.
+	 * For streamed dumps the minds are stored after the entities, and are therefore only read once all entities have been read.
 	 */
 	std::map<std::string, Atlas::Objects::Root> mPersistedMinds;
 
@@ -278,13 +296,6 @@ protected:
 	 */
 	std::map<std::string, Atlas::Objects::Root> mPersistedRules;
 
-	/**
-	 * @brief Keeps track of the responses from the server for create operations.
-	 *
-	 * This is used to populate m_entityIdMap with mapping data between entity id values found in the dump, and their new id values once they've been created.
-	 */
-	std::map<long, std::string> mCreateEntityMapping;
-
 	/**
 	 * @brief Keeps track of minds belonging to entities.
 	 *
@@ -296,25 +307,120 @@ protected:
 	/**
 	 * @brief Keeps track of any entities that have references to other entities in their attributes.
 	 *
-	 * The key of the map is the id of the entity, as found in mPersistedEntities.
-	 * The value of the map is a vector containing the names of the attributes with entity references.
+	 * The key of the map is the persisted id of the entity.
+	 * The value of the map contains the attributes with entity references, since the entity itself isn't kept once walked.
 	 *
 	 * Any attribute which references another entity can't be correctly sent when the entity is
 	 * initially created, since the referred entity might not have been created yet. This is even
 	 * the most usual case, since most entity references refer to things worn or wielded, and these
 	 * entities aren't created until the owner entity has been created.
 	 */
-	std::map<std::string, std::vector<std::string>> mEntitiesWithReferenceAttributes;
+	std::map<std::string, Atlas::Message::MapType> mEntitiesWithReferenceAttributes;
 
 	enum
 	{
-		INIT, RULE_WALKING, RULE_UPDATING, RULE_CREATING, ENTITY_WALKSTART, ENTITY_UPDATING, ENTITY_CREATING, ENTITY_WALKING, CANCEL, CANCELLED
+		INIT, RULE_WALKING, RULE_UPDATING, RULE_CREATING, ENTITY_WALKSTART, ENTITY_WALKING, CANCEL, CANCELLED
 	} m_state;
 
 	/**
-	 * @brief Keeps track of the hierarchy of entities that are to be created or updated.
+	 * @brief Represents one entity which is being updated or created on the server.
+	 *
+	 * Each such entity has exactly one op in flight to the server at any time.
+	 */
+	struct EntityWalkEntry
+	{
+		enum
+		{
+			/**
+			 * @brief Waiting for the response to a Get op, to see if the entity already exists on the server.
+			 */
+			GETTING,
+			/**
+			 * @brief Waiting for the response to a Set op, updating the existing entity.
+			 */
+			UPDATING,
+			/**
+			 * @brief Waiting for the response to a Create op, creating a new entity.
+			 */
+			CREATING
+		} state;
+
+		/**
+		 * @brief The persisted entity data.
+		 */
+		Atlas::Objects::Entity::RootEntity obj;
+
+		/**
+		 * @brief The id of the parent entity on the server. Empty for the top entity.
+		 */
+		std::string loc;
+
+		/**
+		 * @brief The serial number of the op in flight. Any other response is ignored.
+		 */
+		long serialno;
+
+		/**
+		 * @brief When the op in flight was sent.
+		 */
+		std::chrono::steady_clock::time_point sent;
+	};
+
+	/**
+	 * @brief Entities which can be updated or created as soon as the window allows, since the id of their parent entity on the server is known.
+	 *
+	 * The first value is the persisted id of the entity, the second the id of the parent entity on the server.
+	 */
+	std::deque<std::pair<std::string, std::string>> mEntityWalkQueue;
+
+	/**
+	 * @brief Entities which are being updated or created, keyed by their persisted id.
+	 */
+	std::unordered_map<std::string, EntityWalkEntry> mEntitiesInFlight;
+
+	/**
+	 * @brief Limits the number of entity ops in flight.
+	 */
+	OperationWindow mEntityWindow;
+
+	/**
+	 * @brief When we started walking the entities, used for the throughput stats.
+	 */
+	std::chrono::steady_clock::time_point mEntityWalkStart;
+
+	/**
+	 * @brief The stream of a streamed dump, which is kept open while entities are read from it.
+	 *
+	 * Must be declared before mEntityReader, since the reader refers to it.
+	 */
+	std::unique_ptr<std::fstream> mEntityStream;
+
+	/**
+	 * @brief Reads entities from a streamed dump. Reset once all entities have been read.
+	 */
+	std::unique_ptr<EntityDumpReader> mEntityReader;
+
+	/**
+	 * @brief The id of the top entity on the server.
+	 */
+	std::string mRootEntityId;
+
+	/**
+	 * @brief Entities read from a streamed dump whose parent hasn't yet been updated or created on the server.
+	 *
+	 * The key is the persisted id of the parent, the value the persisted ids of the children.
+	 */
+	std::unordered_map<std::string, std::vector<std::string>> mParkedEntities;
+
+	/**
+	 * @brief The total number of entities in mParkedEntities.
 	 */
-	std::deque<StackEntry> mTreeStack;
+	size_t mParkedEntitiesCount;
+
+	/**
+	 * @brief The persisted ids of entities which couldn't be updated or created, and whose children therefore are skipped.
+	 */
+	std::unordered_set<std::string> mFailedEntities;
 
 	/**
 	 * @brief Keeps track of the hierarchy of rules that are to be created or updated.
@@ -359,11 +465,73 @@ protected:
 
 	/**
 	 * @brief Gets an entity from the server.
-	 * @param id
-	 * @param res
+	 * @param id The persisted id of the entity.
+	 * @param loc The id of the parent entity on the server, or an empty string for the top entity.
 	 * @return True if the entity id was found amongst the entities, else false. The latter case will occur for transient entities, as they might not have been exported, but are still references from their parent entity.
 	 */
-	bool getEntity(const std::string & id, OpVector & res);
+	bool getEntity(const std::string & id, const std::string & loc);
+
+	/**
+	 * @brief Sends an op concerning an entity being walked, and waits for the response.
+	 * @param id The persisted id of the entity.
+	 * @param entry The entity.
+	 * @param op The op.
+	 */
+	void sendEntityOperation(const std::string& id, EntityWalkEntry& entry, const Operation& op);
+
+	/**
+	 * @brief Queues up the children of an entity, now that its id on the server is known.
+	 *
+	 * This includes both the entities in its CONTAINS attribute, and any parked entities.
+	 * @param id The persisted id of the entity.
+	 * @param obj The persisted entity.
+	 * @param restoredId The id of the entity on the server.
+	 */
+	void queueChildEntities(const std::string& id, const Atlas::Objects::Entity::RootEntity& obj, const std::string& restoredId);
+
+	/**
+	 * @brief Marks an entity as failed, skipping all of its children.
+	 * @param id The persisted id of the entity.
+	 */
+	void entityFailed(const std::string& id);
+
+	/**
+	 * @brief Opens a streamed dump, and starts walking it.
+	 * @param filename A path to an entity dump file.
+	 * @return False if the file isn't a streamed dump.
+	 */
+	bool startStreamed(const std::string& filename);
+
+	/**
+	 * @brief Reads the next entity from a streamed dump, and either queues or parks it depending on whether its parent has been walked.
+	 *
+	 * Once all entities have been read the minds are read, and the dump is closed.
+	 */
+	void readStreamedEntity();
+
+	/**
+	 * @brief Reads the rules of a dump into mPersistedRules.
+	 * @param rulesElem The "rules" element of the dump.
+	 * @return False if the element is malformed.
+	 */
+	bool readRules(const Atlas::Message::Element& rulesElem);
+
+	/**
+	 * @brief Reads the minds of a dump into mPersistedMinds.
+	 * @param mindsElem The "minds" element of the dump.
+	 * @return False if the element is malformed.
+	 */
+	bool readMinds(const Atlas::Message::Element& mindsElem);
+
+	/**
+	 * @brief Moves the minds of all walked entities to mResolvedMindMapping, using the ids the entities have on the server.
+	 */
+	void resolveMinds();
+
+	/**
+	 * @brief Updates the throughput stats.
+	 */
+	void updateEntityStats();
 
 	/**
 	 * @brief Gets a rule from the server.
@@ -383,10 +551,9 @@ protected:
 	void startRuleWalking();
 
 	/**
-	 * @brief Walks on the next entity in line to be created or updated on the server.
-	 * @param res
+	 * @brief Sends ops for as many of the queued entities as the window allows, or moves on once all entities are done.
 	 */
-	void walkEntities(OpVector & res);
+	void walkEntities();
 
 	/**
 	 * @brief Walks on the next rule in line to be created or updated on the server.
@@ -401,10 +568,18 @@ protected:
 
 	/**
 	 * @brief Creates a new entity on the server.
-	 * @param obj The entity specification.
-	 * @param res
+	 * @param id The persisted id of the entity.
+	 * @param entry The entity.
 	 */
-	void createEntity(const Atlas::Objects::Entity::RootEntity & obj, OpVector & res);
+	void createEntity(const std::string& id, EntityWalkEntry& entry);
+
+	/**
+	 * @brief Updates an existing entity on the server.
+	 * @param id The persisted id of the entity.
+	 * @param entry The entity.
+	 * @param restoredId The id of the existing entity on the server.
+	 */
+	void updateEntity(const std::string& id, EntityWalkEntry& entry, const std::string& restoredId);
 
 	/**
 	 * @brief Creates a new rule on the server.
@@ -460,6 +635,13 @@ protected:
 	 */
 	void operation(const Operation& op);
 
+	/**
+	 * @brief Called when the result of an op concerning an entity being walked is received.
+	 * @param op
+	 * @param id The persisted id of the entity.
+	 */
+	void operationEntityResult(const Operation& op, const std::string& id);
+
 	/**
 	 * @brief Called when the result of a Think op is received.
 	 * @param op
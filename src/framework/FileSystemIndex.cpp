@@ -0,0 +1,355 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FileSystemIndex.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+#include <sys/stat.h>
+
+namespace Ember
+{
+
+namespace
+{
+bool entryLess(const FileSystemIndex::Entry& entry, const std::string& name)
+{
+	return entry.name < name;
+}
+
+bool containsEntry(const std::vector<FileSystemIndex::Entry>& entries, const std::string& name)
+{
+	auto I = std::lower_bound(entries.begin(), entries.end(), name, entryLess);
+	return I != entries.end() && I->name == name;
+}
+
+void removeEntry(std::vector<FileSystemIndex::Entry>& entries, const std::string& name)
+{
+	auto I = std::lower_bound(entries.begin(), entries.end(), name, entryLess);
+	if (I != entries.end() && I->name == name) {
+		entries.erase(I);
+	}
+}
+
+void insertEntry(std::vector<FileSystemIndex::Entry>& entries, FileSystemIndex::Entry entry)
+{
+	auto I = std::lower_bound(entries.begin(), entries.end(), entry.name, entryLess);
+	entries.insert(I, std::move(entry));
+}
+
+/**
+ * @brief Converts a relative path to the form used in the index, with "/" as separator.
+ */
+std::string normalise(const std::string& path)
+{
+	std::string result(path);
+	std::replace(result.begin(), result.end(), '\\', '/');
+	return result;
+}
+}
+
+FileSystemIndex::FileSystemIndex(std::string rootPath) :
+		mRootPath(std::move(rootPath))
+{
+}
+
+bool FileSystemIndex::isVisitable(const std::string& name)
+{
+	//Hidden directories (such as .git) and directories with raw source material (.psd and .blend files etc.) shouldn't be visited.
+	return !name.empty() && name[0] != '.' && name != "source";
+}
+
+FileSystemIndex::Directory FileSystemIndex::scanDirectory(const std::string& key) const
+{
+	Directory directory { false, { }, { } };
+	std::string path = key.empty() ? mRootPath : mRootPath + "/" + key.substr(0, key.length() - 1);
+
+	struct stat fileStat;
+	//If there's a file with the name "norecurse" we shouldn't look any further.
+	if (::stat((path + "/norecurse").c_str(), &fileStat) == 0) {
+		directory.excluded = true;
+		return directory;
+	}
+
+	boost::system::error_code ec;
+	for (boost::filesystem::directory_iterator I(path, ec), end; !ec && I != end; I.increment(ec)) {
+		std::string name = I->path().filename().string();
+		if (::stat((path + "/" + name).c_str(), &fileStat) != 0) {
+			//Imitate a zero-length file, as the Ogre file system archive does.
+			directory.files.push_back(Entry { std::move(name), 0 });
+		} else if ((fileStat.st_mode & S_IFMT) == S_IFDIR) {
+			directory.subdirectories.push_back(Entry { std::move(name), static_cast<size_t>(fileStat.st_size) });
+		} else {
+			directory.files.push_back(Entry { std::move(name), static_cast<size_t>(fileStat.st_size) });
+		}
+	}
+
+	auto byName = [](const Entry& lhs, const Entry& rhs) {return lhs.name < rhs.name;};
+	std::sort(directory.files.begin(), directory.files.end(), byName);
+	std::sort(directory.subdirectories.begin(), directory.subdirectories.end(), byName);
+	return directory;
+}
+
+void FileSystemIndex::scanTree(const std::string& key, unsigned int threadCount, std::map<std::string, Directory>& directories) const
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::string> queue { key };
+	size_t activeWorkers = 0;
+
+	//Each worker takes a directory from the queue, reads it, and adds its subdirectories to the queue. All work is done once the queue is empty and no worker is reading.
+	auto worker = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			condition.wait(lock, [&]() {return !queue.empty() || activeWorkers == 0;});
+			if (queue.empty()) {
+				return;
+			}
+			std::string directoryKey = std::move(queue.front());
+			queue.pop_front();
+			activeWorkers++;
+
+			lock.unlock();
+			Directory directory = scanDirectory(directoryKey);
+			lock.lock();
+
+			for (auto& subdirectory : directory.subdirectories) {
+				if (isVisitable(subdirectory.name)) {
+					queue.push_back(directoryKey + subdirectory.name + "/");
+				}
+			}
+			directories.emplace(std::move(directoryKey), std::move(directory));
+			activeWorkers--;
+			if (!queue.empty() || activeWorkers == 0) {
+				condition.notify_all();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void FileSystemIndex::build(unsigned int threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::map<std::string, Directory> directories;
+	scanTree("", threadCount, directories);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mDirectories = std::move(directories);
+}
+
+void FileSystemIndex::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mDirectories.clear();
+}
+
+void FileSystemIndex::find(const std::string& pattern, bool recursive, bool dirs, const Visitor& visitor) const
+{
+	//The pattern can contain a directory name; separate it from the mask.
+	std::string directory;
+	std::string mask = pattern;
+	size_t pos = pattern.find_last_of("/\\");
+	if (pos != std::string::npos) {
+		directory = pattern.substr(0, pos + 1);
+		mask = pattern.substr(pos + 1);
+	}
+	//Hack for "*.*" -> "*" from DOS/Windows
+	if (mask == "*.*") {
+		mask = "*";
+	}
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	findInDirectory(normalise(directory), directory, mask, recursive, dirs, visitor);
+}
+
+void FileSystemIndex::findInDirectory(const std::string& key, const std::string& prefix, const std::string& mask, bool recursive, bool dirs, const Visitor& visitor) const
+{
+	Directory scannedDirectory;
+	const Directory* directory;
+	auto I = mDirectories.find(key);
+	if (I != mDirectories.end()) {
+		directory = &I->second;
+	} else {
+		//Not indexed, so read it from disk.
+		scannedDirectory = scanDirectory(key);
+		directory = &scannedDirectory;
+	}
+
+	if (directory->excluded) {
+		return;
+	}
+
+	const std::vector<Entry>& entries = dirs ? directory->subdirectories : directory->files;
+	if (mask.find_first_of("*?") == std::string::npos) {
+		auto J = std::lower_bound(entries.begin(), entries.end(), mask, entryLess);
+		if (J != entries.end() && J->name == mask) {
+			visitor(prefix, *J);
+		}
+	} else {
+		for (auto& entry : entries) {
+			if (matchPattern(mask.c_str(), entry.name.c_str())) {
+				visitor(prefix, entry);
+			}
+		}
+	}
+
+	if (recursive) {
+		for (auto& subdirectory : directory->subdirectories) {
+			if (isVisitable(subdirectory.name)) {
+				findInDirectory(key + subdirectory.name + "/", prefix + subdirectory.name + "/", mask, recursive, dirs, visitor);
+			}
+		}
+	}
+}
+
+bool FileSystemIndex::exists(const std::string& path) const
+{
+	std::string normalisedPath = normalise(path);
+	while (!normalisedPath.empty() && normalisedPath.back() == '/') {
+		normalisedPath.pop_back();
+	}
+
+	if (!normalisedPath.empty()) {
+		size_t pos = normalisedPath.rfind('/');
+		std::string key = pos == std::string::npos ? "" : normalisedPath.substr(0, pos + 1);
+		std::string name = normalisedPath.substr(pos == std::string::npos ? 0 : pos + 1);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto I = mDirectories.find(key);
+		if (I != mDirectories.end() && !I->second.excluded) {
+			return containsEntry(I->second.files, name) || containsEntry(I->second.subdirectories, name);
+		}
+	}
+
+	//Not indexed, so check the disk.
+	struct stat fileStat;
+	return ::stat((normalisedPath.empty() ? mRootPath : mRootPath + "/" + normalisedPath).c_str(), &fileStat) == 0;
+}
+
+void FileSystemIndex::pathChanged(const std::string& path)
+{
+	std::string normalisedPath = normalise(path);
+	while (!normalisedPath.empty() && normalisedPath.back() == '/') {
+		normalisedPath.pop_back();
+	}
+	if (normalisedPath.empty()) {
+		return;
+	}
+	size_t pos = normalisedPath.rfind('/');
+	std::string key = pos == std::string::npos ? "" : normalisedPath.substr(0, pos + 1);
+	std::string name = normalisedPath.substr(pos == std::string::npos ? 0 : pos + 1);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mDirectories.find(key);
+	if (I == mDirectories.end()) {
+		//Not indexed, so there's nothing to update.
+		return;
+	}
+
+	if (name == "norecurse") {
+		//Whether the directory should be indexed has changed, so index it anew.
+		removeTree(key);
+		scanTree(key, 1, mDirectories);
+		return;
+	}
+
+	if (I->second.excluded) {
+		return;
+	}
+
+	Directory& directory = I->second;
+	removeEntry(directory.files, name);
+	removeEntry(directory.subdirectories, name);
+	removeTree(key + name + "/");
+
+	struct stat fileStat;
+	if (::stat((mRootPath + "/" + normalisedPath).c_str(), &fileStat) == 0) {
+		if ((fileStat.st_mode & S_IFMT) == S_IFDIR) {
+			insertEntry(directory.subdirectories, Entry { name, static_cast<size_t>(fileStat.st_size) });
+			if (isVisitable(name)) {
+				scanTree(key + name + "/", 1, mDirectories);
+			}
+		} else {
+			insertEntry(directory.files, Entry { name, static_cast<size_t>(fileStat.st_size) });
+		}
+	}
+}
+
+void FileSystemIndex::removeTree(const std::string& key)
+{
+	auto I = mDirectories.lower_bound(key);
+	auto J = I;
+	while (J != mDirectories.end() && J->first.compare(0, key.length(), key) == 0) {
+		++J;
+	}
+	mDirectories.erase(I, J);
+}
+
+size_t FileSystemIndex::getFileCount() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	size_t count = 0;
+	for (auto& entry : mDirectories) {
+		count += entry.second.files.size();
+	}
+	return count;
+}
+
+bool FileSystemIndex::matchPattern(const char* pattern, const char* name)
+{
+	const char* starPattern = nullptr;
+	const char* starName = nullptr;
+	while (*name) {
+		if (*pattern == '*') {
+			starPattern = pattern++;
+			starName = name;
+		} else if (*pattern == '?' || *pattern == *name) {
+			++pattern;
+			++name;
+		} else if (starPattern) {
+			//Let the last "*" consume one more character and try again.
+			pattern = starPattern + 1;
+			name = ++starName;
+		} else {
+			return false;
+		}
+	}
+	while (*pattern == '*') {
+		++pattern;
+	}
+	return !*pattern;
+}
+
+}
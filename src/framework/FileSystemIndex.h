@@ -0,0 +1,164 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FILESYSTEMINDEX_H_
+#define FILESYSTEMINDEX_H_
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Ember
+{
+
+/**
+ * @brief An in-memory index of all files and directories under a root directory.
+ *
+ * The index is built once, by traversing the directory tree in a number of threads, after which queries can be answered without touching the disk.
+ * It's kept up to date by calling pathChanged() whenever the file system reports a change.
+ *
+ * The rules for which directories are indexed are the same as those used by the media archives:
+ * - hidden directories (starting with ".") aren't visited
+ * - directories named "source" aren't visited, since they contain raw source materials
+ * - directories containing a file named "norecurse" are neither listed nor visited
+ *
+ * Queries for directories which aren't indexed, such as hidden ones, are answered by reading the disk directly.
+ */
+class FileSystemIndex
+{
+public:
+
+	/**
+	 * @brief A file or a directory.
+	 */
+	struct Entry
+	{
+		/**
+		 * @brief The name, without any directory.
+		 */
+		std::string name;
+
+		size_t size;
+	};
+
+	/**
+	 * @brief Called for each match. The first parameter is the directory relative to the root, in the same form as in the pattern.
+	 */
+	typedef std::function<void(const std::string&, const Entry&)> Visitor;
+
+	/**
+	 * @brief Ctor.
+	 * @param rootPath The path of the root directory.
+	 */
+	explicit FileSystemIndex(std::string rootPath);
+
+	/**
+	 * @brief Builds the index, replacing any existing one.
+	 * @param threadCount The number of threads used to traverse the directories. If 0 the number of hardware threads is used.
+	 */
+	void build(unsigned int threadCount = 0);
+
+	/**
+	 * @brief Removes everything from the index.
+	 */
+	void clear();
+
+	/**
+	 * @brief Finds all files or directories matching a pattern.
+	 * @param pattern A pattern, optionally prefixed with a directory, such as "*.mesh" or "models/*.modeldef".
+	 * @param recursive Whether subdirectories should be searched too.
+	 * @param dirs True if directories should be found instead of files.
+	 * @param visitor Called for each match. It must not call back into the index.
+	 */
+	void find(const std::string& pattern, bool recursive, bool dirs, const Visitor& visitor) const;
+
+	/**
+	 * @brief Checks whether a file or a directory exists.
+	 * @param path A path relative to the root.
+	 */
+	bool exists(const std::string& path) const;
+
+	/**
+	 * @brief Updates the index after a file or directory has been added, removed or modified.
+	 * @param path A path relative to the root.
+	 */
+	void pathChanged(const std::string& path);
+
+	/**
+	 * @brief Gets the number of indexed files.
+	 */
+	size_t getFileCount() const;
+
+	/**
+	 * @brief Matches a name against a pattern containing "*" and "?" wildcards.
+	 */
+	static bool matchPattern(const char* pattern, const char* name);
+
+private:
+
+	struct Directory
+	{
+		/**
+		 * @brief True if the directory contains a "norecurse" file, in which case its content isn't indexed.
+		 */
+		bool excluded;
+
+		/**
+		 * @brief Files, sorted by name.
+		 */
+		std::vector<Entry> files;
+
+		/**
+		 * @brief Subdirectories, sorted by name.
+		 */
+		std::vector<Entry> subdirectories;
+	};
+
+	const std::string mRootPath;
+
+	/**
+	 * @brief All indexed directories, keyed by their path relative to the root, with a trailing "/". The root itself has an empty key.
+	 *
+	 * Since this is ordered a whole subtree can be found as a range of keys.
+	 */
+	std::map<std::string, Directory> mDirectories;
+
+	mutable std::mutex mMutex;
+
+	/**
+	 * @brief Reads a single directory from disk.
+	 */
+	Directory scanDirectory(const std::string& key) const;
+
+	/**
+	 * @brief Reads a directory and all of its visitable subdirectories from disk.
+	 */
+	void scanTree(const std::string& key, unsigned int threadCount, std::map<std::string, Directory>& directories) const;
+
+	void findInDirectory(const std::string& key, const std::string& prefix, const std::string& mask, bool recursive, bool dirs, const Visitor& visitor) const;
+
+	void removeTree(const std::string& key);
+
+	static bool isVisitable(const std::string& name);
+};
+
+}
+
+#endif /* FILESYSTEMINDEX_H_ */
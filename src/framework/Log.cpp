@@ -30,12 +30,177 @@
 
 #include <boost/date_time.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 //#include <stdio.h>
 
 
 
 namespace Ember {
 
+namespace {
+
+/**
+ * @brief A message queued for asynchronous writing.
+ */
+struct LogRecord
+{
+	std::string message;
+	std::string file;
+	int line;
+	Log::MessageImportance importance;
+	std::thread::id threadId;
+	/**
+	 * @brief A global sequence number, used to write messages from different threads in order.
+	 */
+	std::uint64_t sequence;
+};
+
+/**
+ * @brief A lock free ring buffer, with one producer (the thread logging) and one consumer (the writer thread).
+ */
+class LogRingBuffer
+{
+public:
+	LogRingBuffer() :
+			mRecords(Log::ASYNC_BUFFER_SIZE), mHead(0), mTail(0), mAbandoned(false)
+	{
+	}
+
+	/**
+	 * @brief Pushes a record onto the buffer. Only call this from the producer thread.
+	 * @return False if the buffer was full.
+	 */
+	bool push(LogRecord& record)
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head - mTail.load(std::memory_order_acquire) >= mRecords.size()) {
+			return false;
+		}
+		std::swap(mRecords[head % mRecords.size()], record);
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Pops a record from the buffer. Only call this from the consumer thread.
+	 * @return False if the buffer was empty.
+	 */
+	bool pop(LogRecord& record)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail == mHead.load(std::memory_order_acquire)) {
+			return false;
+		}
+		std::swap(mRecords[tail % mRecords.size()], record);
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const
+	{
+		return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+	}
+
+	std::vector<LogRecord> mRecords;
+	std::atomic<size_t> mHead;
+	std::atomic<size_t> mTail;
+
+	/**
+	 * @brief Set when the producer thread has exited. The buffer can then be removed once it's empty.
+	 */
+	std::atomic<bool> mAbandoned;
+};
+
+/**
+ * @brief Shared state for asynchronous logging.
+ */
+struct AsyncLogState
+{
+	AsyncLogState() :
+			running(false), writer(nullptr), dropped(0), sequence(0), processed(0)
+	{
+	}
+
+	/**
+	 * @brief Guards the "buffers" field. Only taken when a thread logs for the first time, and by the writer thread.
+	 */
+	std::mutex buffersMutex;
+	std::vector<std::shared_ptr<LogRingBuffer>> buffers;
+
+	std::atomic<bool> running;
+	std::thread* writer;
+
+	std::mutex wakeMutex;
+	std::condition_variable wakeCond;
+
+	std::atomic<unsigned long> dropped;
+	std::atomic<std::uint64_t> sequence;
+	/**
+	 * @brief The number of messages either written or dropped.
+	 */
+	std::atomic<std::uint64_t> processed;
+};
+
+AsyncLogState& getAsyncLogState()
+{
+	static AsyncLogState state;
+	return state;
+}
+
+/**
+ * @brief Holds the ring buffer of a thread, and marks it as abandoned when the thread exits.
+ */
+struct ThreadLogBuffer
+{
+	std::shared_ptr<LogRingBuffer> buffer;
+
+	~ThreadLogBuffer()
+	{
+		if (buffer) {
+			buffer->mAbandoned = true;
+		}
+	}
+};
+
+LogRingBuffer& getThreadLogBuffer()
+{
+	thread_local ThreadLogBuffer threadBuffer;
+	if (!threadBuffer.buffer) {
+		threadBuffer.buffer = std::make_shared<LogRingBuffer>();
+		AsyncLogState& state = getAsyncLogState();
+		std::unique_lock<std::mutex> lock(state.buffersMutex);
+		state.buffers.push_back(threadBuffer.buffer);
+	}
+	return *threadBuffer.buffer;
+}
+
+/**
+ * @brief The thread from which the message currently being dispatched was logged.
+ */
+std::thread::id& getOriginThreadIdStorage()
+{
+	thread_local std::thread::id threadId;
+	return threadId;
+}
+
+/**
+ * @brief Guards the observer list, as messages can be dispatched both from the writer thread and from any thread when logging synchronously.
+ * This is recursive since observers might log themselves.
+ */
+std::recursive_mutex& getObserverMutex()
+{
+	static std::recursive_mutex mutex;
+	return mutex;
+}
+
+}
+
 /**
  * @brief An observer which writes to std::cout.
  */
@@ -50,12 +215,26 @@ public:
 							const int &line,
 							const Log::MessageImportance & importance) override
 	{
-		std::cout << message << std::endl;
+		if (Log::isAsynchronous()) {
+			//We'll flush after each batch instead.
+			std::cout << message << '\n';
+		} else {
+			std::cout << message << std::endl;
+		}
+	}
+
+	void flush() override
+	{
+		std::cout.flush();
 	}
 };
 
 Log::ObserverList Log::sObserverList;
 
+std::atomic<int> Log::sMinimumImportance(Log::INFO);
+
+std::atomic<bool> Log::sAsynchronous(false);
+
 int Log::sNumberOfExternalObservers = 0;
 
 StdOutLogObserver Log::sStdOutLogObserver;
@@ -155,6 +334,7 @@ LoggingInstance Log::slog (const std::string & file)
 
 void Log::addObserver(LogObserver* observer)
 {
+	std::unique_lock<std::recursive_mutex> lock(getObserverMutex());
 	//test on already existing observer
 	if (std::find(sObserverList.begin(), sObserverList.end(), observer) == sObserverList.end()) {
 		if (sNumberOfExternalObservers == 0) {
@@ -164,10 +344,12 @@ void Log::addObserver(LogObserver* observer)
 		sObserverList.push_back(observer);
 		sNumberOfExternalObservers++;
 	}
+	updateFilter();
 }
 
 int Log::removeObserver(LogObserver* observer)
 {
+	std::unique_lock<std::recursive_mutex> lock(getObserverMutex());
 	ObserverList::iterator I = std::find(sObserverList.begin(), sObserverList.end(), observer);
 	if (I != sObserverList.end()) {
 		sObserverList.erase(I);
@@ -175,6 +357,7 @@ int Log::removeObserver(LogObserver* observer)
 		if (sNumberOfExternalObservers == 0) {
 			sObserverList.push_back(&sStdOutLogObserver);
 		}
+		updateFilter();
 		return 0;
 	}
 	return -1;
@@ -189,7 +372,40 @@ Log::HexNumber Log::hexNumber(const int intDecimal)
 
 void Log::sendMessage(const std::string & message, const std::string & file, const int line, const MessageImportance importance)
 {
+	if (!isEnabled(importance)) {
+		return;
+	}
+
+	if (sAsynchronous.load(std::memory_order_acquire)) {
+		AsyncLogState& state = getAsyncLogState();
+		LogRingBuffer& buffer = getThreadLogBuffer();
+		LogRecord record{message, file, line, importance, std::this_thread::get_id(), state.sequence++};
+		if (!buffer.push(record)) {
+			if (importance >= FAILURE) {
+				//Important messages should never be dropped; wait for the writer to catch up.
+				while (!buffer.push(record)) {
+					if (!state.running) {
+						dispatchMessage(message, file, line, importance);
+						state.processed++;
+						return;
+					}
+					state.wakeCond.notify_one();
+					std::this_thread::yield();
+				}
+			} else {
+				state.dropped++;
+				state.processed++;
+			}
+		}
+		return;
+	}
+
+	dispatchMessage(message, file, line, importance);
+}
 
+void Log::dispatchMessage(const std::string & message, const std::string & file, const int line, const MessageImportance importance)
+{
+	std::unique_lock<std::recursive_mutex> lock(getObserverMutex());
 	for (ObserverList::iterator i = sObserverList.begin(); i != sObserverList.end(); i++) {
 		if (static_cast<int>(importance) >= static_cast<int>((*i)->getFilter())) {
 			(*i)->onNewMessage(message, file, line, importance);
@@ -197,4 +413,138 @@ void Log::sendMessage(const std::string & message, const std::string & file, con
 	}
 }
 
+void Log::updateFilter()
+{
+	std::unique_lock<std::recursive_mutex> lock(getObserverMutex());
+	int minimumImportance = CRITICAL + 1;
+	for (auto observer : sObserverList) {
+		minimumImportance = std::min(minimumImportance, static_cast<int>(observer->getFilter()));
+	}
+	sMinimumImportance = minimumImportance;
+}
+
+namespace {
+
+/**
+ * @brief Moves all queued records from all buffers into the supplied vector, removing any abandoned buffers which are empty.
+ */
+void drainBuffers(AsyncLogState& state, std::vector<LogRecord>& records)
+{
+	std::unique_lock<std::mutex> lock(state.buffersMutex);
+	for (auto I = state.buffers.begin(); I != state.buffers.end();) {
+		LogRingBuffer& buffer = **I;
+		//Check for abandonment before draining, so that we don't miss any records pushed right before the thread exited.
+		bool abandoned = buffer.mAbandoned;
+		LogRecord record;
+		while (buffer.pop(record)) {
+			records.push_back(std::move(record));
+		}
+		if (abandoned) {
+			I = state.buffers.erase(I);
+		} else {
+			++I;
+		}
+	}
+}
+
+}
+
+void Log::setAsynchronous(bool enabled)
+{
+	AsyncLogState& state = getAsyncLogState();
+	if (enabled && !sAsynchronous) {
+		state.running = true;
+		state.writer = new std::thread([&state]() {
+#ifndef _WIN32
+			pthread_setname_np(pthread_self(), "Log writer");
+#endif
+			std::vector<LogRecord> records;
+			while (true) {
+				bool running = state.running;
+				drainBuffers(state, records);
+				if (records.empty()) {
+					if (!running) {
+						break;
+					}
+					std::unique_lock<std::mutex> lock(state.wakeMutex);
+					state.wakeCond.wait_for(lock, std::chrono::milliseconds(10));
+					continue;
+				}
+				std::sort(records.begin(), records.end(), [](const LogRecord& lhs, const LogRecord& rhs) {return lhs.sequence < rhs.sequence;});
+				{
+					std::unique_lock<std::recursive_mutex> lock(getObserverMutex());
+					for (auto& record : records) {
+						getOriginThreadIdStorage() = record.threadId;
+						dispatchMessage(record.message, record.file, record.line, record.importance);
+					}
+					getOriginThreadIdStorage() = std::thread::id();
+					for (auto observer : sObserverList) {
+						observer->flush();
+					}
+				}
+				state.processed += records.size();
+				records.clear();
+			}
+		});
+		sAsynchronous = true;
+	} else if (!enabled && sAsynchronous) {
+		//Any new messages will be written directly, while the writer thread writes all queued ones before exiting.
+		sAsynchronous = false;
+		state.running = false;
+		state.wakeCond.notify_one();
+		state.writer->join();
+		delete state.writer;
+		state.writer = nullptr;
+
+		//Catch any messages which were queued just as the writer exited.
+		std::vector<LogRecord> records;
+		drainBuffers(state, records);
+		std::sort(records.begin(), records.end(), [](const LogRecord& lhs, const LogRecord& rhs) {return lhs.sequence < rhs.sequence;});
+		for (auto& record : records) {
+			dispatchMessage(record.message, record.file, record.line, record.importance);
+		}
+		state.processed += records.size();
+	}
+}
+
+bool Log::isAsynchronous()
+{
+	return sAsynchronous.load(std::memory_order_relaxed);
+}
+
+void Log::flush()
+{
+	AsyncLogState& state = getAsyncLogState();
+	std::uint64_t target = state.sequence;
+	while (sAsynchronous && state.processed < target) {
+		state.wakeCond.notify_one();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+unsigned long Log::getDroppedMessageCount()
+{
+	return getAsyncLogState().dropped;
+}
+
+size_t Log::getQueueDepth()
+{
+	AsyncLogState& state = getAsyncLogState();
+	size_t depth = 0;
+	std::unique_lock<std::mutex> lock(state.buffersMutex);
+	for (auto& buffer : state.buffers) {
+		depth += buffer->size();
+	}
+	return depth;
+}
+
+std::thread::id Log::getOriginThreadId()
+{
+	std::thread::id threadId = getOriginThreadIdStorage();
+	if (threadId == std::thread::id()) {
+		return std::this_thread::get_id();
+	}
+	return threadId;
+}
+
 }
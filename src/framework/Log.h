@@ -25,9 +25,11 @@
 
 #include <boost/date_time/posix_time/ptime.hpp>
 
+#include <atomic>
 #include <cstdarg>
 #include <string>
 #include <list>
+#include <thread>
 
 //======================================================================
 // Short type macros
@@ -70,6 +72,14 @@ class LogObserver;
  * written/passed by the callback to an observer.
  *
  *
+ * Logging can optionally be made asynchronous through setAsynchronous(). Each thread will then write
+ * its messages to a lock free ring buffer of its own, which is drained by a dedicated writer thread.
+ * The observers will then only be called from the writer thread. If a ring buffer is full the message
+ * will be dropped, unless it's of FAILURE importance or higher.
+ *
+ * Use isEnabled() to check whether any observer is interested in a message before formatting it.
+ * The S_LOG_* macros do this automatically.
+ *
  * HINT: Names marked with * were chosen this short, because they are intentended to be used very
  * frequently.
  *
@@ -113,6 +123,11 @@ public:
 	static const int NUMBER_BUFFER_SIZE = 24;
 	static const int MESSAGE_BUFFER_SIZE = 4096;
 
+	/**
+	 * @brief The number of messages each thread can have queued when logging asynchronously.
+	 */
+	static const size_t ASYNC_BUFFER_SIZE = 1024;
+
 public:
 
 	/**
@@ -225,8 +240,85 @@ public:
 	 */
 	static void sendMessage(const std::string & message, const std::string & file, const int line, const MessageImportance importance);
 
+	/**
+	 * @brief Checks whether any observer is interested in messages of the supplied importance.
+	 *
+	 * Use this to avoid formatting messages which won't be written anyway.
+	 * @param importance The importance of the message.
+	 * @return True if there's at least one observer which would receive the message.
+	 */
+	static bool isEnabled(const MessageImportance importance)
+	{
+		return static_cast<int>(importance) >= sMinimumImportance.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Recalculates which messages any observer is interested in.
+	 *
+	 * This is called automatically when observers are added or removed, or when the filter of an observer is changed.
+	 */
+	static void updateFilter();
+
+	/**
+	 * @brief Sets whether logging should be asynchronous.
+	 *
+	 * When enabled a writer thread will be started, which takes care of calling the observers.
+	 * When disabled the writer thread will write all queued messages before being stopped.
+	 * @note This should only be called from the main thread.
+	 * @param enabled True if logging should be asynchronous.
+	 */
+	static void setAsynchronous(bool enabled);
+
+	/**
+	 * @brief Checks whether logging is asynchronous.
+	 * @return True if logging is asynchronous.
+	 */
+	static bool isAsynchronous();
+
+	/**
+	 * @brief Blocks until all messages logged before this call have been written.
+	 *
+	 * Does nothing if logging isn't asynchronous.
+	 */
+	static void flush();
+
+	/**
+	 * @brief Gets the number of messages dropped because of full buffers, since logging started.
+	 * @return The number of dropped messages.
+	 */
+	static unsigned long getDroppedMessageCount();
+
+	/**
+	 * @brief Gets the number of messages currently waiting to be written by the writer thread.
+	 * @return The number of queued messages.
+	 */
+	static size_t getQueueDepth();
+
+	/**
+	 * @brief Gets the id of the thread from which the message currently being written was logged.
+	 *
+	 * This is of use to observers, since they will be called from the writer thread when logging is asynchronous.
+	 * @return The id of the thread which logged the current message.
+	 */
+	static std::thread::id getOriginThreadId();
+
 private:
 
+	/**
+	 * @brief Calls all observers with the message.
+	 */
+	static void dispatchMessage(const std::string & message, const std::string & file, const int line, const MessageImportance importance);
+
+	/**
+	 * @brief The lowest importance any observer is interested in.
+	 */
+	static std::atomic<int> sMinimumImportance;
+
+	/**
+	 * @brief Whether logging is asynchronous.
+	 */
+	static std::atomic<bool> sAsynchronous;
+
 	typedef std::list<LogObserver*> ObserverList;
 
 	/**
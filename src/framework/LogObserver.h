@@ -63,6 +63,15 @@ public:
 	void setFilter (Log::MessageImportance filter)
 	{
 		mFilter = filter;
+		Log::updateFilter();
+	}
+
+	/**
+	 * Called after a batch of messages has been sent when logging asynchronously.
+	 * Observers which buffer their output should flush it here.
+	 */
+	virtual void flush()
+	{
 	}
 
 private:
@@ -25,11 +25,11 @@
 
 #include "Log.h"
 
-#define S_LOG_VERBOSE(message) (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::VERBOSE) << message << ENDM)
-#define S_LOG_INFO(message) (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::INFO) << message << ENDM)
-#define S_LOG_WARNING(message) (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::WARNING) << message << ENDM)
-#define S_LOG_FAILURE(message) (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::FAILURE) << message << ENDM)
-#define S_LOG_CRITICAL(message) (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::CRITICAL) << message << ENDM)
+#define S_LOG_VERBOSE(message) (Ember::Log::isEnabled(Ember::Log::VERBOSE) ? (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::VERBOSE) << message << ENDM) : (void)0)
+#define S_LOG_INFO(message) (Ember::Log::isEnabled(Ember::Log::INFO) ? (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::INFO) << message << ENDM) : (void)0)
+#define S_LOG_WARNING(message) (Ember::Log::isEnabled(Ember::Log::WARNING) ? (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::WARNING) << message << ENDM) : (void)0)
+#define S_LOG_FAILURE(message) (Ember::Log::isEnabled(Ember::Log::FAILURE) ? (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::FAILURE) << message << ENDM) : (void)0)
+#define S_LOG_CRITICAL(message) (Ember::Log::isEnabled(Ember::Log::CRITICAL) ? (Ember::Log::slog(__FILE__, __LINE__, Ember::Log::CRITICAL) << message << ENDM) : (void)0)
 
 namespace Atlas {
 namespace Message {
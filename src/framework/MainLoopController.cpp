@@ -22,11 +22,21 @@
 
 #include "MainLoopController.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Ember {
 template<> MainLoopController* Singleton<MainLoopController>::ms_Singleton = 0;
 
+namespace {
+/**
+ * @brief The number of frames used for frame time percentiles; at 60 frames per second about 17 seconds.
+ */
+const size_t FRAME_TIME_HISTORY = 1024;
+}
+
 MainLoopController::MainLoopController(bool& shouldQuit, bool& pollEris, Eris::EventService& eventService) :
-		mShouldQuit(shouldQuit), mPollEris(pollEris), mEventService(eventService) {
+		mShouldQuit(shouldQuit), mPollEris(pollEris), mEventService(eventService), mFrameTimes(FRAME_TIME_HISTORY), mFramesRecorded(0) {
 }
 
 bool MainLoopController::shouldQuit() {
@@ -60,4 +70,26 @@ Eris::EventService& MainLoopController::getEventService() {
 	return mEventService;
 }
 
+void MainLoopController::recordFrameTime(long microseconds) {
+	mFrameTimes[mFramesRecorded % mFrameTimes.size()] = microseconds;
+	mFramesRecorded++;
+}
+
+long MainLoopController::getFrameTimePercentile(float percentile) const {
+	size_t count = getRecordedFrameCount();
+	if (count == 0) {
+		return 0;
+	}
+	std::vector<long> frameTimes(mFrameTimes.begin(), mFrameTimes.begin() + count);
+	//Use the nearest rank.
+	size_t rank = static_cast<size_t>(std::ceil(std::min(100.0f, std::max(0.0f, percentile)) / 100.0f * count));
+	size_t index = std::min(count - 1, rank > 0 ? rank - 1 : 0);
+	std::nth_element(frameTimes.begin(), frameTimes.begin() + index, frameTimes.end());
+	return frameTimes[index];
+}
+
+size_t MainLoopController::getRecordedFrameCount() const {
+	return std::min(mFramesRecorded, mFrameTimes.size());
+}
+
 }
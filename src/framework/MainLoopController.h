@@ -23,6 +23,8 @@
 #include <Eris/EventService.h>
 #include "Singleton.h"
 
+#include <vector>
+
 namespace Ember {
 
 class TimeFrame;
@@ -103,6 +105,25 @@ public:
 
 	Eris::EventService& getEventService();
 
+	/**
+	 * @brief Records how long a frame took.
+	 * This is called by the main loop at the end of each frame.
+	 * @param microseconds The frame time, in microseconds.
+	 */
+	void recordFrameTime(long microseconds);
+
+	/**
+	 * @brief Gets a percentile of the frame times of the most recent frames.
+	 * @param percentile The percentile, between 0 and 100. For example 99 gives the time which 99% of the frames were faster than.
+	 * @return The frame time, in microseconds, or 0 if no frames have been recorded.
+	 */
+	long getFrameTimePercentile(float percentile) const;
+
+	/**
+	 * @brief Gets the number of frames used for calculating frame time percentiles.
+	 */
+	size_t getRecordedFrameCount() const;
+
 	/**
 	 * @brief Emitted before processing input. This event is emitted continuously.
 	 * The parameter sent is the time slice since this event last was emitted.
@@ -140,6 +161,16 @@ private:
 
 	Eris::EventService& mEventService;
 
+	/**
+	 * @brief A ring buffer of the most recent frame times, in microseconds.
+	 */
+	std::vector<long> mFrameTimes;
+
+	/**
+	 * @brief The total number of frames recorded, used to find the next position in mFrameTimes.
+	 */
+	size_t mFramesRecorded;
+
 };
 
 }
@@ -0,0 +1,152 @@
+//
+// Copyright (C) 2016 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "OperationWindow.h"
+
+#include <algorithm>
+
+namespace
+{
+/**
+ * @brief The size of the window when starting out.
+ */
+const size_t INITIAL_SIZE = 4;
+
+/**
+ * @brief The server is considered congested when the smoothed round trip time is this many times the shortest one seen...
+ */
+const long CONGESTION_FACTOR = 4;
+
+/**
+ * @brief ...and at least this much longer, so that jitter on very fast connections isn't mistaken for congestion.
+ */
+const std::chrono::microseconds CONGESTION_SLACK(2000);
+}
+
+const size_t OperationWindow::DEFAULT_MAX_SIZE;
+
+OperationWindow::OperationWindow(size_t maxSize) :
+		mMaxSize(std::max<size_t>(1, maxSize)),
+		mSize(std::min(INITIAL_SIZE, mMaxSize)),
+		mInFlight(0),
+		mPeakInFlight(0),
+		mSlowStart(true),
+		mCompletedSinceGrowth(0),
+		mCompletedUntilShrink(0),
+		mRoundTripTime(0),
+		mMinRoundTripTime(std::chrono::microseconds::max())
+{
+}
+
+void OperationWindow::setMaxSize(size_t maxSize)
+{
+	mMaxSize = std::max<size_t>(1, maxSize);
+	mSize = std::min(mSize, mMaxSize);
+}
+
+size_t OperationWindow::getMaxSize() const
+{
+	return mMaxSize;
+}
+
+size_t OperationWindow::getSize() const
+{
+	return mSize;
+}
+
+size_t OperationWindow::getInFlight() const
+{
+	return mInFlight;
+}
+
+size_t OperationWindow::getPeakInFlight() const
+{
+	return mPeakInFlight;
+}
+
+std::chrono::microseconds OperationWindow::getRoundTripTime() const
+{
+	return mRoundTripTime;
+}
+
+bool OperationWindow::canSend() const
+{
+	return mInFlight < mSize;
+}
+
+void OperationWindow::sent()
+{
+	mInFlight++;
+	mPeakInFlight = std::max(mPeakInFlight, mInFlight);
+}
+
+void OperationWindow::completed(std::chrono::steady_clock::duration roundTripTime)
+{
+	if (mInFlight > 0) {
+		mInFlight--;
+	}
+	if (mCompletedUntilShrink > 0) {
+		mCompletedUntilShrink--;
+	}
+
+	auto sample = std::chrono::duration_cast<std::chrono::microseconds>(roundTripTime);
+	if (mMinRoundTripTime == std::chrono::microseconds::max()) {
+		mRoundTripTime = sample;
+	} else {
+		//Same smoothing as used by TCP.
+		mRoundTripTime = (mRoundTripTime * 7 + sample) / 8;
+	}
+	mMinRoundTripTime = std::min(mMinRoundTripTime, sample);
+
+	if (mRoundTripTime > mMinRoundTripTime * CONGESTION_FACTOR && mRoundTripTime - mMinRoundTripTime > CONGESTION_SLACK) {
+		if (mSize == 1) {
+			//We can't send any slower; the server has just become slower overall, so use this as the new baseline.
+			mMinRoundTripTime = mRoundTripTime;
+		} else {
+			shrink();
+			return;
+		}
+	}
+
+	mCompletedSinceGrowth++;
+	if (mSlowStart || mCompletedSinceGrowth >= mSize) {
+		mCompletedSinceGrowth = 0;
+		mSize = std::min(mSize + 1, mMaxSize);
+	}
+}
+
+void OperationWindow::failed()
+{
+	if (mInFlight > 0) {
+		mInFlight--;
+	}
+	if (mCompletedUntilShrink > 0) {
+		mCompletedUntilShrink--;
+	}
+	shrink();
+}
+
+void OperationWindow::shrink()
+{
+	if (mCompletedUntilShrink > 0) {
+		return;
+	}
+	mSlowStart = false;
+	mCompletedSinceGrowth = 0;
+	mSize = std::max<size_t>(1, mSize / 2);
+	mCompletedUntilShrink = mInFlight;
+}
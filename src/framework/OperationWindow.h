@@ -0,0 +1,147 @@
+//
+// Copyright (C) 2016 Erik Ogenvik
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#ifndef OPERATIONWINDOW_H
+#define OPERATIONWINDOW_H
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @author Erik Ogenvik
+ *
+ * @brief Keeps track of how many operations may be in flight to the server at once, adapting to how responsive the server is.
+ *
+ * This is used when sending lots of operations which are independent of each other, such as when importing or exporting entities.
+ * Sending one operation at a time means that most time is spent waiting for round trips, while sending too many at once risks
+ * overflowing the server connection (which will then be dropped).
+ *
+ * The window starts out small and grows by one for each completed operation, until the first sign of congestion.
+ * After that it grows by one for each full window of completed operations, and is halved whenever the server shows
+ * signs of congestion, i.e. when the round trip time grows well beyond the shortest seen, or when an operation times out.
+ * The window never grows beyond the max size.
+ *
+ * This is meant to be shared between both Ember and Cyphesis, and only relies on C++ std.
+ */
+class OperationWindow
+{
+public:
+
+	/**
+	 * @brief The default max number of operations in flight.
+	 */
+	static const size_t DEFAULT_MAX_SIZE = 64;
+
+	/**
+	 * @brief Ctor.
+	 * @param maxSize The max number of operations which may be in flight at once.
+	 */
+	explicit OperationWindow(size_t maxSize = DEFAULT_MAX_SIZE);
+
+	/**
+	 * @brief Sets the max number of operations which may be in flight at once.
+	 * @param maxSize The max size. Must be at least 1.
+	 */
+	void setMaxSize(size_t maxSize);
+
+	/**
+	 * @brief Gets the max number of operations which may be in flight at once.
+	 * @return The max size.
+	 */
+	size_t getMaxSize() const;
+
+	/**
+	 * @brief Gets the number of operations which currently may be in flight at once.
+	 * @return The current window size.
+	 */
+	size_t getSize() const;
+
+	/**
+	 * @brief Gets the number of operations currently in flight.
+	 * @return The number of operations in flight.
+	 */
+	size_t getInFlight() const;
+
+	/**
+	 * @brief Gets the highest number of operations which have been in flight at once.
+	 * @return The peak number of operations in flight.
+	 */
+	size_t getPeakInFlight() const;
+
+	/**
+	 * @brief Gets the smoothed round trip time.
+	 * @return The smoothed round trip time.
+	 */
+	std::chrono::microseconds getRoundTripTime() const;
+
+	/**
+	 * @brief Checks if another operation can be sent.
+	 * @return True if fewer operations than the current window size are in flight.
+	 */
+	bool canSend() const;
+
+	/**
+	 * @brief Call this when an operation has been sent.
+	 */
+	void sent();
+
+	/**
+	 * @brief Call this when a response to an operation has been received.
+	 * @param roundTripTime The time it took from sending the operation until the response was received.
+	 */
+	void completed(std::chrono::steady_clock::duration roundTripTime);
+
+	/**
+	 * @brief Call this when an operation never got a response, for example because it timed out.
+	 */
+	void failed();
+
+private:
+
+	size_t mMaxSize;
+	size_t mSize;
+	size_t mInFlight;
+	size_t mPeakInFlight;
+
+	/**
+	 * @brief True until the first sign of congestion, while the window grows by one for each completed operation.
+	 */
+	bool mSlowStart;
+
+	/**
+	 * @brief The number of operations completed since the window last grew.
+	 */
+	size_t mCompletedSinceGrowth;
+
+	/**
+	 * @brief The number of operations which must complete before the window can be shrunk again.
+	 *
+	 * This is to prevent the window from shrinking multiple times because of one burst of slow responses,
+	 * since all operations sent before the window was shrunk will still see the same congestion.
+	 */
+	size_t mCompletedUntilShrink;
+
+	std::chrono::microseconds mRoundTripTime;
+	std::chrono::microseconds mMinRoundTripTime;
+
+	/**
+	 * @brief Halves the window.
+	 */
+	void shrink();
+};
+
+#endif //OPERATIONWINDOW_H
@@ -0,0 +1,241 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Ember
+{
+
+namespace
+{
+/**
+ * @brief A recorded zone.
+ *
+ * The fields are atomic since a zone might be overwritten while it's being read; such zones are discarded by the reader.
+ */
+struct Zone
+{
+	std::atomic<const char*> name;
+	std::atomic<int64_t> start;
+	std::atomic<int64_t> end;
+};
+
+/**
+ * @brief The zones recorded by one thread.
+ *
+ * Only the owning thread writes zones. Before a zone is written "claimed" is increased, and once it's written "written" is increased.
+ * A reader can thus tell which of the zones it has read might have been overwritten.
+ */
+struct ThreadBuffer
+{
+	explicit ThreadBuffer(size_t id) :
+			id(id), zones(new Zone[Profiler::ZONES_PER_THREAD]()), claimed(0), written(0)
+	{
+	}
+
+	const size_t id;
+	std::unique_ptr<Zone[]> zones;
+	std::atomic<uint64_t> claimed;
+	std::atomic<uint64_t> written;
+
+	/**
+	 * @brief The name of the thread. Guarded by the registry mutex.
+	 */
+	std::string name;
+};
+
+struct Registry
+{
+	std::mutex mutex;
+
+	/**
+	 * @brief All thread buffers. These are never removed, but those of exited threads are reused.
+	 */
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+	/**
+	 * @brief The buffers of exited threads, which can be reused by new threads.
+	 */
+	std::vector<ThreadBuffer*> retired;
+
+	std::unordered_set<std::string> names;
+};
+
+Registry& getRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+/**
+ * @brief Holds the buffer of a thread, and retires it when the thread exits.
+ *
+ * Threads are created and destroyed as task queues come and go, so without reusing the buffers their number would grow without bounds.
+ */
+struct ThreadBufferHolder
+{
+	ThreadBufferHolder() :
+			buffer(nullptr)
+	{
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		if (!registry.retired.empty()) {
+			buffer = registry.retired.back();
+			registry.retired.pop_back();
+			buffer->name.clear();
+		} else {
+			registry.buffers.emplace_back(new ThreadBuffer(registry.buffers.size()));
+			buffer = registry.buffers.back().get();
+		}
+	}
+
+	~ThreadBufferHolder()
+	{
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.retired.push_back(buffer);
+	}
+
+	ThreadBuffer* buffer;
+};
+
+ThreadBuffer& getThreadBuffer()
+{
+	thread_local ThreadBufferHolder holder;
+	return *holder.buffer;
+}
+
+void writeJsonString(std::ostream& stream, const char* string)
+{
+	stream << '"';
+	for (const char* c = string; *c; ++c) {
+		switch (*c) {
+		case '"':
+			stream << "\\\"";
+			break;
+		case '\\':
+			stream << "\\\\";
+			break;
+		default:
+			if (static_cast<unsigned char>(*c) < 0x20) {
+				stream << ' ';
+			} else {
+				stream << *c;
+			}
+		}
+	}
+	stream << '"';
+}
+}
+
+int64_t Profiler::now()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	buffer.claimed.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	Zone& zone = buffer.zones[index % ZONES_PER_THREAD];
+	zone.name.store(name, std::memory_order_relaxed);
+	zone.start.store(start, std::memory_order_relaxed);
+	zone.end.store(end, std::memory_order_relaxed);
+
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(getRegistry().mutex);
+	buffer.name = name;
+}
+
+const char* Profiler::intern(const std::string& name)
+{
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.names.insert(name).first->c_str();
+}
+
+size_t Profiler::writeChromeTrace(std::ostream& stream, std::chrono::microseconds window)
+{
+	struct Entry
+	{
+		uint64_t index;
+		const char* name;
+		int64_t start;
+		int64_t end;
+	};
+
+	int64_t cutoff = now() - window.count();
+	size_t count = 0;
+	//Thread names are written as events too, so this isn't the same as the number of zones.
+	size_t events = 0;
+	std::vector<Entry> entries;
+
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	stream << "{\"traceEvents\":[";
+	for (auto& buffer : registry.buffers) {
+		entries.clear();
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t first = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+		for (uint64_t i = first; i < written; ++i) {
+			Zone& zone = buffer->zones[i % ZONES_PER_THREAD];
+			entries.push_back(Entry { i, zone.name.load(std::memory_order_relaxed), zone.start.load(std::memory_order_relaxed), zone.end.load(std::memory_order_relaxed) });
+		}
+
+		//Any zone which has been claimed for writing since we started reading might have overwritten one of the zones we read.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t claimed = buffer->claimed.load(std::memory_order_relaxed);
+		uint64_t firstValid = claimed > ZONES_PER_THREAD ? claimed - ZONES_PER_THREAD : 0;
+
+		for (auto& entry : entries) {
+			if (entry.index < firstValid || entry.end < cutoff) {
+				continue;
+			}
+			stream << (events++ ? ",\n" : "\n") << "{\"name\":";
+			writeJsonString(stream, entry.name);
+			stream << ",\"ph\":\"X\",\"ts\":" << entry.start << ",\"dur\":" << (entry.end - entry.start) << ",\"pid\":1,\"tid\":" << buffer->id << "}";
+			count++;
+		}
+
+		if (!buffer->name.empty()) {
+			stream << (events++ ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+			writeJsonString(stream, buffer->name.c_str());
+			stream << "}}";
+		}
+	}
+	stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return count;
+}
+
+}
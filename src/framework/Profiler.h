@@ -0,0 +1,126 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace Ember
+{
+
+/**
+ * @brief Records timed zones, to be inspected afterwards as a trace.
+ *
+ * Each thread writes to its own ring buffer, without any locking, so recording a zone costs little more than reading the clock twice.
+ * The buffers keep the most recent zones only; older ones are overwritten. The buffers of exited threads are kept, so that their zones can still be dumped, until they are reused by new threads.
+ * There are thus never more buffers than the largest number of threads which have been running at the same time.
+ *
+ * The recorded zones can be written in the Chrome trace event format, which can be viewed in "chrome://tracing".
+ *
+ * Zone names must stay valid for as long as the application runs. String literals are fine; any other names should be passed through intern().
+ *
+ * @see ProfileZone
+ */
+class Profiler
+{
+public:
+
+	/**
+	 * @brief The number of zones kept for each thread.
+	 */
+	static const size_t ZONES_PER_THREAD = 1 << 15;
+
+	/**
+	 * @brief Gets the current time, in microseconds since the profiler was first used.
+	 */
+	static int64_t now();
+
+	/**
+	 * @brief Records a zone for the current thread.
+	 * @param name The name of the zone.
+	 * @param start The start time, as returned by now().
+	 * @param end The end time, as returned by now().
+	 */
+	static void record(const char* name, int64_t start, int64_t end);
+
+	/**
+	 * @brief Names the current thread in the trace.
+	 * @param name The name of the thread.
+	 */
+	static void setThreadName(const std::string& name);
+
+	/**
+	 * @brief Gets a name which stays valid for as long as the application runs.
+	 *
+	 * Interning the same name twice returns the same pointer.
+	 * @param name A name.
+	 */
+	static const char* intern(const std::string& name);
+
+	/**
+	 * @brief Writes recorded zones in the Chrome trace event format.
+	 * @param stream The stream to write to.
+	 * @param window Only zones which ended within this long ago are written.
+	 * @return The number of zones written.
+	 */
+	static size_t writeChromeTrace(std::ostream& stream, std::chrono::microseconds window);
+};
+
+/**
+ * @brief Records a zone with the profiler, from creation to destruction.
+ *
+ * Typical usage is to put this first in a block which should show up in the trace:
+ *
+ * {
+ * 	ProfileZone zone("Render");
+ * 	...
+ * }
+ */
+class ProfileZone
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * @param name The name of the zone. This must either be a string literal or have been passed through Profiler::intern().
+	 */
+	explicit ProfileZone(const char* name) :
+			mName(name), mStart(Profiler::now())
+	{
+	}
+
+	~ProfileZone()
+	{
+		Profiler::record(mName, mStart, Profiler::now());
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* mName;
+	int64_t mStart;
+};
+
+}
+
+#endif /* PROFILER_H_ */
@@ -94,7 +94,7 @@ std::atomic<int> ThreadIdentifier::sCounter;
         	static std::map<std::thread::id, ThreadIdentifier> threadIdentifiers;
         	myOut << "(";
 			myOut.width(8);
-			myOut << ((currentTime - mStart).total_microseconds()) << ":"<< threadIdentifiers[std::this_thread::get_id()].id << ":" << Log::sCurrentFrame << ":" << (currentTime - Log::sCurrentFrameStartMilliseconds).total_milliseconds() << ")";
+			myOut << ((currentTime - mStart).total_microseconds()) << ":"<< threadIdentifiers[Log::getOriginThreadId()].id << ":" << Log::sCurrentFrame << ":" << (currentTime - Log::sCurrentFrameStartMilliseconds).total_milliseconds() << ")";
         }
         myOut << "] ";
 
@@ -127,8 +127,18 @@ std::atomic<int> ThreadIdentifier::sCounter;
             }
         #endif
 
-        myOut << std::endl;
+        //When logging asynchronously we'll flush after each batch instead, since flushing for each message is expensive.
+        if (Log::isAsynchronous()) {
+            myOut << '\n';
+        } else {
+            myOut << std::endl;
+        }
+
+    }
 
+    void StreamLogObserver::flush()
+    {
+        myOut.flush();
     }
 
     void StreamLogObserver::setDetailed(bool enabled)
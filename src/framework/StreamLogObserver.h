@@ -113,6 +113,11 @@ class StreamLogObserver : public LogObserver
     virtual void onNewMessage(const std::string & message, const std::string & file, const int & line, 
                                   const Log::MessageImportance & importance);
 
+    /**
+     * Flushes the stream.
+     */
+    virtual void flush();
+
     /**
      * @brief Sets whether the log output should be detailed or not.
      *
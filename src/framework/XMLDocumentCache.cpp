@@ -0,0 +1,393 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "XMLDocumentCache.h"
+
+#include "framework/LoggingInstance.h"
+#include "framework/tinyxml/tinyxml.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+template<> Ember::XMLDocumentCache* Ember::Singleton<Ember::XMLDocumentCache>::ms_Singleton = nullptr;
+
+namespace Ember
+{
+
+namespace
+{
+const char MAGIC[4] = { 'E', 'X', 'D', 'C' };
+
+const char NODE_ELEMENT = 'E';
+const char NODE_TEXT = 'T';
+const char NODE_CDATA = 'C';
+
+template<typename T>
+void write(std::string& buffer, T value)
+{
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeString(std::string& buffer, const std::string& value)
+{
+	write<uint32_t>(buffer, value.size());
+	buffer.append(value);
+}
+
+template<typename T>
+bool read(const char*& data, const char* end, T& value)
+{
+	if (static_cast<size_t>(end - data) < sizeof(T)) {
+		return false;
+	}
+	std::memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+bool readString(const char*& data, const char* end, std::string& value)
+{
+	uint32_t length;
+	if (!read(data, end, length) || static_cast<size_t>(end - data) < length) {
+		return false;
+	}
+	value.assign(data, length);
+	data += length;
+	return true;
+}
+}
+
+const uint32_t XMLDocumentCache::VERSION;
+
+XMLDocumentCache::XMLDocumentCache(std::string path) :
+		mPath(std::move(path)), mMappedData(nullptr), mMappedLength(0), mDirty(false)
+{
+	open();
+}
+
+XMLDocumentCache::~XMLDocumentCache()
+{
+	waitForWrite();
+	if (mMappedData) {
+#ifdef _WIN32
+		delete[] static_cast<char*>(mMappedData);
+#else
+		munmap(mMappedData, mMappedLength);
+#endif
+	}
+}
+
+void XMLDocumentCache::open()
+{
+#ifdef _WIN32
+	std::ifstream file(mPath, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return;
+	}
+	mMappedLength = file.tellg();
+	file.seekg(0);
+	mMappedData = new char[mMappedLength];
+	file.read(static_cast<char*>(mMappedData), mMappedLength);
+#else
+	int fd = ::open(mPath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+		void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			mMappedData = data;
+			mMappedLength = fileStat.st_size;
+		}
+	}
+	::close(fd);
+#endif
+
+	if (mMappedData) {
+		if (readIndex(static_cast<const char*>(mMappedData), mMappedLength)) {
+			S_LOG_INFO("Read " << mEntries.size() << " documents from xml document cache at '" << mPath << "'.");
+		} else {
+			S_LOG_WARNING("Xml document cache at '" << mPath << "' is invalid or of an older version; it will be rebuilt.");
+			mEntries.clear();
+			//Make sure that the invalid file is replaced.
+			mDirty = true;
+		}
+	}
+}
+
+bool XMLDocumentCache::readIndex(const char* data, size_t length)
+{
+	const char* end = data + length;
+	char magic[4];
+	uint32_t version, entryCount;
+	if (!read(data, end, magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+		return false;
+	}
+	if (!read(data, end, version) || version != VERSION) {
+		return false;
+	}
+	if (!read(data, end, entryCount)) {
+		return false;
+	}
+	mEntries.reserve(entryCount);
+	for (uint32_t i = 0; i < entryCount; ++i) {
+		std::string name;
+		Entry entry;
+		uint32_t dataLength;
+		if (!readString(data, end, name) || !read(data, end, entry.modifiedTime) || !read(data, end, entry.size) || !read(data, end, entry.hash) || !read(data, end, dataLength)) {
+			return false;
+		}
+		if (static_cast<size_t>(end - data) < dataLength) {
+			return false;
+		}
+		entry.data = data;
+		entry.length = dataLength;
+		data += dataLength;
+		mEntries.emplace(std::move(name), std::move(entry));
+	}
+	return true;
+}
+
+bool XMLDocumentCache::load(TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(name);
+	if (I == mEntries.end() || I->second.modifiedTime != modifiedTime || I->second.size != size) {
+		return false;
+	}
+	if (!decode(xmlDoc, I->second.data, I->second.length)) {
+		xmlDoc.Clear();
+		return false;
+	}
+	return true;
+}
+
+bool XMLDocumentCache::load(TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, const std::string& content)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto I = mEntries.find(name);
+	if (I == mEntries.end() || I->second.size != content.size() || I->second.hash != hash(content)) {
+		return false;
+	}
+	if (!decode(xmlDoc, I->second.data, I->second.length)) {
+		xmlDoc.Clear();
+		return false;
+	}
+	if (I->second.modifiedTime != modifiedTime) {
+		I->second.modifiedTime = modifiedTime;
+		mDirty = true;
+	}
+	return true;
+}
+
+void XMLDocumentCache::store(const TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, const std::string& content)
+{
+	auto data = std::make_shared<const std::string>(encode(xmlDoc));
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	Entry& entry = mEntries[name];
+	entry.modifiedTime = modifiedTime;
+	entry.size = content.size();
+	entry.hash = hash(content);
+	entry.data = data->data();
+	entry.length = data->size();
+	entry.ownedData = std::move(data);
+	mDirty = true;
+}
+
+void XMLDocumentCache::writeInBackground()
+{
+	waitForWrite();
+
+	std::vector<std::pair<std::string, Entry>> entries;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mDirty) {
+			return;
+		}
+		mDirty = false;
+		entries.assign(mEntries.begin(), mEntries.end());
+	}
+
+	//Entries refer either to the mapped file, which stays mapped until the destructor has waited for the writer, or to owned data which is shared with the writer.
+	std::string path = mPath;
+	mWriter = std::thread([path, entries]() {
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				S_LOG_WARNING("Could not write xml document cache to '" << tempPath << "'.");
+				return;
+			}
+			std::string header;
+			header.append(MAGIC, sizeof(MAGIC));
+			write<uint32_t>(header, VERSION);
+			write<uint32_t>(header, entries.size());
+			file.write(header.data(), header.size());
+
+			for (auto& entryPair : entries) {
+				const Entry& entry = entryPair.second;
+				std::string entryHeader;
+				writeString(entryHeader, entryPair.first);
+				write(entryHeader, entry.modifiedTime);
+				write(entryHeader, entry.size);
+				write(entryHeader, entry.hash);
+				write<uint32_t>(entryHeader, entry.length);
+				file.write(entryHeader.data(), entryHeader.size());
+				file.write(entry.data, entry.length);
+			}
+			if (!file) {
+				S_LOG_WARNING("Could not write xml document cache to '" << tempPath << "'.");
+				std::remove(tempPath.c_str());
+				return;
+			}
+		}
+#ifdef _WIN32
+		std::remove(path.c_str());
+#endif
+		//Renaming leaves any mapping of the old file intact.
+		if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+			S_LOG_WARNING("Could not replace xml document cache at '" << path << "'.");
+			std::remove(tempPath.c_str());
+		} else {
+			S_LOG_VERBOSE("Wrote " << entries.size() << " documents to xml document cache at '" << path << "'.");
+		}
+	});
+}
+
+void XMLDocumentCache::waitForWrite()
+{
+	if (mWriter.joinable()) {
+		mWriter.join();
+	}
+}
+
+size_t XMLDocumentCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEntries.size();
+}
+
+std::string XMLDocumentCache::encode(const TiXmlDocument& xmlDoc)
+{
+	std::string buffer;
+	encodeNode(buffer, xmlDoc);
+	return buffer;
+}
+
+void XMLDocumentCache::encodeNode(std::string& buffer, const TiXmlNode& node)
+{
+	uint32_t childCount = 0;
+	for (const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling()) {
+		if (child->Type() == TiXmlNode::ELEMENT || child->Type() == TiXmlNode::TEXT) {
+			childCount++;
+		}
+	}
+	write(buffer, childCount);
+
+	for (const TiXmlNode* child = node.FirstChild(); child; child = child->NextSibling()) {
+		if (const TiXmlElement* element = child->ToElement()) {
+			buffer.push_back(NODE_ELEMENT);
+			writeString(buffer, element->ValueStr());
+			uint32_t attributeCount = 0;
+			for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+				attributeCount++;
+			}
+			write(buffer, attributeCount);
+			for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+				writeString(buffer, attribute->NameTStr());
+				writeString(buffer, attribute->ValueStr());
+			}
+			encodeNode(buffer, *element);
+		} else if (const TiXmlText* text = child->ToText()) {
+			buffer.push_back(text->CDATA() ? NODE_CDATA : NODE_TEXT);
+			writeString(buffer, text->ValueStr());
+		}
+	}
+}
+
+bool XMLDocumentCache::decode(TiXmlDocument& xmlDoc, const char* data, size_t length)
+{
+	const char* end = data + length;
+	return decodeNodes(xmlDoc, data, end) && data == end;
+}
+
+bool XMLDocumentCache::decodeNodes(TiXmlNode& parent, const char*& data, const char* end)
+{
+	uint32_t childCount;
+	if (!read(data, end, childCount)) {
+		return false;
+	}
+	std::string value;
+	for (uint32_t i = 0; i < childCount; ++i) {
+		char type;
+		if (!read(data, end, type) || !readString(data, end, value)) {
+			return false;
+		}
+		if (type == NODE_ELEMENT) {
+			auto element = new TiXmlElement(value);
+			parent.LinkEndChild(element);
+			uint32_t attributeCount;
+			if (!read(data, end, attributeCount)) {
+				return false;
+			}
+			std::string attributeName;
+			for (uint32_t j = 0; j < attributeCount; ++j) {
+				if (!readString(data, end, attributeName) || !readString(data, end, value)) {
+					return false;
+				}
+				element->SetAttribute(attributeName, value);
+			}
+			if (!decodeNodes(*element, data, end)) {
+				return false;
+			}
+		} else if (type == NODE_TEXT || type == NODE_CDATA) {
+			auto text = new TiXmlText(value);
+			text->SetCDATA(type == NODE_CDATA);
+			parent.LinkEndChild(text);
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t XMLDocumentCache::hash(const std::string& content)
+{
+	//FNV-1a
+	uint64_t result = 14695981039346656037ULL;
+	for (char c : content) {
+		result ^= static_cast<unsigned char>(c);
+		result *= 1099511628211ULL;
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,202 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef XMLDOCUMENTCACHE_H_
+#define XMLDOCUMENTCACHE_H_
+
+#include "framework/Singleton.h"
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace Ember
+{
+class TiXmlDocument;
+class TiXmlNode;
+
+/**
+ * @brief A persistent cache of parsed xml documents.
+ *
+ * Definitions (models, entity mappings, sounds, terrain layers etc.) are stored as xml files, which are all parsed at startup.
+ * This cache keeps a compact binary copy of each parsed document in a single file, so that on subsequent startups the documents can be rebuilt without any text parsing.
+ *
+ * The cache file is mapped into memory when the cache is created, and documents are decoded directly from the mapped memory.
+ * Each entry is stamped with the modification time, the size and a hash of the source file. If the time and size match the entry is used without even reading the source.
+ * If they don't match the source is read and hashed, and if the content is unchanged the entry is still used.
+ * Otherwise the source must be parsed as usual and then stored in the cache.
+ *
+ * Any changes are written to disk in a background thread when writeInBackground() is called.
+ * The file is versioned; a file written by an incompatible version is ignored and replaced.
+ */
+class XMLDocumentCache : public Singleton<XMLDocumentCache>
+{
+public:
+
+	/**
+	 * @brief Increase this whenever the format of the cache file changes.
+	 */
+	static const uint32_t VERSION = 1;
+
+	/**
+	 * @brief Ctor.
+	 *
+	 * If a valid cache file exists at the supplied path it will be mapped into memory.
+	 * @param path The path of the cache file.
+	 */
+	explicit XMLDocumentCache(std::string path);
+
+	/**
+	 * @brief Dtor.
+	 *
+	 * Waits for any background write to complete. Changes not yet written are discarded.
+	 */
+	~XMLDocumentCache() override;
+
+	/**
+	 * @brief Tries to load a document without reading the source.
+	 * @param xmlDoc An empty document.
+	 * @param name The unique name of the source.
+	 * @param modifiedTime The modification time of the source.
+	 * @param size The size of the source.
+	 * @return True if the document was loaded from the cache.
+	 */
+	bool load(TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, size_t size);
+
+	/**
+	 * @brief Tries to load a document by comparing the content of the source.
+	 *
+	 * If the content is unchanged the stored modification time is updated.
+	 * @param xmlDoc An empty document.
+	 * @param name The unique name of the source.
+	 * @param modifiedTime The modification time of the source.
+	 * @param content The full content of the source.
+	 * @return True if the document was loaded from the cache.
+	 */
+	bool load(TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, const std::string& content);
+
+	/**
+	 * @brief Stores a parsed document.
+	 * @param xmlDoc The parsed document.
+	 * @param name The unique name of the source.
+	 * @param modifiedTime The modification time of the source.
+	 * @param content The full content of the source.
+	 */
+	void store(const TiXmlDocument& xmlDoc, const std::string& name, time_t modifiedTime, const std::string& content);
+
+	/**
+	 * @brief Writes the cache to disk in a background thread, if anything has changed.
+	 */
+	void writeInBackground();
+
+	/**
+	 * @brief Waits until any background write has completed.
+	 */
+	void waitForWrite();
+
+	/**
+	 * @brief Gets the number of entries in the cache.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Encodes the element and text nodes of a document.
+	 *
+	 * Comments, declarations and unknown nodes aren't stored.
+	 * @param xmlDoc The document.
+	 * @return The encoded document.
+	 */
+	static std::string encode(const TiXmlDocument& xmlDoc);
+
+	/**
+	 * @brief Decodes a document encoded by encode().
+	 * @param xmlDoc An empty document.
+	 * @param data The encoded data.
+	 * @param length The length of the data.
+	 * @return False if the data was invalid.
+	 */
+	static bool decode(TiXmlDocument& xmlDoc, const char* data, size_t length);
+
+	/**
+	 * @brief Calculates the hash used to check whether a source has changed.
+	 */
+	static uint64_t hash(const std::string& content);
+
+private:
+
+	struct Entry
+	{
+		int64_t modifiedTime;
+		uint64_t size;
+		uint64_t hash;
+
+		/**
+		 * @brief The encoded document, either in the mapped file or in ownedData.
+		 */
+		const char* data;
+		size_t length;
+
+		/**
+		 * @brief Set for entries which were stored during this session.
+		 *
+		 * This is shared so that a background write can keep using it.
+		 */
+		std::shared_ptr<const std::string> ownedData;
+	};
+
+	const std::string mPath;
+
+	/**
+	 * @brief The mapped cache file, if any.
+	 */
+	void* mMappedData;
+	size_t mMappedLength;
+
+	std::unordered_map<std::string, Entry> mEntries;
+
+	mutable std::mutex mMutex;
+
+	/**
+	 * @brief True if there are changes not yet written.
+	 */
+	bool mDirty;
+
+	std::thread mWriter;
+
+	/**
+	 * @brief Maps the cache file and reads its index.
+	 */
+	void open();
+
+	/**
+	 * @brief Reads the index of the mapped file.
+	 * @return False if the file is invalid.
+	 */
+	bool readIndex(const char* data, size_t length);
+
+	static void encodeNode(std::string& buffer, const TiXmlNode& node);
+	static bool decodeNodes(TiXmlNode& parent, const char*& data, const char* end);
+};
+
+}
+
+#endif /* XMLDOCUMENTCACHE_H_ */
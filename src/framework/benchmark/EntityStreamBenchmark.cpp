@@ -0,0 +1,326 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Exports a large synthetic world as a streamed dump, and imports it again into an empty world, reporting the time taken
+// and the peak memory used by each step. The world is generated by the server stand in as entities are asked for, so
+// that the server itself doesn't use any memory which grows with the world.
+//
+// The number of entities can be supplied as the first argument, and the dump file as the second, in which case it's
+// kept afterwards.
+
+#include "../EntityImporterBase.h"
+#include "../EntityExporterBase.h"
+
+#include <Atlas/MultiLineListFormatter.h>
+#include <Atlas/Objects/Anonymous.h>
+#include <Atlas/Objects/Operation.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace Ember;
+using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Entity::RootEntity;
+using Atlas::Objects::smart_dynamic_cast;
+
+namespace
+{
+typedef sigc::slot<void, const Atlas::Objects::Operation::RootOperation&> CallbackFunction;
+
+/**
+ * @brief A stand in for a server with a large world, which doesn't keep the entities in memory.
+ *
+ * When populated, entity n is contained in entity (n - 1) / FANOUT, which is all computed when the entity is asked for.
+ * When not populated only the world exists, and the entities created in it are checked against the same hierarchy.
+ */
+class SyntheticServer
+{
+public:
+	static const long FANOUT = 10;
+
+	/**
+	 * @brief The ids of created entities start here, so that they never are mistaken for entities in the dump.
+	 */
+	static const long CREATED_BASE = 100000000;
+
+	const long count;
+	const bool populated;
+	long nextSerialno;
+
+	/**
+	 * @brief The number of created entities which ended up in the wrong parent.
+	 */
+	size_t misplaced;
+
+	SyntheticServer(long count_, bool populated_) :
+			count(count_), populated(populated_), nextSerialno(1), misplaced(0)
+	{
+	}
+
+	void send(const Operation& op, const CallbackFunction& callback)
+	{
+		mSent.emplace_back(op, callback);
+	}
+
+	/**
+	 * @brief Handles all ops sent so far, and delivers the responses.
+	 * @return False if there were no ops to handle.
+	 */
+	bool roundTrip()
+	{
+		if (mSent.empty()) {
+			return false;
+		}
+		std::deque<std::pair<Operation, CallbackFunction>> sent;
+		sent.swap(mSent);
+		for (auto& entry : sent) {
+			Operation response = handle(entry.first);
+			response->setRefno(entry.first->getSerialno());
+			entry.second(response);
+		}
+		return true;
+	}
+
+private:
+	std::deque<std::pair<Operation, CallbackFunction>> mSent;
+
+	/**
+	 * @brief The number of the original entity for each created entity, indexed by created id minus CREATED_BASE.
+	 */
+	std::vector<long> mCreated;
+
+	RootEntity describe(long n)
+	{
+		Anonymous ent;
+		ent->setId(std::to_string(n));
+		ent->setAttr("n", n);
+		if (n == 0) {
+			ent->setParent("world");
+		} else {
+			ent->setParent("thing");
+			ent->setLoc(std::to_string((n - 1) / FANOUT));
+			ent->setAttr("description", std::string(128, 'x'));
+		}
+		if (populated) {
+			std::list<std::string> contains;
+			for (long child = n * FANOUT + 1; child <= n * FANOUT + FANOUT && child < count; ++child) {
+				contains.push_back(std::to_string(child));
+			}
+			ent->setContains(contains);
+		}
+		return ent;
+	}
+
+	Operation handle(const Operation& op)
+	{
+		auto classNo = op->getClassNo();
+		if (classNo == Atlas::Objects::Operation::LOOK_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(describe(0));
+			return sight;
+		} else if (classNo == Atlas::Objects::Operation::GET_NO) {
+			auto& id = op->getArgs().front()->getId();
+			if (id == "root") {
+				Atlas::Objects::Operation::Info info;
+				Anonymous rule;
+				rule->setId("root");
+				info->setArgs1(rule);
+				return info;
+			}
+			long n = std::strtol(id.c_str(), nullptr, 10);
+			if (id == "0" || (populated && n > 0 && n < count) || (!populated && n >= CREATED_BASE && n < CREATED_BASE + static_cast<long>(mCreated.size()))) {
+				Atlas::Objects::Operation::Info info;
+				info->setArgs1(describe(n));
+				return info;
+			}
+		} else if (classNo == Atlas::Objects::Operation::CREATE_NO) {
+			RootEntity arg = smart_dynamic_cast<RootEntity>(op->getArgs().front());
+			long n = arg->getAttr("n").asInt();
+			long loc = std::strtol(arg->getLoc().c_str(), nullptr, 10);
+			long parent = loc == 0 ? 0 : mCreated[loc - CREATED_BASE];
+			if (parent != (n - 1) / FANOUT) {
+				misplaced++;
+			}
+			Anonymous created;
+			created->setId(std::to_string(CREATED_BASE + mCreated.size()));
+			created->setParent(arg->getParent());
+			created->setLoc(arg->getLoc());
+			mCreated.push_back(n);
+			Atlas::Objects::Operation::Info info;
+			info->setArgs1(created);
+			return info;
+		} else if (classNo == Atlas::Objects::Operation::SET_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(op);
+			return sight;
+		}
+		return Atlas::Objects::Operation::Error();
+	}
+};
+
+class Importer: public EntityImporterBase
+{
+public:
+	SyntheticServer& server;
+	bool completed;
+
+	explicit Importer(SyntheticServer& server_) :
+			EntityImporterBase("1", "2"), server(server_), completed(false)
+	{
+		EventCompleted.connect([this]() {completed = true;});
+	}
+
+protected:
+	virtual long int newSerialNumber()
+	{
+		return server.nextSerialno++;
+	}
+
+	virtual void send(const Atlas::Objects::Operation::RootOperation& op)
+	{
+	}
+
+	virtual void sendAndAwaitResponse(const Atlas::Objects::Operation::RootOperation& op, CallbackFunction& callback)
+	{
+		server.send(op, callback);
+	}
+
+	virtual Atlas::Objects::Root loadFromFile(const std::string& filename)
+	{
+		return Atlas::Objects::Root();
+	}
+};
+
+class Exporter: public EntityExporterBase
+{
+public:
+	SyntheticServer& server;
+	bool completed;
+
+	explicit Exporter(SyntheticServer& server_) :
+			EntityExporterBase("1", "2", "0"), server(server_), completed(false)
+	{
+		EventCompleted.connect([this]() {completed = true;});
+	}
+
+protected:
+	virtual long int newSerialNumber()
+	{
+		return server.nextSerialno++;
+	}
+
+	virtual void send(const Atlas::Objects::Operation::RootOperation& op)
+	{
+	}
+
+	virtual void sendAndAwaitResponse(const Atlas::Objects::Operation::RootOperation& op, CallbackFunction& callback)
+	{
+		server.send(op, callback);
+	}
+
+	virtual Atlas::Formatter* createMultiLineFormatter(std::iostream& s, Atlas::Bridge& b)
+	{
+		return new Atlas::MultiLineListFormatter(s, b);
+	}
+
+	virtual void fillWithServerData(Atlas::Message::MapType& serverMap)
+	{
+		serverMap["name"] = "synthetic";
+	}
+};
+
+/**
+ * @brief Gets the peak memory used by the process, in kilobytes.
+ */
+long getPeakMemory()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+long long millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+	long count = 1000000;
+	if (argc > 1) {
+		count = std::strtol(argv[1], nullptr, 10);
+	}
+	std::string filename = "EntityStreamBenchmark.atlas";
+	bool keepFile = false;
+	if (argc > 2) {
+		filename = argv[2];
+		keepFile = true;
+	}
+
+	std::cout << "Streaming " << count << " entities through " << filename << "." << std::endl;
+
+	long memoryBefore = getPeakMemory();
+	auto start = std::chrono::steady_clock::now();
+	{
+		SyntheticServer server(count, true);
+		Exporter exporter(server);
+		exporter.setStreaming(true);
+		exporter.setFormat(EntityExporterBase::PACKED);
+		exporter.setPreserveIds(true);
+		exporter.start(filename);
+		while (server.roundTrip()) {
+		}
+		if (!exporter.completed || exporter.getStats().entitiesReceived != static_cast<unsigned int>(count)) {
+			std::cerr << "Export failed." << std::endl;
+			return 1;
+		}
+	}
+	long memoryAfterExport = getPeakMemory();
+	std::cout << "Export: " << millisecondsSince(start) << " ms, peak memory grew by " << (memoryAfterExport - memoryBefore) << " kB." << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	SyntheticServer server(count, false);
+	bool succeeded;
+	{
+		Importer importer(server);
+		importer.start(filename);
+		while (server.roundTrip()) {
+		}
+		succeeded = importer.completed && importer.getStats().entitiesCreateCount == static_cast<unsigned int>(count - 1) && server.misplaced == 0;
+	}
+	std::cout << "Import: " << millisecondsSince(start) << " ms, peak memory grew by " << (getPeakMemory() - memoryAfterExport) << " kB." << std::endl;
+
+	if (!keepFile) {
+		std::remove(filename.c_str());
+	}
+
+	if (!succeeded) {
+		std::cerr << "Import failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
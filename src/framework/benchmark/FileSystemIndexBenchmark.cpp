@@ -0,0 +1,107 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Creates a synthetic media tree with 100k files, half of them meshes, and compares scanning the whole tree in one thread,
+// which is what the media archives did for each query before they had an index, with building the index in parallel and
+// querying it.
+//
+// The directory can be supplied as the first argument, in which case it's kept afterwards and reused on the next run.
+
+#include "../FileSystemIndex.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace Ember;
+
+namespace
+{
+const int Directories = 50;
+const int Subdirectories = 20;
+const int FilesPerDirectory = 100;
+const size_t MeshCount = Directories * Subdirectories * FilesPerDirectory / 2;
+
+long long microsecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t countMeshes(const FileSystemIndex& index)
+{
+	size_t count = 0;
+	index.find("*.mesh", true, false, [&](const std::string&, const FileSystemIndex::Entry&) {count++;});
+	return count;
+}
+}
+
+int main(int argc, char** argv)
+{
+	bool keepDirectory = argc > 1;
+	std::string root = keepDirectory ? argv[1] : (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-fsindex-%%%%-%%%%")).string();
+
+	if (!boost::filesystem::exists(root)) {
+		std::cout << "Creating media tree in " << root << "." << std::endl;
+		for (int dir = 0; dir < Directories; ++dir) {
+			for (int subdir = 0; subdir < Subdirectories; ++subdir) {
+				std::string path = root + "/d" + std::to_string(dir) + "/s" + std::to_string(subdir);
+				boost::filesystem::create_directories(path);
+				for (int file = 0; file < FilesPerDirectory; ++file) {
+					std::ofstream(path + "/f" + std::to_string(file) + (file % 2 ? ".png" : ".mesh")) << "data";
+				}
+			}
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t serialCount;
+	{
+		FileSystemIndex index(root);
+		index.build(1);
+		serialCount = countMeshes(index);
+	}
+	long long serialTime = microsecondsSince(start);
+
+	FileSystemIndex index(root);
+	start = std::chrono::steady_clock::now();
+	index.build();
+	long long parallelTime = microsecondsSince(start);
+
+	const int queryCount = 100;
+	size_t queryCountResult = 0;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < queryCount; ++i) {
+		queryCountResult = countMeshes(index);
+	}
+	long long queryTime = microsecondsSince(start) / queryCount;
+
+	std::cout << index.getFileCount() << " files: serial scan " << serialTime << "us, parallel index build " << parallelTime << "us, indexed recursive find " << queryTime << "us" << std::endl;
+
+	if (!keepDirectory) {
+		boost::filesystem::remove_all(root);
+	}
+
+	if (serialCount != MeshCount || queryCountResult != MeshCount) {
+		std::cerr << "Expected " << MeshCount << " meshes, found " << serialCount << " when scanning and " << queryCountResult << " in the index." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares loading a set of model definition documents on a cold start, where all of them are parsed as XML and stored
+// in the document cache, with a warm start, where all of them are read from the cache.
+//
+// The number of documents can be supplied as the first argument.
+
+#include "../XMLDocumentCache.h"
+#include "../tinyxml/tinyxml.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Ember;
+
+namespace
+{
+/**
+ * @brief Creates a document resembling a modeldef file, with a number of models each with a number of parts.
+ */
+std::string createModelDefinition(int index)
+{
+	std::stringstream ss;
+	ss << "<?xml version=\"1.0\"?>\n<models>\n";
+	for (int model = 0; model < 4; ++model) {
+		ss << " <model name=\"model" << index << "_" << model << "\" scale=\"1.5\" usescaleof=\"height\">\n  <submodels>\n";
+		for (int part = 0; part < 5; ++part) {
+			ss << "   <submodel mesh=\"3d_objects/things/model" << index << "_" << part << ".mesh\"><parts><part name=\"part" << part << "\" show=\"true\">"
+					<< "<subentities><subentity index=\"0\" material=\"/global/things/material&amp;" << part << "\"/></subentities></part></parts></submodel>\n";
+		}
+		ss << "  </submodels>\n  <actions><action name=\"__movement_idle\"><animations><animation iterations=\"1\"><animationpart name=\"Idle\"/></animation></animations></action></actions>\n";
+		ss << "  <translate x=\"0\" y=\"1.5\" z=\"0\"/>\n  <rendering><![CDATA[<scheme>]]></rendering>\n </model>\n";
+	}
+	ss << "</models>\n";
+	return ss.str();
+}
+
+long long microsecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+	int documentCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+	const time_t modifiedTime = 1000;
+	boost::filesystem::path directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-xmlcache-%%%%-%%%%");
+	boost::filesystem::create_directories(directory);
+	const std::string path = (directory / "definitions.cache").string();
+
+	std::vector<std::string> sources;
+	for (int i = 0; i < documentCount; ++i) {
+		sources.push_back(createModelDefinition(i));
+	}
+
+	//Cold start: everything is parsed and stored.
+	auto start = std::chrono::steady_clock::now();
+	{
+		XMLDocumentCache cache(path);
+		for (int i = 0; i < documentCount; ++i) {
+			TiXmlDocument xmlDoc;
+			if (!cache.load(xmlDoc, std::to_string(i), modifiedTime, sources[i].size())) {
+				xmlDoc.Parse(sources[i].c_str());
+				cache.store(xmlDoc, std::to_string(i), modifiedTime, sources[i]);
+			}
+		}
+		cache.writeInBackground();
+	}
+	long long coldTime = microsecondsSince(start);
+
+	//Warm start: everything is read from the cache, without looking at the sources.
+	size_t hits = 0;
+	start = std::chrono::steady_clock::now();
+	{
+		XMLDocumentCache cache(path);
+		for (int i = 0; i < documentCount; ++i) {
+			TiXmlDocument xmlDoc;
+			if (cache.load(xmlDoc, std::to_string(i), modifiedTime, sources[i].size())) {
+				hits++;
+			}
+		}
+	}
+	long long warmTime = microsecondsSince(start);
+
+	boost::filesystem::remove_all(directory);
+
+	std::cout << documentCount << " definition documents: cold xml parsing " << coldTime << "us, warm cache " << warmTime << "us (" << hits << " hits)" << std::endl;
+	return hits == static_cast<size_t>(documentCount) ? 0 : 1;
+}
@@ -19,6 +19,8 @@
 #ifndef TASK_H_
 #define TASK_H_
 
+#include "framework/Profiler.h"
+
 #include <string>
 
 namespace Ember {
@@ -61,6 +63,21 @@ public:
 	 * @return The name of the task.
 	 */
 	virtual std::string getName() const = 0;
+
+	/**
+	 * @brief Gets the name of the task, as shown when profiling.
+	 * This is called each time the task is executed, so implementations should only intern the name once.
+	 * @return A name which has been passed through Profiler::intern().
+	 */
+	virtual const char* getProfileName() const { return Profiler::intern(getName()); };
+
+	/**
+	 * @brief Gets the priority of the task.
+	 * Tasks with higher priority will be processed before tasks with lower priority. This can for example be used to process things close to the camera first.
+	 * @note This is only consulted when the task is enqueued; changing the value afterwards has no effect.
+	 * @return The priority of the task. Defaults to 0.
+	 */
+	virtual int getPriority() const { return 0; };
 };
 
 }
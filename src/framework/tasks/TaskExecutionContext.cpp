@@ -18,13 +18,123 @@
 
 #include "TaskExecutionContext.h"
 #include "TaskExecutor.h"
+#include "TaskQueue.h"
 #include "TaskUnit.h"
-#include "ITask.h"
+#include "TemplateNamedTask.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
 
 namespace Ember
 {
 namespace Tasks
 {
+
+/**
+ * @brief Shared state for subtasks executed through TaskExecutionContext::executeTasksInParallel().
+ *
+ * Subtasks are claimed in order by any thread taking part in the execution, until all have been claimed.
+ */
+class ParallelTaskGroup
+{
+public:
+
+	ParallelTaskGroup(std::vector<TaskUnit*> taskUnits) :
+		mTaskUnits(std::move(taskUnits)), mNextIndex(0), mRemaining(mTaskUnits.size())
+	{
+	}
+
+	/**
+	 * @brief Claims and executes subtasks until there are none left to claim.
+	 * Any error is kept, to be rethrown by wait(), so that a failing subtask never leaves the parent waiting.
+	 * @param executor The executor of the calling thread.
+	 */
+	void execute(TaskExecutor& executor)
+	{
+		while (true) {
+			size_t index = mNextIndex++;
+			if (index >= mTaskUnits.size()) {
+				return;
+			}
+			std::exception_ptr error;
+			try {
+				TaskUnit* taskUnit = mTaskUnits[index];
+				auto start = std::chrono::steady_clock::now();
+				TaskExecutionContext context(executor, *taskUnit);
+				taskUnit->executeInBackgroundThread(context);
+				executor.getTaskQueue().recordExecution(taskUnit->getName(), std::chrono::steady_clock::duration::zero(), std::chrono::steady_clock::now() - start);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (error && !mError) {
+				mError = error;
+			}
+			if (--mRemaining == 0) {
+				mCondition.notify_all();
+			}
+		}
+	}
+
+	/**
+	 * @brief Waits until all subtasks have been executed.
+	 * If any subtask failed the first error is rethrown.
+	 */
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mCondition.wait(lock, [&] {return mRemaining == 0;});
+		if (mError) {
+			std::rethrow_exception(mError);
+		}
+	}
+
+private:
+	/**
+	 * @brief The subtasks. These are owned by the parent task unit.
+	 */
+	std::vector<TaskUnit*> mTaskUnits;
+	std::atomic<size_t> mNextIndex;
+	size_t mRemaining;
+
+	/**
+	 * @brief The first error thrown by any subtask.
+	 */
+	std::exception_ptr mError;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+};
+
+/**
+ * @brief Enqueued to let idle executors help out with executing a ParallelTaskGroup.
+ *
+ * If all subtasks already have been claimed by the time this is executed it will just do nothing.
+ */
+class ParallelHelperTask : public TemplateNamedTask<ParallelHelperTask>
+{
+public:
+
+	ParallelHelperTask(std::shared_ptr<ParallelTaskGroup> group) :
+		mGroup(std::move(group))
+	{
+	}
+
+	virtual void executeTaskInBackgroundThread(TaskExecutionContext& context)
+	{
+		mGroup->execute(context.mExecutor);
+		mGroup.reset();
+	}
+
+private:
+	std::shared_ptr<ParallelTaskGroup> mGroup;
+};
+
 TaskExecutionContext::TaskExecutionContext(TaskExecutor& executor, TaskUnit& taskUnit) :
 	mExecutor(executor), mTaskUnit(taskUnit)
 {
@@ -43,8 +153,10 @@ const TaskExecutor& TaskExecutionContext::getExecutor() const
 void TaskExecutionContext::executeTask(ITask* task, ITaskExecutionListener* listener)
 {
 	TaskUnit* taskUnit = mTaskUnit.addSubtask(task, listener);
+	auto start = std::chrono::steady_clock::now();
 	TaskExecutionContext subtaskContext(mExecutor, *taskUnit);
 	taskUnit->executeInBackgroundThread(subtaskContext);
+	mExecutor.getTaskQueue().recordExecution(taskUnit->getName(), std::chrono::steady_clock::duration::zero(), std::chrono::steady_clock::now() - start);
 }
 
 void TaskExecutionContext::executeTasks(std::vector<ITask*> tasks)
@@ -54,5 +166,34 @@ void TaskExecutionContext::executeTasks(std::vector<ITask*> tasks)
 	}
 }
 
+void TaskExecutionContext::executeTasksInParallel(std::vector<ITask*> tasks)
+{
+	if (tasks.size() < 2) {
+		executeTasks(tasks);
+		return;
+	}
+	//All subtask units are created here, so that the parent unit isn't altered from multiple threads.
+	std::vector<TaskUnit*> taskUnits;
+	for (auto task : tasks) {
+		taskUnits.push_back(mTaskUnit.addSubtask(task));
+	}
+	auto group = std::make_shared<ParallelTaskGroup>(std::move(taskUnits));
+
+	//Enqueue helpers with the highest priority, so that idle executors pick them up right away. We don't need more helpers than there are other executors.
+	TaskQueue& queue = mExecutor.getTaskQueue();
+	size_t helpers = std::min(tasks.size() - 1, queue.getNumberOfExecutors() - 1);
+	for (size_t i = 0; i < helpers; ++i) {
+		ParallelHelperTask* helper = new ParallelHelperTask(group);
+		if (!queue.enqueueTask(helper, nullptr, std::numeric_limits<int>::max())) {
+			delete helper;
+			break;
+		}
+	}
+
+	//This thread also takes part, which guarantees progress even if no helper ever gets to run.
+	group->execute(mExecutor);
+	group->wait();
+}
+
 }
 }
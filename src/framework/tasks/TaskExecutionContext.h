@@ -30,6 +30,8 @@ class TaskExecutor;
 class ITask;
 class TaskUnit;
 class ITaskExecutionListener;
+class ParallelTaskGroup;
+class ParallelHelperTask;
 
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
@@ -39,6 +41,7 @@ class ITaskExecutionListener;
  */
 class TaskExecutionContext
 {
+friend class ParallelHelperTask;
 public:
 
 	TaskExecutionContext(TaskExecutor& executor, TaskUnit& taskUnit);
@@ -67,6 +70,16 @@ public:
 	 */
 	void executeTasks(std::vector<ITask*> tasks);
 
+	/**
+	 * @brief Executes a series of independent subtasks in parallel, using any idle executors of the queue.
+	 * The call blocks until all subtasks have been executed in the background. The calling thread takes part in the execution, so this works even if all other executors are busy (in which case the subtasks are simply executed serially).
+	 * Just as with executeTasks() the subtasks are executed in the main thread, in order, before the main task is.
+	 * If executing any subtask throws, the first such error is rethrown once all subtasks have been executed.
+	 * @note The subtasks must not depend on each other, or access any shared data without synchronization. Any dependency within a subtask (such as work which must be done after other work) should be expressed by doing it as nested subtasks, in order, within that subtask.
+	 * @param tasks A list of tasks which will be executed.
+	 */
+	void executeTasksInParallel(std::vector<ITask*> tasks);
+
 
 private:
 
@@ -21,16 +21,16 @@
 #include "TaskExecutionContext.h"
 #include "TaskUnit.h"
 #include "framework/LoggingInstance.h"
+#include "framework/Profiler.h"
 
 namespace Ember
 {
 
 namespace Tasks
 {
-TaskExecutor::TaskExecutor(TaskQueue& taskQueue) :
-	mTaskQueue(taskQueue), mActive(true)
+TaskExecutor::TaskExecutor(TaskQueue& taskQueue, size_t index) :
+	mTaskQueue(taskQueue), mActive(true), mThread(nullptr), mIndex(index)
 {
-	mThread = new std::thread([&](){this->run();});
 }
 
 TaskExecutor::~TaskExecutor()
@@ -38,18 +38,31 @@ TaskExecutor::~TaskExecutor()
 	delete mThread;
 }
 
+void TaskExecutor::start()
+{
+	mThread = new std::thread([&](){this->run();});
+}
+
 void TaskExecutor::run()
 {
 #ifndef _WIN32
 	pthread_setname_np(pthread_self(), "Task Executor");
 #endif
+	Profiler::setThreadName("Task Executor " + std::to_string(mIndex));
 	while (mActive) {
-		TaskUnit* taskUnit = mTaskQueue.fetchNextTask();
+		std::chrono::steady_clock::time_point enqueued;
+		TaskUnit* taskUnit = mTaskQueue.fetchNextTask(*this, enqueued);
 		//If the queue returns a null pointer, it means that the queue is being shut down, and this executor is expected to exit its main processing loop.
 		if (taskUnit) {
 			try {
-				TaskExecutionContext context(*this, *taskUnit);
-				taskUnit->executeInBackgroundThread(context);
+				auto start = std::chrono::steady_clock::now();
+				const char* name = taskUnit->getProfileName();
+				{
+					ProfileZone zone(name);
+					TaskExecutionContext context(*this, *taskUnit);
+					taskUnit->executeInBackgroundThread(context);
+				}
+				mTaskQueue.recordExecution(name, start - enqueued, std::chrono::steady_clock::now() - start);
 				mTaskQueue.addProcessedTask(taskUnit);
 			} catch (const std::exception& ex) {
 				S_LOG_CRITICAL("Error when executing task in background." << ex);
@@ -71,7 +84,41 @@ void TaskExecutor::setActive(bool active)
 
 void TaskExecutor::join()
 {
-	mThread->join();
+	if (mThread) {
+		mThread->join();
+	}
+}
+
+TaskQueue& TaskExecutor::getTaskQueue() const
+{
+	return mTaskQueue;
+}
+
+void TaskExecutor::push(const QueueEntry& entry)
+{
+	std::unique_lock<std::mutex> lock(mLocalQueueMutex);
+	mLocalQueue.push(entry);
+}
+
+bool TaskExecutor::pop(QueueEntry& entry)
+{
+	std::unique_lock<std::mutex> lock(mLocalQueueMutex);
+	if (mLocalQueue.empty()) {
+		return false;
+	}
+	entry = mLocalQueue.top();
+	mLocalQueue.pop();
+	return true;
+}
+
+bool TaskExecutor::peekPriority(int& priority)
+{
+	std::unique_lock<std::mutex> lock(mLocalQueueMutex);
+	if (mLocalQueue.empty()) {
+		return false;
+	}
+	priority = mLocalQueue.top().priority;
+	return true;
 }
 
 }
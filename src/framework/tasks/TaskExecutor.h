@@ -20,6 +20,11 @@
 #define TASKEXECUTOR_H_
 
 #include <thread>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <cstdint>
 
 namespace Ember
 {
@@ -28,11 +33,16 @@ namespace Tasks
 {
 
 class TaskQueue;
+class TaskUnit;
 
 /**
  * @author Erik Ogenvik <erik@ogenvik.org>
  * @brief A task executor, responsible for processing tasks.
  * Each instance of this holds a thread. It's only purpose is to ask the queue for new tasks to process. If no tasks are available it will sleep (inside of TaskQueue::fetchNextTask).
+ *
+ * Each executor also owns a local queue of task units, ordered by priority and then by insertion order.
+ * The executor will primarily process tasks from its own queue, but if that is empty it will steal tasks from the queues of the other executors.
+ * This means that executors only contend for a lock when they actually access the same local queue.
  */
 class TaskExecutor
 {
@@ -55,8 +65,54 @@ public:
 	 */
 	void join();
 
+	/**
+	 * @brief Gets the queue to which this executor belongs.
+	 * @return The task queue.
+	 */
+	TaskQueue& getTaskQueue() const;
+
 protected:
 
+	/**
+	 * @brief An entry in the local queue.
+	 */
+	struct QueueEntry
+	{
+		/**
+		 * @brief The priority of the task. Higher values are processed first.
+		 */
+		int priority;
+
+		/**
+		 * @brief A sequence number, used to keep tasks with the same priority in FIFO order.
+		 */
+		std::uint64_t sequence;
+
+		/**
+		 * @brief The task unit.
+		 */
+		TaskUnit* taskUnit;
+
+		/**
+		 * @brief The time at which the task was enqueued, used for measuring how long it waited.
+		 */
+		std::chrono::steady_clock::time_point enqueued;
+
+		bool operator<(const QueueEntry& rhs) const
+		{
+			//std::priority_queue puts the "largest" element at the top; we want the highest priority, and then the lowest sequence number, there.
+			if (priority != rhs.priority) {
+				return priority < rhs.priority;
+			}
+			return sequence > rhs.sequence;
+		}
+	};
+
+	/**
+	 * @brief The local queue of the executor.
+	 */
+	typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>> LocalQueue;
+
 	/**
 	 * @brief The queue to which this executor belong.
 	 */
@@ -72,17 +128,63 @@ protected:
 	 */
 	std::thread* mThread;
 
+	/**
+	 * @brief The index of the executor in the queue's list of executors.
+	 * This is used to know where to start when looking for tasks to steal.
+	 */
+	size_t mIndex;
+
+	/**
+	 * @brief The local queue of tasks.
+	 * Only access this when holding mLocalQueueMutex.
+	 */
+	LocalQueue mLocalQueue;
+
+	/**
+	 * @brief A mutex protecting the local queue.
+	 */
+	std::mutex mLocalQueueMutex;
+
 	/**
 	 * @brief Ctor.
-	 * During construction a new thread will be created and executed.
+	 * The thread won't be created until start() is called.
 	 * @param taskQueue The queue to which this executor belongs.
+	 * @param index The index of the executor in the queue's list of executors.
+	 */
+	TaskExecutor(TaskQueue& taskQueue, size_t index);
+
+	/**
+	 * @brief Creates the thread and starts processing tasks.
+	 * This must only be called once all executors belonging to the queue have been created, since the executor will start to look for tasks to steal from the others.
 	 */
-	TaskExecutor(TaskQueue& taskQueue);
+	void start();
 
 	/**
 	 * @brief Main loop method.
 	 */
 	void run();
+
+	/**
+	 * @brief Pushes a task unit onto the local queue.
+	 * This can be called from any thread.
+	 * @param entry The entry to push.
+	 */
+	void push(const QueueEntry& entry);
+
+	/**
+	 * @brief Pops the task unit with the highest priority from the local queue.
+	 * This is used both by the executor itself, and by other executors stealing work.
+	 * @param entry The popped entry.
+	 * @return True if there was a task unit to pop.
+	 */
+	bool pop(QueueEntry& entry);
+
+	/**
+	 * @brief Peeks at the priority of the top task unit in the local queue.
+	 * @param priority The priority of the top entry.
+	 * @return True if the queue wasn't empty.
+	 */
+	bool peekPriority(int& priority);
 	//	void shutdown();
 };
 
@@ -23,20 +23,27 @@
 #include "TaskUnit.h"
 
 #include "framework/LoggingInstance.h"
+#include "framework/Profiler.h"
 
 #include <Eris/EventService.h>
 
+#include <algorithm>
+
 namespace Ember {
 
 namespace Tasks {
 
 TaskQueue::TaskQueue(unsigned int numberOfExecutors, Eris::EventService& eventService) :
-		mEventService(eventService), mActive(true), mIsQueuedOnMainThread(false) {
+		mEventService(eventService), mPendingTaskCount(0), mActive(true), mIsQueuedOnMainThread(false), mSequence(0), mNextExecutor(0), mCompletionTimeBudget(boost::posix_time::time_duration()) {
 	S_LOG_VERBOSE("Creating task queue with " << numberOfExecutors << " executors.");
 	for (unsigned int i = 0; i < numberOfExecutors; ++i) {
-		TaskExecutor* executor = new TaskExecutor(*this);
+		TaskExecutor* executor = new TaskExecutor(*this, i);
 		mExecutors.push_back(executor);
 	}
+	//Only start the executors once all of them have been created, since they will look at each other when stealing work.
+	for (auto executor : mExecutors) {
+		executor->start();
+	}
 }
 
 TaskQueue::~TaskQueue() {
@@ -51,24 +58,36 @@ void TaskQueue::deactivate() {
 		}
 		mUnprocessedQueueCond.notify_all();
 		//Join all executors. Since the queue is shutting down they will all exit their main loop if there are no more tasks to process.
+		//They can't be deleted until all of them have been joined, since those still running might be looking at the others when stealing work.
+		for (TaskExecutorStore::iterator I = mExecutors.begin(); I != mExecutors.end(); ++I) {
+			(*I)->join();
+		}
 		for (TaskExecutorStore::iterator I = mExecutors.begin(); I != mExecutors.end(); ++I) {
-			TaskExecutor* executor = *I;
-			executor->join();
-			delete executor;
+			delete *I;
 		}
+		mExecutors.clear();
 
 		//Finally we must process all of the tasks in our main loop. This of course requires that this instance is destroyed from the main loop.
 		mEventService.processAllHandlers();
 
 		assert(mProcessedTaskUnits.empty());
-		assert(mUnprocessedTaskUnits.empty());
+		assert(mMainThreadTaskUnits.empty());
+		assert(mPendingTaskCount == 0);
 	}
 }
 
 bool TaskQueue::enqueueTask(ITask* task, ITaskExecutionListener* listener) {
+	return enqueueTask(task, listener, task->getPriority());
+}
+
+bool TaskQueue::enqueueTask(ITask* task, ITaskExecutionListener* listener, int priority) {
 	std::unique_lock<std::mutex> l(mUnprocessedQueueMutex);
-	if (mActive) {
-		mUnprocessedTaskUnits.push(new TaskUnit(task, listener));
+	if (mActive && !mExecutors.empty()) {
+		//Distribute the tasks evenly among the executors; any imbalance will be evened out through work stealing.
+		TaskExecutor* executor = mExecutors[mNextExecutor];
+		mNextExecutor = (mNextExecutor + 1) % mExecutors.size();
+		executor->push(TaskExecutor::QueueEntry{priority, mSequence++, new TaskUnit(task, listener), std::chrono::steady_clock::now()});
+		++mPendingTaskCount;
 		mUnprocessedQueueCond.notify_one();
 		return true;
 	} else {
@@ -78,21 +97,50 @@ bool TaskQueue::enqueueTask(ITask* task, ITaskExecutionListener* listener) {
 
 }
 
-TaskUnit* TaskQueue::fetchNextTask() {
+TaskUnit* TaskQueue::fetchNextTask(TaskExecutor& executor, std::chrono::steady_clock::time_point& enqueued) {
 	//The semantics of this method is that if a null pointer is returned the task executor is required to exit its main processing loop, since this indicates that the queue is shuttin down.
-	TaskUnit* taskUnit(0);
-	std::unique_lock<std::mutex> lock(mUnprocessedQueueMutex);
-	if (mUnprocessedTaskUnits.empty()) {
-		if (!mActive) {
-			return 0;
+	TaskExecutor::QueueEntry entry;
+	while (true) {
+		if (executor.pop(entry) || stealTask(executor, entry)) {
+			--mPendingTaskCount;
+			enqueued = entry.enqueued;
+			return entry.taskUnit;
+		}
+		//No task could be found; sleep until a new one is enqueued. Since the pending count is only increased while holding the mutex we can't miss any notifications.
+		std::unique_lock<std::mutex> lock(mUnprocessedQueueMutex);
+		if (mPendingTaskCount == 0) {
+			if (!mActive) {
+				return nullptr;
+			}
+			mUnprocessedQueueCond.wait(lock);
 		}
-		mUnprocessedQueueCond.wait(lock);
 	}
-	if (!mUnprocessedTaskUnits.empty()) {
-		taskUnit = mUnprocessedTaskUnits.front();
-		mUnprocessedTaskUnits.pop();
+}
+
+bool TaskQueue::stealTask(TaskExecutor& thief, TaskExecutor::QueueEntry& entry) {
+	//Look through all other executors, and steal from the one which has the task with the highest priority.
+	//Since we don't hold any locks between peeking and popping the victim might have changed, but that's fine; we'll just try again.
+	while (mPendingTaskCount > 0) {
+		TaskExecutor* victim = nullptr;
+		int highestPriority = 0;
+		for (size_t i = 1; i < mExecutors.size(); ++i) {
+			TaskExecutor* candidate = mExecutors[(thief.mIndex + i) % mExecutors.size()];
+			int priority;
+			if (candidate->peekPriority(priority)) {
+				if (!victim || priority > highestPriority) {
+					victim = candidate;
+					highestPriority = priority;
+				}
+			}
+		}
+		if (!victim) {
+			return false;
+		}
+		if (victim->pop(entry)) {
+			return true;
+		}
 	}
-	return taskUnit;
+	return false;
 }
 
 void TaskQueue::addProcessedTask(TaskUnit* taskUnit) {
@@ -100,6 +148,7 @@ void TaskQueue::addProcessedTask(TaskUnit* taskUnit) {
 
 	mProcessedTaskUnits.push(taskUnit);
 	if (!mIsQueuedOnMainThread) {
+		mIsQueuedOnMainThread = true;
 		//Make sure that the task is handled on the main queue.
 		mEventService.runOnMainThread([this] {
 			processCompletedTasks();
@@ -112,52 +161,131 @@ bool TaskQueue::isActive() const {
 	return mActive;
 }
 
-void TaskQueue::processCompletedTasks() {
-	if (!mProcessedTaskUnits.empty()) {
-		TaskUnit* taskUnit;
-		{
-			std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
-			taskUnit = mProcessedTaskUnits.front();
-		}
-		try {
-			bool result = taskUnit->executeInMainThread();
-			if (result) {
-				try {
-					delete taskUnit;
-				} catch (const std::exception& ex) {
-					S_LOG_FAILURE("Error when deleting task in main thread." << ex);
-				} catch (...) {
-					S_LOG_FAILURE("Unknown error when deleting task in main thread.");
-				}
-				{
-					std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
-					mProcessedTaskUnits.pop();
-				}
-			}
+void TaskQueue::setCompletionTimeBudget(const boost::posix_time::time_duration& budget) {
+	mCompletionTimeBudget = budget;
+}
 
-		} catch (const std::exception& ex) {
-			S_LOG_FAILURE("Error when executing task in main thread." << ex);
-			//Task is broken; remove it
-			std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
-			mProcessedTaskUnits.pop();
-		} catch (...) {
-			S_LOG_FAILURE("Unknown error when executing task in main thread.");
-			//Task is broken; remove it
-			std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
+const boost::posix_time::time_duration& TaskQueue::getCompletionTimeBudget() const {
+	return mCompletionTimeBudget;
+}
+
+TaskQueue::CompletionStatistics TaskQueue::takeCompletionStatistics() {
+	CompletionStatistics statistics = mCompletionStatistics;
+	{
+		std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
+		statistics.backlog = mProcessedTaskUnits.size();
+	}
+	statistics.backlog += mMainThreadTaskUnits.size();
+	mCompletionStatistics = CompletionStatistics();
+	return statistics;
+}
+
+void TaskQueue::pollProcessedTasks() {
+	{
+		std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
+		while (!mProcessedTaskUnits.empty()) {
+			mMainThreadTaskUnits.push(mProcessedTaskUnits.front());
 			mProcessedTaskUnits.pop();
 		}
+	}
+	//Any handler already queued through the event service will find nothing to process, which is fine.
+	while (!mMainThreadTaskUnits.empty()) {
+		TaskUnit* taskUnit = mMainThreadTaskUnits.front();
+		if (executeInMainThread(taskUnit)) {
+			mMainThreadTaskUnits.pop();
+			mCompletionStatistics.unitsCompleted++;
+		}
+	}
+}
 
-		{
-			std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
-			if (!mProcessedTaskUnits.empty()) {
-				mEventService.runOnMainThread([this] {
-					processCompletedTasks();
-				});
-			} else {
-				mIsQueuedOnMainThread = false;
+size_t TaskQueue::getNumberOfExecutors() const {
+	return mExecutors.size();
+}
+
+void TaskQueue::recordExecution(const std::string& name, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration duration) {
+	long long waitMicros = std::chrono::duration_cast<std::chrono::microseconds>(wait).count();
+	long long durationMicros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+	std::unique_lock<std::mutex> lock(mExecutionStatisticsMutex);
+	ExecutionStatistics& statistics = mExecutionStatistics[name];
+	statistics.count++;
+	statistics.totalWait += waitMicros;
+	statistics.maxWait = std::max(statistics.maxWait, waitMicros);
+	statistics.totalExecution += durationMicros;
+	statistics.maxExecution = std::max(statistics.maxExecution, durationMicros);
+}
+
+std::map<std::string, TaskQueue::ExecutionStatistics> TaskQueue::getExecutionStatistics() const {
+	std::unique_lock<std::mutex> lock(mExecutionStatisticsMutex);
+	return mExecutionStatistics;
+}
+
+bool TaskQueue::executeInMainThread(TaskUnit* taskUnit) {
+	ProfileZone zone(taskUnit->getProfileName());
+	try {
+		bool result = taskUnit->executeInMainThread();
+		if (result) {
+			try {
+				delete taskUnit;
+			} catch (const std::exception& ex) {
+				S_LOG_FAILURE("Error when deleting task in main thread." << ex);
+			} catch (...) {
+				S_LOG_FAILURE("Unknown error when deleting task in main thread.");
 			}
 		}
+		return result;
+	} catch (const std::exception& ex) {
+		S_LOG_FAILURE("Error when executing task in main thread." << ex);
+	} catch (...) {
+		S_LOG_FAILURE("Unknown error when executing task in main thread.");
+	}
+	//Task is broken; remove it
+	return true;
+}
+
+void TaskQueue::processCompletedTasks() {
+	ProfileZone zone("Task completions");
+	TimeFrame timeFrame(mCompletionTimeBudget);
 
+	//Move all processed units over to the main thread queue in one go, so that we don't need to lock for each unit.
+	{
+		std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
+		if (mMainThreadTaskUnits.empty()) {
+			std::swap(mMainThreadTaskUnits, mProcessedTaskUnits);
+		} else {
+			while (!mProcessedTaskUnits.empty()) {
+				mMainThreadTaskUnits.push(mProcessedTaskUnits.front());
+				mProcessedTaskUnits.pop();
+			}
+		}
+	}
+
+	//If no budget is set, only one call is made for each handler run, as to interleave with other handlers.
+	//Otherwise process as many units as we can within the budget. Any unit which isn't done yet is kept first in the queue and called again, since it's expected to continue where it left off.
+	//We'll always do at least one call, to make sure that we progress.
+	size_t unitsCompleted = 0;
+	if (!mMainThreadTaskUnits.empty()) {
+		do {
+			TaskUnit* taskUnit = mMainThreadTaskUnits.front();
+			if (executeInMainThread(taskUnit)) {
+				mMainThreadTaskUnits.pop();
+				unitsCompleted++;
+			}
+		} while (mCompletionTimeBudget.ticks() > 0 && !mMainThreadTaskUnits.empty() && timeFrame.isTimeLeft());
+	}
+
+	mCompletionStatistics.unitsCompleted += unitsCompleted;
+	mCompletionStatistics.timeSpent += timeFrame.getElapsedTime();
+	mCompletionStatistics.batches++;
+
+	{
+		std::unique_lock<std::mutex> lock(mProcessedQueueMutex);
+		if (!mMainThreadTaskUnits.empty() || !mProcessedTaskUnits.empty()) {
+			mEventService.runOnMainThread([this] {
+				processCompletedTasks();
+			});
+		} else {
+			mIsQueuedOnMainThread = false;
+		}
 	}
 }
 
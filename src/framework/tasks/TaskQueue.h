@@ -20,11 +20,16 @@
 #define TASKQUEUE_H_
 
 #include "framework/TimeFrame.h"
+#include "TaskExecutor.h"
 
 #include <queue>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <map>
 #include <mutex>
+#include <string>
 
 namespace Eris
 {
@@ -53,12 +58,77 @@ class TaskUnit;
  *
  * Create an instance of this in your main thread, and then call pollProcessedTasks() from the same thread at a regular interval.
  * You must also make sure that you delete this instance in the main thread.
+ *
+ * Each executor has its own local queue of tasks. New tasks are distributed evenly among the executors, and any executor which runs out of tasks will steal from the others.
+ * Tasks can be given a priority, either through ITask::getPriority() or when calling enqueueTask(). Tasks with higher priority are processed before tasks with lower priority.
+ * Tasks with the same priority are processed in the order they were enqueued, as long as there's only one executor. With multiple executors the ordering is only approximate.
+ *
+ * Processed tasks are executed in the main thread through the event service. By default only one main thread call is done each time the event service runs the handler.
+ * If a completion time budget is set through setCompletionTimeBudget() processed tasks are instead executed in batches, until the budget is spent.
  */
 class TaskQueue
 {
 	friend class TaskExecutor;
 public:
 
+	/**
+	 * @brief Statistics for the processing of completed tasks in the main thread.
+	 */
+	struct CompletionStatistics
+	{
+		/**
+		 * @brief The number of task units which were completed.
+		 */
+		size_t unitsCompleted = 0;
+
+		/**
+		 * @brief The number of times the processing handler was run.
+		 */
+		size_t batches = 0;
+
+		/**
+		 * @brief The time spent executing tasks in the main thread.
+		 */
+		boost::posix_time::time_duration timeSpent;
+
+		/**
+		 * @brief The number of processed task units still waiting to be executed in the main thread.
+		 */
+		size_t backlog = 0;
+	};
+
+	/**
+	 * @brief Statistics for the background execution of all tasks with the same name.
+	 * All times are in microseconds.
+	 */
+	struct ExecutionStatistics
+	{
+		/**
+		 * @brief The number of times a task was executed.
+		 */
+		size_t count = 0;
+
+		/**
+		 * @brief The total time tasks spent in the queue before being picked up by an executor.
+		 */
+		long long totalWait = 0;
+
+		/**
+		 * @brief The longest time a task spent in the queue.
+		 */
+		long long maxWait = 0;
+
+		/**
+		 * @brief The total time spent executing tasks in background threads.
+		 */
+		long long totalExecution = 0;
+
+		/**
+		 * @brief The longest time spent executing a task in a background thread.
+		 */
+		long long maxExecution = 0;
+	};
+
 	/**
 	 * @brief Ctor.
 	 * @param numberOfExecutors The number of concurrent task executors to use.
@@ -80,6 +150,16 @@ public:
 	 */
 	bool enqueueTask(ITask* task, ITaskExecutionListener* listener = 0);
 
+	/**
+	 * @brief Adds a task to the queue, with an explicit priority.
+	 * This overrides any priority returned by ITask::getPriority().
+	 * @param task The task to add. Note that ownership will be transferred.
+	 * @param listener An optional listener. Note that ownership won't be transferred.
+	 * @param priority The priority of the task. Tasks with higher priority are processed first.
+	 * @return False if the task couldn't be enqueued, probably because the task queue is inactive.
+	 */
+	bool enqueueTask(ITask* task, ITaskExecutionListener* listener, int priority);
+
 	/**
 	 * @brief Deactivates the queue.
 	 *
@@ -96,6 +176,58 @@ public:
 	 */
 	bool isActive() const;
 
+	/**
+	 * @brief Sets the time budget for each run of main thread processing of completed tasks.
+	 * If set to zero (the default) only one main thread call will be made each time, after which processing is deferred to the next run of the event service handlers.
+	 * If set to something larger than zero all processed tasks will be executed in the main thread in one batch, until the budget is spent.
+	 * @note This should only be called from the main thread.
+	 * @param budget The time budget.
+	 */
+	void setCompletionTimeBudget(const boost::posix_time::time_duration& budget);
+
+	/**
+	 * @brief Gets the time budget for main thread processing of completed tasks.
+	 * @return The time budget.
+	 */
+	const boost::posix_time::time_duration& getCompletionTimeBudget() const;
+
+	/**
+	 * @brief Gets the statistics for the main thread processing of completed tasks since the last call to this method, and resets them.
+	 * Calling this once each frame will thus provide per-frame statistics.
+	 * @note This should only be called from the main thread.
+	 * @return Statistics gathered since the last call.
+	 */
+	CompletionStatistics takeCompletionStatistics();
+
+	/**
+	 * @brief Executes all processed task units in the main thread right away, without regard to any time budget.
+	 * This is useful when the main thread needs to wait for tasks to complete, such as when shutting down.
+	 * @note This must only be called from the main thread.
+	 */
+	void pollProcessedTasks();
+
+	/**
+	 * @brief Gets the number of executors.
+	 * @return The number of executors.
+	 */
+	size_t getNumberOfExecutors() const;
+
+	/**
+	 * @brief Records the background execution of a task.
+	 * This is called by the executors, and when subtasks are executed; it can be called from any thread.
+	 * @param name The name of the task.
+	 * @param wait The time the task waited in the queue.
+	 * @param duration The time it took to execute the task.
+	 */
+	void recordExecution(const std::string& name, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration duration);
+
+	/**
+	 * @brief Gets the background execution statistics, per task name, since the queue was created.
+	 * This can be called from any thread.
+	 * @return The statistics, keyed by task name.
+	 */
+	std::map<std::string, ExecutionStatistics> getExecutionStatistics() const;
+
 protected:
 
 	/**
@@ -111,9 +243,9 @@ protected:
 	Eris::EventService& mEventService;
 
 	/**
-	 * @brief A collection of unprocessed task units, which is a tuple of a task and a listener.
+	 * @brief The number of task units which are waiting in any of the executors' local queues.
 	 */
-	TaskUnitQueue mUnprocessedTaskUnits;
+	std::atomic<size_t> mPendingTaskCount;
 
 	/**
 	 * @brief A collection of processed task units. These will need to be executed in the main thread before they can be deleted.
@@ -121,16 +253,25 @@ protected:
 	 */
 	TaskUnitQueue mProcessedTaskUnits;
 
+	/**
+	 * @brief Processed task units which have been moved to the main thread, awaiting execution there.
+	 * This is only accessed from the main thread, and thus doesn't need any locking.
+	 */
+	TaskUnitQueue mMainThreadTaskUnits;
+
 	/**
 	 * @brief The executors used by the queue.
 	 */
 	TaskExecutorStore mExecutors;
 
 	/**
-	 * @brief A mutex used whenever the unprocessed queue is accessed.
+	 * @brief A mutex used when enqueuing new tasks, and when executors are waiting for new tasks.
 	 */
 	std::mutex mUnprocessedQueueMutex;
 
+	/**
+	 * @brief A mutex used whenever the processed queue is accessed.
+	 */
 	std::mutex mProcessedQueueMutex;
 
 	/**
@@ -149,13 +290,53 @@ protected:
 
 	bool mIsQueuedOnMainThread;
 
+	/**
+	 * @brief A sequence number given to each enqueued task, to keep tasks with the same priority in order.
+	 */
+	std::uint64_t mSequence;
+
+	/**
+	 * @brief The index of the executor which will get the next enqueued task.
+	 */
+	size_t mNextExecutor;
+
+	/**
+	 * @brief The time budget for each run of the main thread processing.
+	 * @see setCompletionTimeBudget()
+	 */
+	boost::posix_time::time_duration mCompletionTimeBudget;
+
+	/**
+	 * @brief Statistics gathered since the last call to takeCompletionStatistics().
+	 */
+	CompletionStatistics mCompletionStatistics;
+
+	/**
+	 * @brief Execution statistics per task name.
+	 * Only access this when holding mExecutionStatisticsMutex.
+	 */
+	std::map<std::string, ExecutionStatistics> mExecutionStatistics;
+
+	mutable std::mutex mExecutionStatisticsMutex;
+
 	/**
 	 * @brief Gets the next task to process.
 	 * @note This is normally only called by a TaskExecutor.
 	 * Calling this while there's no current tasks will result in the current thread being put on hold until a new task is enqueued.
+	 * @param executor The executor asking for a task. Its local queue will be checked first, and then the queues of the other executors.
+	 * @param enqueued Set to the time at which the returned task was enqueued.
 	 * @returns A pointer to a task unit, or a null pointer if the executor is expected to exit its processing loop (i.e. when the queue is being shut down).
 	 */
-	TaskUnit* fetchNextTask();
+	TaskUnit* fetchNextTask(TaskExecutor& executor, std::chrono::steady_clock::time_point& enqueued);
+
+	/**
+	 * @brief Steals a task from another executor.
+	 * The task with the highest priority among the other executors' queues will be stolen.
+	 * @param thief The executor which wants a task.
+	 * @param entry The stolen entry.
+	 * @return True if a task could be stolen.
+	 */
+	bool stealTask(TaskExecutor& thief, TaskExecutor::QueueEntry& entry);
 
 	/**
 	 * @brief Adds a processed task back to the queue, to be handled in the main thread and then deleted.
@@ -163,8 +344,19 @@ protected:
 	 */
 	void addProcessedTask(TaskUnit* taskUnit);
 
+	/**
+	 * @brief Executes processed task units in the main thread.
+	 * Depending on the completion time budget, this will process either one or many task units.
+	 */
 	void processCompletedTasks();
 
+	/**
+	 * @brief Executes a task unit in the main thread, deleting it if it's done.
+	 * @param taskUnit The task unit.
+	 * @return True if the task unit is done (or failed), and has been deleted.
+	 */
+	bool executeInMainThread(TaskUnit* taskUnit);
+
 };
 
 }
@@ -98,6 +98,14 @@ bool TaskUnit::executeInMainThread() {
 	return mTask->executeTaskInMainThread();
 }
 
+std::string TaskUnit::getName() const {
+	return mTask->getName();
+}
+
+const char* TaskUnit::getProfileName() const {
+	return mTask->getProfileName();
+}
+
 }
 
 }
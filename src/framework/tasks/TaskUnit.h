@@ -19,6 +19,7 @@
 #ifndef TASKUNIT_H_
 #define TASKUNIT_H_
 
+#include <string>
 #include <vector>
 
 namespace Ember
@@ -89,6 +90,18 @@ public:
 	 */
 	bool executeInMainThread();
 
+	/**
+	 * @brief Gets the name of the main task.
+	 * @return The name of the main task.
+	 */
+	std::string getName() const;
+
+	/**
+	 * @brief Gets the profiling name of the main task.
+	 * @return The profiling name of the main task.
+	 */
+	const char* getProfileName() const;
+
 private:
 
 	/**
@@ -44,6 +44,15 @@ public:
 		return typeid(T).name();
 	}
 
+	/**
+	 * @brief The name is only interned once for each task type.
+	 */
+	virtual const char* getProfileName() const
+	{
+		static const char* name = Profiler::intern(typeid(T).name());
+		return name;
+	}
+
 
 };
 
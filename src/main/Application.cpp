@@ -42,6 +42,7 @@
 #include "framework/FileResourceProvider.h"
 #include "framework/osdir.h"
 #include "framework/FileSystemObserver.h"
+#include "framework/Profiler.h"
 
 #include "components/lua/LuaScriptingProvider.h"
 #include "components/lua/Connectors.h"
@@ -85,6 +86,8 @@ TOLUA_API int tolua_Cegui_open(lua_State* tolua_S);
 #include <boost/thread.hpp>
 #include <framework/TimedLog.h>
 
+#include <sstream>
+
 #ifndef HAVE_SIGHANDLER_T
 
 typedef void (* sighandler_t)(int);
@@ -178,6 +181,7 @@ Application::Application(const std::string prefix, const std::string homeDir, co
 		mConfigSettings(configSettings),
 		mConsoleBackend(new ConsoleBackend()), Quit("quit", this, "Quit Ember."),
 		ToggleErisPolling("toggle_erispolling", this, "Switch server polling on and off."),
+		DumpProfile("dump_profile", this, "Writes the profiled zones of the last seconds to a file viewable in chrome://tracing. Usage: /dump_profile [seconds]"),
 		mScriptingResourceProvider(nullptr) {
 
 }
@@ -201,6 +205,8 @@ Application::~Application() {
 	delete mFileSystemObserver;
 	delete mSession;
 	S_LOG_INFO("Ember shut down normally.");
+	//Make sure that all queued messages are written before the observer is removed.
+	Log::setAsynchronous(false);
 	Log::removeObserver(mLogObserver);
 	delete mLogObserver;
 }
@@ -231,38 +237,56 @@ void Application::mainLoop() {
 	DesiredFpsListener desiredFpsListener;
 	Eris::EventService& eventService = mSession->getEventService();
 	Input& input(Input::getSingleton());
+	Profiler::setThreadName("Main");
 
 	do {
 		try {
+			ProfileZone frameZone("Frame");
 			Log::sCurrentFrameStartMilliseconds = microsec_clock::local_time();
 
 			unsigned int frameActionMask = 0;
 			boost::posix_time::microseconds desiredMicrosecondsPerFrame(desiredFpsListener.getMicrosecondsPerFrame());
 			TimeFrame timeFrame = TimeFrame(desiredMicrosecondsPerFrame);
 
-			mSession->getIoService().poll_one();
+			{
+				ProfileZone zone("Eris IO");
+				mSession->getIoService().poll_one();
+			}
 
-			eventService.processOneHandler();
+			{
+				ProfileZone zone("Main thread handlers");
+				eventService.processOneHandler();
+			}
 
 			if (mWorldView) {
+				ProfileZone zone("World view update");
 				mWorldView->update();
 			}
 
 
-			bool updatedRendering = mOgreView->renderOneFrame(timeFrame);
+			bool updatedRendering;
+			{
+				ProfileZone zone("Render");
+				updatedRendering = mOgreView->renderOneFrame(timeFrame);
+			}
 			if (updatedRendering) {
 				frameActionMask |= MainLoopController::FA_GRAPHICS;
 				frameActionMask |= MainLoopController::FA_INPUT;
 			} else {
+				ProfileZone zone("Input");
 				input.processInput();
 				frameActionMask |= MainLoopController::FA_INPUT;
 			}
 
-			mServices->getSoundService().cycle();
+			{
+				ProfileZone zone("Sound");
+				mServices->getSoundService().cycle();
+			}
 			frameActionMask |= MainLoopController::FA_SOUND;
 
 			//If there's time left this frame, poll any outstanding io handlers.
 			if (timeFrame.isTimeLeft()) {
+				ProfileZone zone("Eris IO");
 				size_t handersRun = 0;
 				do {
 					handersRun = mSession->getIoService().poll_one();
@@ -271,6 +295,7 @@ void Application::mainLoop() {
 
 			//If there's still time left this frame, process any outstanding main thread handlers.
 			if (timeFrame.isTimeLeft()) {
+				ProfileZone zone("Main thread handlers");
 				size_t handersRun = 0;
 				do {
 					handersRun = eventService.processOneHandler();
@@ -279,6 +304,7 @@ void Application::mainLoop() {
 
 			//And if there's yet still time left this frame, wait until time is up, and do io in the meantime.
 			if (timeFrame.isTimeLeft()) {
+				ProfileZone zone("Idle");
 				boost::asio::deadline_timer deadlineTimer(mSession->getIoService());
 				deadlineTimer.expires_at(boost::asio::time_traits<boost::posix_time::ptime>::now() + timeFrame.getRemainingTime());
 
@@ -290,10 +316,15 @@ void Application::mainLoop() {
 				}
 			}
 
-			mMainLoopController.EventFrameProcessed(timeFrame, frameActionMask);
+			{
+				ProfileZone zone("Frame processed");
+				mMainLoopController.EventFrameProcessed(timeFrame, frameActionMask);
+			}
 
-			if (timeFrame.getElapsedTime().total_microseconds() > (desiredMicrosecondsPerFrame.total_microseconds() * 1.4f)) {
-				S_LOG_VERBOSE("Frame took too long.");
+			long frameMicroseconds = timeFrame.getElapsedTime().total_microseconds();
+			mMainLoopController.recordFrameTime(frameMicroseconds);
+			if (frameMicroseconds > (desiredMicrosecondsPerFrame.total_microseconds() * 1.4f)) {
+				S_LOG_VERBOSE("Frame took too long (" << frameMicroseconds << " us).");
 			}
 
 		} catch (const boost::exception& ex) {
@@ -540,7 +571,34 @@ void Application::runCommand(const std::string& command, const std::string& args
 		mShouldQuit = true;
 	} else if (ToggleErisPolling == command) {
 		mPollEris = !mPollEris;
+	} else if (DumpProfile == command) {
+		int seconds = 10;
+		if (!args.empty()) {
+			try {
+				seconds = std::stoi(args);
+			} catch (const std::exception&) {
+				ConsoleBackend::getSingleton().pushMessage("Usage: /dump_profile [seconds]", "error");
+				return;
+			}
+		}
+		dumpProfile(seconds);
+	}
+}
+
+void Application::dumpProfile(int seconds) {
+	std::string path = mServices->getConfigService().getHomeDirectory(BaseDirType_DATA) + "profile.json";
+	std::ofstream stream(path);
+	if (!stream) {
+		S_LOG_FAILURE("Could not open '" << path << "' for writing the profile.");
+		return;
 	}
+	size_t zones = Profiler::writeChromeTrace(stream, std::chrono::seconds(seconds));
+
+	std::stringstream ss;
+	ss << "Wrote " << zones << " profiled zones to '" << path << "'. Frame times over the last " << mMainLoopController.getRecordedFrameCount() << " frames: p50 "
+			<< mMainLoopController.getFrameTimePercentile(50) << " us, p99 " << mMainLoopController.getFrameTimePercentile(99) << " us.";
+	S_LOG_INFO(ss.str());
+	ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
 }
 
 }
@@ -261,6 +261,12 @@ private:
 	 */
 	const ConsoleCommandWrapper ToggleErisPolling;
 
+	/**
+	 * @brief Writes the profiled zones of the last seconds to a file in the Chrome trace format, and logs a summary of the frame times.
+	 * The number of seconds can be supplied as an argument; it defaults to 10.
+	 */
+	const ConsoleCommandWrapper DumpProfile;
+
 	/**
 	 * @brief Provides resources to the scripting system.
 	 */
@@ -283,6 +289,12 @@ private:
 	 */
 	void startScripting();
 
+	/**
+	 * @brief Writes the profiled zones to a file in the Chrome trace format.
+	 * @param seconds How many seconds back zones should be written.
+	 */
+	void dumpProfile(int seconds);
+
 };
 }
 
@@ -66,12 +66,18 @@ void ConfigBoundLogObserver::updateFromConfig()
 			setDetailed(static_cast<bool>(detailed));
 		}
 	}
+	if (mConfigService.itemExists("general", "loggingasync")) {
+		varconf::Variable async = mConfigService.getValue("general", "loggingasync");
+		if (async.is_bool()) {
+			Log::setAsynchronous(static_cast<bool>(async));
+		}
+	}
 }
 
 void ConfigBoundLogObserver::ConfigService_EventChangedConfigItem(const std::string& section, const std::string& key)
 {
 	if (section == "general") {
-		if (key == "logginglevel" || key == "loggingdetailed") {
+		if (key == "logginglevel" || key == "loggingdetailed" || key == "loggingasync") {
 			updateFromConfig();
 		}
 	}
@@ -63,6 +63,7 @@ protected:
 	* @brief Updates from the config.
 	*
 	* The relevant section is "general" and the key "logginglevel". It can have the values of verbose|info|warning|failure|critical
+	* The keys "loggingdetailed" and "loggingasync" are also used, and are booleans.
 	*/
 	void updateFromConfig();
 	
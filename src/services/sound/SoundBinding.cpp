@@ -25,6 +25,8 @@
 #endif
 
 #include "SoundBinding.h"
+#include "SoundSource.h"
+#include "SoundGeneral.h"
 
 namespace Ember {
 
@@ -37,4 +39,10 @@ SoundBinding::~SoundBinding()
 {
 }
 
+void SoundBinding::setIsLooping(bool isLooping)
+{
+	alSourcei(mSource.getALSource(), AL_LOOPING, isLooping ? AL_TRUE : AL_FALSE);
+	SoundGeneral::checkAlError("Setting looping status.");
+}
+
 }
@@ -55,6 +55,27 @@ virtual ~SoundBinding();
  */
 virtual void update() = 0;
 
+/**
+ * @brief Sets whether the sound should loop.
+ * By default this sets the looping state of the OpenAL source. Streaming bindings can't let OpenAL handle the looping, and must instead loop the stream themselves.
+ * @param isLooping True if the sound should loop.
+ */
+virtual void setIsLooping(bool isLooping);
+
+/**
+ * @brief Called when the sound instance starts or stops playing.
+ * This allows streaming bindings to restart the source if it ran out of data while it was supposed to play.
+ * @param isPlaying True if the sound should be playing.
+ */
+virtual void setIsPlaying(bool isPlaying) {}
+
+/**
+ * @brief Checks if all sound data has been played.
+ * A stopped source is only considered to have played to completion if this is true; a streaming source might have stopped just because it ran out of data.
+ * @return True if there's no more data to play.
+ */
+virtual bool isComplete() const { return true; }
+
 protected:
 /**
  * @brief The SoundSource to which this binding is attached.
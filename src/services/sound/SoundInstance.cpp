@@ -30,8 +30,8 @@
 
 namespace Ember {
 
-SoundInstance::SoundInstance()
-: mSource(new SoundSource()), mBinding(0), mMotionProvider(0), mPreviousState(0)
+SoundInstance::SoundInstance(int priority)
+: mSource(new SoundSource()), mBinding(0), mMotionProvider(0), mPreviousState(0), mIsLooping(false), mPriority(priority)
 {
 }
 
@@ -48,7 +48,9 @@ void SoundInstance::bind(SoundBinding* binding)
 		//TODO: handle calling this when there's already a binder
 	}
 	mBinding = binding;
-
+	if (mBinding) {
+		mBinding->setIsLooping(mIsLooping);
+	}
 }
 
 SoundSource& SoundInstance::getSource()
@@ -61,6 +63,9 @@ bool SoundInstance::play()
 	alGetError();
 	alSourcePlay(mSource->getALSource());
 	mPreviousState = AL_PLAYING;
+	if (mBinding) {
+		mBinding->setIsPlaying(true);
+	}
 	return SoundGeneral::checkAlError("Playing sound instance.");
 }
 
@@ -68,6 +73,9 @@ bool SoundInstance::stop()
 {
 	alGetError();
 	alSourceStop(mSource->getALSource());
+	if (mBinding) {
+		mBinding->setIsPlaying(false);
+	}
 	return SoundGeneral::checkAlError("Stopping sound instance.");
 }
 
@@ -75,6 +83,9 @@ bool SoundInstance::pause()
 {
 	alGetError();
 	alSourcePause(mSource->getALSource());
+	if (mBinding) {
+		mBinding->setIsPlaying(false);
+	}
 	return SoundGeneral::checkAlError("Pausing sound instance.");
 }
 
@@ -91,7 +102,8 @@ void SoundInstance::update()
 			ALint alNewState;
 			alGetSourcei(mSource->getALSource(), AL_SOURCE_STATE, &alNewState);
 			SoundGeneral::checkAlError("Checking source state.");
-			if (alNewState == AL_STOPPED) {
+			//A streaming sound might have stopped only because it ran out of data, so check with the binding.
+			if (alNewState == AL_STOPPED && (!mBinding || mBinding->isComplete())) {
 				EventPlayComplete.emit();
 				mPreviousState = alNewState;
 			}
@@ -102,16 +114,23 @@ void SoundInstance::update()
 
 void SoundInstance::setIsLooping(bool isLooping)
 {
-	alSourcei(mSource->getALSource(), AL_LOOPING, isLooping ? AL_TRUE : AL_FALSE);
-	SoundGeneral::checkAlError("Setting looping status.");
+	mIsLooping = isLooping;
+	if (mBinding) {
+		mBinding->setIsLooping(isLooping);
+	} else {
+		alSourcei(mSource->getALSource(), AL_LOOPING, isLooping ? AL_TRUE : AL_FALSE);
+		SoundGeneral::checkAlError("Setting looping status.");
+	}
 }
 
 bool SoundInstance::getIsLooping() const
 {
-	ALint alValue;
-	alGetSourcei(mSource->getALSource(), AL_LOOPING, &alValue);
-	SoundGeneral::checkAlError("Checking looping status.");
-	return alValue == AL_TRUE;
+	return mIsLooping;
+}
+
+int SoundInstance::getPriority() const
+{
+	return mPriority;
 }
 
 void SoundInstance::setMaxDistance(float maxDistance)
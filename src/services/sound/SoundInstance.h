@@ -113,6 +113,19 @@ public:
 	 * This will only be emitted for sounds that aren't looping.
 	 */
 	sigc::signal<void> EventPlayComplete;
+
+	/**
+	 * @brief Emitted when the sound service is about to destroy this instance to give room for a sound with higher priority.
+	 * Any references to the instance must be dropped when this is emitted.
+	 */
+	sigc::signal<void> EventStolen;
+
+	/**
+	 * @brief Gets the priority of the sound.
+	 * When there are too many sounds playing, sounds with lower priority will be stopped to give room for sounds with higher priority.
+	 * @return The priority.
+	 */
+	int getPriority() const;
 	
 	/**
 	 * @brief Sets whether the sound should loop or not.
@@ -142,8 +155,9 @@ protected:
     /**
      * @brief Ctor. This is protected to allow only the SoundService to create instances.
      * An instance of SoundSource will automatically be created at construction.
+     * @param priority The priority of the sound.
      */
-    SoundInstance();
+    SoundInstance(int priority);
 
     /**
      * @brief Dtor. This is protected to allow only the SoundService to delete instances.
@@ -186,6 +200,17 @@ protected:
 	 */
 	int mPreviousState;
 
+	/**
+	 * @brief Whether the sound should loop.
+	 * This is kept here rather than queried from OpenAL, since streaming sounds handle looping themselves.
+	 */
+	bool mIsLooping;
+
+	/**
+	 * @brief The priority of the sound.
+	 */
+	int mPriority;
+
 };
 
 inline void SoundInstance::setMotionProvider(ISoundMotionProvider* motionProvider)
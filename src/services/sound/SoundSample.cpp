@@ -23,6 +23,10 @@
 #include "SoundSample.h"
 
 #include "SoundSource.h"
+#include "SoundStream.h"
+#include "SoundStreamDecoder.h"
+
+#include "framework/Exception.h"
 
 
 #include <AL/alut.h>
@@ -87,223 +91,148 @@ unsigned int StaticSoundSample::getNumberOfBuffers() const
 	return 1;
 }
 
-	// Streamed (OGG)
-// 	StreamedSoundSample::StreamedSoundSample(const std::string& filename, bool playsLocal, float volume)
-// 	{
-// 		mPlaying = false;
-// 		mType = SAMPLE_OGG;
-// 
-// 		FILE* newFile = fopen(filename.c_str(), "rb");
-// 		if (!newFile)
-// 		{
-// 			S_LOG_FAILURE("Failed to open file(" + filename + ") to stream.");
-// 			return;
-// 		}
-// 
-// 		mFile = newFile;
-// 		mFilename = filename;
-// 
-// 		if (ov_open(newFile, &mStream, nullptr, 0) < 0)
-// 		{
-// 			S_LOG_FAILURE("Failed to bind ogg stream to sound sample.");
-// 
-// 			fclose(newFile);
-// 			return;
-// 		}
-// 
-// 		vorbis_info* oggInfo = ov_info(&mStream, -1);
-// 		if (oggInfo->channels == 1)
-// 		{
-// 			mFormat = AL_FORMAT_MONO16;
-// 		}
-// 		else
-// 		{
-// 			mFormat = AL_FORMAT_STEREO16;
-// 		}
-// 
-// 		mRate = oggInfo->rate;
-// 
-// 		alGenBuffers(2, mBuffers);
-// 		if (alGetError() != AL_NO_ERROR)
-// 		{
-// 			S_LOG_FAILURE("Failed to bind ogg stream to sound sample.");
-// 
-// 			fclose(newFile);
-// 			return;
-// 		}
-// 
-// 		alGenSources(1, &mSource);
-// 		if (alGetError() != AL_NO_ERROR)
-// 		{
-// 			S_LOG_FAILURE("Failed to bind ogg stream to sound sample.");
-// 
-// 			alDeleteBuffers(2, mBuffers);
-// 			fclose(newFile);
-// 
-// 			return;
-// 		}
-// 
-// 		alSourcef(mSource, AL_PITCH, 1.0);
-// 		alSourcef(mSource, AL_GAIN, volume);
-// 		alSource3f(mSource, AL_POSITION, 0, 0, 0);
-// 		alSource3f(mSource, AL_VELOCITY, 0, 0, 0);
-// 		alSourcei(mSource, AL_LOOPING, false);
-// 
-// 		if (playsLocal == PLAY_LOCAL)
-// 			alSourcei(mSource, AL_SOURCE_RELATIVE, true);
-// 
-// 		// Ask the Sound Service to register us
-// 		// that we way we keep playing =]
-// 		EmberServices::getSingleton().getSoundService().registerStream(this);
-// 	}
-// 
-// 	StreamedSoundSample::~StreamedSoundSample()
-// 	{
-// 		EmberServices::getSingleton().getSoundService().unregisterStream(this);
-// 
-// 		alSourceStop(mSource);
-// 		checkAlError();
-// 
-// 		alDeleteSources(1, &mSource);
-// 		checkAlError();
-// 
-// 		alDeleteBuffers(2, mBuffers);
-// 		checkAlError();
-// 
-// 		ov_clear(&mStream);
-// 	}
-// 
-// 	const std::string& StreamedSoundSample::getFilename()
-// 	{
-// 		return mFilename;
-// 	}
-// 
-// 	void StreamedSoundSample::setPlaying(bool play)
-// 	{
-// 		mPlaying = play;
-// 	}
-// 
-// 	OggVorbis_File* StreamedSoundSample::getStreamPtr()
-// 	{
-// 		return &mStream;
-// 	}
-// 
-// 	ALuint* StreamedSoundSample::getBufferPtr()
-// 	{
-// 		return mBuffers;
-// 	}
-// 
-// 	bool StreamedSoundSample::isPlaying()
-// 	{
-// 		return mPlaying;
-// 	}
-// 
-// 	unsigned int StreamedSoundSample::getNumberOfBuffers()
-// 	{
-// 		return 2;
-// 	}
-// 
-// 	void StreamedSoundSample::cycle()
-// 	{
-// 		ALint processed;
-// 		bool active = true;
-// 		
-// 		alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
-// 		checkAlError();
-// 		while (processed > 0)
-// 		{
-// 			ALuint buffer;
-// 
-// 			alSourceUnqueueBuffers(mSource, 1, &buffer);
-// 			checkAlError();
-// 
-// 			active = stream(buffer);
-// 			if (!active)
-// 				break;
-// 
-// 			alSourceQueueBuffers(mSource, 1, &buffer);
-// 			checkAlError();
-// 
-// 			alGetSourcei(mSource, AL_BUFFERS_PROCESSED, &processed);
-// 			checkAlError();
-// 		}
-// 	}
-// 
-// 	bool StreamedSoundSample::stream(ALuint buffer)
-// 	{
-// 		char data[OGG_BUFFER_SIZE];
-// 		unsigned int size = 0;
-// 		int section;
-// 		int result;
-// 
-// 		while (size < OGG_BUFFER_SIZE)
-// 		{
-// 			#ifndef LITTLE_ENDIAN
-// 				result = ov_read(&mStream, data + size, OGG_BUFFER_SIZE - size, 1, 2, 1, &section);
-// 			#else
-// 				result = ov_read(&mStream, data + size, OGG_BUFFER_SIZE - size, 0, 2, 1, &section);
-// 			#endif
-// 
-// 			if (result > 0)
-// 			{
-// 				size += result;
-// 			}
-// 			else
-// 			{
-// 				if (result < 0)
-// 				{
-// 					S_LOG_FAILURE("Failed to read from ogg stream.");
-// 					return false;
-// 				}
-// 				else break;
-// 			}
-// 		}
-// 
-// 		// Stream is over
-// 		if (!size)
-// 		{
-// 			mPlaying = false;
-// 			return false;
-// 		}
-// 
-// 		alBufferData(buffer, mFormat, data, size, mRate);
-// 		checkAlError();
-// 
-// 		return true;
-// 	}
-// 		
-// 	void StreamedSoundSample::play()
-// 	{
-// 		// Already Playing
-// 		if (isPlaying())
-// 		{
-// 			return;
-// 		}
-// 
-// 		if (!stream(mBuffers[0]))
-// 		{
-// 			return;
-// 		}
-// 
-// 		if (!stream(mBuffers[1]))
-// 		{
-// 			return;
-// 		}
-// 
-// 		mPlaying = true;
-// 		alSourceQueueBuffers(mSource, 2, mBuffers);
-// 		checkAlError();
-// 
-// 		alSourcePlay(mSource);
-// 		checkAlError();
-// 	}
-// 
-// 	void StreamedSoundSample::stop()
-// 	{
-// 		mPlaying = false;
-// 		alSourceStop(mSource);
-// 		checkAlError();
-// 	}
+StreamedSoundSample::StreamedSoundSample(const ResourceWrapper& resource, SoundStreamDecoder& decoder)
+: mResource(resource), mDecoder(decoder), mFormat(AL_FORMAT_MONO16)
+{
+	mType = SoundGeneral::SAMPLE_OGG;
+	//Open the stream once to verify the data and get the format; each binding will then open its own stream.
+	SoundStream stream(mResource);
+	if (stream.getChannels() == 1) {
+		mFormat = AL_FORMAT_MONO16;
+	} else if (stream.getChannels() == 2) {
+		mFormat = AL_FORMAT_STEREO16;
+	} else {
+		throw Exception("Can't stream '" + mResource.getName() + "' since it has an unsupported number of channels.");
+	}
+}
+
+StreamedSoundSample::~StreamedSoundSample()
+{
+}
+
+unsigned int StreamedSoundSample::getNumberOfBuffers() const
+{
+	return NUMBER_OF_BUFFERS;
+}
+
+SoundBinding* StreamedSoundSample::createBinding(SoundSource& source)
+{
+	return new StreamedSoundBinding(source, *this, mDecoder);
+}
+
+BaseSoundSample::BufferStore StreamedSoundSample::getBuffers() const
+{
+	return BaseSoundSample::BufferStore();
+}
+
+const ResourceWrapper& StreamedSoundSample::getResource() const
+{
+	return mResource;
+}
+
+ALenum StreamedSoundSample::getFormat() const
+{
+	return mFormat;
+}
+
+
+StreamedSoundBinding::StreamedSoundBinding(SoundSource& source, StreamedSoundSample& sample, SoundStreamDecoder& decoder)
+: SoundBinding(source), mSample(sample), mDecoder(decoder), mStream(new SoundStream(sample.getResource())), mIsPlaying(false), mHasQueuedData(false), mCreationTime(std::chrono::steady_clock::now())
+{
+	alGenBuffers(StreamedSoundSample::NUMBER_OF_BUFFERS, mBuffers);
+	SoundGeneral::checkAlError("Generating buffers for streamed sound.");
+	mFreeBuffers.assign(mBuffers, mBuffers + StreamedSoundSample::NUMBER_OF_BUFFERS);
+
+	//Looping is handled by the stream, since a looping source never releases its queued buffers.
+	alSourcei(source.getALSource(), AL_LOOPING, AL_FALSE);
+	alSourcei(source.getALSource(), AL_BUFFER, 0);
+	SoundGeneral::checkAlError("Preparing source for streamed sound.");
+
+	mDecoder.addStream(mStream.get());
+}
+
+StreamedSoundBinding::~StreamedSoundBinding()
+{
+	//Make sure that the stream isn't being decoded before it's destroyed.
+	mDecoder.removeStream(mStream.get());
+
+	ALuint alSource = mSource.getALSource();
+	alSourceStop(alSource);
+	//Stopping marks all queued buffers as processed, so this will unqueue all of them.
+	alSourcei(alSource, AL_BUFFER, 0);
+	alDeleteBuffers(StreamedSoundSample::NUMBER_OF_BUFFERS, mBuffers);
+	SoundGeneral::checkAlError("Deleting streamed sound buffers.");
+}
+
+void StreamedSoundBinding::update()
+{
+	ALuint alSource = mSource.getALSource();
+
+	ALint state;
+	alGetSourcei(alSource, AL_SOURCE_STATE, &state);
+	ALint processed = 0;
+	alGetSourcei(alSource, AL_BUFFERS_PROCESSED, &processed);
+	ALint queued = 0;
+	alGetSourcei(alSource, AL_BUFFERS_QUEUED, &queued);
+	SoundGeneral::checkAlError("Querying streamed sound source.");
+
+	//If the source has played all queued buffers while there's still more data to come we've run out of decoded data.
+	bool isStarved = mIsPlaying && state == AL_STOPPED && queued > 0 && processed == queued && !mStream->isComplete();
+
+	while (processed > 0) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(alSource, 1, &buffer);
+		mFreeBuffers.push_back(buffer);
+		--processed;
+	}
+
+	bool hasQueued = false;
+	while (!mFreeBuffers.empty()) {
+		const SoundStream::Chunk* chunk = mStream->peekChunk();
+		if (!chunk) {
+			break;
+		}
+		ALuint buffer = mFreeBuffers.back();
+		alBufferData(buffer, mSample.getFormat(), chunk->data.data(), static_cast<ALsizei>(chunk->size), static_cast<ALsizei>(mStream->getRate()));
+		alSourceQueueBuffers(alSource, 1, &buffer);
+		mFreeBuffers.pop_back();
+		mStream->popChunk();
+		hasQueued = true;
+	}
+	SoundGeneral::checkAlError("Queuing streamed sound buffers.");
+
+	if (hasQueued) {
+		//There's now room in the stream for more data.
+		mDecoder.wake();
+		if (!mHasQueuedData) {
+			mHasQueuedData = true;
+			mDecoder.recordStartLatency(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mCreationTime).count());
+		}
+		//Either the source was started before any data was available, or it ran out of data; in both cases it needs to be started again.
+		if (mIsPlaying && state != AL_PLAYING && state != AL_PAUSED) {
+			if (isStarved) {
+				mDecoder.recordUnderrun();
+			}
+			alSourcePlay(alSource);
+			SoundGeneral::checkAlError("Restarting streamed sound.");
+		}
+	}
+}
+
+void StreamedSoundBinding::setIsLooping(bool isLooping)
+{
+	mStream->setIsLooping(isLooping);
+}
+
+void StreamedSoundBinding::setIsPlaying(bool isPlaying)
+{
+	mIsPlaying = isPlaying;
+}
+
+bool StreamedSoundBinding::isComplete() const
+{
+	return mStream->isComplete();
+}
 
 }
 
@@ -22,6 +22,8 @@
 #include "SoundGeneral.h"
 #include "SoundBinding.h"
 #include "framework/IResourceProvider.h"
+#include <chrono>
+#include <memory>
 #include <vector>
 
 #ifdef __APPLE__
@@ -36,6 +38,8 @@
 namespace Ember
 {
 class SoundSource;
+class SoundStream;
+class SoundStreamDecoder;
 
 
 /**
@@ -181,114 +185,165 @@ protected:
 
 
 /**
- * The class StreamedSoundSample is responsible to keep track of samples that often need updates and requires more than a buffer to stream data.
- *
- * \todo not implemented
+ * @brief A sound sample which is decoded bit by bit as it's played, instead of all at once.
+ * This is used for Ogg Vorbis data, such as music and long ambient sounds, which would take too much memory, and too long time, to decode into one buffer.
+ * The sample itself only holds the encoded data; each binding has its own decoding state and buffers, allowing the same sample to be played by multiple instances at once.
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class StreamedSoundSample : public BaseSoundSample
+{
+public:
+
+	/**
+	 * @brief The number of OpenAL buffers used for each binding.
+	 */
+	static const unsigned int NUMBER_OF_BUFFERS = 4;
+
+	/**
+	 * @brief Ctor.
+	 * @param resource Resource containing the Ogg Vorbis data.
+	 * @param decoder The decoder which will decode any bindings in a background thread.
+	 * @throws Exception If the resource doesn't contain valid Ogg Vorbis data, or if the data is in a format we can't play.
+	 */
+	StreamedSoundSample(const ResourceWrapper& resource, SoundStreamDecoder& decoder);
+
+	/**
+	 * @brief Dtor.
+	 */
+	~StreamedSoundSample();
+
+	/**
+	 * @brief Each binding has its own buffers, so this returns the number of buffers used by each binding.
+	 */
+	unsigned int getNumberOfBuffers() const;
+
+	/**
+	 * @copydoc BaseSoundSample::createBinding()
+	 */
+	virtual SoundBinding* createBinding(SoundSource& source);
+
+	/**
+	 * @brief Each binding has its own buffers, so this always returns an empty store.
+	 */
+	virtual BaseSoundSample::BufferStore getBuffers() const;
+
+	/**
+	 * @brief Gets the resource containing the encoded data.
+	 * @return The resource.
+	 */
+	const ResourceWrapper& getResource() const;
+
+	/**
+	 * @brief Gets the OpenAL format of the decoded data.
+	 * @return An OpenAL format.
+	 */
+	ALenum getFormat() const;
+
+private:
+
+	/**
+	 * @brief The resource wrapper instance which holds the encoded data.
+	 */
+	ResourceWrapper mResource;
+
+	/**
+	 * @brief The decoder which will decode any bindings.
+	 */
+	SoundStreamDecoder& mDecoder;
+
+	/**
+	 * @brief The OpenAL format of the decoded data.
+	 */
+	ALenum mFormat;
+};
+
+/**
+ * @brief A binding to a streamed sound sample.
+ * The sound data is decoded in a background thread into a small ring of chunks, through an instance of SoundStream. In update(), which is called each frame,
+ * any OpenAL buffers which have been played are refilled with decoded chunks and queued on the source again.
+ * Looping is handled by the stream rather than by OpenAL, since a looping OpenAL source never releases any queued buffers.
+ * @author Erik Ogenvik <erik@ogenvik.org>
  */
-// class StreamedSoundSample : public BaseSoundSample
-// {
-// 	private:
-// 		/**
-// 		 * Filename with full path to the data.
-// 		 */
-// 		std::string		mFilename;
-// 
-// 		/**
-// 		 * A pointer to the file specified in mFilename
-// 		 */
-// 		FILE*				mFile;
-// 
-// 		/**
-// 		 * VORBIS Internal Stream 
-// 		 */
-// 		OggVorbis_File mStream;
-// 
-// 		/**
-// 		 * Front and back buffers for openAl
-// 		 */
-// 		ALuint			mBuffers[2];
-// 
-// 		/**
-// 		 * Format of the stream (checked from ogg/vorbis)
-// 		 */
-// 		ALenum			mFormat;
-// 
-// 		/**
-// 		 * Rate of the stream (checked from ogg/vorbis)
-// 		 */
-// 		ALuint			mRate;
-// 
-// 		/**
-// 		 * If this stream is playing
-// 		 */
-// 		bool				mPlaying;
-// 
-// 		/**
-// 		 * This function is responsible to fill
-// 		 * buffers from stream data
-// 		 *
-// 		 * @param buffer The destination openAl buffer
-// 		 * @return Status of the streaming
-// 		 */
-// 		bool stream(ALuint buffer);
-// 
-// 	public:
-// 		StreamedSoundSample(const std::string& filename, bool playsLocal, float volume);
-// 		~StreamedSoundSample();
-// 
-// 		/**
-// 		 * Set the file to be used in stream proccess.
-// 		 *
-// 		 * @param ptr A pointer to the file.
-// 		 * @param filename The file name with full path.
-// 		 */
-// 		void setFile(FILE* ptr, const std::string& filename);
-// 
-// 		/**
-// 		 * Set stream format
-// 		 */
-// 		void setFormat(ALenum fmt);
-// 
-// 		/**
-// 		 * Set stream rate
-// 		 */
-// 		void setRate(ALuint rate);
-// 
-// 		/**
-// 		 * Set the stream status (if playing or not)
-// 		 */
-// 		void setPlaying(bool play);
-// 
-// 		/**
-// 		 * Returns a pointer to the buffers array
-// 		 */
-// 		ALuint*				getBufferPtr();
-// 
-// 		/**
-// 		 * Returns a pointer to the stream information (vorbis internals).
-// 		 */
-// 		OggVorbis_File*	getStreamPtr();
-// 
-// 		/**
-// 		 * Return the state of the stream.
-// 		 */
-// 		bool					isPlaying();
-// 
-// 		/**
-// 		 * Return the number of buffers in this stream. In this case this is 2.
-// 		 */
-// 		unsigned int		getNumberOfBuffers();
-// 
-// 		/**
-// 		 * Return the full filename of the stream file.
-// 		 */
-// 		const std::string& getFilename();
-// 
-// 		// Common methods
-// 		void play();	
-// 		void stop();
-// 		void cycle();				
-// };
+class StreamedSoundBinding : public SoundBinding
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * @param source The sound source.
+	 * @param sample The streamed sound sample to bind to the source.
+	 * @param decoder The decoder which will decode the stream in a background thread.
+	 */
+	StreamedSoundBinding(SoundSource& source, StreamedSoundSample& sample, SoundStreamDecoder& decoder);
+
+	/**
+	 * @brief Dtor.
+	 * The stream is removed from the decoder and all buffers are released.
+	 */
+	virtual ~StreamedSoundBinding();
+
+	/**
+	 * @brief Refills and queues any played buffers with decoded data.
+	 */
+	virtual void update();
+
+	/**
+	 * @copydoc SoundBinding::setIsLooping()
+	 */
+	virtual void setIsLooping(bool isLooping);
+
+	/**
+	 * @copydoc SoundBinding::setIsPlaying()
+	 */
+	virtual void setIsPlaying(bool isPlaying);
+
+	/**
+	 * @copydoc SoundBinding::isComplete()
+	 */
+	virtual bool isComplete() const;
+
+protected:
+
+	/**
+	 * @brief The streamed sound sample used for binding.
+	 */
+	StreamedSoundSample& mSample;
+
+	/**
+	 * @brief The decoder which decodes the stream.
+	 */
+	SoundStreamDecoder& mDecoder;
+
+	/**
+	 * @brief The stream holding the decoding state.
+	 */
+	std::unique_ptr<SoundStream> mStream;
+
+	/**
+	 * @brief All buffers owned by this binding.
+	 */
+	ALuint mBuffers[StreamedSoundSample::NUMBER_OF_BUFFERS];
+
+	/**
+	 * @brief Buffers which aren't currently queued on the source.
+	 */
+	std::vector<ALuint> mFreeBuffers;
+
+	/**
+	 * @brief True if the sound should be playing.
+	 */
+	bool mIsPlaying;
+
+	/**
+	 * @brief True once the first data has been queued.
+	 */
+	bool mHasQueuedData;
+
+	/**
+	 * @brief When the binding was created, used for measuring the start latency.
+	 */
+	std::chrono::steady_clock::time_point mCreationTime;
+};
 
 } // namespace Ember
 
@@ -26,11 +26,16 @@
 #include "services/EmberServices.h"
 #include "services/config/ConfigService.h"
 #include "framework/LoggingInstance.h"
+#include "framework/ConsoleBackend.h"
 
 #include "SoundSample.h"
 #include "SoundInstance.h"
+#include "SoundStream.h"
+#include "SoundStreamDecoder.h"
 
+#include <algorithm>
 #include <cstring>
+#include <sstream>
 
 #ifdef _MSC_VER
 //#include <ALUT/alut.h>
@@ -42,13 +47,13 @@ namespace Ember
 {
 /* Constructor */
 SoundService::SoundService()
-: Service("Sound")
+: Service("Sound"), Statistics("sound_statistics", this, "Prints statistics about the sound system.")
 #ifdef _MSC_VER
 	, mContext(0), mDevice(0), mResourceProvider(0)
 #else
 	, mResourceProvider(0)
 #endif
-, mEnabled(false)
+, mEnabled(false), mStreamDecoder(nullptr), mMaxInstances(32), mStolenInstances(0)
 {
 }
 
@@ -87,8 +92,16 @@ bool SoundService::start()
 		#endif
 		
 			SoundGeneral::checkAlError();
+
+			if (mEnabled) {
+				mStreamDecoder = new SoundStreamDecoder();
+			}
 		}
 	}
+
+	if (EmberServices::getSingleton().getConfigService().hasItem("audio", "maxinstances")) {
+		setMaxInstances(static_cast<int>(EmberServices::getSingleton().getConfigService().getValue("audio", "maxinstances")));
+	}
 	
 	setRunning(true);
 	return true;
@@ -107,6 +120,9 @@ void SoundService::stop()
 		delete I->second;
 	}
 	mBaseSamples.clear();
+
+	delete mStreamDecoder;
+	mStreamDecoder = nullptr;
 	
  	if (isEnabled()) {
  		#ifndef __WIN32__
@@ -130,46 +146,40 @@ bool SoundService::isEnabled() const
 
 void SoundService::runCommand(const std::string& command, const std::string& args)
 {
+	if (Statistics == command) {
+		SoundStatistics statistics = getStatistics();
+		std::stringstream ss;
+		ss << "Sound instances: " << statistics.instances << " of max " << mMaxInstances << ", " << statistics.stolenInstances << " stolen. "
+				<< "Streams: " << statistics.streams << " using " << statistics.streamBufferBytes << " bytes, " << statistics.decodedBytes << " bytes decoded, "
+				<< statistics.underruns << " underruns. Start latency: last " << statistics.lastStartLatency << " us, max " << statistics.maxStartLatency << " us.";
+		ConsoleBackend::getSingleton().pushMessage(ss.str(), "info");
+	}
 }
 
-void SoundService::registerStream(StreamedSoundSample* copy)
+SoundStatistics SoundService::getStatistics() const
 {
-/*		#ifdef THREAD_SAFE
-	pthread_mutex_lock(&mSamplesMutex);
-	#endif
-
-	mSamples.push_back(copy);
-
-	#ifdef THREAD_SAFE
-	pthread_mutex_unlock(&mSamplesMutex);
-	#endif*/
+	SoundStatistics statistics;
+	statistics.instances = mInstances.size();
+	statistics.stolenInstances = mStolenInstances;
+	statistics.streams = 0;
+	statistics.decodedBytes = 0;
+	statistics.underruns = 0;
+	statistics.lastStartLatency = 0;
+	statistics.maxStartLatency = 0;
+	if (mStreamDecoder) {
+		statistics.streams = mStreamDecoder->getNumberOfStreams();
+		statistics.decodedBytes = mStreamDecoder->getDecodedBytes();
+		statistics.underruns = mStreamDecoder->getUnderruns();
+		statistics.lastStartLatency = mStreamDecoder->getLastStartLatency();
+		statistics.maxStartLatency = mStreamDecoder->getMaxStartLatency();
+	}
+	statistics.streamBufferBytes = statistics.streams * SoundStream::getRingSize();
+	return statistics;
 }
 
-bool SoundService::unregisterStream(const StreamedSoundSample* sample)
+void SoundService::setMaxInstances(size_t maxInstances)
 {
-// 		#ifdef THREAD_SAFE
-// 		pthread_mutex_lock(&mSamplesMutex);
-// 		#endif
-// 	
-// 		std::list<StreamedSoundSample*>::iterator it;
-// 		for (it = mSamples.begin(); it != mSamples.end(); )
-// 		{
-// 			if ((*it) == sample)
-// 			{
-// 				it = mSamples.erase(it);
-// 				return true;
-// 			}
-// 			else
-// 			{
-// 				++it;
-// 			}
-// 		}
-// 
-// 		#ifdef THREAD_SAFE
-// 		pthread_mutex_unlock(&mSamplesMutex);
-// 		#endif
-
-	return false;
+	mMaxInstances = std::max<size_t>(maxInstances, 1);
 }
 
 void SoundService::updateListenerPosition(const WFMath::Point<3>& pos, const WFMath::Vector<3>& direction, const WFMath::Vector<3>& up)
@@ -215,7 +225,21 @@ BaseSoundSample* SoundService::createOrRetrieveSoundSample(const std::string& so
 	if (mResourceProvider) {
 		ResourceWrapper resWrapper = mResourceProvider->getResource(soundPath);
 		if (resWrapper.hasData()) {
-			StaticSoundSample* sample = new StaticSoundSample(resWrapper, false, 1.0);
+			BaseSoundSample* sample = nullptr;
+			//Ogg Vorbis files are typically music or long ambient sounds, so they are streamed rather than decoded all at once.
+			if (soundPath.size() > 4 && soundPath.compare(soundPath.size() - 4, 4, ".ogg") == 0) {
+				if (!mStreamDecoder) {
+					return 0;
+				}
+				try {
+					sample = new StreamedSoundSample(resWrapper, *mStreamDecoder);
+				} catch (const std::exception& ex) {
+					S_LOG_FAILURE("Could not create streamed sound sample for '" << soundPath << "'." << ex);
+					return 0;
+				}
+			} else {
+				sample = new StaticSoundSample(resWrapper, false, 1.0);
+			}
 			mBaseSamples.insert(SoundSampleStore::value_type(soundPath, sample));
 			return sample;
 		}
@@ -234,12 +258,29 @@ bool SoundService::destroySoundSample(const std::string& soundPath)
 	return false;
 }
 
-SoundInstance* SoundService::createInstance()
+SoundInstance* SoundService::createInstance(int priority)
 {
 	if (!isEnabled()) {
 		return 0;
 	}
-	SoundInstance* instance = new SoundInstance();
+	if (mInstances.size() >= mMaxInstances) {
+		//Find the instance with the lowest priority; the store is ordered by age, so the oldest will be chosen among equals.
+		SoundInstance* victim = nullptr;
+		for (auto instance : mInstances) {
+			if (instance->getPriority() <= priority && (!victim || instance->getPriority() < victim->getPriority())) {
+				victim = instance;
+			}
+		}
+		if (!victim) {
+			S_LOG_VERBOSE("Could not create sound instance with priority " << priority << " since all " << mInstances.size() << " instances have higher priority.");
+			return 0;
+		}
+		//Let the owner drop its references before destroying the instance. The owner might also destroy it itself.
+		victim->EventStolen.emit();
+		destroyInstance(victim);
+		mStolenInstances++;
+	}
+	SoundInstance* instance = new SoundInstance(priority);
 	mInstances.push_back(instance);
 	return instance;
 }
@@ -22,6 +22,7 @@
 
 #include "framework/Service.h"
 #include "framework/ConsoleObject.h"
+#include "framework/ConsoleCommandWrapper.h"
 
 #include <wfmath/vector.h>
 #include <wfmath/quaternion.h>
@@ -35,10 +36,56 @@
 namespace Ember {
 
 class IResourceProvider;
-class StreamedSoundSample;
 class SoundInstance;
 class SoundGroup;
 class BaseSoundSample;
+class SoundStreamDecoder;
+
+/**
+ * @brief Statistics about the sound system, mainly about memory use and latency of streaming sounds.
+ */
+struct SoundStatistics
+{
+	/**
+	 * @brief The number of live sound instances.
+	 */
+	size_t instances;
+
+	/**
+	 * @brief The number of sound instances which have been destroyed to give room for sounds with higher priority.
+	 */
+	unsigned int stolenInstances;
+
+	/**
+	 * @brief The number of sounds which are currently being streamed.
+	 */
+	size_t streams;
+
+	/**
+	 * @brief The memory used for decoded data by all current streams, in bytes.
+	 */
+	size_t streamBufferBytes;
+
+	/**
+	 * @brief The total number of bytes decoded by all streams.
+	 */
+	size_t decodedBytes;
+
+	/**
+	 * @brief The number of times any stream has run out of data while playing.
+	 */
+	unsigned int underruns;
+
+	/**
+	 * @brief The time from the most recent stream being created until its first data was queued, in microseconds.
+	 */
+	long lastStartLatency;
+
+	/**
+	 * @brief The largest time from any stream being created until its first data was queued, in microseconds.
+	 */
+	long maxStartLatency;
+};
 
 /**
  * @brief A service responsible for playing and managing sounds.
@@ -96,20 +143,6 @@ public:
 	 */
 	bool destroySoundSample(const std::string& soundPath);
 
-	/**
-	 * Register individual StreamedSamples to keep updated on the cycle calls
-	 * @param copy The StreamedSoundSample to be registered
-	 */
-	void registerStream(StreamedSoundSample* copy);
-
-	/**
-	 * Unregister streamed allocate sound buffers.
-	 * This will only remove it from the service list it will not deallocate the data.
-	 * @param sample A pointer to the sample to be unregistered
-	 * @return The status of the unregistration.
-	 */
-	bool unregisterStream(const StreamedSoundSample* sample);
-
 	/**
 	 * @brief Update the position (in world coordinates) of the listener
 	 * @param position The new listener position.
@@ -129,10 +162,12 @@ public:
 	 * @brief Creates a new SoundInstance.
 	 * Every time you want to play a sound you must create a SoundInstance and use that to play it. The only way to (normally) create such an instance is through this method. The sound service will keep track of all SoundInstance instances that are created, and will call SoundInstance::update() each frame, granted that SoundService::cycle() is called.
 	 * Ownership of the SoundInstance is held by the sound service, and as soon as you're finished with it you should immediately return it to the sound service through destroyInstance(). Under normal operations it's expected that there will only be a few SoundInstances in play at once.
-	 * @note If the sound system is disabled this will always return null, so make sure to check what you receive when calling this.
+	 * The number of instances is bounded, since each holds an OpenAL source. If there's no room for a new instance, the instance with the lowest priority which is not higher than the requested priority will be destroyed, after first emitting SoundInstance::EventStolen. Of those with the same priority, the oldest instance is chosen.
+	 * @note If the sound system is disabled, or if there's no room for another instance, this will return null, so make sure to check what you receive when calling this.
+	 * @param priority The priority of the sound.
 	 * @return A new SoundInstance instance, or null if no instance could be created or the sound system is disabled. Before you can play it, through SoundInstance::play(), you must bind it to a SoundSample.
 	 */
-	SoundInstance* createInstance();
+	SoundInstance* createInstance(int priority = 0);
 	
 	/**
 	 * @brief Destroys a SoundInstance.
@@ -162,6 +197,23 @@ public:
 	 */
 	bool isEnabled() const;
 
+	/**
+	 * @brief Gets statistics about the sound system.
+	 * @return Statistics about the sound system.
+	 */
+	SoundStatistics getStatistics() const;
+
+	/**
+	 * @brief Sets the max number of live sound instances.
+	 * @param maxInstances The max number of instances.
+	 */
+	void setMaxInstances(size_t maxInstances);
+
+	/**
+	 * @brief Prints statistics about the sound system.
+	 */
+	const ConsoleCommandWrapper Statistics;
+
 private:
 	
 	/**
@@ -199,6 +251,22 @@ private:
 	 * @see isEnabled()
 	 */
 	bool mEnabled;
+
+	/**
+	 * @brief Decodes streamed sounds in a background thread.
+	 * This is only available when the sound system is enabled.
+	 */
+	SoundStreamDecoder* mStreamDecoder;
+
+	/**
+	 * @brief The max number of live sound instances.
+	 */
+	size_t mMaxInstances;
+
+	/**
+	 * @brief The number of instances destroyed to give room for sounds with higher priority.
+	 */
+	unsigned int mStolenInstances;
 }; //SoundService
 
 } // namespace Ember
@@ -0,0 +1,213 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "SoundStream.h"
+
+#include "framework/LoggingInstance.h"
+#include "framework/Exception.h"
+
+#define OV_EXCLUDE_STATIC_CALLBACKS
+#include <vorbis/vorbisfile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace Ember
+{
+
+struct SoundStreamCallbacks
+{
+	static size_t read(void* ptr, size_t size, size_t nmemb, void* datasource)
+	{
+		SoundStream* stream = static_cast<SoundStream*>(datasource);
+		size_t available = stream->mResource.getSize() - stream->mReadPosition;
+		size_t bytes = std::min(size * nmemb, available);
+		memcpy(ptr, stream->mResource.getDataPtr() + stream->mReadPosition, bytes);
+		stream->mReadPosition += bytes;
+		return size ? bytes / size : 0;
+	}
+
+	static int seek(void* datasource, ogg_int64_t offset, int whence)
+	{
+		SoundStream* stream = static_cast<SoundStream*>(datasource);
+		ogg_int64_t newPosition;
+		switch (whence) {
+		case SEEK_SET:
+			newPosition = offset;
+			break;
+		case SEEK_CUR:
+			newPosition = stream->mReadPosition + offset;
+			break;
+		case SEEK_END:
+			newPosition = stream->mResource.getSize() + offset;
+			break;
+		default:
+			return -1;
+		}
+		if (newPosition < 0 || newPosition > static_cast<ogg_int64_t>(stream->mResource.getSize())) {
+			return -1;
+		}
+		stream->mReadPosition = static_cast<size_t>(newPosition);
+		return 0;
+	}
+
+	static long tell(void* datasource)
+	{
+		return static_cast<long>(static_cast<SoundStream*>(datasource)->mReadPosition);
+	}
+};
+
+SoundStream::SoundStream(const ResourceWrapper& resource) :
+		mResource(resource), mReadPosition(0), mFile(new OggVorbis_File()), mChannels(0), mRate(0), mReadIndex(0), mWriteIndex(0), mDecodedCount(0), mEndOfStream(false), mIsLooping(false)
+{
+	ov_callbacks callbacks;
+	callbacks.read_func = &SoundStreamCallbacks::read;
+	callbacks.seek_func = &SoundStreamCallbacks::seek;
+	callbacks.close_func = nullptr;
+	callbacks.tell_func = &SoundStreamCallbacks::tell;
+
+	int result = ov_open_callbacks(this, mFile, nullptr, 0, callbacks);
+	if (result < 0) {
+		delete mFile;
+		throw Exception("Could not open '" + mResource.getName() + "' as an Ogg Vorbis stream.");
+	}
+
+	vorbis_info* info = ov_info(mFile, -1);
+	mChannels = info->channels;
+	mRate = info->rate;
+
+	for (auto& chunk : mChunks) {
+		chunk.data.resize(CHUNK_SIZE);
+		chunk.size = 0;
+	}
+}
+
+SoundStream::~SoundStream()
+{
+	ov_clear(mFile);
+	delete mFile;
+}
+
+int SoundStream::getChannels() const
+{
+	return mChannels;
+}
+
+long SoundStream::getRate() const
+{
+	return mRate;
+}
+
+void SoundStream::setIsLooping(bool isLooping)
+{
+	mIsLooping = isLooping;
+}
+
+bool SoundStream::needsDecoding() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return !mEndOfStream && mDecodedCount < NUMBER_OF_CHUNKS;
+}
+
+size_t SoundStream::decodeChunk()
+{
+	unsigned int writeIndex;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mEndOfStream || mDecodedCount == NUMBER_OF_CHUNKS) {
+			return 0;
+		}
+		writeIndex = mWriteIndex;
+	}
+
+	//The chunk at the write index isn't visible to the consumer until it's published below, so it can be written to without holding the lock.
+	Chunk& chunk = mChunks[writeIndex];
+	size_t size = 0;
+	bool endOfStream = false;
+	bool hasRewound = false;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	const int bigEndian = 1;
+#else
+	const int bigEndian = 0;
+#endif
+	while (size < CHUNK_SIZE) {
+		int section;
+		long result = ov_read(mFile, chunk.data.data() + size, static_cast<int>(CHUNK_SIZE - size), bigEndian, 2, 1, &section);
+		if (result > 0) {
+			size += result;
+			hasRewound = false;
+		} else if (result == 0) {
+			//Only rewind once in a row, to avoid spinning on empty streams.
+			if (mIsLooping && !hasRewound && ov_pcm_seek(mFile, 0) == 0) {
+				hasRewound = true;
+			} else {
+				endOfStream = true;
+				break;
+			}
+		} else if (result != OV_HOLE) {
+			S_LOG_FAILURE("Error when decoding Ogg Vorbis stream '" << mResource.getName() << "': " << result);
+			endOfStream = true;
+			break;
+		}
+	}
+	chunk.size = size;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (size > 0) {
+		mWriteIndex = (mWriteIndex + 1) % NUMBER_OF_CHUNKS;
+		mDecodedCount++;
+	}
+	mEndOfStream = endOfStream;
+	return size;
+}
+
+const SoundStream::Chunk* SoundStream::peekChunk() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mDecodedCount == 0) {
+		return nullptr;
+	}
+	return &mChunks[mReadIndex];
+}
+
+void SoundStream::popChunk()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mDecodedCount > 0) {
+		mReadIndex = (mReadIndex + 1) % NUMBER_OF_CHUNKS;
+		mDecodedCount--;
+	}
+}
+
+bool SoundStream::isComplete() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mEndOfStream && mDecodedCount == 0;
+}
+
+size_t SoundStream::getRingSize()
+{
+	return NUMBER_OF_CHUNKS * CHUNK_SIZE;
+}
+
+}
@@ -0,0 +1,202 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBER_SOUNDSTREAM_H
+#define EMBER_SOUNDSTREAM_H
+
+#include "framework/IResourceProvider.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct OggVorbis_File;
+
+namespace Ember
+{
+
+/**
+ * @brief Decodes an Ogg Vorbis resource into a small ring of PCM chunks.
+ *
+ * The decoding is meant to happen in a background thread, through decodeChunk(), while the decoded chunks are consumed from the main thread
+ * through peekChunk() and popChunk(). Only one thread may decode, and only one thread may consume.
+ * The ring is bounded, so the memory used by a stream never exceeds NUMBER_OF_CHUNKS * CHUNK_SIZE bytes of PCM data, regardless of the length of the sound.
+ *
+ * This class doesn't interact with OpenAL at all; that's the responsibility of StreamedSoundBinding.
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class SoundStream
+{
+public:
+
+	/**
+	 * @brief The max size, in bytes, of each decoded chunk.
+	 */
+	static const size_t CHUNK_SIZE = 32768;
+
+	/**
+	 * @brief The number of chunks in the ring.
+	 */
+	static const unsigned int NUMBER_OF_CHUNKS = 4;
+
+	/**
+	 * @brief A chunk of decoded 16 bit PCM data.
+	 */
+	struct Chunk
+	{
+		std::vector<char> data;
+
+		/**
+		 * @brief The number of valid bytes in data.
+		 */
+		size_t size;
+	};
+
+	/**
+	 * @brief Ctor.
+	 * @param resource The resource holding the Ogg Vorbis data. The data will be read directly from the resource, which is kept alive by the stream.
+	 * @throws Exception If the data couldn't be parsed as Ogg Vorbis.
+	 */
+	explicit SoundStream(const ResourceWrapper& resource);
+
+	/**
+	 * @brief Dtor.
+	 * Make sure that the stream isn't being decoded when this is called.
+	 */
+	~SoundStream();
+
+	/**
+	 * @brief Gets the number of channels in the stream.
+	 * @return The number of channels.
+	 */
+	int getChannels() const;
+
+	/**
+	 * @brief Gets the sample rate of the stream.
+	 * @return The sample rate, in hz.
+	 */
+	long getRate() const;
+
+	/**
+	 * @brief Sets whether the stream should start over from the beginning once it has been fully decoded.
+	 * @param isLooping True if the stream should loop.
+	 */
+	void setIsLooping(bool isLooping);
+
+	/**
+	 * @brief Checks if there's room for more decoded data.
+	 *
+	 * This can be called from any thread.
+	 * @return True if decodeChunk() would decode more data.
+	 */
+	bool needsDecoding() const;
+
+	/**
+	 * @brief Decodes one chunk, if there's room for it in the ring.
+	 *
+	 * This should be called from the decoding thread.
+	 * @return The number of decoded bytes, or 0 if nothing was decoded.
+	 */
+	size_t decodeChunk();
+
+	/**
+	 * @brief Gets the oldest decoded chunk, without removing it.
+	 *
+	 * This should be called from the consuming thread.
+	 * @return The oldest decoded chunk, or null if there are none.
+	 */
+	const Chunk* peekChunk() const;
+
+	/**
+	 * @brief Removes the oldest decoded chunk, giving room for more decoding.
+	 *
+	 * This should be called from the consuming thread, after the data from peekChunk() has been used.
+	 */
+	void popChunk();
+
+	/**
+	 * @brief Checks if all data has been decoded and consumed.
+	 * @return True if the end of a non looping stream has been reached, and all chunks have been consumed.
+	 */
+	bool isComplete() const;
+
+	/**
+	 * @brief Gets the number of bytes the ring can hold.
+	 * @return The size of the ring, in bytes.
+	 */
+	static size_t getRingSize();
+
+private:
+
+	/**
+	 * @brief The resource holding the encoded data.
+	 */
+	ResourceWrapper mResource;
+
+	/**
+	 * @brief The current read position in the encoded data.
+	 */
+	size_t mReadPosition;
+
+	/**
+	 * @brief The Vorbis decoder state.
+	 */
+	OggVorbis_File* mFile;
+
+	int mChannels;
+
+	long mRate;
+
+	Chunk mChunks[NUMBER_OF_CHUNKS];
+
+	/**
+	 * @brief The index of the oldest decoded chunk.
+	 */
+	unsigned int mReadIndex;
+
+	/**
+	 * @brief The index of the next chunk to decode into.
+	 */
+	unsigned int mWriteIndex;
+
+	/**
+	 * @brief The number of decoded, but not yet consumed, chunks.
+	 */
+	unsigned int mDecodedCount;
+
+	/**
+	 * @brief True if the end of the data has been reached.
+	 */
+	bool mEndOfStream;
+
+	std::atomic<bool> mIsLooping;
+
+	/**
+	 * @brief Guards the ring indices and the end of stream flag.
+	 */
+	mutable std::mutex mMutex;
+
+	/**
+	 * @brief Provides the Vorbis decoder with access to the data in mResource.
+	 */
+	friend struct SoundStreamCallbacks;
+};
+
+}
+
+#endif /* EMBER_SOUNDSTREAM_H */
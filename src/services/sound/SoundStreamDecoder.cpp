@@ -0,0 +1,146 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "SoundStreamDecoder.h"
+#include "SoundStream.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Ember
+{
+
+SoundStreamDecoder::SoundStreamDecoder() :
+		mDecodingStream(nullptr), mHasWork(false), mIsRunning(true), mDecodedBytes(0), mUnderruns(0), mLastStartLatency(0), mMaxStartLatency(0)
+{
+	mThread = std::thread(&SoundStreamDecoder::run, this);
+}
+
+SoundStreamDecoder::~SoundStreamDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mIsRunning = false;
+	}
+	mCondition.notify_all();
+	mThread.join();
+}
+
+void SoundStreamDecoder::addStream(SoundStream* stream)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStreams.push_back(stream);
+		mHasWork = true;
+	}
+	mCondition.notify_all();
+}
+
+void SoundStreamDecoder::removeStream(SoundStream* stream)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStreams.erase(std::remove(mStreams.begin(), mStreams.end(), stream), mStreams.end());
+	mDecodedCondition.wait(lock, [&] {return mDecodingStream != stream;});
+}
+
+void SoundStreamDecoder::wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mHasWork = true;
+	}
+	mCondition.notify_all();
+}
+
+void SoundStreamDecoder::recordUnderrun()
+{
+	mUnderruns++;
+}
+
+void SoundStreamDecoder::recordStartLatency(long microseconds)
+{
+	mLastStartLatency = microseconds;
+	long currentMax = mMaxStartLatency;
+	while (microseconds > currentMax && !mMaxStartLatency.compare_exchange_weak(currentMax, microseconds)) {
+	}
+}
+
+size_t SoundStreamDecoder::getNumberOfStreams() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStreams.size();
+}
+
+size_t SoundStreamDecoder::getDecodedBytes() const
+{
+	return mDecodedBytes;
+}
+
+unsigned int SoundStreamDecoder::getUnderruns() const
+{
+	return mUnderruns;
+}
+
+long SoundStreamDecoder::getLastStartLatency() const
+{
+	return mLastStartLatency;
+}
+
+long SoundStreamDecoder::getMaxStartLatency() const
+{
+	return mMaxStartLatency;
+}
+
+void SoundStreamDecoder::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (mIsRunning) {
+		mHasWork = false;
+		//Decode one chunk at a time from each stream in turn, so that no stream is starved by another.
+		bool didDecode = true;
+		while (didDecode && mIsRunning) {
+			didDecode = false;
+			//Streams might be added or removed while we're decoding, so work on a copy.
+			std::vector<SoundStream*> streams(mStreams);
+			for (auto stream : streams) {
+				if (std::find(mStreams.begin(), mStreams.end(), stream) == mStreams.end()) {
+					continue;
+				}
+				//The lock is released while decoding, so that the main thread never has to wait for it. Marking the stream as being decoded prevents it from being destroyed meanwhile.
+				mDecodingStream = stream;
+				lock.unlock();
+				size_t bytes = stream->decodeChunk();
+				lock.lock();
+				mDecodingStream = nullptr;
+				mDecodedCondition.notify_all();
+				if (bytes) {
+					mDecodedBytes += bytes;
+					didDecode = true;
+				}
+			}
+		}
+		//The timeout is only a safeguard; normally we'll be woken through wake().
+		mCondition.wait_for(lock, std::chrono::milliseconds(100), [&] {return mHasWork || !mIsRunning;});
+	}
+}
+
+}
@@ -0,0 +1,167 @@
+/*
+ Copyright (C) 2016 Erik Ogenvik <erik@ogenvik.org>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software Foundation,
+ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef EMBER_SOUNDSTREAMDECODER_H
+#define EMBER_SOUNDSTREAMDECODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ember
+{
+
+class SoundStream;
+
+/**
+ * @brief Decodes all active sound streams in a background thread.
+ *
+ * Streams are registered through addStream() and will from then on be kept filled. Whenever data has been consumed from a stream, call wake() so that it's refilled as soon as possible.
+ *
+ * The decoder also keeps counters of the streaming, which can be used to monitor memory use and latency.
+ * @author Erik Ogenvik <erik@ogenvik.org>
+ */
+class SoundStreamDecoder
+{
+public:
+
+	/**
+	 * @brief Ctor.
+	 * The decoding thread is started here.
+	 */
+	SoundStreamDecoder();
+
+	/**
+	 * @brief Dtor.
+	 * The decoding thread is stopped here. Any streams still registered will be left as they are.
+	 */
+	~SoundStreamDecoder();
+
+	/**
+	 * @brief Registers a stream to be decoded.
+	 * @param stream The stream. Ownership isn't transferred.
+	 */
+	void addStream(SoundStream* stream);
+
+	/**
+	 * @brief Unregisters a stream.
+	 *
+	 * When this returns the stream isn't being decoded, and can safely be destroyed.
+	 * If the stream is being decoded when this is called this waits for the decoding of the current chunk to finish.
+	 * @param stream The stream.
+	 */
+	void removeStream(SoundStream* stream);
+
+	/**
+	 * @brief Wakes the decoding thread, to refill any streams which have had data consumed.
+	 */
+	void wake();
+
+	/**
+	 * @brief Records that a stream ran out of data while playing.
+	 */
+	void recordUnderrun();
+
+	/**
+	 * @brief Records the time it took from a stream being created until its first data was queued for playback.
+	 * @param microseconds The latency in microseconds.
+	 */
+	void recordStartLatency(long microseconds);
+
+	/**
+	 * @brief Gets the number of registered streams.
+	 * @return The number of registered streams.
+	 */
+	size_t getNumberOfStreams() const;
+
+	/**
+	 * @brief Gets the total number of bytes decoded.
+	 * @return The total number of decoded bytes.
+	 */
+	size_t getDecodedBytes() const;
+
+	/**
+	 * @brief Gets the number of times any stream has run out of data while playing.
+	 * @return The number of underruns.
+	 */
+	unsigned int getUnderruns() const;
+
+	/**
+	 * @brief Gets the start latency of the most recently started stream.
+	 * @return The latency in microseconds.
+	 */
+	long getLastStartLatency() const;
+
+	/**
+	 * @brief Gets the largest start latency of any stream.
+	 * @return The latency in microseconds.
+	 */
+	long getMaxStartLatency() const;
+
+private:
+
+	/**
+	 * @brief The registered streams.
+	 */
+	std::vector<SoundStream*> mStreams;
+
+	/**
+	 * @brief The stream currently being decoded, if any.
+	 */
+	SoundStream* mDecodingStream;
+
+	/**
+	 * @brief Guards mStreams and mDecodingStream. This isn't held while decoding, so that the main thread never has to wait for that.
+	 */
+	mutable std::mutex mMutex;
+
+	std::condition_variable mCondition;
+
+	/**
+	 * @brief Signalled whenever a stream has been decoded, so that removeStream() can wait for a stream to not be decoded.
+	 */
+	std::condition_variable mDecodedCondition;
+
+	/**
+	 * @brief Set when there might be more work to do, to prevent missed wakeups.
+	 */
+	bool mHasWork;
+
+	bool mIsRunning;
+
+	std::atomic<size_t> mDecodedBytes;
+
+	std::atomic<unsigned int> mUnderruns;
+
+	std::atomic<long> mLastStartLatency;
+
+	std::atomic<long> mMaxStartLatency;
+
+	std::thread mThread;
+
+	/**
+	 * @brief The main loop of the decoding thread.
+	 */
+	void run();
+};
+
+}
+
+#endif /* EMBER_SOUNDSTREAMDECODER_H */
@@ -0,0 +1,741 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "framework/EntityImporterBase.h"
+#include "framework/EntityExporterBase.h"
+#include "framework/EntityDumpReader.h"
+#include "framework/OperationWindow.h"
+
+#include <Atlas/MultiLineListFormatter.h>
+#include <Atlas/Objects/Anonymous.h>
+#include <Atlas/Objects/Operation.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+using Atlas::Objects::Entity::Anonymous;
+using Atlas::Objects::Entity::RootEntity;
+using Atlas::Objects::smart_dynamic_cast;
+
+namespace Ember
+{
+
+/**
+ * @brief A stand in for the server, which handles ops in the order they were sent, one round trip at a time.
+ *
+ * Only the ops used by the importer and exporter are handled.
+ */
+class LoopbackServer
+{
+public:
+	typedef sigc::slot<void, const Atlas::Objects::Operation::RootOperation&> CallbackFunction;
+
+	struct Entity
+	{
+		std::string parent;
+		std::string loc;
+		std::list<std::string> contains;
+	};
+
+	std::map<std::string, Entity> entities;
+	long nextId;
+	long nextSerialno;
+	size_t outstanding;
+	size_t peakOutstanding;
+	int roundTrips;
+
+	LoopbackServer() :
+			nextId(1000), nextSerialno(1), outstanding(0), peakOutstanding(0), roundTrips(0)
+	{
+		entities["0"] = Entity { "world", "", { } };
+	}
+
+	virtual ~LoopbackServer()
+	{
+	}
+
+	void addEntity(const std::string& id, const std::string& parent, const std::string& loc)
+	{
+		entities[id] = Entity { parent, loc, { } };
+		entities[loc].contains.push_back(id);
+	}
+
+	void send(const Operation& op, const CallbackFunction& callback)
+	{
+		mSent.emplace_back(op, callback);
+		outstanding++;
+		peakOutstanding = std::max(peakOutstanding, outstanding);
+	}
+
+	/**
+	 * @brief Handles all ops sent so far, and delivers the responses.
+	 *
+	 * Any ops sent while handling the responses will be handled in the next round trip.
+	 * @return False if there were no ops to handle.
+	 */
+	bool roundTrip()
+	{
+		if (mSent.empty()) {
+			return false;
+		}
+		roundTrips++;
+		std::deque<std::pair<Operation, CallbackFunction>> sent;
+		sent.swap(mSent);
+		for (auto& entry : sent) {
+			outstanding--;
+			Operation response = handle(entry.first);
+			response->setRefno(entry.first->getSerialno());
+			entry.second(response);
+		}
+		return true;
+	}
+
+protected:
+	std::deque<std::pair<Operation, CallbackFunction>> mSent;
+
+	static Operation describeRootRule()
+	{
+		Atlas::Objects::Operation::Info info;
+		Anonymous rule;
+		rule->setId("root");
+		info->setArgs1(rule);
+		return info;
+	}
+
+	RootEntity describe(const std::string& id)
+	{
+		auto& entity = entities[id];
+		Anonymous ent;
+		ent->setId(id);
+		ent->setParent(entity.parent);
+		if (!entity.loc.empty()) {
+			ent->setLoc(entity.loc);
+		}
+		ent->setContains(entity.contains);
+		return ent;
+	}
+
+	virtual Operation handle(const Operation& op)
+	{
+		auto classNo = op->getClassNo();
+		if (classNo == Atlas::Objects::Operation::LOOK_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(describe("0"));
+			return sight;
+		} else if (classNo == Atlas::Objects::Operation::GET_NO) {
+			auto& id = op->getArgs().front()->getId();
+			if (entities.find(id) != entities.end()) {
+				Atlas::Objects::Operation::Info info;
+				info->setArgs1(describe(id));
+				return info;
+			} else if (id == "root") {
+				return describeRootRule();
+			}
+		} else if (classNo == Atlas::Objects::Operation::CREATE_NO) {
+			RootEntity arg = smart_dynamic_cast<RootEntity>(op->getArgs().front());
+			std::stringstream ss;
+			ss << nextId++;
+			addEntity(ss.str(), arg->getParent(), arg->getLoc());
+			Atlas::Objects::Operation::Info info;
+			info->setArgs1(describe(ss.str()));
+			return info;
+		} else if (classNo == Atlas::Objects::Operation::SET_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(op);
+			return sight;
+		}
+		return Atlas::Objects::Operation::Error();
+	}
+};
+
+/**
+ * @brief A stand in for a server with a large world, which doesn't keep the entities in memory.
+ *
+ * When populated, entity n is contained in entity (n - 1) / FANOUT, which is all computed when the entity is asked for.
+ * When not populated only the world exists, and the entities created in it are checked against the same hierarchy.
+ */
+class SyntheticServer: public LoopbackServer
+{
+public:
+	static const long FANOUT = 10;
+
+	/**
+	 * @brief The ids of created entities start here, so that they never are mistaken for entities in the dump.
+	 */
+	static const long CREATED_BASE = 100000000;
+
+	const long count;
+	const bool populated;
+
+	/**
+	 * @brief The number of created entities which ended up in the wrong parent.
+	 */
+	size_t misplaced;
+
+	SyntheticServer(long count_, bool populated_) :
+			count(count_), populated(populated_), misplaced(0)
+	{
+	}
+
+protected:
+
+	/**
+	 * @brief The number of the original entity for each created entity, indexed by created id minus CREATED_BASE.
+	 */
+	std::vector<long> mCreated;
+
+	RootEntity describe(long n)
+	{
+		Anonymous ent;
+		ent->setId(std::to_string(n));
+		ent->setAttr("n", n);
+		if (n == 0) {
+			ent->setParent("world");
+		} else {
+			ent->setParent("thing");
+			ent->setLoc(std::to_string((n - 1) / FANOUT));
+			ent->setAttr("description", std::string(128, 'x'));
+		}
+		if (populated) {
+			std::list<std::string> contains;
+			for (long child = n * FANOUT + 1; child <= n * FANOUT + FANOUT && child < count; ++child) {
+				contains.push_back(std::to_string(child));
+			}
+			ent->setContains(contains);
+		}
+		return ent;
+	}
+
+	virtual Operation handle(const Operation& op)
+	{
+		auto classNo = op->getClassNo();
+		if (classNo == Atlas::Objects::Operation::LOOK_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(describe(0));
+			return sight;
+		} else if (classNo == Atlas::Objects::Operation::GET_NO) {
+			auto& id = op->getArgs().front()->getId();
+			if (id == "root") {
+				return describeRootRule();
+			}
+			long n = std::strtol(id.c_str(), nullptr, 10);
+			if (id == "0" || (populated && n > 0 && n < count) || (!populated && n >= CREATED_BASE && n < CREATED_BASE + static_cast<long>(mCreated.size()))) {
+				Atlas::Objects::Operation::Info info;
+				info->setArgs1(describe(n));
+				return info;
+			}
+		} else if (classNo == Atlas::Objects::Operation::CREATE_NO) {
+			RootEntity arg = smart_dynamic_cast<RootEntity>(op->getArgs().front());
+			long n = arg->getAttr("n").asInt();
+			long loc = std::strtol(arg->getLoc().c_str(), nullptr, 10);
+			long parent = loc == 0 ? 0 : mCreated[loc - CREATED_BASE];
+			if (parent != (n - 1) / FANOUT) {
+				misplaced++;
+			}
+			Anonymous created;
+			created->setId(std::to_string(CREATED_BASE + mCreated.size()));
+			created->setParent(arg->getParent());
+			created->setLoc(arg->getLoc());
+			mCreated.push_back(n);
+			Atlas::Objects::Operation::Info info;
+			info->setArgs1(created);
+			return info;
+		} else if (classNo == Atlas::Objects::Operation::SET_NO) {
+			Atlas::Objects::Operation::Sight sight;
+			sight->setArgs1(op);
+			return sight;
+		}
+		return Atlas::Objects::Operation::Error();
+	}
+};
+
+/**
+ * @brief A stand in for a server which refuses to create entities of the type "broken".
+ */
+class FailingServer: public LoopbackServer
+{
+protected:
+	virtual Operation handle(const Operation& op)
+	{
+		if (op->getClassNo() == Atlas::Objects::Operation::CREATE_NO && op->getArgs().front()->getParent() == "broken") {
+			return Atlas::Objects::Operation::Error();
+		}
+		return LoopbackServer::handle(op);
+	}
+};
+
+class LoopbackImporter: public EntityImporterBase
+{
+public:
+	LoopbackServer& server;
+	Atlas::Objects::Root dump;
+	bool completed;
+
+	LoopbackImporter(LoopbackServer& server_, const Atlas::Objects::Root& dump_) :
+			EntityImporterBase("1", "2"), server(server_), dump(dump_), completed(false)
+	{
+		EventCompleted.connect([this]() {completed = true;});
+	}
+
+	size_t getWindowSize() const
+	{
+		return mEntityWindow.getSize();
+	}
+
+	std::string getRestoredId(const std::string& persistedId) const
+	{
+		auto I = mEntityIdMap.find(persistedId);
+		if (I != mEntityIdMap.end()) {
+			return I->second;
+		}
+		return persistedId;
+	}
+
+protected:
+	virtual long int newSerialNumber()
+	{
+		return server.nextSerialno++;
+	}
+
+	virtual void send(const Atlas::Objects::Operation::RootOperation& op)
+	{
+	}
+
+	virtual void sendAndAwaitResponse(const Atlas::Objects::Operation::RootOperation& op, CallbackFunction& callback)
+	{
+		server.send(op, callback);
+	}
+
+	virtual Atlas::Objects::Root loadFromFile(const std::string& filename)
+	{
+		return dump;
+	}
+};
+
+class LoopbackExporter: public EntityExporterBase
+{
+public:
+	LoopbackServer& server;
+	bool completed;
+
+	explicit LoopbackExporter(LoopbackServer& server_) :
+			EntityExporterBase("1", "2", "0"), server(server_), completed(false)
+	{
+		EventCompleted.connect([this]() {completed = true;});
+	}
+
+protected:
+	virtual long int newSerialNumber()
+	{
+		return server.nextSerialno++;
+	}
+
+	virtual void send(const Atlas::Objects::Operation::RootOperation& op)
+	{
+	}
+
+	virtual void sendAndAwaitResponse(const Atlas::Objects::Operation::RootOperation& op, CallbackFunction& callback)
+	{
+		server.send(op, callback);
+	}
+
+	virtual Atlas::Formatter* createMultiLineFormatter(std::iostream& s, Atlas::Bridge& b)
+	{
+		return new Atlas::MultiLineListFormatter(s, b);
+	}
+
+	virtual void fillWithServerData(Atlas::Message::MapType& serverMap)
+	{
+		serverMap["name"] = "loopback";
+	}
+};
+
+class EntityImportTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(EntityImportTestCase);
+	CPPUNIT_TEST(testOperationWindow);
+	CPPUNIT_TEST(testImport);
+	CPPUNIT_TEST(testImportSerial);
+	CPPUNIT_TEST(testImportFailure);
+	CPPUNIT_TEST(testExport);
+	CPPUNIT_TEST(testStreamedXml);
+	CPPUNIT_TEST(testStreamedPacked);
+	CPPUNIT_TEST(testStreamedSynthetic);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	static const int CHILDREN = 20;
+
+	/**
+	 * @brief Creates a dump with a world containing CHILDREN entities, each containing CHILDREN entities.
+	 */
+	static Atlas::Objects::Root createDump()
+	{
+		Atlas::Message::ListType entities;
+		Atlas::Message::ListType worldContains;
+		int nextId = 1;
+		for (int i = 0; i < CHILDREN; ++i) {
+			std::stringstream ss;
+			ss << nextId++;
+			std::string childId = ss.str();
+			worldContains.push_back(childId);
+			Atlas::Message::ListType childContains;
+			for (int j = 0; j < CHILDREN; ++j) {
+				std::stringstream ss2;
+				ss2 << nextId++;
+				childContains.push_back(ss2.str());
+				entities.push_back(Atlas::Message::MapType { { "id", ss2.str() }, { "parent", "thing" } });
+			}
+			entities.push_back(Atlas::Message::MapType { { "id", childId }, { "parent", "thing" }, { "contains", childContains } });
+		}
+		entities.push_back(Atlas::Message::MapType { { "id", "0" }, { "parent", "world" }, { "contains", worldContains } });
+
+		Atlas::Objects::Entity::Anonymous dump;
+		dump->setAttr("meta", Atlas::Message::MapType());
+		dump->setAttr("entities", entities);
+		dump->setAttr("minds", Atlas::Message::ListType());
+		return dump;
+	}
+
+	/**
+	 * @brief Checks that all entities in the dump have been restored in the same hierarchy.
+	 */
+	static void assertRestored(LoopbackServer& server, LoopbackImporter& importer)
+	{
+		int nextId = 1;
+		for (int i = 0; i < CHILDREN; ++i) {
+			std::stringstream ss;
+			ss << nextId++;
+			std::string childId = importer.getRestoredId(ss.str());
+			CPPUNIT_ASSERT(server.entities.find(childId) != server.entities.end());
+			CPPUNIT_ASSERT_EQUAL(std::string("0"), server.entities[childId].loc);
+			for (int j = 0; j < CHILDREN; ++j) {
+				std::stringstream ss2;
+				ss2 << nextId++;
+				std::string grandChildId = importer.getRestoredId(ss2.str());
+				CPPUNIT_ASSERT(server.entities.find(grandChildId) != server.entities.end());
+				CPPUNIT_ASSERT_EQUAL(childId, server.entities[grandChildId].loc);
+			}
+		}
+	}
+
+	/**
+	 * @brief Adds the same hierarchy as in createDump() to the server.
+	 */
+	static void populate(LoopbackServer& server)
+	{
+		int nextId = 1;
+		for (int i = 0; i < CHILDREN; ++i) {
+			std::stringstream ss;
+			ss << nextId++;
+			std::string childId = ss.str();
+			server.addEntity(childId, "thing", "0");
+			for (int j = 0; j < CHILDREN; ++j) {
+				std::stringstream ss2;
+				ss2 << nextId++;
+				server.addEntity(ss2.str(), "thing", childId);
+			}
+		}
+	}
+
+	/**
+	 * @brief Removes a file when going out of scope, so that it's removed even if an assert fails.
+	 */
+	struct ScopedFile
+	{
+		const std::string filename;
+
+		~ScopedFile()
+		{
+			std::remove(filename.c_str());
+		}
+	};
+
+	/**
+	 * @brief Exports the hierarchy from createDump() as a streamed dump, and imports it into an empty world.
+	 */
+	static void testStreamed(EntityExporterBase::Format format)
+	{
+		const std::string filename = "TestEntityExportStreamed.atlas";
+		ScopedFile file { filename };
+		{
+			LoopbackServer server;
+			populate(server);
+			LoopbackExporter exporter(server);
+			exporter.setStreaming(true);
+			exporter.setFormat(format);
+			exporter.start(filename);
+			while (server.roundTrip()) {
+			}
+			CPPUNIT_ASSERT(exporter.completed);
+			CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN + 1), exporter.getStats().entitiesReceived);
+		}
+
+		{
+			std::fstream stream(filename, std::ios::in);
+			EntityDumpReader reader(stream);
+			CPPUNIT_ASSERT(reader.readUntilEntities());
+			auto& meta = reader.getSections().find("meta")->second.asMap();
+			CPPUNIT_ASSERT_EQUAL(1L, meta.find("streamed")->second.asInt());
+			reader.readToEnd();
+			CPPUNIT_ASSERT_EQUAL(size_t(CHILDREN * CHILDREN + CHILDREN + 1), reader.getEntityCount());
+			CPPUNIT_ASSERT(reader.getSections().find("minds") != reader.getSections().end());
+		}
+
+		LoopbackServer server;
+		LoopbackImporter importer(server, Atlas::Objects::Root());
+		importer.start(filename);
+		while (server.roundTrip()) {
+		}
+
+		CPPUNIT_ASSERT(importer.completed);
+		auto& stats = importer.getStats();
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN + 1), stats.entitiesCount);
+		CPPUNIT_ASSERT_EQUAL(1u, stats.entitiesUpdateCount);
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN), stats.entitiesCreateCount);
+		CPPUNIT_ASSERT_EQUAL(0u, stats.entitiesCreateErrorCount);
+
+		//The new ids don't match the old ones, so check that the shape of the hierarchy is the same.
+		CPPUNIT_ASSERT_EQUAL(size_t(CHILDREN * CHILDREN + CHILDREN + 1), server.entities.size());
+		auto& worldContains = server.entities["0"].contains;
+		CPPUNIT_ASSERT_EQUAL(size_t(CHILDREN), worldContains.size());
+		for (auto& childId : worldContains) {
+			CPPUNIT_ASSERT_EQUAL(size_t(CHILDREN), server.entities[childId].contains.size());
+		}
+	}
+
+	void testOperationWindow()
+	{
+		OperationWindow window(16);
+		CPPUNIT_ASSERT(window.getSize() < 16);
+
+		//Fast responses should make the window grow up to the max.
+		for (int i = 0; i < 1000; ++i) {
+			while (window.canSend()) {
+				window.sent();
+			}
+			window.completed(std::chrono::microseconds(100));
+		}
+		CPPUNIT_ASSERT_EQUAL(size_t(16), window.getSize());
+		CPPUNIT_ASSERT_EQUAL(size_t(16), window.getPeakInFlight());
+
+		//A failure halves the window, but only once for the operations already in flight.
+		window.failed();
+		CPPUNIT_ASSERT_EQUAL(size_t(8), window.getSize());
+		window.failed();
+		CPPUNIT_ASSERT_EQUAL(size_t(8), window.getSize());
+
+		//Responses getting much slower means the server is congested, which should shrink the window.
+		//Once the slower responses are the norm the window should start growing again.
+		size_t smallestSize = window.getSize();
+		for (int i = 0; i < 100; ++i) {
+			window.completed(std::chrono::milliseconds(50));
+			smallestSize = std::min(smallestSize, window.getSize());
+			while (window.canSend()) {
+				window.sent();
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL(size_t(1), smallestSize);
+		CPPUNIT_ASSERT(window.getSize() > 1);
+
+		window.setMaxSize(0);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), window.getMaxSize());
+	}
+
+	void testImport()
+	{
+		LoopbackServer server;
+		//One of the entities already exists, and should be updated rather than created.
+		server.addEntity("1", "thing", "0");
+
+		LoopbackImporter importer(server, createDump());
+		importer.setMaxOpsInFlight(32);
+		importer.start("");
+		while (server.roundTrip()) {
+		}
+
+		CPPUNIT_ASSERT(importer.completed);
+		auto& stats = importer.getStats();
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN + 1), stats.entitiesProcessedCount);
+		CPPUNIT_ASSERT_EQUAL(2u, stats.entitiesUpdateCount);
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN - 1), stats.entitiesCreateCount);
+		CPPUNIT_ASSERT_EQUAL(0u, stats.entitiesCreateErrorCount);
+		CPPUNIT_ASSERT_EQUAL(0u, stats.entityOpsInFlight);
+		CPPUNIT_ASSERT(stats.entityOpsInFlightPeak > 1);
+		CPPUNIT_ASSERT(server.peakOutstanding <= 32);
+		assertRestored(server, importer);
+
+		//Doing one entity at a time would require two round trips per entity.
+		CPPUNIT_ASSERT(server.roundTrips < CHILDREN * CHILDREN / 2);
+	}
+
+	void testImportSerial()
+	{
+		LoopbackServer server;
+		LoopbackImporter importer(server, createDump());
+		importer.setMaxOpsInFlight(1);
+		importer.start("");
+		while (server.roundTrip()) {
+		}
+
+		CPPUNIT_ASSERT(importer.completed);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), server.peakOutstanding);
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN), importer.getStats().entitiesCreateCount);
+		assertRestored(server, importer);
+	}
+
+	void testImportFailure()
+	{
+		//Make one of the entities fail to be created.
+		Atlas::Objects::Root dump = createDump();
+		Atlas::Message::ListType entities = dump->getAttr("entities").asList();
+		for (auto& entity : entities) {
+			if (entity.asMap().find("id")->second == "2") {
+				entity.asMap()["parent"] = "broken";
+			}
+		}
+		dump->setAttr("entities", entities);
+
+		FailingServer server;
+		LoopbackImporter importer(server, dump);
+		importer.setMaxOpsInFlight(16);
+		importer.start("");
+		//The loopback server responds right away, so the window can only shrink because of the failure.
+		bool shrank = false;
+		size_t windowSize = importer.getWindowSize();
+		while (server.roundTrip()) {
+			if (importer.getWindowSize() < windowSize) {
+				shrank = true;
+			}
+			windowSize = importer.getWindowSize();
+		}
+
+		CPPUNIT_ASSERT(importer.completed);
+		CPPUNIT_ASSERT_EQUAL(1u, importer.getStats().entitiesCreateErrorCount);
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN), importer.getStats().entitiesCreateCount);
+		CPPUNIT_ASSERT_EQUAL(size_t(CHILDREN * CHILDREN + CHILDREN), server.entities.size());
+		CPPUNIT_ASSERT(shrank);
+	}
+
+	void testExport()
+	{
+		LoopbackServer server;
+		populate(server);
+
+		const std::string filename = "TestEntityExport.xml";
+		LoopbackExporter exporter(server);
+		exporter.setMaxOpsInFlight(16);
+		exporter.start(filename);
+		while (server.roundTrip()) {
+		}
+		std::remove(filename.c_str());
+
+		CPPUNIT_ASSERT(exporter.completed);
+		auto& stats = exporter.getStats();
+		CPPUNIT_ASSERT_EQUAL(unsigned(CHILDREN * CHILDREN + CHILDREN + 1), stats.entitiesReceived);
+		CPPUNIT_ASSERT_EQUAL(0u, stats.entitiesError);
+		//Before being windowed no more than five entities were requested at once.
+		CPPUNIT_ASSERT(server.peakOutstanding > 5);
+		CPPUNIT_ASSERT(server.peakOutstanding <= 16);
+		CPPUNIT_ASSERT(server.roundTrips < CHILDREN * CHILDREN / 5);
+	}
+
+	void testStreamedXml()
+	{
+		testStreamed(EntityExporterBase::XML);
+	}
+
+	void testStreamedPacked()
+	{
+		testStreamed(EntityExporterBase::PACKED);
+	}
+
+	void testStreamedSynthetic()
+	{
+		const long count = 1111;
+		const std::string filename = "TestEntityExportSynthetic.atlas";
+		ScopedFile file { filename };
+		{
+			SyntheticServer server(count, true);
+			LoopbackExporter exporter(server);
+			exporter.setStreaming(true);
+			exporter.setFormat(EntityExporterBase::PACKED);
+			exporter.setPreserveIds(true);
+			exporter.start(filename);
+			while (server.roundTrip()) {
+			}
+			CPPUNIT_ASSERT(exporter.completed);
+			CPPUNIT_ASSERT_EQUAL(unsigned(count), exporter.getStats().entitiesReceived);
+		}
+
+		//All entities should have been streamed with their ids kept.
+		{
+			std::fstream stream(filename, std::ios::in);
+			EntityDumpReader reader(stream);
+			CPPUNIT_ASSERT(reader.readUntilEntities());
+			auto& meta = reader.getSections().find("meta")->second.asMap();
+			CPPUNIT_ASSERT_EQUAL(1L, meta.find("preserved_ids")->second.asInt());
+			std::vector<bool> seen(count, false);
+			Atlas::Message::MapType entity;
+			while (reader.readEntity(entity)) {
+				long n = entity.find("n")->second.asInt();
+				CPPUNIT_ASSERT(n >= 0 && n < count);
+				CPPUNIT_ASSERT(!seen[n]);
+				seen[n] = true;
+				CPPUNIT_ASSERT_EQUAL(std::to_string(n), entity.find("id")->second.asString());
+			}
+			CPPUNIT_ASSERT_EQUAL(size_t(count), reader.getEntityCount());
+			CPPUNIT_ASSERT(std::find(seen.begin(), seen.end(), false) == seen.end());
+		}
+
+		SyntheticServer server(count, false);
+		LoopbackImporter importer(server, Atlas::Objects::Root());
+		importer.start(filename);
+		while (server.roundTrip()) {
+		}
+		CPPUNIT_ASSERT(importer.completed);
+		CPPUNIT_ASSERT_EQUAL(unsigned(count), importer.getStats().entitiesCount);
+		CPPUNIT_ASSERT_EQUAL(1u, importer.getStats().entitiesUpdateCount);
+		CPPUNIT_ASSERT_EQUAL(unsigned(count - 1), importer.getStats().entitiesCreateCount);
+		CPPUNIT_ASSERT_EQUAL(0u, importer.getStats().entitiesCreateErrorCount);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), server.misplaced);
+
+		//Every persisted id should map to an entity created by the server.
+		for (long n = 1; n < count; ++n) {
+			long restored = std::strtol(importer.getRestoredId(std::to_string(n)).c_str(), nullptr, 10);
+			CPPUNIT_ASSERT(restored >= SyntheticServer::CREATED_BASE);
+			CPPUNIT_ASSERT(restored < SyntheticServer::CREATED_BASE + count - 1);
+		}
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::EntityImportTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
@@ -0,0 +1,336 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/entitymapping/EntityMappingManager.h"
+#include "components/entitymapping/EntityMapping.h"
+#include "components/entitymapping/IActionCreator.h"
+#include "components/entitymapping/Actions/Action.h"
+#include "components/entitymapping/Cases/CaseBase.h"
+#include "components/entitymapping/Definitions/EntityMappingDefinition.h"
+
+#include <Eris/Connection.h>
+#include <Eris/Entity.h>
+#include <Eris/Session.h>
+#include <Eris/TypeService.h>
+
+#include <wfmath/atlasconv.h>
+#include <wfmath/axisbox.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Ember::EntityMapping;
+
+namespace
+{
+const int ENTITY_COUNT = 10000;
+
+/**
+ * @brief An entity which can be given attributes without any view or connection.
+ */
+class TestEntity: public Eris::Entity
+{
+public:
+	TestEntity(const std::string& id, Eris::TypeInfo* type) :
+		Eris::Entity(id, type)
+	{
+	}
+
+	~TestEntity()
+	{
+		shutdown();
+	}
+
+	Eris::TypeService* getTypeService() const
+	{
+		return 0;
+	}
+
+	void removeFromMovementPrediction()
+	{
+	}
+
+	void addToMovementPredition()
+	{
+	}
+
+	Eris::Entity* getEntity(const std::string& id)
+	{
+		return 0;
+	}
+
+	void setAttributes(const Atlas::Message::MapType& attributes)
+	{
+		beginUpdate();
+		for (auto& entry : attributes) {
+			setAttr(entry.first, entry.second);
+		}
+		endUpdate();
+	}
+
+	void setHeight(float height)
+	{
+		setAttributes({ { "bbox", WFMath::AxisBox<3>(WFMath::Point<3>(0, 0, 0), WFMath::Point<3>(1, 1, height)).toAtlas() } });
+	}
+};
+
+/**
+ * @brief Keeps track of how many actions of each name are active.
+ */
+class TestAction: public Actions::Action
+{
+public:
+	TestAction(std::map<std::string, int>& activeActions, const std::string& name) :
+		mActiveActions(activeActions), mName(name)
+	{
+	}
+
+	void activate(ChangeContext& context) override
+	{
+		mActiveActions[mName]++;
+	}
+
+	void deactivate(ChangeContext& context) override
+	{
+		mActiveActions[mName]--;
+	}
+
+private:
+	std::map<std::string, int>& mActiveActions;
+	std::string mName;
+};
+
+class TestActionCreator: public IActionCreator
+{
+public:
+	std::map<std::string, int> activeActions;
+
+	void createActions(EntityMapping& modelMapping, Cases::CaseBase* aCase, Definitions::CaseDefinition& caseDefinition) override
+	{
+		for (auto& actionDefinition : caseDefinition.getActions()) {
+			aCase->addAction(new TestAction(activeActions, actionDefinition.getValue()));
+		}
+	}
+};
+
+Definitions::CaseDefinition createCase(const std::string& parameter, const std::string& value, const std::string& action)
+{
+	Definitions::CaseDefinition caseDefinition;
+	caseDefinition.getCaseParameters().emplace_back(parameter, value);
+	Definitions::ActionDefinition actionDefinition;
+	actionDefinition.setType("test");
+	actionDefinition.setValue(action);
+	caseDefinition.getActions().push_back(actionDefinition);
+	return caseDefinition;
+}
+
+Definitions::MatchDefinition createAttributeMatch(const std::string& attribute, const std::string& type)
+{
+	Definitions::MatchDefinition match;
+	match.setType("attribute");
+	match.getProperties()["attribute"] = attribute;
+	match.getProperties()["type"] = type;
+	return match;
+}
+
+/**
+ * @brief Creates a definition for "tree" entities, with matches for a string, a numeric and a function attribute.
+ */
+Definitions::EntityMappingDefinition* createDefinition()
+{
+	Definitions::EntityMappingDefinition* definition = new Definitions::EntityMappingDefinition();
+	definition->setName("tree");
+	definition->getRoot().setType("entitytype");
+
+	Definitions::CaseDefinition treeCase = createCase("equals", "tree", "tree");
+
+	Definitions::MatchDefinition stateMatch = createAttributeMatch("state", "string");
+	stateMatch.getCases().push_back(createCase("equals", "standing", "standing"));
+	stateMatch.getCases().push_back(createCase("equals", "fallen", "fallen"));
+	treeCase.getMatches().push_back(stateMatch);
+
+	Definitions::MatchDefinition ageMatch = createAttributeMatch("age", "numeric");
+	ageMatch.getCases().push_back(createCase("lesser", "10", "young"));
+	Definitions::CaseDefinition oldCase = createCase("greaterequals", "10", "old");
+	oldCase.getCaseParameters().emplace_back("lesser", "100");
+	ageMatch.getCases().push_back(oldCase);
+	treeCase.getMatches().push_back(ageMatch);
+
+	Definitions::MatchDefinition heightMatch = createAttributeMatch("height", "function");
+	heightMatch.getCases().push_back(createCase("greater", "5", "tall"));
+	heightMatch.getCases().push_back(createCase("lesserequals", "5", "short"));
+	treeCase.getMatches().push_back(heightMatch);
+
+	definition->getRoot().getCases().push_back(treeCase);
+	return definition;
+}
+
+}
+
+namespace Ember
+{
+
+class EntityMappingTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(EntityMappingTestCase);
+	CPPUNIT_TEST(testActivation);
+	CPPUNIT_TEST(testCompiledDefinitionLifetime);
+	CPPUNIT_TEST(testManyEntities);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	void testActivation()
+	{
+		Eris::Session session;
+		Eris::Connection connection(session, "test", "localhost", 6767);
+		Eris::TypeService& typeService = *connection.getTypeService();
+
+		EntityMappingManager manager;
+		manager.setTypeService(&typeService);
+		manager.addDefinition(createDefinition());
+
+		TestActionCreator actionCreator;
+
+		TestEntity rock("1", typeService.getTypeByName("rock"));
+		CPPUNIT_ASSERT(!manager.createMapping(rock, actionCreator, nullptr));
+
+		TestEntity tree("2", typeService.getTypeByName("tree"));
+		tree.setAttributes({ { "state", "standing" }, { "age", 50 } });
+		tree.setHeight(10);
+		std::unique_ptr<EntityMapping> mapping(manager.createMapping(tree, actionCreator, nullptr));
+		CPPUNIT_ASSERT(mapping);
+		mapping->initialize();
+
+		auto& active = actionCreator.activeActions;
+		CPPUNIT_ASSERT_EQUAL(1, active["tree"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["standing"]);
+		CPPUNIT_ASSERT_EQUAL(0, active["fallen"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["old"]);
+		CPPUNIT_ASSERT_EQUAL(0, active["young"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["tall"]);
+		CPPUNIT_ASSERT_EQUAL(0, active["short"]);
+
+		tree.setAttributes({ { "state", "fallen" } });
+		CPPUNIT_ASSERT_EQUAL(0, active["standing"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["fallen"]);
+
+		//Outside the range of the "old" case.
+		tree.setAttributes({ { "age", 150 } });
+		CPPUNIT_ASSERT_EQUAL(0, active["old"]);
+		CPPUNIT_ASSERT_EQUAL(0, active["young"]);
+
+		tree.setAttributes({ { "age", 5 } });
+		CPPUNIT_ASSERT_EQUAL(1, active["young"]);
+
+		tree.setHeight(2);
+		CPPUNIT_ASSERT_EQUAL(0, active["tall"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["short"]);
+
+		//A second entity uses the same compiled comparers, but must be evaluated on its own.
+		TestEntity otherTree("3", typeService.getTypeByName("tree"));
+		otherTree.setAttributes({ { "state", "standing" }, { "age", 50 } });
+		otherTree.setHeight(10);
+		std::unique_ptr<EntityMapping> otherMapping(manager.createMapping(otherTree, actionCreator, nullptr));
+		otherMapping->initialize();
+		CPPUNIT_ASSERT_EQUAL(2, active["tree"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["standing"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["fallen"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["tall"]);
+		CPPUNIT_ASSERT_EQUAL(1, active["short"]);
+
+		otherMapping.reset();
+		mapping.reset();
+	}
+
+	void testCompiledDefinitionLifetime()
+	{
+		Eris::Session session;
+		Eris::Connection connection(session, "test", "localhost", 6767);
+		Eris::TypeService& typeService = *connection.getTypeService();
+
+		EntityMappingManager manager;
+		manager.setTypeService(&typeService);
+		manager.addDefinition(createDefinition());
+
+		TestActionCreator actionCreator;
+		TestEntity tree("1", typeService.getTypeByName("tree"));
+		tree.setAttributes({ { "state", "standing" } });
+		std::unique_ptr<EntityMapping> mapping(manager.createMapping(tree, actionCreator, nullptr));
+		mapping->initialize();
+		CPPUNIT_ASSERT_EQUAL(1, actionCreator.activeActions["standing"]);
+
+		//This discards the compiled definitions held by the manager; the mapping should keep its own alive.
+		manager.setTypeService(&typeService);
+		tree.setAttributes({ { "state", "fallen" } });
+		CPPUNIT_ASSERT_EQUAL(0, actionCreator.activeActions["standing"]);
+		CPPUNIT_ASSERT_EQUAL(1, actionCreator.activeActions["fallen"]);
+	}
+
+	void testManyEntities()
+	{
+		Eris::Session session;
+		Eris::Connection connection(session, "test", "localhost", 6767);
+		Eris::TypeService& typeService = *connection.getTypeService();
+		Eris::TypeInfo* treeType = typeService.getTypeByName("tree");
+
+		EntityMappingManager manager;
+		manager.setTypeService(&typeService);
+		manager.addDefinition(createDefinition());
+
+		TestActionCreator actionCreator;
+
+		std::vector<std::unique_ptr<TestEntity>> entities;
+		entities.reserve(ENTITY_COUNT);
+		for (int i = 0; i < ENTITY_COUNT; ++i) {
+			entities.emplace_back(new TestEntity(std::to_string(i), treeType));
+			entities.back()->setAttributes({ { "state", i % 2 ? "standing" : "fallen" }, { "age", i % 20 } });
+			entities.back()->setHeight(i % 10);
+		}
+
+		//Create mappings for all entities, as when a large number of entities are seen at once.
+		std::vector<std::unique_ptr<EntityMapping>> mappings;
+		mappings.reserve(ENTITY_COUNT);
+		for (auto& entity : entities) {
+			mappings.emplace_back(manager.createMapping(*entity, actionCreator, nullptr));
+			mappings.back()->initialize();
+		}
+
+		auto& active = actionCreator.activeActions;
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT, active["tree"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT / 2, active["standing"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT / 2, active["fallen"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT / 2, active["young"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT / 2, active["old"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT * 4 / 10, active["tall"]);
+		CPPUNIT_ASSERT_EQUAL(ENTITY_COUNT * 6 / 10, active["short"]);
+
+		mappings.clear();
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::EntityMappingTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
@@ -0,0 +1,173 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/ogre/terrain/foliage/ClusterPopulator.h"
+#include "components/ogre/terrain/foliage/CoverageCache.h"
+#include "components/ogre/terrain/Buffer.h"
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Ember::OgreView::Terrain;
+using namespace Ember::OgreView::Terrain::Foliage;
+
+namespace Ember
+{
+
+/**
+ * @brief Number of points along each side of a segment.
+ */
+const unsigned int SEGMENT_SIZE = 65;
+
+class FoliageTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(FoliageTestCase);
+	CPPUNIT_TEST(testSubtractCoverage);
+	CPPUNIT_TEST(testGetHeights);
+	CPPUNIT_TEST(testCoverageCache);
+	CPPUNIT_TEST(testCombinedLayers);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	static void subtractCoverageScalar(unsigned char* coverage, const unsigned char* layer, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i) {
+			coverage[i] -= std::min<unsigned char>(layer[i], coverage[i]);
+		}
+	}
+
+	void testSubtractCoverage()
+	{
+		std::mt19937 random(1);
+		//Use a size which isn't a multiple of the vector width, to exercise the tail.
+		size_t size = SEGMENT_SIZE * SEGMENT_SIZE;
+		std::vector<unsigned char> coverage(size), layer(size);
+		for (size_t i = 0; i < size; ++i) {
+			coverage[i] = random() % 256;
+			layer[i] = random() % 256;
+		}
+		std::vector<unsigned char> expected(coverage);
+		subtractCoverageScalar(expected.data(), layer.data(), size);
+		ClusterPopulator::subtractCoverage(coverage.data(), layer.data(), size);
+		CPPUNIT_ASSERT(expected == coverage);
+	}
+
+	void testGetHeights()
+	{
+		std::vector<float> points(SEGMENT_SIZE * SEGMENT_SIZE);
+		for (unsigned int y = 0; y < SEGMENT_SIZE; ++y) {
+			for (unsigned int x = 0; x < SEGMENT_SIZE; ++x) {
+				points[y * SEGMENT_SIZE + x] = x * 2.0f + y * 0.5f;
+			}
+		}
+
+		std::vector<WFMath::Point<2>> positions;
+		positions.emplace_back(0, 0);
+		positions.emplace_back(10.25f, 3.75f);
+		positions.emplace_back(3.75f, 10.25f);
+		positions.emplace_back(64, 64);
+		std::vector<float> heights;
+		ClusterPopulator::getHeights(points.data(), SEGMENT_SIZE, positions, heights);
+		CPPUNIT_ASSERT_EQUAL(positions.size(), heights.size());
+		//The heights form a plane, so the interpolation should be exact.
+		for (size_t i = 0; i < positions.size(); ++i) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(positions[i].x() * 2.0f + positions[i].y() * 0.5f, heights[i], 0.001);
+		}
+	}
+
+	void testCoverageCache()
+	{
+		CoverageCache cache(2);
+		CoverageCache::Key key;
+		key.xRef = 0;
+		key.yRef = 0;
+		key.resolution = 64;
+		key.layers = {1, 2};
+
+		unsigned long generation = 0;
+		CPPUNIT_ASSERT(!cache.get(key, generation));
+		CoverageCache::CoveragePtr coverage(new Buffer<unsigned char>(SEGMENT_SIZE, 1));
+		cache.insert(key, coverage, generation);
+		CPPUNIT_ASSERT(cache.get(key, generation) == coverage);
+
+		//Coverage calculated before an invalidation should not be inserted.
+		CoverageCache::Key otherKey(key);
+		otherKey.layers = {2};
+		CPPUNIT_ASSERT(!cache.get(otherKey, generation));
+		std::vector<WFMath::AxisBox<2>> areas;
+		areas.push_back(WFMath::AxisBox<2>(WFMath::Point<2>(10, 10), WFMath::Point<2>(20, 20)));
+		cache.invalidate(areas);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+		cache.insert(otherKey, coverage, generation);
+		CPPUNIT_ASSERT(!cache.get(otherKey, generation));
+
+		//Areas outside the segment shouldn't affect it.
+		cache.insert(key, coverage, generation);
+		areas[0] = WFMath::AxisBox<2>(WFMath::Point<2>(100, 100), WFMath::Point<2>(120, 120));
+		cache.invalidate(areas);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cache.size());
+
+		//The least recently used coverage should be removed when full.
+		cache.get(key, generation);
+		cache.insert(otherKey, coverage, generation);
+		CoverageCache::Key thirdKey(key);
+		thirdKey.xRef = 64;
+		cache.get(key, generation);
+		cache.insert(thirdKey, coverage, generation);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cache.size());
+		CPPUNIT_ASSERT(cache.get(key, generation));
+		CPPUNIT_ASSERT(!cache.get(otherKey, generation));
+	}
+
+	void testCombinedLayers()
+	{
+		std::mt19937 random(2);
+		size_t size = SEGMENT_SIZE * SEGMENT_SIZE;
+		const int layers = 4;
+		std::vector<std::vector<unsigned char>> layerData(layers, std::vector<unsigned char>(size));
+		for (auto& layer : layerData) {
+			for (auto& value : layer) {
+				value = random() % 256;
+			}
+		}
+
+		//Subtracting several layers in turn, as is done when populating a cluster, should give the same result as the scalar version.
+		std::vector<unsigned char> scalar(layerData[0]), vectorised(layerData[0]);
+		for (int j = 1; j < layers; ++j) {
+			subtractCoverageScalar(scalar.data(), layerData[j].data(), size);
+			ClusterPopulator::subtractCoverage(vectorised.data(), layerData[j].data(), size);
+		}
+		CPPUNIT_ASSERT(scalar == vectorised);
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::FoliageTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
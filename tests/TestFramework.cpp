@@ -7,6 +7,11 @@
 #include "framework/TinyXmlCodec.h"
 #include "framework/AtlasMessageLoader.h"
 #include "framework/tinyxml/tinyxml.h"
+#include "framework/LoggingInstance.h"
+#include "framework/LogObserver.h"
+#include "framework/XMLDocumentCache.h"
+#include "framework/FileSystemIndex.h"
+#include "framework/Profiler.h"
 
 #include <Atlas/Objects/SmartPtr.h>
 #include <Atlas/Objects/Root.h>
@@ -16,14 +21,52 @@
 
 #include <boost/thread.hpp>
 #include <boost/date_time.hpp>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 namespace Ember
 {
 
+/**
+ * @brief Counts messages, and records which threads they were written from.
+ */
+class CountingLogObserver: public LogObserver
+{
+public:
+	std::atomic<int> count;
+	std::atomic<int> countFromOtherThreads;
+	std::thread::id writerThread;
+
+	CountingLogObserver() :
+			count(0), countFromOtherThreads(0)
+	{
+	}
+
+	void onNewMessage(const std::string& message, const std::string& file, const int& line, const Log::MessageImportance& importance) override
+	{
+		count++;
+		writerThread = std::this_thread::get_id();
+		if (Log::getOriginThreadId() != writerThread) {
+			countFromOtherThreads++;
+		}
+	}
+};
+
 class FrameworkTestCase: public CppUnit::TestFixture
 {
 CPPUNIT_TEST_SUITE(FrameworkTestCase);
 	CPPUNIT_TEST(testTinyXmlCodec);
+	CPPUNIT_TEST(testLogFilter);
+	CPPUNIT_TEST(testAsyncLog);
+	CPPUNIT_TEST(testXMLDocumentCache);
+	CPPUNIT_TEST(testFileSystemIndex);
+	CPPUNIT_TEST(testProfiler);
 
 	CPPUNIT_TEST_SUITE_END()
 	;
@@ -71,6 +114,344 @@ public:
 		}
 	}
 
+	void testLogFilter()
+	{
+		CountingLogObserver observer;
+		observer.setFilter(Log::WARNING);
+		Log::addObserver(&observer);
+		CPPUNIT_ASSERT(!Log::isEnabled(Log::VERBOSE));
+		CPPUNIT_ASSERT(!Log::isEnabled(Log::INFO));
+		CPPUNIT_ASSERT(Log::isEnabled(Log::WARNING));
+
+		int formatted = 0;
+		auto format = [&]() {
+			formatted++;
+			return "formatted";
+		};
+		S_LOG_VERBOSE(format());
+		S_LOG_WARNING(format());
+		CPPUNIT_ASSERT(formatted == 1);
+		CPPUNIT_ASSERT(observer.count == 1);
+
+		observer.setFilter(Log::VERBOSE);
+		CPPUNIT_ASSERT(Log::isEnabled(Log::VERBOSE));
+		Log::removeObserver(&observer);
+	}
+
+	void testAsyncLog()
+	{
+		CountingLogObserver observer;
+		observer.setFilter(Log::VERBOSE);
+		Log::addObserver(&observer);
+		Log::setAsynchronous(true);
+		CPPUNIT_ASSERT(Log::isAsynchronous());
+
+		const int numberOfThreads = 4;
+		const int messagesPerThread = 200;
+		std::vector<std::thread> threads;
+		for (int i = 0; i < numberOfThreads; ++i) {
+			threads.emplace_back([=]() {
+				for (int j = 0; j < messagesPerThread; ++j) {
+					S_LOG_VERBOSE("Message " << j << " from thread " << i);
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		Log::flush();
+
+		//Messages might be dropped if the writer can't keep up, but all messages must be accounted for.
+		CPPUNIT_ASSERT(observer.count + static_cast<int>(Log::getDroppedMessageCount()) == numberOfThreads * messagesPerThread);
+		CPPUNIT_ASSERT(observer.count == observer.countFromOtherThreads);
+		CPPUNIT_ASSERT(observer.writerThread != std::this_thread::get_id());
+		CPPUNIT_ASSERT(Log::getQueueDepth() == 0);
+
+		Log::setAsynchronous(false);
+		CPPUNIT_ASSERT(!Log::isAsynchronous());
+		int count = observer.count;
+		S_LOG_INFO("Synchronous message");
+		CPPUNIT_ASSERT(observer.count == count + 1);
+		Log::removeObserver(&observer);
+	}
+
+	/**
+	 * @brief Creates a document resembling a model definition file.
+	 */
+	static std::string createModelDefinition(int index)
+	{
+		std::stringstream ss;
+		ss << "<?xml version=\"1.0\"?>\n<models>\n";
+		for (int model = 0; model < 4; ++model) {
+			ss << " <model name=\"model" << index << "_" << model << "\" scale=\"1.5\" usescaleof=\"height\">\n  <submodels>\n";
+			for (int part = 0; part < 5; ++part) {
+				ss << "   <submodel mesh=\"3d_objects/things/model" << index << "_" << part << ".mesh\"><parts><part name=\"part" << part << "\" show=\"true\">"
+						<< "<subentities><subentity index=\"0\" material=\"/global/things/material&amp;" << part << "\"/></subentities></part></parts></submodel>\n";
+			}
+			ss << "  </submodels>\n  <actions><action name=\"__movement_idle\"><animations><animation iterations=\"1\"><animationpart name=\"Idle\"/></animation></animations></action></actions>\n";
+			ss << "  <translate x=\"0\" y=\"1.5\" z=\"0\"/>\n  <rendering><![CDATA[<scheme>]]></rendering>\n </model>\n";
+		}
+		ss << "</models>\n";
+		return ss.str();
+	}
+
+	void testXMLDocumentCache()
+	{
+		const int documentCount = 20;
+		const time_t modifiedTime = 1000;
+		ScopedDirectory directory { boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-xmlcache-%%%%-%%%%") };
+		boost::filesystem::create_directories(directory.path);
+		const std::string path = (directory.path / "definitions.cache").string();
+
+		std::vector<std::string> sources;
+		for (int i = 0; i < documentCount; ++i) {
+			sources.push_back(createModelDefinition(i));
+		}
+
+		//Cold start: everything is parsed and stored.
+		{
+			XMLDocumentCache cache(path);
+			CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+			for (int i = 0; i < documentCount; ++i) {
+				TiXmlDocument xmlDoc;
+				CPPUNIT_ASSERT(!cache.load(xmlDoc, std::to_string(i), modifiedTime, sources[i].size()));
+				xmlDoc.Parse(sources[i].c_str());
+				CPPUNIT_ASSERT(!xmlDoc.Error());
+				cache.store(xmlDoc, std::to_string(i), modifiedTime, sources[i]);
+			}
+			cache.writeInBackground();
+		}
+
+		//Warm start: everything is read from the cache, without looking at the sources.
+		{
+			XMLDocumentCache cache(path);
+			CPPUNIT_ASSERT_EQUAL(size_t(documentCount), cache.size());
+			for (int i = 0; i < documentCount; ++i) {
+				TiXmlDocument xmlDoc;
+				CPPUNIT_ASSERT(cache.load(xmlDoc, std::to_string(i), modifiedTime, sources[i].size()));
+			}
+		}
+
+		{
+			XMLDocumentCache cache(path);
+
+			TiXmlDocument parsedDoc, cachedDoc;
+			parsedDoc.Parse(sources[0].c_str());
+			CPPUNIT_ASSERT(cache.load(cachedDoc, "0", modifiedTime, sources[0].size()));
+			CPPUNIT_ASSERT(XMLDocumentCache::encode(parsedDoc) == XMLDocumentCache::encode(cachedDoc));
+			CPPUNIT_ASSERT_EQUAL(std::string("/global/things/material&0"), std::string(cachedDoc.RootElement()->FirstChildElement("model")->FirstChildElement("submodels")
+					->FirstChildElement("submodel")->FirstChildElement("parts")->FirstChildElement("part")->FirstChildElement("subentities")->FirstChildElement("subentity")->Attribute("material")));
+
+			//A touched but unchanged source is found by its content, and the new time is used from then on.
+			TiXmlDocument touchedDoc;
+			CPPUNIT_ASSERT(!cache.load(touchedDoc, "1", modifiedTime + 1, sources[1].size()));
+			CPPUNIT_ASSERT(cache.load(touchedDoc, "1", modifiedTime + 1, sources[1]));
+			TiXmlDocument touchedAgainDoc;
+			CPPUNIT_ASSERT(cache.load(touchedAgainDoc, "1", modifiedTime + 1, sources[1].size()));
+
+			//A changed source must be parsed again.
+			TiXmlDocument changedDoc;
+			CPPUNIT_ASSERT(!cache.load(changedDoc, "2", modifiedTime + 1, sources[3]));
+			CPPUNIT_ASSERT(!cache.load(changedDoc, "unknown", modifiedTime, sources[2]));
+		}
+
+		//A cache of a different version is ignored.
+		{
+			std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+			file.seekp(4);
+			uint32_t version = XMLDocumentCache::VERSION + 1;
+			file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		}
+		{
+			XMLDocumentCache cache(path);
+			CPPUNIT_ASSERT_EQUAL(size_t(0), cache.size());
+		}
+	}
+
+	/**
+	 * @brief Removes a directory tree when going out of scope, so that it's removed even if an assert fails.
+	 */
+	struct ScopedDirectory
+	{
+		const boost::filesystem::path path;
+
+		~ScopedDirectory()
+		{
+			boost::system::error_code ec;
+			boost::filesystem::remove_all(path, ec);
+		}
+	};
+
+	void testFileSystemIndex()
+	{
+		CPPUNIT_ASSERT(FileSystemIndex::matchPattern("*.mesh", "a.mesh"));
+		CPPUNIT_ASSERT(FileSystemIndex::matchPattern("*", ".hidden"));
+		CPPUNIT_ASSERT(FileSystemIndex::matchPattern("f?.*h", "f1.mesh"));
+		CPPUNIT_ASSERT(!FileSystemIndex::matchPattern("*.mesh", "a.mesh.bak"));
+		CPPUNIT_ASSERT(!FileSystemIndex::matchPattern("f?.mesh", "f10.mesh"));
+
+		//A small media tree with 200 files, half of them meshes.
+		ScopedDirectory directory { boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-fsindex-%%%%-%%%%") };
+		const std::string root = directory.path.string();
+		for (int dir = 0; dir < 5; ++dir) {
+			for (int subdir = 0; subdir < 4; ++subdir) {
+				std::string path = root + "/d" + std::to_string(dir) + "/s" + std::to_string(subdir);
+				boost::filesystem::create_directories(path);
+				for (int file = 0; file < 10; ++file) {
+					std::ofstream(path + "/f" + std::to_string(file) + (file % 2 ? ".png" : ".mesh")) << "data";
+				}
+			}
+		}
+		//Neither hidden directories, source directories nor directories with a "norecurse" file are indexed.
+		boost::filesystem::create_directories(root + "/.hidden");
+		std::ofstream(root + "/.hidden/a.mesh");
+		boost::filesystem::create_directories(root + "/source");
+		std::ofstream(root + "/source/b.mesh");
+		boost::filesystem::create_directories(root + "/excluded");
+		std::ofstream(root + "/excluded/norecurse");
+		std::ofstream(root + "/excluded/c.mesh");
+
+		auto countMatches = [](const FileSystemIndex& index, const std::string& pattern, bool recursive, bool dirs) {
+			size_t count = 0;
+			index.find(pattern, recursive, dirs, [&](const std::string&, const FileSystemIndex::Entry&) {count++;});
+			return count;
+		};
+
+		//Building with one thread or many should give the same index.
+		{
+			FileSystemIndex index(root);
+			index.build(1);
+			CPPUNIT_ASSERT_EQUAL(size_t(200), index.getFileCount());
+			CPPUNIT_ASSERT_EQUAL(size_t(100), countMatches(index, "*.mesh", true, false));
+		}
+
+		FileSystemIndex index(root);
+		index.build();
+
+		CPPUNIT_ASSERT_EQUAL(size_t(200), index.getFileCount());
+		CPPUNIT_ASSERT_EQUAL(size_t(100), countMatches(index, "*.mesh", true, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(5), countMatches(index, "d0/s0/f?.mesh", false, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), countMatches(index, "d0\\s0\\f8.mesh", false, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(8), countMatches(index, "*", false, true));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), countMatches(index, ".hidden/*.mesh", false, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), countMatches(index, "excluded/*", false, false));
+		std::string foundDirectory;
+		index.find("d1/*8.mesh", true, false, [&](const std::string& directory, const FileSystemIndex::Entry& entry) {foundDirectory = directory;});
+		CPPUNIT_ASSERT_EQUAL(std::string("d1/s3/"), foundDirectory);
+
+		CPPUNIT_ASSERT(index.exists("d0/s0/f0.mesh"));
+		CPPUNIT_ASSERT(index.exists("d0/s0"));
+		CPPUNIT_ASSERT(!index.exists("d0/s0/f1.mesh"));
+		CPPUNIT_ASSERT(index.exists("excluded/c.mesh"));
+
+		//Changes are picked up once reported.
+		std::ofstream(root + "/d0/s0/new.mesh");
+		CPPUNIT_ASSERT(!index.exists("d0/s0/new.mesh"));
+		index.pathChanged("d0/s0/new.mesh");
+		CPPUNIT_ASSERT(index.exists("d0/s0/new.mesh"));
+		CPPUNIT_ASSERT_EQUAL(size_t(101), countMatches(index, "*.mesh", true, false));
+
+		boost::filesystem::remove_all(root + "/d0/s1");
+		index.pathChanged("d0/s1");
+		CPPUNIT_ASSERT(!index.exists("d0/s1"));
+		CPPUNIT_ASSERT_EQUAL(size_t(101 - 5), countMatches(index, "*.mesh", true, false));
+
+		boost::filesystem::create_directories(root + "/d0/s1");
+		std::ofstream(root + "/d0/s1/f0.mesh");
+		index.pathChanged("d0/s1");
+		CPPUNIT_ASSERT(index.exists("d0/s1/f0.mesh"));
+
+		std::ofstream(root + "/d1/norecurse");
+		index.pathChanged("d1/norecurse");
+		CPPUNIT_ASSERT_EQUAL(size_t(0), countMatches(index, "d1/*.mesh", true, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(102 - 5 - 20), countMatches(index, "*.mesh", true, false));
+	}
+
+	void testProfiler()
+	{
+		typedef std::chrono::microseconds us;
+
+		//Record from a number of threads while the trace is being written, so that zones are overwritten during reading.
+		const size_t zonesPerThread = Profiler::ZONES_PER_THREAD * 2;
+		std::atomic<bool> start(false);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i) {
+			threads.emplace_back([&, i]() {
+				Profiler::setThreadName("Test " + std::to_string(i));
+				const char* name = Profiler::intern("Zone \"" + std::to_string(i) + "\"");
+				while (!start) {
+					std::this_thread::yield();
+				}
+				for (size_t j = 0; j < zonesPerThread; ++j) {
+					ProfileZone zone(name);
+				}
+			});
+		}
+		start = true;
+		std::stringstream concurrentTrace;
+		Profiler::writeChromeTrace(concurrentTrace, std::chrono::seconds(60));
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		CPPUNIT_ASSERT(concurrentTrace.str().find("{\"traceEvents\":[") == 0);
+
+		//Only the most recent zones of each thread are kept.
+		std::stringstream trace;
+		size_t zones = Profiler::writeChromeTrace(trace, std::chrono::seconds(60));
+		CPPUNIT_ASSERT(zones >= Profiler::ZONES_PER_THREAD * 4);
+		CPPUNIT_ASSERT(zones < Profiler::ZONES_PER_THREAD * 5);
+		CPPUNIT_ASSERT(trace.str().find("\"name\":\"Zone \\\"3\\\"\"") != std::string::npos);
+		CPPUNIT_ASSERT(trace.str().find("\"args\":{\"name\":\"Test 2\"}") != std::string::npos);
+		CPPUNIT_ASSERT_EQUAL(Profiler::intern("Zone \"1\""), Profiler::intern(std::string("Zone \"1\"")));
+
+		//The buffers of exited threads are reused, so threads which run one after another should all write to the same buffer.
+		for (int i = 0; i < 10; ++i) {
+			std::thread thread([i]() {
+				Profiler::setThreadName("Sequential " + std::to_string(i));
+				ProfileZone zone(Profiler::intern("Sequential " + std::to_string(i)));
+			});
+			thread.join();
+		}
+		std::stringstream sequentialTrace;
+		Profiler::writeChromeTrace(sequentialTrace, std::chrono::seconds(60));
+		auto getThreadId = [&](const std::string& zoneName) {
+			std::string::size_type pos = sequentialTrace.str().find("{\"name\":\"" + zoneName + "\",\"ph\":\"X\"");
+			CPPUNIT_ASSERT(pos != std::string::npos);
+			pos = sequentialTrace.str().find("\"tid\":", pos);
+			return std::stoi(sequentialTrace.str().substr(pos + 6));
+		};
+		CPPUNIT_ASSERT_EQUAL(getThreadId("Sequential 0"), getThreadId("Sequential 9"));
+		CPPUNIT_ASSERT(sequentialTrace.str().find("\"args\":{\"name\":\"Sequential 9\"}") != std::string::npos);
+		CPPUNIT_ASSERT(sequentialTrace.str().find("\"args\":{\"name\":\"Sequential 0\"}") == std::string::npos);
+
+		//Zones older than the window aren't written.
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		{
+			ProfileZone zone("Recent");
+		}
+		std::stringstream recentTrace;
+		CPPUNIT_ASSERT_EQUAL(size_t(1), Profiler::writeChromeTrace(recentTrace, std::chrono::milliseconds(10)));
+
+		//Once the buffer has wrapped around, exactly the most recent zones of the thread are written, all of them well formed.
+		const size_t iterations = Profiler::ZONES_PER_THREAD * 3;
+		int64_t startTime = Profiler::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			ProfileZone zone("Overhead");
+		}
+		//Only include zones recorded since the loop started; those of other threads are all older.
+		std::stringstream overheadTrace;
+		size_t overheadZones = Profiler::writeChromeTrace(overheadTrace, us(Profiler::now() - startTime));
+		CPPUNIT_ASSERT_EQUAL(size_t(Profiler::ZONES_PER_THREAD), overheadZones);
+		std::string overheadString = overheadTrace.str();
+		size_t overheadCount = 0;
+		for (std::string::size_type pos = overheadString.find("{\"name\":\"Overhead\",\"ph\":\"X\",\"ts\":"); pos != std::string::npos;
+				pos = overheadString.find("{\"name\":\"Overhead\",\"ph\":\"X\",\"ts\":", pos + 1)) {
+			overheadCount++;
+		}
+		CPPUNIT_ASSERT_EQUAL(overheadZones, overheadCount);
+		CPPUNIT_ASSERT(overheadString.find("\"Recent\"") == std::string::npos);
+	}
+
 };
 
 }
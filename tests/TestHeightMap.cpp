@@ -0,0 +1,268 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/ogre/terrain/HeightMap.h"
+#include "components/ogre/terrain/HeightMapSegment.h"
+#include "components/ogre/terrain/HeightMapFlatSegment.h"
+#include "components/ogre/terrain/HeightMapBuffer.h"
+#include "components/ogre/terrain/HeightMapBufferProvider.h"
+#include "components/ogre/terrain/Buffer.h"
+
+#include <wfmath/point.h>
+#include <wfmath/vector.h>
+
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace Ember::OgreView::Terrain;
+
+namespace Ember
+{
+
+/**
+ * @brief Number of segments along each side of the test height map.
+ */
+const int SEGMENTS = 16;
+
+/**
+ * @brief Resolution of one segment in the test height map.
+ */
+const unsigned int RESOLUTION = 64;
+
+float testHeight(int x, int y)
+{
+	return (x * 0.5f) + (y * 0.25f);
+}
+
+/**
+ * @brief Replicates the nested map segment store used by HeightMap before it was flattened, to be able to compare lookup speeds.
+ */
+class LegacySegmentStore
+{
+public:
+	typedef std::unordered_map<int, std::shared_ptr<IHeightMapSegment>> Segmentcolumn;
+	typedef std::unordered_map<int, Segmentcolumn> Segmentstore;
+
+	Segmentstore mSegments;
+
+	std::shared_ptr<IHeightMapSegment> getSegment(int xIndex, int yIndex) const
+	{
+		auto column = mSegments.find(xIndex);
+		if (column != mSegments.end()) {
+			auto row = column->second.find(yIndex);
+			if (row != column->second.end()) {
+				return row->second;
+			}
+		}
+		return std::shared_ptr<IHeightMapSegment>();
+	}
+
+	float getHeight(float x, float y) const
+	{
+		int ix = (int)std::floor(x / RESOLUTION);
+		int iy = (int)std::floor(y / RESOLUTION);
+		std::shared_ptr<IHeightMapSegment> segment(getSegment(ix, iy));
+		if (!segment.get()) {
+			return 0;
+		}
+		return segment->getHeight(std::lround(x) - (ix * (int)RESOLUTION), std::lround(y) - (iy * (int)RESOLUTION));
+	}
+
+	void blitHeights(int xMin, int xMax, int yMin, int yMax, std::vector<float>& heights) const
+	{
+		int xSize = xMax - xMin;
+		for (int segmentX = xMin / (int)RESOLUTION; segmentX <= xMax / (int)RESOLUTION; ++segmentX) {
+			for (int segmentY = yMin / (int)RESOLUTION; segmentY <= yMax / (int)RESOLUTION; ++segmentY) {
+				auto segmentPtr = getSegment(segmentX, segmentY);
+				if (segmentPtr) {
+					int segmentXStart = segmentX * RESOLUTION;
+					int segmentYStart = segmentY * RESOLUTION;
+					int dataXOffset = segmentXStart - xMin;
+					int dataYOffset = segmentYStart - yMin;
+					int xStart = std::max(xMin - segmentXStart, 0);
+					int yStart = std::max(yMin - segmentYStart, 0);
+					int xEnd = std::min<int>(xMax - segmentXStart, RESOLUTION);
+					int yEnd = std::min<int>(yMax - segmentYStart, RESOLUTION);
+					for (int x = xStart; x < xEnd; ++x) {
+						for (int y = yStart; y < yEnd; ++y) {
+							heights[((dataYOffset + y) * xSize) + (dataXOffset + x)] = segmentPtr->getHeight(x, y);
+						}
+					}
+				}
+			}
+		}
+	}
+};
+
+class HeightMapTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(HeightMapTestCase);
+	CPPUNIT_TEST(testInsertRemove);
+	CPPUNIT_TEST(testBlitHeights);
+	CPPUNIT_TEST(testBatchLookups);
+	CPPUNIT_TEST(testAgainstLegacyStore);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	std::unique_ptr<HeightMapBufferProvider> mProvider;
+
+	void setUp()
+	{
+		mProvider.reset(new HeightMapBufferProvider(RESOLUTION + 1));
+	}
+
+	void tearDown()
+	{
+		mProvider.reset();
+	}
+
+	IHeightMapSegment* createSegment(int segmentX, int segmentY)
+	{
+		HeightMapBuffer* buffer = mProvider->checkout();
+		float* data = buffer->getBuffer()->getData();
+		for (unsigned int y = 0; y <= RESOLUTION; ++y) {
+			for (unsigned int x = 0; x <= RESOLUTION; ++x) {
+				data[y * (RESOLUTION + 1) + x] = testHeight(segmentX * RESOLUTION + x, segmentY * RESOLUTION + y);
+			}
+		}
+		return new HeightMapSegment(buffer);
+	}
+
+	void populate(HeightMap& heightMap)
+	{
+		for (int x = 0; x < SEGMENTS; ++x) {
+			for (int y = 0; y < SEGMENTS; ++y) {
+				heightMap.insert(x, y, createSegment(x, y));
+			}
+		}
+	}
+
+	void testInsertRemove()
+	{
+		HeightMap heightMap(-12, RESOLUTION);
+		heightMap.insert(-1, -1, new HeightMapFlatSegment(5));
+		heightMap.insert(0, 0, createSegment(0, 0));
+
+		CPPUNIT_ASSERT_EQUAL(5.0f, heightMap.getHeight(-10, -10));
+		CPPUNIT_ASSERT_EQUAL(testHeight(10, 20), heightMap.getHeight(10, 20));
+		CPPUNIT_ASSERT_EQUAL(-12.0f, heightMap.getHeight(-10, 10));
+
+		CPPUNIT_ASSERT(heightMap.remove(-1, -1));
+		CPPUNIT_ASSERT(!heightMap.remove(-1, -1));
+		CPPUNIT_ASSERT_EQUAL(-12.0f, heightMap.getHeight(-10, -10));
+	}
+
+	void testBlitHeights()
+	{
+		HeightMap heightMap(0, RESOLUTION);
+		populate(heightMap);
+		heightMap.insert(SEGMENTS, 0, new HeightMapFlatSegment(3));
+
+		int xMin = 30, xMax = (SEGMENTS * RESOLUTION) + 20, yMin = 10, yMax = 200;
+		std::vector<float> heights((xMax - xMin) * (yMax - yMin));
+		heightMap.blitHeights(xMin, xMax, yMin, yMax, heights);
+
+		for (int y = yMin; y < yMax; ++y) {
+			for (int x = xMin; x < xMax; ++x) {
+				float expected = heightMap.getHeight(x, y);
+				CPPUNIT_ASSERT_EQUAL(expected, heights[(y - yMin) * (xMax - xMin) + (x - xMin)]);
+			}
+		}
+	}
+
+	void testBatchLookups()
+	{
+		HeightMap heightMap(-1, RESOLUTION);
+		populate(heightMap);
+
+		std::vector<WFMath::Point<2>> positions;
+		for (float x = -5.5f; x < 300; x += 3.7f) {
+			positions.emplace_back(x, x * 0.8f + 1.3f);
+		}
+
+		std::vector<float> heights;
+		heightMap.getHeights(positions, heights);
+		CPPUNIT_ASSERT_EQUAL(positions.size(), heights.size());
+		for (size_t i = 0; i < positions.size(); ++i) {
+			CPPUNIT_ASSERT_EQUAL(heightMap.getHeight(positions[i].x(), positions[i].y()), heights[i]);
+		}
+
+		std::vector<WFMath::Vector<3>> normals;
+		size_t found = heightMap.getHeightsAndNormals(positions, heights, normals);
+		size_t expectedFound = 0;
+		for (size_t i = 0; i < positions.size(); ++i) {
+			float height;
+			WFMath::Vector<3> normal;
+			if (heightMap.getHeightAndNormal(positions[i].x(), positions[i].y(), height, normal)) {
+				expectedFound++;
+				CPPUNIT_ASSERT_EQUAL(height, heights[i]);
+				CPPUNIT_ASSERT_EQUAL(normal.z(), normals[i].z());
+			} else {
+				CPPUNIT_ASSERT_EQUAL(-1.0f, heights[i]);
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL(expectedFound, found);
+	}
+
+	void testAgainstLegacyStore()
+	{
+		HeightMap heightMap(0, RESOLUTION);
+		populate(heightMap);
+
+		LegacySegmentStore legacy;
+		for (int x = 0; x < SEGMENTS; ++x) {
+			for (int y = 0; y < SEGMENTS; ++y) {
+				legacy.mSegments[x][y] = std::shared_ptr<IHeightMapSegment>(createSegment(x, y));
+			}
+		}
+
+		const int size = SEGMENTS * RESOLUTION;
+		std::vector<WFMath::Point<2>> positions;
+		positions.reserve(size * 64);
+		for (int y = 0; y < size; y += 16) {
+			for (int x = 0; x < size; x += 4) {
+				positions.emplace_back(x + 0.3f, y + 0.6f);
+			}
+		}
+
+		std::vector<float> heights;
+		heightMap.getHeights(positions, heights);
+		for (size_t i = 0; i < positions.size(); ++i) {
+			CPPUNIT_ASSERT_EQUAL(legacy.getHeight(positions[i].x(), positions[i].y()), heights[i]);
+		}
+
+		std::vector<float> legacyHeights(size * size);
+		legacy.blitHeights(0, size, 0, size, legacyHeights);
+
+		std::vector<float> blitted(size * size);
+		heightMap.blitHeights(0, size, 0, size, blitted);
+		CPPUNIT_ASSERT(legacyHeights == blitted);
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::HeightMapTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
@@ -0,0 +1,186 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/ogre/TriangleBVH.h"
+
+#include <OgreMath.h>
+#include <OgreRay.h>
+#include <OgreVector3.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Ember::OgreView;
+
+namespace Ember
+{
+
+class MeshCollisionTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(MeshCollisionTestCase);
+	CPPUNIT_TEST(testSingleTriangle);
+	CPPUNIT_TEST(testAgainstBruteForce);
+	CPPUNIT_TEST(testTransformedMesh);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	/**
+	 * @brief Creates a bumpy grid facing upwards, similar to a high poly building or terrain mesh.
+	 */
+	static void createGrid(unsigned int size, std::vector<Ogre::Vector3>& vertices, std::vector<unsigned long>& indices)
+	{
+		for (unsigned int z = 0; z <= size; ++z) {
+			for (unsigned int x = 0; x <= size; ++x) {
+				vertices.emplace_back(x, std::sin(x * 0.3f) * std::cos(z * 0.2f) * 2.0f, z);
+			}
+		}
+		for (unsigned int z = 0; z < size; ++z) {
+			for (unsigned int x = 0; x < size; ++x) {
+				unsigned long i = z * (size + 1) + x;
+				indices.push_back(i);
+				indices.push_back(i + size + 1);
+				indices.push_back(i + 1);
+				indices.push_back(i + 1);
+				indices.push_back(i + size + 1);
+				indices.push_back(i + size + 2);
+			}
+		}
+	}
+
+	/**
+	 * @brief Intersects all triangles, the way picking was done before.
+	 */
+	static bool intersectBruteForce(const Ogre::Ray& ray, const std::vector<Ogre::Vector3>& vertices, const std::vector<unsigned long>& indices, Ogre::Real& distance)
+	{
+		bool hit = false;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			std::pair<bool, Ogre::Real> result = Ogre::Math::intersects(ray, vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], true, false);
+			if (result.first && (!hit || result.second < distance)) {
+				distance = result.second;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+
+	static Ogre::Ray createRay(std::mt19937& random, unsigned int size)
+	{
+		std::uniform_real_distribution<float> position(-10.0f, size + 10.0f);
+		std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+		Ogre::Vector3 direction(offset(random), -1.0f, offset(random));
+		direction.normalise();
+		return Ogre::Ray(Ogre::Vector3(position(random), 20.0f, position(random)), direction);
+	}
+
+	void testSingleTriangle()
+	{
+		std::vector<Ogre::Vector3> vertices { Ogre::Vector3(0, 0, 0), Ogre::Vector3(0, 0, 1), Ogre::Vector3(1, 0, 0) };
+		std::vector<unsigned long> indices { 0, 1, 2 };
+		TriangleBVH bvh(vertices, indices);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), bvh.getNumberOfTriangles());
+
+		Ogre::Real distance;
+		CPPUNIT_ASSERT(bvh.intersect(Ogre::Ray(Ogre::Vector3(0.2f, 5, 0.2f), Ogre::Vector3(0, -1, 0)), distance));
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(5.0, distance, 0.0001);
+		//Back faces should be ignored.
+		CPPUNIT_ASSERT(!bvh.intersect(Ogre::Ray(Ogre::Vector3(0.2f, -5, 0.2f), Ogre::Vector3(0, 1, 0)), distance));
+		CPPUNIT_ASSERT(!bvh.intersect(Ogre::Ray(Ogre::Vector3(0.8f, 5, 0.8f), Ogre::Vector3(0, -1, 0)), distance));
+
+		TriangleBVH empty(vertices, std::vector<unsigned long>());
+		CPPUNIT_ASSERT(!empty.intersect(Ogre::Ray(Ogre::Vector3(0.2f, 5, 0.2f), Ogre::Vector3(0, -1, 0)), distance));
+	}
+
+	void testAgainstBruteForce()
+	{
+		const unsigned int size = 64;
+		std::vector<Ogre::Vector3> vertices;
+		std::vector<unsigned long> indices;
+		createGrid(size, vertices, indices);
+		TriangleBVH bvh(vertices, indices);
+		CPPUNIT_ASSERT_EQUAL(indices.size() / 3, bvh.getNumberOfTriangles());
+
+		std::mt19937 random(1);
+		for (int i = 0; i < 1000; ++i) {
+			Ogre::Ray ray = createRay(random, size);
+			Ogre::Real expectedDistance = 0, distance = 0;
+			bool expected = intersectBruteForce(ray, vertices, indices, expectedDistance);
+			CPPUNIT_ASSERT_EQUAL(expected, bvh.intersect(ray, distance));
+			if (expected) {
+				CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedDistance, distance, 0.001);
+			}
+		}
+	}
+
+	void testTransformedMesh()
+	{
+		const unsigned int size = 200;
+		const int picks = 100;
+		std::vector<Ogre::Vector3> vertices;
+		std::vector<unsigned long> indices;
+		createGrid(size, vertices, indices);
+
+		//Place the mesh somewhere in the world; the bvh is queried in local space while the brute force check uses transformed vertices.
+		Ogre::Vector3 position(100, 5, -50);
+		Ogre::Vector3 scale(2, 2, 2);
+
+		std::mt19937 random(2);
+		std::vector<Ogre::Ray> rays;
+		for (int i = 0; i < picks; ++i) {
+			Ogre::Ray ray = createRay(random, size);
+			rays.emplace_back(ray.getOrigin() * scale + position, ray.getDirection());
+		}
+
+		int bruteForceHits = 0;
+		std::vector<Ogre::Vector3> worldVertices(vertices.size());
+		for (auto& ray : rays) {
+			for (size_t i = 0; i < vertices.size(); ++i) {
+				worldVertices[i] = vertices[i] * scale + position;
+			}
+			Ogre::Real distance;
+			if (intersectBruteForce(ray, worldVertices, indices, distance)) {
+				bruteForceHits++;
+			}
+		}
+
+		TriangleBVH bvh(vertices, indices);
+		CPPUNIT_ASSERT_EQUAL(indices.size() / 3, bvh.getNumberOfTriangles());
+
+		int bvhHits = 0;
+		for (auto& ray : rays) {
+			Ogre::Ray localRay((ray.getOrigin() - position) / scale, ray.getDirection() / scale);
+			Ogre::Real distance;
+			if (bvh.intersect(localRay, distance)) {
+				bvhHits++;
+			}
+		}
+
+		CPPUNIT_ASSERT(bvhHits > 0);
+		CPPUNIT_ASSERT_EQUAL(bruteForceHits, bvhHits);
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::MeshCollisionTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
@@ -0,0 +1,305 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "services/EmberServices.h"
+#include "services/sound/SoundService.h"
+#include "services/sound/SoundInstance.h"
+#include "services/sound/SoundStream.h"
+#include "services/sound/SoundSample.h"
+#include "framework/IResourceProvider.h"
+
+#include <Eris/Session.h>
+
+#include <vorbis/vorbisenc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace Ember
+{
+
+/**
+ * @brief Encodes a mono sine wave as Ogg Vorbis, so that the tests don't need any bundled sound files.
+ * @param seconds The length of the sound.
+ * @return The encoded data.
+ */
+std::string encodeSineWave(int seconds)
+{
+	const long rate = 22050;
+	std::string data;
+
+	vorbis_info info;
+	vorbis_info_init(&info);
+	if (vorbis_encode_init_vbr(&info, 1, rate, 0.1f) != 0) {
+		vorbis_info_clear(&info);
+		return data;
+	}
+	vorbis_comment comment;
+	vorbis_comment_init(&comment);
+	vorbis_dsp_state dspState;
+	vorbis_analysis_init(&dspState, &info);
+	vorbis_block block;
+	vorbis_block_init(&dspState, &block);
+	ogg_stream_state stream;
+	ogg_stream_init(&stream, 1);
+
+	ogg_page page;
+	auto appendPage = [&]() {
+		data.append(reinterpret_cast<const char*>(page.header), page.header_len);
+		data.append(reinterpret_cast<const char*>(page.body), page.body_len);
+	};
+
+	ogg_packet header, headerComment, headerCode;
+	vorbis_analysis_headerout(&dspState, &comment, &header, &headerComment, &headerCode);
+	ogg_stream_packetin(&stream, &header);
+	ogg_stream_packetin(&stream, &headerComment);
+	ogg_stream_packetin(&stream, &headerCode);
+	while (ogg_stream_flush(&stream, &page)) {
+		appendPage();
+	}
+
+	auto encodeBlocks = [&]() {
+		while (vorbis_analysis_blockout(&dspState, &block) == 1) {
+			vorbis_analysis(&block, nullptr);
+			vorbis_bitrate_addblock(&block);
+			ogg_packet packet;
+			while (vorbis_bitrate_flushpacket(&dspState, &packet)) {
+				ogg_stream_packetin(&stream, &packet);
+				while (ogg_stream_pageout(&stream, &page)) {
+					appendPage();
+				}
+			}
+		}
+	};
+
+	const long frames = rate * seconds;
+	const long framesPerWrite = 1024;
+	for (long offset = 0; offset < frames; offset += framesPerWrite) {
+		long count = std::min(framesPerWrite, frames - offset);
+		float** buffer = vorbis_analysis_buffer(&dspState, static_cast<int>(count));
+		for (long i = 0; i < count; ++i) {
+			buffer[0][i] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * (offset + i) / rate);
+		}
+		vorbis_analysis_wrote(&dspState, static_cast<int>(count));
+		encodeBlocks();
+	}
+	//Mark the end of the stream.
+	vorbis_analysis_wrote(&dspState, 0);
+	encodeBlocks();
+	while (ogg_stream_flush(&stream, &page)) {
+		appendPage();
+	}
+
+	ogg_stream_clear(&stream);
+	vorbis_block_clear(&block);
+	vorbis_dsp_clear(&dspState);
+	vorbis_comment_clear(&comment);
+	vorbis_info_clear(&info);
+	return data;
+}
+
+class MemoryResourceWrapper: public IResourceWrapper
+{
+public:
+	explicit MemoryResourceWrapper(const std::string& data) :
+			mData(data)
+	{
+	}
+
+	virtual const char* getDataPtr()
+	{
+		return mData.data();
+	}
+
+	virtual bool hasData()
+	{
+		return !mData.empty();
+	}
+
+	virtual size_t getSize()
+	{
+		return mData.size();
+	}
+
+private:
+	std::string mData;
+};
+
+/**
+ * @brief Provides the same data for any resource asked for.
+ */
+class MemoryResourceProvider: public IResourceProvider
+{
+public:
+	explicit MemoryResourceProvider(const std::string& data) :
+			mData(data)
+	{
+	}
+
+	virtual ResourceWrapper getResource(const std::string& name)
+	{
+		return ResourceWrapper(new MemoryResourceWrapper(mData), name);
+	}
+
+private:
+	std::string mData;
+};
+
+class SoundTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(SoundTestCase);
+	CPPUNIT_TEST(testInstanceCounters);
+	CPPUNIT_TEST(testStreamCounters);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+	struct StolenListener
+	{
+		int count = 0;
+
+		void stolen()
+		{
+			count++;
+		}
+	};
+
+public:
+
+	void setUp()
+	{
+		//Use the OpenAL Soft null device, so that the tests don't require any sound hardware.
+		setenv("ALSOFT_DRIVERS", "null", 1);
+	}
+
+	void testInstanceCounters()
+	{
+		Eris::Session session;
+		EmberServices services(session);
+		SoundService& soundService = services.getSoundService();
+		soundService.start();
+		CPPUNIT_ASSERT(soundService.isEnabled());
+
+		soundService.setMaxInstances(2);
+
+		SoundInstance* low = soundService.createInstance(0);
+		SoundInstance* high = soundService.createInstance(1);
+		CPPUNIT_ASSERT(low);
+		CPPUNIT_ASSERT(high);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), soundService.getStatistics().instances);
+		CPPUNIT_ASSERT_EQUAL(0u, soundService.getStatistics().stolenInstances);
+
+		StolenListener lowListener;
+		StolenListener highListener;
+		low->EventStolen.connect(sigc::mem_fun(lowListener, &StolenListener::stolen));
+		high->EventStolen.connect(sigc::mem_fun(highListener, &StolenListener::stolen));
+
+		//The pool is full, so the instance with the lowest priority should be stolen.
+		SoundInstance* newHigh = soundService.createInstance(1);
+		CPPUNIT_ASSERT(newHigh);
+		CPPUNIT_ASSERT_EQUAL(1, lowListener.count);
+		CPPUNIT_ASSERT_EQUAL(0, highListener.count);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), soundService.getStatistics().instances);
+		CPPUNIT_ASSERT_EQUAL(1u, soundService.getStatistics().stolenInstances);
+
+		//All remaining instances have higher priority, so nothing should be stolen.
+		CPPUNIT_ASSERT(!soundService.createInstance(0));
+		CPPUNIT_ASSERT_EQUAL(0, highListener.count);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), soundService.getStatistics().instances);
+		CPPUNIT_ASSERT_EQUAL(1u, soundService.getStatistics().stolenInstances);
+
+		CPPUNIT_ASSERT(soundService.destroyInstance(high));
+		CPPUNIT_ASSERT(soundService.destroyInstance(newHigh));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), soundService.getStatistics().instances);
+
+		soundService.stop();
+	}
+
+	void testStreamCounters()
+	{
+		Eris::Session session;
+		EmberServices services(session);
+		SoundService& soundService = services.getSoundService();
+		soundService.start();
+		CPPUNIT_ASSERT(soundService.isEnabled());
+
+		//Without any streamed sounds no memory should be used for stream buffers, and nothing should have been decoded.
+		SoundStatistics statistics = soundService.getStatistics();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streams);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streamBufferBytes);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.decodedBytes);
+		CPPUNIT_ASSERT_EQUAL(0u, statistics.underruns);
+		CPPUNIT_ASSERT_EQUAL(0L, statistics.maxStartLatency);
+		CPPUNIT_ASSERT(SoundStream::getRingSize() > 0);
+
+		//Ogg Vorbis sounds are streamed.
+		MemoryResourceProvider resourceProvider(encodeSineWave(2));
+		soundService.setResourceProvider(&resourceProvider);
+		BaseSoundSample* sample = soundService.createOrRetrieveSoundSample("sine.ogg");
+		CPPUNIT_ASSERT(sample);
+		CPPUNIT_ASSERT_EQUAL(SoundGeneral::SAMPLE_OGG, sample->getType());
+
+		SoundInstance* instance = soundService.createInstance();
+		CPPUNIT_ASSERT(instance);
+		instance->bind(sample->createBinding(instance->getSource()));
+		CPPUNIT_ASSERT(instance->play());
+		statistics = soundService.getStatistics();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), statistics.streams);
+		CPPUNIT_ASSERT_EQUAL(SoundStream::getRingSize(), statistics.streamBufferBytes);
+
+		//Cycle as the main loop would, until the first decoded data has been queued for playback.
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (soundService.getStatistics().maxStartLatency == 0 && std::chrono::steady_clock::now() < deadline) {
+			soundService.cycle();
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		statistics = soundService.getStatistics();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), statistics.streams);
+		CPPUNIT_ASSERT(statistics.decodedBytes > 0);
+		CPPUNIT_ASSERT(statistics.maxStartLatency > 0);
+		CPPUNIT_ASSERT_EQUAL(statistics.maxStartLatency, statistics.lastStartLatency);
+
+		//Once the instance is gone the stream and its buffers should be released, while the totals are kept.
+		CPPUNIT_ASSERT(instance->stop());
+		CPPUNIT_ASSERT(soundService.destroyInstance(instance));
+		statistics = soundService.getStatistics();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streams);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streamBufferBytes);
+		CPPUNIT_ASSERT(statistics.decodedBytes > 0);
+
+		soundService.stop();
+		CPPUNIT_ASSERT(!soundService.isEnabled());
+		statistics = soundService.getStatistics();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streams);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.streamBufferBytes);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), statistics.decodedBytes);
+		CPPUNIT_ASSERT_EQUAL(0L, statistics.maxStartLatency);
+		soundService.setResourceProvider(nullptr);
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::SoundTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
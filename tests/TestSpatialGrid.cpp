@@ -0,0 +1,184 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/navigation/SpatialGrid.h"
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Ember::Navigation;
+
+namespace Ember
+{
+
+/**
+ * @brief Number of entities to use in the comparison with a linear search; roughly a large town.
+ */
+const int ENTITY_COUNT = 10000;
+
+/**
+ * @brief Size of one side of the world used in the comparison with a linear search.
+ */
+const float WORLD_SIZE = 2048;
+
+/**
+ * @brief Size of one side of a grid cell; the same as a navmesh tile with default settings.
+ */
+const float CELL_SIZE = 64;
+
+bool boxesIntersect(const WFMath::AxisBox<2>& a, const WFMath::AxisBox<2>& b)
+{
+	return a.lowCorner().x() <= b.highCorner().x() && a.highCorner().x() >= b.lowCorner().x() && a.lowCorner().y() <= b.highCorner().y() && a.highCorner().y() >= b.lowCorner().y();
+}
+
+WFMath::AxisBox<2> makeBox(float x, float y, float size)
+{
+	return WFMath::AxisBox<2>(WFMath::Point<2>(x, y), WFMath::Point<2>(x + size, y + size));
+}
+
+class SpatialGridTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(SpatialGridTestCase);
+	CPPUNIT_TEST(testInsertRemove);
+	CPPUNIT_TEST(testQuery);
+	CPPUNIT_TEST(testAgainstLinearSearch);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	void testInsertRemove()
+	{
+		SpatialGrid<int> grid(10, WFMath::Point<2>(-100, -100));
+		grid.insert(1, makeBox(0, 0, 5));
+		grid.insert(2, makeBox(-50, -50, 30));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), grid.size());
+		CPPUNIT_ASSERT(grid.contains(1));
+
+		std::vector<int> result;
+		grid.query(makeBox(1, 1, 1), result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT_EQUAL(1, result.front());
+
+		//Moving an item should make it show up at the new position only.
+		grid.insert(1, makeBox(200, 200, 5));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), grid.size());
+		result.clear();
+		grid.query(makeBox(1, 1, 1), result);
+		CPPUNIT_ASSERT(result.empty());
+		grid.query(makeBox(202, 202, 1), result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+
+		CPPUNIT_ASSERT(grid.remove(1));
+		CPPUNIT_ASSERT(!grid.remove(1));
+		CPPUNIT_ASSERT(!grid.contains(1));
+		result.clear();
+		grid.query(makeBox(202, 202, 1), result);
+		CPPUNIT_ASSERT(result.empty());
+	}
+
+	void testQuery()
+	{
+		SpatialGrid<int> grid(10);
+		//An item spanning many cells must only be reported once.
+		grid.insert(1, makeBox(-25, -25, 50));
+		grid.insert(2, makeBox(12, 12, 2));
+		grid.insert(3, makeBox(40, 40, 2));
+
+		std::vector<int> result;
+		grid.query(makeBox(-30, -30, 60), result);
+		std::sort(result.begin(), result.end());
+		CPPUNIT_ASSERT_EQUAL(size_t(2), result.size());
+		CPPUNIT_ASSERT_EQUAL(1, result[0]);
+		CPPUNIT_ASSERT_EQUAL(2, result[1]);
+
+		//Items sharing a cell with the query, but not intersecting it, must not be reported.
+		result.clear();
+		grid.query(makeBox(15, 15, 2), result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT_EQUAL(1, result[0]);
+	}
+
+	void testAgainstLinearSearch()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(0, WORLD_SIZE);
+		std::uniform_real_distribution<float> size(0.5f, 20);
+
+		std::vector<WFMath::AxisBox<2>> boxes;
+		boxes.reserve(ENTITY_COUNT);
+		SpatialGrid<int> grid(CELL_SIZE);
+
+		for (int i = 0; i < ENTITY_COUNT; ++i) {
+			boxes.push_back(makeBox(position(random), position(random), size(random)));
+			grid.insert(i, boxes.back());
+		}
+
+		//Query once for each tile, as is done when rebuilding the whole navmesh.
+		std::vector<WFMath::AxisBox<2>> tiles;
+		for (float x = 0; x < WORLD_SIZE; x += CELL_SIZE) {
+			for (float y = 0; y < WORLD_SIZE; y += CELL_SIZE) {
+				tiles.push_back(makeBox(x, y, CELL_SIZE));
+			}
+		}
+
+		size_t linearMatches = 0;
+		for (auto& tile : tiles) {
+			for (auto& box : boxes) {
+				if (boxesIntersect(tile, box)) {
+					linearMatches++;
+				}
+			}
+		}
+
+		size_t gridMatches = 0;
+		std::vector<int> result;
+		for (auto& tile : tiles) {
+			result.clear();
+			grid.query(tile, result);
+			gridMatches += result.size();
+		}
+		CPPUNIT_ASSERT_EQUAL(linearMatches, gridMatches);
+
+		//Move every entity a bit, as is done when entities are updated.
+		for (int i = 0; i < ENTITY_COUNT; ++i) {
+			auto& box = boxes[i];
+			box = makeBox(box.lowCorner().x() + 3, box.lowCorner().y() + 3, box.highCorner().x() - box.lowCorner().x());
+			grid.insert(i, box);
+		}
+
+		for (auto& tile : tiles) {
+			result.clear();
+			grid.query(tile, result);
+			size_t expected = std::count_if(boxes.begin(), boxes.end(), [&](const WFMath::AxisBox<2>& box) {return boxesIntersect(tile, box);});
+			CPPUNIT_ASSERT_EQUAL(expected, result.size());
+		}
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::SpatialGridTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
\ No newline at end of file
@@ -20,6 +20,9 @@
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <vector>
 
 namespace Ember
 {
@@ -115,6 +118,94 @@ public:
 	}
 };
 
+/**
+ * @brief A task which does a small amount of busy work.
+ */
+class BusyTask: public Tasks::ITask
+{
+public:
+
+	std::atomic<int>& executed;
+
+	BusyTask(std::atomic<int>& executed)
+	: executed(executed)
+	{
+	}
+
+	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context) override
+	{
+		auto start = std::chrono::steady_clock::now();
+		//Spin for a short while to simulate some work.
+		while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(50)) {
+		}
+		executed++;
+	}
+
+	std::string getName() const override {
+		return "BusyTask";
+	}
+};
+
+/**
+ * @brief A task which waits until a number of instances of it are executing at the same time, recording the highest number seen.
+ * If that number isn't reached within a couple of seconds it gives up, so that the test fails instead of hanging.
+ */
+class OverlapTask: public Tasks::ITask
+{
+public:
+
+	std::atomic<int>& running;
+	std::atomic<int>& maxRunning;
+	int expected;
+
+	OverlapTask(std::atomic<int>& running, std::atomic<int>& maxRunning, int expected)
+	: running(running), maxRunning(maxRunning), expected(expected)
+	{
+	}
+
+	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context) override
+	{
+		int current = ++running;
+		int seen = maxRunning;
+		while (current > seen && !maxRunning.compare_exchange_weak(seen, current)) {
+		}
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (maxRunning < expected && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		--running;
+	}
+
+	std::string getName() const override {
+		return "OverlapTask";
+	}
+};
+
+/**
+ * @brief A task which executes a number of subtasks in parallel.
+ */
+class ParallelTask: public Tasks::ITask
+{
+public:
+
+	std::vector<Tasks::ITask*> subtasks;
+
+	ParallelTask(std::vector<Tasks::ITask*> subtasks)
+	: subtasks(std::move(subtasks))
+	{
+	}
+
+	void executeTaskInBackgroundThread(Tasks::TaskExecutionContext& context) override
+	{
+		context.executeTasksInParallel(subtasks);
+		subtasks.clear();
+	}
+
+	std::string getName() const override {
+		return "ParallelTask";
+	}
+};
+
 class SimpleListener : public Tasks::ITaskExecutionListener {
 public:
 
@@ -160,6 +251,11 @@ class TaskTestCase: public CppUnit::TestFixture
 	CPPUNIT_TEST(testBackgroundException);
 	CPPUNIT_TEST(testTaskOrder);
 	CPPUNIT_TEST(testSubTaskOrder);
+	CPPUNIT_TEST(testPriority);
+	CPPUNIT_TEST(testWorkStealing);
+	CPPUNIT_TEST(testBatchedCompletion);
+	CPPUNIT_TEST(testParallelSubtasks);
+	CPPUNIT_TEST(testManyTasks);
 
 	CPPUNIT_TEST_SUITE_END();
 
@@ -301,6 +397,126 @@ public:
 		CPPUNIT_ASSERT(time1.time < time3.time);
 	}
 
+	void testPriority()
+	{
+		int counter = 0;
+		SimpleListener listenerLow;
+		SimpleListener listenerHigh;
+		TimeHolder timeLow;
+		TimeHolder timeHigh;
+		{
+			Eris::EventService es(io_service);
+			Tasks::TaskQueue taskQueue(1, es);
+			//Keep the executor busy so that the other tasks are queued up.
+			taskQueue.enqueueTask(new CounterTask(counter, 100));
+			taskQueue.enqueueTask(new TimeTask(timeLow), &listenerLow, -10);
+			taskQueue.enqueueTask(new TimeTask(timeHigh), &listenerHigh, 10);
+		}
+		CPPUNIT_ASSERT(counter == 0);
+		CPPUNIT_ASSERT(listenerHigh.startedTime < listenerLow.startedTime);
+		CPPUNIT_ASSERT(timeHigh.time < timeLow.time);
+	}
+
+	void testWorkStealing()
+	{
+		std::atomic<int> running(0);
+		std::atomic<int> maxRunning(0);
+		int counter = 0;
+		{
+			Eris::EventService es(io_service);
+			Tasks::TaskQueue taskQueue(2, es);
+			//The tasks are distributed round robin, so the first executor will get both overlapping tasks.
+			//They can only ever be executing at the same time if the second executor steals one of them.
+			taskQueue.enqueueTask(new OverlapTask(running, maxRunning, 2));
+			taskQueue.enqueueTask(new CounterTask(counter));
+			taskQueue.enqueueTask(new OverlapTask(running, maxRunning, 2));
+			taskQueue.deactivate();
+			CPPUNIT_ASSERT(maxRunning == 2);
+		}
+		CPPUNIT_ASSERT(running == 0);
+		CPPUNIT_ASSERT(counter == 0);
+	}
+
+	void testBatchedCompletion()
+	{
+		int counter = 0;
+		{
+			Eris::EventService es(io_service);
+			Tasks::TaskQueue taskQueue(1, es);
+			taskQueue.setCompletionTimeBudget(boost::posix_time::seconds(10));
+			taskQueue.enqueueTask(new CounterTask(counter));
+			taskQueue.enqueueTask(new CounterTask(counter));
+			taskQueue.enqueueTask(new CounterTask(counter));
+			//200 ms should be enough... This isn't deterministic though.
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			//All three tasks should be handled in one handler run.
+			es.processOneHandler();
+			CPPUNIT_ASSERT(counter == 0);
+			auto statistics = taskQueue.takeCompletionStatistics();
+			CPPUNIT_ASSERT(statistics.unitsCompleted == 3);
+			CPPUNIT_ASSERT(statistics.batches == 1);
+			CPPUNIT_ASSERT(statistics.backlog == 0);
+			statistics = taskQueue.takeCompletionStatistics();
+			CPPUNIT_ASSERT(statistics.unitsCompleted == 0);
+		}
+	}
+
+	void testParallelSubtasks()
+	{
+		std::atomic<int> running(0);
+		std::atomic<int> maxRunning(0);
+		{
+			Eris::EventService es(io_service);
+			Tasks::TaskQueue taskQueue(4, es);
+			std::vector<Tasks::ITask*> subtasks;
+			for (int i = 0; i < 4; ++i) {
+				subtasks.push_back(new OverlapTask(running, maxRunning, 4));
+			}
+			taskQueue.enqueueTask(new ParallelTask(subtasks));
+			taskQueue.deactivate();
+			//With four executors all four subtasks should be executing at the same time.
+			CPPUNIT_ASSERT(maxRunning == 4);
+			auto statistics = taskQueue.getExecutionStatistics();
+			CPPUNIT_ASSERT(statistics["OverlapTask"].count == 4);
+			CPPUNIT_ASSERT(statistics["ParallelTask"].count == 1);
+		}
+		CPPUNIT_ASSERT(running == 0);
+
+		//With only one executor the subtasks should be executed serially by the parent.
+		std::vector<int> serialCounters(2, 0);
+		{
+			Eris::EventService es(io_service);
+			Tasks::TaskQueue taskQueue(1, es);
+			std::vector<Tasks::ITask*> subtasks;
+			for (auto& counter : serialCounters) {
+				subtasks.push_back(new CounterTask(counter));
+			}
+			taskQueue.enqueueTask(new ParallelTask(subtasks));
+		}
+		for (auto counter : serialCounters) {
+			CPPUNIT_ASSERT(counter == 0);
+		}
+	}
+
+	void testManyTasks()
+	{
+		const int numberOfTasks = 5000;
+		unsigned int maxExecutors = std::max(2u, std::thread::hardware_concurrency());
+		for (unsigned int executors = 1; executors <= maxExecutors; executors *= 2) {
+			std::atomic<int> executed(0);
+			{
+				Eris::EventService es(io_service);
+				Tasks::TaskQueue taskQueue(executors, es);
+				for (int i = 0; i < numberOfTasks; ++i) {
+					taskQueue.enqueueTask(new BusyTask(executed));
+				}
+				taskQueue.deactivate();
+				auto statistics = taskQueue.getExecutionStatistics();
+				CPPUNIT_ASSERT(statistics["BusyTask"].count == static_cast<size_t>(numberOfTasks));
+			}
+			CPPUNIT_ASSERT(executed == numberOfTasks);
+		}
+	}
 
 };
 
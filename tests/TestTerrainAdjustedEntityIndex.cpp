@@ -0,0 +1,304 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/ogre/TerrainAdjustedEntityIndex.h"
+
+#include <Eris/Entity.h>
+
+#include <Atlas/Message/Element.h>
+
+#include <wfmath/axisbox.h>
+#include <wfmath/point.h>
+#include <wfmath/quaternion.h>
+#include <wfmath/atlasconv.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+using Ember::OgreView::TerrainAdjustedEntityIndex;
+
+namespace Ember
+{
+
+/**
+ * @brief Number of entities to use in the terrain update test.
+ */
+const int ENTITY_COUNT = 5000;
+
+/**
+ * @brief Size of one side of the world used in the terrain update test.
+ */
+const float WORLD_SIZE = 2048;
+
+bool boxesIntersect(const WFMath::AxisBox<2>& a, const WFMath::AxisBox<2>& b)
+{
+	return a.lowCorner().x() <= b.highCorner().x() && a.highCorner().x() >= b.lowCorner().x() && a.lowCorner().y() <= b.highCorner().y() && a.highCorner().y() >= b.lowCorner().y();
+}
+
+WFMath::AxisBox<2> makeBox(float x, float y, float size)
+{
+	return WFMath::AxisBox<2>(WFMath::Point<2>(x, y), WFMath::Point<2>(x + size, y + size));
+}
+
+bool boxesEqual(const WFMath::AxisBox<2>& a, const WFMath::AxisBox<2>& b)
+{
+	const float epsilon = 0.001f;
+	return std::abs(a.lowCorner().x() - b.lowCorner().x()) < epsilon && std::abs(a.lowCorner().y() - b.lowCorner().y()) < epsilon
+			&& std::abs(a.highCorner().x() - b.highCorner().x()) < epsilon && std::abs(a.highCorner().y() - b.highCorner().y()) < epsilon;
+}
+
+/**
+ * @brief An entity which can be placed, moved and resized without any view or connection.
+ */
+class TestEntity: public Eris::Entity
+{
+public:
+	explicit TestEntity(const std::string& id) :
+		Eris::Entity(id, 0)
+	{
+	}
+
+	~TestEntity()
+	{
+		shutdown();
+	}
+
+	Eris::TypeService* getTypeService() const
+	{
+		return 0;
+	}
+
+	void removeFromMovementPrediction()
+	{
+	}
+
+	void addToMovementPredition()
+	{
+	}
+
+	Eris::Entity* getEntity(const std::string& id)
+	{
+		return 0;
+	}
+
+	void setLocation(Eris::Entity* location)
+	{
+		Eris::Entity::setLocation(location);
+	}
+
+	void setAttributes(const Atlas::Message::MapType& attributes)
+	{
+		beginUpdate();
+		for (auto& entry : attributes) {
+			setAttr(entry.first, entry.second);
+		}
+		endUpdate();
+	}
+
+	void place(float x, float y, float size)
+	{
+		setAttributes({ { "pos", WFMath::Point<3>(x, y, 0).toAtlas() }, { "bbox", WFMath::AxisBox<3>(WFMath::Point<3>(0, 0, 0), WFMath::Point<3>(size, size, 1)).toAtlas() } });
+	}
+};
+
+class TerrainAdjustedEntityIndexTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(TerrainAdjustedEntityIndexTestCase);
+	CPPUNIT_TEST(testFootprint);
+	CPPUNIT_TEST(testIndexMaintenance);
+	CPPUNIT_TEST(testIndexBboxChange);
+	CPPUNIT_TEST(testTerrainUpdate);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+public:
+
+	void testFootprint()
+	{
+		WFMath::AxisBox<3> bbox(WFMath::Point<3>(-2, -1, 0), WFMath::Point<3>(2, 1, 1));
+		WFMath::Point<3> position(10, 20, 5);
+
+		//Without any orientation the bbox is just moved.
+		CPPUNIT_ASSERT(boxesEqual(WFMath::AxisBox<2>(WFMath::Point<2>(8, 19), WFMath::Point<2>(12, 21)), TerrainAdjustedEntityIndex::getFootprint(position, WFMath::Quaternion(), bbox)));
+
+		//Rotated a quarter turn around the z axis the bbox is stretched along the y axis instead.
+		CPPUNIT_ASSERT(boxesEqual(WFMath::AxisBox<2>(WFMath::Point<2>(9, 18), WFMath::Point<2>(11, 22)), TerrainAdjustedEntityIndex::getFootprint(position, WFMath::Quaternion(2, WFMath::numeric_constants<float>::pi() / 2), bbox)));
+
+		//Rotated an eighth of a turn the footprint encloses the rotated corners.
+		float extent = 3 * std::sqrt(2.0f) / 2;
+		CPPUNIT_ASSERT(boxesEqual(WFMath::AxisBox<2>(WFMath::Point<2>(10 - extent, 20 - extent), WFMath::Point<2>(10 + extent, 20 + extent)),
+				TerrainAdjustedEntityIndex::getFootprint(position, WFMath::Quaternion(2, WFMath::numeric_constants<float>::pi() / 4), bbox)));
+
+		//Rotations around other axes don't affect the footprint.
+		CPPUNIT_ASSERT(boxesEqual(WFMath::AxisBox<2>(WFMath::Point<2>(8, 19), WFMath::Point<2>(12, 21)), TerrainAdjustedEntityIndex::getFootprint(position, WFMath::Quaternion(0, 1.0f), bbox)));
+
+		//Without a bbox the footprint is just the position.
+		CPPUNIT_ASSERT(boxesEqual(WFMath::AxisBox<2>(WFMath::Point<2>(10, 20), WFMath::Point<2>(10, 20)), TerrainAdjustedEntityIndex::getFootprint(position, WFMath::Quaternion(), WFMath::AxisBox<3>())));
+	}
+
+	void testIndexMaintenance()
+	{
+		TestEntity world("0");
+		TestEntity first("1");
+		TestEntity second("2");
+		first.setLocation(&world);
+		first.place(10, 10, 2);
+		second.setLocation(&first);
+		second.place(0, 0, 1);
+
+		TerrainAdjustedEntityIndex index;
+		index.setTopLevel(&world);
+
+		//Only entities directly contained by the world are indexed.
+		CPPUNIT_ASSERT_EQUAL(size_t(1), index.size());
+		std::vector<Eris::Entity*> result;
+		index.query({ makeBox(9, 9, 2) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT(result.front() == &first);
+
+		//Entities overlapping multiple areas are only reported once.
+		result.clear();
+		index.query({ makeBox(9, 9, 2), makeBox(11, 11, 2) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+
+		//Moving an entity should make it show up at the new position only.
+		first.place(500, 500, 2);
+		result.clear();
+		index.query({ makeBox(9, 9, 2) }, result);
+		CPPUNIT_ASSERT(result.empty());
+		index.query({ makeBox(501, 501, 1) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT(result.front() == &first);
+
+		//Entities moved into the world should be indexed, and those moved out of it removed.
+		second.setLocation(&world);
+		second.place(100, 100, 1);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), index.size());
+		result.clear();
+		index.query({ makeBox(99, 99, 2) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT(result.front() == &second);
+
+		first.setLocation(&second);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), index.size());
+		result.clear();
+		index.query({ makeBox(501, 501, 1) }, result);
+		CPPUNIT_ASSERT(result.empty());
+
+		//Entities seen after the world has been set are indexed too.
+		TestEntity third("3");
+		third.setLocation(&world);
+		third.place(200, 200, 1);
+		index.addEntity(&third);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), index.size());
+
+		//Deleted entities should be removed.
+		second.shutdown();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), index.size());
+		result.clear();
+		index.query({ makeBox(99, 99, 2), makeBox(199, 199, 2) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+		CPPUNIT_ASSERT(result.front() == &third);
+	}
+
+	void testIndexBboxChange()
+	{
+		TestEntity world("0");
+		TestEntity entity("1");
+		entity.setLocation(&world);
+		entity.place(10, 10, 1);
+
+		TerrainAdjustedEntityIndex index;
+		index.setTopLevel(&world);
+
+		std::vector<Eris::Entity*> result;
+		index.query({ makeBox(20, 20, 1) }, result);
+		CPPUNIT_ASSERT(result.empty());
+
+		//Growing the bbox, without moving the entity, should make it cover more of the terrain.
+		entity.setAttributes({ { "bbox", WFMath::AxisBox<3>(WFMath::Point<3>(0, 0, 0), WFMath::Point<3>(15, 15, 1)).toAtlas() } });
+		index.query({ makeBox(20, 20, 1) }, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+
+		//And shrinking it should make it cover less.
+		entity.setAttributes({ { "bbox", WFMath::AxisBox<3>(WFMath::Point<3>(0, 0, 0), WFMath::Point<3>(1, 1, 1)).toAtlas() } });
+		result.clear();
+		index.query({ makeBox(20, 20, 1) }, result);
+		CPPUNIT_ASSERT(result.empty());
+
+		//Rotating it should affect the footprint too. Look on both sides, so that the direction of the rotation doesn't matter.
+		entity.setAttributes({ { "bbox", WFMath::AxisBox<3>(WFMath::Point<3>(0, 0, 0), WFMath::Point<3>(15, 1, 1)).toAtlas() } });
+		std::vector<WFMath::AxisBox<2>> alongY { makeBox(9.5f, 20, 1), makeBox(9.5f, -1, 1) };
+		index.query(alongY, result);
+		CPPUNIT_ASSERT(result.empty());
+		entity.setAttributes({ { "orientation", WFMath::Quaternion(2, WFMath::numeric_constants<float>::pi() / 2).toAtlas() } });
+		index.query(alongY, result);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), result.size());
+	}
+
+	void testTerrainUpdate()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(0, WORLD_SIZE);
+		std::uniform_real_distribution<float> size(0.5f, 10);
+
+		TestEntity world("0");
+		std::vector<std::unique_ptr<TestEntity>> entities;
+		entities.reserve(ENTITY_COUNT);
+		for (int i = 0; i < ENTITY_COUNT; ++i) {
+			entities.emplace_back(new TestEntity(std::to_string(i + 1)));
+			entities.back()->setLocation(&world);
+			entities.back()->place(position(random), position(random), size(random));
+		}
+		TerrainAdjustedEntityIndex index;
+		index.setTopLevel(&world);
+		CPPUNIT_ASSERT_EQUAL(size_t(ENTITY_COUNT), index.size());
+
+		//A typical terrain mod, along with an area, both changed in the same update.
+		std::vector<WFMath::AxisBox<2>> areas { makeBox(1000, 1000, 20), makeBox(990, 1010, 100) };
+
+		//Find the affected entities by looking at all of them, as was done before the index.
+		std::vector<Eris::Entity*> allResult;
+		for (unsigned int i = 0; i < world.numContained(); ++i) {
+			Eris::Entity* entity = world.getContained(i);
+			WFMath::AxisBox<2> footprint = TerrainAdjustedEntityIndex::getFootprint(entity->getPredictedPos(), entity->getOrientation(), entity->getBBox());
+			if (boxesIntersect(areas[0], footprint) || boxesIntersect(areas[1], footprint)) {
+				allResult.push_back(entity);
+			}
+		}
+
+		std::vector<Eris::Entity*> indexResult;
+		index.query(areas, indexResult);
+
+		std::sort(allResult.begin(), allResult.end());
+		std::sort(indexResult.begin(), indexResult.end());
+		CPPUNIT_ASSERT(!indexResult.empty());
+		CPPUNIT_ASSERT(allResult == indexResult);
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::TerrainAdjustedEntityIndexTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}
\ No newline at end of file
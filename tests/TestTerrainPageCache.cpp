@@ -0,0 +1,299 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/BriefTestProgressListener.h>
+#include <cppunit/TestResult.h>
+
+#include "components/ogre/terrain/TerrainPageCache.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+using namespace Ember::OgreView::Terrain;
+
+namespace Ember
+{
+
+class TerrainPageCacheTestCase: public CppUnit::TestFixture
+{
+CPPUNIT_TEST_SUITE(TerrainPageCacheTestCase);
+	CPPUNIT_TEST(testRoundTrip);
+	CPPUNIT_TEST(testContents);
+	CPPUNIT_TEST(testCorruptFile);
+	CPPUNIT_TEST(testTruncatedFile);
+	CPPUNIT_TEST(testEviction);
+
+	CPPUNIT_TEST_SUITE_END()
+	;
+
+	boost::filesystem::path mDirectory;
+
+	static TerrainPageCache::PageData createPageData(bool withBlendMaps, bool withShadow)
+	{
+		TerrainPageCache::PageData data;
+		for (int x = 0; x < 2; ++x) {
+			for (int y = 0; y < 2; ++y) {
+				std::string segmentData;
+				for (int i = 0; i < 4096; ++i) {
+					segmentData.push_back(static_cast<char>((i * 7 + x * 13 + y * 17) % 251));
+				}
+				data.segments.push_back(TerrainPageCache::PageData::SegmentData { x, y, segmentData });
+			}
+		}
+		if (withBlendMaps) {
+			std::shared_ptr<BlendMapCache::BlendMap> blendMap(new BlendMapCache::BlendMap());
+			blendMap->width = 4;
+			blendMap->levels.emplace_back(4 * 4 * 4, 10);
+			blendMap->levels.emplace_back(2 * 2 * 4, 20);
+			blendMap->levels.emplace_back(1 * 1 * 4, 30);
+			BlendMapCache::StoredBlendMap storedBlendMap;
+			storedBlendMap.key = "blendmap";
+			storedBlendMap.layerIndices = { 1, 2, 3 };
+			storedBlendMap.blendMap = blendMap;
+			data.blendMaps.push_back(storedBlendMap);
+		}
+		if (withShadow) {
+			data.shadowWidth = 8;
+			for (int i = 0; i < 8 * 8; ++i) {
+				data.shadow.push_back(static_cast<unsigned char>(i * 3));
+				data.normals.push_back(static_cast<int8_t>(i));
+				data.normals.push_back(static_cast<int8_t>(-i));
+				data.normals.push_back(static_cast<int8_t>(127));
+			}
+			data.shadowLightDirection = WFMath::Vector<3>(0, 0.5f, 1);
+		}
+		return data;
+	}
+
+	std::string getPath(TerrainPageCache::Key key) const
+	{
+		std::stringstream ss;
+		ss << std::hex << std::setw(16) << std::setfill('0') << key << ".page";
+		return (mDirectory / ss.str()).string();
+	}
+
+	size_t getPageSize()
+	{
+		//All pages created by createPageData() with the same contents have the same size, since only the key differs.
+		boost::filesystem::path directory = mDirectory / "size";
+		TerrainPageCache cache;
+		cache.setDirectory(directory.string(), 1024 * 1024);
+		cache.save(1, createPageData(false, false));
+		size_t size = cache.getStatistics().diskUsed;
+		cache.setDirectory("", 0);
+		boost::filesystem::remove_all(directory);
+		return size;
+	}
+
+public:
+
+	void setUp()
+	{
+		mDirectory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ember-pagecache-%%%%-%%%%");
+	}
+
+	void tearDown()
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove_all(mDirectory, ec);
+	}
+
+	void testRoundTrip()
+	{
+		TerrainPageCache::PageData stored = createPageData(true, true);
+		{
+			TerrainPageCache cache;
+			cache.setDirectory(mDirectory.string(), 1024 * 1024);
+			CPPUNIT_ASSERT(cache.isEnabled());
+			cache.save(42, stored);
+			CPPUNIT_ASSERT_EQUAL(size_t(1), cache.getStatistics().stores);
+			CPPUNIT_ASSERT(boost::filesystem::exists(getPath(42)));
+		}
+
+		//The page should be picked up by a new session.
+		TerrainPageCache cache;
+		cache.setDirectory(mDirectory.string(), 1024 * 1024);
+		CPPUNIT_ASSERT(cache.contains(42));
+		CPPUNIT_ASSERT(!cache.contains(43));
+
+		TerrainPageCache::PageData loaded;
+		CPPUNIT_ASSERT(cache.load(42, loaded));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cache.getStatistics().hits);
+
+		CPPUNIT_ASSERT_EQUAL(stored.segments.size(), loaded.segments.size());
+		for (size_t i = 0; i < stored.segments.size(); ++i) {
+			CPPUNIT_ASSERT_EQUAL(stored.segments[i].xIndex, loaded.segments[i].xIndex);
+			CPPUNIT_ASSERT_EQUAL(stored.segments[i].yIndex, loaded.segments[i].yIndex);
+			CPPUNIT_ASSERT(stored.segments[i].data == loaded.segments[i].data);
+		}
+
+		CPPUNIT_ASSERT_EQUAL(size_t(1), loaded.blendMaps.size());
+		CPPUNIT_ASSERT_EQUAL(stored.blendMaps[0].key, loaded.blendMaps[0].key);
+		CPPUNIT_ASSERT(stored.blendMaps[0].layerIndices == loaded.blendMaps[0].layerIndices);
+		CPPUNIT_ASSERT_EQUAL(stored.blendMaps[0].blendMap->width, loaded.blendMaps[0].blendMap->width);
+		CPPUNIT_ASSERT(stored.blendMaps[0].blendMap->levels == loaded.blendMaps[0].blendMap->levels);
+
+		CPPUNIT_ASSERT_EQUAL(stored.shadowWidth, loaded.shadowWidth);
+		CPPUNIT_ASSERT(stored.shadow == loaded.shadow);
+		CPPUNIT_ASSERT(stored.normals == loaded.normals);
+		CPPUNIT_ASSERT(stored.shadowLightDirection == loaded.shadowLightDirection);
+
+		TerrainPageCache::PageData missing;
+		CPPUNIT_ASSERT(!cache.load(43, missing));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cache.getStatistics().misses);
+	}
+
+	void testContents()
+	{
+		TerrainPageCache cache;
+		cache.setDirectory(mDirectory.string(), 1024 * 1024);
+
+		cache.save(1, createPageData(true, false));
+		CPPUNIT_ASSERT(cache.contains(1, TerrainPageCache::CONTENTS_SEGMENTS | TerrainPageCache::CONTENTS_BLEND_MAPS));
+		CPPUNIT_ASSERT(!cache.contains(1, TerrainPageCache::CONTENTS_SHADOW));
+
+		cache.save(1, createPageData(true, true));
+		CPPUNIT_ASSERT(cache.contains(1, TerrainPageCache::CONTENTS_SEGMENTS | TerrainPageCache::CONTENTS_BLEND_MAPS | TerrainPageCache::CONTENTS_SHADOW));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cache.getStatistics().entries);
+
+		//A page with less contents shouldn't replace one with more.
+		cache.save(1, createPageData(true, false));
+		CPPUNIT_ASSERT(cache.contains(1, TerrainPageCache::CONTENTS_SHADOW));
+		TerrainPageCache::PageData loaded;
+		CPPUNIT_ASSERT(cache.load(1, loaded));
+		CPPUNIT_ASSERT(!loaded.shadow.empty());
+	}
+
+	void testCorruptFile()
+	{
+		TerrainPageCache cache;
+		cache.setDirectory(mDirectory.string(), 1024 * 1024);
+		cache.save(1, createPageData(true, true));
+		cache.save(2, createPageData(true, true));
+
+		//Overwrite part of the compressed data, keeping the headers intact.
+		{
+			std::fstream stream(getPath(1), std::ios::binary | std::ios::in | std::ios::out);
+			stream.seekp(0, std::ios::end);
+			std::streamoff size = stream.tellp();
+			stream.seekp(size / 2);
+			std::string garbage(static_cast<size_t>(size / 4), '\xff');
+			stream.write(garbage.data(), garbage.size());
+		}
+		//Break the header of the second one.
+		{
+			std::fstream stream(getPath(2), std::ios::binary | std::ios::in | std::ios::out);
+			stream.write("XXXX", 4);
+		}
+
+		TerrainPageCache::PageData loaded;
+		CPPUNIT_ASSERT(!cache.load(1, loaded));
+		CPPUNIT_ASSERT(!cache.load(2, loaded));
+
+		//Corrupt pages should be removed, so that they're generated and stored anew.
+		CPPUNIT_ASSERT(!cache.contains(1));
+		CPPUNIT_ASSERT(!cache.contains(2));
+		CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(1)));
+		CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(2)));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.getStatistics().entries);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.getStatistics().diskUsed);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.getStatistics().hits);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cache.getStatistics().misses);
+	}
+
+	void testTruncatedFile()
+	{
+		{
+			TerrainPageCache cache;
+			cache.setDirectory(mDirectory.string(), 1024 * 1024);
+			cache.save(1, createPageData(true, true));
+			cache.save(2, createPageData(true, true));
+			cache.save(3, createPageData(true, true));
+		}
+
+		//Cut the files off at various points, as if a session had ended while writing them.
+		boost::filesystem::resize_file(getPath(1), boost::filesystem::file_size(getPath(1)) - 1);
+		boost::filesystem::resize_file(getPath(2), 10);
+		boost::filesystem::resize_file(getPath(3), 0);
+
+		TerrainPageCache cache;
+		cache.setDirectory(mDirectory.string(), 1024 * 1024);
+		for (TerrainPageCache::Key key = 1; key <= 3; ++key) {
+			TerrainPageCache::PageData loaded;
+			CPPUNIT_ASSERT(!cache.load(key, loaded));
+			CPPUNIT_ASSERT(!cache.contains(key));
+			CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(key)));
+		}
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.getStatistics().entries);
+	}
+
+	void testEviction()
+	{
+		size_t pageSize = getPageSize();
+		CPPUNIT_ASSERT(pageSize > 0);
+
+		//Room for three pages, but not four.
+		TerrainPageCache cache;
+		cache.setDirectory(mDirectory.string(), pageSize * 3 + pageSize / 2);
+		cache.save(1, createPageData(false, false));
+		cache.save(2, createPageData(false, false));
+		cache.save(3, createPageData(false, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(3), cache.getStatistics().entries);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cache.getStatistics().evictions);
+
+		//Using the first page should make the second one the least recently used.
+		TerrainPageCache::PageData loaded;
+		CPPUNIT_ASSERT(cache.load(1, loaded));
+
+		cache.save(4, createPageData(false, false));
+		CPPUNIT_ASSERT_EQUAL(size_t(3), cache.getStatistics().entries);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cache.getStatistics().evictions);
+		CPPUNIT_ASSERT(cache.getStatistics().diskUsed <= pageSize * 3 + pageSize / 2);
+		CPPUNIT_ASSERT(cache.contains(1));
+		CPPUNIT_ASSERT(!cache.contains(2));
+		CPPUNIT_ASSERT(cache.contains(3));
+		CPPUNIT_ASSERT(cache.contains(4));
+		CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(2)));
+
+		//A smaller budget in a new session should evict the least recently used pages found on disk.
+		//The usage order is kept as the modification times, which have a resolution of a second, so make it unambiguous.
+		std::time_t now = std::time(nullptr);
+		boost::filesystem::last_write_time(getPath(3), now - 30);
+		boost::filesystem::last_write_time(getPath(4), now - 20);
+		boost::filesystem::last_write_time(getPath(1), now - 10);
+
+		TerrainPageCache newCache;
+		newCache.setDirectory(mDirectory.string(), pageSize + pageSize / 2);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), newCache.getStatistics().entries);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), newCache.getStatistics().evictions);
+		CPPUNIT_ASSERT(newCache.contains(1));
+		CPPUNIT_ASSERT(!newCache.contains(3));
+		CPPUNIT_ASSERT(!newCache.contains(4));
+		CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(3)));
+		CPPUNIT_ASSERT(!boost::filesystem::exists(getPath(4)));
+	}
+
+};
+
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Ember::TerrainPageCacheTestCase);
+
+int main(int argc, char **argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+	runner.addTest(registry.makeTest());
+
+	// Shows a message as each test starts
+	CppUnit::BriefTestProgressListener listener;
+	runner.eventManager().addListener(&listener);
+
+	bool wasSuccessful = runner.run("", false);
+	return !wasSuccessful;
+}